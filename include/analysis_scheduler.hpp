@@ -0,0 +1,111 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_analyzer.hpp"
+
+// Lower value runs first
+enum class AnalysisPriority {
+    DECK = 0,       // Track was just loaded to a deck
+    IMPORT = 1      // Library import or rescan
+};
+
+enum class AnalysisJobState {
+    QUEUED,
+    RUNNING,
+    DONE,
+    FAILED,
+    CANCELLED
+};
+
+const char* analysis_job_state_name(AnalysisJobState state);
+
+struct AnalysisJobStatus {
+    std::string track_id;
+    std::string file_path;
+    AnalysisPriority priority = AnalysisPriority::IMPORT;
+    AnalysisJobState state = AnalysisJobState::QUEUED;
+    float progress = 0.0f;          // 0.0 - 1.0
+    std::string error;
+
+    // Set when state is DONE
+    std::shared_ptr<const OneStopRadio::WaveformData> waveform;
+    std::string waveform_path;      // Empty unless waveform_dir is set
+};
+
+struct AnalysisSummary {
+    size_t workers = 0;
+    size_t queued = 0;
+    size_t running = 0;
+    uint64_t done = 0;
+    uint64_t failed = 0;
+    uint64_t cancelled = 0;
+};
+
+struct AnalysisSchedulerOptions {
+    size_t workers = 0;             // 0 = hardware threads - 1, at least 1
+    size_t max_queued = 10000;      // IMPORT submissions beyond this are refused
+    size_t batch_size = 64;         // Finished jobs that trigger an early sink call
+    std::chrono::milliseconds flush_interval{500};
+    size_t history = 1024;          // Finished jobs kept for get_job()
+    OneStopRadio::AnalysisConfig analysis;
+
+    // When set, finished tracks are saved there as <track_id>.osrwf
+    // (AudioAnalyzer::export_to_binary) and <track_id>.osrwp (WaveformPyramid)
+    std::string waveform_dir;
+};
+
+/**
+ * Background track analysis
+ *
+ * Jobs wait in a bounded queue ordered by priority, then submission order.
+ * Each worker thread owns an AudioAnalyzer, so FFT buffers are reused
+ * across tracks and never shared between threads.
+ *
+ * Job updates are delivered to the sink from a single writer thread, as
+ * soon as batch_size jobs have finished or every flush_interval, whichever
+ * comes first. A batch also carries new and running jobs with their current
+ * progress, so the sink can persist everything in one transaction.
+ */
+class AnalysisScheduler {
+public:
+    using BatchSink = std::function<void(const std::vector<AnalysisJobStatus>& updates)>;
+
+    explicit AnalysisScheduler(const AnalysisSchedulerOptions& options = AnalysisSchedulerOptions());
+    ~AnalysisScheduler();
+
+    // Set before start()
+    void set_sink(BatchSink sink);
+
+    bool start();
+    // Interrupts running jobs. They and the queued jobs are dropped without a
+    // final update, so the sink's last record of them is queued or running.
+    void stop();
+    bool is_running() const;
+
+    /**
+     * Queue a track. Submitting a track that is already queued raises its
+     * priority if the new one is higher; a running track is left alone.
+     * @return false if the queue is full or the scheduler is stopped
+     */
+    bool submit(const std::string& track_id, const std::string& file_path,
+                AnalysisPriority priority = AnalysisPriority::IMPORT);
+
+    // @return false if the track is not queued or running
+    bool cancel(const std::string& track_id);
+    size_t cancel_all();
+
+    bool get_job(const std::string& track_id, AnalysisJobStatus& status) const;
+    // Queued and running: running first, then queued in run order, from offset
+    std::vector<AnalysisJobStatus> get_jobs(size_t offset = 0, size_t limit = SIZE_MAX) const;
+    AnalysisSummary get_summary() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct SwrContext;
+
+namespace OneStopRadio {
+
+enum class AudioDecoderBackend {
+    SNDFILE,        // WAV, FLAC, AIFF, Ogg Vorbis and the rest of libsndfile's formats
+    FFMPEG          // MP3, AAC/M4A, Opus, WMA and anything else libavformat opens
+};
+
+struct AudioDecoderInfo {
+    AudioDecoderBackend backend = AudioDecoderBackend::SNDFILE;
+    int source_sample_rate = 0;
+    int sample_rate = 0;            // Output rate
+    int channels = 0;
+    uint64_t frames = 0;            // Output frames; from the container duration for FFmpeg, so an estimate
+};
+
+/**
+ * Streaming decoder producing interleaved float frames at a chosen rate
+ *
+ * open() uses libsndfile when it recognises the file, for its exact frame
+ * counts and sample-accurate seeks, and FFmpeg otherwise. When the output
+ * rate differs from the file's, a libswresample context owned by the
+ * decoder converts as it reads; its filter state carries over between
+ * reads, so consecutive blocks join seamlessly, and seek() resets it.
+ *
+ * Not thread-safe; one decoder per stream.
+ */
+class AudioDecoder {
+public:
+    /**
+     * @param sample_rate Output rate; 0 keeps the file's rate
+     * @return nullptr if neither backend can decode the file
+     */
+    static std::unique_ptr<AudioDecoder> open(const std::string& file_path, int sample_rate = 0);
+
+    virtual ~AudioDecoder();
+
+    AudioDecoder(const AudioDecoder&) = delete;
+    AudioDecoder& operator=(const AudioDecoder&) = delete;
+
+    const AudioDecoderInfo& info() const { return info_; }
+    const std::string& file_path() const { return file_path_; }
+
+    // Output frame the next read() starts at
+    uint64_t position() const { return position_; }
+
+    // @return frames written to `out`; fewer than `frames` only at the end of the stream
+    size_t read(float* out, size_t frames);
+
+    // @param frame Output frame
+    bool seek(uint64_t frame);
+
+protected:
+    explicit AudioDecoder(std::string file_path);
+
+    // Configure conversion from `format` (an AVSampleFormat) at the source rate
+    bool init_resampler(int format);
+
+    /**
+     * Convert `frames` source frames and append them to `out`; `input` is
+     * one pointer per plane for planar formats. A null `input` drains the
+     * resampler at the end of the stream.
+     */
+    bool convert(const uint8_t* const* input, int frames, std::vector<float>& out);
+
+    // Append the next decoded block; false at the end of the stream or on error
+    virtual bool decode_more(std::vector<float>& out) = 0;
+    virtual bool seek_source(uint64_t source_frame) = 0;
+
+    AudioDecoderInfo info_;
+    uint64_t discard_frames_ = 0;   // Output frames before the seek target still to drop
+
+private:
+    std::string file_path_;
+    SwrContext* resampler_ = nullptr;
+    int input_format_ = -1;
+    std::vector<float> pending_;    // Decoded output not yet returned by read()
+    size_t pending_offset_ = 0;     // In samples
+    uint64_t position_ = 0;
+    bool drained_ = false;
+};
+
+} // namespace OneStopRadio
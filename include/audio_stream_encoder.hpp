@@ -8,6 +8,11 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
+#include <tuple>
+
+#include "shout_sender.hpp"
+#include "utils/audio_ring_buffer.hpp"
 
 extern "C" {
 #include <shout/shout.h>
@@ -79,6 +84,7 @@ struct StreamConfig {
     int reconnect_delay = 5;        // seconds
     int max_reconnect_attempts = -1; // -1 = infinite
     int connection_timeout = 10;     // seconds
+    int send_queue_ms = 2000;        // Audio buffered for a slow server before the oldest is dropped
     
     // Advanced options
     bool public_stream = true;
@@ -121,8 +127,16 @@ struct StreamStats {
     // Stream health
     int buffer_fill = 0;             // Buffer fill percentage
     int dropped_frames = 0;
+    uint64_t buffer_overflows = 0;   // Times the encoder fell a full ring behind the master bus
+    uint64_t buffer_underruns = 0;   // Reads that timed out waiting for master bus audio
     double latency = 0.0;            // Stream latency (ms)
     
+    // Network sender
+    int send_queue_packets = 0;      // Encoded packets waiting for the server
+    uint64_t send_queue_bytes = 0;
+    uint64_t packets_dropped = 0;    // Oldest packets dropped because the server could not keep up
+    double max_latency = 0.0;        // Worst enqueue-to-socket time (ms)
+    
     // Listeners (if supported by server)
     int current_listeners = 0;
     int peak_listeners = 0;
@@ -151,11 +165,150 @@ public:
     virtual std::string get_current_metadata() { return ""; }
 };
 
+/**
+ * Parameters that fully determine an encoded bitstream.
+ * Mounts with equal profiles can share a single encoder.
+ */
+struct EncoderProfile {
+    StreamCodec codec = StreamCodec::MP3;
+    int bitrate = 128;              // kbps
+    int sample_rate = 44100;        // Hz
+    int channels = 2;
+    
+    static EncoderProfile from_config(const StreamConfig& config);
+    std::string to_string() const;
+    
+    bool operator<(const EncoderProfile& other) const {
+        return std::tie(codec, bitrate, sample_rate, channels) <
+               std::tie(other.codec, other.bitrate, other.sample_rate, other.channels);
+    }
+    bool operator==(const EncoderProfile& other) const {
+        return !(*this < other) && !(other < *this);
+    }
+};
+
+/**
+ * Receiver of encoded packets (typically one server connection)
+ */
+class EncodedPacketSink {
+public:
+    virtual ~EncodedPacketSink() = default;
+    
+    /**
+     * Called on the encoding thread for every packet, in order.
+     * Must not call back into the encoder's add_sink()/remove_sink().
+     */
+    virtual void on_encoded_packet(const EncodedPacketPtr& packet) = 0;
+};
+
+/**
+ * Encodes one profile once and fans the packets out to any number of sinks
+ *
+ * Either runs its own thread pulling from a master bus reader (start()), or
+ * is driven by the caller through encode(); the two must not be mixed.
+ * Sinks that join a running stream are first sent the stream headers, so
+ * Ogg mounts can be added while other mounts of the same profile are live.
+ */
+class SharedStreamEncoder {
+public:
+    explicit SharedStreamEncoder(const EncoderProfile& profile);
+    ~SharedStreamEncoder();
+    
+    SharedStreamEncoder(const SharedStreamEncoder&) = delete;
+    SharedStreamEncoder& operator=(const SharedStreamEncoder&) = delete;
+    
+    // Create the codec; must succeed before start() or encode()
+    bool open();
+    
+    bool start(std::shared_ptr<AudioRingBuffer::Reader> source);
+    void stop();
+    bool is_running() const { return running_; }
+    
+    // Encode interleaved samples on the calling thread and deliver the packets
+    bool encode(const float* samples, size_t frames);
+    
+    // Encode digital silence, bridging master bus underruns so mounts stay fed
+    bool encode_silence(size_t frames);
+    
+    void add_sink(EncodedPacketSink* sink);
+    void remove_sink(EncodedPacketSink* sink);
+    size_t sink_count() const;
+    
+    const EncoderProfile& profile() const { return profile_; }
+    std::shared_ptr<AudioRingBuffer::Reader> source() const { return source_; }
+    std::string get_error() const;
+    uint64_t packets_encoded() const { return packets_encoded_; }
+    uint64_t frames_encoded() const { return frames_encoded_; }
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+    
+    const EncoderProfile profile_;
+    
+    // Sinks and the headers replayed to late joiners
+    std::vector<EncodedPacketSink*> sinks_;
+    std::vector<EncodedPacketPtr> header_packets_;
+    mutable std::mutex sinks_mutex_;
+    
+    // Worker for start() mode
+    std::shared_ptr<AudioRingBuffer::Reader> source_;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> should_stop_{false};
+    
+    std::atomic<uint64_t> packets_encoded_{0};
+    std::atomic<uint64_t> frames_encoded_{0};
+    std::string error_;
+    mutable std::mutex error_mutex_;
+    
+    void worker_loop();
+    void set_error(const std::string& error);
+    void emit_packet(const uint8_t* data, size_t size, size_t frames);
+    void emit_header(const uint8_t* data, size_t size);
+    void emit_ogg_pages(bool flush, bool header);
+    bool setup_mp3_encoder();
+    bool setup_vorbis_encoder();
+    bool setup_opus_encoder();
+    bool setup_aac_encoder();
+    bool encode_mp3(const float* samples, size_t frames);
+    bool encode_vorbis(const float* samples, size_t frames);
+    bool encode_opus(const float* samples, size_t frames);
+    bool encode_aac(const float* samples, size_t frames);
+};
+
+/**
+ * Hands out one running SharedStreamEncoder per distinct profile, so encoding
+ * cost scales with the number of profiles rather than the number of mounts
+ */
+class SharedEncoderPool {
+public:
+    using ReaderFactory = std::function<std::shared_ptr<AudioRingBuffer::Reader>()>;
+    
+    explicit SharedEncoderPool(ReaderFactory make_reader);
+    ~SharedEncoderPool();
+    
+    // Running encoder for the profile, started on a new reader if none exists yet
+    std::shared_ptr<SharedStreamEncoder> acquire(const EncoderProfile& profile);
+    
+    // Stop and drop encoders that no longer have sinks
+    void release_idle();
+    void clear();
+    
+    size_t encoder_count() const;
+    std::vector<EncoderProfile> active_profiles() const;
+
+private:
+    ReaderFactory make_reader_;
+    std::map<EncoderProfile, std::shared_ptr<SharedStreamEncoder>> encoders_;
+    mutable std::mutex mutex_;
+};
+
 /**
  * Professional Audio Stream Encoder
  * Supports Icecast2, SHOUTcast, and HTTP streaming
  */
-class AudioStreamEncoder {
+class AudioStreamEncoder : public EncodedPacketSink {
 public:
     AudioStreamEncoder();
     ~AudioStreamEncoder();
@@ -170,7 +323,12 @@ public:
     bool is_connected() const { return status_ == StreamStatus::CONNECTED || status_ == StreamStatus::STREAMING; }
     
     // Streaming control
-    bool start_streaming(AudioStreamCallback* callback);
+    bool start_streaming(AudioStreamCallback* callback = nullptr);
+    // Pull audio from a master bus reader; the worker blocks until data is available
+    bool start_streaming(std::shared_ptr<AudioRingBuffer::Reader> source);
+    // Send packets from an encoder shared with other mounts. Gain, gate and
+    // limiter settings do not apply, as the audio is encoded once for all.
+    bool start_streaming(std::shared_ptr<SharedStreamEncoder> shared_encoder);
     bool stop_streaming();
     bool is_streaming() const { return status_ == StreamStatus::STREAMING; }
     
@@ -189,6 +347,8 @@ public:
     
     // Advanced features
     bool set_gain(float gain);  // Linear gain adjustment
+    // Limiting happens once on the master bus (AudioSystem::set_limiter), not
+    // per stream; enabling it here fails
     bool enable_limiter(bool enabled, float threshold = -1.0f);
     bool enable_noise_gate(bool enabled, float threshold = -40.0f);
     
@@ -221,12 +381,22 @@ private:
     std::condition_variable stop_condition_;
     std::mutex stop_mutex_;
     
-    // Audio callback
+    // Audio sources (either a ring reader or a pull callback)
     AudioStreamCallback* audio_callback_{nullptr};
+    std::shared_ptr<AudioRingBuffer::Reader> audio_source_;
+    
+    // Encoder whose packets this connection sends; private unless shared_encoder_ is set
+    std::shared_ptr<SharedStreamEncoder> encoder_;
+    bool shared_encoder_ = false;
+    
+    // EncodedPacketSink
+    void on_encoded_packet(const EncodedPacketPtr& packet) override;
     
     // Internal methods
     void streaming_worker();
+    bool launch_worker();
     bool setup_encoder();
+    void apply_audio_processing(float* samples, size_t frames);
     bool setup_connection();
     void cleanup();
     bool encode_and_send(const float* samples, size_t frames);
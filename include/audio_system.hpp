@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <memory>
 #include <vector>
 #include <string>
@@ -10,6 +11,15 @@
 #include <mutex>
 #include <condition_variable>
 
+#include "utils/audio_ring_buffer.hpp"
+#include "utils/param_ramp.hpp"
+#include "dynamics_processor.hpp"
+#include "disk_recorder.hpp"
+#include "spectrum_analyzer.hpp"
+#include "beat_tracker.hpp"
+#include "track_cache.hpp"
+#include "time_stretcher.hpp"
+
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
@@ -26,6 +36,8 @@ class AudioMixer;
 class AudioEffect;
 class AudioCompressor;
 class AudioEqualizer;
+class SharedStreamEncoder;
+struct EncoderProfile;
 
 /**
  * Audio format configuration
@@ -52,6 +64,17 @@ struct AudioLevels {
     uint64_t timestamp = 0;      // Timestamp in ms
 };
 
+/**
+ * Tempo relation of the channels passed to enable_bpm_sync()
+ */
+struct BpmSyncStatus {
+    bool active = false;
+    float master_bpm = 0.0f;     // 0 until the channel's tempo is known
+    float slave_bpm = 0.0f;
+    float tempo_ratio = 1.0f;    // Slave playback rate that matches the master tempo
+    float phase_offset = 0.0f;   // Slave beat phase minus the master's, in beats (-0.5 to 0.5)
+};
+
 /**
  * Microphone configuration
  */
@@ -104,6 +127,39 @@ struct StreamingConfig {
     bool enabled = false;
 };
 
+/**
+ * Audio fed into the mixer from outside the audio device, e.g. a remote
+ * contributor. One producer thread writes; the audio callback takes one
+ * block per period, or plays silence when a whole block has not arrived.
+ * Nothing paces the producer: it keeps buffered_frames() just above
+ * block_frames(), which is all the latency this adds.
+ */
+class LiveInput {
+public:
+    const std::string& id() const { return id_; }
+    int sample_rate() const { return ring_->sample_rate(); }
+    int channels() const { return ring_->channels(); }
+    size_t block_frames() const { return block_frames_; }   // Taken per audio callback
+
+    // Producer thread only; at most a quarter of a second per call
+    void write(const float* interleaved, size_t frames);
+    size_t buffered_frames() const;      // Written and not yet mixed
+    uint64_t underruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+    // Audio thread: exactly `frames` frames, or false and nothing
+    bool read(float* out, size_t frames);
+
+    LiveInput(const std::string& id, int sample_rate, int channels, size_t block_frames);
+
+private:
+    std::string id_;
+    size_t block_frames_;
+    std::shared_ptr<AudioRingBuffer> ring_;
+    std::shared_ptr<AudioRingBuffer::Reader> reader_;
+    std::atomic<uint64_t> consumed_{0};
+    std::atomic<uint64_t> underruns_{0};
+};
+
 /**
  * Complete Audio Processing System
  * Handles all audio duties for the radio platform
@@ -139,7 +195,14 @@ public:
     AudioChannelConfig get_channel_config(const std::string& channel_id);
     std::vector<std::string> get_active_channels();
 
-    // Audio file playback
+    // Live inputs take a mixer slot under their own id, so configure_channel()
+    // and the channel volume setters apply to them. Null if the id is taken
+    // or every slot is in use.
+    std::shared_ptr<LiveInput> create_live_input(const std::string& input_id);
+    bool destroy_live_input(const std::string& input_id);
+
+    // Audio file playback; decks play decoded PCM from the track cache, so a
+    // load of a cached track and every seek is a pointer handoff with no I/O
     bool load_audio_file(const std::string& channel_id, const std::string& file_path);
     bool play_channel(const std::string& channel_id);
     bool pause_channel(const std::string& channel_id);
@@ -147,6 +210,20 @@ public:
     bool set_channel_position(const std::string& channel_id, double position_seconds);
     double get_channel_position(const std::string& channel_id);
     double get_channel_duration(const std::string& channel_id);
+    
+    // Deck tempo and pitch; every deck plays through its own time-stretcher.
+    // Without key lock the pitch follows the rate, as on a turntable; with it
+    // only the pitch shift (-12 to +12 semitones) moves it
+    bool set_channel_playback_rate(const std::string& channel_id, double rate);
+    bool set_channel_key_lock(const std::string& channel_id, bool enabled);
+    bool set_channel_pitch_shift(const std::string& channel_id, double semitones);
+    bool get_time_stretch_stats(const std::string& channel_id, OneStopRadio::TimeStretchStats& stats);
+    
+    // Decoded-track cache: decode upcoming tracks and hot-cue regions in the background
+    void prefetch_audio_file(const std::string& file_path);
+    void preload_audio_region(const std::string& file_path, double position_seconds);
+    void set_track_cache_budget(size_t bytes);
+    TrackCacheStats get_track_cache_stats();
 
     // Real-time audio mixing
     bool set_crossfader_position(float position); // -1.0 to 1.0
@@ -174,7 +251,17 @@ public:
     float get_microphone_level();
     AudioLevels get_master_audio_levels(); // Returns complete master level info
     
-    // Volume fading for talkover
+    // Gain automation. Ramps run per sample in the audio callback and start
+    // from the current value, so a new ramp takes over a running one without
+    // a jump; the plain setters use a short linear ramp against zipper noise.
+    bool ramp_master_volume(float target, float ramp_ms, RampShape shape = RampShape::EXPONENTIAL);
+    bool ramp_channel_volume(const std::string& channel_id, float volume, float ramp_ms,
+                             RampShape shape = RampShape::EXPONENTIAL);
+    bool ramp_microphone_gain(float gain, float ramp_ms, RampShape shape = RampShape::EXPONENTIAL);
+    // Program ducking on top of the master volume, 1.0 for none
+    bool set_duck_level(float level, float ramp_ms, RampShape shape = RampShape::EXPONENTIAL);
+    
+    // Volume fading for talkover; an exponential ramp_master_volume()
     bool fade_master_volume(float target_volume, float fade_time_ms);
     
     // Audio monitoring control
@@ -186,12 +273,17 @@ public:
     
     // Channel control methods for DJ mixing
     bool set_channel_playback(const std::string& channel_id, bool play);
-    bool set_channel_eq(const std::string& channel_id, float bass, float mid, float treble);
+    bool set_channel_eq(const std::string& channel_id, float bass, float mid, float treble);   // dB
+    bool set_channel_filter(const std::string& channel_id, float position);   // -1 low-pass ... 0 off ... 1 high-pass
 
-    // Recording
+    // Recording from the master bus on its own threads. The single-file form
+    // takes the format from the extension (.wav, .flac, .mp3, .ogg, .opus, .aac);
+    // RecorderOptions also segments an aircheck or archive on the hour.
     bool start_recording(const std::string& output_file, const AudioFormat& format = {});
+    bool start_recording(const RecorderOptions& options);
     bool stop_recording();
     bool is_recording() const { return recording_; }
+    RecorderStats get_recording_stats() const;   // Of the running or last recording
 
     // Live streaming
     bool add_stream_target(const std::string& name, const StreamingConfig& config);
@@ -200,22 +292,60 @@ public:
     bool stop_streaming();
     bool is_streaming() const { return streaming_; }
     std::map<std::string, StreamingConfig> get_stream_targets();
+    
+    // Independent cursor on the post-master program bus (encoders, recorders, monitors)
+    std::shared_ptr<AudioRingBuffer::Reader> create_master_bus_reader();
+    int get_sample_rate() const;
+    int get_channel_count() const;
+    // Seconds from the end of the mix to the device output, 0 while stopped
+    double get_output_latency() const;
+    // Program bus encoder shared with stream targets of the same profile, for
+    // consumers outside the audio system such as the RTMP muxers. Register as
+    // a sink straight away: stream changes stop encoders without sinks.
+    std::shared_ptr<SharedStreamEncoder> acquire_shared_encoder(const EncoderProfile& profile);
+    // Stop shared encoders nothing is a sink of any more
+    void release_idle_encoders();
 
     // Advanced features
     bool enable_auto_duck(bool enabled, float threshold = -20.0f, float duck_amount = 0.3f);
+    // Master bus dynamics, applied once before the program reaches any output:
+    // a lookahead true-peak limiter (threshold is the ceiling in dBTP) after
+    // the "master" compressor of enable_channel_compressor()
     bool set_limiter(bool enabled, float threshold = -1.0f, float release = 50.0f);
+    OneStopRadio::DynamicsStats get_master_dynamics_stats() const;
     bool enable_spectral_analyzer(bool enabled);
-    std::vector<float> get_spectrum_data(int bins = 256); // FFT spectrum data
+    bool set_spectral_analyzer_options(const SpectrumAnalyzerOptions& options); // Restarts a running analyzer
+    std::vector<float> get_spectrum_data(int bins = 256); // Latest master bus spectrum, 0.0 - 1.0 per bin, lock-free
 
-    // BPM detection and sync
-    float detect_bpm(const std::string& channel_id);
-    bool enable_bpm_sync(const std::string& channel_a, const std::string& channel_b);
+    // BPM detection and sync; every playing channel is beat-tracked in the audio callback
+    float detect_bpm(const std::string& channel_id);     // 0 until a tempo is found
+    bool get_beat_grid(const std::string& channel_id, OneStopRadio::BeatGrid& grid);
+    bool enable_bpm_sync(const std::string& channel_a, const std::string& channel_b); // channel_a is the master
     bool disable_bpm_sync();
+    BpmSyncStatus get_bpm_sync_status();
 
     // Audio callback for external processing
     using AudioCallback = std::function<void(const float* input, float* output, int frames, int channels)>;
     void set_audio_callback(AudioCallback callback);
 
+    // Run the mixer without a device: frames of interleaved input (may be
+    // null) in, the master program out. Only while stopped; for offline
+    // rendering and benchmarks.
+    bool render_offline(const float* input, float* output, int frames);
+
+    // Bumped after every parameter, topology, streaming or recording change;
+    // see SnapshotCache. Levels and positions move without bumping it.
+    uint64_t get_state_generation() const;
+
+    // Run without a device, clocked by the caller: start_headless() starts
+    // everything but the device stream, then process_block() must be called
+    // with get_block_frames() frames per period, in real time from a single
+    // thread. Used by StationHost, where one worker clocks many stations.
+    bool start_headless();
+    bool is_headless() const;
+    bool process_block(float* output, int frames);
+    int get_block_frames() const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> impl_;
@@ -243,18 +373,8 @@ private:
     std::mutex callback_mutex_;
     
     // Channel control variables
-    SNDFILE* channel_a_file_ = nullptr;
-    SNDFILE* channel_b_file_ = nullptr;
-    SF_INFO channel_a_info_;
-    SF_INFO channel_b_info_;
-    std::vector<float> channel_a_buffer_;
-    std::vector<float> channel_b_buffer_;
-    bool channel_a_loaded_ = false;
-    bool channel_b_loaded_ = false;
-    bool channel_a_playing_ = false;
-    bool channel_b_playing_ = false;
-    sf_count_t channel_a_position_ = 0;
-    sf_count_t channel_b_position_ = 0;
+    std::mutex deck_mutex_;         // Guards the deck tracks
+    std::array<std::shared_ptr<const DecodedTrack>, 2> deck_tracks_;  // A, B
     float channel_a_volume_ = 0.75f;
     float channel_b_volume_ = 0.75f;
     
@@ -314,43 +434,111 @@ private:
 
 /**
  * Real-time Audio Effects
+ *
+ * Every edit builds a new, immutable list of effects on the calling thread
+ * and publishes it with a single atomic exchange, so process() switches
+ * lists at a block boundary without locking. With a crossfade set, added
+ * effects fade in and removed ones fade out over that many frames instead
+ * of switching abruptly. Lists the audio thread can no longer be reading
+ * are freed by the next edit or the destructor, never by process().
+ *
+ * Parameters are bound once by name to an integer id; set_parameter() with
+ * that id stores straight into the effect's atomic.
  */
 class AudioEffectChain {
 public:
+    using ParameterId = int;
+    static constexpr ParameterId kInvalidParameter = -1;
+
     AudioEffectChain();
     ~AudioEffectChain();
 
     void add_effect(std::unique_ptr<AudioEffect> effect);
     void remove_effect(const std::string& effect_id);
     void clear_effects();
-    
+    std::vector<std::string> get_effect_ids() const;
+
+    // Frames added and removed effects fade over; 0 switches at the next block
+    void set_crossfade_frames(int frames);
+
+    // Audio thread; never allocates, locks or frees
     void process(float* samples, int frames, int channels);
     void set_bypass(bool bypassed) { bypassed_ = bypassed; }
 
+    // Ids stay valid until their effect is removed
+    ParameterId bind_parameter(const std::string& effect_id, const std::string& name);
+    bool set_parameter(ParameterId id, float value);
+
 private:
-    std::vector<std::unique_ptr<AudioEffect>> effects_;
+    class Impl;
+    std::unique_ptr<Impl> impl_;
     std::atomic<bool> bypassed_{false};
 };
 
 /**
  * Base Audio Effect Class
+ *
+ * Effects declare their parameters in the constructor with add_parameter();
+ * each is an atomic addressed by its index, so setting one from a control
+ * thread never races process(), which reads them with parameter().
  */
 class AudioEffect {
 public:
+    static constexpr int kMaxParameters = 16;
+
     AudioEffect(const std::string& id) : id_(id) {}
     virtual ~AudioEffect() = default;
     
     virtual void process(float* samples, int frames, int channels) = 0;
     virtual void reset() {}
-    virtual void set_parameter(const std::string& name, float value) {}
+
+    int get_parameter_count() const { return parameter_count_; }
+    int get_parameter_index(const std::string& name) const {
+        for (int i = 0; i < parameter_count_; ++i) {
+            if (parameter_names_[i] == name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+    bool set_parameter(int index, float value) {
+        if (index < 0 || index >= parameter_count_) {
+            return false;
+        }
+        parameters_[index].store(value, std::memory_order_relaxed);
+        return true;
+    }
+    // Looks the name up on every call; bind the index for repeated updates
+    bool set_parameter(const std::string& name, float value) {
+        return set_parameter(get_parameter_index(name), value);
+    }
+    float get_parameter(int index) const {
+        return index >= 0 && index < parameter_count_ ? parameter(index) : 0.0f;
+    }
     
     const std::string& get_id() const { return id_; }
     void set_enabled(bool enabled) { enabled_ = enabled; }
     bool is_enabled() const { return enabled_; }
 
 protected:
+    // Constructor only: the indices are declaration order
+    int add_parameter(const std::string& name, float initial_value) {
+        if (parameter_count_ == kMaxParameters) {
+            return -1;
+        }
+        parameter_names_[parameter_count_] = name;
+        parameters_[parameter_count_].store(initial_value, std::memory_order_relaxed);
+        return parameter_count_++;
+    }
+    float parameter(int index) const { return parameters_[index].load(std::memory_order_relaxed); }
+
     std::string id_;
     std::atomic<bool> enabled_{true};
+
+private:
+    std::atomic<float> parameters_[kMaxParameters] = {};
+    std::string parameter_names_[kMaxParameters];
+    int parameter_count_ = 0;
 };
 
 /**
@@ -364,6 +552,8 @@ public:
     void process(float* samples, int frames, int channels) override;
     void reset() override;
     
+    enum Parameter : int { LOW_GAIN, MID_GAIN, HIGH_GAIN };   // dB
+
     void set_low_gain(float gain_db);    // Low shelf at 200Hz
     void set_mid_gain(float gain_db);    // Peak at 1kHz
     void set_high_gain(float gain_db);   // High shelf at 8kHz
@@ -384,6 +574,8 @@ public:
     void process(float* samples, int frames, int channels) override;
     void reset() override;
     
+    enum Parameter : int { THRESHOLD, RATIO, ATTACK, RELEASE, MAKEUP_GAIN };
+
     void set_threshold(float threshold_db);
     void set_ratio(float ratio);
     void set_attack(float attack_ms);
@@ -0,0 +1,116 @@
+#pragma once
+#include "utils/seqlock.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OneStopRadio {
+
+enum class BeatTrackerMode {
+    STREAMING,  // Live decks: the autocorrelation forgets, the grid follows tempo changes
+    OFFLINE     // Whole tracks: the autocorrelation accumulates, finish() returns one grid
+};
+
+struct BeatTrackerOptions {
+    BeatTrackerMode mode = BeatTrackerMode::STREAMING;
+    int sample_rate = 48000;
+    float onset_rate = 200.0f;      // Onset-strength frames per second
+    float min_bpm = 70.0f;
+    float max_bpm = 180.0f;
+    float history_seconds = 8.0f;   // Onsets kept for phase locking; also the streaming autocorrelation's memory
+    float update_seconds = 0.25f;   // Streaming re-estimation interval
+};
+
+/**
+ * Beats at beat_time + n * 60 / bpm seconds, counted from the first sample
+ * the tracker processed
+ */
+struct BeatGrid {
+    float bpm = 0.0f;               // 0 until a tempo has been found
+    float confidence = 0.0f;        // 0.0 - 1.0
+    double beat_time = 0.0;         // Offline: the first beat, in [0, 60 / bpm)
+    double stream_time = 0.0;       // Seconds processed when the grid was estimated
+
+    // Position within the beat at `time`, 0.0 - 1.0
+    double phase_at(double time) const;
+};
+
+/**
+ * Onset-strength and autocorrelation tempo tracker with a phase-locked grid
+ *
+ * Every hop it turns the energy of the full band and of a low band (kicks)
+ * into a rectified log-energy flux. The flux, minus its running mean, feeds
+ * an autocorrelation updated one frame at a time over the lags of the BPM
+ * range and their doubles, so the cost is spread evenly and never spikes.
+ * The tempo is the lag whose autocorrelation, plus half that of twice the
+ * lag, scores best under a mild prior around 120 BPM. The phase comes from
+ * a comb over the onset history, and a PLL nudges the grid toward it.
+ *
+ * All memory is allocated by the constructor; process() never allocates or
+ * locks and is safe on the audio thread. process(), reset(), finish() and
+ * current() belong to one thread; grid() may be called from any thread.
+ */
+class BeatTracker {
+public:
+    explicit BeatTracker(const BeatTrackerOptions& options = BeatTrackerOptions());
+
+    // Feed mono samples
+    void process(const float* mono, size_t frames);
+    void reset();
+
+    // OFFLINE: estimate the grid of everything processed so far
+    BeatGrid finish();
+
+    const BeatGrid& current() const { return grid_; }
+    BeatGrid grid() const { return published_.load(); }
+
+    // Position within the beat at the last processed sample
+    double beat_position() const;
+    double stream_time() const;
+
+    const BeatTrackerOptions& options() const { return options_; }
+
+private:
+    void push_onset(float onset);
+    bool estimate_tempo(float& lag, float& confidence) const;
+    double locate_beat(float lag) const;
+    void update_grid(bool lock_phase);
+    void anchor_offline();
+    double frame_time(double frame) const;
+    double score(int lag) const;
+
+    BeatTrackerOptions options_;
+    int hop_ = 1;
+    double frame_rate_ = 0.0;
+    int min_lag_ = 1;
+    int max_lag_ = 1;
+    double acf_decay_ = 1.0;
+    float mean_decay_ = 0.0f;
+    float low_coefficient_ = 0.0f;
+    int update_frames_ = 1;
+
+    // Front end
+    float low_state_ = 0.0f;
+    float energy_ = 0.0f;
+    float low_energy_ = 0.0f;
+    int hop_fill_ = 0;
+    float last_log_energy_ = 0.0f;
+    float last_log_low_ = 0.0f;
+    float onset_mean_ = 0.0f;
+    uint64_t samples_ = 0;
+
+    // Onset history, centred on the running mean; frame f lives at f % size
+    std::vector<float> onsets_;
+    uint64_t frames_ = 0;
+    std::vector<double> acf_;       // Lags 0 .. 2 * (max_lag_ + 1) + 1
+
+    int frames_since_update_ = 0;
+    bool anchored_ = false;
+    double anchor_frame_ = 0.0;     // OFFLINE: an early beat, in onset frames
+    double beat_frame_ = 0.0;       // Grid anchor, in onset frames
+    float period_frames_ = 0.0f;
+    BeatGrid grid_;
+    SeqLock<BeatGrid> published_;
+};
+
+} // namespace OneStopRadio
@@ -3,15 +3,47 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
 #include <sqlite3.h>
 #include <nlohmann/json.hpp>
 #include "radio_control.hpp"
 
 using json = nlohmann::json;
 
+class JsonWriter;
+
+/**
+ * One page of the library, in the order of an indexed column
+ */
+struct TrackPageRequest {
+    std::string sort = "title";         // title, artist, genre, bpm, added_at or last_played
+    bool descending = false;
+    std::string cursor;                 // next_cursor of the previous page; empty for the first
+    int limit = 100;                    // Capped at DatabaseManager::MAX_PAGE_SIZE
+    std::vector<std::string> fields;    // RadioTrack::to_json names; empty for all of them
+};
+
+struct DatabaseStorageOptions {
+    bool wal = true;                        // WAL journal with synchronous=NORMAL
+    int64_t mmap_size = 256LL << 20;        // Bytes of the file read through mmap; 0 disables
+    int cache_size_kb = 32 * 1024;          // Page cache per connection
+    int read_connections = 4;               // Read-only pool (WAL only); 0 reads on the writer
+    int write_batch_ms = 200;               // Queued updates commit together this often; 0 writes at once
+    int busy_timeout_ms = 5000;
+};
+
 /**
  * Database Manager for persistent storage of radio data
  * Uses SQLite for local database operations
+ *
+ * One writer connection, used under a mutex, and in WAL mode a pool of
+ * read-only connections so searches and listings never wait behind a
+ * write. Play counts, last-played times and track updates are queued and
+ * committed together by a background thread every write_batch_ms; any
+ * other write flushes the queue first, so writes still apply in order.
  */
 class DatabaseManager {
 public:
@@ -19,6 +51,8 @@ public:
     ~DatabaseManager();
     
     // Database initialization
+    // Storage options apply at the next initialize()
+    void set_storage_options(const DatabaseStorageOptions& options) { storage_options_ = options; }
     bool initialize(const std::string& db_path = "radio_database.db");
     void close();
     bool is_connected() const;
@@ -33,16 +67,42 @@ public:
     // ===== TRACK OPERATIONS =====
     
     bool insert_track(const RadioTrack& track);
+    // All or nothing, in one transaction
+    bool insert_tracks(const std::vector<RadioTrack>& tracks);
+    // Queued; see write_batch_ms
     bool update_track(const RadioTrack& track);
     bool delete_track(const std::string& track_id);
     RadioTrack* get_track(const std::string& track_id);
     std::vector<RadioTrack> get_all_tracks();
-    std::vector<RadioTrack> search_tracks(const std::string& query);
+    
+    /**
+     * Write a page of tracks as the members "tracks", "count" and
+     * "next_cursor" (null on the last page) of the object open in `out`.
+     * Rows go from SQLite straight into the writer, so memory follows the
+     * page size, and the cursor is a keyset position, so later pages cost
+     * the same as the first.
+     *
+     * @return false, with nothing written, for an unknown sort key or
+     *         field or a malformed cursor
+     */
+    static constexpr int MAX_PAGE_SIZE = 500;
+    bool write_track_page(const TrackPageRequest& request, JsonWriter& out, std::string& error);
+    
+    // Full-text search over title, artist, album and genre through the
+    // tracks_fts index. Every word matches as a prefix, so partial input
+    // works while typing; results are ranked by relevance (title and artist
+    // weigh most) and paged. An empty query pages through the whole library.
+    // Only the SEARCH_RANK_WINDOW best-ranked matches can be paged through,
+    // which bounds the cost of very broad prefixes; pages past it are empty.
+    static constexpr int MAX_SEARCH_RESULTS = 200;  // Cap on limit
+    static constexpr int SEARCH_RANK_WINDOW = 1000;
+    std::vector<RadioTrack> search_tracks(const std::string& query, int limit = 50, int offset = 0);
+    
     std::vector<RadioTrack> get_tracks_by_genre(const std::string& genre);
     std::vector<RadioTrack> get_tracks_by_artist(const std::string& artist);
     std::vector<RadioTrack> get_tracks_by_bpm_range(int min_bpm, int max_bpm);
     
-    // Track statistics
+    // Track statistics (queued like update_track)
     bool increment_play_count(const std::string& track_id);
     bool update_last_played(const std::string& track_id);
     std::vector<RadioTrack> get_most_played_tracks(int limit = 10);
@@ -122,6 +182,28 @@ public:
     std::vector<HotCueData> get_track_hot_cues(const std::string& track_id);
     bool clear_track_hot_cues(const std::string& track_id);
     
+    // ===== TRACK ANALYSIS =====
+    
+    struct AnalysisJobData {
+        std::string track_id;
+        std::string status;         // queued, running, done, failed, cancelled
+        float progress = 0.0f;
+        std::string error;
+        int duration_ms = 0;
+        float peak = 0.0f;
+        float dynamic_range = 0.0f;
+        std::string waveform_path;
+        float bpm = 0.0f;           // 0 when no steady tempo was found
+        double beat_time = 0.0;     // First beat (seconds)
+        float energy = 0.0f;        // 0.0 - 1.0
+    };
+    
+    // Upserts every job in one transaction; "done" jobs also mark their track
+    // analyzed and, when a tempo was found, set its bpm
+    bool save_analysis_jobs(const std::vector<AnalysisJobData>& jobs);
+    std::vector<AnalysisJobData> get_analysis_jobs(const std::string& status = "");
+    bool get_analysis_job(const std::string& track_id, AnalysisJobData& job);
+    
     // ===== SETTINGS AND PREFERENCES =====
     
     bool save_setting(const std::string& key, const std::string& value);
@@ -165,15 +247,70 @@ public:
     // Custom query execution
     json execute_custom_query(const std::string& sql);
     
-    // Transaction support
-    bool begin_transaction();
-    bool commit_transaction();
-    bool rollback_transaction();
+    // Apply queued writes now
+    bool flush_writes();
 
 private:
     sqlite3* db_;
     bool is_connected_;
     std::string db_path_;
+    DatabaseStorageOptions storage_options_;
+    std::mutex write_mutex_;        // Guards db_ and prepared_statements_
+    
+    // ===== READ POOL =====
+    
+    struct ReadConnection {
+        sqlite3* db = nullptr;
+        sqlite3_stmt* search_tracks = nullptr;
+        sqlite3_stmt* list_tracks = nullptr;
+    };
+    
+    std::vector<std::unique_ptr<ReadConnection>> read_connections_;
+    std::vector<ReadConnection*> idle_readers_;
+    std::mutex read_mutex_;
+    std::condition_variable reader_available_;
+    
+    bool open_read_pool();
+    void close_read_pool();
+    
+    // Run `read` on an idle pooled connection, or on the writer without a pool
+    template <typename Read>
+    auto with_reader(Read&& read);
+    
+    // ===== WRITE BATCHING =====
+    
+    struct PendingWrite {
+        enum class Type {
+            TRACK,
+            PLAY_COUNT,
+            LAST_PLAYED
+        };
+        
+        Type type = Type::TRACK;
+        RadioTrack track;           // Only the id for PLAY_COUNT and LAST_PLAYED
+    };
+    
+    std::vector<PendingWrite> pending_writes_;
+    std::mutex pending_mutex_;
+    std::condition_variable pending_cv_;
+    std::thread batch_thread_;
+    bool batch_running_ = false;
+    
+    bool queue_write(PendingWrite write);
+    void batch_loop();
+    
+    // Lock the writer after committing whatever is queued
+    std::unique_lock<std::mutex> lock_writer();
+    bool flush_pending_writes();    // Writer held
+    
+    // Transactions on the writer connection; writer held, so they never
+    // interleave with a batch flush
+    bool begin_transaction();
+    bool commit_transaction();
+    bool rollback_transaction();
+    bool apply_write(const PendingWrite& write);
+    bool insert_track_row(const RadioTrack& track);
+    bool apply_pragmas(sqlite3* db, bool writer);
     
     // Prepared statements for common operations
     struct PreparedStatements {
@@ -182,6 +319,7 @@ private:
         sqlite3_stmt* delete_track = nullptr;
         sqlite3_stmt* get_track = nullptr;
         sqlite3_stmt* search_tracks = nullptr;
+        sqlite3_stmt* list_tracks = nullptr;
         
         sqlite3_stmt* insert_playlist = nullptr;
         sqlite3_stmt* update_playlist = nullptr;
@@ -212,9 +350,12 @@ private:
     bool prepare_statements();
     void finalize_statements();
     RadioTrack track_from_statement(sqlite3_stmt* stmt);
+    AnalysisJobData analysis_job_from_statement(sqlite3_stmt* stmt);
     RadioPlaylist playlist_from_statement(sqlite3_stmt* stmt);
     CuePointData cue_point_from_statement(sqlite3_stmt* stmt);
     HotCueData hot_cue_from_statement(sqlite3_stmt* stmt);
+    bool create_search_index();
+    static std::string fts_match_expression(const std::string& query);
     
     // Database schema
     static const char* CREATE_TRACKS_TABLE;
@@ -226,6 +367,9 @@ private:
     static const char* CREATE_BROADCAST_TRACKS_TABLE;
     static const char* CREATE_STATION_CONFIG_TABLE;
     static const char* CREATE_SETTINGS_TABLE;
+    static const char* CREATE_ANALYSIS_JOBS_TABLE;
+    static const char* CREATE_TRACKS_FTS_TABLE;
+    static const char* CREATE_TRACKS_FTS_TRIGGERS;
     
     // Indices for performance
     static const char* CREATE_TRACKS_INDICES;
@@ -238,115 +382,3 @@ private:
     void log_sqlite_error(const std::string& operation);
     std::string get_sqlite_error_message();
 };
-
-// Database schema SQL constants
-const char* DatabaseManager::CREATE_TRACKS_TABLE = R"(
-    CREATE TABLE IF NOT EXISTS tracks (
-        id TEXT PRIMARY KEY,
-        title TEXT NOT NULL,
-        artist TEXT NOT NULL,
-        album TEXT,
-        genre TEXT,
-        file_path TEXT NOT NULL UNIQUE,
-        duration_ms INTEGER DEFAULT 0,
-        bpm INTEGER DEFAULT 0,
-        musical_key TEXT,
-        gain REAL DEFAULT 1.0,
-        is_analyzed INTEGER DEFAULT 0,
-        play_count INTEGER DEFAULT 0,
-        added_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-        last_played TIMESTAMP,
-        file_size INTEGER,
-        file_hash TEXT,
-        metadata_json TEXT
-    )
-)";
-
-const char* DatabaseManager::CREATE_PLAYLISTS_TABLE = R"(
-    CREATE TABLE IF NOT EXISTS playlists (
-        id TEXT PRIMARY KEY,
-        name TEXT NOT NULL,
-        description TEXT,
-        is_active INTEGER DEFAULT 0,
-        created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-        updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-        track_count INTEGER DEFAULT 0,
-        total_duration_ms INTEGER DEFAULT 0
-    )
-)";
-
-const char* DatabaseManager::CREATE_PLAYLIST_TRACKS_TABLE = R"(
-    CREATE TABLE IF NOT EXISTS playlist_tracks (
-        playlist_id TEXT NOT NULL,
-        track_id TEXT NOT NULL,
-        position INTEGER NOT NULL,
-        added_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-        PRIMARY KEY (playlist_id, track_id),
-        FOREIGN KEY (playlist_id) REFERENCES playlists(id) ON DELETE CASCADE,
-        FOREIGN KEY (track_id) REFERENCES tracks(id) ON DELETE CASCADE
-    )
-)";
-
-const char* DatabaseManager::CREATE_CUE_POINTS_TABLE = R"(
-    CREATE TABLE IF NOT EXISTS cue_points (
-        id TEXT PRIMARY KEY,
-        track_id TEXT NOT NULL,
-        position_ms REAL NOT NULL,
-        label TEXT,
-        is_loop_start INTEGER DEFAULT 0,
-        is_loop_end INTEGER DEFAULT 0,
-        created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-        FOREIGN KEY (track_id) REFERENCES tracks(id) ON DELETE CASCADE
-    )
-)";
-
-const char* DatabaseManager::CREATE_HOT_CUES_TABLE = R"(
-    CREATE TABLE IF NOT EXISTS hot_cues (
-        track_id TEXT NOT NULL,
-        hot_cue_index INTEGER NOT NULL,
-        position_ms REAL NOT NULL,
-        label TEXT,
-        created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-        PRIMARY KEY (track_id, hot_cue_index),
-        FOREIGN KEY (track_id) REFERENCES tracks(id) ON DELETE CASCADE,
-        CHECK (hot_cue_index >= 0 AND hot_cue_index <= 7)
-    )
-)";
-
-const char* DatabaseManager::CREATE_BROADCAST_SESSIONS_TABLE = R"(
-    CREATE TABLE IF NOT EXISTS broadcast_sessions (
-        id TEXT PRIMARY KEY,
-        start_time TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-        end_time TIMESTAMP,
-        duration_minutes INTEGER,
-        peak_listeners INTEGER DEFAULT 0,
-        metadata_json TEXT
-    )
-)";
-
-const char* DatabaseManager::CREATE_BROADCAST_TRACKS_TABLE = R"(
-    CREATE TABLE IF NOT EXISTS broadcast_tracks (
-        session_id TEXT NOT NULL,
-        track_id TEXT NOT NULL,
-        played_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-        FOREIGN KEY (session_id) REFERENCES broadcast_sessions(id) ON DELETE CASCADE,
-        FOREIGN KEY (track_id) REFERENCES tracks(id) ON DELETE CASCADE
-    )
-)";
-
-const char* DatabaseManager::CREATE_STATION_CONFIG_TABLE = R"(
-    CREATE TABLE IF NOT EXISTS station_config (
-        key TEXT PRIMARY KEY,
-        value TEXT NOT NULL,
-        updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-    )
-)";
-
-const char* DatabaseManager::CREATE_SETTINGS_TABLE = R"(
-    CREATE TABLE IF NOT EXISTS settings (
-        key TEXT PRIMARY KEY,
-        value TEXT NOT NULL,
-        category TEXT,
-        updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-    )
-)";
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+#include "dsp_kernels.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace OneStopRadio {
+
+enum class DeckEqMode : uint8_t {
+    SHELVING,   // Low shelf, mid peak, high shelf: a mixer-channel tone control
+    ISOLATOR    // Crossover split into three bands that can each be killed
+};
+
+enum class DeckEqBand : uint8_t {
+    LOW,
+    MID,
+    HIGH
+};
+
+struct DeckEqOptions {
+    int sample_rate = 48000;
+    DeckEqMode mode = DeckEqMode::SHELVING;
+    float low_hz = 200.0f;          // Low shelf corner, or the low/mid crossover
+    float mid_hz = 1000.0f;         // Mid peak centre (shelving only)
+    float mid_q = 0.7f;
+    float high_hz = 8000.0f;        // High shelf corner, or the mid/high crossover
+    float smoothing_ms = 20.0f;     // Time constant for settings to reach their targets
+};
+
+/**
+ * Settings for one deck
+ */
+struct DeckEqSettings {
+    float low = 1.0f;               // Linear band gains; 0 kills the band
+    float mid = 1.0f;
+    float high = 1.0f;
+    float filter = 0.0f;            // -1 full low-pass ... 0 off ... 1 full high-pass
+    float resonance = 1.3065f;      // Q of the resonant filter section; the default is 4th-order Butterworth
+};
+
+/**
+ * Three-band EQ plus sweepable filter for both decks
+ *
+ * Both stereo decks run as the four lanes of one biquad cascade, so every
+ * section filters deck A and deck B, left and right, in a single SIMD pass.
+ * Callers hand over 4-lane interleaved frames: A.L, A.R, B.L, B.R.
+ *
+ * In shelving mode the bands are RBJ shelves and a peak. In isolator mode
+ * 4th-order Linkwitz-Riley crossovers at low_hz and high_hz split the
+ * signal into three bands that sum back to an allpass, so a killed band is
+ * gone rather than partly cancelled. A deck with flat settings passes its
+ * input untouched; moving in and out of flat crossfades with that dry
+ * signal. The filter is a 4th-order low- or high-pass whose cutoff sweeps
+ * with the position, off in the middle.
+ *
+ * New settings are targets. They are smoothed every kSubBlockFrames, and a
+ * deck's coefficients are only recomputed while its settings are moving.
+ * When every deck is flat and settled, process() returns without touching
+ * the audio.
+ *
+ * Setters and process() belong to the audio thread and never allocate.
+ */
+class DeckEqualizer {
+public:
+    static constexpr int kDecks = 2;
+    static constexpr int kLanes = 2 * kDecks;
+    static constexpr size_t kSubBlockFrames = 64;
+
+    explicit DeckEqualizer(const DeckEqOptions& options = DeckEqOptions());
+
+    void set(int deck, const DeckEqSettings& settings);
+    void set_band(int deck, DeckEqBand band, float gain);
+    void set_filter(int deck, float position);
+
+    const DeckEqSettings& target(int deck) const { return target_[deck]; }
+    DeckEqMode mode() const { return options_.mode; }
+
+    // Whether process() would change the audio
+    bool active() const;
+
+    // Forget filter state, e.g. after a seek; settings jump to their targets
+    void reset();
+
+    // 4-lane interleaved frames, in place
+    void process(float* lanes, size_t frames);
+
+private:
+    static constexpr size_t kToneStages = 3;
+    static constexpr size_t kCrossoverStages = 2;
+    static constexpr size_t kFilterStages = 2;
+
+    DeckEqOptions options_;
+    float smoothing_coeff_;         // Per sub-block step toward the targets
+
+    DeckEqSettings target_[kDecks];
+    DeckEqSettings current_[kDecks];
+    float wet_[kDecks] = {};        // Isolator blend with the dry signal
+    bool running_ = false;          // Processing since the last bypass
+
+    // Shelving tone sections (low shelf, peak, high shelf) then the filter
+    // sections, so the whole shelving chain is one cascade call. Isolator
+    // mode only runs the filter sections.
+    dsp::BiquadStage4 stages_[kToneStages + kFilterStages];
+
+    // Isolator split: low-pass at low_hz plus an allpass matching the phase
+    // of the high_hz crossover; the high-passed rest splits again at high_hz
+    dsp::BiquadStage4 split_low_[kCrossoverStages + 1];
+    dsp::BiquadStage4 split_rest_[kCrossoverStages];
+    dsp::BiquadStage4 split_mid_[kCrossoverStages];
+    dsp::BiquadStage4 split_high_[kCrossoverStages];
+
+    alignas(16) float low_band_[kSubBlockFrames * kLanes];
+    alignas(16) float mid_band_[kSubBlockFrames * kLanes];
+    alignas(16) float high_band_[kSubBlockFrames * kLanes];
+
+    // Smooth toward the targets; true when the deck's settings moved
+    bool advance(int deck, DeckEqSettings& before);
+    void update_tone(int deck);
+    void update_filter(int deck);
+    void isolate(float* lanes, size_t frames, const DeckEqSettings (&before)[kDecks],
+                 const float (&wet_before)[kDecks]);
+    void clear_state();
+};
+
+} // namespace OneStopRadio
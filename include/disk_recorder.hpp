@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "utils/audio_ring_buffer.hpp"
+
+class SharedStreamEncoder;
+
+/**
+ * Recorder configuration
+ */
+struct RecorderOptions {
+    std::string format = "wav";         // wav, flac, or an encoder codec: mp3, ogg, opus, aac
+    int bit_depth = 16;                 // PCM formats: 16, 24 or 32 (WAV float)
+    int bitrate = 192;                  // kbps, encoded formats
+
+    // Segments are <directory>/<prefix>-YYYYMMDD-HHMMSS.<ext>, local time
+    std::string directory = "recordings";
+    std::string prefix = "aircheck";
+    int segment_seconds = 3600;         // Cut on wall-clock multiples, so on the hour; 0 for one file
+    std::string file;                   // Record to exactly this path instead, never segmented
+
+    double buffer_seconds = 10.0;       // Audio held in memory while the disk stalls
+    size_t block_frames = 32768;        // PCM frames per disk write, rounded up to a multiple of 4096
+};
+
+/**
+ * Recorder progress; frames are per channel
+ */
+struct RecorderStats {
+    bool recording = false;
+    std::string current_file;
+    uint64_t segments = 0;              // Files opened so far
+    uint64_t frames_written = 0;
+    uint64_t dropped_frames = 0;        // Lost before reaching the disk
+    double lag_seconds = 0.0;           // Captured or encoded but not yet written
+    uint64_t write_errors = 0;
+};
+
+/**
+ * Aircheck and archive recorder for the master bus
+ *
+ * PCM formats are written through libsndfile. A capture thread moves audio
+ * from a master bus reader into a bounded pool of preallocated blocks and a
+ * writer thread empties them to disk one whole block per write, so a slow
+ * disk only ever fills the pool. Encoded formats become a sink of a shared
+ * encoder instead: its packets are queued for the writer and written as
+ * they arrive, in blocks of the same size.
+ *
+ * Segments are cut at an exact frame, or for encoded formats at the first
+ * packet past it, so consecutive files join without a gap. Audio lost to a
+ * full pool or a master bus overrun is counted; in PCM formats it is also
+ * replaced with silence, so every file keeps its wall-clock length. The
+ * audio thread is never involved: it only writes the master bus ring.
+ */
+class DiskRecorder {
+public:
+    explicit DiskRecorder(const RecorderOptions& options = RecorderOptions());
+    ~DiskRecorder();
+
+    DiskRecorder(const DiskRecorder&) = delete;
+    DiskRecorder& operator=(const DiskRecorder&) = delete;
+
+    // PCM formats; the reader fixes the sample rate and channel count
+    bool start(std::shared_ptr<AudioRingBuffer::Reader> source);
+    // Encoded formats; registers as a sink of a running encoder
+    bool start(std::shared_ptr<SharedStreamEncoder> encoder);
+    // Writes out everything captured so far and closes the file
+    void stop();
+    bool is_running() const;
+
+    RecorderStats stats() const;
+    const RecorderOptions& options() const;
+    std::string get_error() const;
+
+    // False for wav and flac
+    static bool is_encoded_format(const std::string& format);
+    // Format for a file name's extension, wav when unknown
+    static std::string format_for_path(const std::string& path);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Vectorized DSP kernels shared by the mixers
+ *
+ * Every kernel has a portable scalar implementation plus SSE2/AVX2 (x86)
+ * or NEON (ARM) variants. The best table for the running CPU is picked
+ * once at first use; the scalar table stays available so SIMD output can
+ * be checked against it. Stereo kernels operate on interleaved L/R frames.
+ * None of the kernels allocate or block, so all are safe in an audio callback.
+ */
+namespace dsp {
+
+struct PeakRms {
+    float peak_left = 0.0f;
+    float peak_right = 0.0f;
+    float sum_sq_left = 0.0f;   // Sum of squares; divide by frames for mean square
+    float sum_sq_right = 0.0f;
+};
+
+// One biquad section across four independent lanes (e.g. two stereo decks),
+// transposed direct form II, coefficients normalised so a0 == 1. The filter
+// state lives with the coefficients so a cascade is just an array of these.
+struct alignas(16) BiquadStage4 {
+    float b0[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    float b1[4] = {};
+    float b2[4] = {};
+    float a1[4] = {};
+    float a2[4] = {};
+    float z1[4] = {};
+    float z2[4] = {};
+};
+
+struct KernelTable {
+    const char* name;
+
+    // dst[i] += src[i] * gain
+    void (*mix_accumulate)(float* dst, const float* src, size_t count, float gain);
+    // Interleaved stereo dst += src with independent left/right gains
+    void (*mix_accumulate_stereo)(float* dst, const float* src, size_t frames,
+                                  float gain_left, float gain_right);
+    // buffer[i] *= gain
+    void (*apply_gain)(float* buffer, size_t count, float gain);
+    // Interleaved stereo; frame i gets start + (end - start) * i / frames
+    void (*apply_gain_ramp_stereo)(float* buffer, size_t frames, float start_gain, float end_gain);
+    // Peak and sum of squares per channel of an interleaved stereo buffer
+    PeakRms (*peak_rms_stereo)(const float* interleaved, size_t frames);
+    void (*deinterleave_stereo)(const float* interleaved, float* left, float* right, size_t frames);
+    void (*interleave_stereo)(const float* left, const float* right, float* interleaved, size_t frames);
+    // Samples above threshold in magnitude become tanh(x) * threshold
+    void (*soft_clip)(float* buffer, size_t count, float threshold);
+    // Runs 4-lane interleaved frames through the stages in order, in place
+    void (*biquad_cascade_x4)(float* lanes, size_t frames, BiquadStage4* stages, size_t stage_count);
+};
+
+// Best implementation for this CPU
+const KernelTable& kernels();
+
+// Reference implementation (parity checks, debugging)
+const KernelTable& scalar_kernels();
+
+inline void mix_accumulate(float* dst, const float* src, size_t count, float gain) {
+    kernels().mix_accumulate(dst, src, count, gain);
+}
+
+inline void mix_accumulate_stereo(float* dst, const float* src, size_t frames,
+                                  float gain_left, float gain_right) {
+    kernels().mix_accumulate_stereo(dst, src, frames, gain_left, gain_right);
+}
+
+inline void apply_gain(float* buffer, size_t count, float gain) {
+    kernels().apply_gain(buffer, count, gain);
+}
+
+inline void apply_gain_ramp_stereo(float* buffer, size_t frames, float start_gain, float end_gain) {
+    kernels().apply_gain_ramp_stereo(buffer, frames, start_gain, end_gain);
+}
+
+inline PeakRms peak_rms_stereo(const float* interleaved, size_t frames) {
+    return kernels().peak_rms_stereo(interleaved, frames);
+}
+
+inline void deinterleave_stereo(const float* interleaved, float* left, float* right, size_t frames) {
+    kernels().deinterleave_stereo(interleaved, left, right, frames);
+}
+
+inline void interleave_stereo(const float* left, const float* right, float* interleaved, size_t frames) {
+    kernels().interleave_stereo(left, right, interleaved, frames);
+}
+
+inline void soft_clip(float* buffer, size_t count, float threshold) {
+    kernels().soft_clip(buffer, count, threshold);
+}
+
+inline void biquad_cascade_x4(float* lanes, size_t frames, BiquadStage4* stages, size_t stage_count) {
+    kernels().biquad_cascade_x4(lanes, frames, stages, stage_count);
+}
+
+} // namespace dsp
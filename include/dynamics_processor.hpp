@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OneStopRadio {
+
+struct DynamicsOptions {
+    int sample_rate = 48000;
+    int channels = 2;
+    float lookahead_ms = 5.0f;          // Fixed for the processor's lifetime
+    bool true_peak = true;              // Detect inter-sample peaks at 4x oversampling
+
+    bool limiter_enabled = true;
+    float ceiling_db = -1.0f;           // dBTP with true_peak, else dBFS
+    float limiter_release_ms = 50.0f;
+
+    bool compressor_enabled = false;
+    float threshold_db = -12.0f;
+    float ratio = 4.0f;
+    float knee_db = 6.0f;
+    float attack_ms = 10.0f;
+    float release_ms = 100.0f;
+    float makeup_db = 0.0f;
+};
+
+/**
+ * Gain reduction over the last processed block
+ */
+struct DynamicsStats {
+    float compressor_reduction_db = 0.0f;
+    float limiter_reduction_db = 0.0f;
+};
+
+/**
+ * Broadcast dynamics: compressor into a lookahead brickwall limiter
+ *
+ * Both stages are driven by one stereo-linked detector. With true_peak the
+ * detector also sees the peaks between samples, estimated by a 4x polyphase
+ * interpolator, so the output stays under the ceiling after a codec or DAC
+ * reconstructs it.
+ *
+ * The compressor is a soft-knee feed-forward design that smooths its gain
+ * reduction in dB. The limiter works out, for every sample, the gain that
+ * would hold it at the ceiling, takes the minimum over the lookahead window
+ * with a monotonic deque, lets it recover at the release rate and averages
+ * it over the window again; delaying the audio by that window means every
+ * sample meets its gain already fully applied, without overshoot and
+ * without the distortion of clipping. Level and gain conversions use
+ * precomputed tables.
+ *
+ * All memory is allocated by the constructor. Setters and process() belong
+ * to the audio thread and never allocate or lock; stats() may be called
+ * from any thread.
+ */
+class DynamicsProcessor {
+public:
+    static constexpr int kMaxChannels = 8;      // Larger options.channels are clamped
+
+    explicit DynamicsProcessor(const DynamicsOptions& options = DynamicsOptions());
+
+    void set_limiter(bool enabled, float ceiling_db, float release_ms);
+    void set_compressor(bool enabled, float threshold_db, float ratio);
+    void set_compressor_timing(float attack_ms, float release_ms);
+    void set_makeup_gain(float gain_db);
+
+    const DynamicsOptions& options() const { return options_; }
+
+    // Frames the output trails the input by; constant whatever is enabled
+    size_t latency_frames() const { return delay_frames_ + detector_delay_; }
+
+    // Clear the delay line and detectors
+    void reset();
+
+    // Interleaved frames in options().channels, in place
+    void process(float* interleaved, size_t frames);
+    // Planar stereo, in place
+    void process_planar(float* left, float* right, size_t frames);
+
+    DynamicsStats stats() const;
+
+private:
+    static constexpr int kOversample = 4;
+    static constexpr size_t kHalfTaps = 6;             // Interpolator taps each side of the gap
+    static constexpr size_t kTaps = 2 * kHalfTaps;
+
+    DynamicsOptions options_;
+    int channels_;
+    size_t delay_frames_;           // Lookahead window, at least one frame
+    size_t detector_delay_;         // Interpolator latency; 0 without true peak
+
+    // Interpolator: per channel history, written twice so any window of
+    // kTaps is contiguous
+    std::vector<float> history_;
+    size_t history_pos_ = 0;
+    float phase_coeffs_[kOversample - 1][kTaps];
+
+    // Converted settings
+    float ceiling_;
+    float threshold_db_;
+    float slope_;                   // 1 - 1 / ratio
+    float knee_db_;
+    float makeup_db_;
+    float attack_coeff_;
+    float release_coeff_;
+    float limiter_release_coeff_;
+
+    // Compressor state
+    float reduction_db_ = 0.0f;
+
+    // Limiter state. The delay line carries each frame with the compressor
+    // gain computed for it.
+    std::vector<float> delay_;
+    std::vector<float> delay_gain_;
+    size_t delay_pos_ = 0;
+    std::vector<float> deque_value_;
+    std::vector<uint64_t> deque_frame_;
+    size_t deque_head_ = 0;
+    size_t deque_size_ = 0;
+    uint64_t frame_ = 0;
+    float released_ = 1.0f;
+    std::vector<float> box_;
+    double box_sum_;
+    size_t box_pos_ = 0;
+
+    std::atomic<float> stat_compressor_db_{0.0f};
+    std::atomic<float> stat_limiter_db_{0.0f};
+
+    void process_frames(float* const* channels, size_t stride, size_t frames);
+    float detect(float* const* channels, size_t offset, float* centre);
+    float compressor_gain_db(float level_db) const;
+    float hold_minimum(float gain);
+};
+
+} // namespace OneStopRadio
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <fftw3.h>
+
+/**
+ * Process-wide cache of FFTW plans
+ *
+ * FFTW's planner is not thread-safe and FFTW_MEASURE planning takes far
+ * longer than the transforms themselves, so every FFT user asks here
+ * instead of planning its own. Plans are created once per (size, flags)
+ * under the planner lock and live until the process exits.
+ *
+ * A returned plan is shared: run it with the new-array execute functions
+ * (fftwf_execute_dft_r2c) on the caller's own buffers, which must come from
+ * fftwf_alloc_real / fftwf_alloc_complex so their alignment matches the
+ * planning buffers. Those calls are safe from any thread.
+ *
+ * Wisdom loaded at startup makes FFTW_MEASURE plans nearly free to create.
+ * Plans made since then are written back by save_wisdom().
+ */
+class FftPlanRegistry {
+public:
+    static FftPlanRegistry& instance();
+
+    // Out-of-place real-to-complex forward transform of n real samples
+    fftwf_plan real_forward(int n, unsigned flags = FFTW_MEASURE);
+
+    // @return false if the file is missing or unreadable; planning still works
+    bool load_wisdom(const std::string& path);
+    // Written atomically, and only when plans were added since the last load or save
+    bool save_wisdom(const std::string& path);
+
+    size_t plan_count() const;
+
+    FftPlanRegistry(const FftPlanRegistry&) = delete;
+    FftPlanRegistry& operator=(const FftPlanRegistry&) = delete;
+
+private:
+    FftPlanRegistry() = default;
+    ~FftPlanRegistry() = default;
+
+    mutable std::mutex mutex_;      // Also serializes every FFTW planner call
+    std::map<std::pair<int, unsigned>, fftwf_plan> real_forward_plans_;
+    bool wisdom_dirty_ = false;
+};
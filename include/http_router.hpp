@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "http_server.hpp"
+
+struct HttpRoute {
+    RouteHandler handler;
+    SnapshotHandler snapshot;           // Instead of handler, for cached responses with an ETag
+    RouteExecution execution = RouteExecution::IO_THREAD;
+    std::string content_type = "application/json";
+};
+
+/**
+ * Radix-tree request router
+ *
+ * Patterns are split on '/'. A segment is either literal text or a
+ * parameter: {name} or {name:str} matches any non-empty segment,
+ * {name:int} matches an optionally signed decimal integer, and
+ * {name:path} (last segment only) matches the rest of the path. Literal
+ * segments win over parameters and int wins over str. Backtracking covers
+ * the cases where a more specific branch fails further down.
+ *
+ * compile() merges chains of literal nodes into single edges and sorts
+ * children. match() then walks the target in place: it does not copy or
+ * allocate, and path parameters are returned as views into the target.
+ */
+class HttpRouter {
+public:
+    static constexpr size_t kMaxParams = 8;
+
+    enum class MatchStatus {
+        FOUND,
+        NOT_FOUND,
+        METHOD_NOT_ALLOWED
+    };
+
+    struct Match {
+        MatchStatus status = MatchStatus::NOT_FOUND;
+        const HttpRoute* route = nullptr;
+        std::string_view path;      // Target without the query string
+        std::string_view query;     // After '?', still URL-encoded
+        std::array<std::pair<std::string_view, std::string_view>, kMaxParams> params;  // Name, raw value
+        size_t param_count = 0;
+    };
+
+    HttpRouter();
+    ~HttpRouter();
+
+    /**
+     * Register a handler; an empty method accepts any method.
+     * Registering the same method and pattern again replaces the handler.
+     * @throws std::invalid_argument for malformed patterns
+     */
+    void add(std::string_view method, const std::string& pattern, HttpRoute route);
+
+    // Must run once after the last add() and before match()
+    void compile();
+
+    Match match(std::string_view method, std::string_view target) const;
+
+    // Percent-decoding; '+' becomes a space when decoding query components
+    static std::string url_decode(std::string_view encoded, bool plus_as_space = false);
+    static void parse_query(std::string_view query, std::map<std::string, std::string>& out);
+
+private:
+    struct Node;
+
+    std::unique_ptr<Node> root_;
+    bool compiled_ = false;
+
+    static void compile_node(Node& node);
+    static bool match_node(const Node& node, std::string_view rest, std::string_view method,
+                           Match& match, bool& method_mismatch);
+    static const HttpRoute* find_method(const Node& node, std::string_view method);
+};
@@ -3,27 +3,80 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <chrono>
+#include <cstddef>
 
 struct HttpRequest {
     std::string method;
     std::string path;
     std::string body;
     std::map<std::string, std::string> headers;
-    std::map<std::string, std::string> params;
+    std::map<std::string, std::string> params;         // Decoded query-string parameters
+    std::map<std::string, std::string> path_params;    // From {name} segments of the route pattern
 };
 
 using RouteHandler = std::function<std::string(const HttpRequest&)>;
 
+/**
+ * A serialized response shared by every request that sees the same state
+ */
+struct HttpSnapshot {
+    std::string body;
+    std::string etag;                   // Quoted entity tag, as sent in the ETag header
+};
+
+using SnapshotHandler = std::function<std::shared_ptr<const HttpSnapshot>(const HttpRequest&)>;
+
+/**
+ * Where a route handler runs
+ */
+enum class RouteExecution {
+    IO_THREAD,  // Inline on the connection's I/O thread; for handlers that return quickly
+    WORKER      // On the worker pool, so a slow handler never stalls other connections
+};
+
+struct HttpServerOptions {
+    size_t io_threads = 0;                      // 0 = one per hardware thread
+    size_t worker_threads = 4;                  // Pool for RouteExecution::WORKER handlers
+    std::chrono::seconds idle_timeout{30};      // Close keep-alive connections idle this long
+    size_t max_pipelined_requests = 16;         // Requests read ahead of their responses
+    size_t max_requests_per_connection = 1000;  // Then answer with Connection: close
+};
+
+/**
+ * HTTP/1.1 server with keep-alive and pipelining
+ *
+ * All I/O threads share one io_context and each connection runs on its own
+ * strand. Pipelined requests are answered in order, but their handlers are
+ * not serialized: IO_THREAD handlers of one session run one at a time on
+ * its strand, while its WORKER handlers run on the pool alongside each
+ * other and the strand. Handlers must therefore be safe to run concurrently,
+ * even for requests from the same connection. Routes must be registered
+ * before run(), which compiles them into an HttpRouter; see http_router.hpp
+ * for the pattern syntax.
+ */
 class HttpServer {
 public:
-    explicit HttpServer(int port);
+    explicit HttpServer(int port, const HttpServerOptions& options = HttpServerOptions());
     ~HttpServer();
-    
-    void add_route(const std::string& path, RouteHandler handler);
+
+    // Matches any method
+    void add_route(const std::string& path, RouteHandler handler,
+                   RouteExecution execution = RouteExecution::IO_THREAD);
+    // Matches one method; others on the same path get 405
+    void add_route(const std::string& method, const std::string& path, RouteHandler handler,
+                   RouteExecution execution = RouteExecution::IO_THREAD);
+    // For handlers that answer with something other than JSON
+    void add_route(const std::string& method, const std::string& path, const std::string& content_type,
+                   RouteHandler handler, RouteExecution execution = RouteExecution::IO_THREAD);
+    // Matches any method. The snapshot's ETag is sent with the body, and a
+    // request whose If-None-Match lists it gets 304 and no body.
+    void add_snapshot_route(const std::string& path, SnapshotHandler handler,
+                            RouteExecution execution = RouteExecution::IO_THREAD);
     void run();
     void stop();
-    
+
 private:
     class Impl;
     std::unique_ptr<Impl> impl_;
-};
\ No newline at end of file
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+/**
+ * Values published on one tick, keyed by dotted name ("master.left_peak",
+ * "deck.A.position_ms"). Booleans are published as 0/1.
+ */
+class LiveStateWriter {
+public:
+    virtual ~LiveStateWriter() = default;
+    virtual void set(std::string_view name, double value) = 0;
+};
+
+using LiveStateSource = std::function<void(LiveStateWriter&)>;
+
+struct LivePushOptions {
+    int port = 8082;
+    double tick_hz = 20.0;           // Upper bound on frames per second per client
+    double min_delta = 1e-4;         // Smaller changes are not sent
+    size_t max_clients = 64;
+};
+
+struct LivePushStats {
+    size_t clients = 0;
+    uint64_t ticks = 0;
+    uint64_t frames_sent = 0;
+    uint64_t frames_skipped = 0;     // Deltas a slow client missed; it resyncs with a keyframe
+    uint64_t keyframes_sent = 0;
+};
+
+/**
+ * WebSocket push channel for meters and deck state
+ *
+ * Clients connect to ws://host:port/live, or /live?format=binary for
+ * binary frames. A tick thread samples the source at tick_hz and publishes
+ * only the fields that changed. Each encoding of a tick is serialized once
+ * and shared by every client that receives it.
+ *
+ * JSON clients receive text frames:
+ *   {"type":"delta"|"keyframe","seq":N,"t":ms,"values":{"name":value,...}}
+ *
+ * Binary clients first receive {"type":"schema","fields":[...]} as text
+ * (re-sent when fields are added), then little-endian binary frames:
+ *   u8 kind (1 delta, 2 keyframe), u8 0, u16 count, u32 seq, f64 t_ms,
+ *   count x { u16 field index, f32 value }
+ *
+ * A client has at most one frame being written. Ticks that arrive while a
+ * write is still in flight are dropped for that client, and its next frame
+ * is a full keyframe, so a slow client never queues memory on the server.
+ */
+class LivePushServer {
+public:
+    explicit LivePushServer(const LivePushOptions& options = LivePushOptions());
+    ~LivePushServer();
+
+    // Set before start()
+    void set_source(LiveStateSource source);
+
+    bool start();
+    void stop();
+    bool is_running() const { return running_; }
+
+    LivePushStats get_stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+    std::atomic<bool> running_{false};
+};
@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * Monotonic count
+ */
+class MetricCounter {
+public:
+    void increment(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+/**
+ * Point-in-time value, e.g. a queue depth
+ */
+class MetricGauge {
+public:
+    void set(double value) { value_.store(value, std::memory_order_relaxed); }
+    void add(double delta) {
+        double current = value_.load(std::memory_order_relaxed);
+        while (!value_.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+        }
+    }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+/**
+ * Histogram over fixed bucket bounds
+ *
+ * observe() walks at most kMaxBuckets bounds and does two relaxed atomic
+ * adds, so it belongs on the audio thread as much as anywhere. A scrape
+ * may see a count and a sum from slightly different moments.
+ */
+class MetricHistogram {
+public:
+    static constexpr size_t kMaxBuckets = 16;
+
+    // Ascending upper bounds; anything past kMaxBuckets is ignored
+    explicit MetricHistogram(const std::vector<double>& bounds);
+
+    void observe(double value) {
+        size_t bucket = 0;
+        while (bucket < bound_count_ && value > bounds_[bucket]) {
+            ++bucket;
+        }
+        counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+        double sum = sum_.load(std::memory_order_relaxed);
+        while (!sum_.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {
+        }
+    }
+
+    struct Snapshot {
+        std::vector<double> bounds;
+        std::vector<uint64_t> cumulative;   // One per bound, then +Inf
+        double sum = 0.0;
+    };
+    Snapshot snapshot() const;
+
+private:
+    double bounds_[kMaxBuckets];
+    size_t bound_count_;
+    std::atomic<uint64_t> counts_[kMaxBuckets + 1] = {};    // Last one is +Inf
+    std::atomic<double> sum_{0.0};
+};
+
+/**
+ * Process-wide metrics with Prometheus text exposition
+ *
+ * Components look their metrics up once, typically in a constructor, and
+ * keep the reference: lookups lock, updates never do. Asking again for the
+ * same name and labels returns the same metric, so any number of instances
+ * can feed one series. Metrics live until the process exits. Reusing a
+ * name for another metric type throws std::invalid_argument.
+ */
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    MetricCounter& counter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    MetricGauge& gauge(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    // The first registration of a name fixes its bounds
+    MetricHistogram& histogram(const std::string& name, const std::string& help,
+                               const std::vector<double>& bounds, const MetricLabels& labels = {});
+
+    // Text exposition format, to be served as kContentType
+    std::string render_prometheus() const;
+
+    // count bounds from start, each factor times the last
+    static std::vector<double> exponential_buckets(double start, double factor, size_t count);
+
+    static constexpr const char* kContentType = "text/plain; version=0.0.4";
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+private:
+    enum class Type {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    struct Family {
+        Type type;
+        std::string help;
+        std::vector<double> bounds;
+        // Keyed by the rendered label set, e.g. {codec="mp3"}
+        std::map<std::string, std::unique_ptr<MetricCounter>> counters;
+        std::map<std::string, std::unique_ptr<MetricGauge>> gauges;
+        std::map<std::string, std::unique_ptr<MetricHistogram>> histograms;
+    };
+
+    MetricsRegistry() = default;
+    ~MetricsRegistry() = default;
+
+    Family& family(const std::string& name, Type type, const std::string& help);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Vectorized pixel kernels for the video compositor
+ *
+ * Same arrangement as the DSP kernels: a scalar reference plus SSSE3 (x86)
+ * or NEON (ARM) variants, picked once at first use. All variants produce
+ * bit-identical output, so a SIMD result can be compared byte for byte
+ * with the scalar table.
+ */
+namespace dsp {
+
+struct PixelKernelTable {
+    const char* name;
+
+    // Straight-alpha RGBA over packed RGB24:
+    // dst = (src * a + dst * (255 - a)) / 255, rounded
+    void (*blend_rgba_over_rgb)(uint8_t* dst_rgb, const uint8_t* src_rgba, size_t pixels);
+};
+
+// Best implementation for this CPU
+const PixelKernelTable& pixel_kernels();
+
+// Reference implementation (parity checks, debugging)
+const PixelKernelTable& scalar_pixel_kernels();
+
+inline void blend_rgba_over_rgb(uint8_t* dst_rgb, const uint8_t* src_rgba, size_t pixels) {
+    pixel_kernels().blend_rgba_over_rgb(dst_rgb, src_rgba, pixels);
+}
+
+} // namespace dsp
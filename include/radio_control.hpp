@@ -1,11 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
 #include <functional>
 #include <map>
 #include <chrono>
+#include <mutex>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -15,6 +18,18 @@ class AudioSystem;
 class VideoStreamManager;
 class AudioStreamEncoder;
 class DatabaseManager;
+struct DatabaseStorageOptions;
+struct TrackPageRequest;
+class JsonWriter;
+class AnalysisScheduler;
+struct AnalysisJobStatus;
+namespace OneStopRadio {
+class WaveformPyramid;
+class TrackCatalog;
+struct TrackFilter;
+class RecommendationIndex;
+struct RecommendationOptions;
+}
 
 /**
  * Track information structure for radio control
@@ -34,6 +49,7 @@ struct RadioTrack {
     std::chrono::system_clock::time_point added_at;
     std::chrono::system_clock::time_point last_played;
     int play_count = 0;
+    float energy = 0.0f;            // From analysis, 0.0 - 1.0
     
     json to_json() const {
         return json{
@@ -48,7 +64,8 @@ struct RadioTrack {
             {"key", key},
             {"gain", gain},
             {"is_analyzed", is_analyzed},
-            {"play_count", play_count}
+            {"play_count", play_count},
+            {"energy", energy}
         };
     }
     
@@ -66,10 +83,29 @@ struct RadioTrack {
         track.gain = j.value("gain", 1.0f);
         track.is_analyzed = j.value("is_analyzed", false);
         track.play_count = j.value("play_count", 0);
+        track.energy = j.value("energy", 0.0f);
         return track;
     }
 };
 
+/**
+ * A library track suggested to follow another
+ */
+struct TrackSuggestion {
+    RadioTrack track;
+    float score = 0.0f;             // Lower is a closer match
+    float tempo_ratio = 1.0f;       // 0.5 or 2.0 when it matches at half or double time
+    std::string key_relation;       // same, relative, adjacent or unknown
+    
+    json to_json() const {
+        json j = track.to_json();
+        j["score"] = score;
+        j["tempo_ratio"] = tempo_ratio;
+        j["key_relation"] = key_relation;
+        return j;
+    }
+};
+
 /**
  * Playlist structure for organizing tracks
  */
@@ -159,6 +195,8 @@ struct DJDeck {
     bool is_cue_enabled = false;
     double position_ms = 0.0;
     double playback_rate = 1.0;
+    bool key_lock = false;          // Keep the pitch when the rate changes
+    double pitch_semitones = 0.0;
     
     // Mix controls
     float volume = 1.0f;
@@ -194,6 +232,8 @@ struct DJDeck {
             {"is_cue_enabled", is_cue_enabled},
             {"position_ms", position_ms},
             {"playback_rate", playback_rate},
+            {"key_lock", key_lock},
+            {"pitch_semitones", pitch_semitones},
             {"volume", volume},
             {"gain", gain},
             {"high_eq", high_eq},
@@ -213,6 +253,21 @@ struct DJDeck {
     }
 };
 
+/**
+ * Copy of a deck's playback state, see RadioControl::get_deck_states()
+ */
+struct DJDeckState {
+    std::string id;
+    bool is_playing = false;
+    bool is_paused = false;
+    double position_ms = 0.0;
+    double playback_rate = 1.0;
+    float volume = 1.0f;
+    bool has_track = false;
+    std::string track_id;
+    int bpm = 0;
+};
+
 /**
  * Radio Control System - Main interface for DJ operations
  */
@@ -225,6 +280,9 @@ public:
     ~RadioControl();
     
     // Initialization
+    // Before initialize()
+    void set_database_options(const DatabaseStorageOptions& options);
+    
     bool initialize();
     void shutdown();
     
@@ -232,15 +290,32 @@ public:
     
     // Add track to library with metadata analysis
     std::string add_track(const std::string& file_path, const json& metadata = {});
+    // Library import: every valid file is added in one database transaction
+    std::vector<std::string> import_tracks(const std::vector<std::string>& file_paths, bool analyze = true);
     bool remove_track(const std::string& track_id);
     bool update_track_metadata(const std::string& track_id, const json& metadata);
     RadioTrack* get_track(const std::string& track_id);
     std::vector<RadioTrack> get_all_tracks();
-    std::vector<RadioTrack> search_tracks(const std::string& query);
-    
-    // Track analysis
+    // Library listing for the API; see DatabaseManager::write_track_page
+    bool write_track_page(const TrackPageRequest& request, JsonWriter& out, std::string& error);
+    std::vector<RadioTrack> search_tracks(const std::string& query, int limit = 50, int offset = 0);
+    // BPM, key and genre filter over the in-memory catalog
+    std::vector<RadioTrack> find_tracks(const OneStopRadio::TrackFilter& filter);
+    // Tracks that mix from `track_id`: BPM within ±tolerance_percent and a harmonic key
+    std::vector<RadioTrack> find_harmonic_tracks(const std::string& track_id, float tolerance_percent = 6.0f,
+                                                 size_t limit = 50);
+    int find_genre_id(const std::string& genre);
+    // Next-track suggestions from the recommendation index, best first
+    std::vector<TrackSuggestion> recommend_tracks(const std::string& track_id,
+                                                  const OneStopRadio::RecommendationOptions& options);
+    
+    // Track analysis runs in the background; these queue work and return immediately
     bool analyze_track(const std::string& track_id);
     bool analyze_all_tracks();
+    bool cancel_analysis(const std::string& track_id = "");   // Empty cancels every job
+    // Without a track: counts and one page of the running and queued jobs
+    static constexpr size_t MAX_ANALYSIS_JOBS_PAGE = 1000;
+    json get_analysis_status(const std::string& track_id = "", size_t offset = 0, size_t limit = 100);
     
     // ===== PLAYLIST MANAGEMENT =====
     
@@ -266,6 +341,8 @@ public:
     bool cue_deck(const std::string& deck_id);
     bool seek_deck(const std::string& deck_id, double position_ms);
     bool set_deck_playback_rate(const std::string& deck_id, double rate);
+    bool set_deck_key_lock(const std::string& deck_id, bool enabled);
+    bool set_deck_pitch_shift(const std::string& deck_id, double semitones);
     
     // Deck mixing controls
     bool set_deck_volume(const std::string& deck_id, float volume);
@@ -325,6 +402,12 @@ public:
     WaveformData get_deck_waveform(const std::string& deck_id);
     bool generate_waveform_data(const std::string& track_id, int width_pixels = 800);
     
+    // Any zoom window of an analyzed track, sliced from its waveform pyramid without decoding.
+    // end_ms <= 0 means the end of the track; widths above MAX_WAVEFORM_WIDTH are clamped.
+    static constexpr int MAX_WAVEFORM_WIDTH = 8192;
+    bool get_track_waveform(const std::string& track_id, double start_ms, double end_ms,
+                            int width_pixels, WaveformData& waveform);
+    
     // Real-time audio levels for VU meters
     struct RealTimeAudioLevels {
         float left_peak = 0.0f;
@@ -394,8 +477,11 @@ public:
     
     // Get current status
     DJDeck* get_deck(const std::string& deck_id);
-    std::vector<DJDeck*> get_all_decks();
+    // Copied under the decks lock, for readers off the HTTP threads
+    std::vector<DJDeckState> get_deck_states();
     json get_mixer_status();
+    // Bumped after every deck, mixer, microphone or broadcast change; see SnapshotCache
+    uint64_t get_state_generation() const { return state_generation_.load(std::memory_order_acquire); }
     json get_stream_status();
     json get_system_status();
     
@@ -430,16 +516,29 @@ public:
     void set_beat_callback(BeatCallback callback);
 
 private:
+    // Bumps the generation when a mutator returns, after every field it set
+    struct StateChange {
+        explicit StateChange(std::atomic<uint64_t>& generation) : generation(generation) {}
+        ~StateChange() { generation.fetch_add(1, std::memory_order_release); }
+        std::atomic<uint64_t>& generation;
+    };
+    std::atomic<uint64_t> state_generation_{0};
+    
     // Component references
     AudioSystem* audio_system_;
     VideoStreamManager* video_manager_;
     AudioStreamEncoder* audio_encoder_;
     std::unique_ptr<DatabaseManager> database_;
+    std::unique_ptr<AnalysisScheduler> analysis_scheduler_;
     
     // Internal data
+    std::mutex library_mutex_;      // Guards tracks_ and catalog_ against the analysis writer thread
     std::map<std::string, RadioTrack> tracks_;
+    std::unique_ptr<OneStopRadio::TrackCatalog> catalog_;  // Column copy of tracks_ for filtering
+    std::unique_ptr<OneStopRadio::RecommendationIndex> recommendations_;   // Over catalog_ indices
     std::map<std::string, RadioPlaylist> playlists_;
     std::map<std::string, std::unique_ptr<DJDeck>> decks_;
+    std::mutex decks_mutex_;        // Guards deck playback fields for get_deck_states(); taken before library_mutex_
     RadioStation station_config_;
     
     // Mixer state
@@ -454,6 +553,7 @@ private:
     bool auto_dj_enabled_ = false;
     int auto_dj_crossfade_time_ = 10;
     std::string auto_dj_playlist_id_;
+    size_t prefetch_ahead_ = 2;     // Playlist tracks after the loaded one decoded in advance
     
     // Recording state
     bool is_recording_ = false;
@@ -466,13 +566,17 @@ private:
     bool talkover_active_ = false;
     float talkover_duck_level_ = 0.25f;  // Duck to 25% by default
     float talkover_duck_time_ = 100.0f;  // 100ms fade time
-    float original_master_volume_ = 0.8f; // Store original volume for restoration
     
     // Audio monitoring state
     bool audio_monitoring_active_ = false;
     RealTimeAudioLevels current_levels_;
     std::map<std::string, WaveformData> waveform_cache_;
     
+    // Waveform files written by analysis, mapped on first use
+    std::string waveform_dir_ = "waveforms";
+    std::mutex pyramid_mutex_;
+    std::map<std::string, std::shared_ptr<const OneStopRadio::WaveformPyramid>> pyramid_cache_;
+    
     // Callbacks
     TrackLoadedCallback track_loaded_callback_;
     TrackEndedCallback track_ended_callback_;
@@ -480,10 +584,17 @@ private:
     
     // Internal methods
     std::string generate_track_id();
+    RadioTrack make_track(const std::string& track_id, const std::string& file_path, const json& metadata = {});
+    // Keep catalog_ and recommendations_ in step with tracks_; library_mutex_ held
+    void index_track(const RadioTrack& track);
+    void unindex_track(const std::string& track_id);
     std::string generate_playlist_id();
     void initialize_default_decks();
     void update_mixer_output();
     void process_auto_dj();
     bool validate_track_file(const std::string& file_path);
     json extract_metadata_from_file(const std::string& file_path);
+    void apply_analysis_updates(const std::vector<AnalysisJobStatus>& updates);
+    void prefetch_upcoming_tracks(const std::string& current_track_id);
+    std::shared_ptr<const OneStopRadio::WaveformPyramid> get_waveform_pyramid(const std::string& track_id);
 };
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 #include <queue>
 #include <chrono>
 #include <map>
@@ -16,6 +17,10 @@
 #include <numeric>
 #include <cmath>
 
+#include "beat_tracker.hpp"
+#include "deck_equalizer.hpp"
+#include "dynamics_processor.hpp"
+
 // Real-time DJ audio processing system
 // Handles dual-deck mixing, audio level analysis, and beat detection
 
@@ -57,6 +62,24 @@ struct AudioBuffer {
     }
 };
 
+// Planar (structure-of-arrays) stereo buffer, sized once and reused
+struct PlanarBuffer {
+    std::vector<float> left;
+    std::vector<float> right;
+    
+    void resize(size_t frames) {
+        left.assign(frames, 0.0f);
+        right.assign(frames, 0.0f);
+    }
+    
+    void clear() {
+        std::fill(left.begin(), left.end(), 0.0f);
+        std::fill(right.begin(), right.end(), 0.0f);
+    }
+    
+    size_t size() const { return left.size(); }
+};
+
 struct AudioLevels {
     float peak_left = 0.0f;
     float peak_right = 0.0f;
@@ -120,54 +143,24 @@ struct MixerState {
     std::mutex mixer_mutex;
 };
 
-// Simple 3-band EQ filter
-class ThreeBandEQ {
-private:
-    struct FilterState {
-        float low_freq = 0.0f;
-        float mid_freq = 0.0f; 
-        float high_freq = 0.0f;
-    };
-    
-    FilterState left_state;
-    FilterState right_state;
-    
-    int sample_rate;
-    
-public:
-    ThreeBandEQ(int sr = 48000) : sample_rate(sr) {}
-    
-    AudioSample process(const AudioSample& input, const EQSettings& eq);
-    void reset();
-};
-
-// Beat detection and BPM analysis
+// Beat detection and BPM analysis for a live deck
 class BeatDetector {
 private:
-    struct BeatAnalysis {
-        std::vector<float> energy_history;
-        std::vector<float> onset_times;
-        float current_bpm = 0.0f;
-        float confidence = 0.0f;
-        size_t analysis_window = 0;
-    };
-    
-    BeatAnalysis analysis;
-    int sample_rate;
-    size_t buffer_size;
+    static constexpr size_t SCRATCH_FRAMES = 256;
     
-    float calculateEnergy(const AudioBuffer& buffer);
-    bool detectOnset(float current_energy);
-    float estimateBPM();
+    BeatTracker tracker;
+    float mono_scratch[SCRATCH_FRAMES];
     
 public:
-    BeatDetector(int sr = 48000, size_t bs = 1024) 
-        : sample_rate(sr), buffer_size(bs) {}
+    BeatDetector(int sr = 48000, size_t bs = 1024);
     
     void process(const AudioBuffer& buffer);
-    float getCurrentBPM() const { return analysis.current_bpm; }
-    float getBeatPosition() const;
-    void reset();
+    // Feed mono samples (downmixed by a fused pipeline); never allocates
+    void processMono(const float* mono, size_t frames);
+    float getCurrentBPM() const { return tracker.current().bpm; }
+    float getBeatPosition() const { return static_cast<float>(tracker.beat_position()); }
+    const BeatGrid& getBeatGrid() const { return tracker.current(); }
+    void reset() { tracker.reset(); }
 };
 
 // Real-time level meter with peak hold and decay
@@ -179,15 +172,24 @@ private:
     float rms_right = 0.0f;
     
     float peak_decay_rate = 0.99f;   // Per sample decay
-    size_t rms_window_size = 1024;
+    size_t rms_window_size;
     
-    std::queue<float> rms_buffer_left;
-    std::queue<float> rms_buffer_right;
+    // Fixed-size sliding windows of squared samples
+    std::vector<float> rms_window_left;
+    std::vector<float> rms_window_right;
+    size_t rms_write_pos = 0;
+    size_t rms_count = 0;
     float rms_sum_left = 0.0f;
     float rms_sum_right = 0.0f;
     
+    inline void accumulate(float left, float right);
+    void updateRMS();
+    
 public:
+    explicit LevelMeter(size_t window_size = 1024);
+    
     void process(const AudioBuffer& buffer);
+    void processPlanar(const float* left, const float* right, size_t frames);
     AudioLevels getLevels() const;
     void reset();
     void setPeakDecayRate(float rate) { peak_decay_rate = rate; }
@@ -213,10 +215,32 @@ public:
     
     AudioSample mix(const AudioSample& channel_a, const AudioSample& channel_b, 
                    float crossfader_position);
+    
+    // Per-deck gains for a crossfader position, for block-based mixing
+    void getGains(float crossfader_position, float& gain_a, float& gain_b);
+};
+
+// Per-block timing statistics for the DJ processing clock
+struct ProcessingStats {
+    uint64_t blocks_processed = 0;
+    uint64_t missed_deadlines = 0;    // Blocks that finished (or started) after their deadline
+    double budget_us = 0.0;           // Time available per block (buffer_size / sample_rate)
+    double last_processing_us = 0.0;
+    double avg_processing_us = 0.0;   // Exponential moving average
+    double max_processing_us = 0.0;
+    double load = 0.0;                // avg_processing_us / budget_us
+    bool realtime_priority = false;   // Whether SCHED_FIFO was granted to the clock thread
 };
 
 // Main real-time DJ processor
 class RealtimeDJProcessor {
+public:
+    // What paces processAudioBuffer()
+    enum ClockMode {
+        INTERNAL_CLOCK,     // Own thread sleeping until absolute per-block deadlines
+        EXTERNAL_CALLBACK   // Audio device callback calls processBlock() directly
+    };
+    
 private:
     // Audio configuration
     int sample_rate = 48000;
@@ -229,23 +253,101 @@ private:
     MixerState mixer;
     
     // Audio processing components
-    std::unique_ptr<ThreeBandEQ> eq_a;
-    std::unique_ptr<ThreeBandEQ> eq_b;
+    std::unique_ptr<DeckEqualizer> deck_eq;     // Both decks in one SIMD pass
     std::unique_ptr<BeatDetector> beat_detector_a;
     std::unique_ptr<BeatDetector> beat_detector_b;
     std::unique_ptr<LevelMeter> level_meter_a;
     std::unique_ptr<LevelMeter> level_meter_b;
     std::unique_ptr<LevelMeter> master_meter;
     std::unique_ptr<Crossfader> crossfader;
+    std::unique_ptr<DynamicsProcessor> master_dynamics;    // Lookahead limiter on the master bus
     
     // Real-time processing thread
     std::atomic<bool> processing_active{false};
     std::thread processing_thread;
+    ClockMode clock_mode = INTERNAL_CLOCK;
+    int realtime_priority = 80;            // SCHED_FIFO priority for the clock thread
+    std::mutex clock_mutex;
+    std::condition_variable clock_cv;      // Wakes the clock thread early on stop()
+    
+    // What the block reads, set by the control methods next to the locked
+    // DeckState and MixerState copies. The block never locks: in callback
+    // mode it runs on the device thread.
+    struct DeckParams {
+        std::atomic<bool> playing{false};
+        std::atomic<float> volume{0.8f};
+        std::atomic<float> channel_volume{0.8f};
+        std::atomic<float> eq_low{0.0f};
+        std::atomic<float> eq_mid{0.0f};
+        std::atomic<float> eq_high{0.0f};
+        std::atomic<float> eq_filter{0.0f};
+        std::atomic<float> manual_bpm{0.0f};
+        
+        void setEQ(const EQSettings& eq);
+        EQSettings eq() const;
+    };
     
-    // Audio buffers for processing
-    AudioBuffer deck_a_buffer;
-    AudioBuffer deck_b_buffer;
-    AudioBuffer master_buffer;
+    // What the block measured, for updates and getters
+    struct LevelTaps {
+        std::atomic<float> peak_left{0.0f};
+        std::atomic<float> peak_right{0.0f};
+        std::atomic<float> rms_left{0.0f};
+        std::atomic<float> rms_right{0.0f};
+        
+        void store(const AudioLevels& levels);
+        AudioLevels load() const;
+    };
+    
+    struct DeckTaps {
+        LevelTaps levels;
+        std::atomic<float> bpm{0.0f};
+        std::atomic<float> beat_position{0.0f};
+    };
+    
+    DeckParams params_a;
+    DeckParams params_b;
+    std::atomic<float> param_crossfader{0.0f};
+    std::atomic<float> param_master_volume{0.8f};
+    std::atomic<bool> param_sync{false};
+    DeckTaps taps_a;
+    DeckTaps taps_b;
+    LevelTaps master_taps;
+    std::atomic<float> tap_master_bpm{128.0f};
+    
+    // Timing statistics (written by whichever thread runs blocks)
+    std::atomic<uint64_t> stat_blocks{0};
+    std::atomic<uint64_t> stat_missed{0};
+    std::atomic<double> stat_last_us{0.0};
+    std::atomic<double> stat_avg_us{0.0};
+    std::atomic<double> stat_max_us{0.0};
+    std::atomic<bool> stat_realtime{false};
+    
+    // Preallocated processing buffers; nothing in processAudioBuffer allocates
+    static constexpr size_t FUSED_BLOCK_FRAMES = 64;   // Working set that stays in L1
+    
+    struct ProcessingBuffers {
+        PlanarBuffer deck_a_input;
+        PlanarBuffer deck_b_input;
+        PlanarBuffer master;
+        // Per-block scratch for the fused pipeline
+        float deck_a_left[FUSED_BLOCK_FRAMES];
+        float deck_a_right[FUSED_BLOCK_FRAMES];
+        float deck_b_left[FUSED_BLOCK_FRAMES];
+        float deck_b_right[FUSED_BLOCK_FRAMES];
+        float deck_a_mono[FUSED_BLOCK_FRAMES];
+        float deck_b_mono[FUSED_BLOCK_FRAMES];
+        alignas(16) float eq_lanes[FUSED_BLOCK_FRAMES * DeckEqualizer::kLanes];
+    };
+    
+    ProcessingBuffers buffers;
+    AudioBuffer master_buffer;          // Interleaved copy of buffers.master for getMasterOutput()
+    // Guards master_buffer, and in INTERNAL_CLOCK mode the deck inputs and
+    // buffers.master as well. In callback mode those belong to the device
+    // thread, which only ever try-locks to refresh master_buffer.
+    mutable std::mutex buffer_mutex;
+    
+    void allocateBuffers();
+    std::unique_lock<std::mutex> lockBlockBuffers() const;
     
     // Sync and timing
     std::chrono::steady_clock::time_point last_process_time;
@@ -256,12 +358,14 @@ private:
     std::function<void(const std::string&)> websocket_callback;
     
     void processingLoop();
+    void updateLoop();
     void processAudioBuffer();
+    void recordBlockTiming(double elapsed_us, bool late);
+    std::chrono::microseconds blockPeriod() const;
+    bool promoteToRealtime();
     void updateSyncAndBPM();
     void sendRealtimeUpdate();
     
-    AudioSample processEQ(const AudioSample& input, const EQSettings& eq, 
-                         ThreeBandEQ& eq_filter);
     
 public:
     RealtimeDJProcessor(int sr = 48000, size_t bs = 1024);
@@ -272,6 +376,20 @@ public:
     void stop();
     bool isRunning() const { return processing_active.load(); }
     
+    // Clocking (set before start())
+    void setClockMode(ClockMode mode);
+    ClockMode getClockMode() const { return clock_mode; }
+    void setRealtimePriority(int priority) { realtime_priority = priority; }
+    
+    // EXTERNAL_CALLBACK mode: run one block from the device callback.
+    // Feed inputs with processAudioInput() and read results with readMasterOutput(),
+    // both from the same callback; nothing on that path locks or allocates.
+    void processBlock();
+    size_t readMasterOutput(float* interleaved_out, size_t frames) const;
+    
+    ProcessingStats getProcessingStats() const;
+    void resetProcessingStats();
+    
     // Deck control
     void loadTrack(const std::string& deck, const std::string& track_id,
                    const std::string& title, const std::string& artist);
@@ -325,6 +443,7 @@ public:
 private:
     DeckState& getDeckRef(const std::string& deck);
     const DeckState& getDeckRef(const std::string& deck) const;
+    DeckParams& getDeckParams(const std::string& deck);
 };
 
 // Utility functions for audio processing
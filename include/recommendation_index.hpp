@@ -0,0 +1,86 @@
+#pragma once
+#include "track_catalog.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OneStopRadio {
+
+// How a candidate's key sits on the Camelot wheel relative to the seed
+enum class KeyRelation : uint8_t {
+    SAME,
+    RELATIVE,       // Same number, other letter: relative major or minor
+    ADJACENT,       // One step round the wheel
+    UNKNOWN         // Seed or candidate has no key
+};
+
+const char* key_relation_name(KeyRelation relation);
+
+struct RecommendationOptions {
+    float bpm_tolerance = 0.06f;    // Fraction either side of the seed tempo, at most 0.3
+    bool half_double = true;        // Also match at half and double the seed tempo
+    float max_energy_delta = 1.0f;  // Drop candidates further than this from the seed energy
+    float energy_weight = 0.5f;     // Score per unit of energy difference
+    size_t limit = 20;
+};
+
+struct Recommendation {
+    TrackIndex track = kNoTrack;
+    float score = 0.0f;             // Lower is a closer match
+    float tempo_ratio = 1.0f;       // Candidate tempo over the seed's: 0.5, 1 or 2
+    KeyRelation relation = KeyRelation::UNKNOWN;
+};
+
+/**
+ * Next-track lookup by key, tempo and energy
+ *
+ * Tracks are bucketed by Camelot key, and each bucket keeps parallel BPM,
+ * energy and track columns sorted by (BPM, energy). A query visits only the
+ * four harmonic buckets and, in each, binary-searches the BPM window at the
+ * seed tempo and optionally at half and double it, so the work is the size
+ * of the answer rather than of the library. Candidates are scored on tempo
+ * distance, energy difference and how far apart the keys are.
+ *
+ * Updates move one entry within or between buckets. Track numbers are
+ * TrackCatalog indices; like the catalog, the index is not thread-safe.
+ */
+class RecommendationIndex {
+public:
+    // Insert or move a track; bpm 0 means unknown, energy < 0 unknown
+    void update(TrackIndex track, float bpm, uint8_t key, float energy);
+    void remove(TrackIndex track);
+    void clear();
+
+    // Seeded by an indexed track, which is left out of the results
+    std::vector<Recommendation> query(TrackIndex seed, const RecommendationOptions& options) const;
+    std::vector<Recommendation> query(float bpm, uint8_t key, float energy, const RecommendationOptions& options,
+                                      TrackIndex exclude = kNoTrack) const;
+
+    bool contains(TrackIndex track) const;
+    size_t size() const { return size_; }
+
+private:
+    struct Bucket {
+        std::vector<float> bpm;
+        std::vector<float> energy;
+        std::vector<TrackIndex> tracks;
+    };
+
+    struct Entry {
+        float bpm = 0.0f;
+        float energy = -1.0f;
+        uint8_t key = kNoKey;
+        bool indexed = false;
+    };
+
+    void scan(const Bucket& bucket, float low, float high, float target, float tempo_ratio,
+              KeyRelation relation, float energy, const RecommendationOptions& options, TrackIndex exclude,
+              std::vector<Recommendation>& out) const;
+
+    std::array<Bucket, kNoKey + 1> buckets_;    // By key; the last holds unknown keys
+    std::vector<Entry> entries_;                // By track
+    size_t size_ = 0;
+};
+
+} // namespace OneStopRadio
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "audio_stream_encoder.hpp"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+struct RtmpSenderOptions {
+    std::string name;                       // For logs; the URL carries the stream key
+    std::string url;                        // Ingest URL with the stream key appended
+    int max_queue_ms = 3000;                // Buffered media before whole GOPs are dropped
+    size_t max_queue_packets = 2048;        // Hard bound for streams with broken timestamps
+    int reconnect_delay_ms = 2000;
+    int max_reconnect_attempts = -1;        // Consecutive failures before giving up; -1 retries forever
+    int io_timeout_ms = 10000;              // A connect or write blocked longer than this fails
+};
+
+/**
+ * Muxer queue and connection statistics
+ */
+struct RtmpSenderStats {
+    bool connected = false;
+    bool failed = false;
+    std::string error;
+
+    size_t queue_packets = 0;
+    double queue_ms = 0.0;          // Media time between the oldest and newest queued packet
+
+    uint64_t packets_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t packets_dropped = 0;   // Discarded from the queue or while waiting for a keyframe
+    uint64_t gops_dropped = 0;
+    int reconnects = 0;
+
+    double bitrate = 0.0;           // Bits per second written, smoothed
+};
+
+/**
+ * FLV muxer and output thread for one RTMP ingest
+ *
+ * The sender never encodes: video packets are referenced from a shared
+ * VideoEncoder and audio packets arrive as an EncodedPacketSink of a shared
+ * AAC encoder, so any number of platforms cost one encode per profile.
+ * Both only take the queue lock; connecting and writing happen on the
+ * sender's own thread, so a slow ingest cannot stall the encoders or the
+ * other platforms.
+ *
+ * When the queue holds more than max_queue_ms the oldest group of pictures
+ * is dropped up to the next keyframe, so the server never sees a picture
+ * whose references are gone. A failed connection is reopened with the same
+ * codec parameters; output resumes at the next keyframe with timestamps
+ * starting again from zero.
+ */
+class RtmpSender : public EncodedPacketSink {
+public:
+    // video is copied; audio may be null for a video-only stream
+    RtmpSender(const RtmpSenderOptions& options, const AVCodecParameters* video, AVRational video_time_base,
+               const EncoderProfile* audio);
+    ~RtmpSender() override;
+
+    RtmpSender(const RtmpSender&) = delete;
+    RtmpSender& operator=(const RtmpSender&) = delete;
+
+    bool start();
+    void stop();
+
+    // Takes a reference to the packet's buffer; never blocks on the network
+    bool enqueue_video(const AVPacket* packet);
+    // Raw AAC from the shared encoder
+    void on_encoded_packet(const EncodedPacketPtr& packet) override;
+
+    bool is_connected() const { return connected_; }
+    bool has_failed() const { return failed_; }
+    RtmpSenderStats get_stats() const;
+
+private:
+    struct QueuedPacket {
+        AVPacket* video = nullptr;          // Owned reference
+        EncodedPacketPtr audio;
+        int64_t pts_us = 0;                 // Rebased to the sender's first packet
+        int64_t dts_us = 0;
+        bool keyframe = false;              // Audio packets are never keyframes
+        size_t size = 0;
+    };
+
+    const RtmpSenderOptions options_;
+    AVCodecParameters* video_params_ = nullptr;
+    const AVRational video_time_base_;
+    const bool has_audio_;
+    EncoderProfile audio_profile_;
+
+    // Per-stream time origins, set by each stream's first packet
+    int64_t video_origin_ = AV_NOPTS_VALUE;
+    int64_t audio_samples_ = 0;
+
+    std::deque<QueuedPacket> queue_;
+    bool resync_ = false;                   // Queue emptied mid-GOP; wait for a keyframe
+    mutable std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+
+    std::thread io_thread_;
+    std::atomic<bool> should_stop_{false};
+    std::atomic<bool> connected_{false};
+    std::atomic<bool> failed_{false};
+
+    // Only touched by the I/O thread
+    AVFormatContext* output_ = nullptr;
+    int video_stream_ = -1;
+    int audio_stream_ = -1;
+    bool header_written_ = false;
+    bool need_keyframe_ = true;
+    int64_t connection_origin_us_ = 0;
+    std::chrono::steady_clock::time_point io_deadline_;
+
+    mutable std::mutex stats_mutex_;
+    RtmpSenderStats stats_;
+    std::chrono::steady_clock::time_point window_start_;
+    size_t window_bytes_ = 0;
+
+    void io_loop();
+    bool open_output();
+    void close_output();
+    bool write_packet(QueuedPacket& entry);
+    void push(QueuedPacket entry);
+    void drop_oldest_gop();
+    void release(QueuedPacket& entry);
+    void record_sent(size_t bytes);
+    void set_error(const std::string& error);
+    bool wait_reconnect();
+
+    static int interrupt_callback(void* opaque);
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <shout/shout.h>
+
+/**
+ * One encoded unit, shared read-only by every connection it is sent to
+ */
+struct EncodedPacket {
+    std::vector<uint8_t> data;
+    uint64_t sequence = 0;          // Position in the encoder's output, starting at 0
+    size_t frames = 0;              // Profile-rate PCM frames this packet covers, when known
+    bool header = false;            // Stream header; replayed to late joiners and never dropped
+};
+
+using EncodedPacketPtr = std::shared_ptr<const EncodedPacket>;
+
+/**
+ * Sender queue and network statistics
+ */
+struct ShoutSenderStats {
+    bool connected = false;
+    bool failed = false;
+    std::string error;
+
+    size_t queue_packets = 0;       // Waiting in our queue
+    size_t queue_bytes = 0;
+    size_t shout_queue_bytes = 0;   // Accepted by libshout but not yet on the socket
+
+    uint64_t packets_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t packets_dropped = 0;   // Oldest packets discarded because the queue was full
+    uint64_t bytes_dropped = 0;
+
+    double latency_ms = 0.0;        // Smoothed time from enqueue() to libshout
+    double max_latency_ms = 0.0;
+};
+
+/**
+ * Non-blocking sender for one libshout connection
+ *
+ * enqueue() never blocks: packets go into a bounded queue that a dedicated
+ * I/O thread feeds to libshout in non-blocking mode. When the server cannot
+ * keep up the oldest audio packets are dropped (stream headers never are),
+ * so a lagging relay cannot back-pressure the encoder feeding it.
+ *
+ * The shout_t stays owned by the caller and must outlive stop(). To have
+ * the sender open the connection itself, call shout_set_nonblocking(shout, 1)
+ * before start(true).
+ */
+class ShoutSender {
+public:
+    ShoutSender(shout_t* shout, size_t max_queue_bytes);
+    ~ShoutSender();
+
+    ShoutSender(const ShoutSender&) = delete;
+    ShoutSender& operator=(const ShoutSender&) = delete;
+
+    // Start the I/O thread; with open_connection the shout_open() happens there
+    bool start(bool open_connection);
+    void stop();
+
+    bool enqueue(EncodedPacketPtr packet);
+    bool enqueue(const uint8_t* data, size_t size);
+
+    bool is_connected() const { return connected_; }
+    bool has_failed() const { return failed_; }
+    std::string get_error() const;
+    ShoutSenderStats get_stats() const;
+
+    // Wait for a non-blocking shout_open() to finish
+    static bool wait_connected(shout_t* shout, std::chrono::milliseconds timeout);
+
+private:
+    struct QueuedPacket {
+        EncodedPacketPtr packet;
+        std::chrono::steady_clock::time_point queued_at;
+    };
+
+    shout_t* shout_;
+    const size_t max_queue_bytes_;
+
+    std::deque<QueuedPacket> queue_;
+    size_t queue_bytes_ = 0;
+    mutable std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+
+    std::thread io_thread_;
+    std::atomic<bool> should_stop_{false};
+    std::atomic<bool> open_connection_{false};
+    std::atomic<bool> connected_{false};
+    std::atomic<bool> failed_{false};
+
+    // Written by the I/O thread (and enqueue() for drops), read by get_stats()
+    mutable std::mutex stats_mutex_;
+    ShoutSenderStats stats_;
+    std::string error_;
+
+    void io_loop();
+    bool finish_connect();
+    bool flush_shout_queue();
+    void record_sent(const QueuedPacket& entry);
+    void record_shout_queue();
+    void fail(const std::string& error);
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "http_server.hpp"
+
+/**
+ * One endpoint's serialized response, rebuilt only when its state changes
+ *
+ * The caller passes the generation of the state the response is built
+ * from: the sum of the generation counters of the subsystems it reads.
+ * Each counter only grows and is bumped after every change, so an
+ * unchanged sum means an unchanged response. While it is unchanged, every
+ * request shares the same immutable snapshot and nothing is serialized.
+ * Responses that also carry values no counter tracks, such as meters, set
+ * max_age and are rebuilt at most once per that tick as well.
+ *
+ * Concurrent misses build once: the other requests wait for that build
+ * and share its result. The ETag is a hash of the body. A rebuild that
+ * produces the same bytes keeps the previous snapshot, so pollers keep
+ * getting 304 across ticks while nothing moves.
+ */
+class SnapshotCache {
+public:
+    using Builder = std::function<std::string()>;
+
+    // 0 caches for as long as the generation stays the same
+    explicit SnapshotCache(std::chrono::milliseconds max_age = std::chrono::milliseconds(0));
+
+    SnapshotCache(const SnapshotCache&) = delete;
+    SnapshotCache& operator=(const SnapshotCache&) = delete;
+
+    std::shared_ptr<const HttpSnapshot> get(uint64_t generation, const Builder& build);
+
+    // For responses not worth caching, e.g. errors; still gets an ETag
+    static std::shared_ptr<const HttpSnapshot> make(std::string body);
+    static std::string make_etag(const std::string& body);
+
+private:
+    struct Entry {
+        std::shared_ptr<const HttpSnapshot> snapshot;
+        uint64_t generation = 0;
+        std::chrono::steady_clock::time_point built;
+    };
+
+    bool fresh(const Entry& entry, uint64_t generation, std::chrono::steady_clock::time_point now) const;
+
+    const std::chrono::milliseconds max_age_;
+    std::mutex build_mutex_;            // Held by the one request rebuilding
+    mutable std::mutex mutex_;          // Guards entry_; never held while building
+    Entry entry_;
+};
@@ -0,0 +1,102 @@
+#pragma once
+#include "utils/audio_ring_buffer.hpp"
+#include "utils/seqlock.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <fftw3.h>
+
+struct SpectrumAnalyzerOptions {
+    int fft_size = 2048;            // Decimated samples per transform (power of two)
+    int hop = 512;                  // Decimated samples between frames
+    int decimation = 2;             // Master bus samples per analyzed sample
+    int bands = 256;                // Log-spaced bands per published frame
+    float min_frequency = 30.0f;
+    float max_frequency = 0.0f;     // 0: 90% of the decimated Nyquist frequency
+    float floor_db = -90.0f;        // Level mapped to 0.0; 0 dBFS maps to 1.0
+    float release = 0.6f;           // Fraction of the previous level kept when a band falls
+};
+
+/**
+ * Latest spectrum, published through a seqlock so readers never block
+ * the analyzer and never see a half-written frame
+ */
+struct SpectrumFrame {
+    static constexpr size_t kMaxBands = 512;
+
+    uint64_t sequence = 0;          // Frames computed since start(); 0 means none yet
+    uint32_t band_count = 0;
+    float min_frequency = 0.0f;
+    float max_frequency = 0.0f;
+    std::array<float, kMaxBands> levels{};   // 0.0 - 1.0 per band, lowest band first
+};
+
+/**
+ * Real-time spectrum of the master bus
+ *
+ * A low-priority thread reads its own master bus cursor, so the audio
+ * callback does no extra work. Each hop it downmixes and low-pass
+ * decimates the new samples, runs a Hann-windowed FFT from the shared
+ * FftPlanRegistry and folds the bins into log-spaced bands through a map
+ * built once in start(). Every buffer is allocated up front.
+ */
+class SpectrumAnalyzer {
+public:
+    explicit SpectrumAnalyzer(const SpectrumAnalyzerOptions& options = SpectrumAnalyzerOptions());
+    ~SpectrumAnalyzer();
+
+    SpectrumAnalyzer(const SpectrumAnalyzer&) = delete;
+    SpectrumAnalyzer& operator=(const SpectrumAnalyzer&) = delete;
+
+    // Takes ownership of the cursor; false if already running or the options are unusable
+    bool start(std::shared_ptr<AudioRingBuffer::Reader> reader);
+    void stop();
+    bool is_running() const { return running_.load(); }
+
+    // Applied by the next start()
+    void set_options(const SpectrumAnalyzerOptions& options);
+    SpectrumAnalyzerOptions get_options() const { return options_; }
+
+    SpectrumFrame latest() const { return frame_.load(); }
+
+    /**
+     * The latest frame resampled to `bins` values. The band-to-bin map is
+     * cached per calling thread, so repeated calls with the same count only
+     * copy.
+     */
+    std::vector<float> get_spectrum(int bins) const;
+
+private:
+    struct BandRange {
+        uint32_t first_bin;
+        uint32_t last_bin;          // Inclusive
+    };
+
+    void run();
+    void build_band_map(int sample_rate);
+    void analyze_window();
+
+    SpectrumAnalyzerOptions options_;
+    SpectrumAnalyzerOptions active_;    // Copy taken by start() for the analyzer thread
+    std::shared_ptr<AudioRingBuffer::Reader> reader_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    // Analyzer thread only
+    std::vector<BandRange> band_map_;
+    std::vector<float> lowpass_;        // Decimation filter taps
+    std::vector<float> mono_;           // Downmixed input with lowpass_.size() - 1 samples of history
+    std::vector<float> history_;        // Last fft_size decimated samples
+    std::vector<float> window_;
+    std::vector<float> block_;
+    float* fft_input_ = nullptr;
+    fftwf_complex* fft_output_ = nullptr;
+    fftwf_plan fft_plan_ = nullptr;     // Owned by FftPlanRegistry
+    float window_gain_ = 1.0f;
+    SpectrumFrame working_;
+
+    SeqLock<SpectrumFrame> frame_;
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class StartupPhaseState {
+    PENDING,
+    RUNNING,
+    DONE,
+    FAILED,
+    SKIPPED                             // A dependency failed
+};
+
+/**
+ * When a phase ran, in milliseconds since the orchestrator was created
+ */
+struct StartupPhaseTiming {
+    std::string name;
+    StartupPhaseState state = StartupPhaseState::PENDING;
+    bool required = true;
+    bool lazy = false;                  // Run by run_once() on first use
+    double start_ms = 0.0;
+    double end_ms = 0.0;
+    double duration_ms = 0.0;
+};
+
+/**
+ * Parallel startup of independent subsystems
+ *
+ * Phases are added with the names of the phases they depend on. run()
+ * starts each one on its own thread as soon as all of its dependencies have
+ * succeeded, so independent chains overlap and startup takes as long as the
+ * slowest chain rather than the sum of every step. A phase that fails or
+ * throws skips everything that depends on it. Only a failed required phase
+ * makes run() fail.
+ *
+ * Phases can be added in batches: a later batch may depend on phases that
+ * earlier runs completed, and run_async() runs a batch in the background,
+ * e.g. once the process is already serving. run_once() covers subsystems
+ * initialized on first use instead; it is timed like any other phase.
+ * Every phase's timing is logged when it finishes and kept for timings().
+ */
+class StartupOrchestrator {
+public:
+    using Phase = std::function<bool()>;
+
+    StartupOrchestrator();
+    ~StartupOrchestrator();
+
+    StartupOrchestrator(const StartupOrchestrator&) = delete;
+    StartupOrchestrator& operator=(const StartupOrchestrator&) = delete;
+
+    void add_phase(const std::string& name, const std::vector<std::string>& depends_on, Phase phase,
+                   bool required = true);
+
+    // Runs the phases added since the last run; false when a required one failed
+    bool run();
+    // The same in the background; wait() joins it
+    void run_async();
+    bool wait();
+
+    // Runs phase the first time name is asked for and returns its result
+    // every time; concurrent callers wait for the first
+    bool run_once(const std::string& name, const Phase& phase);
+
+    std::vector<StartupPhaseTiming> timings() const;
+    double elapsed_ms() const;
+    bool get_timing(const std::string& name, StartupPhaseTiming& timing) const;
+
+    static const char* state_name(StartupPhaseState state);
+
+private:
+    struct Entry {
+        StartupPhaseTiming timing;
+        std::vector<std::string> depends_on;
+        Phase phase;
+        bool scheduled = false;         // Part of a run that has started
+    };
+
+    Entry* find(const std::string& name);
+    void finish(Entry& entry, bool success);
+
+    const std::chrono::steady_clock::time_point epoch_;
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+    std::mutex once_mutex_;             // Serializes run_once() phases
+    std::thread background_;
+    bool background_result_ = true;
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_system.hpp"
+
+/**
+ * One station engine
+ */
+struct StationConfig {
+    std::string id;                     // Letters, digits, '-' and '_'; used in routes and metric labels
+    std::string name;
+    AudioFormat format;
+    size_t track_cache_mb = 256;        // Decoded audio kept for this station
+    bool spectrum_analyzer = false;     // One more thread per station; off unless a UI needs it
+    std::map<std::string, StreamingConfig> stream_targets;   // Started with the station
+    int worker = -1;                    // Audio worker to run on; -1 for the least loaded
+};
+
+/**
+ * Host threads
+ */
+struct StationHostOptions {
+    size_t workers = 0;                 // Audio workers; 0 = hardware threads - 1, at least 1
+    bool pin_workers = true;            // Worker i runs on core first_core + i (Linux only)
+    int first_core = 1;                 // Core 0 is left for the HTTP front end and the OS
+    size_t job_workers = 2;             // Work-stealing pool for station jobs
+    int max_late_blocks = 4;            // A station this far behind skips ahead and counts an overrun
+};
+
+/**
+ * A station's share of the host
+ */
+struct StationStats {
+    std::string id;
+    std::string name;
+    bool running = false;
+    int worker = -1;
+    int core = -1;                      // -1 when the worker is not pinned
+
+    int sample_rate = 0;
+    uint64_t blocks = 0;                // Audio periods rendered
+    uint64_t overruns = 0;              // Periods skipped because the worker fell behind
+
+    // CPU time spent on this station's audio and jobs, and the audio share
+    // of real time over the last second (1.0 is a whole core)
+    double cpu_seconds = 0.0;
+    double job_cpu_seconds = 0.0;
+    double load = 0.0;
+    uint64_t jobs = 0;                  // Completed
+
+    size_t memory_bytes = 0;            // Decoded audio held in the station's track cache
+    size_t memory_budget_bytes = 0;
+    bool streaming = false;
+};
+
+/**
+ * Many isolated station engines in one process
+ *
+ * Each station is an AudioSystem of its own, started headless: no device is
+ * opened and a host worker calls process_block() once per period against the
+ * station's own sample clock. Stations are sharded across a fixed set of
+ * workers, one per core and optionally pinned to it, so a host runs as many
+ * stations as its cores keep up with rather than one per process. A worker
+ * renders whichever of its stations is due and sleeps until the next one is;
+ * a station that falls more than max_late_blocks behind skips ahead instead
+ * of holding up the others.
+ *
+ * Work that does not belong on an audio worker, such as loading files, goes
+ * through submit(): a small work-stealing pool shared by every station. Both
+ * kinds of work are timed on the thread CPU clock and charged to the station,
+ * and each station's track cache has its own budget, so stats() shows what
+ * each one costs. Stations share the process's HTTP front end and metrics;
+ * their encoders and stream targets stay their own.
+ */
+class StationHost {
+public:
+    using Job = std::function<void(AudioSystem& station)>;
+
+    explicit StationHost(const StationHostOptions& options = StationHostOptions());
+    ~StationHost();
+
+    StationHost(const StationHost&) = delete;
+    StationHost& operator=(const StationHost&) = delete;
+
+    bool start();
+    void stop();
+    bool is_running() const;
+
+    // Stations can be added and removed while the host runs
+    bool add_station(const StationConfig& config);
+    bool remove_station(const std::string& id);
+    std::shared_ptr<AudioSystem> get_station(const std::string& id) const;
+    std::vector<std::string> get_station_ids() const;
+
+    // Runs job on the pool with the station's engine; false for an unknown station
+    bool submit(const std::string& id, Job job);
+
+    std::vector<StationStats> stats() const;
+    bool get_stats(const std::string& id, StationStats& stats) const;
+    size_t worker_count() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
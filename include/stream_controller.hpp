@@ -8,6 +8,8 @@
 #include <chrono>
 #include <shout/shout.h>
 
+#include "shout_sender.hpp"
+
 namespace onestopradio {
 
 enum class StreamStatus {
@@ -57,6 +59,11 @@ struct StreamStats {
     std::chrono::system_clock::time_point last_update;
     std::string current_song;
     std::string error_message;
+    
+    // Non-blocking sender
+    size_t send_queue_bytes;
+    int64_t packets_dropped;
+    double send_latency_ms;
 };
 
 struct IcecastConfigData {
@@ -112,6 +119,7 @@ private:
         StreamConfig config;
         StreamStatus status;
         shout_t* shout_connection;
+        std::unique_ptr<ShoutSender> sender;   // All sends go through its I/O thread
         std::chrono::system_clock::time_point start_time;
         int64_t bytes_sent;
         int current_listeners;
@@ -127,6 +135,7 @@ private:
     bool WriteIcecastConfig(const IcecastConfigData& data);
     bool ReloadIcecastServer();
     void UpdateStreamStats(const std::string& stream_id);
+    void FillSenderStats(const Stream& stream, StreamStats& stats) const;
     std::string StatusToString(StreamStatus status);
     StreamStatus StringToStatus(const std::string& status);
 
@@ -35,7 +35,7 @@ private:
     std::string StreamConfigToJson(const StreamConfig& config);
     std::string StreamStatsToJson(const StreamStats& stats);
     StreamConfig JsonToStreamConfig(const std::string& json);
-    std::string ExtractStreamId(const std::string& path);
+    std::string ExtractStreamId(const HttpRequest& request);
 
     std::unique_ptr<StreamController> stream_controller_;
     std::unique_ptr<HttpServer> http_server_;
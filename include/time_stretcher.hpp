@@ -0,0 +1,131 @@
+#pragma once
+#include "utils/seqlock.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OneStopRadio {
+
+struct TimeStretcherOptions {
+    int sample_rate = 48000;        // Output rate
+    int channels = 2;
+    size_t max_block_frames = 4096; // Largest render() request
+    float frame_ms = 20.0f;         // WSOLA frame; the hop is half of it
+    float search_ms = 4.0f;         // Splice search either side of the nominal position
+    float max_ratio = 4.0f;         // Bound on the stretch and resampling factors
+};
+
+/**
+ * Cost of render(), measured on every block
+ */
+struct TimeStretchStats {
+    uint64_t blocks = 0;
+    double last_us = 0.0;
+    double avg_us = 0.0;            // Exponential average
+    double max_us = 0.0;
+    double load = 0.0;              // avg_us over the real-time length of the last block
+};
+
+/**
+ * Audio a deck streams into the stretcher
+ */
+class TimeStretchSource {
+public:
+    virtual ~TimeStretchSource() = default;
+
+    // Fill all `frames` interleaved frames; silence past the end of the audio
+    virtual void read(float* out, size_t frames) = 0;
+};
+
+/**
+ * Real-time tempo and pitch control for one deck
+ *
+ * Two stages in series: WSOLA changes the tempo without touching the pitch,
+ * then a cubic resampler changes speed and pitch together. Without key lock
+ * the rate goes entirely to the resampler, like a turntable; with key lock
+ * WSOLA takes the rate and the resampler only applies the pitch shift. The
+ * resampler also absorbs a source rate that differs from the output rate.
+ *
+ * WSOLA overlap-adds Hann frames at half-frame hops. Each frame is spliced
+ * where its start best matches the natural continuation of the previous
+ * one, found by a coarse-to-fine normalised cross-correlation. At a stretch
+ * of 1.0 the continuation is always in range, so the output is the input
+ * unchanged.
+ *
+ * All memory is allocated by the constructor. The setters and render()
+ * belong to the audio thread and never allocate or lock; stats() may be
+ * called from any thread.
+ */
+class TimeStretcher {
+public:
+    explicit TimeStretcher(const TimeStretcherOptions& options = TimeStretcherOptions());
+
+    // Playback speed; 1.0 is normal
+    void set_rate(double rate);
+    void set_pitch_shift(double semitones);
+    void set_key_lock(bool enabled);
+    void set_source_rate(int sample_rate);
+
+    double rate() const { return rate_; }
+    double pitch_shift() const { return pitch_semitones_; }
+    bool key_lock() const { return key_lock_; }
+
+    // Forget buffered audio, e.g. after a seek; the next block fades in
+    void reset();
+
+    // Write `frames` (at most max_block_frames) interleaved output frames
+    void render(float* out, size_t frames, TimeStretchSource& source);
+
+    // Source frames behind the output: how far into the source the listener is
+    double source_position() const;
+
+    TimeStretchStats stats() const { return stats_.load(); }
+    const TimeStretcherOptions& options() const { return options_; }
+
+private:
+    void update_ratios();
+    void next_hop(TimeStretchSource& source);
+    void fill_input(int64_t end, TimeStretchSource& source);
+    int64_t find_splice(int64_t nominal);
+    double correlation(const float* reference, const float* candidate, int stride) const;
+    void record_timing(double elapsed_us, size_t frames);
+
+    const float* input_frame(int64_t position) const {
+        return input_.data() + static_cast<size_t>(position - input_start_) * channels_;
+    }
+
+    TimeStretcherOptions options_;
+    int channels_ = 2;
+    int hop_ = 1;
+    int frame_ = 2;
+    int search_ = 0;
+    std::vector<float> window_;
+
+    // Control
+    double rate_ = 1.0;
+    double pitch_semitones_ = 0.0;
+    bool key_lock_ = false;
+    int source_rate_ = 0;
+    double stretch_ = 1.0;          // Source frames per WSOLA output frame
+    double step_ = 1.0;             // WSOLA frames per output frame
+
+    // WSOLA: input_ holds source frames [input_start_, input_end_)
+    std::vector<float> input_;
+    int64_t input_start_ = 0;
+    int64_t input_end_ = 0;
+    double analysis_position_ = 0.0;
+    int64_t natural_position_ = 0;  // Where the previous frame would have continued
+    bool first_frame_ = true;
+    std::vector<float> overlap_;    // frame_ frames; the first hop_ are complete after each frame
+
+    // Resampler: fifo_ holds WSOLA output, read at a fractional position
+    std::vector<float> fifo_;
+    size_t fifo_frames_ = 0;
+    size_t fifo_capacity_ = 0;
+    double fifo_position_ = 1.0;    // One frame of history stays in front for the interpolator
+
+    SeqLock<TimeStretchStats> stats_;
+    TimeStretchStats running_stats_;
+};
+
+} // namespace OneStopRadio
@@ -0,0 +1,140 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Build with -DONESTOP_TRACING=0 to compile every trace marker out
+#ifndef ONESTOP_TRACING
+#define ONESTOP_TRACING 1
+#endif
+
+/**
+ * One completed scope. name points at a string literal.
+ */
+struct TraceEvent {
+    const char* name = nullptr;
+    uint64_t start_ns = 0;
+    uint64_t end_ns = 0;
+};
+
+struct TraceStatus {
+    bool capturing = false;
+    double duration_seconds = 0.0;  // Of the running or last capture
+    uint64_t events = 0;            // Held for export
+    uint64_t overwritten = 0;       // Lost to ring wrap-around; the newest are kept
+    uint64_t dropped = 0;           // From threads that found no free buffer
+    size_t threads = 0;
+};
+
+/**
+ * Process-wide scoped trace capture
+ *
+ * Each thread records into its own ring buffer, so a marker costs two clock
+ * reads and a few uncontended atomics while a capture runs and a single
+ * relaxed load otherwise. Buffers are allocated by start(), never by the
+ * threads that record, so markers are safe on the audio callback; a thread
+ * claims a free buffer with its first event and gives it back when it exits.
+ * When a ring fills, the oldest events are overwritten.
+ *
+ * stop() waits for in-flight events, after which the capture can be exported
+ * as Chrome trace JSON or as a Perfetto protobuf trace, both of which
+ * ui.perfetto.dev and chrome://tracing open.
+ */
+class TraceProfiler {
+public:
+    static constexpr size_t kMaxThreads = 64;
+    static constexpr size_t kEventsPerThread = 16384;
+    static constexpr size_t kSpareBuffers = 16;     // Kept free for threads that start mid capture
+
+    static TraceProfiler& instance();
+
+    // Discards the previous capture; false if one is running
+    bool start();
+    // False if no capture was running
+    bool stop();
+    bool capturing() const { return capturing_.load(std::memory_order_relaxed); }
+    TraceStatus status() const;
+
+    // Label the calling thread in exports; the name must be a string literal
+    void set_thread_name(const char* name);
+
+    // Called by TraceScope
+    void record(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+    // Both return an empty string while a capture runs
+    std::string export_chrome_json() const;
+    std::string export_perfetto() const;
+
+    static uint64_t now_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    TraceProfiler(const TraceProfiler&) = delete;
+    TraceProfiler& operator=(const TraceProfiler&) = delete;
+
+private:
+    struct ThreadBuffer {
+        std::unique_ptr<TraceEvent[]> events;
+        std::atomic<uint64_t> head{0};              // Events ever written this capture
+        std::atomic<bool> owned{false};
+        std::atomic<bool> writing{false};
+        std::atomic<const char*> name{nullptr};
+        uint32_t id = 0;
+    };
+
+    // The calling thread's buffer and name
+    struct ThreadHandle;
+    static thread_local ThreadHandle local_;
+
+    TraceProfiler() = default;
+    ~TraceProfiler() = default;
+
+    ThreadBuffer* claim_buffer();
+    size_t buffer_count() const { return buffer_count_.load(std::memory_order_acquire); }
+
+    // Guards buffer allocation, start, stop and export
+    mutable std::mutex mutex_;
+    ThreadBuffer buffers_[kMaxThreads];
+    std::atomic<size_t> buffer_count_{0};
+    std::atomic<bool> capturing_{false};
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t capture_start_ns_ = 0;
+    uint64_t capture_end_ns_ = 0;
+};
+
+/**
+ * Records the enclosing scope when a capture was running at its start
+ */
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : name_(name), start_ns_(TraceProfiler::instance().capturing() ? TraceProfiler::now_ns() : 0) {}
+
+    ~TraceScope() {
+        if (start_ns_ != 0) {
+            TraceProfiler::instance().record(name_, start_ns_, TraceProfiler::now_ns());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_ns_;
+};
+
+#if ONESTOP_TRACING
+#define ONESTOP_TRACE_CONCAT_INNER(a, b) a##b
+#define ONESTOP_TRACE_CONCAT(a, b) ONESTOP_TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope ONESTOP_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) TraceProfiler::instance().set_thread_name(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
@@ -0,0 +1,142 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Lower value is decoded first
+enum class PrefetchPriority {
+    PLAYBACK = 0,   // Just ahead of a deck's play position
+    HOT_CUE = 1,    // From a hot cue of a loaded or upcoming track
+    LOADED = 2,     // The rest of a track on a deck
+    UPCOMING = 3    // Next tracks of the active playlist
+};
+
+/**
+ * Decoded PCM of one file, filled chunk by chunk by TrackCache workers
+ *
+ * Chunks are published with release semantics and never freed before the
+ * track itself, so readers on any thread (including the audio thread) see
+ * either a complete chunk or none. read() never blocks, locks or allocates.
+ */
+class DecodedTrack {
+public:
+    DecodedTrack(std::string file_path, int sample_rate, int channels, uint64_t frames, uint32_t chunk_frames);
+    ~DecodedTrack();
+
+    DecodedTrack(const DecodedTrack&) = delete;
+    DecodedTrack& operator=(const DecodedTrack&) = delete;
+
+    const std::string& file_path() const { return file_path_; }
+    int sample_rate() const { return sample_rate_; }
+    int channels() const { return channels_; }
+    uint64_t frames() const { return frames_; }
+    double duration() const { return static_cast<double>(frames_) / sample_rate_; }
+
+    uint32_t chunk_frames() const { return chunk_frames_; }
+    size_t chunk_count() const { return chunk_count_; }
+    size_t chunk_of(uint64_t frame) const { return static_cast<size_t>(frame / chunk_frames_); }
+
+    /**
+     * Copy up to `count` interleaved frames starting at `frame` into `out`
+     * @return frames copied; stops early at the end of the track or at the
+     *         first chunk that is not decoded yet
+     */
+    size_t read(uint64_t frame, float* out, size_t count) const;
+
+    bool is_decoded(uint64_t frame) const;
+    bool is_complete() const { return decoded_chunks_.load(std::memory_order_acquire) == chunk_count_; }
+    size_t decoded_bytes() const;
+
+private:
+    friend class TrackCache;
+
+    size_t chunk_samples(size_t index) const;
+    bool has_chunk(size_t index) const { return chunks_[index].load(std::memory_order_acquire) != nullptr; }
+
+    // TrackCache workers: false if another worker published the chunk first
+    bool publish_chunk(size_t index, std::unique_ptr<float[]> samples);
+
+    std::string file_path_;
+    int sample_rate_;
+    int channels_;
+    uint64_t frames_;
+    uint32_t chunk_frames_;
+    size_t chunk_count_;
+    std::unique_ptr<std::atomic<float*>[]> chunks_;
+    std::atomic<size_t> decoded_chunks_{0};
+};
+
+struct TrackCacheOptions {
+    size_t memory_budget_bytes = size_t(1) << 30;   // Decoded PCM kept for idle tracks
+    uint32_t chunk_frames = 65536;                   // Decode and eviction granularity
+    size_t workers = 1;                              // Decoding is mostly I/O bound
+    double playback_lead_seconds = 4.0;              // Decoded first from a deck's play position
+    double hot_cue_seconds = 8.0;                    // Audio preloaded from each hot cue
+    int sample_rate = 0;                             // Decoded rate; 0 keeps each file's rate
+};
+
+struct TrackCacheStats {
+    size_t tracks = 0;
+    size_t bytes = 0;
+    size_t budget_bytes = 0;
+    size_t queued = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+/**
+ * Decoded-PCM cache with an LRU memory budget and background prefetch
+ *
+ * Tracks are decoded by low-priority worker threads in chunk_frames chunks,
+ * most urgent request first: a worker checks the queue between chunks, so a
+ * deck seek overtakes a playlist prefetch within one chunk. Only tracks no
+ * one else holds are evicted, so tracks on decks stay resident whatever the
+ * budget; hot-cue and playlist prefetches that would exceed it are dropped.
+ *
+ * Files are decoded through AudioDecoder, so anything libsndfile or FFmpeg
+ * reads can be cached, converted to the engine rate on the way in.
+ *
+ * acquire() of a cached track is a lookup and a pointer copy. A miss reads
+ * the file header on the calling thread and leaves the samples to the
+ * workers, so nothing on the audio path waits for the disk.
+ */
+class TrackCache {
+public:
+    explicit TrackCache(const TrackCacheOptions& options = TrackCacheOptions());
+    ~TrackCache();
+
+    bool start();
+    void stop();
+
+    /**
+     * The track for a deck. The audio from `position_seconds` is decoded
+     * ahead of everything else and the rest of the track follows, so call
+     * it again on a seek to move the decoder.
+     * @return nullptr if the file cannot be opened
+     */
+    std::shared_ptr<const DecodedTrack> acquire(const std::string& file_path, double position_seconds = 0.0);
+
+    // Cached track or nullptr; no I/O
+    std::shared_ptr<const DecodedTrack> find(const std::string& file_path);
+
+    // Decode the whole track in the background
+    void prefetch(const std::string& file_path, PrefetchPriority priority = PrefetchPriority::UPCOMING);
+
+    // Decode [position, position + seconds); seconds <= 0 uses hot_cue_seconds
+    void prefetch_region(const std::string& file_path, double position_seconds, double seconds = 0.0,
+                         PrefetchPriority priority = PrefetchPriority::HOT_CUE);
+
+    // Tracks are resampled to this rate as they decode; changing it drops the cached ones
+    void set_sample_rate(int sample_rate);
+
+    // Shrinking evicts idle tracks right away
+    void set_memory_budget(size_t bytes);
+    TrackCacheStats get_stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct RadioTrack;
+
+namespace OneStopRadio {
+
+using TrackIndex = uint32_t;
+constexpr TrackIndex kNoTrack = UINT32_MAX;
+
+// Camelot wheel position: 0-11 are 1A-12A (minor), 12-23 are 1B-12B (major)
+constexpr uint8_t kNoKey = 24;
+using KeyMask = uint32_t;           // Bit per wheel position; bit kNoKey is "unknown"
+
+// Accepts Camelot ("8A"), Open Key ("1m") and note names ("Am", "F# minor", "Eb")
+uint8_t parse_musical_key(std::string_view key);
+std::string camelot_name(uint8_t key);
+// The key itself, its wheel neighbours and its relative major or minor
+KeyMask harmonic_keys(uint8_t key);
+
+/**
+ * Column predicate for TrackCatalog::filter; unset fields match everything
+ */
+struct TrackFilter {
+    float min_bpm = 0.0f;
+    float max_bpm = 0.0f;           // 0 means no upper bound
+    KeyMask keys = 0;               // 0 matches any key, including unknown
+    int genre = -1;                 // genre_id(); -1 matches any genre
+    int max_play_count = -1;        // -1 means no bound
+    size_t limit = 0;               // 0 returns every match
+};
+
+/**
+ * Bump allocator for strings that live as long as the catalog
+ *
+ * Views stay valid until clear(): blocks are never moved or freed
+ * individually.
+ */
+class StringArena {
+public:
+    std::string_view store(std::string_view text);
+    void clear();
+    size_t bytes() const { return bytes_; }
+
+private:
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* block_ = nullptr;         // Block small strings are appended to
+    size_t block_used_ = 0;
+    size_t bytes_ = 0;
+};
+
+/**
+ * Column-oriented copy of the library's hot fields
+ *
+ * Each track id is interned to a dense index; BPM, key, duration, genre and
+ * play count sit in parallel arrays so a filter is a straight pass over a
+ * few contiguous columns the compiler can vectorise, rather than a walk of
+ * the string-keyed track map. Genres are interned to small integers the same
+ * way. Strings are copied into an arena that is compacted once replaced
+ * strings make up half of it.
+ *
+ * Removed tracks leave a dead slot that the next insert reuses, so indices
+ * stay dense. Not thread-safe: RadioControl updates it under the same lock
+ * as its track map.
+ */
+class TrackCatalog {
+public:
+    // Insert or refresh a track; returns its index
+    TrackIndex upsert(const RadioTrack& track);
+    bool remove(std::string_view track_id);
+    void clear();
+
+    void set_play_count(TrackIndex index, int play_count);
+    void set_analysis(TrackIndex index, float bpm, int duration_ms);
+
+    TrackIndex find(std::string_view track_id) const;
+    int genre_id(std::string_view genre) const;     // -1 if no track has it
+
+    std::vector<TrackIndex> filter(const TrackFilter& filter) const;
+
+    // Columns, valid for live indices
+    std::string_view id(TrackIndex index) const { return ids_[index]; }
+    std::string_view title(TrackIndex index) const { return titles_[index]; }
+    std::string_view artist(TrackIndex index) const { return artists_[index]; }
+    float bpm(TrackIndex index) const { return bpm_[index]; }
+    uint8_t key(TrackIndex index) const { return key_[index]; }
+    int32_t duration_ms(TrackIndex index) const { return duration_ms_[index]; }
+    int play_count(TrackIndex index) const { return static_cast<int>(play_count_[index]); }
+    std::string_view genre(TrackIndex index) const;
+
+    size_t size() const { return index_.size(); }
+    size_t capacity() const { return live_.size(); }
+    size_t string_bytes() const { return arena_.bytes(); }
+
+private:
+    std::string_view store(std::string_view text);
+    uint16_t intern_genre(std::string_view genre);
+    void compact();
+
+    std::vector<float> bpm_;
+    std::vector<uint8_t> key_;
+    std::vector<int32_t> duration_ms_;
+    std::vector<uint16_t> genre_;
+    std::vector<uint32_t> play_count_;
+    std::vector<uint8_t> live_;
+
+    std::vector<std::string_view> ids_;
+    std::vector<std::string_view> titles_;
+    std::vector<std::string_view> artists_;
+    std::unordered_map<std::string_view, TrackIndex> index_;   // Keys point into arena_
+    std::vector<TrackIndex> free_;
+
+    std::vector<std::string_view> genres_;                     // Lower-cased; id 0 is ""
+    std::unordered_map<std::string_view, uint16_t> genre_index_;
+
+    StringArena arena_;
+    size_t dead_bytes_ = 0;         // Arena bytes no live view refers to
+};
+
+} // namespace OneStopRadio
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+/**
+ * Single-writer, multi-reader ring of interleaved float audio.
+ *
+ * The writer (the audio callback) never blocks and is never held back by
+ * readers: each reader owns its cursor, and a reader that falls more than
+ * one ring behind is moved forward and records an overflow. Blocked
+ * readers sleep on a condition variable. The writer wakes them only while
+ * one is waiting, and only if it can take the wait mutex without blocking;
+ * a missed wake is covered by the next write or, failing that, by
+ * kWakeSafetyNet. cancel() and close() come from control threads and wake
+ * readers at once.
+ * A single write() must not exceed a quarter of the capacity.
+ */
+class AudioRingBuffer : public std::enable_shared_from_this<AudioRingBuffer> {
+public:
+    class Reader {
+    public:
+        /**
+         * Block until `frames` frames are available and copy them out.
+         * Returns `frames` on success, or 0 on timeout (counted as an
+         * underrun), cancel() or when the ring is closed.
+         */
+        size_t read(float* out, size_t frames, std::chrono::milliseconds timeout) {
+            const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+            while (!ring_->closed_.load() && !cancelled_.load()) {
+                if (try_read(out, frames)) {
+                    return frames;
+                }
+
+                const auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    underruns_.fetch_add(1);
+                    return 0;
+                }
+
+                std::unique_lock<std::mutex> lock(ring_->wait_mutex_);
+                ring_->waiters_.fetch_add(1);
+                ring_->data_cv_.wait_until(lock, std::min(deadline, now + kWakeSafetyNet), [&] {
+                    return ring_->closed_.load() || cancelled_.load() || ready(frames);
+                });
+                ring_->waiters_.fetch_sub(1);
+            }
+            return 0;
+        }
+
+        // Non-blocking variant: copies exactly `frames` frames or nothing
+        bool try_read(float* out, size_t frames) {
+            if (frames > ring_->capacity_ / 2) {
+                return false; // Request could never be served without overflowing
+            }
+
+            for (;;) {
+                const uint64_t write_pos = ring_->write_pos_.load(std::memory_order_acquire);
+                if (write_pos - cursor_ > ring_->capacity_) {
+                    skip_ahead(write_pos);
+                }
+                if (write_pos - cursor_ < frames) {
+                    return false;
+                }
+
+                ring_->copy_out(cursor_, out, frames);
+
+                // The writer copies before publishing, so anything within a guard
+                // band of being lapped may already have been overwritten
+                const uint64_t after = ring_->write_pos_.load(std::memory_order_acquire);
+                if (after - cursor_ > ring_->capacity_ - ring_->guard_) {
+                    skip_ahead(after);
+                    continue;
+                }
+
+                cursor_ += frames;
+                return true;
+            }
+        }
+
+        // Wake a blocked read() and make further reads return 0
+        void cancel() {
+            cancelled_.store(true);
+            std::lock_guard<std::mutex> lock(ring_->wait_mutex_);
+            ring_->data_cv_.notify_all();
+        }
+
+        size_t available() const {
+            const uint64_t write_pos = ring_->write_pos_.load(std::memory_order_acquire);
+            return static_cast<size_t>(std::min<uint64_t>(write_pos - cursor_, ring_->capacity_));
+        }
+
+        int channels() const { return ring_->channels_; }
+        int sample_rate() const { return ring_->sample_rate_; }
+        size_t capacity_frames() const { return ring_->capacity_; }
+        uint64_t overflows() const { return overflows_.load(); }
+        uint64_t underruns() const { return underruns_.load(); }
+        uint64_t dropped_frames() const { return dropped_frames_.load(); }
+
+    private:
+        friend class AudioRingBuffer;
+
+        Reader(std::shared_ptr<AudioRingBuffer> ring, uint64_t start)
+            : ring_(std::move(ring)), cursor_(start) {}
+
+        // Whether try_read() would have frames to copy (or a lap to recover)
+        bool ready(size_t frames) const {
+            return frames <= ring_->capacity_ / 2 && ring_->write_pos_.load() - cursor_ >= frames;
+        }
+
+        void skip_ahead(uint64_t write_pos) {
+            // Resume half a ring behind the writer so the next read has headroom
+            const uint64_t target = write_pos - ring_->capacity_ / 2;
+            dropped_frames_.fetch_add(target - cursor_);
+            overflows_.fetch_add(1);
+            cursor_ = target;
+        }
+
+        std::shared_ptr<AudioRingBuffer> ring_;
+        uint64_t cursor_;                 // Owned by the reading thread
+        std::atomic<bool> cancelled_{false};
+        std::atomic<uint64_t> overflows_{0};
+        std::atomic<uint64_t> underruns_{0};
+        std::atomic<uint64_t> dropped_frames_{0};
+    };
+
+    static std::shared_ptr<AudioRingBuffer> create(size_t capacity_frames, int channels, int sample_rate) {
+        return std::shared_ptr<AudioRingBuffer>(new AudioRingBuffer(capacity_frames, channels, sample_rate));
+    }
+
+    AudioRingBuffer(const AudioRingBuffer&) = delete;
+    AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+    // Writer side; real-time safe (never blocks or allocates, and makes a
+    // system call only to wake a reader that is waiting)
+    void write(const float* interleaved, size_t frames) {
+        const uint64_t pos = write_pos_.load(std::memory_order_relaxed);
+
+        // Only the newest `capacity_` frames can ever be read
+        if (frames > capacity_) {
+            interleaved += (frames - capacity_) * channels_;
+            write_pos_.store(pos + (frames - capacity_), std::memory_order_release);
+            write(interleaved, capacity_);
+            return;
+        }
+
+        const size_t start = static_cast<size_t>(pos & mask_);
+        const size_t first = std::min(frames, capacity_ - start);
+        std::memcpy(data_.get() + start * channels_, interleaved, first * channels_ * sizeof(float));
+        std::memcpy(data_.get(), interleaved + first * channels_, (frames - first) * channels_ * sizeof(float));
+
+        write_pos_.store(pos + frames, std::memory_order_release);
+
+        // Pairs with the reader registering in waiters_ before its last check
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) > 0 && wait_mutex_.try_lock()) {
+            data_cv_.notify_all();
+            wait_mutex_.unlock();
+        }
+    }
+
+    // New readers start at the current write position (no backlog)
+    std::shared_ptr<Reader> create_reader() {
+        return std::shared_ptr<Reader>(new Reader(shared_from_this(), write_pos_.load()));
+    }
+
+    // Wake all readers; subsequent reads return 0
+    void close() {
+        closed_.store(true);
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        data_cv_.notify_all();
+    }
+
+    bool is_closed() const { return closed_.load(); }
+    uint64_t frames_written() const { return write_pos_.load(); }
+    size_t capacity_frames() const { return capacity_; }
+    int channels() const { return channels_; }
+    int sample_rate() const { return sample_rate_; }
+
+private:
+    // Longest a reader sleeps past a write whose wake it missed
+    static constexpr std::chrono::milliseconds kWakeSafetyNet{20};
+
+    AudioRingBuffer(size_t capacity_frames, int channels, int sample_rate)
+        : channels_(channels)
+        , sample_rate_(sample_rate)
+        , capacity_(round_up_pow2(std::max<size_t>(capacity_frames, 2)))
+        , mask_(capacity_ - 1)
+        , guard_(capacity_ / 4)
+        , data_(new float[capacity_ * channels]()) {}
+
+    static size_t round_up_pow2(size_t v) {
+        size_t p = 1;
+        while (p < v) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    void copy_out(uint64_t pos, float* out, size_t frames) const {
+        const size_t start = static_cast<size_t>(pos & mask_);
+        const size_t first = std::min(frames, capacity_ - start);
+        std::memcpy(out, data_.get() + start * channels_, first * channels_ * sizeof(float));
+        std::memcpy(out + first * channels_, data_.get(), (frames - first) * channels_ * sizeof(float));
+    }
+
+    const int channels_;
+    const int sample_rate_;
+    const size_t capacity_;
+    const size_t mask_;
+    const size_t guard_;      // Largest write that may be in flight during a read
+    std::unique_ptr<float[]> data_;
+
+    alignas(64) std::atomic<uint64_t> write_pos_{0};
+    std::atomic<bool> closed_{false};
+
+    std::mutex wait_mutex_;
+    std::condition_variable data_cv_;
+    std::atomic<int> waiters_{0};       // Readers inside data_cv_.wait_until()
+};
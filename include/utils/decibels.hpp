@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Table-driven dB <-> linear conversion for per-sample use.
+ *
+ * to_gain() interpolates a table at 0.1 dB steps over [kMinDb, kMaxDb];
+ * to_db() takes the exponent from the float bits and interpolates log2 of
+ * the mantissa. Both stay within 0.001 dB of the exact functions.
+ */
+class Decibels {
+public:
+    static constexpr float kMinDb = -120.0f;    // Levels at or below are silence
+    static constexpr float kMaxDb = 40.0f;
+
+    static float to_gain(float db) {
+        const Tables& t = tables();
+        const float position = (std::min(std::max(db, kMinDb), kMaxDb) - kMinDb) * kGainStepsPerDb;
+        const int index = std::min(static_cast<int>(position), kGainEntries - 2);
+        const float frac = position - static_cast<float>(index);
+        return t.gain[index] + (t.gain[index + 1] - t.gain[index]) * frac;
+    }
+
+    static float to_db(float gain) {
+        gain = std::abs(gain);
+        if (!(gain > kMinGain)) {
+            return kMinDb;
+        }
+        uint32_t bits;
+        std::memcpy(&bits, &gain, sizeof(bits));
+        const int exponent = static_cast<int>((bits >> 23) & 0xff) - 127;
+        const float position = static_cast<float>(bits & 0x7fffff) * (static_cast<float>(kMantissaEntries - 1) / 8388608.0f);
+        const int index = static_cast<int>(position);
+        const float frac = position - static_cast<float>(index);
+        const Tables& t = tables();
+        const float log2_mantissa = t.log2[index] + (t.log2[index + 1] - t.log2[index]) * frac;
+        return kDbPerOctave * (static_cast<float>(exponent) + log2_mantissa);
+    }
+
+private:
+    static constexpr float kGainStepsPerDb = 10.0f;
+    static constexpr int kGainEntries = static_cast<int>((kMaxDb - kMinDb) * kGainStepsPerDb) + 1;
+    static constexpr int kMantissaEntries = 257;   // log2 of 1.0 ... 2.0
+    static constexpr float kDbPerOctave = 6.0205999f;
+    static constexpr float kMinGain = 1e-6f;        // kMinDb
+
+    struct Tables {
+        float gain[kGainEntries];
+        float log2[kMantissaEntries];
+
+        Tables() {
+            for (int i = 0; i < kGainEntries; ++i) {
+                gain[i] = static_cast<float>(std::pow(10.0, (kMinDb + i / kGainStepsPerDb) / 20.0));
+            }
+            for (int i = 0; i < kMantissaEntries; ++i) {
+                log2[i] = static_cast<float>(std::log2(1.0 + static_cast<double>(i) / (kMantissaEntries - 1)));
+            }
+        }
+    };
+
+    static const Tables& tables() {
+        static const Tables instance;
+        return instance;
+    }
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Streaming JSON serializer that appends straight to a string.
+ *
+ * For responses too large to build as a json DOM first: values are
+ * escaped and written as they are produced, so memory is the output
+ * itself. Commas are inserted automatically; the caller is responsible
+ * for balancing begin/end calls and for passing a key before every
+ * object member. Strings are copied byte for byte, so they must already
+ * be UTF-8.
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    JsonWriter& begin_object() { return open('{'); }
+    JsonWriter& end_object() { return close('}'); }
+    JsonWriter& begin_array() { return open('['); }
+    JsonWriter& end_array() { return close(']'); }
+
+    JsonWriter& key(std::string_view name) {
+        separate();
+        write_string(name);
+        out_ += ':';
+        after_key_ = true;
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view text) {
+        separate();
+        write_string(text);
+        return *this;
+    }
+
+    JsonWriter& value(const char* text) { return text ? value(std::string_view(text)) : null(); }
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+
+    JsonWriter& value(bool flag) {
+        separate();
+        out_ += flag ? "true" : "false";
+        return *this;
+    }
+
+    template <typename T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+    JsonWriter& value(T number) {
+        if constexpr (std::is_floating_point<T>::value) {
+            if (!std::isfinite(number)) {
+                return null();     // JSON has no NaN or infinity
+            }
+        }
+        separate();
+        char buffer[32];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out_.append(buffer, result.ptr);
+        return *this;
+    }
+
+    JsonWriter& null() {
+        separate();
+        out_ += "null";
+        return *this;
+    }
+
+private:
+    JsonWriter& open(char bracket) {
+        separate();
+        out_ += bracket;
+        first_.push_back(true);
+        return *this;
+    }
+
+    JsonWriter& close(char bracket) {
+        out_ += bracket;
+        first_.pop_back();
+        return *this;
+    }
+
+    void separate() {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+        if (!first_.empty()) {
+            if (!first_.back()) {
+                out_ += ',';
+            }
+            first_.back() = false;
+        }
+    }
+
+    void write_string(std::string_view text) {
+        static const char kHex[] = "0123456789abcdef";
+        out_ += '"';
+        size_t run = 0;     // Start of the bytes that need no escaping
+        for (size_t i = 0; i < text.size(); ++i) {
+            const unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            out_.append(text.data() + run, i - run);
+            run = i + 1;
+            switch (c) {
+                case '"': out_ += "\\\""; break;
+                case '\\': out_ += "\\\\"; break;
+                case '\n': out_ += "\\n"; break;
+                case '\r': out_ += "\\r"; break;
+                case '\t': out_ += "\\t"; break;
+                default:
+                    out_ += "\\u00";
+                    out_ += kHex[c >> 4];
+                    out_ += kHex[c & 0xF];
+                    break;
+            }
+        }
+        out_.append(text.data() + run, text.size() - run);
+        out_ += '"';
+    }
+
+    std::string& out_;
+    std::vector<bool> first_;   // Per open container: nothing written in it yet
+    bool after_key_ = false;
+};
@@ -1,6 +1,21 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
 #include <string>
 
+// Calls below this level compile to nothing. Release builds drop DEBUG
+// unless the build sets LOGGER_MIN_LEVEL explicitly (0 DEBUG ... 3 ERROR).
+#ifndef LOGGER_MIN_LEVEL
+#ifdef NDEBUG
+#define LOGGER_MIN_LEVEL 1
+#else
+#define LOGGER_MIN_LEVEL 0
+#endif
+#endif
+
 class Logger {
 public:
     enum Level {
@@ -9,17 +24,74 @@ public:
         WARN,
         ERROR
     };
-    
-    static void initialize(const std::string& log_file = "");
+
+    static constexpr Level kMinLevel = static_cast<Level>(LOGGER_MIN_LEVEL);
+
     static void set_level(Level level);
-    
-    static void debug(const std::string& message);
-    static void info(const std::string& message);
+    static void set_log_file(const std::string& filepath, size_t max_size = 10 * 1024 * 1024, bool rotate = true);
+
+    // Async mode: each logging thread appends to its own lock-free ring of
+    // buffer_entries messages and a background writer formats and writes
+    // them in batches, so a caller never waits on the console or the file.
+    // A message that finds its ring full is counted and dropped. Messages
+    // longer than an entry are truncated. stop_async() writes everything
+    // still queued and returns to synchronous logging; it also runs at exit.
+    static void start_async(size_t buffer_entries = 1024);
+    static void stop_async();
+    static bool is_async();
+    static uint64_t dropped_messages();
+
+    // Whether a level would be written; for skipping expensive messages
+    static bool enabled(Level level) {
+        return level >= kMinLevel && level >= current_level_;
+    }
+
+    static void debug(const std::string& message) {
+        if (DEBUG >= kMinLevel) {
+            log(DEBUG, message);
+        }
+    }
+    static void info(const std::string& message) {
+        if (INFO >= kMinLevel) {
+            log(INFO, message);
+        }
+    }
     static void warn(const std::string& message);
     static void error(const std::string& message);
-    
+
+    // Same, as "[context] message"
+    static void debug(const std::string& context, const std::string& message) {
+        if (DEBUG >= kMinLevel) {
+            log_with_context(DEBUG, context, message);
+        }
+    }
+    static void info(const std::string& context, const std::string& message) {
+        if (INFO >= kMinLevel) {
+            log_with_context(INFO, context, message);
+        }
+    }
+    static void warn(const std::string& context, const std::string& message);
+    static void error(const std::string& context, const std::string& message);
+
 private:
-    static Level current_level_;
-    static std::string log_file_;
+    static std::atomic<Level> current_level_;
+    static std::string log_file_path_;
+    static std::mutex log_mutex_;
+    static size_t max_file_size_;
+    static bool rotate_logs_;
+
+    static std::string level_to_string(Level level);
+    static std::string get_timestamp(std::chrono::system_clock::time_point time);
+    static void rotate_log_file();
     static void log(Level level, const std::string& message);
-};
\ No newline at end of file
+    static void log_with_context(Level level, const std::string& context, const std::string& message);
+
+    friend class LogWriter;
+};
+
+// Skips building the message entirely when the level is filtered out,
+// at compile time for levels below LOGGER_MIN_LEVEL
+#define LOG_DEBUG(...) \
+    do { if (Logger::DEBUG >= Logger::kMinLevel && Logger::enabled(Logger::DEBUG)) Logger::debug(__VA_ARGS__); } while (0)
+#define LOG_INFO(...) \
+    do { if (Logger::INFO >= Logger::kMinLevel && Logger::enabled(Logger::INFO)) Logger::info(__VA_ARGS__); } while (0)
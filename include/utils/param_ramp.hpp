@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+enum class RampShape : uint8_t {
+    LINEAR,         // Even steps in amplitude; short de-zipper moves
+    EXPONENTIAL     // Even steps in dB; fades and ducking
+};
+
+/**
+ * Gain that moves to a new value over a number of frames instead of jumping.
+ *
+ * Owned by a single thread (the audio callback). A ramp is consumed in
+ * segments over which the value moves linearly, so a block can go through
+ * the gain-ramp kernels: a linear ramp is one segment, an exponential one is
+ * split every kSegmentFrames and exact at each boundary. A new ramp starts
+ * from wherever the running one has got to, so overlapping fades never jump.
+ */
+class ParamRamp {
+public:
+    static constexpr uint32_t kSegmentFrames = 32;
+    static constexpr float kExponentialFloor = 1e-4f;   // -80 dB, where ramps to or from silence start and end
+
+    explicit ParamRamp(float value = 1.0f) : current_(value), target_(value) {}
+
+    void set(float value) {
+        current_ = target_ = value;
+        remaining_ = 0;
+    }
+
+    // frames == 0 jumps
+    void ramp_to(float target, uint32_t frames, RampShape shape) {
+        if (frames == 0 || target == current_) {
+            set(target);
+            return;
+        }
+
+        target_ = target;
+        remaining_ = frames;
+        exponential_ = shape == RampShape::EXPONENTIAL;
+        if (exponential_) {
+            current_ = std::max(current_, kExponentialFloor);
+            step_ = std::pow(std::max(target, kExponentialFloor) / current_, 1.0f / static_cast<float>(frames));
+        } else {
+            step_ = (target - current_) / static_cast<float>(frames);
+        }
+    }
+
+    float value() const { return current_; }
+    float target() const { return target_; }
+    bool ramping() const { return remaining_ > 0; }
+
+    // Frames, up to max_frames, before the next change of slope
+    uint32_t segment(uint32_t max_frames) const {
+        if (remaining_ == 0) {
+            return max_frames;
+        }
+        return std::min({max_frames, remaining_, exponential_ ? kSegmentFrames : remaining_});
+    }
+
+    // frames must not exceed segment()
+    void advance(uint32_t frames) {
+        if (remaining_ == 0) {
+            return;
+        }
+        remaining_ -= frames;
+        if (remaining_ == 0) {
+            current_ = target_;
+        } else if (exponential_) {
+            current_ *= std::pow(step_, static_cast<float>(frames));
+        } else {
+            current_ += step_ * static_cast<float>(frames);
+        }
+    }
+
+private:
+    float current_;
+    float target_;
+    float step_ = 0.0f;         // Per frame: added when linear, multiplied when exponential
+    uint32_t remaining_ = 0;
+    bool exponential_ = false;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Single-writer sequence lock for small trivially copyable values.
+ *
+ * The writer (typically the audio thread) never blocks; readers retry
+ * until they observe a consistent copy. The payload is stored as relaxed
+ * atomic words so concurrent access is well defined.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type");
+
+public:
+    SeqLock() { store(T{}); }
+
+    void store(const T& value) {
+        Words words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        const uint32_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < kWordCount; ++i) {
+            data_[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        Words words{};
+        uint32_t before, after;
+        do {
+            before = sequence_.load(std::memory_order_acquire);
+            for (size_t i = 0; i < kWordCount; ++i) {
+                words[i] = data_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence_.load(std::memory_order_relaxed);
+        } while ((before & 1u) != 0 || before != after);
+
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr size_t kWordCount = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    using Words = std::array<uint32_t, kWordCount>;
+
+    std::atomic<uint32_t> sequence_{0};
+    std::array<std::atomic<uint32_t>, kWordCount> data_;
+};
@@ -6,6 +6,8 @@
 #include <functional>
 #include <mutex>
 #include <map>
+#include <thread>
+#include "utils/seqlock.hpp"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -36,6 +38,52 @@ struct VideoFormat {
     int fps = 30;
     int bitrate = 2500000; // 2.5 Mbps
     std::string codec = "h264";
+    std::string encoder = "auto";   // auto, software, nvenc, qsv, vaapi or videotoolbox
+    std::string hw_device;          // e.g. /dev/dri/renderD128 for VAAPI; empty picks the default
+};
+
+// Platforms whose formats share a key share one encoder. Every encoder runs
+// at the composer's frame rate, so fps is not part of it.
+std::string video_profile_key(const VideoFormat& format);
+
+class SharedStreamEncoder;
+struct RtmpSenderOptions;
+
+enum class VideoEncoderBackend {
+    SOFTWARE,       // libx264
+    VAAPI,
+    NVENC,
+    QSV,
+    VIDEOTOOLBOX
+};
+
+const char* video_encoder_backend_name(VideoEncoderBackend backend);
+
+struct VideoEncoderStats {
+    VideoEncoderBackend backend = VideoEncoderBackend::SOFTWARE;
+    bool hardware = false;
+    uint64_t frames = 0;
+    double last_encode_ms = 0.0;    // Upload and encode of one frame
+    double avg_encode_ms = 0.0;     // Exponential average
+    double max_encode_ms = 0.0;
+};
+
+struct VideoStageStats {
+    uint64_t frames = 0;            // Frames the stage finished
+    uint64_t dropped = 0;           // Frames discarded because the next stage was still full
+    double avg_ms = 0.0;            // Work per frame, exponential average
+    double max_ms = 0.0;
+};
+
+// Live pipeline: compose -> convert -> encode -> send, one thread each
+struct VideoPipelineStats {
+    VideoStageStats compose;
+    VideoStageStats convert;
+    VideoStageStats encode;
+    VideoStageStats send;           // Counts packets rather than frames
+    uint64_t deadline_misses = 0;   // Frame slots skipped because composition fell behind
+    uint64_t repeated_frames = 0;   // Unchanged pictures passed to the encoders without conversion
+    double latency_ms = 0.0;        // Composition to hand-off to the streamer, averaged
 };
 
 struct SocialMediaConfig {
@@ -55,15 +103,54 @@ struct SlideShowConfig {
     std::string transition_effect = "fade";
 };
 
+// One composed RGB24 picture. Frames are shared rather than copied: the
+// composer reuses a frame's buffer only once every reference is released.
+struct VideoFrame {
+    std::vector<uint8_t> rgb;
+    int width = 0;
+    int height = 0;
+    uint64_t generation = 0;        // Changes whenever the picture does
+};
+
+using VideoFramePtr = std::shared_ptr<const VideoFrame>;
+
 class VideoEncoder {
 public:
     VideoEncoder();
     ~VideoEncoder();
     
-    bool initialize(const VideoFormat& format);
+    // Opens format.encoder ("auto" tries each hardware backend), then libx264
+    // if none of those could be opened. Input frames are source_width x
+    // source_height (the output size if 0) and are scaled to the output.
+    bool initialize(const VideoFormat& format, int source_width = 0, int source_height = 0);
+    
+    // Called for each packet an encode produces. The packet is only valid for
+    // the call; av_packet_ref it to keep the data without copying.
+    using PacketCallback = std::function<void(const AVPacket* packet)>;
+    
+    // frame_data is one RGB24 frame at the configured size
+    bool encode_frame(const uint8_t* frame_data, const PacketCallback& on_packet);
+    // Appends every packet's bytes to encoded_data
     bool encode_frame(const uint8_t* frame_data, std::vector<uint8_t>& encoded_data);
+    
+    // The two halves of encode_frame(), for running them on different threads.
+    // convert_frame returns a new frame reference that encode_converted
+    // releases. pts counts frames at the configured rate; it may skip, and a
+    // restart from 0 is carried on from the last timestamp.
+    AVFrame* convert_frame(const uint8_t* frame_data, int64_t pts);
+    // Another reference to a frame convert_frame returned, at a new pts, for
+    // a picture that has not changed; no conversion or copy
+    AVFrame* repeat_frame(const AVFrame* converted, int64_t pts);
+    bool encode_converted(AVFrame* frame, const PacketCallback& on_packet);
     void reset();
     
+    // Backend chosen by initialize() and per-frame cost; safe from any thread
+    VideoEncoderStats get_stats() const;
+    
+    // Stream description for a muxer, and the time base of packet timestamps
+    bool get_codec_parameters(AVCodecParameters* params) const;
+    AVRational get_time_base() const;
+    
 private:
     class Impl;
     std::unique_ptr<Impl> impl_;
@@ -95,7 +182,11 @@ public:
     void next_slide();
     void previous_slide();
     
-    // Frame generation
+    // Frame generation. Layers are rasterized when they change and only the
+    // regions they touch are recomposited; while nothing changes the same
+    // frame is returned again. Null before initialize().
+    VideoFramePtr acquire_frame();
+    // Copies acquire_frame() into frame_buffer
     bool get_current_frame(uint8_t* frame_buffer, size_t buffer_size);
     
     // Overlay text/graphics
@@ -117,6 +208,16 @@ public:
     bool add_platform(const std::string& platform_id, const SocialMediaConfig& config);
     bool remove_platform(const std::string& platform_id);
     bool update_platform_config(const std::string& platform_id, const SocialMediaConfig& config);
+    bool get_platform_config(const std::string& platform_id, SocialMediaConfig& config) const;
+    
+    // Encoded inputs each platform's muxer is fed from. Platforms start only
+    // once the stream for their profile key is set; the audio encoder is
+    // optional and must produce AAC.
+    bool set_video_stream(const std::string& profile_key, const VideoEncoder& encoder);
+    void clear_video_streams();
+    void set_audio_encoder(std::shared_ptr<SharedStreamEncoder> encoder);
+    // Queue, reconnect and timeout settings for senders started from now on
+    void set_sender_options(const RtmpSenderOptions& options);
     
     // Streaming control
     bool start_streaming(const std::string& platform_id);
@@ -130,6 +231,9 @@ public:
     // Stream data
     bool send_video_data(const uint8_t* video_data, size_t video_size,
                         const uint8_t* audio_data, size_t audio_size);
+    // Encoder output by reference (see VideoEncoder::PacketCallback), queued
+    // to every live platform using that profile
+    bool send_video_packet(const std::string& profile_key, const AVPacket* packet);
     
     // Statistics
     struct StreamStats {
@@ -138,6 +242,9 @@ public:
         double current_bitrate = 0.0;
         bool is_connected = false;
         std::string last_error;
+        uint64_t packets_dropped = 0;
+        double queue_ms = 0.0;
+        int reconnects = 0;
     };
     
     StreamStats get_stream_stats(const std::string& platform_id) const;
@@ -180,6 +287,14 @@ public:
     bool start_live_stream(const std::vector<std::string>& platform_ids);
     bool stop_live_stream();
     bool is_live() const;
+    VideoEncoderStats get_encoder_stats() const;
+    VideoPipelineStats get_pipeline_stats() const;
+    
+    // Source of the AAC encoder live streams share: acquired at each
+    // start_live_stream() and released once its platforms have stopped.
+    // Without one the streams carry no audio.
+    using AudioEncoderSource = std::function<std::shared_ptr<SharedStreamEncoder>()>;
+    void set_audio_source(AudioEncoderSource acquire, std::function<void()> release);
     
     // Video source shortcuts
     bool switch_to_camera();
@@ -194,15 +309,19 @@ public:
     bool setup_custom_rtmp(const std::string& rtmp_url, const std::string& stream_key);
     
 private:
-    void video_processing_loop();
+    struct Pipeline;
     
     std::unique_ptr<VideoComposer> composer_;
-    std::unique_ptr<VideoEncoder> encoder_;
+    std::unique_ptr<VideoEncoder> encoder_;                             // current_format_'s profile
+    std::map<std::string, std::unique_ptr<VideoEncoder>> live_encoders_; // Other profiles while live
+    std::vector<std::pair<std::string, VideoEncoder*>> live_profiles_;  // Encoded every frame while live
     std::unique_ptr<SocialMediaStreamer> streamer_;
+    AudioEncoderSource acquire_audio_;
+    std::function<void()> release_audio_;
     
     VideoFormat current_format_;
     bool initialized_;
     bool running_;
-    std::thread processing_thread_;
+    std::unique_ptr<Pipeline> pipeline_;
     mutable std::mutex mutex_;
 };
\ No newline at end of file
@@ -1,22 +1,101 @@
 #pragma once
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
+#include <vector>
+
+class AudioSystem;
+
+/**
+ * Media settings; signalling listens on the port given to the constructor
+ */
+struct WebRTCOptions {
+    std::vector<std::string> ice_servers = {"stun:stun.l.google.com:19302"};
+    uint16_t port_range_begin = 0;      // UDP ports for ICE; 0 and 0 for any
+    uint16_t port_range_end = 0;
+
+    // Program return to every peer that receives audio
+    bool program_return = true;
+    int frame_ms = 10;                  // Opus packet duration: 10 or 20
+    int return_bitrate = 128;           // kbps
+
+    // Contribution jitter buffer: the target delay follows the measured
+    // jitter between these bounds
+    double min_jitter_ms = 10.0;
+    double max_jitter_ms = 200.0;
+};
+
+/**
+ * One peer's media path; latencies are one way, in milliseconds
+ */
+struct WebRTCPeerStats {
+    std::string peer_id;
+    std::string stream_id;
+    std::string state;                  // new, connecting, connected, disconnected, failed, closed
+    std::string input_channel;          // AudioSystem live input, empty until audio arrives
+
+    uint64_t packets_received = 0;
+    uint64_t packets_lost = 0;          // Missing at their playout time; concealed
+    uint64_t packets_late = 0;          // Arrived after their playout time
+    uint64_t packets_recovered = 0;     // Rebuilt from the next packet's FEC
+    uint64_t packets_discarded = 0;     // Dropped to bring the delay back to target
+    uint64_t mixer_underruns = 0;
+    uint64_t packets_sent = 0;
 
+    double rtt_ms = 0.0;                // 0 until the first echo
+    double jitter_ms = 0.0;             // RFC 3550 interarrival jitter
+    double jitter_buffer_ms = 0.0;      // Audio held for this peer right now
+    double jitter_target_ms = 0.0;
+
+    // Components measured here plus what the peer reports of its own side
+    double contribution_latency_ms = 0.0;   // Peer capture to our device output
+    double return_latency_ms = 0.0;         // Our program bus to the peer's speakers
+    double round_trip_latency_ms = 0.0;     // What the peer hears of itself through the station
+};
+
+/**
+ * Browser contribution and monitoring over WebRTC
+ *
+ * Clients signal over a WebSocket as documented in README.md. The media
+ * transport, ICE and DTLS-SRTP, is libdatachannel's; RTP is parsed and
+ * built here. Each peer's Opus contribution goes through an adaptive jitter
+ * buffer and is decoded into its own AudioSystem live input, which mixes
+ * like any channel. The program bus is encoded once, in 10 or 20 ms Opus
+ * frames with the restricted low-delay mode, and sent back to every peer.
+ *
+ * Latency is measured per peer: the round trip by echoing pings over the
+ * peer's "latency" data channel (or the signalling socket without one),
+ * and each buffer along the way by its fill. Peers can include their own
+ * capture and playout delays in the echo to complete the end-to-end figures.
+ */
 class WebRTCServer {
 public:
-    explicit WebRTCServer(int port);
+    // Decoded contribution audio, interleaved at the mixer rate
+    using AudioDataCallback = std::function<void(const std::string& stream_id, const float* samples,
+                                                 size_t frames, int channels)>;
+
+    explicit WebRTCServer(int port, const WebRTCOptions& options = WebRTCOptions());
     ~WebRTCServer();
-    
-    bool initialize();
-    void run();
+
+    WebRTCServer(const WebRTCServer&) = delete;
+    WebRTCServer& operator=(const WebRTCServer&) = delete;
+
+    // Set before start(); without one, peers only signal
+    void set_audio_system(AudioSystem* audio_system);
+    void set_audio_data_callback(AudioDataCallback callback);
+
+    bool start();
     void stop();
-    
-    // WebRTC stream handling
-    void handle_offer(const std::string& offer);
-    std::string create_answer();
-    void add_ice_candidate(const std::string& candidate);
-    
+    bool is_running() const;
+
+    size_t get_connection_count() const;
+    size_t get_streaming_count() const;
+    std::vector<std::string> get_active_streams() const;
+    std::vector<WebRTCPeerStats> get_peer_stats() const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> impl_;
-};
\ No newline at end of file
+};
@@ -0,0 +1,477 @@
+#include "analysis_scheduler.hpp"
+#include "waveform_pyramid.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+const char* analysis_job_state_name(AnalysisJobState state) {
+    switch (state) {
+        case AnalysisJobState::QUEUED:    return "queued";
+        case AnalysisJobState::RUNNING:   return "running";
+        case AnalysisJobState::DONE:      return "done";
+        case AnalysisJobState::FAILED:    return "failed";
+        case AnalysisJobState::CANCELLED: return "cancelled";
+    }
+    return "unknown";
+}
+
+class AnalysisScheduler::Impl {
+public:
+    explicit Impl(const AnalysisSchedulerOptions& options) : options_(options) {}
+
+    ~Impl() {
+        stop();
+    }
+
+    void set_sink(BatchSink sink) {
+        sink_ = std::move(sink);
+    }
+
+    bool start() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) {
+            return true;
+        }
+
+        size_t worker_count = options_.workers;
+        if (worker_count == 0) {
+            const unsigned hardware = std::thread::hardware_concurrency();
+            worker_count = hardware > 1 ? hardware - 1 : 1;
+        }
+
+        if (!options_.waveform_dir.empty()) {
+            std::error_code error;
+            std::filesystem::create_directories(options_.waveform_dir, error);
+        }
+
+        stopping_ = false;
+        writer_stopping_ = false;
+        running_ = true;
+
+        workers_.reserve(worker_count);
+        for (size_t i = 0; i < worker_count; ++i) {
+            workers_.emplace_back([this] { worker_loop(); });
+        }
+        writer_ = std::thread([this] { writer_loop(); });
+
+        Logger::info("AnalysisScheduler: Started " + std::to_string(worker_count) + " workers");
+        return true;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) {
+                return;
+            }
+            stopping_ = true;
+
+            // Queued jobs are forgotten; the library still has them as unanalyzed
+            for (const auto& entry : queue_) {
+                jobs_.erase(std::get<2>(entry));
+            }
+            queue_.clear();
+            for (auto& [track_id, job] : jobs_) {
+                job.control->cancel = true;
+            }
+        }
+        work_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+
+        // Workers are gone, so the writer's last batch has every job that finished
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            writer_stopping_ = true;
+        }
+        writer_cv_.notify_all();
+        writer_.join();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        Logger::info("AnalysisScheduler: Stopped");
+    }
+
+    bool is_running() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return running_ && !stopping_;
+    }
+
+    bool submit(const std::string& track_id, const std::string& file_path, AnalysisPriority priority) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || stopping_) {
+            return false;
+        }
+
+        auto it = jobs_.find(track_id);
+        if (it != jobs_.end()) {
+            Job& job = it->second;
+            if (job.status.state == AnalysisJobState::QUEUED && priority < job.status.priority) {
+                queue_.erase(queue_key(job));
+                job.status.priority = priority;
+                queue_.insert(queue_key(job));
+                dirty_.insert(track_id);
+            }
+            return true;
+        }
+
+        // Deck loads are never refused; the bound is for bulk imports
+        if (priority != AnalysisPriority::DECK && queue_.size() >= options_.max_queued) {
+            return false;
+        }
+
+        Job job;
+        job.status.track_id = track_id;
+        job.status.file_path = file_path;
+        job.status.priority = priority;
+        job.seq = next_seq_++;
+        job.control = std::make_shared<Control>();
+
+        queue_.insert(queue_key(job));
+        jobs_.emplace(track_id, std::move(job));
+        dirty_.insert(track_id);
+
+        work_cv_.notify_one();
+        return true;
+    }
+
+    bool cancel(const std::string& track_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = jobs_.find(track_id);
+        if (it == jobs_.end()) {
+            return false;
+        }
+        cancel_locked(it->second);
+        return true;
+    }
+
+    size_t cancel_all() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::string> track_ids;
+        track_ids.reserve(jobs_.size());
+        for (const auto& [track_id, job] : jobs_) {
+            track_ids.push_back(track_id);
+        }
+        for (const auto& track_id : track_ids) {
+            cancel_locked(jobs_.at(track_id));
+        }
+        return track_ids.size();
+    }
+
+    bool get_job(const std::string& track_id, AnalysisJobStatus& status) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = jobs_.find(track_id);
+        if (it != jobs_.end()) {
+            status = snapshot(it->second);
+            return true;
+        }
+        auto finished = finished_.find(track_id);
+        if (finished != finished_.end()) {
+            status = finished->second;
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<AnalysisJobStatus> get_jobs(size_t offset, size_t limit) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<AnalysisJobStatus> result;
+        result.reserve(std::min(limit, jobs_.size()));
+
+        // Running first, then queued in the order they will run
+        size_t index = 0;
+        auto take = [&](const Job& job) {
+            if (index++ >= offset && result.size() < limit) {
+                result.push_back(snapshot(job));
+            }
+            return result.size() < limit;
+        };
+        for (const auto& [track_id, job] : jobs_) {
+            if (job.status.state == AnalysisJobState::RUNNING && !take(job)) {
+                return result;
+            }
+        }
+        for (const auto& entry : queue_) {
+            if (!take(jobs_.at(std::get<2>(entry)))) {
+                break;
+            }
+        }
+        return result;
+    }
+
+    AnalysisSummary get_summary() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        AnalysisSummary summary;
+        summary.workers = workers_.size();
+        summary.queued = queue_.size();
+        summary.running = jobs_.size() - queue_.size();
+        summary.done = done_count_;
+        summary.failed = failed_count_;
+        summary.cancelled = cancelled_count_;
+        return summary;
+    }
+
+private:
+    struct Control {
+        std::atomic<bool> cancel{false};
+        std::atomic<float> progress{0.0f};
+    };
+
+    struct Job {
+        AnalysisJobStatus status;   // progress lives in control while active
+        uint64_t seq = 0;
+        std::shared_ptr<Control> control;
+    };
+
+    using QueueKey = std::tuple<AnalysisPriority, uint64_t, std::string>;
+
+    static QueueKey queue_key(const Job& job) {
+        return QueueKey(job.status.priority, job.seq, job.status.track_id);
+    }
+
+    static AnalysisJobStatus snapshot(const Job& job) {
+        AnalysisJobStatus status = job.status;
+        status.progress = job.control->progress.load(std::memory_order_relaxed);
+        return status;
+    }
+
+    void cancel_locked(Job& job) {
+        if (job.status.state == AnalysisJobState::RUNNING) {
+            // The worker notices at its next block and reports the cancellation
+            job.control->cancel = true;
+            return;
+        }
+        queue_.erase(queue_key(job));
+        AnalysisJobStatus status = snapshot(job);
+        status.state = AnalysisJobState::CANCELLED;
+        finish_locked(std::move(status));
+    }
+
+    // Moves a job out of the active set and queues its final status for the sink
+    void finish_locked(AnalysisJobStatus status) {
+        const std::string track_id = status.track_id;
+        jobs_.erase(track_id);
+        dirty_.erase(track_id);
+
+        switch (status.state) {
+            case AnalysisJobState::DONE:      ++done_count_; break;
+            case AnalysisJobState::FAILED:    ++failed_count_; break;
+            case AnalysisJobState::CANCELLED: ++cancelled_count_; break;
+            default: break;
+        }
+
+        // History keeps the outcome only; the waveform goes to the sink
+        AnalysisJobStatus history = status;
+        history.waveform.reset();
+        if (finished_.insert_or_assign(track_id, std::move(history)).second) {
+            finished_order_.push_back(track_id);
+        }
+        while (finished_order_.size() > options_.history) {
+            finished_.erase(finished_order_.front());
+            finished_order_.pop_front();
+        }
+
+        pending_.push_back(std::move(status));
+        if (pending_.size() >= options_.batch_size) {
+            writer_cv_.notify_one();
+        }
+    }
+
+    void worker_loop() {
+        // Constructed here so its FFT buffers belong to this thread
+        OneStopRadio::AudioAnalyzer analyzer(options_.analysis);
+        OneStopRadio::WaveformPyramidBuilder pyramid;
+        const bool save_waveforms = !options_.waveform_dir.empty();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            work_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) {
+                return;
+            }
+
+            const std::string track_id = std::get<2>(*queue_.begin());
+            queue_.erase(queue_.begin());
+
+            Job& job = jobs_.at(track_id);
+            job.status.state = AnalysisJobState::RUNNING;
+            dirty_.insert(track_id);
+            const std::string file_path = job.status.file_path;
+            const std::shared_ptr<Control> control = job.control;
+            lock.unlock();
+
+            std::unique_ptr<OneStopRadio::WaveformData> waveform;
+            std::string error;
+            analyzer.set_cancel_flag(&control->cancel);
+            try {
+                waveform = analyzer.analyze_file(file_path, [&control](float progress) {
+                    control->progress.store(progress, std::memory_order_relaxed);
+                }, save_waveforms ? &pyramid : nullptr);
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            analyzer.set_cancel_flag(nullptr);
+
+            std::string waveform_path;
+            if (waveform && save_waveforms) {
+                waveform_path = save_waveform_files(analyzer, pyramid, *waveform, track_id);
+            }
+
+            lock.lock();
+            if (stopping_ && control->cancel) {
+                // Interrupted by stop(), not by a user: leave it unfinished in the sink's records
+                jobs_.erase(track_id);
+                dirty_.erase(track_id);
+                return;
+            }
+            AnalysisJobStatus status = snapshot(jobs_.at(track_id));
+            if (control->cancel) {
+                status.state = AnalysisJobState::CANCELLED;
+            } else if (waveform) {
+                status.state = AnalysisJobState::DONE;
+                status.progress = 1.0f;
+                status.waveform = std::move(waveform);
+                status.waveform_path = std::move(waveform_path);
+            } else {
+                status.state = AnalysisJobState::FAILED;
+                status.error = error.empty() ? "Could not decode " + file_path : error;
+                Logger::warn("AnalysisScheduler: Analysis failed for track " + track_id + ": " + status.error);
+            }
+            finish_locked(std::move(status));
+        }
+    }
+
+    // @return the .osrwf path, or empty if it could not be written
+    std::string save_waveform_files(const OneStopRadio::AudioAnalyzer& analyzer,
+                                    const OneStopRadio::WaveformPyramidBuilder& pyramid,
+                                    const OneStopRadio::WaveformData& waveform,
+                                    const std::string& track_id) const {
+        const std::filesystem::path base = std::filesystem::path(options_.waveform_dir) / track_id;
+        const std::string waveform_path = base.string() + ".osrwf";
+
+        if (!pyramid.write(base.string() + ".osrwp")) {
+            Logger::warn("AnalysisScheduler: Failed to write waveform pyramid for track " + track_id);
+        }
+        if (!analyzer.export_to_binary(waveform, waveform_path)) {
+            Logger::warn("AnalysisScheduler: Failed to write waveform for track " + track_id);
+            return "";
+        }
+        return waveform_path;
+    }
+
+    void writer_loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            writer_cv_.wait_for(lock, options_.flush_interval, [this] {
+                return writer_stopping_ || pending_.size() >= options_.batch_size;
+            });
+            const bool last = writer_stopping_;
+
+            std::vector<AnalysisJobStatus> updates = std::move(pending_);
+            pending_.clear();
+            for (const auto& [track_id, job] : jobs_) {
+                if (job.status.state == AnalysisJobState::RUNNING || dirty_.count(track_id)) {
+                    updates.push_back(snapshot(job));
+                }
+            }
+            dirty_.clear();
+
+            if (!updates.empty() && sink_) {
+                lock.unlock();
+                try {
+                    sink_(updates);
+                } catch (const std::exception& e) {
+                    Logger::error(std::string("AnalysisScheduler: Sink failed: ") + e.what());
+                }
+                lock.lock();
+            }
+
+            if (last) {
+                return;
+            }
+        }
+    }
+
+    const AnalysisSchedulerOptions options_;
+    BatchSink sink_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable writer_cv_;
+
+    std::unordered_map<std::string, Job> jobs_;         // Queued and running
+    std::set<QueueKey> queue_;
+    std::unordered_set<std::string> dirty_;             // Queued or started since the last batch
+    std::vector<AnalysisJobStatus> pending_;            // Finished since the last batch
+    std::unordered_map<std::string, AnalysisJobStatus> finished_;
+    std::deque<std::string> finished_order_;
+    uint64_t next_seq_ = 0;
+
+    uint64_t done_count_ = 0;
+    uint64_t failed_count_ = 0;
+    uint64_t cancelled_count_ = 0;
+
+    bool running_ = false;
+    bool stopping_ = false;
+    bool writer_stopping_ = false;
+    std::vector<std::thread> workers_;
+    std::thread writer_;
+};
+
+AnalysisScheduler::AnalysisScheduler(const AnalysisSchedulerOptions& options)
+    : impl_(std::make_unique<Impl>(options)) {}
+
+AnalysisScheduler::~AnalysisScheduler() = default;
+
+void AnalysisScheduler::set_sink(BatchSink sink) {
+    impl_->set_sink(std::move(sink));
+}
+
+bool AnalysisScheduler::start() {
+    return impl_->start();
+}
+
+void AnalysisScheduler::stop() {
+    impl_->stop();
+}
+
+bool AnalysisScheduler::is_running() const {
+    return impl_->is_running();
+}
+
+bool AnalysisScheduler::submit(const std::string& track_id, const std::string& file_path,
+                               AnalysisPriority priority) {
+    return impl_->submit(track_id, file_path, priority);
+}
+
+bool AnalysisScheduler::cancel(const std::string& track_id) {
+    return impl_->cancel(track_id);
+}
+
+size_t AnalysisScheduler::cancel_all() {
+    return impl_->cancel_all();
+}
+
+bool AnalysisScheduler::get_job(const std::string& track_id, AnalysisJobStatus& status) const {
+    return impl_->get_job(track_id, status);
+}
+
+std::vector<AnalysisJobStatus> AnalysisScheduler::get_jobs(size_t offset, size_t limit) const {
+    return impl_->get_jobs(offset, limit);
+}
+
+AnalysisSummary AnalysisScheduler::get_summary() const {
+    return impl_->get_summary();
+}
@@ -1,6 +1,11 @@
 #include "audio_analyzer.hpp"
+#include "audio_decoder.hpp"
+#include "fft_plan_registry.hpp"
+#include "waveform_pyramid.hpp"
+#include "beat_tracker.hpp"
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -9,6 +14,7 @@
 
 namespace OneStopRadio {
 
+
 AudioAnalyzer::AudioAnalyzer(const AnalysisConfig& config)
     : config_(config)
     , fft_input_(nullptr)
@@ -35,21 +41,13 @@ void AudioAnalyzer::initialize_fft(uint32_t window_size) {
     fft_input_ = fftwf_alloc_real(fft_size_);
     fft_output_ = fftwf_alloc_complex(fft_size_ / 2 + 1);
     
-    fft_plan_ = fftwf_plan_dft_r2c_1d(
-        fft_size_,
-        fft_input_,
-        fft_output_,
-        FFTW_ESTIMATE
-    );
+    fft_plan_ = FftPlanRegistry::instance().real_forward(fft_size_, config_.fft_planner_flags);
     
     generate_window(fft_size_);
 }
 
 void AudioAnalyzer::cleanup_fft() {
-    if (fft_plan_) {
-        fftwf_destroy_plan(fft_plan_);
-        fft_plan_ = nullptr;
-    }
+    fft_plan_ = nullptr;
     
     if (fft_input_) {
         fftwf_free(fft_input_);
@@ -95,60 +93,103 @@ uint32_t AudioAnalyzer::calculate_window_size(uint32_t total_samples, uint32_t t
 
 std::unique_ptr<WaveformData> AudioAnalyzer::analyze_file(
     const std::string& file_path,
-    std::function<void(float)> progress_callback
+    std::function<void(float)> progress_callback,
+    WaveformPyramidBuilder* pyramid
 ) {
-    // Open audio file using libsndfile
-    SF_INFO sf_info;
-    std::memset(&sf_info, 0, sizeof(sf_info));
-    
-    SNDFILE* sf_file = sf_open(file_path.c_str(), SFM_READ, &sf_info);
-    if (!sf_file) {
+    // Decode at the file's own rate; libsndfile or FFmpeg, whichever reads it
+    std::unique_ptr<AudioDecoder> decoder = AudioDecoder::open(file_path);
+    if (!decoder) {
         std::cerr << "Failed to open audio file: " << file_path << std::endl;
-        std::cerr << "libsndfile error: " << sf_strerror(nullptr) << std::endl;
         return nullptr;
     }
     
-    // Read entire file into memory (for offline analysis)
-    std::vector<float> samples(sf_info.frames * sf_info.channels);
-    sf_count_t frames_read = sf_readf_float(sf_file, samples.data(), sf_info.frames);
-    sf_close(sf_file);
+    const AudioDecoderInfo& info = decoder->info();
+    const uint32_t total_samples = static_cast<uint32_t>(info.frames);
+    const int channels = info.channels;
+    auto result = begin_analysis(total_samples, info.sample_rate, 1);
+    if (!result) {
+        return nullptr;
+    }
     
-    if (frames_read != sf_info.frames) {
-        std::cerr << "Warning: Only read " << frames_read << " of " << sf_info.frames << " frames" << std::endl;
+    if (pyramid) {
+        pyramid->reset(info.sample_rate, channels);
     }
     
-    // Convert to mono by averaging channels
-    std::vector<float> mono_samples;
-    if (sf_info.channels == 1) {
-        mono_samples = std::move(samples);
-    } else {
-        mono_samples.resize(sf_info.frames);
-        for (sf_count_t i = 0; i < sf_info.frames; ++i) {
-            float sum = 0.0f;
-            for (int ch = 0; ch < sf_info.channels; ++ch) {
-                sum += samples[i * sf_info.channels + ch];
+    const uint32_t window_size = result->window_size;
+    const uint32_t hop_size = result->hop_size;
+    const size_t block_frames = std::max<uint32_t>(config_.stream_block_frames, 1);
+    
+    // mono holds samples [mono_base, mono_base + mono.size()) of the downmix;
+    // everything before the next window's start has been dropped
+    std::vector<float> block(block_frames * channels);
+    std::vector<float> mono;
+    mono.reserve(window_size + block_frames);
+    uint64_t mono_base = 0;
+    uint64_t decoded = 0;
+    uint64_t next_window = 0;
+    float global_peak = 0.0f;
+    bool short_read_reported = false;
+    auto beats = make_beat_tracker(info.sample_rate);
+    
+    while (decoded < total_samples) {
+        if (is_cancelled()) {
+            return nullptr;
+        }
+        
+        const size_t wanted = static_cast<size_t>(std::min<uint64_t>(block_frames, total_samples - decoded));
+        const size_t got = decoder->read(block.data(), wanted);
+        if (got < wanted) {
+            // Same as the whole-file read: frames the decoder did not deliver are silence.
+            // FFmpeg lengths come from the container, so a slight shortfall is expected there
+            if (!short_read_reported && info.backend == AudioDecoderBackend::SNDFILE) {
+                std::cerr << "Warning: Only read " << decoded + got << " of " << info.frames << " frames" << std::endl;
+                short_read_reported = true;
             }
-            mono_samples[i] = sum / sf_info.channels;
+            std::fill(block.begin() + got * channels, block.begin() + wanted * channels, 0.0f);
+        }
+        
+        if (pyramid) {
+            pyramid->add(block.data(), wanted);
         }
+        
+        // Convert to mono by averaging channels
+        if (channels == 1) {
+            mono.insert(mono.end(), block.begin(), block.begin() + wanted);
+        } else {
+            for (size_t i = 0; i < wanted; ++i) {
+                float sum = 0.0f;
+                for (int ch = 0; ch < channels; ++ch) {
+                    sum += block[i * channels + ch];
+                }
+                mono.push_back(sum / channels);
+            }
+        }
+        decoded += wanted;
+        if (beats) {
+            beats->process(mono.data() + mono.size() - wanted, wanted);
+        }
+        
+        // Run every window that is now complete
+        while (next_window + window_size <= mono_base + mono.size()) {
+            analyze_next_window(*result, &mono[next_window - mono_base], static_cast<uint32_t>(next_window),
+                                global_peak, progress_callback);
+            next_window += hop_size;
+        }
+        
+        // Keep only the overlap the next window needs
+        const uint64_t keep_from = std::min<uint64_t>(next_window, mono_base + mono.size());
+        mono.erase(mono.begin(), mono.begin() + (keep_from - mono_base));
+        mono_base = keep_from;
     }
     
-    // Analyze the mono samples
-    auto result = analyze_samples(
-        mono_samples.data(),
-        mono_samples.size(),
-        sf_info.samplerate,
-        1,
-        progress_callback
-    );
+    finish_analysis(*result, global_peak, progress_callback);
+    finish_beat_tracking(*result, beats.get());
+    result->file_path = file_path;
     
-    if (result) {
-        result->file_path = file_path;
-        
-        // Get file size
-        std::ifstream file(file_path, std::ios::binary | std::ios::ate);
-        if (file.good()) {
-            result->file_size = file.tellg();
-        }
+    // Get file size
+    std::ifstream file(file_path, std::ios::binary | std::ios::ate);
+    if (file.good()) {
+        result->file_size = file.tellg();
     }
     
     return result;
@@ -161,7 +202,61 @@ std::unique_ptr<WaveformData> AudioAnalyzer::analyze_samples(
     uint32_t channels,
     std::function<void(float)> progress_callback
 ) {
-    if (!samples || num_samples == 0 || sample_rate == 0) {
+    if (!samples) {
+        return nullptr;
+    }
+    
+    auto waveform = begin_analysis(num_samples, sample_rate, channels);
+    if (!waveform) {
+        return nullptr;
+    }
+    
+    // Process audio in overlapping windows
+    float global_peak = 0.0f;
+    const uint32_t window_size = waveform->window_size;
+    for (uint32_t i = 0; i + window_size <= num_samples; i += waveform->hop_size) {
+        if (is_cancelled()) {
+            return nullptr;
+        }
+        analyze_next_window(*waveform, &samples[i], i, global_peak, progress_callback);
+    }
+    
+    finish_analysis(*waveform, global_peak, progress_callback);
+    if (auto beats = make_beat_tracker(sample_rate)) {
+        beats->process(samples, num_samples);
+        finish_beat_tracking(*waveform, beats.get());
+    }
+    return waveform;
+}
+
+std::unique_ptr<BeatTracker> AudioAnalyzer::make_beat_tracker(uint32_t sample_rate) const {
+    if (!config_.enable_beat_tracking || sample_rate == 0) {
+        return nullptr;
+    }
+    
+    BeatTrackerOptions options;
+    options.mode = BeatTrackerMode::OFFLINE;
+    options.sample_rate = static_cast<int>(sample_rate);
+    return std::make_unique<BeatTracker>(options);
+}
+
+void AudioAnalyzer::finish_beat_tracking(WaveformData& waveform, BeatTracker* beats) const {
+    if (!beats) {
+        return;
+    }
+    
+    const BeatGrid grid = beats->finish();
+    waveform.bpm = grid.bpm;
+    waveform.bpm_confidence = grid.confidence;
+    waveform.beat_time = grid.beat_time;
+}
+
+std::unique_ptr<WaveformData> AudioAnalyzer::begin_analysis(
+    uint32_t num_samples,
+    uint32_t sample_rate,
+    uint32_t channels
+) {
+    if (num_samples == 0 || sample_rate == 0) {
         return nullptr;
     }
     
@@ -170,6 +265,7 @@ std::unique_ptr<WaveformData> AudioAnalyzer::analyze_samples(
     waveform->sample_rate = sample_rate;
     waveform->channels = channels;
     waveform->total_samples = num_samples;
+    waveform->file_size = 0;
     
     // Calculate optimal window and hop sizes
     uint32_t window_size = calculate_window_size(num_samples, config_.target_points);
@@ -183,55 +279,63 @@ std::unique_ptr<WaveformData> AudioAnalyzer::analyze_samples(
     initialize_fft(window_size);
     
     // Reserve space for waveform points
-    uint32_t estimated_points = (num_samples - window_size) / hop_size + 1;
-    waveform->points.reserve(estimated_points);
+    if (num_samples >= window_size) {
+        waveform->points.reserve((num_samples - window_size) / hop_size + 1);
+    }
     
-    // Process audio in overlapping windows
-    float global_peak = 0.0f;
-    uint32_t processed_samples = 0;
+    return waveform;
+}
+
+void AudioAnalyzer::analyze_next_window(
+    WaveformData& waveform,
+    const float* window_samples,
+    uint32_t sample_index,
+    float& global_peak,
+    const std::function<void(float)>& progress_callback
+) {
+    // Calculate timestamp and process this window
+    double timestamp = static_cast<double>(sample_index) / waveform.sample_rate;
+    WaveformPoint point = process_window(
+        window_samples,
+        waveform.window_size,
+        waveform.sample_rate,
+        timestamp,
+        sample_index
+    );
     
-    for (uint32_t i = 0; i + window_size <= num_samples; i += hop_size) {
-        // Calculate timestamp and sample index
-        double timestamp = static_cast<double>(i) / sample_rate;
-        
-        // Process this window
-        WaveformPoint point = process_window(
-            &samples[i],
-            window_size,
-            sample_rate,
-            timestamp,
-            i
-        );
-        
-        waveform->points.push_back(point);
-        
-        // Track global peak
-        global_peak = std::max(global_peak, point.peak_amplitude);
-        
-        // Update progress
-        processed_samples = i + window_size;
-        if (progress_callback && (waveform->points.size() % 100) == 0) {
-            float progress = static_cast<float>(processed_samples) / num_samples;
-            progress_callback(std::min(progress, 1.0f));
-        }
-    }
+    waveform.points.push_back(point);
     
-    waveform->global_peak = global_peak;
+    // Track global peak
+    global_peak = std::max(global_peak, point.peak_amplitude);
+    
+    // Update progress
+    if (progress_callback && (waveform.points.size() % 100) == 0) {
+        uint32_t processed_samples = sample_index + waveform.window_size;
+        float progress = static_cast<float>(processed_samples) / waveform.total_samples;
+        progress_callback(std::min(progress, 1.0f));
+    }
+}
+
+void AudioAnalyzer::finish_analysis(
+    WaveformData& waveform,
+    float global_peak,
+    const std::function<void(float)>& progress_callback
+) const {
+    waveform.global_peak = global_peak;
     
     // Normalize waveform if requested
     if (config_.normalize_amplitude) {
-        normalize_waveform(*waveform);
+        normalize_waveform(waveform);
     }
     
     // Calculate dynamic range
-    waveform->dynamic_range = calculate_dynamic_range(*waveform);
+    waveform.dynamic_range = calculate_dynamic_range(waveform);
+    waveform.energy = calculate_energy(waveform);
     
     // Final progress update
     if (progress_callback) {
         progress_callback(1.0f);
     }
-    
-    return waveform;
 }
 
 WaveformPoint AudioAnalyzer::process_window(
@@ -306,7 +410,7 @@ void AudioAnalyzer::analyze_frequency_content(
     }
     
     // Perform FFT
-    fftwf_execute(fft_plan_);
+    fftwf_execute_dft_r2c(fft_plan_, fft_input_, fft_output_);
     
     // Calculate frequency bin size
     float bin_size = static_cast<float>(sample_rate) / size;
@@ -395,6 +499,37 @@ float AudioAnalyzer::calculate_dynamic_range(const WaveformData& waveform) const
     return max_db - min_db;
 }
 
+// Relative intensity for matching tracks, not a calibrated loudness: dense
+// (loud against the peak), busy (RMS moving from point to point) and bright
+// (high-band share) tracks score higher
+float AudioAnalyzer::calculate_energy(const WaveformData& waveform) const {
+    if (waveform.points.size() < 2 || waveform.global_peak <= 0.0f) {
+        return 0.0f;
+    }
+    
+    double level = 0.0;
+    double movement = 0.0;
+    double brightness = 0.0;
+    for (size_t i = 0; i < waveform.points.size(); ++i) {
+        const WaveformPoint& point = waveform.points[i];
+        level += point.amplitude;
+        if (i > 0) {
+            movement += std::fabs(point.amplitude - waveform.points[i - 1].amplitude);
+        }
+        const float bands = point.low_freq + point.mid_freq + point.high_freq;
+        if (bands > 0.0f) {
+            brightness += point.high_freq / bands;
+        }
+    }
+    const double count = static_cast<double>(waveform.points.size());
+    level /= count * waveform.global_peak;
+    movement = level > 0.0 ? movement / (count * waveform.global_peak * level) : 0.0;
+    brightness /= count;
+    
+    const double energy = 0.5 * std::min(2.0 * level, 1.0) + 0.3 * std::min(movement, 1.0) + 0.2 * brightness;
+    return static_cast<float>(std::clamp(energy, 0.0, 1.0));
+}
+
 float AudioAnalyzer::amplitude_to_db(float amplitude) const {
     if (amplitude <= 0.0f) {
         return config_.noise_floor;
@@ -418,6 +553,10 @@ std::string AudioAnalyzer::export_to_json(const WaveformData& waveform) const {
     metadata["total_samples"] = waveform.total_samples;
     metadata["global_peak"] = waveform.global_peak;
     metadata["dynamic_range"] = waveform.dynamic_range;
+    metadata["energy"] = waveform.energy;
+    metadata["bpm"] = waveform.bpm;
+    metadata["bpm_confidence"] = waveform.bpm_confidence;
+    metadata["beat_time"] = waveform.beat_time;
     metadata["file_path"] = waveform.file_path;
     metadata["file_size"] = static_cast<Json::UInt64>(waveform.file_size);
     metadata["window_size"] = waveform.window_size;
@@ -544,16 +683,8 @@ std::vector<std::string> get_supported_formats() {
 }
 
 bool is_valid_audio_file(const std::string& file_path) {
-    SF_INFO sf_info;
-    std::memset(&sf_info, 0, sizeof(sf_info));
-    
-    SNDFILE* sf_file = sf_open(file_path.c_str(), SFM_READ, &sf_info);
-    if (!sf_file) {
-        return false;
-    }
-    
-    sf_close(sf_file);
-    return sf_info.frames > 0 && sf_info.samplerate > 0;
+    std::unique_ptr<AudioDecoder> decoder = AudioDecoder::open(file_path);
+    return decoder && decoder->info().frames > 0 && decoder->info().sample_rate > 0;
 }
 
 } // namespace OneStopRadio
\ No newline at end of file
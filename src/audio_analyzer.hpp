@@ -1,14 +1,18 @@
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include <string>
 #include <memory>
 #include <complex>
+#include <functional>
 #include <fftw3.h>
-#include <sndfile.h>
 
 namespace OneStopRadio {
 
+class WaveformPyramidBuilder;
+class BeatTracker;
+
 /**
  * Waveform data point containing amplitude and frequency information
  */
@@ -34,6 +38,7 @@ struct WaveformData {
     uint32_t total_samples;  // Total samples in track
     float global_peak;       // Global peak amplitude
     float dynamic_range;     // Dynamic range (dB)
+    float energy = 0.0f;     // Perceived intensity, 0.0 - 1.0 (see calculate_energy)
     std::string file_path;   // Source file path
     uint64_t file_size;      // File size in bytes
     
@@ -41,6 +46,11 @@ struct WaveformData {
     uint32_t window_size;    // Analysis window size (samples)
     uint32_t hop_size;       // Hop size between windows
     double resolution;       // Time resolution per point (seconds)
+    
+    // Beat grid (enable_beat_tracking); bpm is 0 when no steady tempo was found
+    float bpm = 0.0f;
+    float bpm_confidence = 0.0f;  // 0.0 - 1.0
+    double beat_time = 0.0;       // First beat (seconds)
 };
 
 /**
@@ -57,6 +67,17 @@ struct AnalysisConfig {
     // Frequency band definitions (Hz)
     float low_freq_cutoff = 250.0f;
     float mid_freq_cutoff = 4000.0f;
+    
+    // Estimate tempo and first beat in the same pass (see BeatTracker)
+    bool enable_beat_tracking = true;
+    
+    // FFTW planner flags; plans come from FftPlanRegistry, so FFTW_MEASURE
+    // is paid once per size and process, or never once wisdom is saved
+    unsigned fft_planner_flags = FFTW_MEASURE;
+    
+    // Frames decoded per read when analyzing files; memory use is about
+    // (stream_block_frames * channels + window size) floats whatever the track length
+    uint32_t stream_block_frames = 16384;
 };
 
 /**
@@ -69,13 +90,21 @@ public:
     
     /**
      * Analyze audio file and generate waveform data
+     *
+     * The file is decoded and downmixed in blocks of stream_block_frames,
+     * keeping only the samples the next window still needs. The result is
+     * identical to analyze_samples() on the whole mono downmix.
+     *
      * @param file_path Path to audio file (supports WAV, FLAC, MP3, etc.)
      * @param progress_callback Optional callback for progress updates (0.0 - 1.0)
+     * @param pyramid Optional; reset and fed every decoded block, so the
+     *        display pyramid is built in the same pass
      * @return Waveform analysis data or nullptr on failure
      */
     std::unique_ptr<WaveformData> analyze_file(
         const std::string& file_path,
-        std::function<void(float)> progress_callback = nullptr
+        std::function<void(float)> progress_callback = nullptr,
+        WaveformPyramidBuilder* pyramid = nullptr
     );
     
     /**
@@ -103,11 +132,19 @@ public:
      * Load waveform data from binary format
      */
     std::unique_ptr<WaveformData> load_from_binary(const std::string& file_path) const;
+    
+    /**
+     * Abort analysis when *flag becomes true; analyze_file() and
+     * analyze_samples() then return nullptr. Checked once per decoded block
+     * and per window. Pass nullptr to clear.
+     */
+    void set_cancel_flag(const std::atomic<bool>* flag) { cancel_flag_ = flag; }
 
 private:
     AnalysisConfig config_;
+    const std::atomic<bool>* cancel_flag_ = nullptr;
     
-    // FFTW resources
+    // FFTW resources; the plan is shared and owned by FftPlanRegistry
     float* fft_input_;
     fftwf_complex* fft_output_;
     fftwf_plan fft_plan_;
@@ -126,11 +163,39 @@ private:
      */
     void cleanup_fft();
     
+    bool is_cancelled() const {
+        return cancel_flag_ && cancel_flag_->load(std::memory_order_relaxed);
+    }
+    
     /**
      * Generate Hanning window function
      */
     void generate_window(uint32_t size);
     
+    /**
+     * Create the result for a track of num_samples mono samples, choose the
+     * window and hop sizes and prepare the FFT for them
+     */
+    std::unique_ptr<WaveformData> begin_analysis(uint32_t num_samples, uint32_t sample_rate, uint32_t channels);
+    
+    /**
+     * Analyze the window starting at sample_index and report progress
+     */
+    void analyze_next_window(WaveformData& waveform, const float* window_samples, uint32_t sample_index,
+                             float& global_peak, const std::function<void(float)>& progress_callback);
+    
+    /**
+     * Set the global peak, normalize and compute the dynamic range
+     */
+    void finish_analysis(WaveformData& waveform, float global_peak,
+                         const std::function<void(float)>& progress_callback) const;
+    
+    /**
+     * Offline beat tracker for the track, or nullptr when beat tracking is disabled
+     */
+    std::unique_ptr<BeatTracker> make_beat_tracker(uint32_t sample_rate) const;
+    void finish_beat_tracking(WaveformData& waveform, BeatTracker* beats) const;
+    
     /**
      * Calculate optimal window size based on track length and target points
      */
@@ -189,6 +254,7 @@ private:
      * Calculate dynamic range
      */
     float calculate_dynamic_range(const WaveformData& waveform) const;
+    float calculate_energy(const WaveformData& waveform) const;
 };
 
 /**
@@ -0,0 +1,379 @@
+#include "audio_decoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sndfile.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libswresample/swresample.h>
+}
+
+namespace OneStopRadio {
+
+namespace {
+
+constexpr size_t kSndfileBlockFrames = 4096;
+
+// Rounds down; frames * rate stays far inside 64 bits for any real track
+uint64_t rescale(uint64_t value, int to_rate, int from_rate) {
+    return value * static_cast<uint64_t>(to_rate) / static_cast<uint64_t>(from_rate);
+}
+
+class SndfileDecoder : public AudioDecoder {
+public:
+    static std::unique_ptr<AudioDecoder> open(const std::string& file_path, int sample_rate) {
+        SF_INFO sf_info;
+        std::memset(&sf_info, 0, sizeof(sf_info));
+        SNDFILE* file = sf_open(file_path.c_str(), SFM_READ, &sf_info);
+        if (!file) {
+            return nullptr;
+        }
+        if (sf_info.frames <= 0 || sf_info.samplerate <= 0 || sf_info.channels <= 0) {
+            sf_close(file);
+            return nullptr;
+        }
+
+        std::unique_ptr<SndfileDecoder> decoder(new SndfileDecoder(file_path, file));
+        AudioDecoderInfo& info = decoder->info_;
+        info.backend = AudioDecoderBackend::SNDFILE;
+        info.source_sample_rate = sf_info.samplerate;
+        info.sample_rate = sample_rate > 0 ? sample_rate : sf_info.samplerate;
+        info.channels = sf_info.channels;
+        info.frames = rescale(static_cast<uint64_t>(sf_info.frames), info.sample_rate, info.source_sample_rate);
+
+        if (!decoder->init_resampler(AV_SAMPLE_FMT_FLT)) {
+            return nullptr;
+        }
+        decoder->block_.resize(kSndfileBlockFrames * sf_info.channels);
+        return decoder;
+    }
+
+    ~SndfileDecoder() override {
+        sf_close(file_);
+    }
+
+protected:
+    bool decode_more(std::vector<float>& out) override {
+        const sf_count_t got = sf_readf_float(file_, block_.data(), static_cast<sf_count_t>(kSndfileBlockFrames));
+        if (got <= 0) {
+            return false;
+        }
+        const uint8_t* input = reinterpret_cast<const uint8_t*>(block_.data());
+        return convert(&input, static_cast<int>(got), out);
+    }
+
+    bool seek_source(uint64_t source_frame) override {
+        return sf_seek(file_, static_cast<sf_count_t>(source_frame), SEEK_SET) >= 0;
+    }
+
+private:
+    SndfileDecoder(const std::string& file_path, SNDFILE* file)
+        : AudioDecoder(file_path), file_(file) {}
+
+    SNDFILE* file_;
+    std::vector<float> block_;
+};
+
+class FfmpegDecoder : public AudioDecoder {
+public:
+    static std::unique_ptr<AudioDecoder> open(const std::string& file_path, int sample_rate) {
+        std::unique_ptr<FfmpegDecoder> decoder(new FfmpegDecoder(file_path));
+        if (!decoder->open_stream()) {
+            return nullptr;
+        }
+
+        AudioDecoderInfo& info = decoder->info_;
+        const AVCodecContext* codec = decoder->codec_;
+        info.backend = AudioDecoderBackend::FFMPEG;
+        info.source_sample_rate = codec->sample_rate;
+        info.sample_rate = sample_rate > 0 ? sample_rate : codec->sample_rate;
+        info.channels = codec->channels;
+
+        const AVStream* stream = decoder->format_->streams[decoder->stream_index_];
+        double duration = 0.0;
+        if (stream->duration != AV_NOPTS_VALUE) {
+            duration = stream->duration * av_q2d(stream->time_base);
+        } else if (decoder->format_->duration != AV_NOPTS_VALUE) {
+            duration = static_cast<double>(decoder->format_->duration) / AV_TIME_BASE;
+        }
+        info.frames = static_cast<uint64_t>(std::llround(std::max(duration, 0.0) * info.sample_rate));
+        if (info.frames == 0) {
+            return nullptr;     // Live streams and files without a duration can't be cached
+        }
+
+        if (!decoder->init_resampler(codec->sample_fmt)) {
+            return nullptr;
+        }
+        return decoder;
+    }
+
+    ~FfmpegDecoder() override {
+        av_frame_free(&frame_);
+        av_packet_free(&packet_);
+        avcodec_free_context(&codec_);
+        avformat_close_input(&format_);
+    }
+
+protected:
+    bool decode_more(std::vector<float>& out) override {
+        while (true) {
+            const int received = avcodec_receive_frame(codec_, frame_);
+            if (received == 0) {
+                const bool ok = convert_frame(out);
+                av_frame_unref(frame_);
+                if (!ok) {
+                    return false;
+                }
+                if (!out.empty()) {
+                    return true;
+                }
+                continue;   // Frame was before the seek target
+            }
+            if (received != AVERROR(EAGAIN)) {
+                return false;   // AVERROR_EOF once the decoder is drained
+            }
+
+            const int read = av_read_frame(format_, packet_);
+            if (read < 0) {
+                // End of file: drain the frames the decoder still holds
+                if (avcodec_send_packet(codec_, nullptr) < 0) {
+                    return false;
+                }
+                continue;
+            }
+            if (packet_->stream_index == stream_index_) {
+                const int sent = avcodec_send_packet(codec_, packet_);
+                if (sent < 0 && sent != AVERROR_INVALIDDATA) {
+                    av_packet_unref(packet_);
+                    return false;
+                }
+            }
+            av_packet_unref(packet_);
+        }
+    }
+
+    bool seek_source(uint64_t source_frame) override {
+        const AVStream* stream = format_->streams[stream_index_];
+        const int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        const int64_t timestamp = start + av_rescale_q(static_cast<int64_t>(source_frame),
+                                                       AVRational{1, info_.source_sample_rate}, stream->time_base);
+        if (av_seek_frame(format_, stream_index_, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
+            return false;
+        }
+        avcodec_flush_buffers(codec_);
+
+        // Seeks land on the packet before the target; drop up to the exact frame
+        seek_target_ = static_cast<int64_t>(source_frame);
+        return true;
+    }
+
+private:
+    explicit FfmpegDecoder(const std::string& file_path) : AudioDecoder(file_path) {}
+
+    bool open_stream() {
+        if (avformat_open_input(&format_, file_path().c_str(), nullptr, nullptr) < 0) {
+            return false;
+        }
+        if (avformat_find_stream_info(format_, nullptr) < 0) {
+            return false;
+        }
+
+        const AVCodec* decoder = nullptr;
+        stream_index_ = av_find_best_stream(format_, AVMEDIA_TYPE_AUDIO, -1, -1, &decoder, 0);
+        if (stream_index_ < 0 || !decoder) {
+            return false;
+        }
+
+        codec_ = avcodec_alloc_context3(decoder);
+        if (!codec_ || avcodec_parameters_to_context(codec_, format_->streams[stream_index_]->codecpar) < 0) {
+            return false;
+        }
+        if (avcodec_open2(codec_, decoder, nullptr) < 0) {
+            return false;
+        }
+        if (codec_->sample_rate <= 0 || codec_->channels <= 0) {
+            return false;
+        }
+
+        packet_ = av_packet_alloc();
+        frame_ = av_frame_alloc();
+        return packet_ && frame_;
+    }
+
+    bool convert_frame(std::vector<float>& out) {
+        int skip = 0;
+        if (seek_target_ >= 0) {
+            const int64_t timestamp = frame_->best_effort_timestamp;
+            if (timestamp == AV_NOPTS_VALUE) {
+                seek_target_ = -1;
+            } else {
+                const AVStream* stream = format_->streams[stream_index_];
+                const int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+                const int64_t first = av_rescale_q(timestamp - start, stream->time_base,
+                                                   AVRational{1, info_.source_sample_rate});
+                if (first + frame_->nb_samples <= seek_target_) {
+                    return true;
+                }
+                skip = static_cast<int>(std::clamp<int64_t>(seek_target_ - first, 0, frame_->nb_samples));
+                seek_target_ = -1;
+            }
+        }
+
+        // Offset every plane, or the single interleaved buffer, past the skipped frames
+        const AVSampleFormat format = static_cast<AVSampleFormat>(frame_->format);
+        const int bytes = av_get_bytes_per_sample(format);
+        const bool planar = av_sample_fmt_is_planar(format) != 0;
+        const int planes = planar ? codec_->channels : 1;
+        const size_t offset = static_cast<size_t>(skip) * bytes * (planar ? 1 : codec_->channels);
+        plane_pointers_.resize(planes);
+        for (int p = 0; p < planes; ++p) {
+            plane_pointers_[p] = frame_->extended_data[p] + offset;
+        }
+        return convert(plane_pointers_.data(), frame_->nb_samples - skip, out);
+    }
+
+    AVFormatContext* format_ = nullptr;
+    AVCodecContext* codec_ = nullptr;
+    AVPacket* packet_ = nullptr;
+    AVFrame* frame_ = nullptr;
+    int stream_index_ = -1;
+    int64_t seek_target_ = -1;              // Source frame, while dropping frames after a seek
+    std::vector<const uint8_t*> plane_pointers_;
+};
+
+} // namespace
+
+std::unique_ptr<AudioDecoder> AudioDecoder::open(const std::string& file_path, int sample_rate) {
+    if (auto decoder = SndfileDecoder::open(file_path, sample_rate)) {
+        return decoder;
+    }
+    if (auto decoder = FfmpegDecoder::open(file_path, sample_rate)) {
+        return decoder;
+    }
+    std::cerr << "AudioDecoder: No decoder for " << file_path << std::endl;
+    return nullptr;
+}
+
+AudioDecoder::AudioDecoder(std::string file_path) : file_path_(std::move(file_path)) {}
+
+AudioDecoder::~AudioDecoder() {
+    swr_free(&resampler_);
+}
+
+bool AudioDecoder::init_resampler(int format) {
+    input_format_ = format;
+    if (format == AV_SAMPLE_FMT_FLT && info_.sample_rate == info_.source_sample_rate) {
+        return true;    // Already interleaved float at the output rate
+    }
+
+    const int64_t layout = av_get_default_channel_layout(info_.channels);
+    resampler_ = swr_alloc_set_opts(nullptr, layout, AV_SAMPLE_FMT_FLT, info_.sample_rate,
+                                    layout, static_cast<AVSampleFormat>(format), info_.source_sample_rate,
+                                    0, nullptr);
+    if (!resampler_) {
+        return false;
+    }
+
+    // Interpolating between filter phases costs little and removes the
+    // phase-quantisation noise of the default resampler
+    av_opt_set_int(resampler_, "linear_interp", 1, 0);
+    av_opt_set_int(resampler_, "filter_size", 32, 0);
+    if (swr_init(resampler_) < 0) {
+        swr_free(&resampler_);
+        return false;
+    }
+    return true;
+}
+
+bool AudioDecoder::convert(const uint8_t* const* input, int frames, std::vector<float>& out) {
+    const size_t channels = static_cast<size_t>(info_.channels);
+    if (!resampler_) {
+        if (input) {
+            const float* samples = reinterpret_cast<const float*>(input[0]);
+            out.insert(out.end(), samples, samples + static_cast<size_t>(frames) * channels);
+        }
+        return true;
+    }
+
+    const int capacity = swr_get_out_samples(resampler_, input ? frames : 0);
+    if (capacity <= 0) {
+        return capacity == 0;
+    }
+    const size_t used = out.size();
+    out.resize(used + static_cast<size_t>(capacity) * channels);
+    uint8_t* output = reinterpret_cast<uint8_t*>(out.data() + used);
+    const int converted = swr_convert(resampler_, &output, capacity,
+                                      const_cast<const uint8_t**>(input), input ? frames : 0);
+    if (converted < 0) {
+        out.resize(used);
+        return false;
+    }
+    out.resize(used + static_cast<size_t>(converted) * channels);
+    return true;
+}
+
+size_t AudioDecoder::read(float* out, size_t frames) {
+    const size_t channels = static_cast<size_t>(info_.channels);
+    size_t done = 0;
+
+    while (done < frames) {
+        if (pending_offset_ == pending_.size()) {
+            pending_.clear();
+            pending_offset_ = 0;
+            if (!decode_more(pending_)) {
+                if (drained_ || !resampler_) {
+                    break;
+                }
+                drained_ = true;
+                convert(nullptr, 0, pending_);
+                if (pending_.empty()) {
+                    break;
+                }
+            }
+            continue;
+        }
+
+        size_t available = (pending_.size() - pending_offset_) / channels;
+        if (discard_frames_ > 0) {
+            const size_t dropped = static_cast<size_t>(std::min<uint64_t>(discard_frames_, available));
+            discard_frames_ -= dropped;
+            pending_offset_ += dropped * channels;
+            continue;
+        }
+
+        const size_t n = std::min(frames - done, available);
+        std::memcpy(out + done * channels, pending_.data() + pending_offset_, n * channels * sizeof(float));
+        pending_offset_ += n * channels;
+        done += n;
+    }
+
+    position_ += done;
+    return done;
+}
+
+bool AudioDecoder::seek(uint64_t frame) {
+    frame = std::min(frame, info_.frames);
+    const uint64_t source_frame = rescale(frame, info_.source_sample_rate, info_.sample_rate);
+    if (!seek_source(source_frame)) {
+        return false;
+    }
+
+    pending_.clear();
+    pending_offset_ = 0;
+    drained_ = false;
+    if (resampler_) {
+        swr_init(resampler_);   // Re-initialising drops the filter history
+    }
+
+    // The source frame rounds down; drop the output frames before the target
+    discard_frames_ = frame - std::min(frame, rescale(source_frame, info_.sample_rate, info_.source_sample_rate));
+    position_ = frame;
+    return true;
+}
+
+} // namespace OneStopRadio
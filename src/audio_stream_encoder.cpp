@@ -1,50 +1,98 @@
 #include "audio_stream_encoder.hpp"
+#include "dsp_kernels.hpp"
+#include "metrics_registry.hpp"
+#include "trace_profiler.hpp"
 #include "utils/logger.hpp"
+#include "utils/decibels.hpp"
 #include <chrono>
 #include <sstream>
 #include <iomanip>
 #include <cstring>
 #include <algorithm>
+#include <cmath>
+#include <random>
 
 extern "C" {
 #include <ogg/ogg.h>
-// Note: The following audio codec libraries need to be installed:
-// #include <lame/lame.h>          // LAME MP3 encoder
-// #include <vorbis/vorbisenc.h>   // Vorbis OGG encoder  
-// #include <opus/opus.h>          // Opus audio encoder
+#include <lame/lame.h>          // LAME MP3 encoder
+#include <vorbis/vorbisenc.h>   // Vorbis OGG encoder
+#include <opus/opus.h>          // Opus audio encoder
 }
 
+namespace {
+
+constexpr size_t kMp3FrameSamples = 1152;
+constexpr size_t kOpusFrameSamples = 960;   // 20 ms at 48 kHz
+constexpr int kOpusSampleRate = 48000;
+constexpr size_t kOpusMaxPacketBytes = 4000;
+constexpr size_t kPacketPoolSize = 64;
+
+// Feed interleaved audio through `pending` so encode_block() always sees exactly
+// block_frames frames. Whole blocks are passed straight from the input.
+template <typename EncodeBlock>
+bool accumulate_blocks(const float* samples, size_t frames, int channels, size_t block_frames,
+                       std::vector<float>& pending, size_t& pending_frames, EncodeBlock&& encode_block) {
+    while (frames > 0) {
+        if (pending_frames == 0 && frames >= block_frames) {
+            if (!encode_block(samples)) {
+                return false;
+            }
+            samples += block_frames * channels;
+            frames -= block_frames;
+            continue;
+        }
+        
+        const size_t take = std::min(frames, block_frames - pending_frames);
+        std::memcpy(pending.data() + pending_frames * channels, samples, take * channels * sizeof(float));
+        pending_frames += take;
+        samples += take * channels;
+        frames -= take;
+        
+        if (pending_frames == block_frames) {
+            pending_frames = 0;
+            if (!encode_block(pending.data())) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Split interleaved frames into per-channel planes
+void deinterleave(const float* interleaved, float* const* planes, int channels, size_t frames) {
+    if (channels == 2) {
+        dsp::deinterleave_stereo(interleaved, planes[0], planes[1], frames);
+    } else if (channels == 1) {
+        std::memcpy(planes[0], interleaved, frames * sizeof(float));
+    } else {
+        for (size_t i = 0; i < frames; ++i) {
+            for (int ch = 0; ch < channels; ++ch) {
+                planes[ch][i] = interleaved[i * channels + ch];
+            }
+        }
+    }
+}
+
+void put_le16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back(v & 0xff);
+    out.push_back(v >> 8);
+}
+
+void put_le32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back((v >> (8 * i)) & 0xff);
+    }
+}
+
+} // namespace
+
 /**
  * Internal implementation details
  */
 struct AudioStreamEncoder::Impl {
-    // libshout connection
+    // libshout connection; all sends go through the sender's I/O thread
     shout_t* shout = nullptr;
-    
-    // Audio encoders (disabled until libraries are installed)
-    // lame_global_flags* lame = nullptr;      // MP3
-    // vorbis_info vorbis_info_obj;            // OGG Vorbis
-    // vorbis_comment vorbis_comment_obj;
-    // vorbis_dsp_state vorbis_dsp;
-    // vorbis_block vorbis_block_obj;
-    // OpusEncoder* opus_encoder = nullptr;    // OGG Opus
-    
-    // OGG container support
-    ogg_stream_state ogg_stream_obj;
-    uint64_t opus_granule_pos = 0;
-    uint64_t opus_packet_count = 0;
-    uint64_t bytes_sent = 0;
-    
-    // FFmpeg for AAC/advanced encoding
-    AVCodecContext* codec_context = nullptr;
-    SwrContext* resampler = nullptr;
-    AVFrame* frame = nullptr;
-    AVPacket* packet = nullptr;
-    
-    // Audio buffers
-    std::vector<uint8_t> encoded_buffer;
-    std::vector<float> resample_buffer;
-    std::vector<int16_t> pcm_buffer;
+    std::unique_ptr<ShoutSender> sender;
     
     // Statistics
     StreamStats stats;
@@ -52,11 +100,9 @@ struct AudioStreamEncoder::Impl {
     std::chrono::steady_clock::time_point connect_time;
     
     // Audio processing
-    float gain = 1.0f;
-    bool limiter_enabled = false;
-    float limiter_threshold = -1.0f;
-    bool noise_gate_enabled = false;
-    float noise_gate_threshold = -40.0f;
+    std::atomic<float> gain{1.0f};
+    std::atomic<bool> noise_gate_enabled{false};
+    std::atomic<float> noise_gate_threshold{0.01f};   // Linear; -40 dB
     
     Impl() {
         // Initialize libshout
@@ -73,30 +119,93 @@ struct AudioStreamEncoder::Impl {
     }
     
     void cleanup() {
-        // Cleanup encoders (disabled until libraries are installed)
-        // if (lame) {
-        //     lame_close(lame);
-        //     lame = nullptr;
-        // }
-        
-        // if (opus_encoder) {
-        //     opus_encoder_destroy(opus_encoder);
-        //     opus_encoder = nullptr;
-        // }
-        
-        // Cleanup Vorbis (more complex)
-        // vorbis_block_clear(&vorbis_block_obj);
-        // vorbis_dsp_clear(&vorbis_dsp);
-        // vorbis_comment_clear(&vorbis_comment_obj);
-        // vorbis_info_clear(&vorbis_info_obj);
-        
-        // Cleanup OGG stream
-        ogg_stream_clear(&ogg_stream_obj);
+        // The sender uses the connection until it is stopped
+        sender.reset();
         
-        // Cleanup FFmpeg
+        // Cleanup libshout
+        if (shout) {
+            if (shout_get_connected(shout) == SHOUTERR_CONNECTED) {
+                shout_close(shout);
+            }
+            shout_free(shout);
+            shout = nullptr;
+        }
+    }
+};
+
+/**
+ * Codec state for one shared encoder. Everything is allocated in open();
+ * encoding reuses these buffers and never resizes them in steady state.
+ */
+struct SharedStreamEncoder::Impl {
+    // MP3
+    lame_global_flags* lame = nullptr;
+    
+    // OGG Vorbis
+    vorbis_info vorbis_info_obj;
+    vorbis_comment vorbis_comment_obj;
+    vorbis_dsp_state vorbis_dsp;
+    vorbis_block vorbis_block_obj;
+    bool vorbis_initialized = false;
+    
+    // OGG Opus (always encodes at 48 kHz; other rates are resampled)
+    OpusEncoder* opus_encoder = nullptr;
+    SwrContext* resampler = nullptr;
+    int opus_pre_skip = 0;
+    
+    // OGG container support
+    ogg_stream_state ogg_stream_obj;
+    bool ogg_initialized = false;
+    uint64_t opus_granule_pos = 0;
+    uint64_t opus_packet_count = 0;
+    ogg_int64_t last_page_granule = 0;
+    
+    // FFmpeg for AAC
+    AVCodecContext* codec_context = nullptr;
+    AVFrame* frame = nullptr;
+    AVPacket* packet = nullptr;
+    int64_t aac_pts = 0;
+    
+    // Fixed-size frame accumulation
+    std::vector<float> pending;
+    size_t pending_frames = 0;
+    size_t block_frames = 0;
+    
+    // Reused output buffers
+    std::vector<uint8_t> encoded_buffer;
+    std::vector<float> resample_buffer;
+    std::vector<uint8_t> page_buffer;
+    std::vector<float> silence;
+    
+    // Packets recycled once every sink has released them
+    std::vector<std::shared_ptr<EncodedPacket>> packet_pool;
+    size_t next_pooled = 0;
+    
+    // Metrics for this profile
+    MetricHistogram* frame_seconds = nullptr;
+    MetricCounter* frames_total = nullptr;
+    MetricCounter* source_underruns = nullptr;
+    MetricGauge* source_lag = nullptr;
+    
+    ~Impl() {
+        if (lame) {
+            lame_close(lame);
+        }
+        if (opus_encoder) {
+            opus_encoder_destroy(opus_encoder);
+        }
         if (resampler) {
             swr_free(&resampler);
         }
+        if (vorbis_initialized) {
+            vorbis_block_clear(&vorbis_block_obj);
+            vorbis_dsp_clear(&vorbis_dsp);
+            vorbis_comment_clear(&vorbis_comment_obj);
+            vorbis_info_clear(&vorbis_info_obj);
+        }
+        if (ogg_initialized) {
+            ogg_stream_clear(&ogg_stream_obj);
+        }
         if (codec_context) {
             avcodec_free_context(&codec_context);
         }
@@ -106,15 +215,29 @@ struct AudioStreamEncoder::Impl {
         if (packet) {
             av_packet_free(&packet);
         }
-        
-        // Cleanup libshout
-        if (shout) {
-            if (shout_get_connected(shout) == SHOUTERR_CONNECTED) {
-                shout_close(shout);
+    }
+    
+    void reserve_blocks(size_t frames, int channels) {
+        block_frames = frames;
+        pending.assign(frames * channels, 0.0f);
+        pending_frames = 0;
+    }
+    
+    std::shared_ptr<EncodedPacket> acquire_packet() {
+        for (size_t i = 0; i < packet_pool.size(); ++i) {
+            auto& candidate = packet_pool[(next_pooled + i) % packet_pool.size()];
+            if (candidate.use_count() == 1) {
+                // Pairs with the release in the last sink's shared_ptr destructor
+                std::atomic_thread_fence(std::memory_order_acquire);
+                next_pooled = (next_pooled + i + 1) % packet_pool.size();
+                return candidate;
             }
-            shout_free(shout);
-            shout = nullptr;
         }
+        auto packet = std::make_shared<EncodedPacket>();
+        if (packet_pool.size() < kPacketPoolSize) {
+            packet_pool.push_back(packet);
+        }
+        return packet;
     }
 };
 
@@ -152,7 +275,7 @@ bool AudioStreamEncoder::connect() {
     std::lock_guard<std::mutex> lock(status_mutex_);
     
     if (is_connected()) {
-        Logger::warning("Already connected to stream server");
+        Logger::warn("Already connected to stream server");
         return true;
     }
     
@@ -165,21 +288,22 @@ bool AudioStreamEncoder::connect() {
         return false;
     }
     
-    // Setup audio encoder
-    if (!setup_encoder()) {
-        status_ = StreamStatus::ERROR;
-        return false;
-    }
-    
-    // Connect to server
+    // Connect to server (non-blocking socket, so wait for the handshake here)
     int result = shout_open(impl_->shout);
-    if (result != SHOUTERR_SUCCESS) {
+    if ((result != SHOUTERR_SUCCESS && result != SHOUTERR_BUSY) ||
+        !ShoutSender::wait_connected(impl_->shout, std::chrono::seconds(config_.connection_timeout))) {
         status_ = StreamStatus::ERROR;
         status_message_ = "Connection failed: " + std::string(shout_get_error(impl_->shout));
         Logger::error("Failed to connect to stream server: " + status_message_);
         return false;
     }
     
+    // Bound the send queue by audio duration at the configured bitrate
+    const size_t queue_bytes = std::max<size_t>(
+        16 * 1024, static_cast<size_t>(config_.bitrate) * 125 * config_.send_queue_ms / 1000);
+    impl_->sender = std::make_unique<ShoutSender>(impl_->shout, queue_bytes);
+    impl_->sender->start(false);
+    
     status_ = StreamStatus::CONNECTED;
     status_message_ = "Connected to server";
     impl_->connect_time = std::chrono::steady_clock::now();
@@ -192,8 +316,11 @@ bool AudioStreamEncoder::connect() {
 bool AudioStreamEncoder::disconnect() {
     std::lock_guard<std::mutex> lock(status_mutex_);
     
-    if (is_streaming()) {
-        stop_streaming();
+    stop_streaming();
+    
+    if (impl_->sender) {
+        impl_->stats.bytes_sent = impl_->sender->get_stats().bytes_sent;
+        impl_->sender.reset();
     }
     
     if (impl_->shout && shout_get_connected(impl_->shout) == SHOUTERR_CONNECTED) {
@@ -209,51 +336,134 @@ bool AudioStreamEncoder::disconnect() {
 }
 
 bool AudioStreamEncoder::start_streaming(AudioStreamCallback* callback) {
-    if (!is_connected()) {
-        Logger::error("Must be connected before starting stream");
+    if (is_streaming()) {
+        Logger::warn("Already streaming");
+        return true;
+    }
+    
+    audio_callback_ = callback;
+    audio_source_.reset();
+    return launch_worker();
+}
+
+bool AudioStreamEncoder::start_streaming(std::shared_ptr<AudioRingBuffer::Reader> source) {
+    if (is_streaming()) {
+        Logger::warn("Already streaming");
+        return true;
+    }
+    
+    if (!source) {
+        Logger::error("No audio source given for streaming");
         return false;
     }
     
+    audio_callback_ = nullptr;
+    audio_source_ = std::move(source);
+    return launch_worker();
+}
+
+bool AudioStreamEncoder::start_streaming(std::shared_ptr<SharedStreamEncoder> shared_encoder) {
     if (is_streaming()) {
-        Logger::warning("Already streaming");
+        Logger::warn("Already streaming");
         return true;
     }
     
-    audio_callback_ = callback;
-    should_stop_ = false;
+    if (!shared_encoder || !is_connected()) {
+        Logger::error("Must be connected and given an encoder before starting stream");
+        return false;
+    }
     
-    // Start streaming thread
-    streaming_thread_ = std::thread(&AudioStreamEncoder::streaming_worker, this);
+    if (!(shared_encoder->profile() == EncoderProfile::from_config(config_))) {
+        Logger::error("Shared encoder " + shared_encoder->profile().to_string() +
+                      " does not match stream profile " + EncoderProfile::from_config(config_).to_string());
+        return false;
+    }
+    
+    audio_callback_ = nullptr;
+    audio_source_.reset();
+    encoder_ = std::move(shared_encoder);
+    shared_encoder_ = true;
+    
+    // Packets start flowing (headers first) as soon as we are a sink
+    status_ = StreamStatus::STREAMING;
+    status_message_ = "Streaming active (shared encoder)";
+    impl_->stats.status = StreamStatus::STREAMING;
+    encoder_->add_sink(this);
+    
+    Logger::info("Audio streaming started on shared encoder " + encoder_->profile().to_string());
+    return true;
+}
+
+bool AudioStreamEncoder::launch_worker() {
+    if (!is_connected()) {
+        Logger::error("Must be connected before starting stream");
+        return false;
+    }
+    
+    if (!setup_encoder()) {
+        Logger::error("Failed to set up encoder: " + status_message_);
+        return false;
+    }
+    
+    should_stop_ = false;
     
     status_ = StreamStatus::STREAMING;
     status_message_ = "Streaming active";
     impl_->stats.status = StreamStatus::STREAMING;
+    encoder_->add_sink(this);
+    
+    // Start streaming thread
+    streaming_thread_ = std::thread(&AudioStreamEncoder::streaming_worker, this);
     
     Logger::info("Audio streaming started");
     return true;
 }
 
 bool AudioStreamEncoder::stop_streaming() {
-    if (!is_streaming()) {
+    // A worker that exited on error still has to be joined and detached from its encoder
+    if (!encoder_ && !streaming_thread_.joinable()) {
         return true;
     }
     
-    // Signal thread to stop
+    // Signal thread to stop, waking it if it is blocked on the master bus
     should_stop_ = true;
+    if (audio_source_) {
+        audio_source_->cancel();
+    }
     
     // Wait for thread to finish
     if (streaming_thread_.joinable()) {
         streaming_thread_.join();
     }
     
-    status_ = StreamStatus::CONNECTED;
-    status_message_ = "Streaming stopped";
+    // After this returns the encoder no longer calls back into us
+    if (encoder_) {
+        encoder_->remove_sink(this);
+        encoder_.reset();
+    }
+    shared_encoder_ = false;
+    
+    if (status_ == StreamStatus::STREAMING) {
+        status_ = StreamStatus::CONNECTED;
+        status_message_ = "Streaming stopped";
+    }
     audio_callback_ = nullptr;
     
     Logger::info("Audio streaming stopped");
     return true;
 }
 
+void AudioStreamEncoder::on_encoded_packet(const EncodedPacketPtr& packet) {
+    if (status_ != StreamStatus::STREAMING || !impl_->sender) {
+        return;
+    }
+    
+    // Never blocks; a slow server only costs this mount its oldest packets
+    if (!impl_->sender->enqueue(packet)) {
+        handle_connection_error(impl_->sender->get_error());
+    }
+}
+
 bool AudioStreamEncoder::send_audio_data(const float* samples, size_t frames) {
     if (!is_streaming()) {
         return false;
@@ -281,7 +491,7 @@ bool AudioStreamEncoder::update_metadata(const std::string& title, const std::st
     shout_metadata_free(shout_meta);
     
     if (result != SHOUTERR_SUCCESS) {
-        Logger::warning("Failed to update metadata: " + std::string(shout_get_error(impl_->shout)));
+        Logger::warn("Failed to update metadata: " + std::string(shout_get_error(impl_->shout)));
         return false;
     }
     
@@ -296,6 +506,25 @@ StreamStats AudioStreamEncoder::get_statistics() const {
     stats.status = status_;
     stats.status_message = status_message_;
     
+    // Shared encoders own the master bus reader
+    auto source = audio_source_ ? audio_source_ : (encoder_ ? encoder_->source() : nullptr);
+    if (impl_->sender) {
+        const ShoutSenderStats sender = impl_->sender->get_stats();
+        stats.bytes_sent = sender.bytes_sent;
+        stats.send_queue_packets = static_cast<int>(sender.queue_packets);
+        stats.send_queue_bytes = sender.queue_bytes + sender.shout_queue_bytes;
+        stats.packets_dropped = sender.packets_dropped;
+        stats.latency = sender.latency_ms;
+        stats.max_latency = sender.max_latency_ms;
+    }
+    
+    if (source) {
+        stats.buffer_overflows = source->overflows();
+        stats.buffer_underruns = source->underruns();
+        stats.dropped_frames = static_cast<int>(source->dropped_frames());
+        stats.buffer_fill = static_cast<int>(100 * source->available() / source->capacity_frames());
+    }
+    
     // Calculate connection time
     if (status_ == StreamStatus::CONNECTED || status_ == StreamStatus::STREAMING) {
         auto now = std::chrono::steady_clock::now();
@@ -307,6 +536,9 @@ StreamStats AudioStreamEncoder::get_statistics() const {
 }
 
 bool AudioStreamEncoder::setup_connection() {
+    // Drop any connection left from a previous connect()
+    impl_->cleanup();
+    
     impl_->shout = shout_new();
     if (!impl_->shout) {
         status_message_ = "Failed to create libshout object";
@@ -371,91 +603,73 @@ bool AudioStreamEncoder::setup_connection() {
     shout_set_public(impl_->shout, config_.public_stream ? 1 : 0);
     shout_set_agent(impl_->shout, config_.user_agent.c_str());
     
+    // Sending happens on the ShoutSender I/O thread and must never block it
+    shout_set_nonblocking(impl_->shout, 1);
+    
     return true;
 }
 
 bool AudioStreamEncoder::setup_encoder() {
-    switch (config_.codec) {
-        case StreamCodec::MP3:
-            return setup_mp3_encoder();
-        case StreamCodec::OGG_VORBIS:
-            return setup_vorbis_encoder();
-        case StreamCodec::OGG_OPUS:
-            return setup_opus_encoder();
-        case StreamCodec::AAC:
-            return setup_aac_encoder();
-        default:
-            status_message_ = "Unsupported codec";
-            return false;
-    }
-}
-
-bool AudioStreamEncoder::setup_mp3_encoder() {
-    status_message_ = "MP3 encoder not available - LAME library not installed";
-    Logger::error("MP3 encoding requires LAME library installation");
-    return false;
-}
-
-bool AudioStreamEncoder::setup_vorbis_encoder() {
-    status_message_ = "Vorbis encoder not available - libvorbis library not installed";
-    Logger::error("Vorbis encoding requires libvorbis library installation");
-    return false;
-}
-
-bool AudioStreamEncoder::setup_opus_encoder() {
-    status_message_ = "Opus encoder not available - libopus library not installed";
-    Logger::error("Opus encoding requires libopus library installation");
-    return false;
-}
-
-bool AudioStreamEncoder::setup_aac_encoder() {
-    // Find AAC encoder
-    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
-    if (!codec) {
-        status_message_ = "AAC encoder not found";
-        return false;
-    }
-    
-    // Create codec context
-    impl_->codec_context = avcodec_alloc_context3(codec);
-    if (!impl_->codec_context) {
-        status_message_ = "Failed to allocate AAC codec context";
-        return false;
-    }
-    
-    // Configure codec
-    impl_->codec_context->bit_rate = config_.bitrate * 1000;
-    impl_->codec_context->sample_rate = config_.sample_rate;
-    impl_->codec_context->channels = config_.channels;
-    impl_->codec_context->channel_layout = config_.channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO;
-    impl_->codec_context->sample_fmt = AV_SAMPLE_FMT_FLTP;
-    impl_->codec_context->profile = FF_PROFILE_AAC_LOW;
-    
-    // Open codec
-    if (avcodec_open2(impl_->codec_context, codec, nullptr) < 0) {
-        status_message_ = "Failed to open AAC codec";
-        return false;
-    }
-    
-    // Allocate frame and packet
-    impl_->frame = av_frame_alloc();
-    impl_->packet = av_packet_alloc();
+    // Private encoder for callback and direct reader streaming
+    encoder_ = std::make_shared<SharedStreamEncoder>(EncoderProfile::from_config(config_));
+    shared_encoder_ = false;
     
-    if (!impl_->frame || !impl_->packet) {
-        status_message_ = "Failed to allocate AAC frame/packet";
+    if (!encoder_->open()) {
+        status_message_ = encoder_->get_error();
+        encoder_.reset();
         return false;
     }
-    
-    Logger::info("AAC encoder initialized: " + std::to_string(config_.bitrate) + "kbps");
     return true;
 }
 
 void AudioStreamEncoder::streaming_worker() {
     Logger::info("Streaming worker thread started");
+    TRACE_THREAD_NAME("stream_worker");
     
     const size_t buffer_size = 1152; // Standard frame size
     std::vector<float> audio_buffer(buffer_size * config_.channels);
     
+    // Ring sources block on data availability; no polling
+    if (audio_source_) {
+        if (audio_source_->channels() != config_.channels) {
+            Logger::error("Master bus has " + std::to_string(audio_source_->channels()) +
+                          " channels but stream expects " + std::to_string(config_.channels));
+            handle_connection_error("Channel count mismatch");
+            return;
+        }
+        
+        while (!should_stop_) {
+            size_t frames = audio_source_->read(audio_buffer.data(), buffer_size, std::chrono::milliseconds(100));
+            if (frames == 0) {
+                // Timeout (counted as underrun): keep the mount fed with silence
+                if (!should_stop_ && !encoder_->encode_silence(config_.sample_rate / 10)) {
+                    handle_connection_error("Encoding error: " + encoder_->get_error());
+                    break;
+                }
+                continue;
+            }
+            
+            TRACE_SCOPE("stream_block");
+            apply_audio_processing(audio_buffer.data(), frames);
+            
+            if (!encode_and_send(audio_buffer.data(), frames)) {
+                if (status_ != StreamStatus::ERROR) {
+                    handle_connection_error("Encoding error: " + encoder_->get_error());
+                }
+                break;
+            }
+            
+            update_statistics();
+        }
+        
+        Logger::info("Streaming worker thread stopped");
+        return;
+    }
+    
+    // Callbacks are not paced by the audio clock, so pace to real time here
+    const auto stream_start = std::chrono::steady_clock::now();
+    uint64_t frames_streamed = 0;
+    
     while (!should_stop_) {
         if (!audio_callback_) {
             std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -467,16 +681,25 @@ void AudioStreamEncoder::streaming_worker() {
             audio_buffer.data(), buffer_size, config_.channels);
         
         if (frames_provided > 0) {
-            // Apply audio processing
-            apply_audio_processing(audio_buffer.data(), frames_provided);
-            
-            // Encode and send
-            if (!encode_and_send(audio_buffer.data(), frames_provided)) {
-                Logger::error("Failed to encode/send audio data");
-                handle_connection_error("Encoding/transmission error");
-                break;
+            {
+                TRACE_SCOPE("stream_block");
+                
+                // Apply audio processing
+                apply_audio_processing(audio_buffer.data(), frames_provided);
+                
+                // Encode and send
+                if (!encode_and_send(audio_buffer.data(), frames_provided)) {
+                    if (status_ != StreamStatus::ERROR) {
+                        handle_connection_error("Encoding error: " + encoder_->get_error());
+                    }
+                    break;
+                }
             }
             
+            frames_streamed += frames_provided;
+            std::this_thread::sleep_until(stream_start + std::chrono::microseconds(
+                frames_streamed * 1000000 / static_cast<uint64_t>(config_.sample_rate)));
+            
             // Update statistics
             update_statistics();
         } else {
@@ -492,15 +715,14 @@ void AudioStreamEncoder::apply_audio_processing(float* samples, size_t frames) {
     const size_t total_samples = frames * config_.channels;
     
     // Apply gain
-    if (impl_->gain != 1.0f) {
-        for (size_t i = 0; i < total_samples; ++i) {
-            samples[i] *= impl_->gain;
-        }
+    const float gain = impl_->gain.load(std::memory_order_relaxed);
+    if (gain != 1.0f) {
+        dsp::apply_gain(samples, total_samples, gain);
     }
     
     // Apply noise gate
-    if (impl_->noise_gate_enabled) {
-        const float threshold = std::pow(10.0f, impl_->noise_gate_threshold / 20.0f);
+    if (impl_->noise_gate_enabled.load(std::memory_order_relaxed)) {
+        const float threshold = impl_->noise_gate_threshold.load(std::memory_order_relaxed);
         for (size_t i = 0; i < total_samples; i += config_.channels) {
             float level = 0.0f;
             for (int ch = 0; ch < config_.channels; ++ch) {
@@ -516,16 +738,6 @@ void AudioStreamEncoder::apply_audio_processing(float* samples, size_t frames) {
         }
     }
     
-    // Apply limiter
-    if (impl_->limiter_enabled) {
-        const float threshold = std::pow(10.0f, impl_->limiter_threshold / 20.0f);
-        for (size_t i = 0; i < total_samples; ++i) {
-            if (std::abs(samples[i]) > threshold) {
-                samples[i] = samples[i] > 0 ? threshold : -threshold;
-            }
-        }
-    }
-    
     // Update level statistics
     float peak_left = 0.0f, peak_right = 0.0f;
     for (size_t i = 0; i < frames; ++i) {
@@ -539,85 +751,622 @@ void AudioStreamEncoder::apply_audio_processing(float* samples, size_t frames) {
     impl_->stats.peak_level_right = config_.channels > 1 ? peak_right : peak_left;
 }
 
+bool AudioStreamEncoder::set_gain(float gain) {
+    impl_->gain = std::max(0.0f, gain);
+    return true;
+}
+
+bool AudioStreamEncoder::enable_limiter(bool enabled, float /*threshold*/) {
+    if (enabled) {
+        Logger::warn("Per-stream limiting is not supported; the master bus limiter (AudioSystem::set_limiter) covers every stream");
+    }
+    return !enabled;
+}
+
+bool AudioStreamEncoder::enable_noise_gate(bool enabled, float threshold) {
+    impl_->noise_gate_threshold = Decibels::to_gain(threshold);
+    impl_->noise_gate_enabled = enabled;
+    return true;
+}
+
 bool AudioStreamEncoder::encode_and_send(const float* samples, size_t frames) {
-    switch (config_.codec) {
+    // Packets are sent from on_encoded_packet(), which flags send failures
+    if (!encoder_ || shared_encoder_ || !encoder_->encode(samples, frames)) {
+        return false;
+    }
+    return status_ != StreamStatus::ERROR;
+}
+
+void AudioStreamEncoder::handle_connection_error(const std::string& error) {
+    status_ = StreamStatus::ERROR;
+    status_message_ = error;
+    Logger::error("Stream error: " + error);
+    
+    if (config_.auto_reconnect) {
+        // TODO: Implement auto-reconnection logic
+        Logger::info("Auto-reconnect will be attempted");
+    }
+}
+
+void AudioStreamEncoder::update_statistics() {
+    if (impl_->sender) {
+        impl_->stats.bytes_sent = impl_->sender->get_stats().bytes_sent;
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    impl_->stats.total_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - impl_->start_time).count();
+    
+    // Calculate current bitrate based on bytes sent
+    if (impl_->stats.total_time > 0) {
+        impl_->stats.current_bitrate = (impl_->stats.bytes_sent * 8.0) / 
+                                      (impl_->stats.total_time / 1000.0) / 1000.0;
+    }
+}
+
+// EncoderProfile implementation
+EncoderProfile EncoderProfile::from_config(const StreamConfig& config) {
+    EncoderProfile profile;
+    profile.codec = config.codec;
+    profile.bitrate = config.bitrate;
+    profile.sample_rate = config.sample_rate;
+    profile.channels = config.channels;
+    return profile;
+}
+
+std::string EncoderProfile::to_string() const {
+    return AudioStreamEncoder::codec_to_string(codec) + "/" + std::to_string(bitrate) + "kbps/" +
+           std::to_string(sample_rate) + "Hz/" + std::to_string(channels) + "ch";
+}
+
+// SharedStreamEncoder implementation
+SharedStreamEncoder::SharedStreamEncoder(const EncoderProfile& profile)
+    : impl_(std::make_unique<Impl>()), profile_(profile) {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    const MetricLabels labels = {{"profile", profile_.to_string()}};
+    impl_->frame_seconds = &registry.histogram(
+        "onestop_encoder_frame_seconds", "Encoding time per PCM frame, averaged over each encode call",
+        MetricsRegistry::exponential_buckets(0.00000005, 2.0, 12), labels);
+    impl_->frames_total = &registry.counter("onestop_encoder_frames_total", "PCM frames encoded", labels);
+    impl_->source_underruns = &registry.counter(
+        "onestop_encoder_source_underruns_total", "Master bus reads that timed out and were bridged with silence", labels);
+    impl_->source_lag = &registry.gauge(
+        "onestop_encoder_source_lag_frames", "Master bus frames written but not yet read by the encoder", labels);
+}
+
+SharedStreamEncoder::~SharedStreamEncoder() {
+    stop();
+}
+
+bool SharedStreamEncoder::open() {
+    impl_->silence.assign(kMp3FrameSamples * profile_.channels, 0.0f);
+    
+    switch (profile_.codec) {
+        case StreamCodec::MP3:
+            return setup_mp3_encoder();
+        case StreamCodec::OGG_VORBIS:
+            return setup_vorbis_encoder();
+        case StreamCodec::OGG_OPUS:
+            return setup_opus_encoder();
+        case StreamCodec::AAC:
+            return setup_aac_encoder();
+        default:
+            set_error("Unsupported codec");
+            return false;
+    }
+}
+
+bool SharedStreamEncoder::start(std::shared_ptr<AudioRingBuffer::Reader> source) {
+    if (running_) {
+        return true;
+    }
+    
+    if (!source) {
+        set_error("No audio source given");
+        return false;
+    }
+    
+    if (source->channels() != profile_.channels || source->sample_rate() != profile_.sample_rate) {
+        set_error("Master bus format does not match encoder profile " + profile_.to_string());
+        return false;
+    }
+    
+    source_ = std::move(source);
+    should_stop_ = false;
+    running_ = true;
+    worker_ = std::thread(&SharedStreamEncoder::worker_loop, this);
+    
+    Logger::info("Shared encoder started: " + profile_.to_string());
+    return true;
+}
+
+void SharedStreamEncoder::stop() {
+    if (!worker_.joinable()) {
+        return;
+    }
+    
+    should_stop_ = true;
+    source_->cancel();
+    worker_.join();
+    running_ = false;
+    
+    Logger::info("Shared encoder stopped: " + profile_.to_string());
+}
+
+void SharedStreamEncoder::worker_loop() {
+    const size_t buffer_size = 1152; // Standard frame size
+    std::vector<float> audio_buffer(buffer_size * profile_.channels);
+    TRACE_THREAD_NAME("shared_encoder");
+    
+    while (!should_stop_) {
+        const auto timeout = std::chrono::milliseconds(100);
+        size_t frames = source_->read(audio_buffer.data(), buffer_size, timeout);
+        impl_->source_lag->set(static_cast<double>(source_->available()));
+        if (frames == 0) {
+            impl_->source_underruns->increment();
+            // Timeout (counted as underrun): fill the gap so servers do not drop the source
+            if (!should_stop_ && !encode_silence(profile_.sample_rate * timeout.count() / 1000)) {
+                Logger::error("Shared encoder " + profile_.to_string() + " failed: " + get_error());
+                break;
+            }
+            continue;
+        }
+        
+        if (!encode(audio_buffer.data(), frames)) {
+            Logger::error("Shared encoder " + profile_.to_string() + " failed: " + get_error());
+            break;
+        }
+    }
+    
+    running_ = false;
+}
+
+bool SharedStreamEncoder::encode(const float* samples, size_t frames) {
+    TRACE_SCOPE("encode");
+    const auto begin = std::chrono::steady_clock::now();
+    bool ok = false;
+    switch (profile_.codec) {
         case StreamCodec::MP3:
-            return encode_and_send_mp3(samples, frames);
+            ok = encode_mp3(samples, frames);
+            break;
         case StreamCodec::OGG_VORBIS:
-            return encode_and_send_vorbis(samples, frames);
+            ok = encode_vorbis(samples, frames);
+            break;
         case StreamCodec::OGG_OPUS:
-            return encode_and_send_opus(samples, frames);
+            ok = encode_opus(samples, frames);
+            break;
         case StreamCodec::AAC:
-            return encode_and_send_aac(samples, frames);
+            ok = encode_aac(samples, frames);
+            break;
         default:
+            break;
+    }
+    
+    if (ok && frames > 0) {
+        frames_encoded_ += frames;
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        impl_->frame_seconds->observe(elapsed / static_cast<double>(frames));
+        impl_->frames_total->increment(frames);
+    }
+    return ok;
+}
+
+bool SharedStreamEncoder::encode_silence(size_t frames) {
+    const size_t chunk = impl_->silence.size() / profile_.channels;
+    while (frames > 0) {
+        const size_t n = std::min(frames, chunk);
+        if (!encode(impl_->silence.data(), n)) {
+            return false;
+        }
+        frames -= n;
+    }
+    return true;
+}
+
+void SharedStreamEncoder::add_sink(EncodedPacketSink* sink) {
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    
+    // Late joiners need the stream headers before any audio packet
+    for (const auto& header : header_packets_) {
+        sink->on_encoded_packet(header);
+    }
+    sinks_.push_back(sink);
+}
+
+void SharedStreamEncoder::remove_sink(EncodedPacketSink* sink) {
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    sinks_.erase(std::remove(sinks_.begin(), sinks_.end(), sink), sinks_.end());
+}
+
+size_t SharedStreamEncoder::sink_count() const {
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    return sinks_.size();
+}
+
+std::string SharedStreamEncoder::get_error() const {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    return error_;
+}
+
+void SharedStreamEncoder::set_error(const std::string& error) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    error_ = error;
+}
+
+void SharedStreamEncoder::emit_packet(const uint8_t* data, size_t size, size_t frames) {
+    auto packet = impl_->acquire_packet();
+    packet->data.assign(data, data + size);
+    packet->sequence = packets_encoded_++;
+    packet->frames = frames;
+    packet->header = false;
+    
+    // Encoded once; every sink gets a reference to the same bytes
+    EncodedPacketPtr shared = std::move(packet);
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    for (auto* sink : sinks_) {
+        sink->on_encoded_packet(shared);
+    }
+}
+
+void SharedStreamEncoder::emit_header(const uint8_t* data, size_t size) {
+    auto packet = std::make_shared<EncodedPacket>();
+    packet->data.assign(data, data + size);
+    packet->sequence = packets_encoded_++;
+    packet->header = true;
+    
+    EncodedPacketPtr shared = std::move(packet);
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    header_packets_.push_back(shared);
+    for (auto* sink : sinks_) {
+        sink->on_encoded_packet(shared);
+    }
+}
+
+void SharedStreamEncoder::emit_ogg_pages(bool flush, bool header) {
+    ogg_page page;
+    auto next_page = flush ? ogg_stream_flush : ogg_stream_pageout;
+    
+    while (next_page(&impl_->ogg_stream_obj, &page) > 0) {
+        auto& buffer = impl_->page_buffer;
+        buffer.clear();
+        buffer.insert(buffer.end(), page.header, page.header + page.header_len);
+        buffer.insert(buffer.end(), page.body, page.body + page.body_len);
+        
+        if (header) {
+            emit_header(buffer.data(), buffer.size());
+            continue;
+        }
+        
+        // Header pages carry granule 0; audio pages advance it. Opus granules
+        // count 48 kHz samples, so they are scaled back to profile-rate
+        // frames, cumulatively so rounding never drifts.
+        const ogg_int64_t granule = ogg_page_granulepos(&page);
+        const auto to_frames = [this](ogg_int64_t position) {
+            if (profile_.codec != StreamCodec::OGG_OPUS) {
+                return position;
+            }
+            return position * profile_.sample_rate / kOpusSampleRate;
+        };
+        const size_t frames = granule > impl_->last_page_granule
+            ? static_cast<size_t>(to_frames(granule) - to_frames(impl_->last_page_granule)) : 0;
+        impl_->last_page_granule = std::max(impl_->last_page_granule, granule);
+        emit_packet(buffer.data(), buffer.size(), frames);
+    }
+}
+
+bool SharedStreamEncoder::setup_mp3_encoder() {
+    if (profile_.channels < 1 || profile_.channels > 2) {
+        set_error("MP3 supports mono or stereo only");
+        return false;
+    }
+    
+    impl_->lame = lame_init();
+    if (!impl_->lame) {
+        set_error("Failed to create LAME encoder");
+        return false;
+    }
+    
+    lame_set_in_samplerate(impl_->lame, profile_.sample_rate);
+    lame_set_out_samplerate(impl_->lame, profile_.sample_rate);
+    lame_set_num_channels(impl_->lame, profile_.channels);
+    lame_set_mode(impl_->lame, profile_.channels == 1 ? MONO : JOINT_STEREO);
+    lame_set_brate(impl_->lame, profile_.bitrate);
+    lame_set_quality(impl_->lame, 5);   // Good quality at modest CPU cost
+    
+    if (lame_init_params(impl_->lame) < 0) {
+        set_error("Invalid LAME parameters for " + profile_.to_string());
+        return false;
+    }
+    
+    // Worst case output for one frame, per the LAME API documentation
+    impl_->encoded_buffer.resize(kMp3FrameSamples * 5 / 4 + 7200);
+    impl_->reserve_blocks(kMp3FrameSamples, profile_.channels);
+    
+    Logger::info("MP3 encoder initialized: " + profile_.to_string());
+    return true;
+}
+
+bool SharedStreamEncoder::setup_vorbis_encoder() {
+    vorbis_info_init(&impl_->vorbis_info_obj);
+    
+    // Managed average bitrate mode
+    if (vorbis_encode_init(&impl_->vorbis_info_obj, profile_.channels, profile_.sample_rate,
+                           -1, profile_.bitrate * 1000, -1) != 0) {
+        vorbis_info_clear(&impl_->vorbis_info_obj);
+        set_error("Unsupported Vorbis parameters for " + profile_.to_string());
+        return false;
+    }
+    
+    vorbis_comment_init(&impl_->vorbis_comment_obj);
+    vorbis_comment_add_tag(&impl_->vorbis_comment_obj, "ENCODER", "OneStopRadio");
+    vorbis_analysis_init(&impl_->vorbis_dsp, &impl_->vorbis_info_obj);
+    vorbis_block_init(&impl_->vorbis_dsp, &impl_->vorbis_block_obj);
+    impl_->vorbis_initialized = true;
+    
+    ogg_stream_init(&impl_->ogg_stream_obj, static_cast<int>(std::random_device{}()));
+    impl_->ogg_initialized = true;
+    
+    // Identification, comment and codebook headers, each flushed to whole pages
+    ogg_packet identification, comment, codebooks;
+    vorbis_analysis_headerout(&impl_->vorbis_dsp, &impl_->vorbis_comment_obj,
+                              &identification, &comment, &codebooks);
+    ogg_stream_packetin(&impl_->ogg_stream_obj, &identification);
+    ogg_stream_packetin(&impl_->ogg_stream_obj, &comment);
+    ogg_stream_packetin(&impl_->ogg_stream_obj, &codebooks);
+    emit_ogg_pages(true, true);
+    
+    Logger::info("Vorbis encoder initialized: " + profile_.to_string());
+    return true;
+}
+
+bool SharedStreamEncoder::setup_opus_encoder() {
+    if (profile_.channels < 1 || profile_.channels > 2) {
+        set_error("Opus streaming supports mono or stereo only");
+        return false;
+    }
+    
+    int error = OPUS_OK;
+    impl_->opus_encoder = opus_encoder_create(kOpusSampleRate, profile_.channels, OPUS_APPLICATION_AUDIO, &error);
+    if (error != OPUS_OK || !impl_->opus_encoder) {
+        set_error("Failed to create Opus encoder: " + std::string(opus_strerror(error)));
+        return false;
+    }
+    
+    opus_encoder_ctl(impl_->opus_encoder, OPUS_SET_BITRATE(profile_.bitrate * 1000));
+    opus_int32 lookahead = 0;
+    opus_encoder_ctl(impl_->opus_encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+    impl_->opus_pre_skip = lookahead;
+    
+    // Opus only runs at 48 kHz
+    if (profile_.sample_rate != kOpusSampleRate) {
+        const int64_t layout = profile_.channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO;
+        impl_->resampler = swr_alloc_set_opts(nullptr, layout, AV_SAMPLE_FMT_FLT, kOpusSampleRate,
+                                              layout, AV_SAMPLE_FMT_FLT, profile_.sample_rate, 0, nullptr);
+        if (!impl_->resampler || swr_init(impl_->resampler) < 0) {
+            set_error("Failed to create resampler for Opus");
             return false;
+        }
     }
+    
+    impl_->encoded_buffer.resize(kOpusMaxPacketBytes);
+    impl_->reserve_blocks(kOpusFrameSamples, profile_.channels);
+    
+    ogg_stream_init(&impl_->ogg_stream_obj, static_cast<int>(std::random_device{}()));
+    impl_->ogg_initialized = true;
+    
+    // OpusHead (RFC 7845 section 5.1), alone on the first page
+    std::vector<uint8_t> head = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1,
+                                 static_cast<uint8_t>(profile_.channels)};
+    put_le16(head, static_cast<uint16_t>(impl_->opus_pre_skip));
+    put_le32(head, static_cast<uint32_t>(profile_.sample_rate));
+    put_le16(head, 0);      // Output gain
+    head.push_back(0);      // Channel mapping family
+    
+    // OpusTags (section 5.2) with no user comments
+    const std::string vendor = opus_get_version_string();
+    std::vector<uint8_t> tags = {'O', 'p', 'u', 's', 'T', 'a', 'g', 's'};
+    put_le32(tags, static_cast<uint32_t>(vendor.size()));
+    tags.insert(tags.end(), vendor.begin(), vendor.end());
+    put_le32(tags, 0);
+    
+    ogg_packet packet{};
+    packet.packet = head.data();
+    packet.bytes = static_cast<long>(head.size());
+    packet.b_o_s = 1;
+    packet.packetno = static_cast<ogg_int64_t>(impl_->opus_packet_count++);
+    ogg_stream_packetin(&impl_->ogg_stream_obj, &packet);
+    emit_ogg_pages(true, true);
+    
+    packet = ogg_packet{};
+    packet.packet = tags.data();
+    packet.bytes = static_cast<long>(tags.size());
+    packet.packetno = static_cast<ogg_int64_t>(impl_->opus_packet_count++);
+    ogg_stream_packetin(&impl_->ogg_stream_obj, &packet);
+    emit_ogg_pages(true, true);
+    
+    Logger::info("Opus encoder initialized: " + profile_.to_string());
+    return true;
 }
 
-bool AudioStreamEncoder::encode_and_send_mp3(const float* samples, size_t frames) {
-    Logger::error("MP3 encoding not implemented - missing LAME library");
-    return false;
+bool SharedStreamEncoder::setup_aac_encoder() {
+    // Find AAC encoder
+    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
+    if (!codec) {
+        set_error("AAC encoder not found");
+        return false;
+    }
+    
+    // Create codec context
+    impl_->codec_context = avcodec_alloc_context3(codec);
+    if (!impl_->codec_context) {
+        set_error("Failed to allocate AAC codec context");
+        return false;
+    }
+    
+    // Configure codec
+    impl_->codec_context->bit_rate = profile_.bitrate * 1000;
+    impl_->codec_context->sample_rate = profile_.sample_rate;
+    impl_->codec_context->channels = profile_.channels;
+    impl_->codec_context->channel_layout = profile_.channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO;
+    impl_->codec_context->sample_fmt = AV_SAMPLE_FMT_FLTP;
+    impl_->codec_context->profile = FF_PROFILE_AAC_LOW;
+    
+    // Open codec
+    if (avcodec_open2(impl_->codec_context, codec, nullptr) < 0) {
+        set_error("Failed to open AAC codec");
+        return false;
+    }
+    
+    // Allocate frame and packet
+    impl_->frame = av_frame_alloc();
+    impl_->packet = av_packet_alloc();
+    
+    if (!impl_->frame || !impl_->packet) {
+        set_error("Failed to allocate AAC frame/packet");
+        return false;
+    }
+    
+    // One frame buffer of the codec's frame size, reused for every frame
+    impl_->frame->nb_samples = impl_->codec_context->frame_size;
+    impl_->frame->format = impl_->codec_context->sample_fmt;
+    impl_->frame->channel_layout = impl_->codec_context->channel_layout;
+    impl_->frame->channels = impl_->codec_context->channels;
+    if (av_frame_get_buffer(impl_->frame, 0) < 0) {
+        set_error("Failed to get AAC frame buffer");
+        return false;
+    }
+    impl_->reserve_blocks(static_cast<size_t>(impl_->codec_context->frame_size), profile_.channels);
+    
+    Logger::info("AAC encoder initialized: " + std::to_string(profile_.bitrate) + "kbps");
+    return true;
 }
 
-bool AudioStreamEncoder::encode_and_send_vorbis(const float* samples, size_t frames) {
-    if (!impl_ || !impl_->shout) {
-        Logger::error("Vorbis encoding not available - libraries not installed");
+bool SharedStreamEncoder::encode_mp3(const float* samples, size_t frames) {
+    if (!impl_->lame) {
+        set_error("MP3 encoder not open");
         return false;
     }
     
-    // Vorbis encoding disabled until libraries are installed
-    Logger::error("Vorbis encoding not implemented - missing libvorbis");
-    return false;
+    return accumulate_blocks(samples, frames, profile_.channels, kMp3FrameSamples,
+                             impl_->pending, impl_->pending_frames, [this](const float* block) {
+        auto& out = impl_->encoded_buffer;
+        const int bytes = profile_.channels == 1
+            ? lame_encode_buffer_ieee_float(impl_->lame, block, block, kMp3FrameSamples,
+                                            out.data(), static_cast<int>(out.size()))
+            : lame_encode_buffer_interleaved_ieee_float(impl_->lame, block, kMp3FrameSamples,
+                                                        out.data(), static_cast<int>(out.size()));
+        if (bytes < 0) {
+            set_error("LAME encoding error: " + std::to_string(bytes));
+            return false;
+        }
+        
+        // LAME buffers internally; some calls produce no output
+        if (bytes > 0) {
+            emit_packet(out.data(), static_cast<size_t>(bytes), kMp3FrameSamples);
+        }
+        return true;
+    });
 }
 
-bool AudioStreamEncoder::encode_and_send_opus(const float* samples, size_t frames) {
-    if (!impl_ || !impl_->shout) {
-        Logger::error("Opus encoding not available - libraries not installed");
+bool SharedStreamEncoder::encode_vorbis(const float* samples, size_t frames) {
+    if (!impl_->vorbis_initialized) {
+        set_error("Vorbis encoder not open");
         return false;
     }
     
-    // Opus encoding disabled until libraries are installed
-    Logger::error("Opus encoding not implemented - missing libopus");
-    return false;
+    // libvorbis takes any block size and buffers internally
+    float** buffer = vorbis_analysis_buffer(&impl_->vorbis_dsp, static_cast<int>(frames));
+    deinterleave(samples, buffer, profile_.channels, frames);
+    vorbis_analysis_wrote(&impl_->vorbis_dsp, static_cast<int>(frames));
+    
+    ogg_packet packet;
+    while (vorbis_analysis_blockout(&impl_->vorbis_dsp, &impl_->vorbis_block_obj) == 1) {
+        vorbis_analysis(&impl_->vorbis_block_obj, nullptr);
+        vorbis_bitrate_addblock(&impl_->vorbis_block_obj);
+        
+        while (vorbis_bitrate_flushpacket(&impl_->vorbis_dsp, &packet)) {
+            ogg_stream_packetin(&impl_->ogg_stream_obj, &packet);
+        }
+    }
+    
+    emit_ogg_pages(false, false);
+    return true;
 }
 
-bool AudioStreamEncoder::encode_and_send_aac(const float* samples, size_t frames) {
-    if (!impl_ || !impl_->codec_context || !impl_->frame || !impl_->shout) {
-        Logger::error("AAC encoding not fully available - missing components");
+bool SharedStreamEncoder::encode_opus(const float* samples, size_t frames) {
+    if (!impl_->opus_encoder) {
+        set_error("Opus encoder not open");
         return false;
     }
     
-    try {
-        // Configure frame
-        impl_->frame->nb_samples = frames;
-        impl_->frame->format = impl_->codec_context->sample_fmt;
-        impl_->frame->channel_layout = impl_->codec_context->channel_layout;
+    const float* input = samples;
+    size_t input_frames = frames;
+    
+    if (impl_->resampler) {
+        const int capacity = swr_get_out_samples(impl_->resampler, static_cast<int>(frames));
+        if (impl_->resample_buffer.size() < static_cast<size_t>(capacity) * profile_.channels) {
+            impl_->resample_buffer.resize(static_cast<size_t>(capacity) * profile_.channels);
+        }
         
-        // Get buffer for frame
-        int ret = av_frame_get_buffer(impl_->frame, 0);
-        if (ret < 0) {
-            Logger::error("Failed to get AAC frame buffer");
+        uint8_t* out = reinterpret_cast<uint8_t*>(impl_->resample_buffer.data());
+        const uint8_t* in = reinterpret_cast<const uint8_t*>(samples);
+        const int converted = swr_convert(impl_->resampler, &out, capacity, &in, static_cast<int>(frames));
+        if (converted < 0) {
+            set_error("Opus resampling failed");
+            return false;
+        }
+        input = impl_->resample_buffer.data();
+        input_frames = static_cast<size_t>(converted);
+    }
+    
+    const bool ok = accumulate_blocks(input, input_frames, profile_.channels, kOpusFrameSamples,
+                                      impl_->pending, impl_->pending_frames, [this](const float* block) {
+        auto& out = impl_->encoded_buffer;
+        const opus_int32 bytes = opus_encode_float(impl_->opus_encoder, block, kOpusFrameSamples,
+                                                   out.data(), static_cast<opus_int32>(out.size()));
+        if (bytes < 0) {
+            set_error("Opus encoding error: " + std::string(opus_strerror(bytes)));
             return false;
         }
         
-        // Convert interleaved float samples to planar format
-        float** frame_data = (float**)impl_->frame->data;
+        impl_->opus_granule_pos += kOpusFrameSamples;
         
-        if (config_.channels == 1) {
-            // Mono
-            memcpy(frame_data[0], samples, frames * sizeof(float));
-        } else {
-            // Stereo - deinterleave
-            for (size_t i = 0; i < frames; i++) {
-                frame_data[0][i] = samples[i * 2];     // Left
-                frame_data[1][i] = samples[i * 2 + 1]; // Right
-            }
+        ogg_packet packet{};
+        packet.packet = out.data();
+        packet.bytes = bytes;
+        packet.granulepos = static_cast<ogg_int64_t>(impl_->opus_granule_pos);
+        packet.packetno = static_cast<ogg_int64_t>(impl_->opus_packet_count++);
+        ogg_stream_packetin(&impl_->ogg_stream_obj, &packet);
+        return true;
+    });
+    
+    emit_ogg_pages(false, false);
+    return ok;
+}
+
+bool SharedStreamEncoder::encode_aac(const float* samples, size_t frames) {
+    if (!impl_->codec_context || !impl_->frame) {
+        set_error("AAC encoder not open");
+        return false;
+    }
+    
+    return accumulate_blocks(samples, frames, profile_.channels, impl_->block_frames,
+                             impl_->pending, impl_->pending_frames, [this](const float* block) {
+        // The encoder may still reference the previous frame's data
+        int ret = av_frame_make_writable(impl_->frame);
+        if (ret < 0) {
+            set_error("AAC frame not writable: " + std::to_string(ret));
+            return false;
         }
         
-        // Send frame to encoder
+        deinterleave(block, reinterpret_cast<float* const*>(impl_->frame->data),
+                     profile_.channels, impl_->block_frames);
+        impl_->frame->pts = impl_->aac_pts;
+        impl_->aac_pts += static_cast<int64_t>(impl_->block_frames);
+        
         ret = avcodec_send_frame(impl_->codec_context, impl_->frame);
         if (ret < 0) {
-            Logger::error("Failed to send frame to AAC encoder: " + std::to_string(ret));
+            set_error("Failed to send frame to AAC encoder: " + std::to_string(ret));
             return false;
         }
         
@@ -628,60 +1377,78 @@ bool AudioStreamEncoder::encode_and_send_aac(const float* samples, size_t frames
             if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
                 break; // Need more input or end of stream
             } else if (ret < 0) {
-                Logger::error("AAC encoding error: " + std::to_string(ret));
+                set_error("AAC encoding error: " + std::to_string(ret));
                 return false;
             }
             
-            // Send encoded packet to server
-            int shout_ret = shout_send(impl_->shout, impl_->packet->data, impl_->packet->size);
-            if (shout_ret != SHOUTERR_SUCCESS) {
-                Logger::error("Failed to send AAC data: " + std::string(shout_get_error(impl_->shout)));
-                av_packet_unref(impl_->packet);
-                return false;
-            }
-            
-            // Update statistics
-            impl_->bytes_sent += impl_->packet->size;
-            
-            // Clean up packet
+            emit_packet(impl_->packet->data, impl_->packet->size, impl_->block_frames);
             av_packet_unref(impl_->packet);
         }
-        
-        // Sync with server
-        shout_sync(impl_->shout);
-        
-        // Clean up frame
-        av_frame_unref(impl_->frame);
-        
         return true;
-        
-    } catch (const std::exception& e) {
-        Logger::error("AAC encoding error: " + std::string(e.what()));
-        return false;
-    }
+    });
 }
 
-void AudioStreamEncoder::handle_connection_error(const std::string& error) {
-    status_ = StreamStatus::ERROR;
-    status_message_ = error;
-    Logger::error("Stream error: " + error);
+// SharedEncoderPool implementation
+SharedEncoderPool::SharedEncoderPool(ReaderFactory make_reader) : make_reader_(std::move(make_reader)) {}
+
+SharedEncoderPool::~SharedEncoderPool() {
+    clear();
+}
+
+std::shared_ptr<SharedStreamEncoder> SharedEncoderPool::acquire(const EncoderProfile& profile) {
+    std::lock_guard<std::mutex> lock(mutex_);
     
-    if (config_.auto_reconnect) {
-        // TODO: Implement auto-reconnection logic
-        Logger::info("Auto-reconnect will be attempted");
+    auto it = encoders_.find(profile);
+    if (it != encoders_.end()) {
+        if (it->second->is_running()) {
+            return it->second;
+        }
+        // Worker died on an encoding error; replace it
+        encoders_.erase(it);
+    }
+    
+    auto encoder = std::make_shared<SharedStreamEncoder>(profile);
+    if (!encoder->open() || !encoder->start(make_reader_())) {
+        Logger::error("Failed to start shared encoder " + profile.to_string() + ": " + encoder->get_error());
+        return nullptr;
     }
+    
+    encoders_[profile] = encoder;
+    return encoder;
 }
 
-void AudioStreamEncoder::update_statistics() {
-    auto now = std::chrono::steady_clock::now();
-    impl_->stats.total_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now - impl_->start_time).count();
-    
-    // Calculate current bitrate based on bytes sent
-    if (impl_->stats.total_time > 0) {
-        impl_->stats.current_bitrate = (impl_->stats.bytes_sent * 8.0) / 
-                                      (impl_->stats.total_time / 1000.0) / 1000.0;
+void SharedEncoderPool::release_idle() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = encoders_.begin(); it != encoders_.end();) {
+        if (it->second->sink_count() == 0) {
+            it->second->stop();
+            it = encoders_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SharedEncoderPool::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [profile, encoder] : encoders_) {
+        encoder->stop();
+    }
+    encoders_.clear();
+}
+
+size_t SharedEncoderPool::encoder_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return encoders_.size();
+}
+
+std::vector<EncoderProfile> SharedEncoderPool::active_profiles() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<EncoderProfile> profiles;
+    for (const auto& [profile, encoder] : encoders_) {
+        profiles.push_back(profile);
     }
+    return profiles;
 }
 
 // Static utility functions
@@ -735,6 +1502,27 @@ std::string AudioStreamEncoder::protocol_to_string(StreamProtocol protocol) {
     }
 }
 
+StreamCodec AudioStreamEncoder::string_to_codec(const std::string& codec_str) {
+    std::string codec = codec_str;
+    std::transform(codec.begin(), codec.end(), codec.begin(), ::tolower);
+    
+    if (codec == "ogg" || codec == "vorbis" || codec == "ogg vorbis") return StreamCodec::OGG_VORBIS;
+    if (codec == "opus" || codec == "ogg opus") return StreamCodec::OGG_OPUS;
+    if (codec == "aac") return StreamCodec::AAC;
+    if (codec == "flac") return StreamCodec::FLAC;
+    return StreamCodec::MP3;
+}
+
+StreamProtocol AudioStreamEncoder::string_to_protocol(const std::string& protocol_str) {
+    std::string protocol = protocol_str;
+    std::transform(protocol.begin(), protocol.end(), protocol.begin(), ::tolower);
+    
+    if (protocol == "shoutcast" || protocol == "icy") return StreamProtocol::SHOUTCAST;
+    if (protocol == "http") return StreamProtocol::HTTP;
+    if (protocol == "rtmp") return StreamProtocol::RTMP;
+    return StreamProtocol::ICECAST2;
+}
+
 // StreamConfigBuilder implementation
 StreamConfigBuilder& StreamConfigBuilder::icecast2(const std::string& host, int port, const std::string& mount, const std::string& password) {
     config_.protocol = StreamProtocol::ICECAST2;
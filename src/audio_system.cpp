@@ -1,9 +1,22 @@
 #include "audio_system.hpp"
 #include "utils/logger.hpp"
+#include "utils/spsc_queue.hpp"
+#include "utils/seqlock.hpp"
+#include "utils/param_ramp.hpp"
+#include "dsp_kernels.hpp"
+#include "audio_decoder.hpp"
+#include "time_stretcher.hpp"
+#include "deck_equalizer.hpp"
+#include "dynamics_processor.hpp"
+#include "audio_stream_encoder.hpp"
+#include "disk_recorder.hpp"
+#include "metrics_registry.hpp"
+#include "trace_profiler.hpp"
+#include "utils/audio_ring_buffer.hpp"
 #include <portaudio.h>
 #include <samplerate.h>
 #include <fftw3.h>
-#include <sndfile.h>
+#include <array>
 #include <chrono>
 #include <cmath>
 #include <algorithm>
@@ -18,8 +31,201 @@ extern "C" {
 #include <libavutil/time.h>
 }
 
+namespace {
+
+constexpr int kMaxMixChannels = 16;
+constexpr size_t kControlQueueCapacity = 256;
+constexpr int kDeckCount = 2;
+constexpr float kDezipperMs = 10.0f;    // Ramp for plain gain setters, so steps never click
+constexpr size_t kDeckScratchSamples = 8192;    // Track-format samples per source read
+
+enum class CrossfaderSide : uint8_t {
+    NONE,
+    A,
+    B
+};
+
+/**
+ * Immutable mix topology read by the audio callback.
+ * Built on a control thread and published with an atomic pointer swap;
+ * never modified once published.
+ */
+struct MixGraph {
+    struct Entry {
+        AudioChannel* channel = nullptr;
+        int slot = 0;
+        CrossfaderSide side = CrossfaderSide::NONE;
+    };
+    
+    struct LiveEntry {
+        std::shared_ptr<LiveInput> input;   // Released with the graph
+        int slot = 0;
+    };
+    
+    std::vector<Entry> channels;
+    std::vector<LiveEntry> live_inputs;
+    AudioSystem::AudioCallback callback;
+    
+    // Deck A and B tracks; released with the graph, never on the audio thread
+    std::array<std::shared_ptr<const DecodedTrack>, kDeckCount> decks;
+};
+
+/**
+ * Parameter change sent from control threads to the audio thread
+ */
+struct ControlCommand {
+    enum class Type : uint8_t {
+        MASTER_VOLUME,
+        CROSSFADER,
+        CHANNEL_GAIN,   // value = left gain, value2 = right gain
+        MIC_GAIN,
+        DUCK_GAIN,      // Ducks the decks and channels, not the mic or live inputs
+        MIC_GATE,       // value = linear threshold, value2 > 0 when gate enabled
+        BEAT_RESET,     // Forget the slot's tempo (a new channel took it)
+        BPM_SYNC,       // slot = master, value = slave slot; slot < 0 disables
+        DECK_PLAY,      // slot = deck, value > 0 plays
+        DECK_SEEK,      // slot = deck, frame = track frame
+        DECK_GAIN,      // slot = deck
+        DECK_RATE,      // slot = deck, value = playback rate
+        DECK_PITCH,     // slot = deck, value = semitones
+        DECK_KEY_LOCK,  // slot = deck, value > 0 keeps the pitch when the rate changes
+        DECK_EQ_BAND,   // slot = deck, value = DeckEqBand, value2 = linear band gain
+        DECK_FILTER,    // slot = deck, value = -1 low-pass ... 1 high-pass
+        LIMITER,        // slot > 0 enables, value = ceiling dB, value2 = release ms
+        COMPRESSOR,     // slot > 0 enables, value = threshold dB, value2 = ratio
+        COMPRESSOR_TIMING   // value = attack ms, value2 = release ms
+    };
+    
+    Type type = Type::MASTER_VOLUME;
+    int slot = 0;
+    float value = 0.0f;
+    float value2 = 0.0f;
+    uint64_t frame = 0;
+    
+    // Gain commands ramp from the current value over this many frames; 0 jumps
+    uint32_t ramp_frames = 0;
+    RampShape shape = RampShape::LINEAR;
+};
+
+/**
+ * Mixer parameters owned exclusively by the audio thread
+ */
+struct RealtimeParams {
+    ParamRamp master_volume{0.8f};
+    ParamRamp duck_gain{1.0f};
+    float crossfader = 0.0f;
+    ParamRamp mic_gain{1.0f};
+    float mic_gate_threshold = 0.01f; // linear
+    bool mic_gate_enabled = true;
+    ParamRamp channel_gain_left[kMaxMixChannels];
+    ParamRamp channel_gain_right[kMaxMixChannels];
+    int sync_master_slot = -1;
+    int sync_slave_slot = -1;
+};
+
+/**
+ * Playback of one deck, owned by the audio thread. The track pointer is
+ * pinned by the current MixGraph.
+ */
+struct DeckVoice : OneStopRadio::TimeStretchSource {
+    const DecodedTrack* track = nullptr;
+    bool playing = false;
+    ParamRamp gain{1.0f};
+    uint64_t start_frame = 0;   // Track frame at the stretcher's last reset
+    uint64_t read_frame = 0;    // Next track frame handed to the stretcher
+    int channels = 2;           // Engine channels
+    std::vector<float> scratch;
+    std::vector<float> block;   // This callback's output, engine layout
+    std::unique_ptr<OneStopRadio::TimeStretcher> stretcher;
+    
+    void seek(uint64_t frame) {
+        start_frame = read_frame = frame;
+        if (stretcher) {
+            stretcher->reset();
+        }
+    }
+    
+    uint64_t heard_frame() const {
+        return start_frame + static_cast<uint64_t>(stretcher ? stretcher->source_position() : 0.0);
+    }
+    
+    // Track frames in the engine's channel layout; audio not decoded yet plays as silence
+    void read(float* out, size_t frames) override {
+        const int source_channels = track ? track->channels() : channels;
+        const size_t block = scratch.size() / static_cast<size_t>(source_channels);
+        for (size_t done = 0; done < frames;) {
+            const size_t n = std::min(frames - done, block);
+            const size_t got = track ? track->read(read_frame, scratch.data(), n) : 0;
+            std::fill(scratch.begin() + got * source_channels, scratch.begin() + n * source_channels, 0.0f);
+            
+            float* dst = out + done * channels;
+            if (source_channels == channels) {
+                std::copy(scratch.begin(), scratch.begin() + n * channels, dst);
+            } else {
+                for (size_t i = 0; i < n; ++i) {
+                    for (int ch = 0; ch < channels; ++ch) {
+                        dst[i * channels + ch] = scratch[i * source_channels + std::min(ch, source_channels - 1)];
+                    }
+                }
+            }
+            read_frame += n;
+            done += n;
+        }
+    }
+};
+
+// Decks are "A" and "B" here and "deck_a" and "deck_b" in RadioControl
+int deck_index(const std::string& channel_id) {
+    if (channel_id == "A" || channel_id == "deck_a") return 0;
+    if (channel_id == "B" || channel_id == "deck_b") return 1;
+    return -1;
+}
+
+CrossfaderSide crossfader_side_for(const std::string& channel_id) {
+    // Simple A/B crossfader assignment by channel name
+    if (channel_id.find("A") != std::string::npos) return CrossfaderSide::A;
+    if (channel_id.find("B") != std::string::npos) return CrossfaderSide::B;
+    return CrossfaderSide::NONE;
+}
+
+// Callback health, shared by every AudioSystem in the process
+struct AudioMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    MetricHistogram& callback_seconds = registry.histogram(
+        "onestop_audio_callback_seconds", "Audio callback run time",
+        MetricsRegistry::exponential_buckets(0.0000625, 2.0, 12));
+    MetricHistogram& callback_load = registry.histogram(
+        "onestop_audio_callback_load", "Audio callback run time over its buffer period",
+        {0.05, 0.1, 0.25, 0.5, 0.75, 0.9, 1.0, 1.5, 2.0});
+    MetricCounter& deadline_misses = registry.counter(
+        "onestop_audio_deadline_misses_total", "Audio callbacks that ran longer than their buffer period");
+    MetricCounter& input_underflows = registry.counter(
+        "onestop_audio_xruns_total", "PortAudio xrun flags seen by the callback", {{"type", "input_underflow"}});
+    MetricCounter& input_overflows = registry.counter(
+        "onestop_audio_xruns_total", "PortAudio xrun flags seen by the callback", {{"type", "input_overflow"}});
+    MetricCounter& output_underflows = registry.counter(
+        "onestop_audio_xruns_total", "PortAudio xrun flags seen by the callback", {{"type", "output_underflow"}});
+    MetricCounter& output_overflows = registry.counter(
+        "onestop_audio_xruns_total", "PortAudio xrun flags seen by the callback", {{"type", "output_overflow"}});
+    MetricGauge& control_queue_depth = registry.gauge(
+        "onestop_audio_control_queue_depth", "Parameter changes waiting for the audio callback");
+};
+
+AudioMetrics& audio_metrics() {
+    static AudioMetrics metrics;
+    return metrics;
+}
+
+} // namespace
+
 /**
  * AudioSystem Implementation Class
+ *
+ * Threading model: the PortAudio callback never locks or allocates. Control
+ * threads publish topology (channels, external callback) as an immutable
+ * MixGraph and push scalar parameter changes through an SPSC command queue
+ * (producers serialize on control_mutex_). Meters are published back through
+ * seqlocks.
  */
 class AudioSystem::Impl {
 public:
@@ -32,7 +238,12 @@ public:
         , master_volume_(0.8f)
         , sample_rate_(48000)
         , channels_(2)
-        , frames_per_buffer_(512) {
+        , frames_per_buffer_(512)
+        , control_queue_(kControlQueueCapacity)
+        , graph_(new MixGraph()) {
+        
+        slot_in_use_.fill(false);
+        track_cache_->start();
         
         // Initialize PortAudio
         PaError err = Pa_Initialize();
@@ -49,9 +260,15 @@ public:
     }
     
     ~Impl() {
+        spectrum_->stop();
+        track_cache_->stop();
         stop_audio_stream();
         Pa_Terminate();
         
+        // No callbacks can run any more; release all published state
+        delete graph_.exchange(nullptr);
+        free_all_retired();
+        
         // Cleanup FFmpeg resources
         cleanup_encoders();
     }
@@ -60,25 +277,58 @@ public:
         format_ = format;
         sample_rate_ = format.sample_rate;
         channels_ = format.channels;
+        track_cache_->set_sample_rate(sample_rate_);   // Decks play files at any rate
         
-        // Initialize audio buffers
+        // Initialize audio buffers (the callback never resizes these)
         input_buffer_.resize(frames_per_buffer_ * channels_);
         output_buffer_.resize(frames_per_buffer_ * channels_);
         mix_buffer_.resize(frames_per_buffer_ * channels_);
+        channel_buffer_.resize(frames_per_buffer_ * channels_);
+        mic_buffer_.assign(frames_per_buffer_ * channels_, 0.0f);
         
         // Initialize level meters
         reset_level_meters();
         
+        // Master bus ring for encoders and the recorder (a few seconds of headroom)
+        master_ring_ = AudioRingBuffer::create(static_cast<size_t>(sample_rate_) * 4, channels_, sample_rate_);
+        encoder_pool_ = std::make_unique<SharedEncoderPool>([ring = master_ring_] { return ring->create_reader(); });
+        
+        // One streaming beat tracker per mixer slot, owned by the audio thread
+        OneStopRadio::BeatTrackerOptions beat_options;
+        beat_options.sample_rate = sample_rate_;
+        for (auto& tracker : beat_trackers_) {
+            tracker = std::make_unique<OneStopRadio::BeatTracker>(beat_options);
+        }
+        beat_mono_.assign(frames_per_buffer_, 0.0f);
+        
+        // Deck time-stretchers, sized for the largest callback
+        OneStopRadio::TimeStretcherOptions stretch_options;
+        stretch_options.sample_rate = sample_rate_;
+        stretch_options.channels = channels_;
+        stretch_options.max_block_frames = static_cast<size_t>(frames_per_buffer_);
+        for (DeckVoice& deck : decks_) {
+            deck.channels = channels_;
+            deck.scratch.assign(kDeckScratchSamples, 0.0f);
+            deck.block.assign(frames_per_buffer_ * channels_, 0.0f);
+            deck.stretcher = std::make_unique<OneStopRadio::TimeStretcher>(stretch_options);
+        }
+        
+        // Deck EQ: bass/mid/treble shelves and the sweep filter, both decks per pass
+        OneStopRadio::DeckEqOptions eq_options;
+        eq_options.sample_rate = sample_rate_;
+        deck_eq_ = std::make_unique<OneStopRadio::DeckEqualizer>(eq_options);
+        eq_lanes_.assign(static_cast<size_t>(frames_per_buffer_) * OneStopRadio::DeckEqualizer::kLanes, 0.0f);
+        
+        // Resolve SIMD dispatch now rather than on the first audio callback
+        Logger::info(std::string("AudioSystem: DSP kernels: ") + dsp::kernels().name);
+        
         // Initialize master effect chain
         master_effects_ = std::make_unique<AudioEffectChain>();
         
-        // Add default master limiter
-        auto limiter = std::make_unique<AudioCompressor>("master_limiter");
-        limiter->set_threshold(-1.0f);
-        limiter->set_ratio(10.0f);
-        limiter->set_attack(1.0f);
-        limiter->set_release(50.0f);
-        master_effects_->add_effect(std::move(limiter));
+        // Master dynamics: the one limiter every output shares
+        dynamics_config_.sample_rate = sample_rate_;
+        dynamics_config_.channels = channels_;
+        dynamics_ = std::make_unique<OneStopRadio::DynamicsProcessor>(dynamics_config_);
         
         Logger::info("AudioSystem initialized with " + std::to_string(sample_rate_) + " Hz, " + std::to_string(channels_) + " channels");
         return true;
@@ -135,6 +385,7 @@ public:
         }
         
         running_ = true;
+        state_changed();
         
         // Start processing thread
         processing_thread_ = std::thread(&Impl::processing_loop, this);
@@ -143,6 +394,32 @@ public:
         return true;
     }
     
+    // Everything start() does except opening the device
+    bool start_headless() {
+        if (running_) {
+            Logger::warn("AudioSystem is already running");
+            return true;
+        }
+        headless_ = true;
+        running_ = true;
+        state_changed();
+        processing_thread_ = std::thread(&Impl::processing_loop, this);
+        
+        Logger::info("AudioSystem started without a device");
+        return true;
+    }
+    
+    // One callback per preallocated buffer, as a device would call it
+    void render_blocks(const float* input, float* output, int frames) {
+        const int block = frames_per_buffer_;
+        for (int offset = 0; offset < frames; offset += block) {
+            const int n = std::min(block, frames - offset);
+            const size_t sample_offset = static_cast<size_t>(offset) * channels_;
+            audio_callback(input ? input + sample_offset : nullptr, output + sample_offset,
+                           static_cast<unsigned long>(n), nullptr, 0);
+        }
+    }
+    
     void stop() {
         if (!running_) return;
         
@@ -155,10 +432,102 @@ public:
         }
         
         stop_audio_stream();
+        headless_ = false;
+        state_changed();
+        
+        // Stream is closed, so retired graphs can no longer be referenced
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        free_all_retired();
         
         Logger::info("AudioSystem stopped");
     }
     
+    // ===== CONTROL PLANE (non-real-time threads only) =====
+    
+    uint32_t ramp_frames(float ms) const {
+        return static_cast<uint32_t>(std::max(0.0f, ms) * static_cast<float>(sample_rate_) / 1000.0f);
+    }
+    
+    bool push_command(const ControlCommand& command) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (!control_queue_.try_push(command)) {
+            Logger::warn("AudioSystem: Control queue full, dropping parameter update");
+            return false;
+        }
+        state_changed();
+        return true;
+    }
+    
+    // After every control-plane change, for SnapshotCache users
+    void state_changed() {
+        state_generation_.fetch_add(1, std::memory_order_release);
+    }
+    
+    // Rebuild and publish the mix graph. Caller holds channels_mutex_.
+    void publish_graph() {
+        auto graph = std::make_unique<MixGraph>();
+        graph->channels.reserve(active_channels_.size());
+        for (const auto& [channel_id, channel] : active_channels_) {
+            MixGraph::Entry entry;
+            entry.channel = channel.get();
+            entry.slot = channel_slots_[channel_id];
+            entry.side = crossfader_side_for(channel_id);
+            graph->channels.push_back(entry);
+        }
+        for (const auto& [input_id, input] : live_inputs_) {
+            graph->live_inputs.push_back({input, channel_slots_[input_id]});
+        }
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex_);
+            graph->callback = parent_->audio_callback_;
+        }
+        graph->decks = deck_tracks_;
+        
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        MixGraph* old_graph = graph_.exchange(graph.release());
+        retired_graphs_.emplace_back(callbacks_completed_.load(), std::unique_ptr<MixGraph>(old_graph));
+        collect_retired();
+        state_changed();
+    }
+    
+    // Hand a removed channel to the reclaimer. Caller holds channels_mutex_.
+    void retire_channel(std::unique_ptr<AudioChannel> channel) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        retired_channels_.emplace_back(callbacks_completed_.load(), std::move(channel));
+    }
+    
+    int allocate_slot() {
+        for (int i = 0; i < kMaxMixChannels; ++i) {
+            if (!slot_in_use_[i]) {
+                slot_in_use_[i] = true;
+                return i;
+            }
+        }
+        return -1;
+    }
+    
+    void release_slot(int slot) {
+        if (slot >= 0 && slot < kMaxMixChannels) {
+            slot_in_use_[slot] = false;
+        }
+    }
+    
+    // Free anything the audio thread can no longer see. Caller holds control_mutex_.
+    void collect_retired() {
+        // Anything retired before the last completed callback started is unreachable
+        const uint64_t completed = callbacks_completed_.load();
+        auto reclaimable = [completed](const auto& entry) { return entry.first < completed; };
+        retired_graphs_.erase(std::remove_if(retired_graphs_.begin(), retired_graphs_.end(), reclaimable),
+                              retired_graphs_.end());
+        retired_channels_.erase(std::remove_if(retired_channels_.begin(), retired_channels_.end(), reclaimable),
+                                retired_channels_.end());
+    }
+    
+    void free_all_retired() {
+        retired_graphs_.clear();
+        retired_channels_.clear();
+    }
+    
     // Audio callback function
     static int audio_callback_static(const void* input_buffer, void* output_buffer,
                                    unsigned long frames_per_buffer,
@@ -174,56 +543,192 @@ public:
                       const PaStreamCallbackTimeInfo* time_info,
                       PaStreamCallbackFlags status_flags) {
         
+        TRACE_THREAD_NAME("audio_callback");
+        TRACE_SCOPE("audio_callback");
+        const auto callback_start = std::chrono::steady_clock::now();
         const float* input = static_cast<const float*>(input_buffer);
         float* output = static_cast<float*>(output_buffer);
         
+        if (status_flags) {
+            record_xruns(status_flags);
+        }
+        
         // Clear output buffer
         std::fill(output, output + frames_per_buffer * channels_, 0.0f);
         
+        // Never process more than the preallocated buffers hold
+        const unsigned long frames = std::min<unsigned long>(frames_per_buffer, frames_per_buffer_);
+        
+        // Apply pending parameter changes, then pin the current topology
+        metrics_.control_queue_depth.set(static_cast<double>(control_queue_.size()));
+        drain_control_queue();
+        const MixGraph* graph = graph_.load();
+        
         // Process microphone input
         if (mic_enabled_ && input) {
-            process_microphone_input(input, frames_per_buffer);
+            process_microphone_input(input, frames);
         }
         
         // Mix all active audio channels
-        mix_audio_channels(output, frames_per_buffer);
+        {
+            TRACE_SCOPE("mix");
+            mix_audio_channels(*graph, output, frames);
+        }
         
         // Apply master effects
         if (master_effects_) {
-            master_effects_->process(output, frames_per_buffer, channels_);
+            TRACE_SCOPE("master_effects");
+            master_effects_->process(output, frames, channels_);
         }
         
-        // Apply master volume
-        for (unsigned long i = 0; i < frames_per_buffer * channels_; ++i) {
-            output[i] *= master_volume_;
+        // Apply master volume; the duck was applied in the mix, under the voices
+        ParamRamp& master = rt_params_.master_volume;
+        if (master.ramping()) {
+            apply_ramped_gain(output, frames, master);
+        } else {
+            dsp::apply_gain(output, frames * channels_, master.value());
+        }
+        
+        // Compress and limit once, before the program fans out
+        if (dynamics_) {
+            TRACE_SCOPE("dynamics");
+            dynamics_->process(output, frames);
         }
         
         // Update level meters
-        update_level_meters(output, frames_per_buffer);
+        update_level_meters(output, frames);
+        
+        if (rt_params_.sync_master_slot >= 0) {
+            update_bpm_sync();
+        }
         
         // Call external audio callback if set
-        {
-            std::lock_guard<std::mutex> lock(callback_mutex_);
-            if (parent_->audio_callback_) {
-                parent_->audio_callback_(input, output, frames_per_buffer, channels_);
-            }
+        if (graph->callback) {
+            graph->callback(input, output, frames, channels_);
+        }
+        
+        // Publish the final program to encoders and the recorder
+        master_ring_->write(output, frames);
+        
+        // Run time against the period this buffer covers
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - callback_start).count();
+        const double budget = static_cast<double>(frames_per_buffer) / sample_rate_;
+        metrics_.callback_seconds.observe(elapsed);
+        metrics_.callback_load.observe(elapsed / budget);
+        if (elapsed > budget) {
+            metrics_.deadline_misses.increment();
         }
         
+        // Lets control threads reclaim graphs retired before this callback
+        callbacks_completed_.fetch_add(1);
+        
         return paContinue;
     }
     
+    void record_xruns(PaStreamCallbackFlags status_flags) {
+        if (status_flags & paInputUnderflow) metrics_.input_underflows.increment();
+        if (status_flags & paInputOverflow) metrics_.input_overflows.increment();
+        if (status_flags & paOutputUnderflow) metrics_.output_underflows.increment();
+        if (status_flags & paOutputOverflow) metrics_.output_overflows.increment();
+    }
+    
+    void drain_control_queue() {
+        ControlCommand command;
+        while (control_queue_.try_pop(command)) {
+            switch (command.type) {
+                case ControlCommand::Type::MASTER_VOLUME:
+                    rt_params_.master_volume.ramp_to(command.value, command.ramp_frames, command.shape);
+                    break;
+                case ControlCommand::Type::DUCK_GAIN:
+                    rt_params_.duck_gain.ramp_to(command.value, command.ramp_frames, command.shape);
+                    break;
+                case ControlCommand::Type::CROSSFADER:
+                    rt_params_.crossfader = command.value;
+                    break;
+                case ControlCommand::Type::CHANNEL_GAIN:
+                    if (command.slot >= 0 && command.slot < kMaxMixChannels) {
+                        rt_params_.channel_gain_left[command.slot].ramp_to(command.value, command.ramp_frames, command.shape);
+                        rt_params_.channel_gain_right[command.slot].ramp_to(command.value2, command.ramp_frames, command.shape);
+                    }
+                    break;
+                case ControlCommand::Type::MIC_GAIN:
+                    rt_params_.mic_gain.ramp_to(command.value, command.ramp_frames, command.shape);
+                    break;
+                case ControlCommand::Type::MIC_GATE:
+                    rt_params_.mic_gate_threshold = command.value;
+                    rt_params_.mic_gate_enabled = command.value2 > 0.0f;
+                    break;
+                case ControlCommand::Type::BEAT_RESET:
+                    if (command.slot >= 0 && command.slot < kMaxMixChannels && beat_trackers_[command.slot]) {
+                        beat_trackers_[command.slot]->reset();
+                    }
+                    break;
+                case ControlCommand::Type::BPM_SYNC:
+                    rt_params_.sync_master_slot = command.slot;
+                    rt_params_.sync_slave_slot = static_cast<int>(command.value);
+                    if (command.slot < 0) {
+                        bpm_sync_.store(BpmSyncStatus());
+                    }
+                    break;
+                case ControlCommand::Type::DECK_EQ_BAND:
+                    if (deck_eq_) {
+                        deck_eq_->set_band(command.slot, static_cast<OneStopRadio::DeckEqBand>(static_cast<int>(command.value)),
+                                           command.value2);
+                    }
+                    break;
+                case ControlCommand::Type::DECK_FILTER:
+                    if (deck_eq_) deck_eq_->set_filter(command.slot, command.value);
+                    break;
+                case ControlCommand::Type::LIMITER:
+                    if (dynamics_) dynamics_->set_limiter(command.slot > 0, command.value, command.value2);
+                    break;
+                case ControlCommand::Type::COMPRESSOR:
+                    if (dynamics_) dynamics_->set_compressor(command.slot > 0, command.value, command.value2);
+                    break;
+                case ControlCommand::Type::COMPRESSOR_TIMING:
+                    if (dynamics_) dynamics_->set_compressor_timing(command.value, command.value2);
+                    break;
+                default:
+                    if (command.slot >= 0 && command.slot < kDeckCount) {
+                        apply_deck_command(decks_[command.slot], command);
+                    }
+                    break;
+            }
+        }
+    }
+    
+    void apply_deck_command(DeckVoice& deck, const ControlCommand& command) {
+        switch (command.type) {
+            case ControlCommand::Type::DECK_PLAY:
+                deck.playing = command.value > 0.0f && deck.track;
+                break;
+            case ControlCommand::Type::DECK_SEEK:
+                deck.seek(command.frame);
+                break;
+            case ControlCommand::Type::DECK_GAIN:
+                deck.gain.ramp_to(command.value, command.ramp_frames, command.shape);
+                break;
+            case ControlCommand::Type::DECK_RATE:
+                if (deck.stretcher) deck.stretcher->set_rate(command.value);
+                break;
+            case ControlCommand::Type::DECK_PITCH:
+                if (deck.stretcher) deck.stretcher->set_pitch_shift(command.value);
+                break;
+            case ControlCommand::Type::DECK_KEY_LOCK:
+                if (deck.stretcher) deck.stretcher->set_key_lock(command.value > 0.0f);
+                break;
+            default:
+                break;
+        }
+    }
+    
     void process_microphone_input(const float* input, unsigned long frames) {
-        if (!mic_enabled_) return;
-        
-        std::lock_guard<std::mutex> lock(mic_mutex_);
-        
         // Apply microphone gain
-        for (unsigned long i = 0; i < frames * channels_; ++i) {
-            mic_buffer_[i] = input[i] * mic_config_.gain;
-        }
+        std::copy(input, input + frames * channels_, mic_buffer_.begin());
+        apply_ramped_gain(mic_buffer_.data(), frames, rt_params_.mic_gain);
         
         // Apply noise gate
-        if (mic_config_.gate_threshold > -60.0f) {
+        if (rt_params_.mic_gate_enabled) {
             apply_noise_gate(mic_buffer_.data(), frames);
         }
         
@@ -233,53 +738,271 @@ public:
         // Mix microphone into master output (this will be done in mix_audio_channels)
     }
     
-    void mix_audio_channels(float* output, unsigned long frames) {
+    void mix_audio_channels(const MixGraph& graph, float* output, unsigned long frames) {
+        const unsigned long samples = frames * channels_;
+        
         // Clear mix buffer
-        std::fill(mix_buffer_.begin(), mix_buffer_.end(), 0.0f);
+        std::fill(mix_buffer_.begin(), mix_buffer_.begin() + samples, 0.0f);
         
         // Mix all active channels
-        {
-            std::lock_guard<std::mutex> lock(channels_mutex_);
-            for (auto& [channel_id, channel] : active_channels_) {
-                if (channel && channel->is_playing()) {
-                    // Get audio from channel
-                    channel->process_audio(channel_buffer_.data(), frames, channels_);
-                    
-                    // Apply crossfader
-                    float channel_gain = calculate_crossfader_gain(channel_id);
-                    
-                    // Mix into buffer
-                    for (unsigned long i = 0; i < frames * channels_; ++i) {
-                        mix_buffer_[i] += channel_buffer_[i] * channel_gain;
-                    }
-                }
+        for (const auto& entry : graph.channels) {
+            if (!entry.channel->is_playing()) {
+                continue;
+            }
+            
+            // Get audio from channel
+            entry.channel->process_audio(channel_buffer_.data(), frames, channels_);
+            track_beats(entry.slot, channel_buffer_.data(), frames);
+            accumulate_channel(entry.slot, calculate_crossfader_gain(entry.side), frames);
+        }
+        
+        render_decks(graph, frames);
+        
+        // Talkover ducks the music only, so it goes before the voices are added
+        ParamRamp& duck = rt_params_.duck_gain;
+        if (duck.ramping()) {
+            apply_ramped_gain(mix_buffer_.data(), frames, duck);
+        } else if (duck.value() != 1.0f) {
+            dsp::apply_gain(mix_buffer_.data(), samples, duck.value());
+        }
+        
+        // Live inputs that missed this period are silent for it
+        for (const auto& entry : graph.live_inputs) {
+            if (entry.input->read(channel_buffer_.data(), frames)) {
+                accumulate_channel(entry.slot, 1.0f, frames);
             }
         }
         
         // Add microphone if enabled
         if (mic_enabled_) {
-            std::lock_guard<std::mutex> lock(mic_mutex_);
-            for (unsigned long i = 0; i < frames * channels_; ++i) {
-                mix_buffer_[i] += mic_buffer_[i];
-            }
+            dsp::mix_accumulate(mix_buffer_.data(), mic_buffer_.data(), samples, 1.0f);
         }
         
         // Copy to output
-        std::copy(mix_buffer_.begin(), mix_buffer_.begin() + frames * channels_, output);
+        std::copy(mix_buffer_.begin(), mix_buffer_.begin() + samples, output);
+    }
+    
+    // Add channel_buffer_ to the mix with the slot's gain
+    void accumulate_channel(int slot, float fader_gain, unsigned long frames) {
+        const unsigned long samples = frames * channels_;
+        ParamRamp& left = rt_params_.channel_gain_left[slot];
+        ParamRamp& right = rt_params_.channel_gain_right[slot];
+        if (left.ramping() || right.ramping()) {
+            apply_channel_ramp(channel_buffer_.data(), frames, left, right);
+            dsp::mix_accumulate(mix_buffer_.data(), channel_buffer_.data(), samples, fader_gain);
+            return;
+        }
+        const float gain_left = left.value() * fader_gain;
+        const float gain_right = right.value() * fader_gain;
+        
+        // Mix into buffer
+        if (channels_ == 2) {
+            dsp::mix_accumulate_stereo(mix_buffer_.data(), channel_buffer_.data(), frames,
+                                       gain_left, gain_right);
+        } else if (channels_ == 1) {
+            dsp::mix_accumulate(mix_buffer_.data(), channel_buffer_.data(), frames, gain_left);
+        } else {
+            for (unsigned long i = 0; i < samples; i += channels_) {
+                mix_buffer_[i] += channel_buffer_[i] * gain_left;
+                for (int ch = 1; ch < channels_; ++ch) {
+                    mix_buffer_[i + ch] += channel_buffer_[i + ch] * gain_right;
+                }
+            }
+        }
+    }
+    
+    // Decks play through their time-stretchers and the EQ into the mix, on the crossfader
+    void render_decks(const MixGraph& graph, unsigned long frames) {
+        bool rendered[kDeckCount] = {};
+        for (int d = 0; d < kDeckCount; ++d) {
+            DeckVoice& deck = decks_[d];
+            const DecodedTrack* track = graph.decks[d].get();
+            if (track != deck.track) {
+                // A new track starts stopped at the top
+                deck.track = track;
+                deck.playing = false;
+                deck.seek(0);
+                if (track && deck.stretcher) {
+                    deck.stretcher->set_source_rate(track->sample_rate());
+                }
+                deck_positions_[d].store(0, std::memory_order_relaxed);
+            }
+            if (!deck.playing || !deck.stretcher) {
+                continue;
+            }
+            
+            deck.stretcher->render(deck.block.data(), frames, deck);
+            rendered[d] = true;
+            const uint64_t heard = deck.heard_frame();
+            deck_positions_[d].store(heard, std::memory_order_relaxed);
+            if (heard >= deck.track->frames()) {
+                deck.playing = false;
+            }
+        }
+        
+        equalize_decks(rendered, frames);
+        
+        for (int d = 0; d < kDeckCount; ++d) {
+            if (!rendered[d]) {
+                continue;
+            }
+            DeckVoice& deck = decks_[d];
+            float gain = calculate_crossfader_gain(d == 0 ? CrossfaderSide::A : CrossfaderSide::B);
+            if (deck.gain.ramping()) {
+                apply_ramped_gain(deck.block.data(), frames, deck.gain);
+            } else {
+                gain *= deck.gain.value();
+            }
+            dsp::mix_accumulate(mix_buffer_.data(), deck.block.data(), frames * channels_, gain);
+        }
+    }
+    
+    // Both decks go through the EQ together as its four lanes. A stopped deck
+    // feeds silence so its filters ring out; channels past the second are
+    // left unfiltered.
+    void equalize_decks(const bool (&rendered)[kDeckCount], unsigned long frames) {
+        if (!deck_eq_ || !deck_eq_->active()) {
+            return;
+        }
+        constexpr int kLanes = OneStopRadio::DeckEqualizer::kLanes;
+        const int right = channels_ > 1 ? 1 : 0;
+        float* lanes = eq_lanes_.data();
+        for (int d = 0; d < kDeckCount; ++d) {
+            const float* block = decks_[d].block.data();
+            for (unsigned long i = 0; i < frames; ++i) {
+                lanes[i * kLanes + 2 * d] = rendered[d] ? block[i * channels_] : 0.0f;
+                lanes[i * kLanes + 2 * d + 1] = rendered[d] ? block[i * channels_ + right] : 0.0f;
+            }
+        }
+        
+        deck_eq_->process(lanes, frames);
+        
+        for (int d = 0; d < kDeckCount; ++d) {
+            if (!rendered[d]) {
+                continue;
+            }
+            float* block = decks_[d].block.data();
+            for (unsigned long i = 0; i < frames; ++i) {
+                block[i * channels_] = lanes[i * kLanes + 2 * d];
+                if (right) {
+                    block[i * channels_ + 1] = lanes[i * kLanes + 2 * d + 1];
+                }
+            }
+        }
+    }
+    
+    // buffer *= gain, following the ramp sample by sample while it moves
+    void apply_ramped_gain(float* buffer, unsigned long frames, ParamRamp& gain) {
+        if (!gain.ramping()) {
+            dsp::apply_gain(buffer, frames * channels_, gain.value());
+            return;
+        }
+        unsigned long done = 0;
+        while (done < frames) {
+            const uint32_t count = gain.segment(static_cast<uint32_t>(frames - done));
+            const float start = gain.value();
+            gain.advance(count);
+            apply_gain_ramp(buffer + done * channels_, count, start, gain.value());
+            done += count;
+        }
+    }
+    
+    void apply_gain_ramp(float* buffer, unsigned long frames, float start, float end) {
+        if (channels_ == 2) {
+            dsp::apply_gain_ramp_stereo(buffer, frames, start, end);
+            return;
+        }
+        const float step = (end - start) / static_cast<float>(frames);
+        for (unsigned long i = 0; i < frames; ++i) {
+            const float gain = start + step * static_cast<float>(i);
+            for (int ch = 0; ch < channels_; ++ch) {
+                buffer[i * channels_ + ch] *= gain;
+            }
+        }
+    }
+    
+    // Channel balance while either side ramps; left is the first channel,
+    // right every other one, as in the steady-state mix
+    void apply_channel_ramp(float* buffer, unsigned long frames, ParamRamp& left, ParamRamp& right) {
+        unsigned long done = 0;
+        while (done < frames) {
+            const uint32_t remaining = static_cast<uint32_t>(frames - done);
+            const uint32_t count = std::min(left.segment(remaining), right.segment(remaining));
+            const float left_start = left.value();
+            const float right_start = right.value();
+            left.advance(count);
+            right.advance(count);
+            const float left_step = (left.value() - left_start) / static_cast<float>(count);
+            const float right_step = (right.value() - right_start) / static_cast<float>(count);
+            
+            for (uint32_t i = 0; i < count; ++i) {
+                float* frame = buffer + (done + i) * channels_;
+                frame[0] *= left_start + left_step * static_cast<float>(i);
+                const float right_gain = right_start + right_step * static_cast<float>(i);
+                for (int ch = 1; ch < channels_; ++ch) {
+                    frame[ch] *= right_gain;
+                }
+            }
+            done += count;
+        }
     }
     
-    float calculate_crossfader_gain(const std::string& channel_id) {
-        // Simple A/B crossfader implementation
-        if (channel_id.find("A") != std::string::npos) {
-            return (crossfader_position_ <= 0.0f) ? 1.0f : (1.0f - crossfader_position_);
-        } else if (channel_id.find("B") != std::string::npos) {
-            return (crossfader_position_ >= 0.0f) ? 1.0f : (1.0f + crossfader_position_);
+    // Beat tracking sees the channel before its fader, so the tempo survives fades
+    void track_beats(int slot, const float* samples, unsigned long frames) {
+        OneStopRadio::BeatTracker* tracker = beat_trackers_[slot].get();
+        if (!tracker) {
+            return;
+        }
+        
+        const float scale = 1.0f / channels_;
+        for (unsigned long i = 0; i < frames; ++i) {
+            float sum = 0.0f;
+            for (int ch = 0; ch < channels_; ++ch) {
+                sum += samples[i * channels_ + ch];
+            }
+            beat_mono_[i] = sum * scale;
+        }
+        tracker->process(beat_mono_.data(), frames);
+    }
+    
+    void update_bpm_sync() {
+        const int master = rt_params_.sync_master_slot;
+        const int slave = rt_params_.sync_slave_slot;
+        if (master >= kMaxMixChannels || slave < 0 || slave >= kMaxMixChannels ||
+            !beat_trackers_[master] || !beat_trackers_[slave]) {
+            return;
+        }
+        
+        const OneStopRadio::BeatTracker& master_tracker = *beat_trackers_[master];
+        const OneStopRadio::BeatTracker& slave_tracker = *beat_trackers_[slave];
+        
+        BpmSyncStatus status;
+        status.active = true;
+        status.master_bpm = master_tracker.current().bpm;
+        status.slave_bpm = slave_tracker.current().bpm;
+        if (status.master_bpm > 0.0f && status.slave_bpm > 0.0f) {
+            status.tempo_ratio = status.master_bpm / status.slave_bpm;
+            double offset = slave_tracker.beat_position() - master_tracker.beat_position();
+            offset -= std::floor(offset + 0.5);
+            status.phase_offset = static_cast<float>(offset);
+        }
+        bpm_sync_.store(status);
+    }
+    
+    float calculate_crossfader_gain(CrossfaderSide side) const {
+        const float position = rt_params_.crossfader;
+        switch (side) {
+            case CrossfaderSide::A:
+                return (position <= 0.0f) ? 1.0f : (1.0f - position);
+            case CrossfaderSide::B:
+                return (position >= 0.0f) ? 1.0f : (1.0f + position);
+            default:
+                return 1.0f; // Other channels not affected by crossfader
         }
-        return 1.0f; // Other channels not affected by crossfader
     }
     
     void apply_noise_gate(float* samples, unsigned long frames) {
-        const float threshold_linear = std::pow(10.0f, mic_config_.gate_threshold / 20.0f);
+        const float threshold_linear = rt_params_.mic_gate_threshold;
         
         for (unsigned long i = 0; i < frames; ++i) {
             float sample_level = 0.0f;
@@ -300,83 +1023,62 @@ public:
         }
     }
     
-    void update_level_meters(const float* samples, unsigned long frames) {
-        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+    static AudioLevels measure_levels(const float* samples, unsigned long frames, int channels) {
+        AudioLevels levels;
+        levels.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::steady_clock::now().time_since_epoch()).count();
         
-        // Calculate levels for master output
+        if (frames == 0) {
+            return levels;
+        }
+        
         float left_peak = 0.0f, right_peak = 0.0f;
         float left_rms = 0.0f, right_rms = 0.0f;
         
-        for (unsigned long i = 0; i < frames; ++i) {
-            float left = std::abs(samples[i * channels_]);
-            float right = (channels_ > 1) ? std::abs(samples[i * channels_ + 1]) : left;
-            
-            left_peak = std::max(left_peak, left);
-            right_peak = std::max(right_peak, right);
-            
-            left_rms += left * left;
-            right_rms += right * right;
+        if (channels == 2) {
+            const dsp::PeakRms reduced = dsp::peak_rms_stereo(samples, frames);
+            left_peak = reduced.peak_left;
+            right_peak = reduced.peak_right;
+            left_rms = reduced.sum_sq_left;
+            right_rms = reduced.sum_sq_right;
+        } else {
+            for (unsigned long i = 0; i < frames; ++i) {
+                float left = std::abs(samples[i * channels]);
+                float right = (channels > 1) ? std::abs(samples[i * channels + 1]) : left;
+                
+                left_peak = std::max(left_peak, left);
+                right_peak = std::max(right_peak, right);
+                
+                left_rms += left * left;
+                right_rms += right * right;
+            }
         }
         
         left_rms = std::sqrt(left_rms / frames);
         right_rms = std::sqrt(right_rms / frames);
         
-        // Update master levels
-        {
-            std::lock_guard<std::mutex> lock(levels_mutex_);
-            master_levels_.left_peak = left_peak;
-            master_levels_.right_peak = right_peak;
-            master_levels_.left_rms = left_rms;
-            master_levels_.right_rms = right_rms;
-            master_levels_.left_db = 20.0f * std::log10(std::max(left_rms, 1e-6f));
-            master_levels_.right_db = 20.0f * std::log10(std::max(right_rms, 1e-6f));
-            master_levels_.clipping = (left_peak > 0.95f) || (right_peak > 0.95f);
-            master_levels_.timestamp = now;
-        }
+        levels.left_peak = left_peak;
+        levels.right_peak = right_peak;
+        levels.left_rms = left_rms;
+        levels.right_rms = right_rms;
+        levels.left_db = 20.0f * std::log10(std::max(left_rms, 1e-6f));
+        levels.right_db = 20.0f * std::log10(std::max(right_rms, 1e-6f));
+        levels.clipping = (left_peak > 0.95f) || (right_peak > 0.95f);
+        return levels;
+    }
+    
+    void update_level_meters(const float* samples, unsigned long frames) {
+        master_levels_.store(measure_levels(samples, frames, channels_));
     }
     
     void update_microphone_levels(const float* samples, unsigned long frames) {
         if (!samples) return;
-        
-        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now().time_since_epoch()).count();
-        
-        float left_peak = 0.0f, right_peak = 0.0f;
-        float left_rms = 0.0f, right_rms = 0.0f;
-        
-        for (unsigned long i = 0; i < frames; ++i) {
-            float left = std::abs(samples[i * channels_]);
-            float right = (channels_ > 1) ? std::abs(samples[i * channels_ + 1]) : left;
-            
-            left_peak = std::max(left_peak, left);
-            right_peak = std::max(right_peak, right);
-            
-            left_rms += left * left;
-            right_rms += right * right;
-        }
-        
-        left_rms = std::sqrt(left_rms / frames);
-        right_rms = std::sqrt(right_rms / frames);
-        
-        // Update microphone levels
-        {
-            std::lock_guard<std::mutex> lock(levels_mutex_);
-            mic_levels_.left_peak = left_peak;
-            mic_levels_.right_peak = right_peak;
-            mic_levels_.left_rms = left_rms;
-            mic_levels_.right_rms = right_rms;
-            mic_levels_.left_db = 20.0f * std::log10(std::max(left_rms, 1e-6f));
-            mic_levels_.right_db = 20.0f * std::log10(std::max(right_rms, 1e-6f));
-            mic_levels_.clipping = (left_peak > 0.95f) || (right_peak > 0.95f);
-            mic_levels_.timestamp = now;
-        }
+        mic_levels_.store(measure_levels(samples, frames, channels_));
     }
     
     void reset_level_meters() {
-        std::lock_guard<std::mutex> lock(levels_mutex_);
-        master_levels_ = AudioLevels();
-        mic_levels_ = AudioLevels();
+        master_levels_.store(AudioLevels());
+        mic_levels_.store(AudioLevels());
     }
     
     void stop_audio_stream() {
@@ -389,49 +1091,56 @@ public:
     
     void processing_loop() {
         Logger::info("Audio processing thread started");
+        TRACE_THREAD_NAME("audio_processing");
         
         while (running_) {
             std::unique_lock<std::mutex> lock(processing_mutex_);
             processing_cv_.wait_for(lock, std::chrono::milliseconds(10));
             
-            // Process streaming if enabled
-            if (parent_->streaming_) {
-                process_streaming();
-            }
-            
-            // Process recording if enabled
-            if (parent_->recording_) {
-                process_recording();
-            }
-            
             // Update BPM detection
+            TRACE_SCOPE("bpm_detection");
             update_bpm_detection();
         }
         
         Logger::info("Audio processing thread stopped");
     }
     
-    void process_streaming() {
-        // Encode and stream audio to configured targets
-        // This would be implemented with actual streaming protocols
-        // For now, just log activity
-        static auto last_log = std::chrono::steady_clock::now();
-        auto now = std::chrono::steady_clock::now();
-        if (std::chrono::duration_cast<std::chrono::seconds>(now - last_log).count() >= 10) {
-            Logger::info("Streaming audio to " + std::to_string(parent_->stream_targets_.size()) + " targets");
-            last_log = now;
+    // Convert an add_stream_target() entry into an encoder configuration.
+    // server_url is [icecast|shoutcast|http]://host[:port]/mount; stream_key is the source password.
+    static StreamConfig stream_config_from_target(const StreamingConfig& target, int sample_rate, int channels) {
+        StreamConfig config;
+        std::string url = target.server_url;
+        
+        const size_t scheme_end = url.find("://");
+        if (scheme_end != std::string::npos) {
+            const std::string scheme = url.substr(0, scheme_end);
+            config.protocol = (scheme == "shoutcast" || scheme == "icy") ? StreamProtocol::SHOUTCAST
+                                                                         : StreamProtocol::ICECAST2;
+            url = url.substr(scheme_end + 3);
         }
-    }
-    
-    void process_recording() {
-        // Record mixed audio to file
-        // This would write the mixed output to an audio file
-        static auto last_log = std::chrono::steady_clock::now();
-        auto now = std::chrono::steady_clock::now();
-        if (std::chrono::duration_cast<std::chrono::seconds>(now - last_log).count() >= 5) {
-            Logger::info("Recording audio...");
-            last_log = now;
+        
+        const size_t path_start = url.find('/');
+        std::string host_port = url.substr(0, path_start);
+        if (path_start != std::string::npos) {
+            config.mount_point = url.substr(path_start);
+        }
+        
+        const size_t colon = host_port.find(':');
+        config.server_host = host_port.substr(0, colon);
+        if (colon != std::string::npos) {
+            config.server_port = std::atoi(host_port.c_str() + colon + 1);
         }
+        
+        config.password = target.stream_key;
+        config.stream_name = target.title.empty() ? config.stream_name : target.title;
+        config.stream_description = target.description.empty() ? config.stream_description : target.description;
+        config.codec = AudioStreamEncoder::string_to_codec(target.format.codec);
+        config.bitrate = target.format.bitrate / 1000;
+        
+        // Encoders consume the master bus directly, so they run at its rate and layout
+        config.sample_rate = sample_rate;
+        config.channels = channels;
+        return config;
     }
     
     void update_bpm_detection() {
@@ -440,26 +1149,34 @@ public:
     }
     
     void cleanup_encoders() {
-        // Cleanup any FFmpeg encoder contexts
-        if (recording_context_) {
-            avcodec_free_context(&recording_context_);
+        stop_recorder();
+        
+        for (auto& [name, encoder] : stream_encoders_) {
+            encoder->stop_streaming();
+            encoder->disconnect();
         }
+        stream_encoders_.clear();
         
-        for (auto& [name, context] : streaming_contexts_) {
-            if (context) {
-                avcodec_free_context(&context);
-            }
+        if (encoder_pool_) {
+            encoder_pool_->clear();
+        }
+    }
+    
+    void stop_recorder() {
+        std::lock_guard<std::mutex> lock(recorder_mutex_);
+        if (recorder_) {
+            recorder_->stop();
+        }
+        parent_->recording_ = false;
+        if (recorder_encoder_) {
+            recorder_encoder_.reset();
+            encoder_pool_->release_idle();
         }
-        streaming_contexts_.clear();
     }
     
     bool initialize_microphone() {
         Logger::info("AudioSystem::Impl: Initializing microphone");
         
-        // Initialize microphone buffer
-        mic_buffer_.resize(frames_per_buffer_ * channels_);
-        std::fill(mic_buffer_.begin(), mic_buffer_.end(), 0.0f);
-        
         // Set default microphone configuration
         mic_config_.enabled = true;
         mic_config_.gain = 1.0f;
@@ -467,11 +1184,27 @@ public:
         mic_config_.noise_suppression = true;
         mic_config_.echo_cancellation = true;
         mic_config_.auto_gain_control = false;
+        push_mic_config();
         
         Logger::info("AudioSystem::Impl: Microphone initialized successfully");
         return true;
     }
     
+    // Forward the control-side mic_config_ to the audio thread
+    void push_mic_config() {
+        ControlCommand gain;
+        gain.type = ControlCommand::Type::MIC_GAIN;
+        gain.value = mic_config_.gain;
+        gain.ramp_frames = ramp_frames(kDezipperMs);
+        push_command(gain);
+        
+        ControlCommand gate;
+        gate.type = ControlCommand::Type::MIC_GATE;
+        gate.value = std::pow(10.0f, mic_config_.gate_threshold / 20.0f);
+        gate.value2 = mic_config_.gate_threshold > -60.0f ? 1.0f : 0.0f;
+        push_command(gate);
+    }
+    
 
 
 public:
@@ -487,6 +1220,9 @@ public:
     int channels_;
     int frames_per_buffer_;
     std::atomic<bool> running_{false};
+    std::atomic<bool> headless_{false};     // Running, clocked by process_block() callers
+    std::atomic<uint64_t> state_generation_{0};
+    AudioMetrics& metrics_ = audio_metrics();
     
     // Audio buffers
     std::vector<float> input_buffer_;
@@ -494,7 +1230,7 @@ public:
     std::vector<float> mix_buffer_;
     std::vector<float> channel_buffer_;
     
-    // Microphone
+    // Microphone (mic_config_ is the control-side copy; mic_mutex_ is never taken by the callback)
     std::atomic<bool> mic_enabled_{false};
     MicrophoneConfig mic_config_;
     std::vector<float> mic_buffer_;
@@ -506,36 +1242,80 @@ public:
     std::atomic<bool> mic_active_{false};
     std::atomic<bool> mic_initialized_{false};
     
-    // Audio channels
+    // Audio channels (control side; guarded by channels_mutex_)
     std::map<std::string, std::unique_ptr<AudioChannel>> active_channels_;
+    std::map<std::string, int> channel_slots_;
+    std::map<std::string, AudioChannelConfig> channel_configs_;
+    std::map<std::string, std::shared_ptr<LiveInput>> live_inputs_;
+    std::array<bool, kMaxMixChannels> slot_in_use_;
     std::mutex channels_mutex_;
     
-    // Mixing
+    // Mixing (control-side mirrors of values owned by the audio thread)
     std::atomic<float> crossfader_position_{0.0f};
     std::atomic<float> master_volume_{0.8f};
     
+    // Real-time control plane
+    std::mutex control_mutex_;                 // Serializes queue producers and reclamation
+    SpscQueue<ControlCommand> control_queue_;
+    RealtimeParams rt_params_;                 // Audio thread only
+    std::atomic<MixGraph*> graph_;
+    std::atomic<uint64_t> callbacks_completed_{0};
+    std::vector<std::pair<uint64_t, std::unique_ptr<MixGraph>>> retired_graphs_;
+    std::vector<std::pair<uint64_t, std::unique_ptr<AudioChannel>>> retired_channels_;
+    
     // Effects
     std::unique_ptr<AudioEffectChain> master_effects_;
     
-    // Level meters
-    AudioLevels master_levels_;
-    AudioLevels mic_levels_;
-    std::mutex levels_mutex_;
+    // Level meters (written by the audio thread, read lock-free)
+    SeqLock<AudioLevels> master_levels_;
+    SeqLock<AudioLevels> mic_levels_;
+    
+    // Beat tracking (audio thread; grids and sync status are read lock-free)
+    std::array<std::unique_ptr<OneStopRadio::BeatTracker>, kMaxMixChannels> beat_trackers_;
+    std::vector<float> beat_mono_;
+    SeqLock<BpmSyncStatus> bpm_sync_;
     
     // Audio monitoring
     std::atomic<bool> level_monitoring_enabled_{false};
+    std::unique_ptr<SpectrumAnalyzer> spectrum_ = std::make_unique<SpectrumAnalyzer>();
+    std::mutex spectrum_mutex_;                // Serializes start/stop; readers never take it
+    
+    // Decoded PCM for the decks, shared with the prefetcher
+    std::unique_ptr<TrackCache> track_cache_ = std::make_unique<TrackCache>();
+    
+    // Decks: tracks on the control side (guarded by channels_mutex_), voices on
+    // the audio thread, which publishes the play positions back in track frames
+    std::array<std::shared_ptr<const DecodedTrack>, kDeckCount> deck_tracks_;
+    std::array<DeckVoice, kDeckCount> decks_;
+    std::array<std::atomic<uint64_t>, kDeckCount> deck_positions_{};
+    std::unique_ptr<OneStopRadio::DeckEqualizer> deck_eq_;     // Audio thread
+    std::vector<float> eq_lanes_;
+    
+    // Master dynamics (audio thread), and the settings last sent to it
+    std::unique_ptr<OneStopRadio::DynamicsProcessor> dynamics_;
+    OneStopRadio::DynamicsOptions dynamics_config_;
+    std::mutex dynamics_mutex_;                // Guards dynamics_config_
     
     // Processing thread
     std::thread processing_thread_;
     std::mutex processing_mutex_;
     std::condition_variable processing_cv_;
     
-    // External callback
+    // External callback (guards AudioSystem::audio_callback_ on the control side)
     std::mutex callback_mutex_;
     
     // Encoding contexts
-    AVCodecContext* recording_context_ = nullptr;
-    std::map<std::string, AVCodecContext*> streaming_contexts_;
+    // Master bus fan-out: one reader per encoder profile and one for the recorder.
+    // Targets with the same codec, bitrate and format share an encoder from the pool.
+    std::shared_ptr<AudioRingBuffer> master_ring_;
+    std::unique_ptr<SharedEncoderPool> encoder_pool_;
+    std::map<std::string, std::unique_ptr<AudioStreamEncoder>> stream_encoders_;
+    
+    // Kept after stop so its final stats stay readable. Record routes run on
+    // the worker pool, so starts, stops and stats reads take recorder_mutex_.
+    std::mutex recorder_mutex_;
+    std::unique_ptr<DiskRecorder> recorder_;
+    std::shared_ptr<SharedStreamEncoder> recorder_encoder_;
 };
 
 /**
@@ -588,12 +1368,15 @@ std::vector<std::string> AudioSystem::get_output_devices() {
 }
 
 bool AudioSystem::enable_microphone(const MicrophoneConfig& config) {
-    impl_->mic_config_ = config;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mic_mutex_);
+        impl_->mic_config_ = config;
+        impl_->push_mic_config();
+    }
     impl_->mic_enabled_ = config.enabled;
     
     if (config.enabled) {
-        // Resize microphone buffer
-        impl_->mic_buffer_.resize(impl_->frames_per_buffer_ * impl_->channels_);
+        // mic_buffer_ is preallocated in initialize(); resizing here would race the callback
         Logger::info("Microphone enabled with gain: " + std::to_string(config.gain));
     } else {
         Logger::info("Microphone disabled");
@@ -610,11 +1393,27 @@ bool AudioSystem::disable_microphone() {
 }
 
 bool AudioSystem::set_microphone_gain(float gain) {
-    impl_->mic_config_.gain = std::clamp(gain, 0.0f, 2.0f);
+    {
+        std::lock_guard<std::mutex> lock(impl_->mic_mutex_);
+        impl_->mic_config_.gain = std::clamp(gain, 0.0f, 2.0f);
+        impl_->push_mic_config();
+    }
     Logger::info("Microphone gain set to: " + std::to_string(gain));
     return true;
 }
 
+bool AudioSystem::ramp_microphone_gain(float gain, float ramp_ms, RampShape shape) {
+    std::lock_guard<std::mutex> lock(impl_->mic_mutex_);
+    impl_->mic_config_.gain = std::clamp(gain, 0.0f, 2.0f);
+    
+    ControlCommand command;
+    command.type = ControlCommand::Type::MIC_GAIN;
+    command.value = impl_->mic_config_.gain;
+    command.ramp_frames = impl_->ramp_frames(ramp_ms);
+    command.shape = shape;
+    return impl_->push_command(command);
+}
+
 std::string AudioSystem::create_audio_channel() {
     static int channel_counter = 0;
     std::string channel_id = "channel_" + std::to_string(++channel_counter);
@@ -623,97 +1422,608 @@ std::string AudioSystem::create_audio_channel() {
     
     {
         std::lock_guard<std::mutex> lock(impl_->channels_mutex_);
+        int slot = impl_->allocate_slot();
+        if (slot < 0) {
+            Logger::error("Cannot create audio channel: mixer supports at most " +
+                          std::to_string(kMaxMixChannels) + " channels");
+            return "";
+        }
+        
+        AudioChannelConfig config;
+        config.id = channel_id;
+        impl_->channel_configs_[channel_id] = config;
+        impl_->channel_slots_[channel_id] = slot;
         impl_->active_channels_[channel_id] = std::move(channel);
+        
+        // Reset the slot's gain and tempo before the channel becomes visible to the callback
+        ControlCommand command;
+        command.type = ControlCommand::Type::CHANNEL_GAIN;
+        command.slot = slot;
+        command.value = 1.0f;
+        command.value2 = 1.0f;
+        impl_->push_command(command);
+        
+        ControlCommand beat_reset;
+        beat_reset.type = ControlCommand::Type::BEAT_RESET;
+        beat_reset.slot = slot;
+        impl_->push_command(beat_reset);
+        impl_->publish_graph();
     }
     
     Logger::info("Created audio channel: " + channel_id);
     return channel_id;
 }
 
+bool AudioSystem::destroy_audio_channel(const std::string& channel_id) {
+    std::lock_guard<std::mutex> lock(impl_->channels_mutex_);
+    auto it = impl_->active_channels_.find(channel_id);
+    if (it == impl_->active_channels_.end()) {
+        return false;
+    }
+    
+    std::unique_ptr<AudioChannel> channel = std::move(it->second);
+    impl_->active_channels_.erase(it);
+    impl_->release_slot(impl_->channel_slots_[channel_id]);
+    impl_->channel_slots_.erase(channel_id);
+    impl_->channel_configs_.erase(channel_id);
+    
+    // The callback may still be mixing this channel; free it once it can't be
+    impl_->publish_graph();
+    impl_->retire_channel(std::move(channel));
+    
+    Logger::info("Destroyed audio channel: " + channel_id);
+    return true;
+}
+
+std::shared_ptr<LiveInput> AudioSystem::create_live_input(const std::string& input_id) {
+    auto input = std::make_shared<LiveInput>(input_id, impl_->sample_rate_, impl_->channels_,
+                                             static_cast<size_t>(impl_->frames_per_buffer_));
+    
+    std::lock_guard<std::mutex> lock(impl_->channels_mutex_);
+    if (input_id.empty() || impl_->channel_slots_.count(input_id)) {
+        Logger::error("Cannot create live input: channel id '" + input_id + "' is taken");
+        return nullptr;
+    }
+    int slot = impl_->allocate_slot();
+    if (slot < 0) {
+        Logger::error("Cannot create live input: mixer supports at most " +
+                      std::to_string(kMaxMixChannels) + " channels");
+        return nullptr;
+    }
+    
+    AudioChannelConfig config;
+    config.id = input_id;
+    impl_->channel_configs_[input_id] = config;
+    impl_->channel_slots_[input_id] = slot;
+    impl_->live_inputs_[input_id] = input;
+    
+    ControlCommand command;
+    command.type = ControlCommand::Type::CHANNEL_GAIN;
+    command.slot = slot;
+    command.value = 1.0f;
+    command.value2 = 1.0f;
+    impl_->push_command(command);
+    impl_->publish_graph();
+    
+    Logger::info("Created live input: " + input_id);
+    return input;
+}
+
+bool AudioSystem::destroy_live_input(const std::string& input_id) {
+    std::lock_guard<std::mutex> lock(impl_->channels_mutex_);
+    auto it = impl_->live_inputs_.find(input_id);
+    if (it == impl_->live_inputs_.end()) {
+        return false;
+    }
+    
+    // The graph keeps its own reference until the callback is done with it
+    impl_->live_inputs_.erase(it);
+    impl_->release_slot(impl_->channel_slots_[input_id]);
+    impl_->channel_slots_.erase(input_id);
+    impl_->channel_configs_.erase(input_id);
+    impl_->publish_graph();
+    
+    Logger::info("Destroyed live input: " + input_id);
+    return true;
+}
+
+AudioChannelConfig AudioSystem::get_channel_config(const std::string& channel_id) {
+    std::lock_guard<std::mutex> lock(impl_->channels_mutex_);
+    auto it = impl_->channel_configs_.find(channel_id);
+    return it != impl_->channel_configs_.end() ? it->second : AudioChannelConfig{};
+}
+
+std::vector<std::string> AudioSystem::get_active_channels() {
+    std::lock_guard<std::mutex> lock(impl_->channels_mutex_);
+    std::vector<std::string> channel_ids;
+    channel_ids.reserve(impl_->active_channels_.size() + impl_->live_inputs_.size());
+    for (const auto& [channel_id, channel] : impl_->active_channels_) {
+        channel_ids.push_back(channel_id);
+    }
+    for (const auto& [input_id, input] : impl_->live_inputs_) {
+        channel_ids.push_back(input_id);
+    }
+    return channel_ids;
+}
+
+bool AudioSystem::configure_channel(const std::string& channel_id, const AudioChannelConfig& config) {
+    std::lock_guard<std::mutex> lock(impl_->channels_mutex_);
+    auto slot_it = impl_->channel_slots_.find(channel_id);
+    if (slot_it == impl_->channel_slots_.end()) {
+        return false;
+    }
+    
+    AudioChannelConfig& stored = impl_->channel_configs_[channel_id];
+    stored = config;
+    stored.id = channel_id;
+    stored.volume = std::clamp(config.volume, 0.0f, 1.0f);
+    stored.pan = std::clamp(config.pan, -1.0f, 1.0f);
+    
+    // Linear balance law; muted channels keep their slot but contribute nothing
+    const float volume = stored.muted ? 0.0f : stored.volume;
+    ControlCommand command;
+    command.type = ControlCommand::Type::CHANNEL_GAIN;
+    command.slot = slot_it->second;
+    command.value = volume * std::min(1.0f, 1.0f - stored.pan);
+    command.value2 = volume * std::min(1.0f, 1.0f + stored.pan);
+    command.ramp_frames = impl_->ramp_frames(kDezipperMs);
+    return impl_->push_command(command);
+}
+
 bool AudioSystem::set_crossfader_position(float position) {
     impl_->crossfader_position_ = std::clamp(position, -1.0f, 1.0f);
-    return true;
+    
+    ControlCommand command;
+    command.type = ControlCommand::Type::CROSSFADER;
+    command.value = impl_->crossfader_position_;
+    return impl_->push_command(command);
 }
 
 bool AudioSystem::set_master_volume(float volume) {
-    impl_->master_volume_ = std::clamp(volume, 0.0f, 1.0f);
-    return true;
+    return ramp_master_volume(volume, kDezipperMs, RampShape::LINEAR);
+}
+
+bool AudioSystem::ramp_master_volume(float target, float ramp_ms, RampShape shape) {
+    impl_->master_volume_ = std::clamp(target, 0.0f, 1.0f);
+    
+    ControlCommand command;
+    command.type = ControlCommand::Type::MASTER_VOLUME;
+    command.value = impl_->master_volume_;
+    command.ramp_frames = impl_->ramp_frames(ramp_ms);
+    command.shape = shape;
+    return impl_->push_command(command);
+}
+
+bool AudioSystem::set_duck_level(float level, float ramp_ms, RampShape shape) {
+    ControlCommand command;
+    command.type = ControlCommand::Type::DUCK_GAIN;
+    command.value = std::clamp(level, 0.0f, 1.0f);
+    command.ramp_frames = impl_->ramp_frames(ramp_ms);
+    command.shape = shape;
+    return impl_->push_command(command);
 }
 
 AudioLevels AudioSystem::get_master_levels() {
-    std::lock_guard<std::mutex> lock(impl_->levels_mutex_);
-    return impl_->master_levels_;
+    return impl_->master_levels_.load();
 }
 
 AudioLevels AudioSystem::get_microphone_levels() {
-    std::lock_guard<std::mutex> lock(impl_->levels_mutex_);
-    return impl_->mic_levels_;
+    return impl_->mic_levels_.load();
 }
 
-bool AudioSystem::start_streaming() {
-    streaming_ = true;
-    Logger::info("Audio streaming started");
+std::shared_ptr<AudioRingBuffer::Reader> AudioSystem::create_master_bus_reader() {
+    if (!impl_->master_ring_) {
+        Logger::error("AudioSystem: Master bus not available before initialize()");
+        return nullptr;
+    }
+    return impl_->master_ring_->create_reader();
+}
+
+int AudioSystem::get_sample_rate() const {
+    return impl_->sample_rate_;
+}
+
+int AudioSystem::get_channel_count() const {
+    return impl_->channels_;
+}
+
+double AudioSystem::get_output_latency() const {
+    if (!impl_->running_ || !impl_->pa_stream_) {
+        return 0.0;
+    }
+    const PaStreamInfo* info = Pa_GetStreamInfo(impl_->pa_stream_);
+    return info ? info->outputLatency : 0.0;
+}
+
+std::shared_ptr<SharedStreamEncoder> AudioSystem::acquire_shared_encoder(const EncoderProfile& profile) {
+    std::lock_guard<std::mutex> lock(streaming_mutex_);
+    if (!impl_->encoder_pool_) {
+        Logger::error("AudioSystem: Shared encoders not available before initialize()");
+        return nullptr;
+    }
+    return impl_->encoder_pool_->acquire(profile);
+}
+
+void AudioSystem::release_idle_encoders() {
+    std::lock_guard<std::mutex> lock(streaming_mutex_);
+    if (impl_->encoder_pool_) {
+        impl_->encoder_pool_->release_idle();
+    }
+}
+
+bool AudioSystem::add_stream_target(const std::string& name, const StreamingConfig& config) {
+    std::lock_guard<std::mutex> lock(streaming_mutex_);
+    if (streaming_) {
+        Logger::error("Cannot add stream target while streaming: " + name);
+        return false;
+    }
+    stream_targets_[name] = config;
+    Logger::info("Added stream target: " + name + " -> " + config.server_url);
     return true;
 }
 
+bool AudioSystem::remove_stream_target(const std::string& name) {
+    std::lock_guard<std::mutex> lock(streaming_mutex_);
+    auto it = impl_->stream_encoders_.find(name);
+    if (it != impl_->stream_encoders_.end()) {
+        it->second->stop_streaming();
+        it->second->disconnect();
+        impl_->stream_encoders_.erase(it);
+        impl_->encoder_pool_->release_idle();
+    }
+    return stream_targets_.erase(name) > 0;
+}
+
+std::map<std::string, StreamingConfig> AudioSystem::get_stream_targets() {
+    std::lock_guard<std::mutex> lock(streaming_mutex_);
+    return stream_targets_;
+}
+
+bool AudioSystem::start_streaming() {
+    std::lock_guard<std::mutex> lock(streaming_mutex_);
+    if (streaming_) {
+        return true;
+    }
+    if (!impl_->master_ring_) {
+        Logger::error("Cannot start streaming before AudioSystem is initialized");
+        return false;
+    }
+    
+    int started = 0;
+    for (const auto& [name, target] : stream_targets_) {
+        auto encoder = std::make_unique<AudioStreamEncoder>();
+        StreamConfig config = Impl::stream_config_from_target(target, impl_->sample_rate_, impl_->channels_);
+        
+        if (!encoder->configure(config) || !encoder->connect()) {
+            Logger::error("Failed to start stream target " + name + ": " + encoder->get_status_message());
+            continue;
+        }
+        
+        auto shared_encoder = impl_->encoder_pool_->acquire(EncoderProfile::from_config(config));
+        if (!shared_encoder || !encoder->start_streaming(shared_encoder)) {
+            Logger::error("Failed to start encoder for stream target " + name);
+            encoder->disconnect();
+            continue;
+        }
+        
+        impl_->stream_encoders_[name] = std::move(encoder);
+        ++started;
+    }
+    
+    // Profiles whose every target failed to connect
+    impl_->encoder_pool_->release_idle();
+    
+    streaming_ = started > 0;
+    impl_->state_changed();
+    Logger::info("Audio streaming started to " + std::to_string(started) + "/" +
+                 std::to_string(stream_targets_.size()) + " targets using " +
+                 std::to_string(impl_->encoder_pool_->encoder_count()) + " encoders");
+    return streaming_;
+}
+
 bool AudioSystem::stop_streaming() {
+    std::lock_guard<std::mutex> lock(streaming_mutex_);
+    for (auto& [name, encoder] : impl_->stream_encoders_) {
+        encoder->stop_streaming();
+        encoder->disconnect();
+    }
+    impl_->stream_encoders_.clear();
+    if (impl_->encoder_pool_) {
+        // Encoders still feeding other consumers keep running
+        impl_->encoder_pool_->release_idle();
+    }
+    
     streaming_ = false;
+    impl_->state_changed();
     Logger::info("Audio streaming stopped");
     return true;
 }
 
 bool AudioSystem::start_recording(const std::string& output_file, const AudioFormat& format) {
+    // The single file takes its format from the extension; rate and layout are the master bus's
+    RecorderOptions options;
+    options.file = output_file;
+    options.format = DiskRecorder::format_for_path(output_file);
+    options.bit_depth = format.bit_depth;
+    options.bitrate = format.bitrate / 1000;
+    return start_recording(options);
+}
+
+bool AudioSystem::start_recording(const RecorderOptions& options) {
+    std::lock_guard<std::mutex> lock(impl_->recorder_mutex_);
+    if (recording_) {
+        Logger::info("Recording already in progress");
+        return true;
+    }
+    if (!impl_->master_ring_) {
+        Logger::error("Cannot start recording before AudioSystem is initialized");
+        return false;
+    }
+    
+    auto recorder = std::make_unique<DiskRecorder>(options);
+    bool started = false;
+    if (DiskRecorder::is_encoded_format(options.format)) {
+        // Shares the encoder with any stream target of the same profile
+        EncoderProfile profile;
+        profile.codec = AudioStreamEncoder::string_to_codec(options.format);
+        profile.bitrate = options.bitrate;
+        profile.sample_rate = impl_->sample_rate_;
+        profile.channels = impl_->channels_;
+        auto encoder = impl_->encoder_pool_->acquire(profile);
+        started = encoder && recorder->start(encoder);
+        if (started) {
+            impl_->recorder_encoder_ = std::move(encoder);
+        } else {
+            impl_->encoder_pool_->release_idle();
+        }
+    } else {
+        started = recorder->start(impl_->master_ring_->create_reader());
+    }
+    if (!started) {
+        Logger::error("Failed to start recording: " + recorder->get_error());
+        return false;
+    }
+    
+    impl_->recorder_ = std::move(recorder);
     recording_ = true;
-    Logger::info("Audio recording started: " + output_file);
+    impl_->state_changed();
+    Logger::info("Audio recording started: " + impl_->recorder_->stats().current_file);
     return true;
 }
 
 bool AudioSystem::stop_recording() {
-    recording_ = false;
+    impl_->stop_recorder();
+    impl_->state_changed();
     Logger::info("Audio recording stopped");
     return true;
 }
 
+RecorderStats AudioSystem::get_recording_stats() const {
+    std::lock_guard<std::mutex> lock(impl_->recorder_mutex_);
+    return impl_->recorder_ ? impl_->recorder_->stats() : RecorderStats();
+}
+
 void AudioSystem::set_audio_callback(AudioCallback callback) {
-    std::lock_guard<std::mutex> lock(impl_->callback_mutex_);
-    audio_callback_ = callback;
+    {
+        std::lock_guard<std::mutex> lock(impl_->callback_mutex_);
+        audio_callback_ = callback;
+    }
+    
+    // The callback reaches the audio thread as part of the next graph
+    std::lock_guard<std::mutex> lock(impl_->channels_mutex_);
+    impl_->publish_graph();
+}
+
+bool AudioSystem::render_offline(const float* input, float* output, int frames) {
+    if (impl_->running_ || !impl_->master_ring_ || frames < 0) {
+        return false;
+    }
+    impl_->render_blocks(input, output, frames);
+    return true;
+}
+
+bool AudioSystem::start_headless() {
+    return impl_->start_headless();
+}
+
+bool AudioSystem::is_headless() const {
+    return impl_->headless_;
+}
+
+bool AudioSystem::process_block(float* output, int frames) {
+    if (!impl_->headless_ || frames < 0) {
+        return false;
+    }
+    impl_->render_blocks(nullptr, output, frames);
+    return true;
+}
+
+int AudioSystem::get_block_frames() const {
+    return impl_->frames_per_buffer_;
+}
+
+uint64_t AudioSystem::get_state_generation() const {
+    return impl_->state_generation_.load(std::memory_order_acquire);
 }
 
 // Placeholder implementations for remaining methods
 bool AudioSystem::set_input_device(int device_id) { return true; }
 bool AudioSystem::set_output_device(int device_id) { return true; }
-bool AudioSystem::destroy_audio_channel(const std::string& channel_id) { return true; }
 
-bool AudioSystem::play_channel(const std::string& channel_id) { return true; }
+bool AudioSystem::play_channel(const std::string& channel_id) { return set_channel_playback(channel_id, true); }
 MicrophoneConfig AudioSystem::get_microphone_config() const { return mic_config_; }
-AudioChannelConfig AudioSystem::get_channel_config(const std::string& channel_id) { return {}; }
-std::vector<std::string> AudioSystem::get_active_channels() { return {}; }
-bool AudioSystem::configure_channel(const std::string& channel_id, const AudioChannelConfig& config) { return true; }
-bool AudioSystem::pause_channel(const std::string& channel_id) { return true; }
-bool AudioSystem::stop_channel(const std::string& channel_id) { return true; }
-bool AudioSystem::set_channel_position(const std::string& channel_id, double position_seconds) { return true; }
-double AudioSystem::get_channel_position(const std::string& channel_id) { return 0.0; }
-double AudioSystem::get_channel_duration(const std::string& channel_id) { return 0.0; }
+bool AudioSystem::stop_channel(const std::string& channel_id) { return set_channel_playback(channel_id, false); }
+
+bool AudioSystem::pause_channel(const std::string& channel_id) {
+    const int deck = deck_index(channel_id);
+    if (deck < 0) {
+        return false;
+    }
+    ControlCommand command;
+    command.type = ControlCommand::Type::DECK_PLAY;
+    command.slot = deck;
+    return impl_->push_command(command);
+}
 bool AudioSystem::set_headphone_cue(const std::string& channel_id, bool enabled) { return true; }
 
 bool AudioSystem::set_channel_eq(const std::string& channel_id, const std::vector<EQBand>& bands) { return true; }
 AudioLevels AudioSystem::get_channel_levels(const std::string& channel_id) { return {}; }
 AudioLevels AudioSystem::get_headphone_levels() { return {}; }
-bool AudioSystem::add_stream_target(const std::string& name, const StreamingConfig& config) { return true; }
-bool AudioSystem::remove_stream_target(const std::string& name) { return true; }
-std::map<std::string, StreamingConfig> AudioSystem::get_stream_targets() { return {}; }
-bool AudioSystem::enable_channel_compressor(const std::string& channel_id, bool enabled) { return true; }
-bool AudioSystem::set_compressor_settings(const std::string& channel_id, float threshold, float ratio, float attack, float release) { return true; }
 bool AudioSystem::enable_reverb(bool enabled, float room_size, float damping, float wet_level) { return true; }
 bool AudioSystem::enable_delay(bool enabled, float delay_time, float feedback, float wet_level) { return true; }
 bool AudioSystem::enable_auto_duck(bool enabled, float threshold, float duck_amount) { return true; }
-bool AudioSystem::set_limiter(bool enabled, float threshold, float release) { return true; }
-bool AudioSystem::enable_spectral_analyzer(bool enabled) { return true; }
-std::vector<float> AudioSystem::get_spectrum_data(int bins) { return std::vector<float>(bins, 0.0f); }
-float AudioSystem::detect_bpm(const std::string& channel_id) { return 120.0f; }
-bool AudioSystem::enable_bpm_sync(const std::string& channel_a, const std::string& channel_b) { return true; }
-bool AudioSystem::disable_bpm_sync() { return true; }
-bool AudioSystem::set_microphone_gate_threshold(float threshold_db) { return true; }
+
+// ===== MASTER DYNAMICS =====
+//
+// One compressor and limiter on the master bus, ahead of the ring every
+// encoder and the recorder read from. Only "master" has a compressor.
+
+bool AudioSystem::set_limiter(bool enabled, float threshold, float release) {
+    std::lock_guard<std::mutex> lock(impl_->dynamics_mutex_);
+    OneStopRadio::DynamicsOptions& config = impl_->dynamics_config_;
+    config.limiter_enabled = enabled;
+    config.ceiling_db = std::max(-24.0f, std::min(0.0f, threshold));
+    config.limiter_release_ms = std::max(1.0f, std::min(1000.0f, release));
+    
+    ControlCommand command;
+    command.type = ControlCommand::Type::LIMITER;
+    command.slot = enabled ? 1 : 0;
+    command.value = config.ceiling_db;
+    command.value2 = config.limiter_release_ms;
+    
+    Logger::info("AudioSystem: Master limiter " + std::string(enabled ? "enabled" : "disabled") +
+                 ", ceiling " + std::to_string(config.ceiling_db) + " dB");
+    return impl_->push_command(command);
+}
+
+bool AudioSystem::enable_channel_compressor(const std::string& channel_id, bool enabled) {
+    if (channel_id != "master") {
+        Logger::error("AudioSystem: No compressor on channel " + channel_id + "; only the master bus has one");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(impl_->dynamics_mutex_);
+    OneStopRadio::DynamicsOptions& config = impl_->dynamics_config_;
+    config.compressor_enabled = enabled;
+    
+    ControlCommand command;
+    command.type = ControlCommand::Type::COMPRESSOR;
+    command.slot = enabled ? 1 : 0;
+    command.value = config.threshold_db;
+    command.value2 = config.ratio;
+    
+    Logger::info("AudioSystem: Master compressor " + std::string(enabled ? "enabled" : "disabled"));
+    return impl_->push_command(command);
+}
+
+bool AudioSystem::set_compressor_settings(const std::string& channel_id, float threshold, float ratio, float attack, float release) {
+    if (channel_id != "master") {
+        Logger::error("AudioSystem: No compressor on channel " + channel_id + "; only the master bus has one");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(impl_->dynamics_mutex_);
+    OneStopRadio::DynamicsOptions& config = impl_->dynamics_config_;
+    config.threshold_db = std::max(-60.0f, std::min(0.0f, threshold));
+    config.ratio = std::max(1.0f, std::min(20.0f, ratio));
+    config.attack_ms = std::max(0.0f, std::min(500.0f, attack));
+    config.release_ms = std::max(1.0f, std::min(5000.0f, release));
+    
+    ControlCommand command;
+    command.type = ControlCommand::Type::COMPRESSOR;
+    command.slot = config.compressor_enabled ? 1 : 0;
+    command.value = config.threshold_db;
+    command.value2 = config.ratio;
+    
+    ControlCommand timing;
+    timing.type = ControlCommand::Type::COMPRESSOR_TIMING;
+    timing.value = config.attack_ms;
+    timing.value2 = config.release_ms;
+    
+    return impl_->push_command(command) && impl_->push_command(timing);
+}
+
+OneStopRadio::DynamicsStats AudioSystem::get_master_dynamics_stats() const {
+    return impl_->dynamics_ ? impl_->dynamics_->stats() : OneStopRadio::DynamicsStats();
+}
+
+bool AudioSystem::enable_spectral_analyzer(bool enabled) {
+    std::lock_guard<std::mutex> lock(impl_->spectrum_mutex_);
+    if (!enabled) {
+        impl_->spectrum_->stop();
+        return true;
+    }
+    if (impl_->spectrum_->is_running()) {
+        return true;
+    }
+
+    auto reader = create_master_bus_reader();
+    return reader && impl_->spectrum_->start(std::move(reader));
+}
+
+bool AudioSystem::set_spectral_analyzer_options(const SpectrumAnalyzerOptions& options) {
+    std::lock_guard<std::mutex> lock(impl_->spectrum_mutex_);
+    impl_->spectrum_->set_options(options);
+    if (!impl_->spectrum_->is_running()) {
+        return true;
+    }
+
+    impl_->spectrum_->stop();
+    auto reader = create_master_bus_reader();
+    return reader && impl_->spectrum_->start(std::move(reader));
+}
+
+std::vector<float> AudioSystem::get_spectrum_data(int bins) {
+    return impl_->spectrum_->get_spectrum(bins);
+}
+float AudioSystem::detect_bpm(const std::string& channel_id) {
+    OneStopRadio::BeatGrid grid;
+    return get_beat_grid(channel_id, grid) ? grid.bpm : 0.0f;
+}
+
+bool AudioSystem::get_beat_grid(const std::string& channel_id, OneStopRadio::BeatGrid& grid) {
+    std::lock_guard<std::mutex> lock(impl_->channels_mutex_);
+    auto it = impl_->channel_slots_.find(channel_id);
+    if (it == impl_->channel_slots_.end() || !impl_->beat_trackers_[it->second]) {
+        return false;
+    }
+    grid = impl_->beat_trackers_[it->second]->grid();
+    return true;
+}
+
+bool AudioSystem::enable_bpm_sync(const std::string& channel_a, const std::string& channel_b) {
+    std::lock_guard<std::mutex> lock(impl_->channels_mutex_);
+    auto master = impl_->channel_slots_.find(channel_a);
+    auto slave = impl_->channel_slots_.find(channel_b);
+    if (master == impl_->channel_slots_.end() || slave == impl_->channel_slots_.end() || master == slave) {
+        Logger::warn("AudioSystem: BPM sync needs two distinct channels");
+        return false;
+    }
+    
+    ControlCommand command;
+    command.type = ControlCommand::Type::BPM_SYNC;
+    command.slot = master->second;
+    command.value = static_cast<float>(slave->second);
+    return impl_->push_command(command);
+}
+
+bool AudioSystem::disable_bpm_sync() {
+    ControlCommand command;
+    command.type = ControlCommand::Type::BPM_SYNC;
+    command.slot = -1;
+    return impl_->push_command(command);
+}
+
+BpmSyncStatus AudioSystem::get_bpm_sync_status() {
+    return impl_->bpm_sync_.load();
+}
+
+bool AudioSystem::set_microphone_gate_threshold(float threshold_db) {
+    std::lock_guard<std::mutex> lock(impl_->mic_mutex_);
+    impl_->mic_config_.gate_threshold = threshold_db;
+    impl_->push_mic_config();
+    return true;
+}
 
 // ===== ENHANCED MICROPHONE AND TALKOVER SUPPORT =====
 
@@ -760,26 +2070,7 @@ bool AudioSystem::fade_master_volume(float target_volume, float fade_time_ms) {
     Logger::info("AudioSystem: Fading master volume to " + std::to_string(target_volume) + 
                 " over " + std::to_string(fade_time_ms) + "ms");
     
-    // Start volume fade in separate thread
-    std::thread fade_thread([this, target_volume, fade_time_ms]() {
-        const float start_volume = impl_->master_volume_;
-        const float volume_delta = target_volume - start_volume;
-        const int steps = static_cast<int>(fade_time_ms / 10.0f); // 10ms per step
-        const float step_delta = volume_delta / steps;
-        
-        for (int i = 0; i < steps; ++i) {
-            float current_volume = start_volume + (step_delta * i);
-            impl_->master_volume_ = std::clamp(current_volume, 0.0f, 1.0f);
-            
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
-        
-        // Ensure final volume is exact
-        impl_->master_volume_ = std::clamp(target_volume, 0.0f, 1.0f);
-    });
-    
-    fade_thread.detach();
-    return true;
+    return ramp_master_volume(target_volume, fade_time_ms, RampShape::EXPONENTIAL);
 }
 
 
@@ -788,19 +2079,17 @@ bool AudioSystem::generate_waveform(const std::string& file_path, int width_pixe
                                    std::vector<float>& peaks, std::vector<float>& rms) {
     Logger::info("AudioSystem: Generating waveform for " + file_path + " with " + std::to_string(width_pixels) + " pixels");
     
-    // Open audio file using libsndfile
-    SF_INFO sf_info;
-    SNDFILE* file = sf_open(file_path.c_str(), SFM_READ, &sf_info);
-    if (!file) {
+    std::unique_ptr<OneStopRadio::AudioDecoder> decoder = OneStopRadio::AudioDecoder::open(file_path);
+    if (!decoder) {
         Logger::error("AudioSystem: Failed to open audio file for waveform generation: " + file_path);
         return false;
     }
+    const int channels = decoder->info().channels;
     
     // Calculate samples per pixel
-    const int samples_per_pixel = sf_info.frames / width_pixels;
+    const int samples_per_pixel = width_pixels > 0 ? static_cast<int>(decoder->info().frames / width_pixels) : 0;
     if (samples_per_pixel <= 0) {
         Logger::error("AudioSystem: Invalid samples per pixel calculation");
-        sf_close(file);
         return false;
     }
     
@@ -811,12 +2100,12 @@ bool AudioSystem::generate_waveform(const std::string& file_path, int width_pixe
     rms.reserve(width_pixels);
     
     // Read and process audio data
-    std::vector<float> buffer(samples_per_pixel * sf_info.channels);
+    std::vector<float> buffer(samples_per_pixel * channels);
     
     for (int pixel = 0; pixel < width_pixels; ++pixel) {
         // Read chunk of audio data
-        sf_count_t frames_read = sf_readf_float(file, buffer.data(), samples_per_pixel);
-        if (frames_read <= 0) {
+        const size_t frames_read = decoder->read(buffer.data(), samples_per_pixel);
+        if (frames_read == 0) {
             // End of file - fill remaining with zeros
             peaks.push_back(0.0f);
             rms.push_back(0.0f);
@@ -826,7 +2115,7 @@ bool AudioSystem::generate_waveform(const std::string& file_path, int width_pixe
         // Calculate peak and RMS for this chunk
         float max_peak = 0.0f;
         float rms_sum = 0.0f;
-        int sample_count = frames_read * sf_info.channels;
+        int sample_count = static_cast<int>(frames_read) * channels;
         
         for (int i = 0; i < sample_count; ++i) {
             float sample = std::abs(buffer[i]);
@@ -840,53 +2129,168 @@ bool AudioSystem::generate_waveform(const std::string& file_path, int width_pixe
         rms.push_back(rms_value);
     }
     
-    sf_close(file);
-    
     Logger::info("AudioSystem: Generated waveform with " + std::to_string(peaks.size()) + " data points");
     return true;
 }
 
 // ===== CHANNEL CONTROL METHODS =====
 
-bool AudioSystem::load_audio_file(const std::string& channel_id, const std::string& file_path) {
-    Logger::info("AudioSystem: Loading audio file " + file_path + " into channel " + channel_id);
-    
-    if (!std::filesystem::exists(file_path)) {
-        Logger::error("AudioSystem: File does not exist: " + file_path);
+bool AudioSystem::set_channel_position(const std::string& channel_id, double position_seconds) {
+    const int deck = deck_index(channel_id);
+    std::shared_ptr<const DecodedTrack> track;
+    if (deck >= 0) {
+        std::lock_guard<std::mutex> lock(deck_mutex_);
+        track = deck_tracks_[deck];
+    }
+    if (!track) {
         return false;
     }
     
-    // Open the audio file using libsndfile
-    SF_INFO file_info;
-    memset(&file_info, 0, sizeof(file_info));
+    position_seconds = std::clamp(position_seconds, 0.0, track->duration());
+    const auto frame = static_cast<uint64_t>(position_seconds * track->sample_rate());
+    
+    // Hot cues and prefetched regions are usually decoded already; if not,
+    // move the decoder here instead of reading on this thread
+    impl_->track_cache_->acquire(track->file_path(), position_seconds);
     
-    SNDFILE* file = sf_open(file_path.c_str(), SFM_READ, &file_info);
-    if (!file) {
-        Logger::error("AudioSystem: Failed to open audio file: " + file_path);
+    ControlCommand command;
+    command.type = ControlCommand::Type::DECK_SEEK;
+    command.slot = deck;
+    command.frame = frame;
+    if (!impl_->push_command(command)) {
+        return false;
+    }
+    impl_->deck_positions_[deck].store(frame, std::memory_order_relaxed);
+    return true;
+}
+
+double AudioSystem::get_channel_position(const std::string& channel_id) {
+    const int deck = deck_index(channel_id);
+    if (deck < 0) {
+        return 0.0;
+    }
+    std::lock_guard<std::mutex> lock(deck_mutex_);
+    const auto& track = deck_tracks_[deck];
+    return track ? static_cast<double>(impl_->deck_positions_[deck].load(std::memory_order_relaxed)) /
+                       track->sample_rate()
+                 : 0.0;
+}
+
+double AudioSystem::get_channel_duration(const std::string& channel_id) {
+    const int deck = deck_index(channel_id);
+    if (deck < 0) {
+        return 0.0;
+    }
+    std::lock_guard<std::mutex> lock(deck_mutex_);
+    return deck_tracks_[deck] ? deck_tracks_[deck]->duration() : 0.0;
+}
+
+bool AudioSystem::set_channel_playback_rate(const std::string& channel_id, double rate) {
+    const int deck = deck_index(channel_id);
+    if (deck < 0 || rate <= 0.0) {
+        return false;
+    }
+    ControlCommand command;
+    command.type = ControlCommand::Type::DECK_RATE;
+    command.slot = deck;
+    command.value = static_cast<float>(rate);
+    return impl_->push_command(command);
+}
+
+bool AudioSystem::set_channel_key_lock(const std::string& channel_id, bool enabled) {
+    const int deck = deck_index(channel_id);
+    if (deck < 0) {
         return false;
     }
+    ControlCommand command;
+    command.type = ControlCommand::Type::DECK_KEY_LOCK;
+    command.slot = deck;
+    command.value = enabled ? 1.0f : 0.0f;
+    return impl_->push_command(command);
+}
+
+bool AudioSystem::set_channel_pitch_shift(const std::string& channel_id, double semitones) {
+    const int deck = deck_index(channel_id);
+    if (deck < 0) {
+        return false;
+    }
+    ControlCommand command;
+    command.type = ControlCommand::Type::DECK_PITCH;
+    command.slot = deck;
+    command.value = static_cast<float>(std::clamp(semitones, -12.0, 12.0));
+    return impl_->push_command(command);
+}
+
+bool AudioSystem::get_time_stretch_stats(const std::string& channel_id, OneStopRadio::TimeStretchStats& stats) {
+    const int deck = deck_index(channel_id);
+    if (deck < 0 || !impl_->decks_[deck].stretcher) {
+        return false;
+    }
+    stats = impl_->decks_[deck].stretcher->stats();
+    return true;
+}
+
+void AudioSystem::prefetch_audio_file(const std::string& file_path) {
+    impl_->track_cache_->prefetch(file_path);
+}
+
+void AudioSystem::preload_audio_region(const std::string& file_path, double position_seconds) {
+    impl_->track_cache_->prefetch_region(file_path, position_seconds);
+}
+
+void AudioSystem::set_track_cache_budget(size_t bytes) {
+    impl_->track_cache_->set_memory_budget(bytes);
+}
+
+TrackCacheStats AudioSystem::get_track_cache_stats() {
+    return impl_->track_cache_->get_stats();
+}
+
+bool AudioSystem::load_audio_file(const std::string& channel_id, const std::string& file_path) {
+    Logger::info("AudioSystem: Loading audio file " + file_path + " into channel " + channel_id);
     
-    // Store file information for the channel
-    if (channel_id == "A") {
-        channel_a_file_ = file;
-        channel_a_info_ = file_info;
-        channel_a_loaded_ = true;
-        channel_a_position_ = 0;
-    } else if (channel_id == "B") {
-        channel_b_file_ = file;
-        channel_b_info_ = file_info;
-        channel_b_loaded_ = true;
-        channel_b_position_ = 0;
-    } else {
-        sf_close(file);
+    const int deck = deck_index(channel_id);
+    if (deck < 0) {
         Logger::error("AudioSystem: Invalid channel ID: " + channel_id);
         return false;
     }
     
+    // A cached or prefetched track is handed over as is; otherwise only the
+    // header is read here and the samples are decoded in the background
+    std::shared_ptr<const DecodedTrack> track = impl_->track_cache_->acquire(file_path);
+    if (!track) {
+        Logger::error(std::filesystem::exists(file_path) ? "AudioSystem: Failed to open audio file: " + file_path
+                                                         : "AudioSystem: File does not exist: " + file_path);
+        return false;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(deck_mutex_);
+        deck_tracks_[deck] = track;
+    }
+    {
+        // The audio thread picks the track up with the next graph, stopped at the top
+        std::lock_guard<std::mutex> lock(impl_->channels_mutex_);
+        impl_->deck_tracks_[deck] = track;
+        impl_->publish_graph();
+    }
+    impl_->deck_positions_[deck].store(0, std::memory_order_relaxed);
+    
+    // Reloading the same track keeps the pointer, so stop and rewind explicitly
+    ControlCommand stop;
+    stop.type = ControlCommand::Type::DECK_PLAY;
+    stop.slot = deck;
+    impl_->push_command(stop);
+    ControlCommand rewind;
+    rewind.type = ControlCommand::Type::DECK_SEEK;
+    rewind.slot = deck;
+    impl_->push_command(rewind);
+    
     Logger::info("AudioSystem: Successfully loaded audio file into channel " + channel_id + 
-                " (Sample Rate: " + std::to_string(file_info.samplerate) + 
-                ", Channels: " + std::to_string(file_info.channels) + 
-                ", Duration: " + std::to_string(file_info.frames / file_info.samplerate) + "s)");
+                " (Sample Rate: " + std::to_string(track->sample_rate()) + 
+                ", Channels: " + std::to_string(track->channels()) + 
+                ", Duration: " + std::to_string(static_cast<int>(track->duration())) + "s" +
+                (track->is_complete() ? ", cached)" : ")"));
     
     return true;
 }
@@ -894,48 +2298,67 @@ bool AudioSystem::load_audio_file(const std::string& channel_id, const std::stri
 bool AudioSystem::set_channel_playback(const std::string& channel_id, bool play) {
     Logger::info("AudioSystem: Setting channel " + channel_id + " playback to " + (play ? "play" : "stop"));
     
-    if (channel_id == "A") {
-        if (!channel_a_loaded_) {
-            Logger::error("AudioSystem: No audio file loaded in channel A");
-            return false;
-        }
-        channel_a_playing_ = play;
-        if (!play) {
-            channel_a_position_ = 0; // Reset position when stopping
-        }
-    } else if (channel_id == "B") {
-        if (!channel_b_loaded_) {
-            Logger::error("AudioSystem: No audio file loaded in channel B");
+    const int deck = deck_index(channel_id);
+    if (deck < 0) {
+        Logger::error("AudioSystem: Invalid channel ID: " + channel_id);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(deck_mutex_);
+        if (!deck_tracks_[deck]) {
+            Logger::error("AudioSystem: No audio file loaded in channel " + channel_id);
             return false;
         }
-        channel_b_playing_ = play;
-        if (!play) {
-            channel_b_position_ = 0; // Reset position when stopping
-        }
-    } else {
-        Logger::error("AudioSystem: Invalid channel ID: " + channel_id);
+    }
+    
+    ControlCommand command;
+    command.type = ControlCommand::Type::DECK_PLAY;
+    command.slot = deck;
+    command.value = play ? 1.0f : 0.0f;
+    if (!impl_->push_command(command)) {
         return false;
     }
+    if (!play) {
+        // Reset position when stopping
+        ControlCommand rewind;
+        rewind.type = ControlCommand::Type::DECK_SEEK;
+        rewind.slot = deck;
+        impl_->push_command(rewind);
+        impl_->deck_positions_[deck].store(0, std::memory_order_relaxed);
+    }
     
     Logger::info("AudioSystem: Channel " + channel_id + " playback set to " + (play ? "playing" : "stopped"));
     return true;
 }
 
 bool AudioSystem::set_channel_volume(const std::string& channel_id, float volume) {
+    return ramp_channel_volume(channel_id, volume, kDezipperMs, RampShape::LINEAR);
+}
+
+bool AudioSystem::ramp_channel_volume(const std::string& channel_id, float volume, float ramp_ms, RampShape shape) {
     Logger::info("AudioSystem: Setting channel " + channel_id + " volume to " + std::to_string(volume));
     
     // Clamp volume to valid range (0.0 to 1.0)
     volume = std::max(0.0f, std::min(1.0f, volume));
     
-    if (channel_id == "A") {
+    const int deck = deck_index(channel_id);
+    if (deck == 0) {
         channel_a_volume_ = volume;
-    } else if (channel_id == "B") {
+    } else if (deck == 1) {
         channel_b_volume_ = volume;
     } else {
         Logger::error("AudioSystem: Invalid channel ID: " + channel_id);
         return false;
     }
     
+    ControlCommand command;
+    command.type = ControlCommand::Type::DECK_GAIN;
+    command.slot = deck;
+    command.value = volume;
+    command.ramp_frames = impl_->ramp_frames(ramp_ms);
+    command.shape = shape;
+    impl_->push_command(command);
+    
     Logger::info("AudioSystem: Channel " + channel_id + " volume set to " + std::to_string(volume));
     return true;
 }
@@ -945,11 +2368,12 @@ bool AudioSystem::set_channel_eq(const std::string& channel_id, float bass, floa
                  std::to_string(bass) + ", Mid: " + std::to_string(mid) + ", Treble: " + std::to_string(treble));
     
     // Store EQ settings for the channel
-    if (channel_id == "A") {
+    const int deck = deck_index(channel_id);
+    if (deck == 0) {
         channel_a_eq_bass_ = bass;
         channel_a_eq_mid_ = mid;
         channel_a_eq_treble_ = treble;
-    } else if (channel_id == "B") {
+    } else if (deck == 1) {
         channel_b_eq_bass_ = bass;
         channel_b_eq_mid_ = mid;
         channel_b_eq_treble_ = treble;
@@ -958,10 +2382,42 @@ bool AudioSystem::set_channel_eq(const std::string& channel_id, float bass, floa
         return false;
     }
     
+    // Gains in dB; the audio thread smooths toward them
+    const std::pair<OneStopRadio::DeckEqBand, float> bands[] = {
+        {OneStopRadio::DeckEqBand::LOW, bass},
+        {OneStopRadio::DeckEqBand::MID, mid},
+        {OneStopRadio::DeckEqBand::HIGH, treble}
+    };
+    for (const auto& band : bands) {
+        ControlCommand command;
+        command.type = ControlCommand::Type::DECK_EQ_BAND;
+        command.slot = deck;
+        command.value = static_cast<float>(band.first);
+        command.value2 = std::pow(10.0f, band.second / 20.0f);
+        impl_->push_command(command);
+    }
+    
     Logger::info("AudioSystem: Channel " + channel_id + " EQ settings updated");
     return true;
 }
 
+bool AudioSystem::set_channel_filter(const std::string& channel_id, float position) {
+    const int deck = deck_index(channel_id);
+    if (deck < 0) {
+        Logger::error("AudioSystem: Invalid channel ID: " + channel_id);
+        return false;
+    }
+    
+    ControlCommand command;
+    command.type = ControlCommand::Type::DECK_FILTER;
+    command.slot = deck;
+    command.value = std::max(-1.0f, std::min(1.0f, position));
+    impl_->push_command(command);
+    
+    Logger::info("AudioSystem: Channel " + channel_id + " filter set to " + std::to_string(command.value));
+    return true;
+}
+
 // ===== AUDIO LEVEL MONITORING =====
 
 bool AudioSystem::enable_level_monitoring(bool enabled) {
@@ -992,12 +2448,12 @@ AudioLevels AudioSystem::get_master_audio_levels() {
         return levels; // Return zeroed levels
     }
     
-    // Get current master levels (these would be calculated during audio processing)
-    levels.left_peak = master_peak_left_;
-    levels.right_peak = master_peak_right_;
-    levels.left_rms = master_rms_left_;
-    levels.right_rms = master_rms_right_;
-    levels.clipping = (master_peak_left_ > 1.0f || master_peak_right_ > 1.0f);
+    // Latest snapshot published by the audio callback
+    levels = impl_->master_levels_.load();
+    master_peak_left_ = levels.left_peak;
+    master_peak_right_ = levels.right_peak;
+    master_rms_left_ = levels.left_rms;
+    master_rms_right_ = levels.right_rms;
     
     return levels;
 }
@@ -1012,4 +2468,418 @@ float AudioSystem::get_microphone_level() {
 
 bool AudioSystem::is_microphone_enabled() const {
     return impl_->microphone_enabled_;
-}
\ No newline at end of file
+}
+
+// ===== EFFECTS =====
+
+namespace {
+
+// One effect's place in the chain, shared by every list that includes it so
+// a fade carries on across edits
+struct EffectSlot {
+    explicit EffectSlot(std::shared_ptr<AudioEffect> e, float initial_mix)
+        : effect(std::move(e)), mix(initial_mix) {}
+
+    std::shared_ptr<AudioEffect> effect;
+    std::atomic<float> mix;             // Wet amount; advanced by the audio thread
+};
+
+// Immutable once published
+struct EffectGraph {
+    struct Node {
+        std::shared_ptr<EffectSlot> slot;
+        bool active;                    // False while a removed effect fades out
+    };
+    std::vector<Node> nodes;
+    float fade_step = 1.0f;             // Mix change per frame
+};
+
+constexpr size_t kEffectScratchSamples = 8192;
+
+} // namespace
+
+class AudioEffectChain::Impl {
+public:
+    struct Binding {
+        std::weak_ptr<AudioEffect> effect;
+        int index;
+    };
+
+    mutable std::mutex edit_mutex;      // Serializes edits; process() never takes it
+    std::atomic<EffectGraph*> graph{nullptr};
+    std::atomic<uint64_t> blocks_completed{0};
+    std::vector<std::pair<uint64_t, std::unique_ptr<EffectGraph>>> retired;
+    std::vector<Binding> bindings;
+    int crossfade_frames = 0;
+    std::vector<float> scratch = std::vector<float>(kEffectScratchSamples);   // Audio thread
+
+    ~Impl() {
+        delete graph.load();
+    }
+
+    // Caller holds edit_mutex; the current list is only replaced under it
+    const EffectGraph* current() const {
+        return graph.load(std::memory_order_relaxed);
+    }
+
+    // A copy of the current list to edit. Removed effects that finished
+    // fading out are dropped here.
+    std::unique_ptr<EffectGraph> copy_current() const {
+        auto next = std::make_unique<EffectGraph>();
+        next->fade_step = crossfade_frames > 0 ? 1.0f / static_cast<float>(crossfade_frames) : 1.0f;
+        if (const EffectGraph* graph_now = current()) {
+            for (const auto& node : graph_now->nodes) {
+                if (node.active || node.slot->mix.load(std::memory_order_relaxed) > 0.0f) {
+                    next->nodes.push_back(node);
+                }
+            }
+        }
+        return next;
+    }
+
+    // Take a node out of the list, fading it when a crossfade is set. Its
+    // parameter ids stop working straight away.
+    void retire_node(EffectGraph& next, size_t index) {
+        const std::shared_ptr<AudioEffect>& effect = next.nodes[index].slot->effect;
+        for (auto& binding : bindings) {
+            if (binding.effect.lock() == effect) {
+                binding.effect.reset();
+            }
+        }
+        if (crossfade_frames > 0) {
+            next.nodes[index].active = false;
+        } else {
+            next.nodes.erase(next.nodes.begin() + static_cast<std::ptrdiff_t>(index));
+        }
+    }
+
+    // Caller holds edit_mutex
+    void publish(std::unique_ptr<EffectGraph> next) {
+        EffectGraph* old_graph = graph.exchange(next.release(), std::memory_order_acq_rel);
+        if (old_graph) {
+            retired.emplace_back(blocks_completed.load(), std::unique_ptr<EffectGraph>(old_graph));
+        }
+        // Anything retired before the last completed block started is unreachable
+        const uint64_t completed = blocks_completed.load();
+        retired.erase(std::remove_if(retired.begin(), retired.end(),
+                                     [completed](const auto& entry) { return entry.first < completed; }),
+                      retired.end());
+    }
+
+    // Run one effect over the block, blending with its input while it fades
+    void process_node(const EffectGraph::Node& node, float fade_step, float* samples, int frames, int channels) {
+        EffectSlot& slot = *node.slot;
+        const float target = node.active ? 1.0f : 0.0f;
+        float mix = slot.mix.load(std::memory_order_relaxed);
+        if (mix == target) {
+            if (node.active) {
+                slot.effect->process(samples, frames, channels);
+            }
+            return;
+        }
+
+        const int chunk_frames = static_cast<int>(scratch.size()) / channels;
+        const float step = node.active ? fade_step : -fade_step;
+        for (int offset = 0; offset < frames; offset += chunk_frames) {
+            const int n = std::min(frames - offset, chunk_frames);
+            float* block = samples + static_cast<size_t>(offset) * channels;
+            float* wet = scratch.data();
+            std::copy(block, block + static_cast<size_t>(n) * channels, wet);
+            slot.effect->process(wet, n, channels);
+            for (int i = 0; i < n; ++i) {
+                mix = node.active ? std::min(mix + step, 1.0f) : std::max(mix + step, 0.0f);
+                for (int c = 0; c < channels; ++c) {
+                    float& sample = block[i * channels + c];
+                    sample += (wet[i * channels + c] - sample) * mix;
+                }
+            }
+        }
+        slot.mix.store(mix, std::memory_order_relaxed);
+    }
+};
+
+AudioEffectChain::AudioEffectChain() : impl_(std::make_unique<Impl>()) {}
+
+AudioEffectChain::~AudioEffectChain() = default;
+
+void AudioEffectChain::add_effect(std::unique_ptr<AudioEffect> effect) {
+    if (!effect) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(impl_->edit_mutex);
+    auto next = impl_->copy_current();
+    // An effect with the same id is replaced
+    for (size_t i = 0; i < next->nodes.size(); ++i) {
+        if (next->nodes[i].active && next->nodes[i].slot->effect->get_id() == effect->get_id()) {
+            impl_->retire_node(*next, i);
+            break;
+        }
+    }
+    const float initial_mix = impl_->crossfade_frames > 0 ? 0.0f : 1.0f;
+    next->nodes.push_back({std::make_shared<EffectSlot>(std::shared_ptr<AudioEffect>(std::move(effect)), initial_mix),
+                           true});
+    impl_->publish(std::move(next));
+}
+
+void AudioEffectChain::remove_effect(const std::string& effect_id) {
+    std::lock_guard<std::mutex> lock(impl_->edit_mutex);
+    auto next = impl_->copy_current();
+    for (size_t i = 0; i < next->nodes.size(); ++i) {
+        if (next->nodes[i].active && next->nodes[i].slot->effect->get_id() == effect_id) {
+            impl_->retire_node(*next, i);
+            impl_->publish(std::move(next));
+            return;
+        }
+    }
+}
+
+void AudioEffectChain::clear_effects() {
+    std::lock_guard<std::mutex> lock(impl_->edit_mutex);
+    auto next = impl_->copy_current();
+    for (size_t i = next->nodes.size(); i-- > 0;) {
+        if (next->nodes[i].active) {
+            impl_->retire_node(*next, i);
+        }
+    }
+    impl_->publish(std::move(next));
+}
+
+std::vector<std::string> AudioEffectChain::get_effect_ids() const {
+    std::lock_guard<std::mutex> lock(impl_->edit_mutex);
+    std::vector<std::string> ids;
+    if (const EffectGraph* graph = impl_->current()) {
+        for (const auto& node : graph->nodes) {
+            if (node.active) {
+                ids.push_back(node.slot->effect->get_id());
+            }
+        }
+    }
+    return ids;
+}
+
+void AudioEffectChain::set_crossfade_frames(int frames) {
+    std::lock_guard<std::mutex> lock(impl_->edit_mutex);
+    impl_->crossfade_frames = std::max(frames, 0);
+}
+
+void AudioEffectChain::process(float* samples, int frames, int channels) {
+    const EffectGraph* graph = impl_->graph.load(std::memory_order_acquire);
+    if (graph && !bypassed_ && frames > 0 && channels > 0) {
+        for (const auto& node : graph->nodes) {
+            impl_->process_node(node, graph->fade_step, samples, frames, channels);
+        }
+    }
+    impl_->blocks_completed.fetch_add(1, std::memory_order_release);
+}
+
+AudioEffectChain::ParameterId AudioEffectChain::bind_parameter(const std::string& effect_id, const std::string& name) {
+    std::lock_guard<std::mutex> lock(impl_->edit_mutex);
+    const EffectGraph* graph = impl_->current();
+    if (!graph) {
+        return kInvalidParameter;
+    }
+    for (const auto& node : graph->nodes) {
+        if (!node.active || node.slot->effect->get_id() != effect_id) {
+            continue;
+        }
+        const int index = node.slot->effect->get_parameter_index(name);
+        if (index < 0) {
+            return kInvalidParameter;
+        }
+        for (size_t id = 0; id < impl_->bindings.size(); ++id) {
+            if (impl_->bindings[id].index == index && impl_->bindings[id].effect.lock() == node.slot->effect) {
+                return static_cast<ParameterId>(id);
+            }
+        }
+        impl_->bindings.push_back({node.slot->effect, index});
+        return static_cast<ParameterId>(impl_->bindings.size() - 1);
+    }
+    return kInvalidParameter;
+}
+
+bool AudioEffectChain::set_parameter(ParameterId id, float value) {
+    std::shared_ptr<AudioEffect> effect;
+    int index = -1;
+    {
+        std::lock_guard<std::mutex> lock(impl_->edit_mutex);
+        if (id < 0 || static_cast<size_t>(id) >= impl_->bindings.size()) {
+            return false;
+        }
+        effect = impl_->bindings[id].effect.lock();
+        index = impl_->bindings[id].index;
+    }
+    return effect && effect->set_parameter(index, value);
+}
+
+// One stereo pair on the first two lanes of the deck equalizer. The effect
+// has no sample rate of its own, so the bands are placed for 48 kHz.
+class AudioEqualizer::Impl {
+public:
+    OneStopRadio::DeckEqualizer eq;
+    alignas(16) float lanes[OneStopRadio::DeckEqualizer::kSubBlockFrames * OneStopRadio::DeckEqualizer::kLanes] = {};
+};
+
+AudioEqualizer::AudioEqualizer(const std::string& id)
+    : AudioEffect(id), impl_(std::make_unique<Impl>()) {
+    add_parameter("low_gain", 0.0f);
+    add_parameter("mid_gain", 0.0f);
+    add_parameter("high_gain", 0.0f);
+}
+
+AudioEqualizer::~AudioEqualizer() = default;
+
+void AudioEqualizer::process(float* samples, int frames, int channels) {
+    OneStopRadio::DeckEqSettings settings;
+    settings.low = std::pow(10.0f, parameter(LOW_GAIN) / 20.0f);
+    settings.mid = std::pow(10.0f, parameter(MID_GAIN) / 20.0f);
+    settings.high = std::pow(10.0f, parameter(HIGH_GAIN) / 20.0f);
+    impl_->eq.set(0, settings);
+    if (!enabled_ || channels < 1 || !impl_->eq.active()) {
+        return;
+    }
+    
+    constexpr int kLanes = OneStopRadio::DeckEqualizer::kLanes;
+    const int right = channels > 1 ? 1 : 0;
+    for (int offset = 0; offset < frames; offset += static_cast<int>(OneStopRadio::DeckEqualizer::kSubBlockFrames)) {
+        const int n = std::min(frames - offset, static_cast<int>(OneStopRadio::DeckEqualizer::kSubBlockFrames));
+        float* block = samples + static_cast<size_t>(offset) * channels;
+        for (int i = 0; i < n; ++i) {
+            impl_->lanes[i * kLanes] = block[i * channels];
+            impl_->lanes[i * kLanes + 1] = block[i * channels + right];
+        }
+        impl_->eq.process(impl_->lanes, n);
+        for (int i = 0; i < n; ++i) {
+            block[i * channels] = impl_->lanes[i * kLanes];
+            if (right) {
+                block[i * channels + 1] = impl_->lanes[i * kLanes + 1];
+            }
+        }
+    }
+}
+
+void AudioEqualizer::reset() {
+    impl_->eq.reset();
+}
+
+void AudioEqualizer::set_low_gain(float gain_db) {
+    set_parameter(LOW_GAIN, gain_db);
+}
+
+void AudioEqualizer::set_mid_gain(float gain_db) {
+    set_parameter(MID_GAIN, gain_db);
+}
+
+void AudioEqualizer::set_high_gain(float gain_db) {
+    set_parameter(HIGH_GAIN, gain_db);
+}
+
+// Compressor only (no lookahead or limiting) on the shared dynamics code.
+// Like the equalizer, the effect has no sample rate of its own; 48 kHz.
+class AudioCompressor::Impl {
+public:
+    static OneStopRadio::DynamicsOptions options() {
+        OneStopRadio::DynamicsOptions options;
+        options.lookahead_ms = 0.0f;
+        options.true_peak = false;
+        options.limiter_enabled = false;
+        options.compressor_enabled = true;
+        return options;
+    }
+    
+    // One per channel layout, built up front so process() never allocates
+    Impl() {
+        for (int channels = 1; channels <= OneStopRadio::DynamicsProcessor::kMaxChannels; ++channels) {
+            OneStopRadio::DynamicsOptions layout = options();
+            layout.channels = channels;
+            dynamics[channels - 1] = std::make_unique<OneStopRadio::DynamicsProcessor>(layout);
+        }
+    }
+    
+    std::array<std::unique_ptr<OneStopRadio::DynamicsProcessor>, OneStopRadio::DynamicsProcessor::kMaxChannels> dynamics;
+};
+
+AudioCompressor::AudioCompressor(const std::string& id)
+    : AudioEffect(id), impl_(std::make_unique<Impl>()) {
+    const OneStopRadio::DynamicsOptions defaults = Impl::options();
+    add_parameter("threshold", defaults.threshold_db);
+    add_parameter("ratio", defaults.ratio);
+    add_parameter("attack", defaults.attack_ms);
+    add_parameter("release", defaults.release_ms);
+    add_parameter("makeup_gain", defaults.makeup_db);
+}
+
+AudioCompressor::~AudioCompressor() = default;
+
+void AudioCompressor::process(float* samples, int frames, int channels) {
+    if (!enabled_ || channels < 1 || channels > OneStopRadio::DynamicsProcessor::kMaxChannels || frames <= 0) {
+        return;
+    }
+    OneStopRadio::DynamicsProcessor& dynamics = *impl_->dynamics[channels - 1];
+    dynamics.set_compressor(true, parameter(THRESHOLD), parameter(RATIO));
+    const float attack = parameter(ATTACK);
+    const float release = parameter(RELEASE);
+    if (attack != dynamics.options().attack_ms || release != dynamics.options().release_ms) {
+        dynamics.set_compressor_timing(attack, release);
+    }
+    dynamics.set_makeup_gain(parameter(MAKEUP_GAIN));
+    dynamics.process(samples, static_cast<size_t>(frames));
+}
+
+void AudioCompressor::reset() {
+    for (auto& dynamics : impl_->dynamics) {
+        dynamics->reset();
+    }
+}
+
+void AudioCompressor::set_threshold(float threshold_db) {
+    set_parameter(THRESHOLD, threshold_db);
+}
+
+void AudioCompressor::set_ratio(float ratio) {
+    set_parameter(RATIO, ratio);
+}
+
+void AudioCompressor::set_attack(float attack_ms) {
+    set_parameter(ATTACK, attack_ms);
+}
+
+void AudioCompressor::set_release(float release_ms) {
+    set_parameter(RELEASE, release_ms);
+}
+
+void AudioCompressor::set_makeup_gain(float gain_db) {
+    set_parameter(MAKEUP_GAIN, gain_db);
+}
+
+/**
+ * LiveInput implementation
+ */
+
+LiveInput::LiveInput(const std::string& id, int sample_rate, int channels, size_t block_frames)
+    : id_(id)
+    , block_frames_(block_frames)
+    , ring_(AudioRingBuffer::create(static_cast<size_t>(sample_rate), channels, sample_rate))
+    , reader_(ring_->create_reader()) {}
+
+void LiveInput::write(const float* interleaved, size_t frames) {
+    ring_->write(interleaved, frames);
+}
+
+size_t LiveInput::buffered_frames() const {
+    // Frames the reader skipped after an overrun were never mixed, but are gone
+    const uint64_t written = ring_->frames_written();
+    const uint64_t consumed = consumed_.load(std::memory_order_relaxed) + reader_->dropped_frames();
+    return written > consumed ? static_cast<size_t>(written - consumed) : 0;
+}
+
+bool LiveInput::read(float* out, size_t frames) {
+    if (!reader_->try_read(out, frames)) {
+        // Part of a block arrived late; a feed that has paused is just silent
+        if (buffered_frames() > 0) {
+            underruns_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return false;
+    }
+    consumed_.store(consumed_.load(std::memory_order_relaxed) + frames, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,269 @@
+#include "beat_tracker.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace OneStopRadio {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr float kLowBandHz = 150.0f;
+constexpr float kEnergyFloor = 1e-6f;       // About -60 dBFS; keeps silence from producing flux
+constexpr double kPriorBpm = 120.0;
+constexpr double kPriorOctaves = 1.0;       // Standard deviation of the tempo prior
+constexpr float kSmoothingTolerance = 0.02f;
+constexpr float kPeriodSmoothing = 0.2f;    // Weight of a new estimate close to the current tempo
+constexpr double kPhaseGain = 0.25;         // PLL correction per update
+constexpr float kAnchorConfidence = 0.3f;
+
+} // namespace
+
+double BeatGrid::phase_at(double time) const {
+    if (bpm <= 0.0f) {
+        return 0.0;
+    }
+    const double beats = (time - beat_time) * bpm / 60.0;
+    return beats - std::floor(beats);
+}
+
+BeatTracker::BeatTracker(const BeatTrackerOptions& options)
+    : options_(options) {
+    if (options_.sample_rate <= 0 || options_.onset_rate <= 0.0f || options_.min_bpm <= 0.0f ||
+        options_.max_bpm <= options_.min_bpm || options_.history_seconds <= 0.0f ||
+        options_.update_seconds <= 0.0f) {
+        throw std::invalid_argument("BeatTracker: invalid options");
+    }
+
+    hop_ = std::max(1, static_cast<int>(std::lround(options_.sample_rate / options_.onset_rate)));
+    frame_rate_ = static_cast<double>(options_.sample_rate) / hop_;
+    min_lag_ = std::max(2, static_cast<int>(std::floor(60.0 * frame_rate_ / options_.max_bpm)));
+    max_lag_ = std::max(min_lag_ + 1, static_cast<int>(std::ceil(60.0 * frame_rate_ / options_.min_bpm)));
+
+    const size_t lags = 2 * static_cast<size_t>(max_lag_ + 1) + 2;
+    const size_t history = std::max(static_cast<size_t>(std::ceil(options_.history_seconds * frame_rate_)), lags);
+    onsets_.assign(history, 0.0f);
+    acf_.assign(lags, 0.0);
+
+    acf_decay_ = options_.mode == BeatTrackerMode::STREAMING
+        ? std::exp(-1.0 / (options_.history_seconds * frame_rate_))
+        : 1.0;
+    mean_decay_ = static_cast<float>(std::exp(-1.0 / frame_rate_));   // One second
+    low_coefficient_ = static_cast<float>(1.0 - std::exp(-2.0 * kPi * kLowBandHz / options_.sample_rate));
+    update_frames_ = std::max(1, static_cast<int>(std::lround(options_.update_seconds * frame_rate_)));
+
+    reset();
+}
+
+void BeatTracker::reset() {
+    low_state_ = 0.0f;
+    energy_ = 0.0f;
+    low_energy_ = 0.0f;
+    hop_fill_ = 0;
+    last_log_energy_ = std::log(kEnergyFloor);
+    last_log_low_ = std::log(kEnergyFloor);
+    onset_mean_ = 0.0f;
+    samples_ = 0;
+
+    std::fill(onsets_.begin(), onsets_.end(), 0.0f);
+    std::fill(acf_.begin(), acf_.end(), 0.0);
+    frames_ = 0;
+
+    frames_since_update_ = 0;
+    anchored_ = false;
+    anchor_frame_ = 0.0;
+    beat_frame_ = 0.0;
+    period_frames_ = 0.0f;
+    grid_ = BeatGrid();
+    published_.store(grid_);
+}
+
+void BeatTracker::process(const float* mono, size_t frames) {
+    const float inverse_hop = 1.0f / hop_;
+
+    for (size_t i = 0; i < frames; ++i) {
+        const float x = mono[i];
+        low_state_ += low_coefficient_ * (x - low_state_);
+        energy_ += x * x;
+        low_energy_ += low_state_ * low_state_;
+
+        if (++hop_fill_ == hop_) {
+            const float log_energy = std::log(energy_ * inverse_hop + kEnergyFloor);
+            const float log_low = std::log(low_energy_ * inverse_hop + kEnergyFloor);
+            const float onset = std::max(0.0f, log_energy - last_log_energy_) +
+                                std::max(0.0f, log_low - last_log_low_);
+            last_log_energy_ = log_energy;
+            last_log_low_ = log_low;
+            energy_ = low_energy_ = 0.0f;
+            hop_fill_ = 0;
+
+            push_onset(onset);
+        }
+    }
+    samples_ += frames;
+}
+
+void BeatTracker::push_onset(float onset) {
+    onset_mean_ = mean_decay_ * onset_mean_ + (1.0f - mean_decay_) * onset;
+    const float centred = onset - onset_mean_;
+
+    const size_t size = onsets_.size();
+    const size_t position = static_cast<size_t>(frames_ % size);
+    onsets_[position] = centred;
+
+    // One frame of every lag, so the cost per hop is constant
+    const size_t lags = static_cast<size_t>(std::min<uint64_t>(acf_.size() - 1, frames_));
+    size_t index = position;
+    for (size_t lag = 0; lag <= lags; ++lag) {
+        acf_[lag] = acf_decay_ * acf_[lag] + static_cast<double>(centred) * onsets_[index];
+        index = index == 0 ? size - 1 : index - 1;
+    }
+    ++frames_;
+
+    if (++frames_since_update_ >= update_frames_) {
+        frames_since_update_ = 0;
+        if (options_.mode == BeatTrackerMode::STREAMING) {
+            update_grid(true);
+        } else if (!anchored_ && frames_ >= onsets_.size()) {
+            anchor_offline();
+        }
+    }
+}
+
+void BeatTracker::anchor_offline() {
+    // Folding a late beat back to the start multiplies any tempo error by the
+    // number of beats in between, so place a beat as early as there is a
+    // confident tempo and fold only that one in finish()
+    float lag = 0.0f;
+    float confidence = 0.0f;
+    if (estimate_tempo(lag, confidence) && confidence >= kAnchorConfidence) {
+        anchor_frame_ = locate_beat(lag);
+        anchored_ = true;
+    }
+}
+
+double BeatTracker::score(int lag) const {
+    // Onsets are one frame wide, so a peak at a fractional lag is spread over
+    // its neighbours: smooth the lag, and take the best of the double's neighbours
+    const double base = 0.25 * acf_[lag - 1] + 0.5 * acf_[lag] + 0.25 * acf_[lag + 1];
+    const double twice = std::max({acf_[2 * lag - 1], acf_[2 * lag], acf_[2 * lag + 1]});
+
+    // Comb of the lag and its double, under a log-normal prior on the tempo
+    const double bpm = 60.0 * frame_rate_ / lag;
+    const double octaves = std::log2(bpm / kPriorBpm) / kPriorOctaves;
+    return (base + 0.5 * twice) * std::exp(-0.5 * octaves * octaves);
+}
+
+bool BeatTracker::estimate_tempo(float& lag, float& confidence) const {
+    // Wait until every lag, doubled, has been seen
+    if (frames_ < acf_.size() || acf_[0] <= 0.0) {
+        return false;
+    }
+
+    int best = min_lag_;
+    double best_score = score(min_lag_);
+    for (int l = min_lag_ + 1; l <= max_lag_; ++l) {
+        const double s = score(l);
+        if (s > best_score) {
+            best_score = s;
+            best = l;
+        }
+    }
+    if (best_score <= 0.0) {
+        return false;
+    }
+
+    // Parabolic interpolation between neighbouring lags
+    double offset = 0.0;
+    const double before = score(best - 1);
+    const double after = score(best + 1);
+    const double curvature = before - 2.0 * best_score + after;
+    if (curvature < 0.0) {
+        offset = std::clamp(0.5 * (before - after) / curvature, -0.5, 0.5);
+    }
+
+    lag = static_cast<float>(best + offset);
+    confidence = static_cast<float>(std::clamp(acf_[best] / acf_[0], 0.0, 1.0));
+    return true;
+}
+
+double BeatTracker::locate_beat(float lag) const {
+    // Comb over the history: the phase whose comb teeth collect the most onset
+    const size_t size = onsets_.size();
+    const uint64_t newest = frames_ - 1;
+    const double available = static_cast<double>(std::min<uint64_t>(frames_, size));
+    const int phases = std::max(1, static_cast<int>(std::ceil(lag)));
+
+    int best_phase = 0;
+    float best_sum = -1.0f;
+    for (int phase = 0; phase < phases; ++phase) {
+        float sum = 0.0f;
+        for (double back = phase; back < available; back += lag) {
+            const uint64_t frame = newest - static_cast<uint64_t>(std::lround(back));
+            sum += std::max(0.0f, onsets_[static_cast<size_t>(frame % size)]);
+        }
+        if (sum > best_sum) {
+            best_sum = sum;
+            best_phase = phase;
+        }
+    }
+    return static_cast<double>(newest) - best_phase;
+}
+
+void BeatTracker::update_grid(bool lock_phase) {
+    float lag = 0.0f;
+    float confidence = 0.0f;
+    if (!estimate_tempo(lag, confidence)) {
+        return;
+    }
+
+    const bool same_tempo = lock_phase && period_frames_ > 0.0f &&
+                            std::abs(lag - period_frames_) < kSmoothingTolerance * period_frames_;
+    period_frames_ = same_tempo ? period_frames_ + kPeriodSmoothing * (lag - period_frames_) : lag;
+
+    const double measured = locate_beat(period_frames_);
+    if (same_tempo) {
+        // Move the anchor to the predicted beat nearest the measurement, then part of the way to it
+        const double beats = std::round((measured - beat_frame_) / period_frames_);
+        const double predicted = beat_frame_ + beats * period_frames_;
+        beat_frame_ = predicted + kPhaseGain * (measured - predicted);
+    } else {
+        beat_frame_ = measured;
+    }
+
+    grid_.bpm = static_cast<float>(60.0 * frame_rate_ / period_frames_);
+    grid_.confidence = confidence;
+    grid_.beat_time = frame_time(beat_frame_);
+    grid_.stream_time = stream_time();
+    published_.store(grid_);
+}
+
+BeatGrid BeatTracker::finish() {
+    period_frames_ = 0.0f;
+    update_grid(false);
+
+    if (grid_.bpm > 0.0f) {
+        if (anchored_) {
+            grid_.beat_time = frame_time(anchor_frame_);
+        }
+        const double period = 60.0 / grid_.bpm;
+        grid_.beat_time -= std::floor(grid_.beat_time / period) * period;
+        published_.store(grid_);
+    }
+    return grid_;
+}
+
+double BeatTracker::frame_time(double frame) const {
+    // An onset frame stands for the middle of its hop
+    return (frame + 0.5) * hop_ / options_.sample_rate;
+}
+
+double BeatTracker::stream_time() const {
+    return static_cast<double>(samples_) / options_.sample_rate;
+}
+
+double BeatTracker::beat_position() const {
+    return grid_.phase_at(stream_time());
+}
+
+} // namespace OneStopRadio
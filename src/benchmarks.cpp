@@ -0,0 +1,433 @@
+// In-process benchmarks for the audio path, encoders, analyzer, database and HTTP server
+//
+// Every input is synthesized from fixed seeds, so two runs on the same
+// machine measure the same work. Record results as JSON with
+//
+//     benchmarks --benchmark_out=benchmarks.json --benchmark_out_format=json
+//
+// (or the benchmark-json target). Use --benchmark_out rather than
+// --benchmark_format: some components log to stdout.
+
+#include <benchmark/benchmark.h>
+
+#include "audio_system.hpp"
+#include "audio_stream_encoder.hpp"
+#include "audio_analyzer.hpp"
+#include "database_manager.hpp"
+#include "deck_equalizer.hpp"
+#include "dsp_kernels.hpp"
+#include "dynamics_processor.hpp"
+#include "http_server.hpp"
+#include "realtime_dj_processor.hpp"
+#include "utils/logger.hpp"
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <sndfile.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kSeed = 20240601;
+constexpr int kSampleRate = 48000;
+
+// Two tones plus noise, so meters, compressors and encoders all do real work
+std::vector<float> synth_audio(size_t frames, int channels, uint32_t seed = kSeed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+    std::vector<float> samples(frames * channels);
+    for (size_t i = 0; i < frames; ++i) {
+        const double t = static_cast<double>(i) / kSampleRate;
+        const float tone = static_cast<float>(0.4 * std::sin(2.0 * M_PI * 110.0 * t) +
+                                              0.2 * std::sin(2.0 * M_PI * 1760.0 * t));
+        for (int c = 0; c < channels; ++c) {
+            samples[i * channels + c] = tone + noise(rng);
+        }
+    }
+    return samples;
+}
+
+std::filesystem::path scratch_path(const std::string& name) {
+    return std::filesystem::temp_directory_path() / ("onestop-bench-" + name);
+}
+
+// ===== DSP =====
+
+void BM_DJProcessorBlock(benchmark::State& state) {
+    const size_t block = static_cast<size_t>(state.range(0));
+    OneStopRadio::RealtimeDJProcessor processor(kSampleRate, block);
+    processor.setClockMode(OneStopRadio::RealtimeDJProcessor::EXTERNAL_CALLBACK);
+    processor.loadTrack("A", "bench-a", "Bench A", "Synth");
+    processor.loadTrack("B", "bench-b", "Bench B", "Synth");
+    processor.playDeck("A");
+    processor.playDeck("B");
+    processor.setCrossfader(0.0f);
+
+    OneStopRadio::AudioBuffer input_a(block, kSampleRate, 2);
+    OneStopRadio::AudioBuffer input_b(block, kSampleRate, 2);
+    const std::vector<float> a = synth_audio(block, 2, kSeed);
+    const std::vector<float> b = synth_audio(block, 2, kSeed + 1);
+    for (size_t i = 0; i < block; ++i) {
+        input_a.samples[i] = OneStopRadio::AudioSample(a[2 * i], a[2 * i + 1]);
+        input_b.samples[i] = OneStopRadio::AudioSample(b[2 * i], b[2 * i + 1]);
+    }
+    processor.processAudioInput(input_a, input_b);
+
+    processor.start();
+    for (auto _ : state) {
+        processor.processBlock();
+    }
+    processor.stop();
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(block));
+    state.counters["budget_us"] = 1e6 * static_cast<double>(block) / kSampleRate;
+}
+BENCHMARK(BM_DJProcessorBlock)->Arg(256)->Arg(512)->Arg(1024);
+
+void BM_DeckEqualizer(benchmark::State& state) {
+    OneStopRadio::DeckEqOptions options;
+    options.mode = state.range(0) ? OneStopRadio::DeckEqMode::ISOLATOR : OneStopRadio::DeckEqMode::SHELVING;
+    OneStopRadio::DeckEqualizer eq(options);
+    OneStopRadio::DeckEqSettings settings;
+    settings.low = 1.5f;
+    settings.high = 0.5f;
+    settings.filter = 0.3f;
+    eq.set(0, settings);
+    eq.set(1, settings);
+
+    constexpr size_t kFrames = 512;
+    std::vector<float> lanes = synth_audio(kFrames, OneStopRadio::DeckEqualizer::kLanes);
+    for (auto _ : state) {
+        eq.process(lanes.data(), kFrames);
+        benchmark::DoNotOptimize(lanes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kFrames));
+    state.SetLabel(state.range(0) ? "isolator" : "shelving");
+}
+BENCHMARK(BM_DeckEqualizer)->Arg(0)->Arg(1);
+
+void BM_MasterDynamics(benchmark::State& state) {
+    OneStopRadio::DynamicsOptions options;
+    options.true_peak = state.range(0) != 0;
+    options.compressor_enabled = true;
+    OneStopRadio::DynamicsProcessor dynamics(options);
+
+    constexpr size_t kFrames = 512;
+    const std::vector<float> source = synth_audio(kFrames, 2);
+    std::vector<float> block(source.size());
+    for (auto _ : state) {
+        std::copy(source.begin(), source.end(), block.begin());
+        dynamics.process(block.data(), kFrames);
+        benchmark::DoNotOptimize(block.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kFrames));
+    state.SetLabel(options.true_peak ? "true-peak" : "sample-peak");
+}
+BENCHMARK(BM_MasterDynamics)->Arg(0)->Arg(1);
+
+// ===== MIXER =====
+
+// A minute of synthetic stereo for the mixer channels
+const std::string& mixer_test_file() {
+    static const std::string path = [] {
+        const std::string file = scratch_path("mixer.wav").string();
+        const size_t frames = static_cast<size_t>(kSampleRate) * 60;
+        const std::vector<float> samples = synth_audio(frames, 2);
+        SF_INFO info = {};
+        info.samplerate = kSampleRate;
+        info.channels = 2;
+        info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+        if (SNDFILE* sf = sf_open(file.c_str(), SFM_WRITE, &info)) {
+            sf_writef_float(sf, samples.data(), static_cast<sf_count_t>(frames));
+            sf_close(sf);
+        }
+        return file;
+    }();
+    return path;
+}
+
+// Channels playing the test file through the full callback: mixing, EQ,
+// master effects, dynamics and metering
+void BM_AudioSystemMix(benchmark::State& state) {
+    AudioSystem audio;
+    AudioFormat format;
+    format.sample_rate = kSampleRate;
+    format.channels = 2;
+    if (!audio.initialize(format)) {
+        state.SkipWithError("AudioSystem::initialize failed");
+        return;
+    }
+
+    std::vector<std::string> channels;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        const std::string id = audio.create_audio_channel();
+        if (id.empty() || !audio.load_audio_file(id, mixer_test_file()) || !audio.play_channel(id)) {
+            state.SkipWithError("could not load the mixer test file");
+            return;
+        }
+        channels.push_back(id);
+    }
+    audio.set_channel_eq(channels.front(), 3.0f, 0.0f, -3.0f);
+
+    constexpr int kFrames = 512;
+    std::vector<float> output(kFrames * format.channels);
+    // Let the decoders fill before measuring
+    for (int i = 0; i < 200; ++i) {
+        audio.render_offline(nullptr, output.data(), kFrames);
+    }
+
+    const double rewind_at = audio.get_channel_duration(channels.front()) - 1.0;
+    for (auto _ : state) {
+        audio.render_offline(nullptr, output.data(), kFrames);
+        benchmark::DoNotOptimize(output.data());
+        if (audio.get_channel_position(channels.front()) > rewind_at) {
+            state.PauseTiming();
+            for (const auto& id : channels) {
+                audio.set_channel_position(id, 0.0);
+            }
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kFrames);
+    state.counters["budget_us"] = 1e6 * kFrames / kSampleRate;
+}
+BENCHMARK(BM_AudioSystemMix)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// Control-side meter reads, as the level WebSocket does them
+void BM_AudioSystemReadLevels(benchmark::State& state) {
+    AudioSystem audio;
+    if (!audio.initialize()) {
+        state.SkipWithError("AudioSystem::initialize failed");
+        return;
+    }
+    const std::string channel = audio.create_audio_channel();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(audio.get_master_levels());
+        benchmark::DoNotOptimize(audio.get_channel_levels(channel));
+    }
+}
+BENCHMARK(BM_AudioSystemReadLevels);
+
+// ===== ENCODERS =====
+
+class CountingSink : public EncodedPacketSink {
+public:
+    void on_encoded_packet(const EncodedPacketPtr& packet) override { bytes += packet->data.size(); }
+    size_t bytes = 0;
+};
+
+void BM_Encode(benchmark::State& state) {
+    EncoderProfile profile;
+    profile.codec = static_cast<StreamCodec>(state.range(0));
+    profile.bitrate = 128;
+    profile.sample_rate = profile.codec == StreamCodec::OGG_OPUS ? 48000 : 44100;
+    profile.channels = 2;
+
+    SharedStreamEncoder encoder(profile);
+    if (!encoder.open()) {
+        state.SkipWithError(("open failed: " + encoder.get_error()).c_str());
+        return;
+    }
+    CountingSink sink;
+    encoder.add_sink(&sink);
+
+    constexpr size_t kFrames = 4096;
+    const std::vector<float> block = synth_audio(kFrames, profile.channels);
+    for (auto _ : state) {
+        if (!encoder.encode(block.data(), kFrames)) {
+            state.SkipWithError(("encode failed: " + encoder.get_error()).c_str());
+            break;
+        }
+    }
+    encoder.remove_sink(&sink);
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kFrames));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(block.size() * sizeof(float)));
+    state.counters["realtime_x"] = benchmark::Counter(static_cast<double>(kFrames) / profile.sample_rate,
+                                                      benchmark::Counter::kIsIterationInvariantRate);
+    state.SetLabel(AudioStreamEncoder::codec_to_string(profile.codec));
+}
+BENCHMARK(BM_Encode)
+    ->Arg(static_cast<int>(StreamCodec::MP3))
+    ->Arg(static_cast<int>(StreamCodec::OGG_VORBIS))
+    ->Arg(static_cast<int>(StreamCodec::OGG_OPUS))
+    ->Arg(static_cast<int>(StreamCodec::AAC));
+
+// ===== ANALYZER =====
+
+// Thirty seconds of mono with the window pinned to the FFT size under test
+void BM_AnalyzeSamples(benchmark::State& state) {
+    const uint32_t fft_size = static_cast<uint32_t>(state.range(0));
+    OneStopRadio::AnalysisConfig config;
+    config.min_window_size = fft_size;
+    config.max_window_size = fft_size;
+    OneStopRadio::AudioAnalyzer analyzer(config);
+
+    const std::vector<float> samples = synth_audio(static_cast<size_t>(kSampleRate) * 30, 1);
+    for (auto _ : state) {
+        auto waveform = analyzer.analyze_samples(samples.data(), static_cast<uint32_t>(samples.size()), kSampleRate);
+        benchmark::DoNotOptimize(waveform.get());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(samples.size()));
+}
+BENCHMARK(BM_AnalyzeSamples)->RangeMultiplier(4)->Range(512, 8192)->Unit(benchmark::kMillisecond);
+
+// ===== DATABASE =====
+
+constexpr int kLibrarySize = 100000;
+
+// A synthetic library, built once per process
+DatabaseManager& library() {
+    static DatabaseManager* database = [] {
+        const std::string path = scratch_path("library.db").string();
+        for (const char* suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(path + suffix);
+        }
+        auto* db = new DatabaseManager();
+        db->initialize(path);
+
+        static const char* const kWords[] = {
+            "love", "night", "dance", "summer", "city", "heart", "fire", "dream", "river", "golden",
+            "electric", "midnight", "shadow", "ocean", "crystal", "wild", "neon", "silver", "echo", "sky"};
+        static const char* const kGenres[] = {"house", "techno", "pop", "hip hop", "jazz", "reggae", "rock", "ambient"};
+        constexpr size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+        constexpr size_t kGenreCount = sizeof(kGenres) / sizeof(kGenres[0]);
+
+        std::mt19937 rng(kSeed);
+        std::vector<RadioTrack> tracks;
+        tracks.reserve(kLibrarySize);
+        for (int i = 0; i < kLibrarySize; ++i) {
+            RadioTrack track;
+            track.id = "track-" + std::to_string(i);
+            track.title = std::string(kWords[rng() % kWordCount]) + " " + kWords[rng() % kWordCount];
+            track.artist = "artist " + std::to_string(rng() % 5000);
+            track.album = std::string(kWords[rng() % kWordCount]) + " sessions";
+            track.genre = kGenres[rng() % kGenreCount];
+            track.file_path = "/music/" + track.id + ".mp3";
+            track.duration_ms = 120000 + static_cast<int>(rng() % 240000);
+            track.bpm = 80 + static_cast<int>(rng() % 80);
+            tracks.push_back(std::move(track));
+        }
+        db->insert_tracks(tracks);
+        return db;
+    }();
+    return *database;
+}
+
+const char* const kSearchQueries[] = {"love", "midnight dance", "artist 42", "techno", "zzz"};
+
+void BM_SearchTracks(benchmark::State& state) {
+    DatabaseManager& db = library();
+    const std::string query = kSearchQueries[state.range(0)];
+    size_t results = 0;
+    for (auto _ : state) {
+        results = db.search_tracks(query, 50).size();
+    }
+    state.counters["results"] = static_cast<double>(results);
+    state.SetLabel(query);
+}
+BENCHMARK(BM_SearchTracks)->DenseRange(0, static_cast<int>(sizeof(kSearchQueries) / sizeof(kSearchQueries[0])) - 1);
+
+// ===== HTTP =====
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using tcp = net::ip::tcp;
+
+int http_port() {
+    const char* port = std::getenv("ONESTOP_BENCH_HTTP_PORT");
+    return port ? std::atoi(port) : 18089;
+}
+
+// One server for the process, on its own thread
+void ensure_http_server() {
+    static HttpServer* server = [] {
+        HttpServerOptions options;
+        options.io_threads = 2;
+        options.max_requests_per_connection = 1u << 30;
+        auto* instance = new HttpServer(http_port(), options);
+        instance->add_route("GET", "/api/ping", [](const HttpRequest&) {
+            return std::string(R"({"status":"ok"})");
+        });
+        instance->add_route("GET", "/api/tracks/{id}", [](const HttpRequest& request) {
+            return R"({"id":")" + request.path_params.at("id") + R"(","title":"Bench"})";
+        });
+        std::thread([instance] { instance->run(); }).detach();
+        return instance;
+    }();
+    (void)server;
+}
+
+tcp::socket connect_client(net::io_context& ioc) {
+    tcp::resolver resolver(ioc);
+    const auto endpoints = resolver.resolve("127.0.0.1", std::to_string(http_port()));
+    tcp::socket socket(ioc);
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        boost::system::error_code ec;
+        net::connect(socket, endpoints, ec);
+        if (!ec) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return socket;
+}
+
+// Keep-alive requests on one connection, range(0) pipelined per round trip
+void BM_HttpRequests(benchmark::State& state) {
+    ensure_http_server();
+    net::io_context ioc;
+    tcp::socket socket = connect_client(ioc);
+    if (!socket.is_open()) {
+        state.SkipWithError("could not connect to the benchmark HTTP server");
+        return;
+    }
+
+    const int depth = static_cast<int>(state.range(0));
+    http::request<http::empty_body> request{http::verb::get, "/api/tracks/42", 11};
+    request.set(http::field::host, "127.0.0.1");
+    request.keep_alive(true);
+    boost::beast::flat_buffer buffer;
+
+    for (auto _ : state) {
+        for (int i = 0; i < depth; ++i) {
+            http::write(socket, request);
+        }
+        for (int i = 0; i < depth; ++i) {
+            http::response<http::string_body> response;
+            http::read(socket, buffer, response);
+            benchmark::DoNotOptimize(response.body().data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * depth);
+
+    boost::system::error_code ec;
+    socket.shutdown(tcp::socket::shutdown_both, ec);
+}
+BENCHMARK(BM_HttpRequests)->Arg(1)->Arg(16)->UseRealTime();
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Logger::set_level(Logger::Level::WARN);
+
+    benchmark::AddCustomContext("dsp_kernels", dsp::kernels().name);
+    benchmark::AddCustomContext("seed", std::to_string(kSeed));
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -1,8 +1,279 @@
 #include "database_manager.hpp"
 #include "utils/logger.hpp"
+#include "utils/json_writer.hpp"
 #include <filesystem>
 #include <sstream>
 #include <iomanip>
+#include <cmath>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+
+namespace {
+
+// Shared by the writer and every pooled reader. The inner query keeps the
+// best-ranked window of matches; rank MATCH swaps in the column weights
+const char* const kSearchTracksSql = R"(
+    SELECT t.* FROM (
+        SELECT rowid, rank AS score FROM tracks_fts
+        WHERE tracks_fts MATCH ? AND rank MATCH 'bm25(10.0, 8.0, 3.0, 1.0)'
+        ORDER BY rank LIMIT ?
+    ) AS m
+    JOIN tracks t ON t.rowid = m.rowid
+    ORDER BY m.score, t.title, t.artist
+    LIMIT ? OFFSET ?
+)";
+const char* const kListTracksSql = "SELECT * FROM tracks ORDER BY title, artist LIMIT ? OFFSET ?";
+
+// Paged listing sorts on these only; each has an index, and ties break on rowid
+const char* const kPageSortColumns[] = {"title", "artist", "genre", "bpm", "added_at", "last_played"};
+
+enum class FieldType {
+    TEXT,
+    INTEGER,
+    REAL,
+    BOOLEAN
+};
+
+struct TrackField {
+    const char* name;       // As in RadioTrack::to_json
+    const char* column;
+    FieldType type;
+};
+
+const TrackField kTrackFields[] = {
+    {"id", "id", FieldType::TEXT},
+    {"title", "title", FieldType::TEXT},
+    {"artist", "artist", FieldType::TEXT},
+    {"album", "album", FieldType::TEXT},
+    {"genre", "genre", FieldType::TEXT},
+    {"file_path", "file_path", FieldType::TEXT},
+    {"duration_ms", "duration_ms", FieldType::INTEGER},
+    {"bpm", "bpm", FieldType::INTEGER},
+    {"key", "musical_key", FieldType::TEXT},
+    {"gain", "gain", FieldType::REAL},
+    {"is_analyzed", "is_analyzed", FieldType::BOOLEAN},
+    {"play_count", "play_count", FieldType::INTEGER}
+};
+
+/**
+ * Keyset position: the rowid and sort value of the last row of a page,
+ * as "<rowid>:n", "<rowid>:i<integer>" or "<rowid>:s<text>"
+ */
+struct PageCursor {
+    int64_t rowid = 0;
+    int type = SQLITE_NULL;
+    int64_t integer = 0;
+    std::string text;
+};
+
+bool parse_page_cursor(const std::string& cursor, PageCursor& parsed) {
+    const size_t colon = cursor.find(':');
+    if (colon == std::string::npos || colon + 1 >= cursor.size()) {
+        return false;
+    }
+    try {
+        size_t used = 0;
+        parsed.rowid = std::stoll(cursor.substr(0, colon), &used);
+        if (used != colon) {
+            return false;
+        }
+        
+        const std::string value = cursor.substr(colon + 2);
+        switch (cursor[colon + 1]) {
+            case 'n':
+                parsed.type = SQLITE_NULL;
+                return value.empty();
+            case 'i':
+                parsed.type = SQLITE_INTEGER;
+                parsed.integer = std::stoll(value, &used);
+                return used == value.size();
+            case 's':
+                parsed.type = SQLITE_TEXT;
+                parsed.text = value;
+                return true;
+            default:
+                return false;
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+std::string make_page_cursor(sqlite3_stmt* stmt, int rowid_column, int sort_column) {
+    std::string cursor = std::to_string(sqlite3_column_int64(stmt, rowid_column)) + ":";
+    switch (sqlite3_column_type(stmt, sort_column)) {
+        case SQLITE_NULL:
+            return cursor + "n";
+        case SQLITE_INTEGER:
+            return cursor + "i" + std::to_string(sqlite3_column_int64(stmt, sort_column));
+        default: {
+            const unsigned char* text = sqlite3_column_text(stmt, sort_column);
+            return cursor + "s" + (text ? reinterpret_cast<const char*>(text) : "");
+        }
+    }
+}
+
+} // namespace
+
+// Database schema SQL constants
+const char* DatabaseManager::CREATE_TRACKS_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS tracks (
+        id TEXT PRIMARY KEY,
+        title TEXT NOT NULL,
+        artist TEXT NOT NULL,
+        album TEXT,
+        genre TEXT,
+        file_path TEXT NOT NULL UNIQUE,
+        duration_ms INTEGER DEFAULT 0,
+        bpm INTEGER DEFAULT 0,
+        musical_key TEXT,
+        gain REAL DEFAULT 1.0,
+        is_analyzed INTEGER DEFAULT 0,
+        play_count INTEGER DEFAULT 0,
+        added_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+        last_played TIMESTAMP,
+        file_size INTEGER,
+        file_hash TEXT,
+        metadata_json TEXT
+    )
+)";
+
+const char* DatabaseManager::CREATE_PLAYLISTS_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS playlists (
+        id TEXT PRIMARY KEY,
+        name TEXT NOT NULL,
+        description TEXT,
+        is_active INTEGER DEFAULT 0,
+        created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+        updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+        track_count INTEGER DEFAULT 0,
+        total_duration_ms INTEGER DEFAULT 0
+    )
+)";
+
+const char* DatabaseManager::CREATE_PLAYLIST_TRACKS_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS playlist_tracks (
+        playlist_id TEXT NOT NULL,
+        track_id TEXT NOT NULL,
+        position INTEGER NOT NULL,
+        added_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+        PRIMARY KEY (playlist_id, track_id),
+        FOREIGN KEY (playlist_id) REFERENCES playlists(id) ON DELETE CASCADE,
+        FOREIGN KEY (track_id) REFERENCES tracks(id) ON DELETE CASCADE
+    )
+)";
+
+const char* DatabaseManager::CREATE_CUE_POINTS_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS cue_points (
+        id TEXT PRIMARY KEY,
+        track_id TEXT NOT NULL,
+        position_ms REAL NOT NULL,
+        label TEXT,
+        is_loop_start INTEGER DEFAULT 0,
+        is_loop_end INTEGER DEFAULT 0,
+        created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+        FOREIGN KEY (track_id) REFERENCES tracks(id) ON DELETE CASCADE
+    )
+)";
+
+const char* DatabaseManager::CREATE_HOT_CUES_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS hot_cues (
+        track_id TEXT NOT NULL,
+        hot_cue_index INTEGER NOT NULL,
+        position_ms REAL NOT NULL,
+        label TEXT,
+        created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+        PRIMARY KEY (track_id, hot_cue_index),
+        FOREIGN KEY (track_id) REFERENCES tracks(id) ON DELETE CASCADE,
+        CHECK (hot_cue_index >= 0 AND hot_cue_index <= 7)
+    )
+)";
+
+const char* DatabaseManager::CREATE_BROADCAST_SESSIONS_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS broadcast_sessions (
+        id TEXT PRIMARY KEY,
+        start_time TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+        end_time TIMESTAMP,
+        duration_minutes INTEGER,
+        peak_listeners INTEGER DEFAULT 0,
+        metadata_json TEXT
+    )
+)";
+
+const char* DatabaseManager::CREATE_BROADCAST_TRACKS_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS broadcast_tracks (
+        session_id TEXT NOT NULL,
+        track_id TEXT NOT NULL,
+        played_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+        FOREIGN KEY (session_id) REFERENCES broadcast_sessions(id) ON DELETE CASCADE,
+        FOREIGN KEY (track_id) REFERENCES tracks(id) ON DELETE CASCADE
+    )
+)";
+
+const char* DatabaseManager::CREATE_STATION_CONFIG_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS station_config (
+        key TEXT PRIMARY KEY,
+        value TEXT NOT NULL,
+        updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+    )
+)";
+
+const char* DatabaseManager::CREATE_SETTINGS_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS settings (
+        key TEXT PRIMARY KEY,
+        value TEXT NOT NULL,
+        category TEXT,
+        updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+    )
+)";
+
+const char* DatabaseManager::CREATE_ANALYSIS_JOBS_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS analysis_jobs (
+        track_id TEXT PRIMARY KEY,
+        status TEXT NOT NULL,
+        progress REAL DEFAULT 0,
+        error TEXT,
+        peak REAL,
+        dynamic_range REAL,
+        waveform_path TEXT,
+        bpm REAL,
+        beat_time REAL,
+        energy REAL,
+        updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+        FOREIGN KEY (track_id) REFERENCES tracks(id) ON DELETE CASCADE
+    )
+)";
+
+// External-content FTS5 index over tracks, keyed by the tracks rowid. The
+// 1- to 3-character prefix indexes keep short search-as-you-type prefixes
+// from merging every term that starts with them.
+const char* DatabaseManager::CREATE_TRACKS_FTS_TABLE = R"(
+    CREATE VIRTUAL TABLE IF NOT EXISTS tracks_fts USING fts5(
+        title, artist, album, genre,
+        content = 'tracks',
+        content_rowid = 'rowid',
+        tokenize = 'unicode61 remove_diacritics 2',
+        prefix = '1 2 3'
+    )
+)";
+
+const char* DatabaseManager::CREATE_TRACKS_FTS_TRIGGERS = R"(
+    CREATE TRIGGER IF NOT EXISTS tracks_fts_insert AFTER INSERT ON tracks BEGIN
+        INSERT INTO tracks_fts (rowid, title, artist, album, genre)
+        VALUES (new.rowid, new.title, new.artist, new.album, new.genre);
+    END;
+    CREATE TRIGGER IF NOT EXISTS tracks_fts_delete AFTER DELETE ON tracks BEGIN
+        INSERT INTO tracks_fts (tracks_fts, rowid, title, artist, album, genre)
+        VALUES ('delete', old.rowid, old.title, old.artist, old.album, old.genre);
+    END;
+    CREATE TRIGGER IF NOT EXISTS tracks_fts_update AFTER UPDATE OF title, artist, album, genre ON tracks BEGIN
+        INSERT INTO tracks_fts (tracks_fts, rowid, title, artist, album, genre)
+        VALUES ('delete', old.rowid, old.title, old.artist, old.album, old.genre);
+        INSERT INTO tracks_fts (rowid, title, artist, album, genre)
+        VALUES (new.rowid, new.title, new.artist, new.album, new.genre);
+    END;
+)";
 
 DatabaseManager::DatabaseManager() 
     : db_(nullptr)
@@ -20,8 +291,9 @@ bool DatabaseManager::initialize(const std::string& db_path) {
     
     Logger::info("DatabaseManager: Opening database " + db_path_);
     
-    // Open SQLite database
-    int rc = sqlite3_open(db_path_.c_str(), &db_);
+    // Open SQLite database; write_mutex_ serializes every use of the writer
+    int rc = sqlite3_open_v2(db_path_.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX,
+                             nullptr);
     if (rc != SQLITE_OK) {
         Logger::error("DatabaseManager: Failed to open database: " + std::string(sqlite3_errmsg(db_)));
         sqlite3_close(db_);
@@ -39,6 +311,10 @@ bool DatabaseManager::initialize(const std::string& db_path) {
         sqlite3_free(error_msg);
     }
     
+    if (!apply_pragmas(db_, true)) {
+        Logger::warn("DatabaseManager: Storage tuning failed; using SQLite defaults");
+    }
+    
     // Create tables
     if (!create_tables()) {
         Logger::error("DatabaseManager: Failed to create tables");
@@ -53,12 +329,145 @@ bool DatabaseManager::initialize(const std::string& db_path) {
         return false;
     }
     
-    Logger::info("DatabaseManager: Database initialized successfully");
+    if (!open_read_pool()) {
+        Logger::warn("DatabaseManager: Read pool unavailable; reads share the writer connection");
+        close_read_pool();
+    }
+    
+    if (storage_options_.write_batch_ms > 0) {
+        batch_running_ = true;
+        batch_thread_ = std::thread(&DatabaseManager::batch_loop, this);
+    }
+    
+    Logger::info("DatabaseManager: Database initialized successfully (" +
+                 std::string(storage_options_.wal ? "WAL" : "rollback journal") + ", " +
+                 std::to_string(read_connections_.size()) + " read connections)");
     return true;
 }
 
+bool DatabaseManager::apply_pragmas(sqlite3* db, bool writer) {
+    bool ok = true;
+    auto exec = [&](const std::string& sql) {
+        char* error_msg = nullptr;
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error_msg) != SQLITE_OK) {
+            Logger::warn("DatabaseManager: " + sql + " failed: " + std::string(error_msg ? error_msg : ""));
+            sqlite3_free(error_msg);
+            ok = false;
+        }
+    };
+    
+    sqlite3_busy_timeout(db, storage_options_.busy_timeout_ms);
+    exec("PRAGMA cache_size = " + std::to_string(-std::max(storage_options_.cache_size_kb, 0)) + ";");
+    exec("PRAGMA mmap_size = " + std::to_string(std::max<int64_t>(storage_options_.mmap_size, 0)) + ";");
+    
+    if (writer && storage_options_.wal) {
+        // In-memory and some network file systems refuse WAL; readers then share the writer
+        std::string mode;
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, "PRAGMA journal_mode = WAL;", -1, &stmt, nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0)) {
+            mode = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+        
+        if (mode != "wal") {
+            Logger::warn("DatabaseManager: WAL unavailable (journal mode " + mode + ")");
+            storage_options_.wal = false;
+            return ok;
+        }
+        // Durable at every checkpoint; a power cut can lose only the last commits
+        exec("PRAGMA synchronous = NORMAL;");
+    }
+    return ok;
+}
+
+bool DatabaseManager::open_read_pool() {
+    if (!storage_options_.wal || storage_options_.read_connections <= 0) {
+        return true;
+    }
+    
+    for (int i = 0; i < storage_options_.read_connections; ++i) {
+        auto reader = std::make_unique<ReadConnection>();
+        if (sqlite3_open_v2(db_path_.c_str(), &reader->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX,
+                            nullptr) != SQLITE_OK) {
+            Logger::error("DatabaseManager: Failed to open read connection: " +
+                          std::string(sqlite3_errmsg(reader->db)));
+            sqlite3_close(reader->db);
+            return false;
+        }
+        read_connections_.push_back(std::move(reader));
+        
+        ReadConnection& connection = *read_connections_.back();
+        idle_readers_.push_back(&connection);
+        apply_pragmas(connection.db, false);
+        if (sqlite3_prepare_v2(connection.db, kSearchTracksSql, -1, &connection.search_tracks, nullptr) != SQLITE_OK ||
+            sqlite3_prepare_v2(connection.db, kListTracksSql, -1, &connection.list_tracks, nullptr) != SQLITE_OK) {
+            Logger::error("DatabaseManager: Failed to prepare read statements: " +
+                          std::string(sqlite3_errmsg(connection.db)));
+            return false;
+        }
+    }
+    return true;
+}
+
+void DatabaseManager::close_read_pool() {
+    std::unique_lock<std::mutex> lock(read_mutex_);
+    
+    // Wait out readers still running on the HTTP threads
+    reader_available_.wait(lock, [this] { return idle_readers_.size() == read_connections_.size(); });
+    for (const auto& reader : read_connections_) {
+        sqlite3_finalize(reader->search_tracks);
+        sqlite3_finalize(reader->list_tracks);
+        sqlite3_close(reader->db);
+    }
+    read_connections_.clear();
+    idle_readers_.clear();
+}
+
+template <typename Read>
+auto DatabaseManager::with_reader(Read&& read) {
+    std::unique_lock<std::mutex> pool_lock(read_mutex_);
+    if (read_connections_.empty()) {
+        pool_lock.unlock();
+        auto lock = lock_writer();
+        ReadConnection writer{db_, prepared_statements_.search_tracks, prepared_statements_.list_tracks};
+        return read(writer);
+    }
+    
+    reader_available_.wait(pool_lock, [this] { return !idle_readers_.empty(); });
+    ReadConnection* reader = idle_readers_.back();
+    idle_readers_.pop_back();
+    pool_lock.unlock();
+    
+    struct Release {
+        DatabaseManager* self;
+        ReadConnection* reader;
+        ~Release() {
+            {
+                std::lock_guard<std::mutex> lock(self->read_mutex_);
+                self->idle_readers_.push_back(reader);
+            }
+            self->reader_available_.notify_all();
+        }
+    } release{this, reader};
+    return read(*reader);
+}
+
 void DatabaseManager::close() {
     if (is_connected_) {
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            batch_running_ = false;
+        }
+        pending_cv_.notify_all();
+        if (batch_thread_.joinable()) {
+            batch_thread_.join();
+        }
+        
+        close_read_pool();
+        
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        flush_pending_writes();
         finalize_statements();
         
         if (db_) {
@@ -87,7 +496,8 @@ bool DatabaseManager::create_tables() {
         CREATE_BROADCAST_SESSIONS_TABLE,
         CREATE_BROADCAST_TRACKS_TABLE,
         CREATE_STATION_CONFIG_TABLE,
-        CREATE_SETTINGS_TABLE
+        CREATE_SETTINGS_TABLE,
+        CREATE_ANALYSIS_JOBS_TABLE
     };
     
     for (const char* sql : tables) {
@@ -102,6 +512,7 @@ bool DatabaseManager::create_tables() {
     
     // Create indices for performance
     const char* indices[] = {
+        "CREATE INDEX IF NOT EXISTS idx_tracks_title ON tracks(title);",
         "CREATE INDEX IF NOT EXISTS idx_tracks_artist ON tracks(artist);",
         "CREATE INDEX IF NOT EXISTS idx_tracks_genre ON tracks(genre);",
         "CREATE INDEX IF NOT EXISTS idx_tracks_bpm ON tracks(bpm);",
@@ -110,7 +521,8 @@ bool DatabaseManager::create_tables() {
         "CREATE INDEX IF NOT EXISTS idx_playlist_tracks_position ON playlist_tracks(playlist_id, position);",
         "CREATE INDEX IF NOT EXISTS idx_cue_points_track ON cue_points(track_id);",
         "CREATE INDEX IF NOT EXISTS idx_hot_cues_track ON hot_cues(track_id);",
-        "CREATE INDEX IF NOT EXISTS idx_broadcast_tracks_session ON broadcast_tracks(session_id);"
+        "CREATE INDEX IF NOT EXISTS idx_broadcast_tracks_session ON broadcast_tracks(session_id);",
+        "CREATE INDEX IF NOT EXISTS idx_analysis_jobs_status ON analysis_jobs(status);"
     };
     
     for (const char* sql : indices) {
@@ -122,10 +534,69 @@ bool DatabaseManager::create_tables() {
         }
     }
     
+    if (!create_search_index()) {
+        return false;
+    }
+    
     Logger::info("DatabaseManager: Tables created successfully");
     return true;
 }
 
+bool DatabaseManager::create_search_index() {
+    // A database from before the index existed has tracks the triggers never saw
+    bool exists = false;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'tracks_fts'",
+                           -1, &stmt, nullptr) == SQLITE_OK) {
+        exists = sqlite3_step(stmt) == SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+    
+    const char* statements[] = {
+        CREATE_TRACKS_FTS_TABLE,
+        CREATE_TRACKS_FTS_TRIGGERS,
+        exists ? nullptr : "INSERT INTO tracks_fts (tracks_fts) VALUES ('rebuild');"
+    };
+    
+    for (const char* sql : statements) {
+        if (!sql) continue;
+        char* error_msg = nullptr;
+        int rc = sqlite3_exec(db_, sql, nullptr, nullptr, &error_msg);
+        if (rc != SQLITE_OK) {
+            Logger::error("DatabaseManager: Failed to create search index: " + std::string(error_msg ? error_msg : ""));
+            sqlite3_free(error_msg);
+            return false;
+        }
+    }
+    
+    if (!exists) {
+        Logger::info("DatabaseManager: Built full-text search index");
+    }
+    return true;
+}
+
+bool DatabaseManager::vacuum_database() {
+    auto lock = lock_writer();
+    
+    // VACUUM may renumber the tracks rowids the search index is keyed by
+    const char* statements[] = {
+        "VACUUM;",
+        "INSERT INTO tracks_fts (tracks_fts) VALUES ('rebuild');",
+        "INSERT INTO tracks_fts (tracks_fts) VALUES ('optimize');"
+    };
+    
+    for (const char* sql : statements) {
+        char* error_msg = nullptr;
+        int rc = sqlite3_exec(db_, sql, nullptr, nullptr, &error_msg);
+        if (rc != SQLITE_OK) {
+            Logger::error("DatabaseManager: Failed to vacuum database: " + std::string(error_msg ? error_msg : ""));
+            sqlite3_free(error_msg);
+            return false;
+        }
+    }
+    return true;
+}
+
 bool DatabaseManager::prepare_statements() {
     Logger::info("DatabaseManager: Preparing SQL statements");
     
@@ -144,10 +615,6 @@ bool DatabaseManager::prepare_statements() {
     )";
     
     const char* get_track_sql = "SELECT * FROM tracks WHERE id = ?";
-    const char* search_tracks_sql = R"(
-        SELECT * FROM tracks WHERE title LIKE ? OR artist LIKE ? OR album LIKE ? OR genre LIKE ?
-        ORDER BY title, artist
-    )";
     
     // Playlist operations
     const char* insert_playlist_sql = R"(
@@ -224,7 +691,8 @@ bool DatabaseManager::prepare_statements() {
         {&prepared_statements_.insert_track, insert_track_sql},
         {&prepared_statements_.update_track, update_track_sql},
         {&prepared_statements_.get_track, get_track_sql},
-        {&prepared_statements_.search_tracks, search_tracks_sql},
+        {&prepared_statements_.search_tracks, kSearchTracksSql},
+        {&prepared_statements_.list_tracks, kListTracksSql},
         {&prepared_statements_.insert_playlist, insert_playlist_sql},
         {&prepared_statements_.update_playlist, update_playlist_sql},
         {&prepared_statements_.get_playlist, get_playlist_sql},
@@ -261,6 +729,7 @@ void DatabaseManager::finalize_statements() {
         prepared_statements_.delete_track,
         prepared_statements_.get_track,
         prepared_statements_.search_tracks,
+        prepared_statements_.list_tracks,
         prepared_statements_.insert_playlist,
         prepared_statements_.update_playlist,
         prepared_statements_.delete_playlist,
@@ -294,6 +763,31 @@ void DatabaseManager::finalize_statements() {
 // ===== TRACK OPERATIONS =====
 
 bool DatabaseManager::insert_track(const RadioTrack& track) {
+    if (!is_connected_) return false;
+    
+    auto lock = lock_writer();
+    return insert_track_row(track);
+}
+
+bool DatabaseManager::insert_tracks(const std::vector<RadioTrack>& tracks) {
+    if (!is_connected_) return false;
+    if (tracks.empty()) return true;
+    
+    // One commit, and one WAL sync, for the whole import
+    auto lock = lock_writer();
+    if (!begin_transaction()) {
+        return false;
+    }
+    for (const auto& track : tracks) {
+        if (!insert_track_row(track)) {
+            rollback_transaction();
+            return false;
+        }
+    }
+    return commit_transaction();
+}
+
+bool DatabaseManager::insert_track_row(const RadioTrack& track) {
     if (!prepared_statements_.insert_track) return false;
     
     sqlite3_stmt* stmt = prepared_statements_.insert_track;
@@ -332,41 +826,15 @@ bool DatabaseManager::insert_track(const RadioTrack& track) {
 }
 
 bool DatabaseManager::update_track(const RadioTrack& track) {
-    if (!prepared_statements_.update_track) return false;
-    
-    sqlite3_stmt* stmt = prepared_statements_.update_track;
-    sqlite3_reset(stmt);
-    
-    // Bind parameters
-    sqlite3_bind_text(stmt, 1, track.title.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, track.artist.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, track.album.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 4, track.genre.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 5, track.duration_ms);
-    sqlite3_bind_int(stmt, 6, track.bpm);
-    sqlite3_bind_text(stmt, 7, track.key.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_double(stmt, 8, track.gain);
-    sqlite3_bind_int(stmt, 9, track.is_analyzed ? 1 : 0);
-    sqlite3_bind_int(stmt, 10, track.play_count);
-    
-    // last_played
-    if (track.last_played != std::chrono::system_clock::time_point{}) {
-        auto time_t = std::chrono::system_clock::to_time_t(track.last_played);
-        std::stringstream ss;
-        ss << std::put_time(std::gmtime(&time_t), "%Y-%m-%d %H:%M:%S");
-        sqlite3_bind_text(stmt, 11, ss.str().c_str(), -1, SQLITE_TRANSIENT);
-    } else {
-        sqlite3_bind_null(stmt, 11);
-    }
-    
-    sqlite3_bind_text(stmt, 12, "{}", -1, SQLITE_STATIC); // metadata_json
-    sqlite3_bind_text(stmt, 13, track.id.c_str(), -1, SQLITE_STATIC);
-    
-    int rc = sqlite3_step(stmt);
-    return (rc == SQLITE_DONE);
+    PendingWrite write;
+    write.type = PendingWrite::Type::TRACK;
+    write.track = track;
+    return queue_write(std::move(write));
 }
 
 bool DatabaseManager::delete_track(const std::string& track_id) {
+    auto lock = lock_writer();
+    
     const char* sql = "DELETE FROM tracks WHERE id = ?";
     sqlite3_stmt* stmt = nullptr;
     
@@ -382,6 +850,7 @@ bool DatabaseManager::delete_track(const std::string& track_id) {
 }
 
 RadioTrack* DatabaseManager::get_track(const std::string& track_id) {
+    auto lock = lock_writer();
     if (!prepared_statements_.get_track) return nullptr;
     
     sqlite3_stmt* stmt = prepared_statements_.get_track;
@@ -400,67 +869,259 @@ RadioTrack* DatabaseManager::get_track(const std::string& track_id) {
 }
 
 std::vector<RadioTrack> DatabaseManager::get_all_tracks() {
-    std::vector<RadioTrack> tracks;
-    
-    const char* sql = "SELECT * FROM tracks ORDER BY title, artist";
-    sqlite3_stmt* stmt = nullptr;
+    if (!is_connected_) return {};
     
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) return tracks;
-    
-    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        tracks.push_back(track_from_statement(stmt));
+    return with_reader([this](ReadConnection& reader) {
+        std::vector<RadioTrack> tracks;
+        
+        const char* sql = "SELECT * FROM tracks ORDER BY title, artist";
+        sqlite3_stmt* stmt = nullptr;
+        
+        int rc = sqlite3_prepare_v2(reader.db, sql, -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) return tracks;
+        
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            tracks.push_back(track_from_statement(stmt));
+        }
+        
+        sqlite3_finalize(stmt);
+        return tracks;
+    });
+}
+
+std::vector<RadioTrack> DatabaseManager::search_tracks(const std::string& query, int limit, int offset) {
+    if (!is_connected_) return {};
+    
+    const std::string match = fts_match_expression(query);
+    limit = std::clamp(limit, 1, MAX_SEARCH_RESULTS);
+    offset = std::max(offset, 0);
+    if (!match.empty()) {
+        // Pages end at the rank window
+        if (offset >= SEARCH_RANK_WINDOW) return {};
+        limit = std::min(limit, SEARCH_RANK_WINDOW - offset);
     }
     
-    sqlite3_finalize(stmt);
-    return tracks;
+    return with_reader([&](ReadConnection& reader) {
+        std::vector<RadioTrack> tracks;
+        
+        sqlite3_stmt* stmt = match.empty() ? reader.list_tracks : reader.search_tracks;
+        if (!stmt) return tracks;
+        
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        
+        int index = 1;
+        if (!match.empty()) {
+            sqlite3_bind_text(stmt, index++, match.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int(stmt, index++, SEARCH_RANK_WINDOW);
+        }
+        sqlite3_bind_int(stmt, index++, limit);
+        sqlite3_bind_int(stmt, index++, offset);
+        
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            tracks.push_back(track_from_statement(stmt));
+        }
+        if (rc != SQLITE_DONE) {
+            Logger::error("DatabaseManager: search tracks failed: " + std::string(sqlite3_errmsg(reader.db)));
+        }
+        
+        // Release the read snapshot so the WAL can be checkpointed
+        sqlite3_reset(stmt);
+        return tracks;
+    });
 }
 
-std::vector<RadioTrack> DatabaseManager::search_tracks(const std::string& query) {
-    std::vector<RadioTrack> tracks;
+bool DatabaseManager::write_track_page(const TrackPageRequest& request, JsonWriter& out, std::string& error) {
+    if (!is_connected_) {
+        error = "Database not connected";
+        return false;
+    }
     
-    if (!prepared_statements_.search_tracks) return tracks;
+    const char* sort = nullptr;
+    for (const char* column : kPageSortColumns) {
+        if (request.sort == column) sort = column;
+    }
+    if (!sort) {
+        error = "Unknown sort key: " + request.sort;
+        return false;
+    }
     
-    sqlite3_stmt* stmt = prepared_statements_.search_tracks;
-    sqlite3_reset(stmt);
+    std::vector<const TrackField*> fields;
+    if (request.fields.empty()) {
+        for (const TrackField& field : kTrackFields) fields.push_back(&field);
+    } else {
+        for (const std::string& name : request.fields) {
+            auto it = std::find_if(std::begin(kTrackFields), std::end(kTrackFields),
+                                   [&](const TrackField& field) { return name == field.name; });
+            if (it == std::end(kTrackFields)) {
+                error = "Unknown field: " + name;
+                return false;
+            }
+            fields.push_back(&*it);
+        }
+    }
     
-    std::string search_pattern = "%" + query + "%";
-    for (int i = 1; i <= 4; i++) {
-        sqlite3_bind_text(stmt, i, search_pattern.c_str(), -1, SQLITE_TRANSIENT);
+    PageCursor cursor;
+    const bool has_cursor = !request.cursor.empty();
+    if (has_cursor && !parse_page_cursor(request.cursor, cursor)) {
+        error = "Malformed cursor";
+        return false;
     }
     
-    int rc;
-    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        tracks.push_back(track_from_statement(stmt));
+    // Columns 0 and 1 are the keyset; the projection follows
+    const std::string key = sort;
+    std::string select = "SELECT rowid, " + key;
+    for (const TrackField* field : fields) {
+        select += ", ";
+        select += field->column;
     }
+    select += " FROM tracks WHERE ";
+    
+    // NULLs sort first ascending and last descending and never compare, so
+    // the NULL and non-NULL rows are read as separate segments; each is a
+    // single index range (an OR of the two would scan)
+    const char* direction = request.descending ? " DESC" : " ASC";
+    const std::string order = " ORDER BY " + key + direction + ", rowid" + direction + " LIMIT ?3";
+    const std::string null_rows = select + key + " IS NULL" +
+        (has_cursor && cursor.type == SQLITE_NULL ? (request.descending ? " AND rowid < ?2" : " AND rowid > ?2") : "") +
+        order;
+    const std::string value_rows = select +
+        (has_cursor && cursor.type != SQLITE_NULL ? "(" + key + ", rowid)" + (request.descending ? " < " : " > ") + "(?1, ?2)"
+                                                  : key + " IS NOT NULL") +
+        order;
+    
+    std::vector<std::string> segments;
+    if (!request.descending) {
+        if (!has_cursor || cursor.type == SQLITE_NULL) segments.push_back(null_rows);
+        segments.push_back(value_rows);
+    } else {
+        if (!has_cursor || cursor.type != SQLITE_NULL) segments.push_back(value_rows);
+        segments.push_back(null_rows);
+    }
+    
+    const int limit = std::clamp(request.limit, 1, MAX_PAGE_SIZE);
     
-    return tracks;
+    return with_reader([&](ReadConnection& reader) {
+        std::vector<sqlite3_stmt*> statements;
+        for (const std::string& sql : segments) {
+            sqlite3_stmt* stmt = nullptr;
+            if (sqlite3_prepare_v2(reader.db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+                error = sqlite3_errmsg(reader.db);
+                for (sqlite3_stmt* prepared : statements) sqlite3_finalize(prepared);
+                return false;
+            }
+            statements.push_back(stmt);
+        }
+        
+        out.key("tracks").begin_array();
+        int count = 0;
+        bool more = false;
+        std::string next_cursor;
+        for (sqlite3_stmt* stmt : statements) {
+            if (has_cursor) {
+                if (cursor.type == SQLITE_INTEGER) {
+                    sqlite3_bind_int64(stmt, 1, cursor.integer);
+                } else if (cursor.type == SQLITE_TEXT) {
+                    sqlite3_bind_text(stmt, 1, cursor.text.c_str(), -1, SQLITE_STATIC);
+                }
+                sqlite3_bind_int64(stmt, 2, cursor.rowid);
+            }
+            // One row past the page tells whether there is another
+            sqlite3_bind_int(stmt, 3, limit - count + 1);
+            
+            int rc;
+            while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                if (count == limit) {
+                    more = true;
+                    break;
+                }
+                
+                out.begin_object();
+                for (size_t i = 0; i < fields.size(); ++i) {
+                    const int column = static_cast<int>(i) + 2;
+                    out.key(fields[i]->name);
+                    switch (fields[i]->type) {
+                        case FieldType::TEXT: {
+                            const unsigned char* text = sqlite3_column_text(stmt, column);
+                            out.value(std::string_view(text ? reinterpret_cast<const char*>(text) : "",
+                                                       static_cast<size_t>(sqlite3_column_bytes(stmt, column))));
+                            break;
+                        }
+                        case FieldType::INTEGER:
+                            out.value(sqlite3_column_int64(stmt, column));
+                            break;
+                        case FieldType::REAL:
+                            out.value(sqlite3_column_double(stmt, column));
+                            break;
+                        case FieldType::BOOLEAN:
+                            out.value(sqlite3_column_int(stmt, column) != 0);
+                            break;
+                    }
+                }
+                out.end_object();
+                
+                if (++count == limit) {
+                    next_cursor = make_page_cursor(stmt, 0, 1);
+                }
+            }
+            if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+                Logger::error("DatabaseManager: track page failed: " + std::string(sqlite3_errmsg(reader.db)));
+            }
+            if (more) {
+                break;
+            }
+        }
+        for (sqlite3_stmt* stmt : statements) sqlite3_finalize(stmt);
+        out.end_array();
+        
+        out.key("count").value(count);
+        out.key("next_cursor");
+        if (more) {
+            out.value(next_cursor);
+        } else {
+            out.null();
+        }
+        return true;
+    });
+}
+
+std::string DatabaseManager::fts_match_expression(const std::string& query) {
+    // Words are runs of letters and digits; everything else, including FTS5
+    // operators and quotes, only separates them. Each word becomes a quoted
+    // prefix term and the terms are ANDed.
+    constexpr int kMaxTerms = 8;
+    auto is_word = [](unsigned char c) { return c >= 0x80 || std::isalnum(c); };
+    std::string expression;
+    int terms = 0;
+    size_t i = 0;
+    while (i < query.size() && terms < kMaxTerms) {
+        while (i < query.size() && !is_word(query[i])) ++i;
+        const size_t start = i;
+        while (i < query.size() && is_word(query[i])) ++i;
+        if (i > start) {
+            if (!expression.empty()) expression += ' ';
+            expression += '"' + query.substr(start, i - start) + "\"*";
+            ++terms;
+        }
+    }
+    return expression;
 }
 
 // ===== TRACK STATISTICS =====
 
 bool DatabaseManager::increment_play_count(const std::string& track_id) {
-    if (!prepared_statements_.increment_play_count) return false;
-    
-    sqlite3_stmt* stmt = prepared_statements_.increment_play_count;
-    sqlite3_reset(stmt);
-    
-    sqlite3_bind_text(stmt, 1, track_id.c_str(), -1, SQLITE_STATIC);
-    
-    int rc = sqlite3_step(stmt);
-    return (rc == SQLITE_DONE);
+    PendingWrite write;
+    write.type = PendingWrite::Type::PLAY_COUNT;
+    write.track.id = track_id;
+    return queue_write(std::move(write));
 }
 
 bool DatabaseManager::update_last_played(const std::string& track_id) {
-    if (!prepared_statements_.update_last_played) return false;
-    
-    sqlite3_stmt* stmt = prepared_statements_.update_last_played;
-    sqlite3_reset(stmt);
-    
-    sqlite3_bind_text(stmt, 1, track_id.c_str(), -1, SQLITE_STATIC);
-    
-    int rc = sqlite3_step(stmt);
-    return (rc == SQLITE_DONE);
+    PendingWrite write;
+    write.type = PendingWrite::Type::LAST_PLAYED;
+    write.track.id = track_id;
+    return queue_write(std::move(write));
 }
 
 // ===== STATION CONFIGURATION =====
@@ -468,6 +1129,8 @@ bool DatabaseManager::update_last_played(const std::string& track_id) {
 bool DatabaseManager::save_station_config(const RadioStation& station) {
     if (!is_connected_) return false;
     
+    auto lock = lock_writer();
+    
     json config_json = station.to_json();
     
     const char* sql = R"(
@@ -490,6 +1153,7 @@ bool DatabaseManager::save_station_config(const RadioStation& station) {
 
 RadioStation DatabaseManager::get_station_config() {
     RadioStation station;
+    auto lock = lock_writer();
     
     const char* sql = "SELECT value FROM station_config WHERE key = 'station_config'";
     sqlite3_stmt* stmt = nullptr;
@@ -535,6 +1199,337 @@ RadioStation DatabaseManager::get_station_config() {
     return station;
 }
 
+// ===== TRACK ANALYSIS =====
+
+bool DatabaseManager::save_analysis_jobs(const std::vector<AnalysisJobData>& jobs) {
+    if (!is_connected_) return false;
+    if (jobs.empty()) return true;
+    
+    auto lock = lock_writer();
+    
+    const char* upsert_sql = R"(
+        INSERT INTO analysis_jobs (track_id, status, progress, error, peak, dynamic_range, waveform_path,
+                                   bpm, beat_time, energy, updated_at)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, CURRENT_TIMESTAMP)
+        ON CONFLICT(track_id) DO UPDATE SET
+            status = excluded.status,
+            progress = excluded.progress,
+            error = excluded.error,
+            peak = COALESCE(excluded.peak, peak),
+            dynamic_range = COALESCE(excluded.dynamic_range, dynamic_range),
+            waveform_path = COALESCE(excluded.waveform_path, waveform_path),
+            bpm = COALESCE(excluded.bpm, bpm),
+            beat_time = COALESCE(excluded.beat_time, beat_time),
+            energy = COALESCE(excluded.energy, energy),
+            updated_at = CURRENT_TIMESTAMP
+    )";
+    const char* track_sql = "UPDATE tracks SET duration_ms = ?, bpm = COALESCE(?, bpm), is_analyzed = 1 WHERE id = ?";
+    
+    sqlite3_stmt* upsert = nullptr;
+    sqlite3_stmt* update_track = nullptr;
+    if (sqlite3_prepare_v2(db_, upsert_sql, -1, &upsert, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, track_sql, -1, &update_track, nullptr) != SQLITE_OK) {
+        log_sqlite_error("Prepare analysis job statements");
+        sqlite3_finalize(upsert);
+        sqlite3_finalize(update_track);
+        return false;
+    }
+    
+    if (!begin_transaction()) {
+        sqlite3_finalize(upsert);
+        sqlite3_finalize(update_track);
+        return false;
+    }
+    
+    bool ok = true;
+    for (const auto& job : jobs) {
+        const bool done = job.status == "done";
+        
+        sqlite3_reset(upsert);
+        sqlite3_clear_bindings(upsert);
+        sqlite3_bind_text(upsert, 1, job.track_id.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(upsert, 2, job.status.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_double(upsert, 3, job.progress);
+        if (!job.error.empty()) {
+            sqlite3_bind_text(upsert, 4, job.error.c_str(), -1, SQLITE_STATIC);
+        }
+        if (done) {
+            sqlite3_bind_double(upsert, 5, job.peak);
+            sqlite3_bind_double(upsert, 6, job.dynamic_range);
+            sqlite3_bind_double(upsert, 10, job.energy);
+        }
+        if (!job.waveform_path.empty()) {
+            sqlite3_bind_text(upsert, 7, job.waveform_path.c_str(), -1, SQLITE_STATIC);
+        }
+        const bool has_tempo = done && job.bpm > 0.0f;
+        if (has_tempo) {
+            sqlite3_bind_double(upsert, 8, job.bpm);
+            sqlite3_bind_double(upsert, 9, job.beat_time);
+        }
+        
+        if (sqlite3_step(upsert) != SQLITE_DONE) {
+            log_sqlite_error("Save analysis job " + job.track_id);
+            ok = false;
+            break;
+        }
+        
+        if (done) {
+            sqlite3_reset(update_track);
+            sqlite3_clear_bindings(update_track);
+            sqlite3_bind_int(update_track, 1, job.duration_ms);
+            if (has_tempo) {
+                sqlite3_bind_int(update_track, 2, static_cast<int>(std::lround(job.bpm)));
+            }
+            sqlite3_bind_text(update_track, 3, job.track_id.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(update_track) != SQLITE_DONE) {
+                log_sqlite_error("Mark track analyzed " + job.track_id);
+                ok = false;
+                break;
+            }
+        }
+    }
+    
+    sqlite3_finalize(upsert);
+    sqlite3_finalize(update_track);
+    
+    if (!ok) {
+        rollback_transaction();
+        return false;
+    }
+    return commit_transaction();
+}
+
+std::vector<DatabaseManager::AnalysisJobData> DatabaseManager::get_analysis_jobs(const std::string& status) {
+    std::vector<AnalysisJobData> jobs;
+    if (!is_connected_) return jobs;
+    
+    auto lock = lock_writer();
+    
+    const char* sql = status.empty()
+        ? "SELECT track_id, status, progress, error, peak, dynamic_range, waveform_path, bpm, beat_time, energy "
+          "FROM analysis_jobs ORDER BY updated_at DESC"
+        : "SELECT track_id, status, progress, error, peak, dynamic_range, waveform_path, bpm, beat_time, energy "
+          "FROM analysis_jobs WHERE status = ? ORDER BY updated_at DESC";
+    sqlite3_stmt* stmt = nullptr;
+    
+    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) return jobs;
+    
+    if (!status.empty()) {
+        sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_STATIC);
+    }
+    
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        jobs.push_back(analysis_job_from_statement(stmt));
+    }
+    
+    sqlite3_finalize(stmt);
+    return jobs;
+}
+
+bool DatabaseManager::get_analysis_job(const std::string& track_id, AnalysisJobData& job) {
+    if (!is_connected_) return false;
+    
+    return with_reader([&](ReadConnection& reader) {
+        const char* sql = "SELECT track_id, status, progress, error, peak, dynamic_range, waveform_path, bpm, beat_time, energy "
+                          "FROM analysis_jobs WHERE track_id = ?";
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(reader.db, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+        
+        sqlite3_bind_text(stmt, 1, track_id.c_str(), -1, SQLITE_STATIC);
+        const bool found = sqlite3_step(stmt) == SQLITE_ROW;
+        if (found) {
+            job = analysis_job_from_statement(stmt);
+        }
+        
+        sqlite3_finalize(stmt);
+        return found;
+    });
+}
+
+DatabaseManager::AnalysisJobData DatabaseManager::analysis_job_from_statement(sqlite3_stmt* stmt) {
+    AnalysisJobData job;
+    job.track_id = (char*)sqlite3_column_text(stmt, 0);
+    job.status = (char*)sqlite3_column_text(stmt, 1);
+    job.progress = sqlite3_column_double(stmt, 2);
+    job.error = sqlite3_column_text(stmt, 3) ? (char*)sqlite3_column_text(stmt, 3) : "";
+    job.peak = sqlite3_column_double(stmt, 4);
+    job.dynamic_range = sqlite3_column_double(stmt, 5);
+    job.waveform_path = sqlite3_column_text(stmt, 6) ? (char*)sqlite3_column_text(stmt, 6) : "";
+    job.bpm = sqlite3_column_double(stmt, 7);
+    job.beat_time = sqlite3_column_double(stmt, 8);
+    job.energy = sqlite3_column_double(stmt, 9);
+    return job;
+}
+
+// ===== WRITE BATCHING =====
+
+bool DatabaseManager::queue_write(PendingWrite write) {
+    if (!is_connected_) return false;
+    
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (batch_running_) {
+            pending_writes_.push_back(std::move(write));
+            return true;
+        }
+    }
+    
+    auto lock = lock_writer();
+    return apply_write(write);
+}
+
+void DatabaseManager::batch_loop() {
+    const auto interval = std::chrono::milliseconds(storage_options_.write_batch_ms);
+    
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    while (batch_running_) {
+        pending_cv_.wait_for(lock, interval, [this] { return !batch_running_; });
+        if (pending_writes_.empty()) {
+            continue;
+        }
+        
+        // The writer is taken before the queue, as everywhere else
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> writer(write_mutex_);
+            flush_pending_writes();
+        }
+        lock.lock();
+    }
+}
+
+std::unique_lock<std::mutex> DatabaseManager::lock_writer() {
+    std::unique_lock<std::mutex> lock(write_mutex_);
+    flush_pending_writes();
+    return lock;
+}
+
+bool DatabaseManager::flush_writes() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    return flush_pending_writes();
+}
+
+bool DatabaseManager::flush_pending_writes() {
+    std::vector<PendingWrite> writes;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        writes.swap(pending_writes_);
+    }
+    if (writes.empty() || !db_) {
+        return true;
+    }
+    
+    if (!begin_transaction()) {
+        // Busy; keep them, in order, for the next batch
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending_writes_.insert(pending_writes_.begin(), std::make_move_iterator(writes.begin()),
+                               std::make_move_iterator(writes.end()));
+        return false;
+    }
+    
+    // One failed row only loses itself
+    for (const auto& write : writes) {
+        if (!apply_write(write)) {
+            log_sqlite_error("Queued write for track " + write.track.id);
+        }
+    }
+    
+    if (!commit_transaction()) {
+        Logger::error("DatabaseManager: Dropped " + std::to_string(writes.size()) + " queued writes");
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::apply_write(const PendingWrite& write) {
+    switch (write.type) {
+        case PendingWrite::Type::PLAY_COUNT:
+        case PendingWrite::Type::LAST_PLAYED: {
+            sqlite3_stmt* stmt = write.type == PendingWrite::Type::PLAY_COUNT
+                ? prepared_statements_.increment_play_count
+                : prepared_statements_.update_last_played;
+            if (!stmt) return false;
+            
+            sqlite3_reset(stmt);
+            sqlite3_bind_text(stmt, 1, write.track.id.c_str(), -1, SQLITE_STATIC);
+            return sqlite3_step(stmt) == SQLITE_DONE;
+        }
+        case PendingWrite::Type::TRACK:
+            break;
+    }
+    
+    const RadioTrack& track = write.track;
+    if (!prepared_statements_.update_track) return false;
+    
+    sqlite3_stmt* stmt = prepared_statements_.update_track;
+    sqlite3_reset(stmt);
+    
+    // Bind parameters
+    sqlite3_bind_text(stmt, 1, track.title.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, track.artist.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, track.album.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, track.genre.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 5, track.duration_ms);
+    sqlite3_bind_int(stmt, 6, track.bpm);
+    sqlite3_bind_text(stmt, 7, track.key.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_double(stmt, 8, track.gain);
+    sqlite3_bind_int(stmt, 9, track.is_analyzed ? 1 : 0);
+    sqlite3_bind_int(stmt, 10, track.play_count);
+    
+    // last_played
+    if (track.last_played != std::chrono::system_clock::time_point{}) {
+        auto time_t = std::chrono::system_clock::to_time_t(track.last_played);
+        std::stringstream ss;
+        ss << std::put_time(std::gmtime(&time_t), "%Y-%m-%d %H:%M:%S");
+        sqlite3_bind_text(stmt, 11, ss.str().c_str(), -1, SQLITE_TRANSIENT);
+    } else {
+        sqlite3_bind_null(stmt, 11);
+    }
+    
+    sqlite3_bind_text(stmt, 12, "{}", -1, SQLITE_STATIC); // metadata_json
+    sqlite3_bind_text(stmt, 13, track.id.c_str(), -1, SQLITE_STATIC);
+    
+    int rc = sqlite3_step(stmt);
+    return (rc == SQLITE_DONE);
+}
+
+// ===== TRANSACTIONS =====
+
+bool DatabaseManager::begin_transaction() {
+    char* error_msg = nullptr;
+    int rc = sqlite3_exec(db_, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, &error_msg);
+    if (rc != SQLITE_OK) {
+        Logger::error("DatabaseManager: Failed to begin transaction: " + std::string(error_msg ? error_msg : ""));
+        sqlite3_free(error_msg);
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::commit_transaction() {
+    char* error_msg = nullptr;
+    int rc = sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, &error_msg);
+    if (rc != SQLITE_OK) {
+        Logger::error("DatabaseManager: Failed to commit transaction: " + std::string(error_msg ? error_msg : ""));
+        sqlite3_free(error_msg);
+        rollback_transaction();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::rollback_transaction() {
+    char* error_msg = nullptr;
+    int rc = sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, &error_msg);
+    if (rc != SQLITE_OK) {
+        Logger::error("DatabaseManager: Failed to roll back transaction: " + std::string(error_msg ? error_msg : ""));
+        sqlite3_free(error_msg);
+        return false;
+    }
+    return true;
+}
+
 // ===== HELPER METHODS =====
 
 RadioTrack DatabaseManager::track_from_statement(sqlite3_stmt* stmt) {
@@ -0,0 +1,368 @@
+#include "deck_equalizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace OneStopRadio {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr float kMinGain = 0.01f;               // -40 dB: the deepest shelf cut
+constexpr float kMaxGain = 4.0f;                // +12 dB
+constexpr float kSnap = 1e-4f;                  // Settings this close to the target land on it
+constexpr float kFilterDeadZone = 0.02f;        // Positions this close to the middle are off
+constexpr double kLowPassMinHz = 80.0;          // Cutoff at full low-pass
+constexpr double kLowPassMaxHz = 20000.0;
+constexpr double kHighPassMinHz = 20.0;
+constexpr double kHighPassMaxHz = 8000.0;       // Cutoff at full high-pass
+constexpr double kButterworthQ = 0.7071067811865476;
+constexpr double kButterworthLowQ = 0.5411961001461969;     // Fixed section of the 4th-order filter
+
+// Normalised biquad coefficients (a0 == 1); the defaults pass audio unchanged
+struct Biquad {
+    double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+};
+
+Biquad normalised(double b0, double b1, double b2, double a0, double a1, double a2) {
+    Biquad c;
+    c.b0 = b0 / a0;
+    c.b1 = b1 / a0;
+    c.b2 = b2 / a0;
+    c.a1 = a1 / a0;
+    c.a2 = a2 / a0;
+    return c;
+}
+
+// Cutoffs near Nyquist make the bilinear designs unstable
+double omega(double hz, int sample_rate) {
+    const double nyquist_guard = 0.45 * sample_rate;
+    return 2.0 * kPi * std::min(std::max(hz, 10.0), nyquist_guard) / sample_rate;
+}
+
+// Designs from the RBJ Audio EQ Cookbook
+Biquad lowpass(double hz, double q, int sample_rate) {
+    const double w = omega(hz, sample_rate);
+    const double cosw = std::cos(w);
+    const double alpha = std::sin(w) / (2.0 * q);
+    return normalised((1.0 - cosw) / 2.0, 1.0 - cosw, (1.0 - cosw) / 2.0,
+                      1.0 + alpha, -2.0 * cosw, 1.0 - alpha);
+}
+
+Biquad highpass(double hz, double q, int sample_rate) {
+    const double w = omega(hz, sample_rate);
+    const double cosw = std::cos(w);
+    const double alpha = std::sin(w) / (2.0 * q);
+    return normalised((1.0 + cosw) / 2.0, -(1.0 + cosw), (1.0 + cosw) / 2.0,
+                      1.0 + alpha, -2.0 * cosw, 1.0 - alpha);
+}
+
+Biquad allpass(double hz, double q, int sample_rate) {
+    const double w = omega(hz, sample_rate);
+    const double cosw = std::cos(w);
+    const double alpha = std::sin(w) / (2.0 * q);
+    return normalised(1.0 - alpha, -2.0 * cosw, 1.0 + alpha,
+                      1.0 + alpha, -2.0 * cosw, 1.0 - alpha);
+}
+
+Biquad peaking(double hz, double q, double gain_db, int sample_rate) {
+    const double a = std::pow(10.0, gain_db / 40.0);
+    const double w = omega(hz, sample_rate);
+    const double cosw = std::cos(w);
+    const double alpha = std::sin(w) / (2.0 * q);
+    return normalised(1.0 + alpha * a, -2.0 * cosw, 1.0 - alpha * a,
+                      1.0 + alpha / a, -2.0 * cosw, 1.0 - alpha / a);
+}
+
+// Shelves with slope 1: the steepest without overshoot
+Biquad low_shelf(double hz, double gain_db, int sample_rate) {
+    const double a = std::pow(10.0, gain_db / 40.0);
+    const double w = omega(hz, sample_rate);
+    const double cosw = std::cos(w);
+    const double k = std::sin(w) * std::sqrt(a);    // 2 * sqrt(A) * alpha
+    return normalised(a * ((a + 1.0) - (a - 1.0) * cosw + k),
+                      2.0 * a * ((a - 1.0) - (a + 1.0) * cosw),
+                      a * ((a + 1.0) - (a - 1.0) * cosw - k),
+                      (a + 1.0) + (a - 1.0) * cosw + k,
+                      -2.0 * ((a - 1.0) + (a + 1.0) * cosw),
+                      (a + 1.0) + (a - 1.0) * cosw - k);
+}
+
+Biquad high_shelf(double hz, double gain_db, int sample_rate) {
+    const double a = std::pow(10.0, gain_db / 40.0);
+    const double w = omega(hz, sample_rate);
+    const double cosw = std::cos(w);
+    const double k = std::sin(w) * std::sqrt(a);
+    return normalised(a * ((a + 1.0) + (a - 1.0) * cosw + k),
+                      -2.0 * a * ((a - 1.0) + (a + 1.0) * cosw),
+                      a * ((a + 1.0) + (a - 1.0) * cosw - k),
+                      (a + 1.0) - (a - 1.0) * cosw + k,
+                      2.0 * ((a - 1.0) - (a + 1.0) * cosw),
+                      (a + 1.0) - (a - 1.0) * cosw - k);
+}
+
+double gain_db(float gain) {
+    return 20.0 * std::log10(std::max(gain, kMinGain));
+}
+
+// A deck owns two adjacent lanes: its left and right channels
+void assign(dsp::BiquadStage4& stage, int deck, const Biquad& c) {
+    for (int lane = 2 * deck; lane < 2 * deck + 2; ++lane) {
+        stage.b0[lane] = static_cast<float>(c.b0);
+        stage.b1[lane] = static_cast<float>(c.b1);
+        stage.b2[lane] = static_cast<float>(c.b2);
+        stage.a1[lane] = static_cast<float>(c.a1);
+        stage.a2[lane] = static_cast<float>(c.a2);
+    }
+}
+
+void clear(dsp::BiquadStage4* stages, size_t count) {
+    for (size_t s = 0; s < count; ++s) {
+        std::memset(stages[s].z1, 0, sizeof(stages[s].z1));
+        std::memset(stages[s].z2, 0, sizeof(stages[s].z2));
+    }
+}
+
+bool flat(const DeckEqSettings& settings) {
+    return settings.low == 1.0f && settings.mid == 1.0f && settings.high == 1.0f && settings.filter == 0.0f;
+}
+
+bool approach(float& current, float target, float coeff) {
+    if (current == target) {
+        return false;
+    }
+    current += (target - current) * coeff;
+    if (std::abs(target - current) < kSnap) {
+        current = target;
+    }
+    return true;
+}
+
+} // namespace
+
+DeckEqualizer::DeckEqualizer(const DeckEqOptions& options)
+    : options_(options) {
+    const double smoothing_frames = options_.smoothing_ms * 0.001 * options_.sample_rate;
+    smoothing_coeff_ = smoothing_frames > 0.0
+        ? static_cast<float>(1.0 - std::exp(-static_cast<double>(kSubBlockFrames) / smoothing_frames))
+        : 1.0f;
+
+    // An LR4 low- and high-pass pair sums to the 2nd-order allpass at the
+    // same frequency, which is what the low band gets for the upper split
+    const int rate = options_.sample_rate;
+    for (int deck = 0; deck < kDecks; ++deck) {
+        for (size_t s = 0; s < kCrossoverStages; ++s) {
+            assign(split_low_[s], deck, lowpass(options_.low_hz, kButterworthQ, rate));
+            assign(split_rest_[s], deck, highpass(options_.low_hz, kButterworthQ, rate));
+            assign(split_mid_[s], deck, lowpass(options_.high_hz, kButterworthQ, rate));
+            assign(split_high_[s], deck, highpass(options_.high_hz, kButterworthQ, rate));
+        }
+        assign(split_low_[kCrossoverStages], deck, allpass(options_.high_hz, kButterworthQ, rate));
+        update_tone(deck);
+        update_filter(deck);
+    }
+    std::memset(low_band_, 0, sizeof(low_band_));
+    std::memset(mid_band_, 0, sizeof(mid_band_));
+    std::memset(high_band_, 0, sizeof(high_band_));
+}
+
+void DeckEqualizer::set(int deck, const DeckEqSettings& settings) {
+    if (deck < 0 || deck >= kDecks) {
+        return;
+    }
+    DeckEqSettings& target = target_[deck];
+    target.low = std::min(std::max(settings.low, 0.0f), kMaxGain);
+    target.mid = std::min(std::max(settings.mid, 0.0f), kMaxGain);
+    target.high = std::min(std::max(settings.high, 0.0f), kMaxGain);
+    target.filter = std::min(std::max(settings.filter, -1.0f), 1.0f);
+    target.resonance = std::min(std::max(settings.resonance, 0.5f), 10.0f);
+}
+
+void DeckEqualizer::set_band(int deck, DeckEqBand band, float gain) {
+    if (deck < 0 || deck >= kDecks) {
+        return;
+    }
+    DeckEqSettings settings = target_[deck];
+    switch (band) {
+        case DeckEqBand::LOW: settings.low = gain; break;
+        case DeckEqBand::MID: settings.mid = gain; break;
+        case DeckEqBand::HIGH: settings.high = gain; break;
+    }
+    set(deck, settings);
+}
+
+void DeckEqualizer::set_filter(int deck, float position) {
+    if (deck < 0 || deck >= kDecks) {
+        return;
+    }
+    DeckEqSettings settings = target_[deck];
+    settings.filter = position;
+    set(deck, settings);
+}
+
+bool DeckEqualizer::active() const {
+    for (int deck = 0; deck < kDecks; ++deck) {
+        if (!flat(current_[deck]) || !flat(target_[deck]) || wet_[deck] != 0.0f) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DeckEqualizer::reset() {
+    clear_state();
+    for (int deck = 0; deck < kDecks; ++deck) {
+        current_[deck] = target_[deck];
+        wet_[deck] = options_.mode == DeckEqMode::ISOLATOR && !flat(target_[deck]) ? 1.0f : 0.0f;
+        update_tone(deck);
+        update_filter(deck);
+    }
+}
+
+void DeckEqualizer::process(float* lanes, size_t frames) {
+    for (size_t offset = 0; offset < frames; offset += kSubBlockFrames) {
+        if (!active()) {
+            // Nothing is moving either, so the rest of the buffer passes too
+            if (running_) {
+                clear_state();
+                running_ = false;
+            }
+            return;
+        }
+        running_ = true;
+
+        const size_t n = std::min(kSubBlockFrames, frames - offset);
+        DeckEqSettings before[kDecks];
+        float wet_before[kDecks];
+        for (int deck = 0; deck < kDecks; ++deck) {
+            if (advance(deck, before[deck])) {
+                update_tone(deck);
+                update_filter(deck);
+            }
+            wet_before[deck] = wet_[deck];
+            if (options_.mode == DeckEqMode::ISOLATOR) {
+                approach(wet_[deck], flat(target_[deck]) ? 0.0f : 1.0f, smoothing_coeff_);
+            }
+        }
+
+        float* block = lanes + offset * kLanes;
+        dsp::BiquadStage4* stages = stages_;
+        size_t stage_count = kToneStages + kFilterStages;
+        if (options_.mode == DeckEqMode::ISOLATOR) {
+            isolate(block, n, before, wet_before);
+            stages += kToneStages;
+            stage_count -= kToneStages;
+        }
+        // With both filters off their sections are identities; skip them
+        if (current_[0].filter == 0.0f && current_[1].filter == 0.0f) {
+            clear(stages_ + kToneStages, kFilterStages);
+            stage_count -= kFilterStages;
+        }
+        if (stage_count > 0) {
+            dsp::biquad_cascade_x4(block, n, stages, stage_count);
+        }
+    }
+}
+
+bool DeckEqualizer::advance(int deck, DeckEqSettings& before) {
+    DeckEqSettings& current = current_[deck];
+    const DeckEqSettings& target = target_[deck];
+    before = current;
+    bool moved = false;
+    moved |= approach(current.low, target.low, smoothing_coeff_);
+    moved |= approach(current.mid, target.mid, smoothing_coeff_);
+    moved |= approach(current.high, target.high, smoothing_coeff_);
+    moved |= approach(current.filter, target.filter, smoothing_coeff_);
+    moved |= approach(current.resonance, target.resonance, smoothing_coeff_);
+    return moved;
+}
+
+void DeckEqualizer::update_tone(int deck) {
+    if (options_.mode != DeckEqMode::SHELVING) {
+        return;
+    }
+    const DeckEqSettings& settings = current_[deck];
+    const int rate = options_.sample_rate;
+    assign(stages_[0], deck, low_shelf(options_.low_hz, gain_db(settings.low), rate));
+    assign(stages_[1], deck, peaking(options_.mid_hz, options_.mid_q, gain_db(settings.mid), rate));
+    assign(stages_[2], deck, high_shelf(options_.high_hz, gain_db(settings.high), rate));
+}
+
+// The cutoff sweeps exponentially from the ends of the audio band toward
+// kLowPassMinHz or kHighPassMaxHz as the position moves out from the middle
+void DeckEqualizer::update_filter(int deck) {
+    const DeckEqSettings& settings = current_[deck];
+    dsp::BiquadStage4& fixed = stages_[kToneStages];
+    dsp::BiquadStage4& resonant = stages_[kToneStages + 1];
+    const float depth = (std::abs(settings.filter) - kFilterDeadZone) / (1.0f - kFilterDeadZone);
+
+    if (depth <= 0.0f) {
+        assign(fixed, deck, Biquad());
+        assign(resonant, deck, Biquad());
+    } else if (settings.filter < 0.0f) {
+        const double hz = kLowPassMaxHz * std::pow(kLowPassMinHz / kLowPassMaxHz, depth);
+        assign(fixed, deck, lowpass(hz, kButterworthLowQ, options_.sample_rate));
+        assign(resonant, deck, lowpass(hz, settings.resonance, options_.sample_rate));
+    } else {
+        const double hz = kHighPassMinHz * std::pow(kHighPassMaxHz / kHighPassMinHz, depth);
+        assign(fixed, deck, highpass(hz, kButterworthLowQ, options_.sample_rate));
+        assign(resonant, deck, highpass(hz, settings.resonance, options_.sample_rate));
+    }
+}
+
+// Bands are summed with their gains, then blended with the dry input.
+// Gains and blend move linearly across the block from where the last one
+// ended, so a kill fades rather than steps.
+void DeckEqualizer::isolate(float* lanes, size_t frames, const DeckEqSettings (&before)[kDecks],
+                            const float (&wet_before)[kDecks]) {
+    const size_t bytes = frames * kLanes * sizeof(float);
+    std::memcpy(low_band_, lanes, bytes);
+    std::memcpy(mid_band_, lanes, bytes);
+    dsp::biquad_cascade_x4(low_band_, frames, split_low_, kCrossoverStages + 1);
+    dsp::biquad_cascade_x4(mid_band_, frames, split_rest_, kCrossoverStages);
+    std::memcpy(high_band_, mid_band_, bytes);
+    dsp::biquad_cascade_x4(mid_band_, frames, split_mid_, kCrossoverStages);
+    dsp::biquad_cascade_x4(high_band_, frames, split_high_, kCrossoverStages);
+
+    float low[kLanes], mid[kLanes], high[kLanes], wet[kLanes];
+    float low_step[kLanes], mid_step[kLanes], high_step[kLanes], wet_step[kLanes];
+    const float inv_frames = 1.0f / static_cast<float>(frames);
+    for (int lane = 0; lane < kLanes; ++lane) {
+        const int deck = lane / 2;
+        const DeckEqSettings& start = before[deck];
+        const DeckEqSettings& end = current_[deck];
+        low[lane] = start.low;
+        mid[lane] = start.mid;
+        high[lane] = start.high;
+        wet[lane] = wet_before[deck];
+        low_step[lane] = (end.low - start.low) * inv_frames;
+        mid_step[lane] = (end.mid - start.mid) * inv_frames;
+        high_step[lane] = (end.high - start.high) * inv_frames;
+        wet_step[lane] = (wet_[deck] - wet_before[deck]) * inv_frames;
+    }
+
+    for (size_t i = 0; i < frames; ++i) {
+        float* x = lanes + i * kLanes;
+        const float* lo = low_band_ + i * kLanes;
+        const float* mi = mid_band_ + i * kLanes;
+        const float* hi = high_band_ + i * kLanes;
+        for (int lane = 0; lane < kLanes; ++lane) {
+            const float bands = lo[lane] * low[lane] + mi[lane] * mid[lane] + hi[lane] * high[lane];
+            x[lane] += (bands - x[lane]) * wet[lane];
+            low[lane] += low_step[lane];
+            mid[lane] += mid_step[lane];
+            high[lane] += high_step[lane];
+            wet[lane] += wet_step[lane];
+        }
+    }
+}
+
+void DeckEqualizer::clear_state() {
+    clear(stages_, kToneStages + kFilterStages);
+    clear(split_low_, kCrossoverStages + 1);
+    clear(split_rest_, kCrossoverStages);
+    clear(split_mid_, kCrossoverStages);
+    clear(split_high_, kCrossoverStages);
+}
+
+} // namespace OneStopRadio
@@ -0,0 +1,643 @@
+#include "disk_recorder.hpp"
+#include "audio_stream_encoder.hpp"
+#include "metrics_registry.hpp"
+#include "trace_profiler.hpp"
+#include "utils/logger.hpp"
+#include "utils/spsc_queue.hpp"
+#include <sndfile.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kBlockAlignFrames = 4096;
+constexpr size_t kEncodedWriteBytes = 128 * 1024;
+constexpr auto kWaitSlice = std::chrono::milliseconds(100);
+constexpr uint64_t kNoSegmentEnd = std::numeric_limits<uint64_t>::max();
+
+struct RecorderMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    MetricCounter& frames = registry.counter(
+        "onestop_recorder_frames_total", "Frames written to recordings");
+    MetricCounter& dropped_frames = registry.counter(
+        "onestop_recorder_dropped_frames_total", "Frames lost before reaching a recording");
+};
+
+RecorderMetrics& recorder_metrics() {
+    static RecorderMetrics metrics;
+    return metrics;
+}
+
+std::string lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return text;
+}
+
+std::string extension_for_format(const std::string& format) {
+    const std::string name = lower(format);
+    if (name == "vorbis" || name == "ogg vorbis") {
+        return "ogg";
+    }
+    if (name == "ogg opus") {
+        return "opus";
+    }
+    return name;
+}
+
+int sndfile_format(const std::string& format, int bit_depth) {
+    if (lower(format) == "flac") {
+        return SF_FORMAT_FLAC | (bit_depth >= 24 ? SF_FORMAT_PCM_24 : SF_FORMAT_PCM_16);
+    }
+    // RF64 falls back to a plain RIFF header when the file stays under 4 GB
+    switch (bit_depth) {
+        case 24: return SF_FORMAT_RF64 | SF_FORMAT_PCM_24;
+        case 32: return SF_FORMAT_RF64 | SF_FORMAT_FLOAT;
+        default: return SF_FORMAT_RF64 | SF_FORMAT_PCM_16;
+    }
+}
+
+} // namespace
+
+/**
+ * One open output file: libsndfile for PCM, a raw file for encoded streams
+ */
+class RecordingSegment {
+public:
+    ~RecordingSegment() { close(); }
+
+    bool open_pcm(const std::string& path, int format, int sample_rate, int channels) {
+        SF_INFO info{};
+        info.samplerate = sample_rate;
+        info.channels = channels;
+        info.format = format;
+        sndfile_ = sf_open(path.c_str(), SFM_WRITE, &info);
+        if (!sndfile_) {
+            return false;
+        }
+        if ((format & SF_FORMAT_TYPEMASK) == SF_FORMAT_RF64) {
+            sf_command(sndfile_, SFC_RF64_AUTO_DOWNGRADE, nullptr, SF_TRUE);
+        }
+        path_ = path;
+        return true;
+    }
+
+    bool open_raw(const std::string& path) {
+        raw_ = std::fopen(path.c_str(), "wb");
+        if (!raw_) {
+            return false;
+        }
+        // Writes arrive in whole blocks already; stdio would only copy them again
+        std::setvbuf(raw_, nullptr, _IONBF, 0);
+        path_ = path;
+        return true;
+    }
+
+    bool write_frames(const float* samples, size_t frames) {
+        return sf_writef_float(sndfile_, samples, static_cast<sf_count_t>(frames)) == static_cast<sf_count_t>(frames);
+    }
+
+    bool write_bytes(const uint8_t* data, size_t size) {
+        return std::fwrite(data, 1, size, raw_) == size;
+    }
+
+    void close() {
+        if (sndfile_) {
+            sf_close(sndfile_);
+            sndfile_ = nullptr;
+        }
+        if (raw_) {
+            std::fclose(raw_);
+            raw_ = nullptr;
+        }
+    }
+
+    bool is_open() const { return sndfile_ || raw_; }
+    const std::string& path() const { return path_; }
+    std::string error() const { return sndfile_ ? sf_strerror(sndfile_) : sf_strerror(nullptr); }
+
+private:
+    SNDFILE* sndfile_ = nullptr;
+    std::FILE* raw_ = nullptr;
+    std::string path_;
+};
+
+class DiskRecorder::Impl : public EncodedPacketSink {
+public:
+    explicit Impl(const RecorderOptions& options) : options_(options) {
+        options_.block_frames = std::max(kBlockAlignFrames,
+            (options_.block_frames + kBlockAlignFrames - 1) / kBlockAlignFrames * kBlockAlignFrames);
+        options_.segment_seconds = options_.file.empty() ? std::max(options_.segment_seconds, 0) : 0;
+    }
+
+    ~Impl() override { stop(); }
+
+    bool start_pcm(std::shared_ptr<AudioRingBuffer::Reader> source) {
+        if (running_ || !source) {
+            return false;
+        }
+        if (DiskRecorder::is_encoded_format(options_.format)) {
+            set_error("Format " + options_.format + " needs an encoder");
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            source_ = std::move(source);
+        }
+        sample_rate_ = source_->sample_rate();
+        channels_ = source_->channels();
+
+        // A blocking read can wait for at most a quarter of the ring
+        block_frames_ = std::min(options_.block_frames, std::max<size_t>(source_->capacity_frames() / 4, 1));
+        const double pool_frames = options_.buffer_seconds * sample_rate_;
+        const size_t blocks = std::max<size_t>(2, static_cast<size_t>(pool_frames / block_frames_) + 1);
+        pool_.assign(blocks * block_frames_ * channels_, 0.0f);
+        silence_.assign(block_frames_ * channels_, 0.0f);
+        filled_ = std::make_unique<SpscQueue<Block>>(blocks);
+        free_ = std::make_unique<SpscQueue<size_t>>(blocks);
+        for (size_t i = 0; i < blocks; ++i) {
+            free_->try_push(i);
+        }
+
+        begin_timeline();
+        if (!open_segment()) {
+            return false;
+        }
+        running_ = true;
+        stopping_ = false;
+        capture_done_ = false;
+        capture_thread_ = std::thread(&Impl::capture_loop, this);
+        writer_thread_ = std::thread(&Impl::pcm_writer_loop, this);
+        return true;
+    }
+
+    bool start_encoded(std::shared_ptr<SharedStreamEncoder> encoder) {
+        if (running_ || !encoder) {
+            return false;
+        }
+        if (!DiskRecorder::is_encoded_format(options_.format)) {
+            set_error("Format " + options_.format + " is not an encoder format");
+            return false;
+        }
+        encoder_ = std::move(encoder);
+        sample_rate_ = encoder_->profile().sample_rate;
+        channels_ = encoder_->profile().channels;
+
+        // Generous for any codec's packet rate; headers are the first packets and always fit
+        packets_ = std::make_unique<SpscQueue<EncodedPacketPtr>>(
+            std::max<size_t>(64, static_cast<size_t>(options_.buffer_seconds * 100.0)));
+        staging_.reserve(kEncodedWriteBytes);
+
+        begin_timeline();
+        if (!open_segment()) {
+            return false;
+        }
+        running_ = true;
+        capture_done_ = false;
+        writer_thread_ = std::thread(&Impl::encoded_writer_loop, this);
+        encoder_->add_sink(this);
+        return true;
+    }
+
+    void stop() {
+        if (!running_) {
+            return;
+        }
+        if (encoder_) {
+            encoder_->remove_sink(this);
+        }
+        stopping_ = true;
+        if (source_) {
+            source_->cancel();
+        }
+        if (capture_thread_.joinable()) {
+            capture_thread_.join();
+        }
+        capture_done_ = true;
+        wake_writer();
+        if (writer_thread_.joinable()) {
+            writer_thread_.join();
+        }
+        running_ = false;
+        encoder_.reset();
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            source_.reset();
+        }
+        Logger::info("Recording stopped after " + std::to_string(segments_.load()) + " segment(s), " +
+                     std::to_string(dropped_frames_.load()) + " frames dropped");
+    }
+
+    bool is_running() const { return running_; }
+
+    RecorderStats stats() const {
+        RecorderStats stats;
+        stats.recording = running_;
+        std::shared_ptr<AudioRingBuffer::Reader> source;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            stats.current_file = current_file_;
+            source = source_;
+        }
+        stats.segments = segments_.load();
+        stats.frames_written = frames_written_.load();
+        stats.dropped_frames = dropped_frames_.load();
+        stats.write_errors = write_errors_.load();
+
+        double pending = static_cast<double>(pending_frames_.load());
+        if (source && running_) {
+            pending += static_cast<double>(source->available());
+        }
+        stats.lag_seconds = sample_rate_ > 0 ? pending / sample_rate_ : 0.0;
+        return stats;
+    }
+
+    const RecorderOptions& options() const { return options_; }
+
+    std::string get_error() const {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        return error_;
+    }
+
+    // Encoder thread, or the starting thread replaying headers; add_sink()
+    // and packet delivery are serialized by the encoder, so one producer at a time
+    void on_encoded_packet(const EncodedPacketPtr& packet) override {
+        if (!packet) {
+            return;
+        }
+        if (!packets_->try_push(packet)) {
+            drop_frames(packet->frames);
+            return;
+        }
+        pending_frames_.fetch_add(packet->frames);
+        wake_writer();
+    }
+
+private:
+    struct Block {
+        size_t index = 0;
+        size_t frames = 0;
+        uint64_t gap_frames = 0;        // Lost just before this block, written as silence
+    };
+
+    void set_error(const std::string& error) {
+        Logger::error("Recorder: " + error);
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        error_ = error;
+    }
+
+    void drop_frames(uint64_t frames) {
+        dropped_frames_.fetch_add(frames);
+        recorder_metrics().dropped_frames.increment(frames);
+    }
+
+    void wake_writer() {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_cv_.notify_one();
+    }
+
+    void wait_for_work() {
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cv_.wait_for(lock, kWaitSlice);
+    }
+
+    // Wall-clock time of frame 0 and the first cut
+    void begin_timeline() {
+        start_time_ = std::chrono::system_clock::now();
+        position_ = 0;
+        segments_ = 0;
+        segment_end_ = kNoSegmentEnd;
+        if (options_.segment_seconds > 0) {
+            const double since_epoch = std::chrono::duration<double>(start_time_.time_since_epoch()).count();
+            const double into_segment = std::fmod(since_epoch, static_cast<double>(options_.segment_seconds));
+            const double until_cut = options_.segment_seconds - into_segment;
+            segment_end_ = std::max<uint64_t>(1, static_cast<uint64_t>(until_cut * sample_rate_ + 0.5));
+        }
+    }
+
+    std::string segment_path() const {
+        if (!options_.file.empty()) {
+            return options_.file;
+        }
+        // Cuts land a hair either side of the second they are named after
+        std::time_t when = std::chrono::system_clock::to_time_t(start_time_);
+        if (position_ > 0) {
+            const auto offset = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(position_) / sample_rate_ + 0.5));
+            when = std::chrono::system_clock::to_time_t(start_time_ + offset);
+        }
+        std::tm local{};
+        localtime_r(&when, &local);
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+
+        const std::string base = (std::filesystem::path(options_.directory) / (options_.prefix + "-" + stamp)).string();
+        const std::string extension = "." + extension_for_format(options_.format);
+        std::string path = base + extension;
+        for (int n = 1; std::filesystem::exists(path); ++n) {
+            path = base + "-" + std::to_string(n) + extension;
+        }
+        return path;
+    }
+
+    bool open_segment() {
+        if (options_.file.empty()) {
+            std::error_code ec;
+            std::filesystem::create_directories(options_.directory, ec);
+        }
+        const std::string path = segment_path();
+        const bool opened = DiskRecorder::is_encoded_format(options_.format)
+            ? segment_.open_raw(path)
+            : segment_.open_pcm(path, sndfile_format(options_.format, options_.bit_depth), sample_rate_, channels_);
+        if (!opened) {
+            write_errors_.fetch_add(1);
+            set_error("Failed to open " + path + ": " + segment_.error());
+            return false;
+        }
+        segments_.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            current_file_ = path;
+        }
+        Logger::info("Recording to " + path);
+        return true;
+    }
+
+    // Close the current segment at the cut and start the next one
+    void next_segment() {
+        if (DiskRecorder::is_encoded_format(options_.format)) {
+            flush_staging();
+        }
+        segment_.close();
+        segment_end_ += static_cast<uint64_t>(options_.segment_seconds) * sample_rate_;
+        if (open_segment() && DiskRecorder::is_encoded_format(options_.format)) {
+            // Each file has to be decodable on its own
+            for (const auto& header : headers_) {
+                stage(header->data.data(), header->data.size());
+            }
+        }
+    }
+
+    // ===== PCM =====
+
+    void capture_loop() {
+        TRACE_THREAD_NAME("recorder_capture");
+        const size_t npos = std::numeric_limits<size_t>::max();
+        size_t index = npos;
+        uint64_t seen_dropped = source_->dropped_frames();
+        uint64_t gap = 0;
+        std::vector<float> scratch(block_frames_ * channels_);
+
+        const auto deliver = [&](size_t frames) {
+            // Ring overruns show up as the reader skipping ahead
+            const uint64_t dropped = source_->dropped_frames();
+            if (dropped > seen_dropped) {
+                drop_frames(dropped - seen_dropped);
+                gap += dropped - seen_dropped;
+                seen_dropped = dropped;
+            }
+            filled_->try_push(Block{index, frames, gap});
+            pending_frames_.fetch_add(gap + frames);
+            gap = 0;
+            index = npos;
+            wake_writer();
+        };
+
+        while (!stopping_) {
+            if (index == npos && !free_->try_pop(index)) {
+                // Pool full: the writer is behind, so this block is lost
+                const size_t frames = source_->read(scratch.data(), block_frames_, kWaitSlice);
+                drop_frames(frames);
+                gap += frames;
+                continue;
+            }
+            const size_t frames = source_->read(block(index), block_frames_, kWaitSlice);
+            if (frames > 0) {
+                deliver(frames);
+            }
+        }
+
+        // Take whatever arrived before stop was requested
+        for (;;) {
+            if (index == npos && !free_->try_pop(index)) {
+                break;
+            }
+            const size_t frames = std::min(source_->available(), block_frames_);
+            if (frames == 0 || !source_->try_read(block(index), frames)) {
+                break;
+            }
+            deliver(frames);
+        }
+        if (index != npos) {
+            free_->try_push(index);
+        }
+    }
+
+    float* block(size_t index) { return pool_.data() + index * block_frames_ * channels_; }
+
+    void pcm_writer_loop() {
+        TRACE_THREAD_NAME("recorder_writer");
+        for (;;) {
+            Block filled;
+            if (filled_->try_pop(filled)) {
+                TRACE_SCOPE("recorder_write");
+                write_pcm(nullptr, filled.gap_frames);
+                write_pcm(block(filled.index), filled.frames);
+                free_->try_push(filled.index);
+                continue;
+            }
+            if (capture_done_) {
+                if (filled_->empty()) {
+                    break;
+                }
+                continue;
+            }
+            wait_for_work();
+        }
+        segment_.close();
+    }
+
+    // Null samples write silence; splits at the segment cut
+    void write_pcm(const float* samples, uint64_t frames) {
+        while (frames > 0) {
+            uint64_t chunk = std::min<uint64_t>(frames, segment_end_ - position_);
+            if (!samples) {
+                chunk = std::min<uint64_t>(chunk, block_frames_);
+            }
+            if (segment_.is_open() && !segment_.write_frames(samples ? samples : silence_.data(), chunk)) {
+                if (write_errors_.fetch_add(1) == 0) {
+                    set_error("Write to " + segment_.path() + " failed: " + segment_.error());
+                }
+            }
+            position_ += chunk;
+            frames -= chunk;
+            if (samples) {
+                samples += chunk * channels_;
+            }
+            frames_written_.fetch_add(chunk);
+            pending_frames_.fetch_sub(chunk);
+            recorder_metrics().frames.increment(chunk);
+            if (position_ == segment_end_) {
+                next_segment();
+            }
+        }
+    }
+
+    // ===== ENCODED =====
+
+    void encoded_writer_loop() {
+        TRACE_THREAD_NAME("recorder_writer");
+        for (;;) {
+            EncodedPacketPtr packet;
+            if (packets_->try_pop(packet)) {
+                TRACE_SCOPE("recorder_write");
+                write_packet(*packet);
+                continue;
+            }
+            if (capture_done_) {
+                if (packets_->empty()) {
+                    break;
+                }
+                continue;
+            }
+            wait_for_work();
+        }
+        flush_staging();
+        segment_.close();
+    }
+
+    void write_packet(const EncodedPacket& packet) {
+        if (packet.header) {
+            headers_.push_back(std::make_shared<EncodedPacket>(packet));
+        } else if (position_ >= segment_end_) {
+            // Encoded streams can only be cut between packets
+            next_segment();
+        }
+        stage(packet.data.data(), packet.data.size());
+        position_ += packet.frames;
+        staged_frames_ += packet.frames;
+    }
+
+    void stage(const uint8_t* data, size_t size) {
+        while (size > 0) {
+            const size_t n = std::min(size, kEncodedWriteBytes - staging_.size());
+            staging_.insert(staging_.end(), data, data + n);
+            data += n;
+            size -= n;
+            if (staging_.size() == kEncodedWriteBytes) {
+                flush_staging();
+            }
+        }
+    }
+
+    void flush_staging() {
+        if (!staging_.empty() && segment_.is_open() && !segment_.write_bytes(staging_.data(), staging_.size())) {
+            if (write_errors_.fetch_add(1) == 0) {
+                set_error("Write to " + segment_.path() + " failed");
+            }
+        }
+        staging_.clear();
+        frames_written_.fetch_add(staged_frames_);
+        pending_frames_.fetch_sub(staged_frames_);
+        recorder_metrics().frames.increment(staged_frames_);
+        staged_frames_ = 0;
+    }
+
+    RecorderOptions options_;
+    int sample_rate_ = 0;
+    int channels_ = 0;
+
+    // PCM: capture thread -> filled_ -> writer thread -> free_ -> capture thread
+    std::shared_ptr<AudioRingBuffer::Reader> source_;
+    size_t block_frames_ = 0;
+    std::vector<float> pool_;
+    std::vector<float> silence_;
+    std::unique_ptr<SpscQueue<Block>> filled_;
+    std::unique_ptr<SpscQueue<size_t>> free_;
+    std::thread capture_thread_;
+
+    // Encoded: encoder thread -> packets_ -> writer thread
+    std::shared_ptr<SharedStreamEncoder> encoder_;
+    std::unique_ptr<SpscQueue<EncodedPacketPtr>> packets_;
+    std::vector<std::shared_ptr<const EncodedPacket>> headers_;
+    std::vector<uint8_t> staging_;
+    uint64_t staged_frames_ = 0;
+
+    // Writer thread
+    std::thread writer_thread_;
+    RecordingSegment segment_;
+    std::chrono::system_clock::time_point start_time_;
+    uint64_t position_ = 0;             // Frames of timeline written, silence included
+    uint64_t segment_end_ = kNoSegmentEnd;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stopping_{false};         // Capture thread: finish up
+    std::atomic<bool> capture_done_{false};     // Writer thread: drain and exit
+
+    std::atomic<uint64_t> segments_{0};
+    std::atomic<uint64_t> frames_written_{0};
+    std::atomic<uint64_t> dropped_frames_{0};
+    std::atomic<uint64_t> pending_frames_{0};
+    std::atomic<uint64_t> write_errors_{0};
+    std::string current_file_;
+    std::string error_;
+    mutable std::mutex state_mutex_;            // Guards current_file_, error_ and, for stats(), source_
+};
+
+DiskRecorder::DiskRecorder(const RecorderOptions& options)
+    : impl_(std::make_unique<Impl>(options)) {}
+
+DiskRecorder::~DiskRecorder() = default;
+
+bool DiskRecorder::start(std::shared_ptr<AudioRingBuffer::Reader> source) {
+    return impl_->start_pcm(std::move(source));
+}
+
+bool DiskRecorder::start(std::shared_ptr<SharedStreamEncoder> encoder) {
+    return impl_->start_encoded(std::move(encoder));
+}
+
+void DiskRecorder::stop() {
+    impl_->stop();
+}
+
+bool DiskRecorder::is_running() const {
+    return impl_->is_running();
+}
+
+RecorderStats DiskRecorder::stats() const {
+    return impl_->stats();
+}
+
+const RecorderOptions& DiskRecorder::options() const {
+    return impl_->options();
+}
+
+std::string DiskRecorder::get_error() const {
+    return impl_->get_error();
+}
+
+bool DiskRecorder::is_encoded_format(const std::string& format) {
+    const std::string name = lower(format);
+    return name != "wav" && name != "flac";
+}
+
+std::string DiskRecorder::format_for_path(const std::string& path) {
+    const std::string extension = lower(std::filesystem::path(path).extension().string());
+    for (const char* format : {"flac", "mp3", "ogg", "opus", "aac"}) {
+        if (extension == std::string(".") + format) {
+            return format;
+        }
+    }
+    return "wav";
+}
@@ -0,0 +1,598 @@
+#include "dsp_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define DSP_HAVE_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define DSP_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// AVX2 variants are compiled per function so the rest of the build keeps its baseline ISA
+#if defined(DSP_HAVE_X86) && defined(__GNUC__)
+#define DSP_HAVE_AVX2 1
+#define DSP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace dsp {
+
+namespace {
+
+// ===== SCALAR REFERENCE =====
+
+void mix_accumulate_scalar(float* dst, const float* src, size_t count, float gain) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] += src[i] * gain;
+    }
+}
+
+void mix_accumulate_stereo_scalar(float* dst, const float* src, size_t frames,
+                                  float gain_left, float gain_right) {
+    for (size_t i = 0; i < frames; ++i) {
+        dst[2 * i] += src[2 * i] * gain_left;
+        dst[2 * i + 1] += src[2 * i + 1] * gain_right;
+    }
+}
+
+void apply_gain_scalar(float* buffer, size_t count, float gain) {
+    for (size_t i = 0; i < count; ++i) {
+        buffer[i] *= gain;
+    }
+}
+
+void apply_gain_ramp_stereo_scalar(float* buffer, size_t frames, float start_gain, float end_gain) {
+    if (frames == 0) return;
+    const float step = (end_gain - start_gain) / static_cast<float>(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        const float gain = start_gain + step * static_cast<float>(i);
+        buffer[2 * i] *= gain;
+        buffer[2 * i + 1] *= gain;
+    }
+}
+
+PeakRms peak_rms_stereo_scalar(const float* interleaved, size_t frames) {
+    PeakRms result;
+    for (size_t i = 0; i < frames; ++i) {
+        const float left = interleaved[2 * i];
+        const float right = interleaved[2 * i + 1];
+        result.peak_left = std::max(result.peak_left, std::abs(left));
+        result.peak_right = std::max(result.peak_right, std::abs(right));
+        result.sum_sq_left += left * left;
+        result.sum_sq_right += right * right;
+    }
+    return result;
+}
+
+void deinterleave_stereo_scalar(const float* interleaved, float* left, float* right, size_t frames) {
+    for (size_t i = 0; i < frames; ++i) {
+        left[i] = interleaved[2 * i];
+        right[i] = interleaved[2 * i + 1];
+    }
+}
+
+void interleave_stereo_scalar(const float* left, const float* right, float* interleaved, size_t frames) {
+    for (size_t i = 0; i < frames; ++i) {
+        interleaved[2 * i] = left[i];
+        interleaved[2 * i + 1] = right[i];
+    }
+}
+
+void soft_clip_scalar(float* buffer, size_t count, float threshold) {
+    for (size_t i = 0; i < count; ++i) {
+        if (std::abs(buffer[i]) > threshold) {
+            buffer[i] = std::tanh(buffer[i]) * threshold;
+        }
+    }
+}
+
+// A decaying filter fed silence sinks into denormals, which are slow on
+// most CPUs; state that small is inaudible, so it is zeroed after each call
+void flush_biquad_state(BiquadStage4& stage) {
+    constexpr float kTiny = 1e-20f;
+    for (int lane = 0; lane < 4; ++lane) {
+        if (std::abs(stage.z1[lane]) < kTiny) stage.z1[lane] = 0.0f;
+        if (std::abs(stage.z2[lane]) < kTiny) stage.z2[lane] = 0.0f;
+    }
+}
+
+void biquad_cascade_x4_scalar(float* lanes, size_t frames, BiquadStage4* stages, size_t stage_count) {
+    for (size_t s = 0; s < stage_count; ++s) {
+        BiquadStage4& stage = stages[s];
+        for (int lane = 0; lane < 4; ++lane) {
+            const float b0 = stage.b0[lane], b1 = stage.b1[lane], b2 = stage.b2[lane];
+            const float a1 = stage.a1[lane], a2 = stage.a2[lane];
+            float z1 = stage.z1[lane], z2 = stage.z2[lane];
+            for (size_t i = 0; i < frames; ++i) {
+                const float x = lanes[4 * i + lane];
+                const float y = b0 * x + z1;
+                z1 = (b1 * x - a1 * y) + z2;
+                z2 = b2 * x - a2 * y;
+                lanes[4 * i + lane] = y;
+            }
+            stage.z1[lane] = z1;
+            stage.z2[lane] = z2;
+        }
+        flush_biquad_state(stage);
+    }
+}
+
+const KernelTable kScalarTable = {
+    "scalar",
+    mix_accumulate_scalar,
+    mix_accumulate_stereo_scalar,
+    apply_gain_scalar,
+    apply_gain_ramp_stereo_scalar,
+    peak_rms_stereo_scalar,
+    deinterleave_stereo_scalar,
+    interleave_stereo_scalar,
+    soft_clip_scalar,
+    biquad_cascade_x4_scalar
+};
+
+#if defined(DSP_HAVE_X86)
+
+// ===== SSE2 =====
+
+void mix_accumulate_sse(float* dst, const float* src, size_t count, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 d = _mm_loadu_ps(dst + i);
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        _mm_storeu_ps(dst + i, d);
+    }
+    mix_accumulate_scalar(dst + i, src + i, count - i, gain);
+}
+
+void mix_accumulate_stereo_sse(float* dst, const float* src, size_t frames,
+                               float gain_left, float gain_right) {
+    const __m128 g = _mm_setr_ps(gain_left, gain_right, gain_left, gain_right);
+    const size_t count = frames * 2;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 d = _mm_loadu_ps(dst + i);
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        _mm_storeu_ps(dst + i, d);
+    }
+    mix_accumulate_stereo_scalar(dst + i, src + i, (count - i) / 2, gain_left, gain_right);
+}
+
+void apply_gain_sse(float* buffer, size_t count, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(buffer + i, _mm_mul_ps(_mm_loadu_ps(buffer + i), g));
+    }
+    apply_gain_scalar(buffer + i, count - i, gain);
+}
+
+void apply_gain_ramp_stereo_sse(float* buffer, size_t frames, float start_gain, float end_gain) {
+    if (frames == 0) return;
+    const float step = (end_gain - start_gain) / static_cast<float>(frames);
+    // Two frames per vector: lanes carry frame indices {0, 0, 1, 1} + n
+    const __m128 lane_offsets = _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f);
+    const __m128 v_step = _mm_set1_ps(step);
+    const __m128 v_start = _mm_set1_ps(start_gain);
+    size_t frame = 0;
+    for (; frame + 2 <= frames; frame += 2) {
+        const __m128 index = _mm_add_ps(_mm_set1_ps(static_cast<float>(frame)), lane_offsets);
+        const __m128 gain = _mm_add_ps(v_start, _mm_mul_ps(v_step, index));
+        float* p = buffer + 2 * frame;
+        _mm_storeu_ps(p, _mm_mul_ps(_mm_loadu_ps(p), gain));
+    }
+    for (; frame < frames; ++frame) {
+        const float gain = start_gain + step * static_cast<float>(frame);
+        buffer[2 * frame] *= gain;
+        buffer[2 * frame + 1] *= gain;
+    }
+}
+
+PeakRms peak_rms_stereo_sse(const float* interleaved, size_t frames) {
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 peak = _mm_setzero_ps();
+    __m128 sum = _mm_setzero_ps();
+    const size_t count = frames * 2;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_loadu_ps(interleaved + i);
+        peak = _mm_max_ps(peak, _mm_and_ps(x, abs_mask));
+        sum = _mm_add_ps(sum, _mm_mul_ps(x, x));
+    }
+
+    // Lanes alternate L, R, L, R
+    alignas(16) float p[4], s[4];
+    _mm_store_ps(p, peak);
+    _mm_store_ps(s, sum);
+    PeakRms tail = peak_rms_stereo_scalar(interleaved + i, (count - i) / 2);
+    PeakRms result;
+    result.peak_left = std::max({p[0], p[2], tail.peak_left});
+    result.peak_right = std::max({p[1], p[3], tail.peak_right});
+    result.sum_sq_left = s[0] + s[2] + tail.sum_sq_left;
+    result.sum_sq_right = s[1] + s[3] + tail.sum_sq_right;
+    return result;
+}
+
+void deinterleave_stereo_sse(const float* interleaved, float* left, float* right, size_t frames) {
+    size_t frame = 0;
+    for (; frame + 4 <= frames; frame += 4) {
+        const __m128 a = _mm_loadu_ps(interleaved + 2 * frame);      // L0 R0 L1 R1
+        const __m128 b = _mm_loadu_ps(interleaved + 2 * frame + 4);  // L2 R2 L3 R3
+        _mm_storeu_ps(left + frame, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + frame, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    deinterleave_stereo_scalar(interleaved + 2 * frame, left + frame, right + frame, frames - frame);
+}
+
+void interleave_stereo_sse(const float* left, const float* right, float* interleaved, size_t frames) {
+    size_t frame = 0;
+    for (; frame + 4 <= frames; frame += 4) {
+        const __m128 l = _mm_loadu_ps(left + frame);
+        const __m128 r = _mm_loadu_ps(right + frame);
+        _mm_storeu_ps(interleaved + 2 * frame, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(interleaved + 2 * frame + 4, _mm_unpackhi_ps(l, r));
+    }
+    interleave_stereo_scalar(left + frame, right + frame, interleaved + 2 * frame, frames - frame);
+}
+
+void soft_clip_sse(float* buffer, size_t count, float threshold) {
+    // Clipping is rare: test four samples at once and only run tanh on hits
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 t = _mm_set1_ps(threshold);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_and_ps(_mm_loadu_ps(buffer + i), abs_mask);
+        if (_mm_movemask_ps(_mm_cmpgt_ps(x, t)) != 0) {
+            soft_clip_scalar(buffer + i, 4, threshold);
+        }
+    }
+    soft_clip_scalar(buffer + i, count - i, threshold);
+}
+
+// The recursion is serial in time, so the four lanes are the parallelism:
+// one frame of all lanes per iteration, stage by stage over the block
+void biquad_cascade_x4_sse(float* lanes, size_t frames, BiquadStage4* stages, size_t stage_count) {
+    for (size_t s = 0; s < stage_count; ++s) {
+        BiquadStage4& stage = stages[s];
+        const __m128 b0 = _mm_load_ps(stage.b0);
+        const __m128 b1 = _mm_load_ps(stage.b1);
+        const __m128 b2 = _mm_load_ps(stage.b2);
+        const __m128 a1 = _mm_load_ps(stage.a1);
+        const __m128 a2 = _mm_load_ps(stage.a2);
+        __m128 z1 = _mm_load_ps(stage.z1);
+        __m128 z2 = _mm_load_ps(stage.z2);
+        for (size_t i = 0; i < frames; ++i) {
+            const __m128 x = _mm_loadu_ps(lanes + 4 * i);
+            const __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+            z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+            z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+            _mm_storeu_ps(lanes + 4 * i, y);
+        }
+        _mm_store_ps(stage.z1, z1);
+        _mm_store_ps(stage.z2, z2);
+        flush_biquad_state(stage);
+    }
+}
+
+const KernelTable kSseTable = {
+    "sse2",
+    mix_accumulate_sse,
+    mix_accumulate_stereo_sse,
+    apply_gain_sse,
+    apply_gain_ramp_stereo_sse,
+    peak_rms_stereo_sse,
+    deinterleave_stereo_sse,
+    interleave_stereo_sse,
+    soft_clip_sse,
+    biquad_cascade_x4_sse
+};
+
+#endif // DSP_HAVE_X86
+
+#if defined(DSP_HAVE_AVX2)
+
+// ===== AVX2 =====
+
+DSP_TARGET_AVX2
+void mix_accumulate_avx2(float* dst, const float* src, size_t count, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 d = _mm256_loadu_ps(dst + i);
+        d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+        _mm256_storeu_ps(dst + i, d);
+    }
+    mix_accumulate_scalar(dst + i, src + i, count - i, gain);
+}
+
+DSP_TARGET_AVX2
+void mix_accumulate_stereo_avx2(float* dst, const float* src, size_t frames,
+                                float gain_left, float gain_right) {
+    const __m256 g = _mm256_setr_ps(gain_left, gain_right, gain_left, gain_right,
+                                    gain_left, gain_right, gain_left, gain_right);
+    const size_t count = frames * 2;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 d = _mm256_loadu_ps(dst + i);
+        d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+        _mm256_storeu_ps(dst + i, d);
+    }
+    mix_accumulate_stereo_scalar(dst + i, src + i, (count - i) / 2, gain_left, gain_right);
+}
+
+DSP_TARGET_AVX2
+void apply_gain_avx2(float* buffer, size_t count, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(buffer + i, _mm256_mul_ps(_mm256_loadu_ps(buffer + i), g));
+    }
+    apply_gain_scalar(buffer + i, count - i, gain);
+}
+
+DSP_TARGET_AVX2
+void apply_gain_ramp_stereo_avx2(float* buffer, size_t frames, float start_gain, float end_gain) {
+    if (frames == 0) return;
+    const float step = (end_gain - start_gain) / static_cast<float>(frames);
+    const __m256 lane_offsets = _mm256_setr_ps(0.0f, 0.0f, 1.0f, 1.0f, 2.0f, 2.0f, 3.0f, 3.0f);
+    const __m256 v_step = _mm256_set1_ps(step);
+    const __m256 v_start = _mm256_set1_ps(start_gain);
+    size_t frame = 0;
+    for (; frame + 4 <= frames; frame += 4) {
+        const __m256 index = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(frame)), lane_offsets);
+        const __m256 gain = _mm256_add_ps(v_start, _mm256_mul_ps(v_step, index));
+        float* p = buffer + 2 * frame;
+        _mm256_storeu_ps(p, _mm256_mul_ps(_mm256_loadu_ps(p), gain));
+    }
+    for (; frame < frames; ++frame) {
+        const float gain = start_gain + step * static_cast<float>(frame);
+        buffer[2 * frame] *= gain;
+        buffer[2 * frame + 1] *= gain;
+    }
+}
+
+DSP_TARGET_AVX2
+PeakRms peak_rms_stereo_avx2(const float* interleaved, size_t frames) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 peak = _mm256_setzero_ps();
+    __m256 sum = _mm256_setzero_ps();
+    const size_t count = frames * 2;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x = _mm256_loadu_ps(interleaved + i);
+        peak = _mm256_max_ps(peak, _mm256_and_ps(x, abs_mask));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(x, x));
+    }
+
+    alignas(32) float p[8], s[8];
+    _mm256_store_ps(p, peak);
+    _mm256_store_ps(s, sum);
+    PeakRms result = peak_rms_stereo_scalar(interleaved + i, (count - i) / 2);
+    for (int lane = 0; lane < 8; lane += 2) {
+        result.peak_left = std::max(result.peak_left, p[lane]);
+        result.peak_right = std::max(result.peak_right, p[lane + 1]);
+        result.sum_sq_left += s[lane];
+        result.sum_sq_right += s[lane + 1];
+    }
+    return result;
+}
+
+DSP_TARGET_AVX2
+void soft_clip_avx2(float* buffer, size_t count, float threshold) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 t = _mm256_set1_ps(threshold);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x = _mm256_and_ps(_mm256_loadu_ps(buffer + i), abs_mask);
+        if (_mm256_movemask_ps(_mm256_cmp_ps(x, t, _CMP_GT_OQ)) != 0) {
+            soft_clip_scalar(buffer + i, 8, threshold);
+        }
+    }
+    soft_clip_scalar(buffer + i, count - i, threshold);
+}
+
+// (De)interleave is bound by memory bandwidth and a 4-lane biquad has no use
+// for wider registers, so AVX2 keeps the SSE2 versions of those
+const KernelTable kAvx2Table = {
+    "avx2",
+    mix_accumulate_avx2,
+    mix_accumulate_stereo_avx2,
+    apply_gain_avx2,
+    apply_gain_ramp_stereo_avx2,
+    peak_rms_stereo_avx2,
+    deinterleave_stereo_sse,
+    interleave_stereo_sse,
+    soft_clip_avx2,
+    biquad_cascade_x4_sse
+};
+
+#endif // DSP_HAVE_AVX2
+
+#if defined(DSP_HAVE_NEON)
+
+// ===== NEON =====
+
+void mix_accumulate_neon(float* dst, const float* src, size_t count, float gain) {
+    const float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t d = vld1q_f32(dst + i);
+        d = vaddq_f32(d, vmulq_f32(vld1q_f32(src + i), g));
+        vst1q_f32(dst + i, d);
+    }
+    mix_accumulate_scalar(dst + i, src + i, count - i, gain);
+}
+
+void mix_accumulate_stereo_neon(float* dst, const float* src, size_t frames,
+                                float gain_left, float gain_right) {
+    const float gains[4] = {gain_left, gain_right, gain_left, gain_right};
+    const float32x4_t g = vld1q_f32(gains);
+    const size_t count = frames * 2;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t d = vld1q_f32(dst + i);
+        d = vaddq_f32(d, vmulq_f32(vld1q_f32(src + i), g));
+        vst1q_f32(dst + i, d);
+    }
+    mix_accumulate_stereo_scalar(dst + i, src + i, (count - i) / 2, gain_left, gain_right);
+}
+
+void apply_gain_neon(float* buffer, size_t count, float gain) {
+    const float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(buffer + i, vmulq_f32(vld1q_f32(buffer + i), g));
+    }
+    apply_gain_scalar(buffer + i, count - i, gain);
+}
+
+void apply_gain_ramp_stereo_neon(float* buffer, size_t frames, float start_gain, float end_gain) {
+    if (frames == 0) return;
+    const float step = (end_gain - start_gain) / static_cast<float>(frames);
+    const float offsets[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    const float32x4_t lane_offsets = vld1q_f32(offsets);
+    const float32x4_t v_step = vdupq_n_f32(step);
+    const float32x4_t v_start = vdupq_n_f32(start_gain);
+    size_t frame = 0;
+    for (; frame + 4 <= frames; frame += 4) {
+        const float32x4_t index = vaddq_f32(vdupq_n_f32(static_cast<float>(frame)), lane_offsets);
+        const float32x4_t gain = vaddq_f32(v_start, vmulq_f32(v_step, index));
+        float32x4x2_t lr = vld2q_f32(buffer + 2 * frame);
+        lr.val[0] = vmulq_f32(lr.val[0], gain);
+        lr.val[1] = vmulq_f32(lr.val[1], gain);
+        vst2q_f32(buffer + 2 * frame, lr);
+    }
+    for (; frame < frames; ++frame) {
+        const float gain = start_gain + step * static_cast<float>(frame);
+        buffer[2 * frame] *= gain;
+        buffer[2 * frame + 1] *= gain;
+    }
+}
+
+PeakRms peak_rms_stereo_neon(const float* interleaved, size_t frames) {
+    float32x4_t peak_l = vdupq_n_f32(0.0f), peak_r = vdupq_n_f32(0.0f);
+    float32x4_t sum_l = vdupq_n_f32(0.0f), sum_r = vdupq_n_f32(0.0f);
+    size_t frame = 0;
+    for (; frame + 4 <= frames; frame += 4) {
+        const float32x4x2_t lr = vld2q_f32(interleaved + 2 * frame);
+        peak_l = vmaxq_f32(peak_l, vabsq_f32(lr.val[0]));
+        peak_r = vmaxq_f32(peak_r, vabsq_f32(lr.val[1]));
+        sum_l = vaddq_f32(sum_l, vmulq_f32(lr.val[0], lr.val[0]));
+        sum_r = vaddq_f32(sum_r, vmulq_f32(lr.val[1], lr.val[1]));
+    }
+
+    float pl[4], pr[4], sl[4], sr[4];
+    vst1q_f32(pl, peak_l);
+    vst1q_f32(pr, peak_r);
+    vst1q_f32(sl, sum_l);
+    vst1q_f32(sr, sum_r);
+    PeakRms result = peak_rms_stereo_scalar(interleaved + 2 * frame, frames - frame);
+    for (int lane = 0; lane < 4; ++lane) {
+        result.peak_left = std::max(result.peak_left, pl[lane]);
+        result.peak_right = std::max(result.peak_right, pr[lane]);
+        result.sum_sq_left += sl[lane];
+        result.sum_sq_right += sr[lane];
+    }
+    return result;
+}
+
+void deinterleave_stereo_neon(const float* interleaved, float* left, float* right, size_t frames) {
+    size_t frame = 0;
+    for (; frame + 4 <= frames; frame += 4) {
+        const float32x4x2_t lr = vld2q_f32(interleaved + 2 * frame);
+        vst1q_f32(left + frame, lr.val[0]);
+        vst1q_f32(right + frame, lr.val[1]);
+    }
+    deinterleave_stereo_scalar(interleaved + 2 * frame, left + frame, right + frame, frames - frame);
+}
+
+void interleave_stereo_neon(const float* left, const float* right, float* interleaved, size_t frames) {
+    size_t frame = 0;
+    for (; frame + 4 <= frames; frame += 4) {
+        float32x4x2_t lr;
+        lr.val[0] = vld1q_f32(left + frame);
+        lr.val[1] = vld1q_f32(right + frame);
+        vst2q_f32(interleaved + 2 * frame, lr);
+    }
+    interleave_stereo_scalar(left + frame, right + frame, interleaved + 2 * frame, frames - frame);
+}
+
+void soft_clip_neon(float* buffer, size_t count, float threshold) {
+    const float32x4_t t = vdupq_n_f32(threshold);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const uint32x4_t over = vcagtq_f32(vld1q_f32(buffer + i), t);
+        if (vmaxvq_u32(over) != 0) {
+            soft_clip_scalar(buffer + i, 4, threshold);
+        }
+    }
+    soft_clip_scalar(buffer + i, count - i, threshold);
+}
+
+void biquad_cascade_x4_neon(float* lanes, size_t frames, BiquadStage4* stages, size_t stage_count) {
+    for (size_t s = 0; s < stage_count; ++s) {
+        BiquadStage4& stage = stages[s];
+        const float32x4_t b0 = vld1q_f32(stage.b0);
+        const float32x4_t b1 = vld1q_f32(stage.b1);
+        const float32x4_t b2 = vld1q_f32(stage.b2);
+        const float32x4_t a1 = vld1q_f32(stage.a1);
+        const float32x4_t a2 = vld1q_f32(stage.a2);
+        float32x4_t z1 = vld1q_f32(stage.z1);
+        float32x4_t z2 = vld1q_f32(stage.z2);
+        for (size_t i = 0; i < frames; ++i) {
+            const float32x4_t x = vld1q_f32(lanes + 4 * i);
+            const float32x4_t y = vaddq_f32(vmulq_f32(b0, x), z1);
+            z1 = vaddq_f32(vsubq_f32(vmulq_f32(b1, x), vmulq_f32(a1, y)), z2);
+            z2 = vsubq_f32(vmulq_f32(b2, x), vmulq_f32(a2, y));
+            vst1q_f32(lanes + 4 * i, y);
+        }
+        vst1q_f32(stage.z1, z1);
+        vst1q_f32(stage.z2, z2);
+        flush_biquad_state(stage);
+    }
+}
+
+const KernelTable kNeonTable = {
+    "neon",
+    mix_accumulate_neon,
+    mix_accumulate_stereo_neon,
+    apply_gain_neon,
+    apply_gain_ramp_stereo_neon,
+    peak_rms_stereo_neon,
+    deinterleave_stereo_neon,
+    interleave_stereo_neon,
+    soft_clip_neon,
+    biquad_cascade_x4_neon
+};
+
+#endif // DSP_HAVE_NEON
+
+const KernelTable& select_kernels() {
+#if defined(DSP_HAVE_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return kAvx2Table;
+    }
+#endif
+#if defined(DSP_HAVE_X86)
+    return kSseTable;
+#elif defined(DSP_HAVE_NEON)
+    return kNeonTable;
+#else
+    return kScalarTable;
+#endif
+}
+
+} // namespace
+
+const KernelTable& kernels() {
+    static const KernelTable& table = select_kernels();
+    return table;
+}
+
+const KernelTable& scalar_kernels() {
+    return kScalarTable;
+}
+
+} // namespace dsp
@@ -0,0 +1,246 @@
+#include "dynamics_processor.hpp"
+#include "utils/decibels.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace OneStopRadio {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// One-pole coefficient reaching 1 - 1/e of a step in `ms`
+float time_coeff(float ms, int sample_rate) {
+    const double frames = ms * 0.001 * sample_rate;
+    return frames > 0.0 ? static_cast<float>(1.0 - std::exp(-1.0 / frames)) : 1.0f;
+}
+
+} // namespace
+
+DynamicsProcessor::DynamicsProcessor(const DynamicsOptions& options)
+    : options_(options),
+      channels_(std::min(std::max(options.channels, 1), kMaxChannels)),
+      delay_frames_(std::max<size_t>(1, static_cast<size_t>(options.lookahead_ms * 0.001f * options.sample_rate))),
+      detector_delay_(options.true_peak ? kHalfTaps : 0),
+      history_(static_cast<size_t>(channels_) * 2 * kTaps, 0.0f),
+      delay_(delay_frames_ * channels_, 0.0f),
+      delay_gain_(delay_frames_, 1.0f),
+      deque_value_(delay_frames_, 1.0f),
+      deque_frame_(delay_frames_, 0),
+      box_(delay_frames_, 1.0f),
+      box_sum_(static_cast<double>(delay_frames_)) {
+    // Hann-windowed sinc for the three in-between phases, each normalised to unity gain at DC.
+    // Phase p estimates the signal p/4 of a sample after the centre tap.
+    for (int p = 1; p < kOversample; ++p) {
+        const double fraction = static_cast<double>(p) / kOversample;
+        double sum = 0.0;
+        double taps[kTaps];
+        for (size_t i = 0; i < kTaps; ++i) {
+            const double d = static_cast<double>(i) - static_cast<double>(kHalfTaps - 1) - fraction;
+            const double sinc = std::sin(kPi * d) / (kPi * d);
+            const double window = 0.5 * (1.0 + std::cos(kPi * d / kHalfTaps));
+            taps[i] = sinc * window;
+            sum += taps[i];
+        }
+        for (size_t i = 0; i < kTaps; ++i) {
+            phase_coeffs_[p - 1][i] = static_cast<float>(taps[i] / sum);
+        }
+    }
+
+    set_limiter(options_.limiter_enabled, options_.ceiling_db, options_.limiter_release_ms);
+    set_compressor(options_.compressor_enabled, options_.threshold_db, options_.ratio);
+    set_compressor_timing(options_.attack_ms, options_.release_ms);
+    set_makeup_gain(options_.makeup_db);
+    knee_db_ = std::max(0.0f, options_.knee_db);
+}
+
+void DynamicsProcessor::set_limiter(bool enabled, float ceiling_db, float release_ms) {
+    options_.limiter_enabled = enabled;
+    options_.ceiling_db = std::min(ceiling_db, 0.0f);
+    options_.limiter_release_ms = std::max(release_ms, 1.0f);
+    ceiling_ = Decibels::to_gain(options_.ceiling_db);
+    limiter_release_coeff_ = time_coeff(options_.limiter_release_ms, options_.sample_rate);
+}
+
+void DynamicsProcessor::set_compressor(bool enabled, float threshold_db, float ratio) {
+    options_.compressor_enabled = enabled;
+    options_.threshold_db = std::min(threshold_db, 0.0f);
+    options_.ratio = std::max(ratio, 1.0f);
+    threshold_db_ = options_.threshold_db;
+    slope_ = 1.0f - 1.0f / options_.ratio;
+}
+
+void DynamicsProcessor::set_compressor_timing(float attack_ms, float release_ms) {
+    options_.attack_ms = std::max(attack_ms, 0.0f);
+    options_.release_ms = std::max(release_ms, 1.0f);
+    attack_coeff_ = time_coeff(options_.attack_ms, options_.sample_rate);
+    release_coeff_ = time_coeff(options_.release_ms, options_.sample_rate);
+}
+
+void DynamicsProcessor::set_makeup_gain(float gain_db) {
+    options_.makeup_db = std::min(std::max(gain_db, 0.0f), 24.0f);
+    makeup_db_ = options_.makeup_db;
+}
+
+void DynamicsProcessor::reset() {
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    std::fill(delay_.begin(), delay_.end(), 0.0f);
+    std::fill(delay_gain_.begin(), delay_gain_.end(), 1.0f);
+    std::fill(box_.begin(), box_.end(), 1.0f);
+    box_sum_ = static_cast<double>(delay_frames_);
+    history_pos_ = delay_pos_ = box_pos_ = 0;
+    deque_head_ = deque_size_ = 0;
+    frame_ = 0;
+    released_ = 1.0f;
+    reduction_db_ = 0.0f;
+}
+
+void DynamicsProcessor::process(float* interleaved, size_t frames) {
+    float* channels[kMaxChannels];
+    for (int c = 0; c < channels_; ++c) {
+        channels[c] = interleaved + c;
+    }
+    process_frames(channels, static_cast<size_t>(channels_), frames);
+}
+
+void DynamicsProcessor::process_planar(float* left, float* right, size_t frames) {
+    if (channels_ != 2) {
+        return;
+    }
+    float* channels[kMaxChannels] = {left, right};
+    process_frames(channels, 1, frames);
+}
+
+DynamicsStats DynamicsProcessor::stats() const {
+    DynamicsStats stats;
+    stats.compressor_reduction_db = stat_compressor_db_.load(std::memory_order_relaxed);
+    stats.limiter_reduction_db = stat_limiter_db_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void DynamicsProcessor::process_frames(float* const* channels, size_t stride, size_t frames) {
+    const bool limiter = options_.limiter_enabled;
+    const bool compressor = options_.compressor_enabled;
+    const float inv_window = 1.0f / static_cast<float>(delay_frames_);
+    float max_reduction_db = 0.0f;
+    float min_limit = 1.0f;
+
+    for (size_t i = 0; i < frames; ++i) {
+        const size_t offset = i * stride;
+        float centre[kMaxChannels];
+        const float peak = detect(channels, offset, centre);
+
+        // Compressor; once disabled it releases back to unity rather than jumping
+        const float target_db = compressor ? compressor_gain_db(Decibels::to_db(peak)) : 0.0f;
+        if (target_db != reduction_db_) {
+            const float coeff = target_db > reduction_db_ ? attack_coeff_ : release_coeff_;
+            reduction_db_ += (target_db - reduction_db_) * coeff;
+            if (std::abs(target_db - reduction_db_) < 1e-4f) {
+                reduction_db_ = target_db;
+            }
+        }
+        const float gain_db = makeup_db_ - reduction_db_;
+        const float compressor_gain = gain_db != 0.0f ? Decibels::to_gain(gain_db) : 1.0f;
+        max_reduction_db = std::max(max_reduction_db, reduction_db_);
+
+        // Gain that keeps this frame at the ceiling, held over the window,
+        // released, then averaged over the window
+        const float level = peak * compressor_gain;
+        const float needed = limiter && level > ceiling_ ? ceiling_ / level : 1.0f;
+        const float held = hold_minimum(needed);
+        released_ = held < released_ ? held : released_ + (held - released_) * limiter_release_coeff_;
+        box_sum_ += static_cast<double>(released_) - box_[box_pos_];
+        box_[box_pos_] = released_;
+        if (++box_pos_ == delay_frames_) {
+            // Resum once per window so rounding never accumulates
+            box_pos_ = 0;
+            box_sum_ = 0.0;
+            for (float value : box_) {
+                box_sum_ += value;
+            }
+        }
+        const float limit = std::min(1.0f, static_cast<float>(box_sum_) * inv_window);
+        min_limit = std::min(min_limit, limit);
+
+        // Into the delay line; out comes the frame the window has looked ahead of
+        float* slot = delay_.data() + delay_pos_ * channels_;
+        for (int c = 0; c < channels_; ++c) {
+            slot[c] = centre[c];
+        }
+        delay_gain_[delay_pos_] = compressor_gain;
+        delay_pos_ = delay_pos_ + 1 == delay_frames_ ? 0 : delay_pos_ + 1;
+
+        const float* oldest = delay_.data() + delay_pos_ * channels_;
+        const float gain = delay_gain_[delay_pos_] * limit;
+        for (int c = 0; c < channels_; ++c) {
+            float out = oldest[c] * gain;
+            if (limiter) {
+                out = std::min(std::max(out, -ceiling_), ceiling_);
+            }
+            channels[c][offset] = out;
+        }
+    }
+
+    stat_compressor_db_.store(max_reduction_db, std::memory_order_relaxed);
+    stat_limiter_db_.store(-Decibels::to_db(min_limit), std::memory_order_relaxed);
+}
+
+// Stereo-linked peak of the frame detector_delay_ frames back, including
+// the inter-sample peaks after it when true_peak is set
+float DynamicsProcessor::detect(float* const* channels, size_t offset, float* centre) {
+    const bool interpolate = options_.true_peak && (options_.limiter_enabled || options_.compressor_enabled);
+    float peak = 0.0f;
+    for (int c = 0; c < channels_; ++c) {
+        float* history = history_.data() + static_cast<size_t>(c) * 2 * kTaps;
+        const float sample = channels[c][offset];
+        history[history_pos_] = sample;
+        history[history_pos_ + kTaps] = sample;
+
+        // Oldest to newest; the newest frame is window[kTaps - 1]
+        const float* window = history + history_pos_ + 1;
+        centre[c] = options_.true_peak ? window[kHalfTaps - 1] : sample;
+        peak = std::max(peak, std::abs(centre[c]));
+        if (interpolate) {
+            for (int p = 0; p < kOversample - 1; ++p) {
+                float y = 0.0f;
+                for (size_t k = 0; k < kTaps; ++k) {
+                    y += window[k] * phase_coeffs_[p][k];
+                }
+                peak = std::max(peak, std::abs(y));
+            }
+        }
+    }
+    history_pos_ = history_pos_ + 1 == kTaps ? 0 : history_pos_ + 1;
+    return peak;
+}
+
+// Gain reduction in dB for a detector level, with a quadratic soft knee
+float DynamicsProcessor::compressor_gain_db(float level_db) const {
+    const float over = level_db - threshold_db_;
+    if (knee_db_ > 0.0f && 2.0f * std::abs(over) <= knee_db_) {
+        const float x = over + 0.5f * knee_db_;
+        return slope_ * x * x / (2.0f * knee_db_);
+    }
+    return over > 0.0f ? slope_ * over : 0.0f;
+}
+
+// Minimum of the last delay_frames_ values: a monotonic deque in a ring,
+// increasing from the front, so each value is pushed and popped once
+float DynamicsProcessor::hold_minimum(float gain) {
+    const size_t capacity = delay_frames_;
+    while (deque_size_ > 0 && deque_frame_[deque_head_] + capacity <= frame_) {
+        deque_head_ = deque_head_ + 1 == capacity ? 0 : deque_head_ + 1;
+        --deque_size_;
+    }
+    while (deque_size_ > 0 && deque_value_[(deque_head_ + deque_size_ - 1) % capacity] >= gain) {
+        --deque_size_;
+    }
+    const size_t back = (deque_head_ + deque_size_) % capacity;
+    deque_value_[back] = gain;
+    deque_frame_[back] = frame_;
+    ++deque_size_;
+    ++frame_;
+    return deque_value_[deque_head_];
+}
+
+} // namespace OneStopRadio
@@ -0,0 +1,63 @@
+#include "fft_plan_registry.hpp"
+#include <cstdio>
+#include <iostream>
+
+FftPlanRegistry& FftPlanRegistry::instance() {
+    // Never destroyed, so plans stay valid for FFT users with static storage
+    static FftPlanRegistry* registry = new FftPlanRegistry();
+    return *registry;
+}
+
+fftwf_plan FftPlanRegistry::real_forward(int n, unsigned flags) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto key = std::make_pair(n, flags);
+    auto it = real_forward_plans_.find(key);
+    if (it != real_forward_plans_.end()) {
+        return it->second;
+    }
+
+    // Measuring planners overwrite their arrays, so plan on scratch buffers
+    float* in = fftwf_alloc_real(n);
+    fftwf_complex* out = fftwf_alloc_complex(n / 2 + 1);
+    fftwf_plan plan = fftwf_plan_dft_r2c_1d(n, in, out, flags);
+    fftwf_free(in);
+    fftwf_free(out);
+
+    if (!plan) {
+        std::cerr << "FftPlanRegistry: failed to plan r2c transform of size " << n << std::endl;
+        return nullptr;
+    }
+
+    real_forward_plans_.emplace(key, plan);
+    wisdom_dirty_ = true;
+    return plan;
+}
+
+bool FftPlanRegistry::load_wisdom(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fftwf_import_wisdom_from_filename(path.c_str()) != 0;
+}
+
+bool FftPlanRegistry::save_wisdom(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!wisdom_dirty_) {
+        return true;
+    }
+
+    // A crash mid-write must not leave wisdom FFTW would refuse to import
+    const std::string temp_path = path + ".tmp";
+    if (!fftwf_export_wisdom_to_filename(temp_path.c_str()) ||
+        std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    wisdom_dirty_ = false;
+    return true;
+}
+
+size_t FftPlanRegistry::plan_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return real_forward_plans_.size();
+}
@@ -0,0 +1,308 @@
+#include "http_router.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+struct HttpRouter::Node {
+    enum class Kind {
+        STATIC,
+        PARAM_INT,      // Ordered by precedence among parameter children
+        PARAM_STR,
+        CATCH_ALL
+    };
+
+    Kind kind = Kind::STATIC;
+    std::string label;                  // Literal text ("a/b" once merged) or parameter name
+    std::string_view first_segment;     // Of label, for sibling search; set by compile()
+
+    std::vector<std::unique_ptr<Node>> statics;
+    std::vector<std::unique_ptr<Node>> params;
+    std::vector<std::pair<std::string, HttpRoute>> methods;   // "" = any method
+};
+
+namespace {
+
+bool is_integer(std::string_view segment) {
+    size_t i = (!segment.empty() && (segment[0] == '-' || segment[0] == '+')) ? 1 : 0;
+    if (i == segment.size()) {
+        return false;
+    }
+    for (; i < segment.size(); ++i) {
+        if (segment[i] < '0' || segment[i] > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Strip the leading slash and a single trailing slash
+std::string_view trim_slashes(std::string_view path) {
+    if (!path.empty() && path.front() == '/') {
+        path.remove_prefix(1);
+    }
+    if (!path.empty() && path.back() == '/') {
+        path.remove_suffix(1);
+    }
+    return path;
+}
+
+} // namespace
+
+HttpRouter::HttpRouter() : root_(std::make_unique<Node>()) {}
+
+HttpRouter::~HttpRouter() = default;
+
+void HttpRouter::add(std::string_view method, const std::string& pattern, HttpRoute route) {
+    if (compiled_) {
+        throw std::logic_error("HttpRouter: add() after compile(): " + pattern);
+    }
+    if (pattern.empty() || pattern.front() != '/') {
+        throw std::invalid_argument("HttpRouter: pattern must start with '/': " + pattern);
+    }
+
+    Node* node = root_.get();
+    std::string_view rest = trim_slashes(pattern);
+    size_t param_count = 0;
+
+    while (!rest.empty()) {
+        const size_t slash = rest.find('/');
+        const std::string_view segment = rest.substr(0, slash);
+        rest = slash == std::string_view::npos ? std::string_view() : rest.substr(slash + 1);
+
+        if (segment.empty()) {
+            throw std::invalid_argument("HttpRouter: empty segment in pattern: " + pattern);
+        }
+
+        if (segment.front() != '{') {
+            auto it = std::find_if(node->statics.begin(), node->statics.end(),
+                                   [&](const std::unique_ptr<Node>& child) { return child->label == segment; });
+            if (it == node->statics.end()) {
+                node->statics.push_back(std::make_unique<Node>());
+                node->statics.back()->label = std::string(segment);
+                it = std::prev(node->statics.end());
+            }
+            node = it->get();
+            continue;
+        }
+
+        if (segment.back() != '}' || ++param_count > kMaxParams) {
+            throw std::invalid_argument("HttpRouter: bad or too many parameters in pattern: " + pattern);
+        }
+
+        const std::string_view spec = segment.substr(1, segment.size() - 2);
+        const size_t colon = spec.find(':');
+        const std::string_view name = spec.substr(0, colon);
+        const std::string_view type = colon == std::string_view::npos ? "str" : spec.substr(colon + 1);
+
+        Node::Kind kind;
+        if (type == "str") {
+            kind = Node::Kind::PARAM_STR;
+        } else if (type == "int") {
+            kind = Node::Kind::PARAM_INT;
+        } else if (type == "path") {
+            kind = Node::Kind::CATCH_ALL;
+        } else {
+            throw std::invalid_argument("HttpRouter: unknown parameter type in pattern: " + pattern);
+        }
+
+        if (name.empty() || (kind == Node::Kind::CATCH_ALL && !rest.empty())) {
+            throw std::invalid_argument("HttpRouter: bad parameter in pattern: " + pattern);
+        }
+
+        auto it = std::find_if(node->params.begin(), node->params.end(),
+                               [&](const std::unique_ptr<Node>& child) { return child->kind == kind; });
+        if (it == node->params.end()) {
+            node->params.push_back(std::make_unique<Node>());
+            node->params.back()->kind = kind;
+            node->params.back()->label = std::string(name);
+            it = std::prev(node->params.end());
+        } else if ((*it)->label != name) {
+            throw std::invalid_argument("HttpRouter: conflicting parameter names in pattern: " + pattern);
+        }
+        node = it->get();
+    }
+
+    auto existing = std::find_if(node->methods.begin(), node->methods.end(),
+                                 [&](const auto& entry) { return entry.first == method; });
+    if (existing != node->methods.end()) {
+        existing->second = std::move(route);
+    } else {
+        node->methods.emplace_back(std::string(method), std::move(route));
+    }
+}
+
+void HttpRouter::compile() {
+    if (!compiled_) {
+        compile_node(*root_);
+        compiled_ = true;
+    }
+}
+
+void HttpRouter::compile_node(Node& node) {
+    for (auto& child : node.statics) {
+        // Merge literal chains ("api" -> "radio" -> "deck") into one edge
+        while (child->methods.empty() && child->params.empty() && child->statics.size() == 1) {
+            std::unique_ptr<Node> only = std::move(child->statics.front());
+            child->label += '/';
+            child->label += only->label;
+            child->statics = std::move(only->statics);
+            child->params = std::move(only->params);
+            child->methods = std::move(only->methods);
+        }
+        compile_node(*child);
+    }
+
+    for (auto& child : node.statics) {
+        const std::string_view label = child->label;
+        child->first_segment = label.substr(0, label.find('/'));
+    }
+    std::sort(node.statics.begin(), node.statics.end(),
+              [](const std::unique_ptr<Node>& a, const std::unique_ptr<Node>& b) {
+                  return a->first_segment < b->first_segment;
+              });
+
+    std::sort(node.params.begin(), node.params.end(),
+              [](const std::unique_ptr<Node>& a, const std::unique_ptr<Node>& b) { return a->kind < b->kind; });
+    for (auto& child : node.params) {
+        compile_node(*child);
+    }
+}
+
+HttpRouter::Match HttpRouter::match(std::string_view method, std::string_view target) const {
+    Match result;
+
+    const size_t question = target.find('?');
+    result.path = target.substr(0, question);
+    if (question != std::string_view::npos) {
+        result.query = target.substr(question + 1);
+    }
+
+    bool method_mismatch = false;
+    if (compiled_ && match_node(*root_, trim_slashes(result.path), method, result, method_mismatch)) {
+        result.status = MatchStatus::FOUND;
+    } else {
+        result.param_count = 0;
+        result.status = method_mismatch ? MatchStatus::METHOD_NOT_ALLOWED : MatchStatus::NOT_FOUND;
+    }
+    return result;
+}
+
+bool HttpRouter::match_node(const Node& node, std::string_view rest, std::string_view method,
+                            Match& match, bool& method_mismatch) {
+    if (rest.empty()) {
+        match.route = find_method(node, method);
+        if (!match.route && !node.methods.empty()) {
+            method_mismatch = true;
+        }
+        if (match.route) {
+            return true;
+        }
+        // A catch-all may still match an empty remainder below
+    }
+
+    const size_t slash = rest.find('/');
+    const std::string_view segment = rest.substr(0, slash);
+
+    if (!rest.empty()) {
+        auto it = std::lower_bound(node.statics.begin(), node.statics.end(), segment,
+                                   [](const std::unique_ptr<Node>& child, std::string_view value) {
+                                       return child->first_segment < value;
+                                   });
+        if (it != node.statics.end() && (*it)->first_segment == segment) {
+            const std::string& label = (*it)->label;
+            if (rest.compare(0, label.size(), label) == 0 &&
+                (rest.size() == label.size() || rest[label.size()] == '/')) {
+                const std::string_view next = rest.size() == label.size()
+                    ? std::string_view() : rest.substr(label.size() + 1);
+                if (match_node(**it, next, method, match, method_mismatch)) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    for (const auto& child : node.params) {
+        if (match.param_count == kMaxParams) {
+            break;
+        }
+
+        if (child->kind == Node::Kind::CATCH_ALL) {
+            const HttpRoute* route = find_method(*child, method);
+            if (route) {
+                match.params[match.param_count++] = {child->label, rest};
+                match.route = route;
+                return true;
+            }
+            method_mismatch = method_mismatch || !child->methods.empty();
+            continue;
+        }
+
+        if (segment.empty() || (child->kind == Node::Kind::PARAM_INT && !is_integer(segment))) {
+            continue;
+        }
+
+        match.params[match.param_count++] = {child->label, segment};
+        const std::string_view next = slash == std::string_view::npos ? std::string_view() : rest.substr(slash + 1);
+        if (match_node(*child, next, method, match, method_mismatch)) {
+            return true;
+        }
+        --match.param_count;
+    }
+
+    return false;
+}
+
+const HttpRoute* HttpRouter::find_method(const Node& node, std::string_view method) {
+    const HttpRoute* any = nullptr;
+    for (const auto& [name, route] : node.methods) {
+        if (name == method) {
+            return &route;
+        }
+        if (name.empty()) {
+            any = &route;
+        }
+    }
+    return any;
+}
+
+std::string HttpRouter::url_decode(std::string_view encoded, bool plus_as_space) {
+    std::string decoded;
+    decoded.reserve(encoded.size());
+
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        const char c = encoded[i];
+        if (c == '%' && i + 2 < encoded.size() && hex_value(encoded[i + 1]) >= 0 && hex_value(encoded[i + 2]) >= 0) {
+            decoded.push_back(static_cast<char>(hex_value(encoded[i + 1]) * 16 + hex_value(encoded[i + 2])));
+            i += 2;
+        } else if (c == '+' && plus_as_space) {
+            decoded.push_back(' ');
+        } else {
+            decoded.push_back(c);
+        }
+    }
+    return decoded;
+}
+
+void HttpRouter::parse_query(std::string_view query, std::map<std::string, std::string>& out) {
+    while (!query.empty()) {
+        const size_t amp = query.find('&');
+        const std::string_view pair = query.substr(0, amp);
+        query = amp == std::string_view::npos ? std::string_view() : query.substr(amp + 1);
+
+        if (pair.empty()) {
+            continue;
+        }
+
+        const size_t equals = pair.find('=');
+        const std::string_view key = pair.substr(0, equals);
+        const std::string_view value = equals == std::string_view::npos ? std::string_view() : pair.substr(equals + 1);
+        out[url_decode(key, true)] = url_decode(value, true);
+    }
+}
@@ -1,171 +1,461 @@
 #include "http_server.hpp"
+#include "http_router.hpp"
+#include "trace_profiler.hpp"
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/config.hpp>
+#include <algorithm>
+#include <cctype>
+#include <deque>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
 
 namespace beast = boost::beast;
 namespace http = beast::http;
 namespace net = boost::asio;
 using tcp = net::ip::tcp;
 
+namespace {
+
+using Response = http::response<http::string_body>;
+
+bool iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+// If-None-Match uses the weak comparison: W/"x" matches "x"
+bool etag_matches(const HttpRequest& request, std::string_view etag) {
+    for (const auto& [name, value] : request.headers) {
+        if (!iequals(name, "If-None-Match")) {
+            continue;
+        }
+        std::string_view list = value;
+        while (!list.empty()) {
+            const size_t comma = list.find(',');
+            std::string_view candidate = list.substr(0, comma);
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+            while (!candidate.empty() && (candidate.front() == ' ' || candidate.front() == '\t')) {
+                candidate.remove_prefix(1);
+            }
+            while (!candidate.empty() && (candidate.back() == ' ' || candidate.back() == '\t')) {
+                candidate.remove_suffix(1);
+            }
+            if (candidate.substr(0, 2) == "W/") {
+                candidate.remove_prefix(2);
+            }
+            if (candidate == "*" || candidate == etag) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace
+
 class HttpServer::Impl {
 public:
-    Impl(int port) : acceptor_(ioc_), socket_(ioc_), port_(port) {}
-    
-    void add_route(const std::string& path, RouteHandler handler) {
-        routes_[path] = std::move(handler);
+    Impl(int port, const HttpServerOptions& options)
+        : options_(options),
+          workers_(std::max<size_t>(options.worker_threads, 1)),
+          acceptor_(net::make_strand(ioc_)),
+          port_(port) {}
+
+    ~Impl() {
+        // Worker jobs post back into ioc_, so they must finish before it goes away
+        ioc_.stop();
+        workers_.stop();
+        workers_.join();
+    }
+
+    void add_route(const std::string& method, const std::string& path, RouteHandler handler,
+                   RouteExecution execution, const std::string& content_type) {
+        router_.add(method, path, HttpRoute{std::move(handler), nullptr, execution, content_type});
+    }
+
+    void add_snapshot_route(const std::string& path, SnapshotHandler handler, RouteExecution execution) {
+        HttpRoute route;
+        route.snapshot = std::move(handler);
+        route.execution = execution;
+        router_.add(std::string_view(), path, std::move(route));
     }
-    
+
     void run() {
         try {
+            router_.compile();
+
             auto const address = net::ip::make_address("0.0.0.0");
-            
+
             // Open the acceptor
             acceptor_.open(tcp::v4());
             acceptor_.set_option(net::socket_base::reuse_address(true));
             acceptor_.bind({address, static_cast<unsigned short>(port_)});
             acceptor_.listen(net::socket_base::max_listen_connections);
-            
+
             // Start accepting connections
             do_accept();
-            
-            // Run the I/O service
+
+            // Run the I/O service on every I/O thread, including this one
+            size_t thread_count = options_.io_threads;
+            if (thread_count == 0) {
+                thread_count = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            std::vector<std::thread> threads;
+            threads.reserve(thread_count - 1);
+            for (size_t i = 1; i < thread_count; ++i) {
+                threads.emplace_back([this] {
+                    TRACE_THREAD_NAME("http_io");
+                    ioc_.run();
+                });
+            }
+            TRACE_THREAD_NAME("http_io");
             ioc_.run();
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
         } catch (std::exception const& e) {
             std::cerr << "HTTP Server Error: " << e.what() << std::endl;
         }
     }
-    
+
     void stop() {
         ioc_.stop();
     }
 
 private:
     void do_accept() {
+        // Each connection gets its own strand
         acceptor_.async_accept(
-            socket_,
-            [this](beast::error_code ec) {
+            net::make_strand(ioc_),
+            [this](beast::error_code ec, tcp::socket socket) {
                 if (!ec) {
-                    std::make_shared<HttpSession>(std::move(socket_), routes_)->run();
+                    std::make_shared<HttpSession>(std::move(socket), router_, workers_, options_)->run();
                 }
                 do_accept();
             });
     }
-    
+
+    /**
+     * One connection. Requests are read ahead while earlier responses are
+     * still being produced, up to max_pipelined_requests, and responses are
+     * written strictly in request order.
+     */
     class HttpSession : public std::enable_shared_from_this<HttpSession> {
     public:
-        HttpSession(tcp::socket&& socket, std::map<std::string, RouteHandler>& routes)
-            : stream_(std::move(socket)), routes_(routes) {}
-        
+        HttpSession(tcp::socket&& socket, const HttpRouter& router, net::thread_pool& workers,
+                    const HttpServerOptions& options)
+            : stream_(std::move(socket)),
+              idle_timer_(stream_.get_executor()),
+              router_(router),
+              workers_(workers),
+              options_(options) {}
+
         void run() {
-            do_read();
+            // Start on the session's strand
+            net::dispatch(stream_.get_executor(),
+                          [self = shared_from_this()] {
+                              self->update_idle_timer();
+                              self->do_read();
+                          });
         }
-        
+
     private:
+        // A pipelined request; response stays null until its handler finishes
+        struct Slot {
+            std::shared_ptr<Response> response;
+        };
+
         void do_read() {
-            req_ = {};
-            stream_.expires_after(std::chrono::seconds(30));
-            
-            http::async_read(stream_, buffer_, req_,
+            if (reading_ || closing_ || pipeline_.size() >= options_.max_pipelined_requests) {
+                return;
+            }
+
+            reading_ = true;
+            parser_.emplace();
+
+            http::async_read(stream_, buffer_, *parser_,
                 [self = shared_from_this()](beast::error_code ec, std::size_t bytes_transferred) {
                     boost::ignore_unused(bytes_transferred);
-                    if (!ec) {
-                        self->handle_request();
-                    }
+                    self->on_read(ec);
                 });
         }
-        
-        void handle_request() {
-            // CORS headers
-            auto const cors_headers = [](auto& response) {
-                response.set(http::field::access_control_allow_origin, "*");
-                response.set(http::field::access_control_allow_methods, "GET, POST, PUT, DELETE, OPTIONS");
-                response.set(http::field::access_control_allow_headers, "Content-Type, Authorization");
-            };
-            
+
+        void on_read(beast::error_code ec) {
+            reading_ = false;
+
+            if (ec == http::error::end_of_stream) {
+                // Client finished sending; answer what is pending, then close
+                closing_ = true;
+                if (pipeline_.empty()) {
+                    do_close();
+                }
+                return;
+            }
+            if (ec) {
+                return;
+            }
+
+            handle_request(parser_->release());
+
+            // Keep reading behind the request we just queued
+            do_read();
+        }
+
+        void handle_request(http::request<http::string_body>&& req) {
+            auto slot = std::make_shared<Slot>();
+            pipeline_.push_back(slot);
+            update_idle_timer();
+
+            ++requests_served_;
+            const bool keep_alive = req.keep_alive() &&
+                                    requests_served_ < options_.max_requests_per_connection;
+            if (!keep_alive) {
+                closing_ = true;
+            }
+
             // Handle OPTIONS (CORS preflight)
-            if (req_.method() == http::verb::options) {
-                http::response<http::string_body> res{http::status::ok, req_.version()};
-                cors_headers(res);
-                res.set(http::field::content_type, "text/plain");
-                res.prepare_payload();
-                send_response(std::move(res));
+            if (req.method() == http::verb::options) {
+                auto res = std::make_shared<Response>(http::status::ok, req.version());
+                set_cors_headers(*res);
+                res->set(http::field::content_type, "text/plain");
+                res->keep_alive(keep_alive);
+                res->prepare_payload();
+                complete(slot, res);
                 return;
             }
-            
-            // Find route handler
-            std::string path = std::string(req_.target());
-            auto it = routes_.find(path);
-            
-            if (it != routes_.end()) {
-                // Build request object
-                HttpRequest request;
-                request.method = std::string(req_.method_string());
-                request.path = path;
-                request.body = req_.body();
-                
-                // Call handler
-                std::string response_body = it->second(request);
-                
-                // Create response
-                http::response<http::string_body> res{http::status::ok, req_.version()};
-                cors_headers(res);
-                res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
-                res.set(http::field::content_type, "application/json");
-                res.body() = response_body;
-                res.prepare_payload();
-                
-                send_response(std::move(res));
-            } else {
-                // 404 Not Found
-                http::response<http::string_body> res{http::status::not_found, req_.version()};
-                cors_headers(res);
-                res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
-                res.set(http::field::content_type, "application/json");
-                res.body() = R"({"error":"Not Found"})";
-                res.prepare_payload();
-                
-                send_response(std::move(res));
-            }
-        }
-        
-        void send_response(http::response<http::string_body> response) {
-            auto sp = std::make_shared<http::response<http::string_body>>(std::move(response));
-            res_ = sp;
-            
-            http::async_write(stream_, *sp,
-                [self = shared_from_this()](beast::error_code ec, std::size_t bytes_transferred) {
+
+            // Find route handler; the match holds views into req.target()
+            const auto target = req.target();
+            const auto method = req.method_string();
+            const HttpRouter::Match match = router_.match(std::string_view(method.data(), method.size()),
+                                                          std::string_view(target.data(), target.size()));
+
+            if (match.status == HttpRouter::MatchStatus::NOT_FOUND) {
+                complete(slot, make_response(http::status::not_found, req.version(), keep_alive,
+                                             R"({"error":"Not Found"})"));
+                return;
+            }
+            if (match.status == HttpRouter::MatchStatus::METHOD_NOT_ALLOWED) {
+                complete(slot, make_response(http::status::method_not_allowed, req.version(), keep_alive,
+                                             R"({"error":"Method Not Allowed"})"));
+                return;
+            }
+
+            // Build request object
+            auto request = std::make_shared<HttpRequest>();
+            request->method = std::string(method);
+            request->path = std::string(match.path);
+            HttpRouter::parse_query(match.query, request->params);
+            for (size_t i = 0; i < match.param_count; ++i) {
+                const auto& [name, value] = match.params[i];
+                request->path_params.emplace(std::string(name), HttpRouter::url_decode(value));
+            }
+            request->body = std::move(req.body());
+            for (const auto& field : req) {
+                request->headers.emplace(std::string(field.name_string()), std::string(field.value()));
+            }
+
+            const HttpRoute& route = *match.route;
+            const unsigned version = req.version();
+
+            if (route.execution == RouteExecution::IO_THREAD) {
+                complete(slot, invoke(route, *request, version, keep_alive));
+                return;
+            }
+
+            // Slow handler: run it on the worker pool and resume on our strand
+            net::post(workers_, [self = shared_from_this(), slot, request, &route, version, keep_alive] {
+                TRACE_THREAD_NAME("http_worker");
+                auto res = invoke(route, *request, version, keep_alive);
+                net::post(self->stream_.get_executor(), [self, slot, res] {
+                    self->complete(slot, res);
+                });
+            });
+        }
+
+        static std::shared_ptr<Response> invoke(const HttpRoute& route, const HttpRequest& request,
+                                                unsigned version, bool keep_alive) {
+            TRACE_SCOPE("http_handler");
+            try {
+                if (route.snapshot) {
+                    return snapshot_response(route, route.snapshot(request), request, version, keep_alive);
+                }
+                return make_response(http::status::ok, version, keep_alive, route.handler(request),
+                                     route.content_type);
+            } catch (const std::exception& e) {
+                return make_response(http::status::internal_server_error, version, keep_alive,
+                                     std::string(R"({"error":"Internal Server Error","message":")") +
+                                     e.what() + "\"}");
+            }
+        }
+
+        static std::shared_ptr<Response> make_response(http::status status, unsigned version,
+                                                       bool keep_alive, std::string body,
+                                                       const std::string& content_type = "application/json") {
+            auto res = std::make_shared<Response>(status, version);
+            set_cors_headers(*res);
+            res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
+            res->set(http::field::content_type, content_type);
+            res->keep_alive(keep_alive);
+            res->body() = std::move(body);
+            res->prepare_payload();
+            return res;
+        }
+
+        // The body is copied into the response; the snapshot stays shared
+        static std::shared_ptr<Response> snapshot_response(const HttpRoute& route,
+                                                           const std::shared_ptr<const HttpSnapshot>& snapshot,
+                                                           const HttpRequest& request, unsigned version,
+                                                           bool keep_alive) {
+            if (!snapshot) {
+                return make_response(http::status::internal_server_error, version, keep_alive,
+                                     R"({"error":"Internal Server Error"})");
+            }
+            const bool not_modified = !snapshot->etag.empty() && etag_matches(request, snapshot->etag);
+            auto res = make_response(not_modified ? http::status::not_modified : http::status::ok, version,
+                                     keep_alive, not_modified ? std::string() : snapshot->body, route.content_type);
+            if (!snapshot->etag.empty()) {
+                res->set(http::field::etag, snapshot->etag);
+                // Clients may keep the body but must revalidate every time
+                res->set(http::field::cache_control, "no-cache");
+            }
+            return res;
+        }
+
+        static void set_cors_headers(Response& response) {
+            response.set(http::field::access_control_allow_origin, "*");
+            response.set(http::field::access_control_allow_methods, "GET, POST, PUT, DELETE, OPTIONS");
+            response.set(http::field::access_control_allow_headers, "Content-Type, Authorization");
+        }
+
+        void complete(const std::shared_ptr<Slot>& slot, std::shared_ptr<Response> response) {
+            slot->response = std::move(response);
+            do_write();
+        }
+
+        void do_write() {
+            if (writing_ || pipeline_.empty() || !pipeline_.front()->response) {
+                return;
+            }
+
+            writing_ = true;
+            update_idle_timer();
+
+            auto res = pipeline_.front()->response;
+            http::async_write(stream_, *res,
+                [self = shared_from_this(), res](beast::error_code ec, std::size_t bytes_transferred) {
                     boost::ignore_unused(bytes_transferred);
-                    self->stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+                    self->on_write(ec, res->need_eof());
                 });
         }
-        
+
+        void on_write(beast::error_code ec, bool close) {
+            writing_ = false;
+            if (ec) {
+                return;
+            }
+
+            pipeline_.pop_front();
+
+            if (close || (closing_ && pipeline_.empty())) {
+                do_close();
+                return;
+            }
+
+            update_idle_timer();
+            do_read();   // Resumes reading if the pipeline was full
+            do_write();
+        }
+
+        void do_close() {
+            idle_timer_.cancel();
+            beast::error_code ec;
+            stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+        }
+
+        // The timer only runs while we wait on the client: idle between
+        // requests or while a response is being written. A slow handler
+        // never times its own connection out.
+        void update_idle_timer() {
+            const bool waiting_on_handler = !writing_ && !pipeline_.empty();
+            if (waiting_on_handler) {
+                idle_timer_.cancel();
+                return;
+            }
+
+            idle_timer_.expires_after(options_.idle_timeout);
+            idle_timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+                if (ec == net::error::operation_aborted) {
+                    return;
+                }
+                if (self->idle_timer_.expiry() <= std::chrono::steady_clock::now()) {
+                    beast::error_code ignored;
+                    self->stream_.socket().close(ignored);
+                }
+            });
+        }
+
         beast::tcp_stream stream_;
         beast::flat_buffer buffer_;
-        http::request<http::string_body> req_;
-        std::shared_ptr<http::response<http::string_body>> res_;
-        std::map<std::string, RouteHandler>& routes_;
+        std::optional<http::request_parser<http::string_body>> parser_;
+        net::steady_timer idle_timer_;
+
+        std::deque<std::shared_ptr<Slot>> pipeline_;
+        bool reading_ = false;
+        bool writing_ = false;
+        bool closing_ = false;
+        size_t requests_served_ = 0;
+
+        const HttpRouter& router_;
+        net::thread_pool& workers_;
+        const HttpServerOptions& options_;
     };
-    
+
+    const HttpServerOptions options_;
+    HttpRouter router_;
+    net::thread_pool workers_;
     net::io_context ioc_;
     tcp::acceptor acceptor_;
-    tcp::socket socket_;
     int port_;
-    std::map<std::string, RouteHandler> routes_;
 };
 
-HttpServer::HttpServer(int port) : impl_(std::make_unique<Impl>(port)) {}
+HttpServer::HttpServer(int port, const HttpServerOptions& options)
+    : impl_(std::make_unique<Impl>(port, options)) {}
 
 HttpServer::~HttpServer() = default;
 
-void HttpServer::add_route(const std::string& path, RouteHandler handler) {
-    impl_->add_route(path, std::move(handler));
+void HttpServer::add_route(const std::string& path, RouteHandler handler, RouteExecution execution) {
+    impl_->add_route(std::string(), path, std::move(handler), execution, HttpRoute().content_type);
+}
+
+void HttpServer::add_route(const std::string& method, const std::string& path, RouteHandler handler,
+                           RouteExecution execution) {
+    impl_->add_route(method, path, std::move(handler), execution, HttpRoute().content_type);
+}
+
+void HttpServer::add_route(const std::string& method, const std::string& path, const std::string& content_type,
+                           RouteHandler handler, RouteExecution execution) {
+    impl_->add_route(method, path, std::move(handler), execution, content_type);
+}
+
+void HttpServer::add_snapshot_route(const std::string& path, SnapshotHandler handler, RouteExecution execution) {
+    impl_->add_snapshot_route(path, std::move(handler), execution);
 }
 
 void HttpServer::run() {
@@ -174,4 +464,4 @@ void HttpServer::run() {
 
 void HttpServer::stop() {
     impl_->stop();
-}
\ No newline at end of file
+}
@@ -0,0 +1,586 @@
+#include "live_push_server.hpp"
+#include "http_router.hpp"
+#include "utils/logger.hpp"
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace {
+
+constexpr uint8_t kDeltaFrame = 1;
+constexpr uint8_t kKeyframe = 2;
+constexpr size_t kBinaryHeaderBytes = 16;
+constexpr size_t kBinaryEntryBytes = 6;
+constexpr size_t kMaxFields = std::numeric_limits<uint16_t>::max();
+constexpr std::chrono::seconds kHandshakeTimeout{10};
+constexpr std::chrono::milliseconds kCloseGrace{200};
+
+using Payload = std::shared_ptr<const std::string>;
+
+void put_le16(std::string& out, uint16_t value) {
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+void put_le32(std::string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+void put_le64(std::string& out, uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+void append_json_string(std::string& out, const std::string& value) {
+    out.push_back('"');
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+void append_json_number(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
+    }
+    char buffer[32];
+    const int length = std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+    out.append(buffer, static_cast<size_t>(length));
+}
+
+/**
+ * One sampled tick. The encodings are built on first use and then shared by
+ * every session; all access happens on the single I/O thread.
+ */
+struct TickFrame {
+    uint32_t seq = 0;
+    double t_ms = 0.0;
+    uint32_t schema_version = 0;
+    std::shared_ptr<const std::vector<std::string>> names;
+    std::vector<float> values;          // Every field, indexed by field id
+    std::vector<uint16_t> changed;      // Field ids published in the delta
+
+    Payload get(bool binary, bool keyframe) {
+        Payload& cached = binary ? (keyframe ? key_binary_ : delta_binary_)
+                                 : (keyframe ? key_json_ : delta_json_);
+        if (!cached) {
+            cached = binary ? encode_binary(keyframe) : encode_json(keyframe);
+        }
+        return cached;
+    }
+
+    Payload schema() {
+        if (!schema_) {
+            auto text = std::make_shared<std::string>(R"({"type":"schema","version":)");
+            *text += std::to_string(schema_version);
+            *text += R"(,"fields":[)";
+            for (size_t i = 0; i < names->size(); ++i) {
+                if (i > 0) {
+                    text->push_back(',');
+                }
+                append_json_string(*text, (*names)[i]);
+            }
+            *text += "]}";
+            schema_ = std::move(text);
+        }
+        return schema_;
+    }
+
+private:
+    template <typename Fn>
+    void for_each_field(bool keyframe, Fn&& fn) const {
+        if (keyframe) {
+            for (size_t id = 0; id < values.size(); ++id) {
+                fn(static_cast<uint16_t>(id));
+            }
+        } else {
+            for (uint16_t id : changed) {
+                fn(id);
+            }
+        }
+    }
+
+    Payload encode_json(bool keyframe) const {
+        auto text = std::make_shared<std::string>();
+        text->reserve(64 + (keyframe ? values.size() : changed.size()) * 32);
+        *text += keyframe ? R"({"type":"keyframe","seq":)" : R"({"type":"delta","seq":)";
+        *text += std::to_string(seq);
+        *text += R"(,"t":)";
+        append_json_number(*text, t_ms);
+        *text += R"(,"values":{)";
+
+        bool first = true;
+        for_each_field(keyframe, [&](uint16_t id) {
+            if (!first) {
+                text->push_back(',');
+            }
+            first = false;
+            append_json_string(*text, (*names)[id]);
+            text->push_back(':');
+            append_json_number(*text, values[id]);
+        });
+        *text += "}}";
+        return text;
+    }
+
+    Payload encode_binary(bool keyframe) const {
+        const size_t count = keyframe ? values.size() : changed.size();
+        auto data = std::make_shared<std::string>();
+        data->reserve(kBinaryHeaderBytes + count * kBinaryEntryBytes);
+
+        data->push_back(static_cast<char>(keyframe ? kKeyframe : kDeltaFrame));
+        data->push_back(0);
+        put_le16(*data, static_cast<uint16_t>(count));
+        put_le32(*data, seq);
+        uint64_t t_bits;
+        std::memcpy(&t_bits, &t_ms, sizeof(t_bits));
+        put_le64(*data, t_bits);
+
+        for_each_field(keyframe, [&](uint16_t id) {
+            uint32_t value_bits;
+            std::memcpy(&value_bits, &values[id], sizeof(value_bits));
+            put_le16(*data, id);
+            put_le32(*data, value_bits);
+        });
+        return data;
+    }
+
+    Payload delta_json_;
+    Payload delta_binary_;
+    Payload key_json_;
+    Payload key_binary_;
+    Payload schema_;
+};
+
+} // namespace
+
+class LivePushServer::Impl {
+public:
+    explicit Impl(const LivePushOptions& options)
+        : options_(options) {}
+
+    ~Impl() {
+        stop();
+    }
+
+    void set_source(LiveStateSource source) {
+        source_ = std::move(source);
+    }
+
+    bool start() {
+        // Fresh I/O state per run, so handlers left over from a previous stop() never fire
+        ioc_ = std::make_unique<net::io_context>(1);
+        acceptor_ = std::make_unique<tcp::acceptor>(*ioc_);
+        try {
+            acceptor_->open(tcp::v4());
+            acceptor_->set_option(net::socket_base::reuse_address(true));
+            acceptor_->bind({net::ip::make_address("0.0.0.0"), static_cast<unsigned short>(options_.port)});
+            acceptor_->listen(net::socket_base::max_listen_connections);
+        } catch (const std::exception& e) {
+            Logger::error("LivePushServer: failed to listen on port " + std::to_string(options_.port) +
+                          ": " + e.what());
+            acceptor_.reset();
+            ioc_.reset();
+            return false;
+        }
+
+        do_accept();
+
+        stopping_ = false;
+        io_thread_ = std::thread([this] { ioc_->run(); });
+        tick_thread_ = std::thread(&Impl::tick_loop, this);
+
+        Logger::info("LivePushServer: listening on port " + std::to_string(options_.port));
+        return true;
+    }
+
+    void stop() {
+        if (tick_thread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(tick_mutex_);
+                stopping_ = true;
+            }
+            tick_cv_.notify_all();
+            tick_thread_.join();
+        }
+
+        if (io_thread_.joinable()) {
+            net::post(*ioc_, [this] {
+                beast::error_code ignored;
+                acceptor_->close(ignored);
+                for (const auto& session : sessions_) {
+                    session->close();
+                }
+
+                // Give sessions a moment to send their close frames
+                auto grace = std::make_shared<net::steady_timer>(*ioc_, kCloseGrace);
+                grace->async_wait([this, grace](beast::error_code) { ioc_->stop(); });
+            });
+            io_thread_.join();
+
+            sessions_.clear();
+            acceptor_.reset();
+            ioc_.reset();
+        }
+        client_count_ = 0;
+    }
+
+    LivePushStats get_stats() const {
+        LivePushStats stats;
+        stats.clients = client_count_;
+        stats.ticks = ticks_;
+        stats.frames_sent = frames_sent_;
+        stats.frames_skipped = frames_skipped_;
+        stats.keyframes_sent = keyframes_sent_;
+        return stats;
+    }
+
+private:
+    class PushSession;
+
+    // Collects one tick; only the tick thread touches the field registry
+    class Sampler : public LiveStateWriter {
+    public:
+        explicit Sampler(Impl& hub) : hub_(hub) {}
+
+        void set(std::string_view name, double value) override {
+            auto it = hub_.field_ids_.find(name);
+            if (it == hub_.field_ids_.end()) {
+                if (hub_.field_names_.size() >= kMaxFields) {
+                    return;
+                }
+                const auto id = static_cast<uint16_t>(hub_.field_names_.size());
+                it = hub_.field_ids_.emplace(std::string(name), id).first;
+                hub_.field_names_.emplace_back(name);
+                hub_.current_.push_back(static_cast<float>(value));
+                hub_.published_.push_back(std::numeric_limits<float>::quiet_NaN());
+                hub_.names_snapshot_.reset();
+                hub_.schema_version_++;
+            }
+            hub_.current_[it->second] = static_cast<float>(value);
+        }
+
+    private:
+        Impl& hub_;
+    };
+
+    void tick_loop() {
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / std::max(options_.tick_hz, 0.1)));
+        const auto epoch = std::chrono::steady_clock::now();
+        auto next_tick = epoch;
+        Sampler sampler(*this);
+        uint32_t seq = 0;
+
+        for (;;) {
+            next_tick += period;
+            {
+                std::unique_lock<std::mutex> lock(tick_mutex_);
+                if (tick_cv_.wait_until(lock, next_tick, [this] { return stopping_; })) {
+                    return;
+                }
+            }
+
+            // Nobody listening: skip sampling; the next client starts from a keyframe anyway
+            if (client_count_ == 0 || !source_) {
+                continue;
+            }
+
+            // Fell behind (debugger, suspended host): drop missed ticks instead of bursting
+            const auto now = std::chrono::steady_clock::now();
+            if (now - next_tick > period) {
+                next_tick = now;
+            }
+
+            source_(sampler);
+
+            auto frame = std::make_shared<TickFrame>();
+            frame->seq = ++seq;
+            frame->t_ms = std::chrono::duration<double, std::milli>(now - epoch).count();
+            frame->schema_version = schema_version_;
+            if (!names_snapshot_) {
+                names_snapshot_ = std::make_shared<const std::vector<std::string>>(field_names_);
+            }
+            frame->names = names_snapshot_;
+            frame->values = current_;
+
+            for (size_t id = 0; id < current_.size(); ++id) {
+                const float previous = published_[id];
+                if (std::isnan(previous) || std::fabs(current_[id] - previous) > options_.min_delta) {
+                    frame->changed.push_back(static_cast<uint16_t>(id));
+                    published_[id] = current_[id];
+                }
+            }
+            ticks_++;
+
+            net::post(*ioc_, [this, frame] {
+                for (const auto& session : sessions_) {
+                    session->deliver(frame);
+                }
+            });
+        }
+    }
+
+    void do_accept() {
+        acceptor_->async_accept(*ioc_, [this](beast::error_code ec, tcp::socket socket) {
+            if (ec) {
+                return;   // Acceptor closed
+            }
+            if (sessions_.size() >= options_.max_clients) {
+                beast::error_code ignored;
+                socket.close(ignored);
+            } else {
+                std::make_shared<PushSession>(std::move(socket), *this)->run();
+            }
+            do_accept();
+        });
+    }
+
+    void join(const std::shared_ptr<PushSession>& session) {
+        sessions_.insert(session);
+        client_count_ = sessions_.size();
+    }
+
+    void leave(const std::shared_ptr<PushSession>& session) {
+        sessions_.erase(session);
+        client_count_ = sessions_.size();
+    }
+
+    /**
+     * One subscriber. Everything runs on the hub's single I/O thread, so no
+     * strand is needed.
+     */
+    class PushSession : public std::enable_shared_from_this<PushSession> {
+    public:
+        PushSession(tcp::socket&& socket, Impl& hub)
+            : ws_(std::move(socket)), hub_(hub) {}
+
+        void run() {
+            beast::get_lowest_layer(ws_).expires_after(kHandshakeTimeout);
+            http::async_read(ws_.next_layer(), buffer_, upgrade_,
+                [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                    self->on_upgrade_request(ec);
+                });
+        }
+
+        void deliver(const std::shared_ptr<TickFrame>& frame) {
+            if (!outbox_.empty()) {
+                // Still writing an earlier frame: skip this one and resync later
+                needs_keyframe_ = true;
+                hub_.frames_skipped_++;
+                return;
+            }
+
+            if (binary_ && schema_version_ != frame->schema_version) {
+                send(frame->schema(), false);
+                schema_version_ = frame->schema_version;
+                needs_keyframe_ = true;
+            }
+
+            if (needs_keyframe_) {
+                send(frame->get(binary_, true), binary_);
+                needs_keyframe_ = false;
+                hub_.keyframes_sent_++;
+            } else if (!frame->changed.empty()) {
+                send(frame->get(binary_, false), binary_);
+            }
+        }
+
+        void close() {
+            if (!open_) {
+                return;
+            }
+            open_ = false;
+            ws_.async_close(websocket::close_code::going_away,
+                            [self = shared_from_this()](beast::error_code) {});
+        }
+
+    private:
+        void on_upgrade_request(beast::error_code ec) {
+            if (ec || !websocket::is_upgrade(upgrade_)) {
+                beast::error_code ignored;
+                beast::get_lowest_layer(ws_).socket().close(ignored);
+                return;
+            }
+
+            const auto target = upgrade_.target();
+            const std::string_view view(target.data(), target.size());
+            const size_t question = view.find('?');
+            if (view.substr(0, question) != "/live") {
+                beast::error_code ignored;
+                beast::get_lowest_layer(ws_).socket().close(ignored);
+                return;
+            }
+            if (question != std::string_view::npos) {
+                std::map<std::string, std::string> query;
+                HttpRouter::parse_query(view.substr(question + 1), query);
+                binary_ = query["format"] == "binary";
+            }
+
+            // The websocket stream runs its own idle timeout and pings from here on
+            beast::get_lowest_layer(ws_).expires_never();
+            ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+            ws_.auto_fragment(false);
+
+            ws_.async_accept(upgrade_, [self = shared_from_this()](beast::error_code ec) {
+                self->on_accept(ec);
+            });
+        }
+
+        void on_accept(beast::error_code ec) {
+            if (ec) {
+                return;
+            }
+            open_ = true;
+            hub_.join(shared_from_this());
+            do_read();
+        }
+
+        // Clients only send control messages; "keyframe" requests a resync
+        void do_read() {
+            ws_.async_read(buffer_, [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                self->on_read(ec);
+            });
+        }
+
+        void on_read(beast::error_code ec) {
+            if (ec) {
+                open_ = false;
+                hub_.leave(shared_from_this());
+                return;
+            }
+            if (ws_.got_text() && beast::buffers_to_string(buffer_.data()) == "keyframe") {
+                needs_keyframe_ = true;
+            }
+            buffer_.consume(buffer_.size());
+            do_read();
+        }
+
+        void send(Payload payload, bool binary) {
+            outbox_.emplace_back(std::move(payload), binary);
+            if (outbox_.size() == 1) {
+                do_write();
+            }
+        }
+
+        void do_write() {
+            const auto& [payload, binary] = outbox_.front();
+            ws_.binary(binary);
+            ws_.async_write(net::buffer(*payload),
+                [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                    self->on_write(ec);
+                });
+        }
+
+        void on_write(beast::error_code ec) {
+            if (ec) {
+                outbox_.clear();
+                return;   // The pending read reports the failure and leaves
+            }
+            outbox_.pop_front();
+            hub_.frames_sent_++;
+            if (!outbox_.empty()) {
+                do_write();
+            }
+        }
+
+        websocket::stream<beast::tcp_stream> ws_;
+        beast::flat_buffer buffer_;
+        http::request<http::string_body> upgrade_;
+        std::deque<std::pair<Payload, bool>> outbox_;   // Schema plus at most one frame
+        Impl& hub_;
+
+        bool open_ = false;
+        bool binary_ = false;
+        bool needs_keyframe_ = true;
+        uint32_t schema_version_ = 0;
+    };
+
+    const LivePushOptions options_;
+    LiveStateSource source_;
+
+    std::unique_ptr<net::io_context> ioc_;
+    std::unique_ptr<tcp::acceptor> acceptor_;
+    std::thread io_thread_;
+    std::unordered_set<std::shared_ptr<PushSession>> sessions_;   // I/O thread only
+
+    std::thread tick_thread_;
+    std::mutex tick_mutex_;
+    std::condition_variable tick_cv_;
+    bool stopping_ = false;
+
+    // Field registry and last published values; tick thread only
+    std::map<std::string, uint16_t, std::less<>> field_ids_;
+    std::vector<std::string> field_names_;
+    std::shared_ptr<const std::vector<std::string>> names_snapshot_;
+    std::vector<float> current_;
+    std::vector<float> published_;
+    uint32_t schema_version_ = 0;
+
+    std::atomic<size_t> client_count_{0};
+    std::atomic<uint64_t> ticks_{0};
+    std::atomic<uint64_t> frames_sent_{0};
+    std::atomic<uint64_t> frames_skipped_{0};
+    std::atomic<uint64_t> keyframes_sent_{0};
+};
+
+LivePushServer::LivePushServer(const LivePushOptions& options)
+    : impl_(std::make_unique<Impl>(options)) {}
+
+LivePushServer::~LivePushServer() {
+    stop();
+}
+
+void LivePushServer::set_source(LiveStateSource source) {
+    impl_->set_source(std::move(source));
+}
+
+bool LivePushServer::start() {
+    if (running_) {
+        return true;
+    }
+    running_ = impl_->start();
+    return running_;
+}
+
+void LivePushServer::stop() {
+    if (!running_) {
+        return;
+    }
+    impl_->stop();
+    running_ = false;
+}
+
+LivePushStats LivePushServer::get_stats() const {
+    return impl_->get_stats();
+}
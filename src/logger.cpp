@@ -3,17 +3,260 @@
 #include <fstream>
 #include <iomanip>
 #include <filesystem>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "utils/spsc_queue.hpp"
 
 // Static member definitions
-Logger::Level Logger::current_level_ = Logger::Level::INFO;
+std::atomic<Logger::Level> Logger::current_level_{Logger::Level::INFO};
 std::string Logger::log_file_path_ = "";
 std::mutex Logger::log_mutex_;
 size_t Logger::max_file_size_ = 10 * 1024 * 1024; // 10MB default
 bool Logger::rotate_logs_ = true;
 
+namespace {
+
+constexpr size_t kEntryTextSize = 224;      // Fixed so pushes never allocate
+constexpr size_t kMinRingEntries = 16;
+constexpr auto kWriterInterval = std::chrono::milliseconds(20);
+
+struct LogEntry {
+    Logger::Level level = Logger::Level::INFO;
+    std::chrono::system_clock::time_point time;
+    uint32_t length = 0;
+    char text[kEntryTextSize];
+};
+
+// One per logging thread; only that thread pushes and only the writer pops
+struct ThreadRing {
+    explicit ThreadRing(size_t entries) : queue(entries) {}
+
+    SpscQueue<LogEntry> queue;
+    std::atomic<bool> retired{false};       // Thread exited; remove once drained
+};
+
+struct AsyncState {
+    std::atomic<bool> active{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> generation{0};    // Bumped per start so threads register fresh rings
+    size_t ring_entries = 1024;
+
+    std::mutex rings_mutex;
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+
+    std::mutex control_mutex;               // start_async / stop_async
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::thread writer;
+};
+
+// Never destroyed: other threads may still log while the process exits
+AsyncState& async_state() {
+    static AsyncState* state = new AsyncState();
+    return *state;
+}
+
+struct ThreadRingHandle {
+    std::shared_ptr<ThreadRing> ring;
+    uint64_t generation = 0;
+
+    ~ThreadRingHandle() {
+        if (ring) {
+            ring->retired.store(true, std::memory_order_release);
+        }
+    }
+};
+
+ThreadRing& thread_ring(AsyncState& state) {
+    thread_local ThreadRingHandle handle;
+
+    const uint64_t generation = state.generation.load(std::memory_order_acquire);
+    if (!handle.ring || handle.generation != generation) {
+        if (handle.ring) {
+            handle.ring->retired.store(true, std::memory_order_release);
+        }
+        // Once per thread and session, the only allocation on this path
+        auto ring = std::make_shared<ThreadRing>(state.ring_entries);
+        {
+            std::lock_guard<std::mutex> lock(state.rings_mutex);
+            state.rings.push_back(ring);
+        }
+        handle.ring = std::move(ring);
+        handle.generation = generation;
+    }
+    return *handle.ring;
+}
+
+// Open log file, only touched under Logger::log_mutex_
+struct LogFile {
+    std::ofstream stream;
+    std::string path;
+    size_t bytes = 0;
+};
+
+LogFile& log_file() {
+    static LogFile* file = new LogFile();
+    return *file;
+}
+
+} // namespace
+
+/**
+ * Formats and writes for both modes. Callers hold log_mutex_ for everything
+ * that touches the console or the file.
+ */
+class LogWriter {
+public:
+    static std::string format(Logger::Level level, std::chrono::system_clock::time_point time,
+                              const char* text, size_t length) {
+        // Format: [TIMESTAMP] [LEVEL] MESSAGE
+        std::string line;
+        line.reserve(length + 40);
+        line += '[';
+        line += Logger::get_timestamp(time);
+        line += "] [";
+        line += Logger::level_to_string(level);
+        line += "] ";
+        line.append(text, length);
+        line += '\n';
+        return line;
+    }
+
+    // Keeps the file open between writes; rotation is checked against the
+    // bytes written rather than a stat per message
+    static void append_to_file(const std::string& text) {
+        if (Logger::log_file_path_.empty()) {
+            return;
+        }
+
+        LogFile& file = log_file();
+        if (!file.stream.is_open() || file.path != Logger::log_file_path_) {
+            open_file(file);
+        }
+        if (Logger::rotate_logs_ && file.bytes >= Logger::max_file_size_) {
+            file.stream.close();
+            Logger::rotate_log_file();
+            open_file(file);
+        }
+        if (!file.stream.is_open()) {
+            return;
+        }
+
+        file.stream << text;
+        file.stream.flush();
+        file.bytes += text.size();
+    }
+
+    static void write_batch(std::vector<LogEntry>& batch) {
+        // Rings are drained one thread at a time
+        std::stable_sort(batch.begin(), batch.end(), [](const LogEntry& a, const LogEntry& b) {
+            return a.time < b.time;
+        });
+
+        std::string out;
+        std::string err;
+        std::string all;
+        for (const LogEntry& entry : batch) {
+            const std::string line = format(entry.level, entry.time, entry.text, entry.length);
+            (entry.level >= Logger::Level::ERROR ? err : out) += line;
+            all += line;
+        }
+
+        std::lock_guard<std::mutex> lock(Logger::log_mutex_);
+        if (!out.empty()) {
+            std::cout << out << std::flush;
+        }
+        if (!err.empty()) {
+            std::cerr << err << std::flush;
+        }
+        append_to_file(all);
+    }
+
+    // Writer thread, or stop_async() once the writer has exited
+    static void drain(AsyncState& state, std::vector<LogEntry>& batch) {
+        std::lock_guard<std::mutex> lock(state.rings_mutex);
+        for (auto it = state.rings.begin(); it != state.rings.end();) {
+            ThreadRing& ring = **it;
+            const bool retired = ring.retired.load(std::memory_order_acquire);
+            LogEntry entry;
+            while (ring.queue.try_pop(entry)) {
+                batch.push_back(entry);
+            }
+            it = retired ? state.rings.erase(it) : it + 1;
+        }
+    }
+
+    static void run(AsyncState& state) {
+        std::vector<LogEntry> batch;
+        uint64_t reported_drops = state.dropped.load(std::memory_order_relaxed);
+
+        while (true) {
+            // Read first, so the last pass drains whatever was pushed before the stop
+            const bool stopping = state.stopping.load(std::memory_order_acquire);
+            drain(state, batch);
+
+            const uint64_t drops = state.dropped.load(std::memory_order_relaxed);
+            if (drops != reported_drops) {
+                batch.push_back(make_entry(Logger::Level::WARN,
+                                           "[Logger] " + std::to_string(drops - reported_drops) +
+                                           " messages dropped, log buffer full"));
+                reported_drops = drops;
+            }
+
+            if (!batch.empty()) {
+                write_batch(batch);
+                batch.clear();
+            }
+            if (stopping) {
+                break;
+            }
+
+            std::unique_lock<std::mutex> lock(state.wake_mutex);
+            state.wake.wait_for(lock, kWriterInterval, [&state] {
+                return state.stopping.load(std::memory_order_acquire);
+            });
+        }
+    }
+
+    static LogEntry make_entry(Logger::Level level, const std::string& message) {
+        LogEntry entry;
+        entry.level = level;
+        entry.time = std::chrono::system_clock::now();
+        entry.length = static_cast<uint32_t>(std::min(message.size(), kEntryTextSize));
+        std::memcpy(entry.text, message.data(), entry.length);
+        if (message.size() > kEntryTextSize) {
+            std::memcpy(entry.text + kEntryTextSize - 3, "...", 3);
+        }
+        return entry;
+    }
+
+private:
+    static void open_file(LogFile& file) {
+        file.stream.close();
+        file.path = Logger::log_file_path_;
+        file.stream.open(file.path, std::ios::app);
+        if (!file.stream.is_open()) {
+            std::cerr << "Failed to write to log file: " << file.path << std::endl;
+            file.bytes = 0;
+            return;
+        }
+
+        std::error_code error;
+        const auto size = std::filesystem::file_size(file.path, error);
+        file.bytes = error ? 0 : static_cast<size_t>(size);
+    }
+};
+
 void Logger::set_level(Level level) {
-    std::lock_guard<std::mutex> lock(log_mutex_);
-    current_level_ = level;
+    current_level_.store(level);
 }
 
 void Logger::set_log_file(const std::string& filepath, size_t max_size, bool rotate) {
@@ -23,6 +266,57 @@ void Logger::set_log_file(const std::string& filepath, size_t max_size, bool rot
     rotate_logs_ = rotate;
 }
 
+void Logger::start_async(size_t buffer_entries) {
+    AsyncState& state = async_state();
+    std::lock_guard<std::mutex> lock(state.control_mutex);
+    if (state.writer.joinable()) {
+        return;
+    }
+
+    static const bool registered = std::atexit(Logger::stop_async) == 0;
+    (void)registered;
+
+    state.ring_entries = std::max(buffer_entries, kMinRingEntries);
+    state.stopping.store(false);
+    state.generation.fetch_add(1, std::memory_order_release);
+    state.writer = std::thread(&LogWriter::run, std::ref(state));
+    state.active.store(true, std::memory_order_release);
+}
+
+void Logger::stop_async() {
+    AsyncState& state = async_state();
+    std::lock_guard<std::mutex> lock(state.control_mutex);
+    if (!state.writer.joinable()) {
+        return;
+    }
+
+    state.active.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> wake_lock(state.wake_mutex);
+        state.stopping.store(true, std::memory_order_release);
+    }
+    state.wake.notify_one();
+    state.writer.join();
+
+    // Messages from threads that saw async mode just before it ended
+    std::vector<LogEntry> batch;
+    LogWriter::drain(state, batch);
+    if (!batch.empty()) {
+        LogWriter::write_batch(batch);
+    }
+
+    std::lock_guard<std::mutex> rings_lock(state.rings_mutex);
+    state.rings.clear();
+}
+
+bool Logger::is_async() {
+    return async_state().active.load(std::memory_order_acquire);
+}
+
+uint64_t Logger::dropped_messages() {
+    return async_state().dropped.load(std::memory_order_relaxed);
+}
+
 std::string Logger::level_to_string(Level level) {
     switch (level) {
         case Level::DEBUG: return "DEBUG";
@@ -33,94 +327,88 @@ std::string Logger::level_to_string(Level level) {
     }
 }
 
-std::string Logger::get_timestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
+std::string Logger::get_timestamp(std::chrono::system_clock::time_point time) {
+    auto time_t = std::chrono::system_clock::to_time_t(time);
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    ss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    
-    return ss.str();
+        time.time_since_epoch()) % 1000;
+
+    // The date and time only change once a second
+    thread_local std::time_t cached_second = -1;
+    thread_local char cached_text[32];
+    if (time_t != cached_second) {
+        std::tm local{};
+        localtime_r(&time_t, &local);
+        std::strftime(cached_text, sizeof(cached_text), "%Y-%m-%d %H:%M:%S", &local);
+        cached_second = time_t;
+    }
+
+    char text[40];
+    std::snprintf(text, sizeof(text), "%s.%03d", cached_text, static_cast<int>(ms.count()));
+    return text;
 }
 
 void Logger::rotate_log_file() {
     if (!rotate_logs_ || log_file_path_.empty()) {
         return;
     }
-    
+
     try {
         // Check if file exists and get its size
         if (!std::filesystem::exists(log_file_path_)) {
             return;
         }
-        
+
         auto file_size = std::filesystem::file_size(log_file_path_);
         if (file_size < max_file_size_) {
             return;
         }
-        
+
         // Create backup filename with timestamp
         auto now = std::chrono::system_clock::now();
         auto time_t = std::chrono::system_clock::to_time_t(now);
-        
+
         std::stringstream backup_name;
-        backup_name << log_file_path_ << "." 
+        backup_name << log_file_path_ << "."
                    << std::put_time(std::localtime(&time_t), "%Y%m%d_%H%M%S");
-        
+
         // Move current log to backup
         std::filesystem::rename(log_file_path_, backup_name.str());
-        
+
         std::cout << "Log file rotated to: " << backup_name.str() << std::endl;
-        
+
     } catch (const std::exception& e) {
         std::cerr << "Error rotating log file: " << e.what() << std::endl;
     }
 }
 
 void Logger::log(Level level, const std::string& message) {
-    if (level < current_level_) {
+    if (level < current_level_.load(std::memory_order_relaxed)) {
         return;
     }
-    
+
+    // Async: copy into this thread's ring and return; no lock, no I/O
+    AsyncState& state = async_state();
+    if (state.active.load(std::memory_order_acquire)) {
+        if (!thread_ring(state).queue.try_push(LogWriter::make_entry(level, message))) {
+            state.dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    const std::string log_entry = LogWriter::format(level, std::chrono::system_clock::now(),
+                                                    message.data(), message.size());
+
     std::lock_guard<std::mutex> lock(log_mutex_);
-    
-    std::string timestamp = get_timestamp();
-    std::string level_str = level_to_string(level);
-    
-    // Format: [TIMESTAMP] [LEVEL] MESSAGE
-    std::string log_entry = "[" + timestamp + "] [" + level_str + "] " + message;
-    
+
     // Always output to console
     if (level >= Level::ERROR) {
-        std::cerr << log_entry << std::endl;
+        std::cerr << log_entry << std::flush;
     } else {
-        std::cout << log_entry << std::endl;
+        std::cout << log_entry << std::flush;
     }
-    
-    // Output to file if configured
-    if (!log_file_path_.empty()) {
-        // Check if rotation is needed
-        rotate_log_file();
-        
-        std::ofstream log_file(log_file_path_, std::ios::app);
-        if (log_file.is_open()) {
-            log_file << log_entry << std::endl;
-            log_file.close();
-        } else {
-            std::cerr << "Failed to write to log file: " << log_file_path_ << std::endl;
-        }
-    }
-}
 
-void Logger::debug(const std::string& message) {
-    log(Level::DEBUG, message);
-}
-
-void Logger::info(const std::string& message) {
-    log(Level::INFO, message);
+    // Output to file if configured
+    LogWriter::append_to_file(log_entry);
 }
 
 void Logger::warn(const std::string& message) {
@@ -132,21 +420,16 @@ void Logger::error(const std::string& message) {
 }
 
 void Logger::log_with_context(Level level, const std::string& context, const std::string& message) {
+    if (level < current_level_.load(std::memory_order_relaxed)) {
+        return;
+    }
     log(level, "[" + context + "] " + message);
 }
 
-void Logger::debug(const std::string& context, const std::string& message) {
-    log_with_context(Level::DEBUG, context, message);
-}
-
-void Logger::info(const std::string& context, const std::string& message) {
-    log_with_context(Level::INFO, context, message);
-}
-
 void Logger::warn(const std::string& context, const std::string& message) {
     log_with_context(Level::WARN, context, message);
 }
 
 void Logger::error(const std::string& context, const std::string& message) {
     log_with_context(Level::ERROR, context, message);
-}
\ No newline at end of file
+}
@@ -1,24 +1,42 @@
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <thread>
 #include <signal.h>
 #include <nlohmann/json.hpp>
 #include "http_server.hpp"
 #include "webrtc_server.hpp"
+#include "live_push_server.hpp"
 #include "stream_manager.hpp"
 #include "video_stream_manager.hpp"
 #include "audio_system.hpp"
 #include "audio_stream_encoder.hpp"
 #include "radio_control.hpp"
+#include "database_manager.hpp"
 #include "config_manager.hpp"
+#include "fft_plan_registry.hpp"
+#include "metrics_registry.hpp"
+#include "trace_profiler.hpp"
+#include "track_catalog.hpp"
+#include "recommendation_index.hpp"
+#include "rtmp_sender.hpp"
+#include "station_host.hpp"
+#include "startup_orchestrator.hpp"
+#include "snapshot_cache.hpp"
 #include "utils/logger.hpp"
+#include "utils/json_writer.hpp"
 
 using json = nlohmann::json;
 
 class RadioServer {
 public:
     RadioServer() 
-        : config_manager_(),
+        : startup_(),
+          config_manager_(),
           stream_manager_(),
           video_manager_(),
           audio_system_(),
@@ -26,8 +44,15 @@ public:
           radio_control_(nullptr),
           http_server_(8080),
           webrtc_server_(nullptr),
+          push_server_(nullptr),
+          station_host_(nullptr),
           running_(false) {}
     
+    ~RadioServer() {
+        // Deferred phases use the members below
+        startup_.wait();
+    }
+    
     bool initialize(const std::string& config_file = "config/config.json") {
         Logger::info("Initializing OneStopRadio Server...");
         
@@ -41,45 +66,109 @@ public:
             return false;
         }
         
-        // Initialize video streaming with default 1080p settings
-        VideoFormat video_format;
-        video_format.width = 1920;
-        video_format.height = 1080;
-        video_format.fps = 30;
-        video_format.bitrate = 4500000; // 4.5 Mbps
-        
-        if (!video_manager_.initialize(video_format)) {
-            Logger::error("Failed to initialize video streaming");
-            return false;
-        }
-        
-        // Initialize audio system with high-quality settings
-        AudioFormat audio_format;
-        audio_format.sample_rate = config_manager_.get_int("audio", "sample_rate", 48000);
-        audio_format.channels = config_manager_.get_int("audio", "channels", 2);
-        audio_format.bit_depth = config_manager_.get_int("audio", "bit_depth", 16);
-        audio_format.bitrate = config_manager_.get_int("audio", "bitrate", 128000);
-        
-        if (!audio_system_.initialize(audio_format)) {
-            Logger::error("Failed to initialize audio system");
-            return false;
+        // Audio and streaming threads log from hot paths; hand the I/O to a writer thread
+        if (config_manager_.get_bool("logging", "async", true)) {
+            Logger::start_async(static_cast<size_t>(config_manager_.get_int("logging", "async_buffer", 1024)));
         }
         
-        // Setup HTTP API routes
-        setup_api_routes();
-        
-        // Initialize WebRTC server
+        data_dir_ = config_manager_.get_string("server", "data_dir", "data");
+        std::error_code dir_error;
+        std::filesystem::create_directories(data_dir_, dir_error);
+        fft_wisdom_path_ = (std::filesystem::path(data_dir_) / "fftw_wisdom").string();
+        
+        // Live video platforms share one AAC encode of the program bus. The
+        // video pipeline itself is only set up by the first video route.
+        EncoderProfile rtmp_audio;
+        rtmp_audio.codec = StreamCodec::AAC;
+        rtmp_audio.bitrate = config_manager_.get_int("video", "audio_bitrate", 160);
+        rtmp_audio.sample_rate = config_manager_.get_int("audio", "sample_rate", 48000);
+        rtmp_audio.channels = config_manager_.get_int("audio", "channels", 2);
+        video_manager_.set_audio_source(
+            [this, rtmp_audio] { return audio_system_.acquire_shared_encoder(rtmp_audio); },
+            [this] { audio_system_.release_idle_encoders(); });
+        
+        // The WebRTC and push servers are started by run(), once audio is on air
         int webrtc_port = config_manager_.get_int("server", "webrtc_port", 8081);
-        webrtc_server_ = std::make_unique<WebRTCServer>(webrtc_port);
+        WebRTCOptions webrtc_options;
+        const std::string stun_server = config_manager_.get_string("webrtc", "ice_server", webrtc_options.ice_servers.front());
+        webrtc_options.ice_servers = {stun_server};
+        webrtc_options.port_range_begin = static_cast<uint16_t>(config_manager_.get_int("webrtc", "port_range_begin", 0));
+        webrtc_options.port_range_end = static_cast<uint16_t>(config_manager_.get_int("webrtc", "port_range_end", 0));
+        webrtc_options.program_return = config_manager_.get_bool("webrtc", "program_return", webrtc_options.program_return);
+        webrtc_options.frame_ms = config_manager_.get_int("webrtc", "frame_ms", webrtc_options.frame_ms);
+        webrtc_options.return_bitrate = config_manager_.get_int("webrtc", "return_bitrate", webrtc_options.return_bitrate);
+        webrtc_options.min_jitter_ms = config_manager_.get_int("webrtc", "min_jitter_ms", 10);
+        webrtc_options.max_jitter_ms = config_manager_.get_int("webrtc", "max_jitter_ms", 200);
+        webrtc_server_ = std::make_unique<WebRTCServer>(webrtc_port, webrtc_options);
+        webrtc_server_->set_audio_system(&audio_system_);
+        
+        // Meters and deck state are pushed over WebSocket instead of being polled
+        LivePushOptions push_options;
+        push_options.port = config_manager_.get_int("server", "push_port", 8082);
+        push_options.tick_hz = config_manager_.get_int("server", "push_rate_hz", 20);
+        push_server_ = std::make_unique<LivePushServer>(push_options);
+        push_server_->set_source([this](LiveStateWriter& out) { publish_live_state(out); });
         
-        // Initialize radio control system
         radio_control_ = std::make_unique<RadioControl>(&audio_system_, &video_manager_, &audio_encoder_);
-        if (!radio_control_->initialize()) {
-            Logger::error("Failed to initialize radio control system");
+        
+        // Independent subsystems come up in parallel. The audio chain goes on
+        // air as soon as it is ready, while the database is still loading.
+        startup_.add_phase("fftw_wisdom", {}, [this] {
+            // Load FFTW wisdom before anything plans an FFT
+            if (!FftPlanRegistry::instance().load_wisdom(fft_wisdom_path_)) {
+                Logger::info("No FFTW wisdom at " + fft_wisdom_path_ + ", FFT plans will be measured on first use");
+            }
+            return true;
+        });
+        startup_.add_phase("audio", {"fftw_wisdom"}, [this] { return initialize_audio(); });
+        startup_.add_phase("audio_start", {"audio"}, [this] {
+            if (!audio_system_.start()) {
+                Logger::error("Failed to start audio system");
+                return false;
+            }
+            return true;
+        });
+        startup_.add_phase("radio_control", {"audio"}, [this] {
+            // Database open, library and catalog load, analysis resume
+            DatabaseStorageOptions database_options;
+            database_options.wal = config_manager_.get_int("database", "wal", 1) != 0;
+            database_options.mmap_size = static_cast<int64_t>(config_manager_.get_int("database", "mmap_mb", 256)) << 20;
+            database_options.cache_size_kb = config_manager_.get_int("database", "cache_mb", 32) * 1024;
+            database_options.read_connections = config_manager_.get_int("database", "read_connections", database_options.read_connections);
+            database_options.write_batch_ms = config_manager_.get_int("database", "write_batch_ms", database_options.write_batch_ms);
+            radio_control_->set_database_options(database_options);
+            if (!radio_control_->initialize()) {
+                Logger::error("Failed to initialize radio control system");
+                return false;
+            }
+            return true;
+        });
+        // Further stations hosted in this process, each without a device. Their
+        // engines still call Pa_Initialize(), and PortAudio's global API is not
+        // thread-safe, so they wait until the main stream is open.
+        startup_.add_phase("stations", {"audio_start"}, [this] {
+            if (!setup_stations()) {
+                return false;
+            }
+            if (station_host_) {
+                station_host_->start();
+            }
+            return true;
+        });
+        startup_.add_phase("routes", {}, [this] {
+            setup_api_routes();
+            return true;
+        });
+        
+        if (!startup_.run()) {
+            Logger::error("Server initialization failed");
             return false;
         }
         
-        Logger::info("Server initialization complete");
+        StartupPhaseTiming audio_start;
+        startup_.get_timing("audio_start", audio_start);
+        Logger::info("Server initialization complete: on air after " + std::to_string(static_cast<int>(audio_start.end_ms)) +
+                     " ms, ready after " + std::to_string(static_cast<int>(startup_.elapsed_ms())) + " ms");
         return true;
     }
     
@@ -92,20 +181,24 @@ public:
         running_ = true;
         Logger::info("🎵 OneStopRadio Server Starting...");
         
-        // Start audio system
-        if (!audio_system_.start()) {
-            Logger::error("Failed to start audio system");
-            running_ = false;
-            return;
-        }
-        
-        // Start WebRTC server
-        if (!webrtc_server_->start()) {
-            Logger::error("Failed to start WebRTC server");
-            audio_system_.stop();
-            running_ = false;
-            return;
-        }
+        // Contribution and live updates come up behind the HTTP server; a
+        // failure leaves the server running without them
+        startup_.add_phase("webrtc", {"audio_start"}, [this] {
+            if (!webrtc_server_->start()) {
+                Logger::error("Failed to start WebRTC server");
+                return false;
+            }
+            return true;
+        }, false);
+        startup_.add_phase("push_server", {"radio_control"}, [this] {
+            // Live updates are optional; polling clients keep working without them
+            if (!push_server_->start()) {
+                Logger::warn("Live push server unavailable, clients must poll");
+                return false;
+            }
+            return true;
+        }, false);
+        startup_.run_async();
         
         // Start HTTP server (this blocks)
         http_server_.run();
@@ -117,14 +210,19 @@ public:
         }
         
         Logger::info("Stopping OneStopRadio Server...");
+        startup_.wait();
         
         // Stop audio system first
         audio_system_.stop();
+        if (station_host_) {
+            station_host_->stop();
+        }
         
         // Stop video streaming
         video_manager_.stop_live_stream();
         
         // Stop servers
+        push_server_->stop();
         webrtc_server_->stop();
         http_server_.stop();
         
@@ -136,40 +234,438 @@ public:
         // Stop all audio streams
         stream_manager_.stop_all_streams();
         
+        if (!FftPlanRegistry::instance().save_wisdom(fft_wisdom_path_)) {
+            Logger::warn("Failed to save FFTW wisdom to " + fft_wisdom_path_);
+        }
+        
         running_ = false;
         Logger::info("Server stopped");
     }
 
 private:
+    bool initialize_audio() {
+        // Initialize audio system with high-quality settings
+        AudioFormat audio_format;
+        audio_format.sample_rate = config_manager_.get_int("audio", "sample_rate", 48000);
+        audio_format.channels = config_manager_.get_int("audio", "channels", 2);
+        audio_format.bit_depth = config_manager_.get_int("audio", "bit_depth", 16);
+        audio_format.bitrate = config_manager_.get_int("audio", "bitrate", 128000);
+        
+        if (!audio_system_.initialize(audio_format)) {
+            Logger::error("Failed to initialize audio system");
+            return false;
+        }
+        
+        SpectrumAnalyzerOptions spectrum_options;
+        spectrum_options.fft_size = config_manager_.get_int("audio", "spectrum_fft_size", spectrum_options.fft_size);
+        spectrum_options.hop = config_manager_.get_int("audio", "spectrum_hop", spectrum_options.hop);
+        spectrum_options.decimation = config_manager_.get_int("audio", "spectrum_decimation", spectrum_options.decimation);
+        spectrum_options.bands = config_manager_.get_int("audio", "spectrum_bands", spectrum_options.bands);
+        audio_system_.set_spectral_analyzer_options(spectrum_options);
+        if (!audio_system_.enable_spectral_analyzer(true)) {
+            Logger::warn("Spectrum analyzer disabled; /api/audio/spectrum will report silence");
+        }
+        
+        const int track_cache_mb = config_manager_.get_int("audio", "track_cache_mb", 1024);
+        audio_system_.set_track_cache_budget(static_cast<size_t>(std::max(track_cache_mb, 0)) << 20);
+        return true;
+    }
+    
+    // The composer, the video encoder and the RTMP senders are set up by the
+    // first video route, so a station that never goes on camera never pays for them
+    bool ensure_video() {
+        return startup_.run_once("video", [this] {
+            // Initialize video streaming with default 1080p settings
+            VideoFormat video_format;
+            video_format.width = 1920;
+            video_format.height = 1080;
+            video_format.fps = 30;
+            video_format.bitrate = 4500000; // 4.5 Mbps
+            
+            if (!video_manager_.initialize(video_format)) {
+                Logger::error("Failed to initialize video streaming");
+                return false;
+            }
+            
+            RtmpSenderOptions rtmp_options;
+            rtmp_options.max_queue_ms = config_manager_.get_int("video", "rtmp_max_queue_ms", rtmp_options.max_queue_ms);
+            rtmp_options.reconnect_delay_ms = config_manager_.get_int("video", "rtmp_reconnect_delay_ms", rtmp_options.reconnect_delay_ms);
+            rtmp_options.max_reconnect_attempts = config_manager_.get_int("video", "rtmp_reconnect_attempts", rtmp_options.max_reconnect_attempts);
+            video_manager_.get_streamer().set_sender_options(rtmp_options);
+            return true;
+        });
+    }
+    
+    static std::string video_unavailable() {
+        json response = {{"success", false}, {"error", "Video streaming failed to initialize"}};
+        return response.dump();
+    }
+    
+    // "stations": {"workers": 0, "pin_workers": true, "job_workers": 2, "list": [
+    //     {"id": "jazz", "name": "...", "sample_rate": 48000, "channels": 2, "track_cache_mb": 256,
+    //      "targets": {"main": {"server_url": "icecast://host:8000/jazz", "stream_key": "...",
+    //                           "codec": "mp3", "bitrate": 128000}}}]}
+    bool setup_stations() {
+        const json section = config_manager_.get_section("stations");
+        if (!section.contains("list") || !section["list"].is_array() || section["list"].empty()) {
+            return true;
+        }
+        
+        StationHostOptions host_options;
+        host_options.workers = section.value("workers", host_options.workers);
+        host_options.pin_workers = section.value("pin_workers", host_options.pin_workers);
+        host_options.first_core = section.value("first_core", host_options.first_core);
+        host_options.job_workers = section.value("job_workers", host_options.job_workers);
+        host_options.max_late_blocks = section.value("max_late_blocks", host_options.max_late_blocks);
+        station_host_ = std::make_unique<StationHost>(host_options);
+        
+        try {
+            for (const json& entry : section["list"]) {
+                StationConfig station;
+                station.id = entry.at("id").get<std::string>();
+                station.name = entry.value("name", station.id);
+                station.format.sample_rate = entry.value("sample_rate", station.format.sample_rate);
+                station.format.channels = entry.value("channels", station.format.channels);
+                station.track_cache_mb = entry.value("track_cache_mb", station.track_cache_mb);
+                station.spectrum_analyzer = entry.value("spectrum_analyzer", station.spectrum_analyzer);
+                station.worker = entry.value("worker", station.worker);
+                for (const auto& [name, target] : entry.value("targets", json::object()).items()) {
+                    StreamingConfig config;
+                    config.server_url = target.value("server_url", "");
+                    config.stream_key = target.value("stream_key", "");
+                    config.title = target.value("title", station.name);
+                    config.description = target.value("description", "");
+                    config.format = station.format;
+                    config.format.codec = target.value("codec", config.format.codec);
+                    config.format.bitrate = target.value("bitrate", config.format.bitrate);
+                    config.enabled = target.value("enabled", true);
+                    station.stream_targets[name] = config;
+                }
+                if (!station_host_->add_station(station)) {
+                    return false;
+                }
+            }
+        } catch (const std::exception& e) {
+            Logger::error("Invalid stations configuration: " + std::string(e.what()));
+            return false;
+        }
+        return true;
+    }
+    
+    // Runs on the push server's tick thread; mirrors the polled level and deck routes
+    void publish_live_state(LiveStateWriter& out) {
+        const auto levels = radio_control_->get_real_time_levels();
+        out.set("levels.left_peak", levels.left_peak);
+        out.set("levels.right_peak", levels.right_peak);
+        out.set("levels.left_rms", levels.left_rms);
+        out.set("levels.right_rms", levels.right_rms);
+        out.set("levels.microphone", levels.microphone_level);
+        out.set("levels.clipping", levels.is_clipping);
+        out.set("levels.ducked", levels.is_ducked);
+        
+        const AudioLevels master = audio_system_.get_master_audio_levels();
+        out.set("master.left_peak", master.left_peak);
+        out.set("master.right_peak", master.right_peak);
+        out.set("master.left_rms", master.left_rms);
+        out.set("master.right_rms", master.right_rms);
+        out.set("master.clipping", master.clipping);
+        
+        std::string prefix;
+        // A copy: HTTP handlers change the decks while this tick runs
+        for (const DJDeckState& deck : radio_control_->get_deck_states()) {
+            prefix = "deck." + deck.id + ".";
+            out.set(prefix + "playing", deck.is_playing);
+            out.set(prefix + "paused", deck.is_paused);
+            out.set(prefix + "position_ms", deck.position_ms);
+            out.set(prefix + "playback_rate", deck.playback_rate);
+            out.set(prefix + "volume", deck.volume);
+            OneStopRadio::TimeStretchStats stretch;
+            if (audio_system_.get_time_stretch_stats(deck.id, stretch)) {
+                out.set(prefix + "stretch_load", stretch.load);
+            }
+            if (deck.has_track) {
+                out.set(prefix + "bpm", deck.bpm);
+            }
+        }
+    }
+    
     void setup_api_routes() {
+        // Handlers that touch files, the network or run analysis are registered with
+        // RouteExecution::WORKER so meter polls on the I/O threads never wait behind them
+        
+        // Dashboards poll the status routes below. Each serializes at most once
+        // per state generation, and once per tick when it also shows meters or
+        // counts no generation tracks; unchanged polls get 304.
+        const std::chrono::milliseconds status_tick(config_manager_.get_int("server", "status_cache_ms", 50));
+        
         // Server status
-        http_server_.add_route("/api/status", [this](const HttpRequest& req) {
+        auto status_cache = std::make_shared<SnapshotCache>(status_tick);
+        http_server_.add_snapshot_route("/api/status", [this, status_cache](const HttpRequest&) {
+            return status_cache->get(audio_system_.get_state_generation(), [this] {
+                json response = {
+                    {"status", "running"},
+                    {"audio_system", audio_system_.is_running()},
+                    {"audio_channels", audio_system_.get_active_channels().size()},
+                    {"audio_streaming", audio_system_.is_streaming()},
+                    {"audio_recording", audio_system_.is_recording()},
+                    {"video_streaming", video_manager_.is_live()},
+                    {"webrtc_connections", webrtc_server_->get_connection_count()}
+                };
+                return response.dump();
+            });
+        });
+        
+        // Remote contributors: jitter, loss and latency of each WebRTC peer
+        http_server_.add_route("GET", "/api/webrtc/peers", [this](const HttpRequest&) {
+            json peers = json::array();
+            for (const WebRTCPeerStats& stats : webrtc_server_->get_peer_stats()) {
+                peers.push_back({
+                    {"peer_id", stats.peer_id},
+                    {"stream_id", stats.stream_id},
+                    {"state", stats.state},
+                    {"input_channel", stats.input_channel},
+                    {"packets_received", stats.packets_received},
+                    {"packets_lost", stats.packets_lost},
+                    {"packets_late", stats.packets_late},
+                    {"packets_recovered", stats.packets_recovered},
+                    {"packets_discarded", stats.packets_discarded},
+                    {"mixer_underruns", stats.mixer_underruns},
+                    {"packets_sent", stats.packets_sent},
+                    {"rtt_ms", stats.rtt_ms},
+                    {"jitter_ms", stats.jitter_ms},
+                    {"jitter_buffer_ms", stats.jitter_buffer_ms},
+                    {"jitter_target_ms", stats.jitter_target_ms},
+                    {"contribution_latency_ms", stats.contribution_latency_ms},
+                    {"return_latency_ms", stats.return_latency_ms},
+                    {"round_trip_latency_ms", stats.round_trip_latency_ms}
+                });
+            }
             json response = {
-                {"status", "running"},
-                {"audio_system", audio_system_.is_running()},
-                {"audio_channels", audio_system_.get_active_channels().size()},
-                {"audio_streaming", audio_system_.is_streaming()},
-                {"audio_recording", audio_system_.is_recording()},
-                {"video_streaming", video_manager_.is_live()},
-                {"webrtc_connections", webrtc_server_->get_connection_count()}
+                {"connections", webrtc_server_->get_connection_count()},
+                {"streaming", webrtc_server_->get_streaming_count()},
+                {"peers", peers}
             };
             return response.dump();
         });
         
+        // Hosted stations: per-station CPU, memory and overruns, plus basic control
+        const auto station_json = [](const StationStats& stats) {
+            return json{
+                {"id", stats.id},
+                {"name", stats.name},
+                {"running", stats.running},
+                {"worker", stats.worker},
+                {"core", stats.core},
+                {"sample_rate", stats.sample_rate},
+                {"blocks", stats.blocks},
+                {"overruns", stats.overruns},
+                {"cpu_seconds", stats.cpu_seconds},
+                {"job_cpu_seconds", stats.job_cpu_seconds},
+                {"load", stats.load},
+                {"jobs", stats.jobs},
+                {"memory_bytes", stats.memory_bytes},
+                {"memory_budget_bytes", stats.memory_budget_bytes},
+                {"streaming", stats.streaming}
+            };
+        };
+        const auto station_not_found = [](const std::string& station_id) {
+            json response = {{"success", false}, {"error", "Unknown station: " + station_id}};
+            return response.dump();
+        };
+        
+        http_server_.add_route("GET", "/api/stations", [this, station_json](const HttpRequest&) {
+            json stations = json::array();
+            if (station_host_) {
+                for (const StationStats& stats : station_host_->stats()) {
+                    stations.push_back(station_json(stats));
+                }
+            }
+            json response = {
+                {"workers", station_host_ ? station_host_->worker_count() : 0},
+                {"stations", stations}
+            };
+            return response.dump();
+        });
+        
+        http_server_.add_route("GET", "/api/stations/{station_id}", [this, station_json, station_not_found](const HttpRequest& req) {
+            const std::string station_id = req.path_params.at("station_id");
+            StationStats stats;
+            std::shared_ptr<AudioSystem> station = station_host_ ? station_host_->get_station(station_id) : nullptr;
+            if (!station || !station_host_->get_stats(station_id, stats)) {
+                return station_not_found(station_id);
+            }
+            const AudioLevels master = station->get_master_audio_levels();
+            json response = station_json(stats);
+            response["master"] = {
+                {"left_peak", master.left_peak},
+                {"right_peak", master.right_peak},
+                {"left_rms", master.left_rms},
+                {"right_rms", master.right_rms},
+                {"clipping", master.clipping}
+            };
+            return response.dump();
+        });
+        
+        // Decoding starts on the station job pool; the deck picks the track up when it is ready
+        http_server_.add_route("POST", "/api/stations/{station_id}/load", [this, station_not_found](const HttpRequest& req) {
+            const std::string station_id = req.path_params.at("station_id");
+            try {
+                json body = json::parse(req.body);
+                const std::string channel_id = body.value("channel_id", "A");
+                const std::string file_path = body.value("file_path", "");
+                const bool queued = station_host_ && station_host_->submit(station_id,
+                    [channel_id, file_path](AudioSystem& station) { station.load_audio_file(channel_id, file_path); });
+                if (!queued) {
+                    return station_not_found(station_id);
+                }
+                json response = {{"success", true}, {"queued", true}, {"channel_id", channel_id}, {"file_path", file_path}};
+                return response.dump();
+            } catch (const std::exception& e) {
+                return json{{"success", false}, {"error", e.what()}}.dump();
+            }
+        });
+        
+        http_server_.add_route("POST", "/api/stations/{station_id}/playback", [this, station_not_found](const HttpRequest& req) {
+            const std::string station_id = req.path_params.at("station_id");
+            std::shared_ptr<AudioSystem> station = station_host_ ? station_host_->get_station(station_id) : nullptr;
+            if (!station) {
+                return station_not_found(station_id);
+            }
+            try {
+                json body = json::parse(req.body);
+                const std::string channel_id = body.value("channel_id", "A");
+                const bool play = body.value("play", false);
+                const bool success = station->set_channel_playback(channel_id, play);
+                json response = {{"success", success}, {"channel_id", channel_id}, {"playing", play}};
+                return response.dump();
+            } catch (const std::exception& e) {
+                return json{{"success", false}, {"error", e.what()}}.dump();
+            }
+        });
+        
+        http_server_.add_route("POST", "/api/stations/{station_id}/master_volume", [this, station_not_found](const HttpRequest& req) {
+            const std::string station_id = req.path_params.at("station_id");
+            std::shared_ptr<AudioSystem> station = station_host_ ? station_host_->get_station(station_id) : nullptr;
+            if (!station) {
+                return station_not_found(station_id);
+            }
+            try {
+                json body = json::parse(req.body);
+                const float volume = std::clamp(body.value("volume", 0.8f), 0.0f, 1.0f);
+                const bool success = station->set_master_volume(volume);
+                return json{{"success", success}, {"volume", volume}}.dump();
+            } catch (const std::exception& e) {
+                return json{{"success", false}, {"error", e.what()}}.dump();
+            }
+        });
+        
+        http_server_.add_route("POST", "/api/stations/{station_id}/streaming", [this, station_not_found](const HttpRequest& req) {
+            const std::string station_id = req.path_params.at("station_id");
+            std::shared_ptr<AudioSystem> station = station_host_ ? station_host_->get_station(station_id) : nullptr;
+            if (!station) {
+                return station_not_found(station_id);
+            }
+            try {
+                json body = json::parse(req.body);
+                const bool enabled = body.value("enabled", true);
+                const bool success = enabled ? station->start_streaming() : station->stop_streaming();
+                return json{{"success", success}, {"streaming", station->is_streaming()}}.dump();
+            } catch (const std::exception& e) {
+                return json{{"success", false}, {"error", e.what()}}.dump();
+            }
+        }, RouteExecution::WORKER);
+        
+        // Startup phase timings, including subsystems set up on first use
+        http_server_.add_route("GET", "/api/startup", [this](const HttpRequest&) {
+            json phases = json::array();
+            for (const StartupPhaseTiming& timing : startup_.timings()) {
+                phases.push_back({
+                    {"name", timing.name},
+                    {"state", StartupOrchestrator::state_name(timing.state)},
+                    {"required", timing.required},
+                    {"lazy", timing.lazy},
+                    {"start_ms", timing.start_ms},
+                    {"end_ms", timing.end_ms},
+                    {"duration_ms", timing.duration_ms}
+                });
+            }
+            StartupPhaseTiming audio_start;
+            const bool on_air = startup_.get_timing("audio_start", audio_start) &&
+                                audio_start.state == StartupPhaseState::DONE;
+            json response = {
+                {"time_to_audio_ms", on_air ? json(audio_start.end_ms) : json(nullptr)},
+                {"uptime_ms", startup_.elapsed_ms()},
+                {"phases", phases}
+            };
+            return response.dump();
+        });
+        
+        // Prometheus scrape: engine timing, xruns, encoder and sender queues
+        http_server_.add_route("GET", "/metrics", MetricsRegistry::kContentType, [](const HttpRequest&) {
+            return MetricsRegistry::instance().render_prometheus();
+        });
+        
+        // Trace capture across the audio, DJ, encoder, video and HTTP threads.
+        // Exporting ends a running capture; both formats open in ui.perfetto.dev.
+        const auto trace_status = [](bool success) {
+            const TraceStatus status = TraceProfiler::instance().status();
+            json response = {
+                {"success", success},
+                {"capturing", status.capturing},
+                {"duration_seconds", status.duration_seconds},
+                {"events", status.events},
+                {"overwritten", status.overwritten},
+                {"dropped", status.dropped},
+                {"threads", status.threads}
+            };
+            return response.dump();
+        };
+        
+        http_server_.add_route("POST", "/api/trace/start", [trace_status](const HttpRequest&) {
+            return trace_status(TraceProfiler::instance().start());
+        });
+        
+        http_server_.add_route("POST", "/api/trace/stop", [trace_status](const HttpRequest&) {
+            return trace_status(TraceProfiler::instance().stop());
+        });
+        
+        http_server_.add_route("GET", "/api/trace/status", [trace_status](const HttpRequest&) {
+            return trace_status(true);
+        });
+        
+        http_server_.add_route("GET", "/api/trace/chrome", [](const HttpRequest&) {
+            TraceProfiler::instance().stop();
+            return TraceProfiler::instance().export_chrome_json();
+        }, RouteExecution::WORKER);
+        
+        http_server_.add_route("GET", "/api/trace/perfetto", "application/octet-stream", [](const HttpRequest&) {
+            TraceProfiler::instance().stop();
+            return TraceProfiler::instance().export_perfetto();
+        }, RouteExecution::WORKER);
+        
         // Video streaming controls
         http_server_.add_route("/api/video/camera/on", [this](const HttpRequest& req) {
+            if (!ensure_video()) {
+                return video_unavailable();
+            }
             bool success = video_manager_.switch_to_camera();
             json response = {{"success", success}, {"source", "camera"}};
             return response.dump();
         });
         
         http_server_.add_route("/api/video/camera/off", [this](const HttpRequest& req) {
+            if (!ensure_video()) {
+                return video_unavailable();
+            }
             bool success = video_manager_.switch_to_off();
             json response = {{"success", success}, {"source", "off"}};
             return response.dump();
         });
         
         http_server_.add_route("/api/video/image", [this](const HttpRequest& req) {
+            if (!ensure_video()) {
+                return video_unavailable();
+            }
             // Parse image path from request body
             json body = json::parse(req.body);
             std::string image_path = body.value("image_path", "");
@@ -184,6 +680,9 @@ private:
         });
         
         http_server_.add_route("/api/video/slideshow/start", [this](const HttpRequest& req) {
+            if (!ensure_video()) {
+                return video_unavailable();
+            }
             json body = json::parse(req.body);
             
             SlideShowConfig config;
@@ -206,6 +705,9 @@ private:
         });
         
         http_server_.add_route("/api/video/slideshow/stop", [this](const HttpRequest& req) {
+            if (!ensure_video()) {
+                return video_unavailable();
+            }
             video_manager_.get_composer().stop_slideshow();
             json response = {{"success", true}, {"action", "slideshow_stopped"}};
             return response.dump();
@@ -213,6 +715,9 @@ private:
         
         // Social media streaming
         http_server_.add_route("/api/video/stream/youtube", [this](const HttpRequest& req) {
+            if (!ensure_video()) {
+                return video_unavailable();
+            }
             json body = json::parse(req.body);
             std::string stream_key = body.value("stream_key", "");
             std::string title = body.value("title", "OneStopRadio Live");
@@ -223,6 +728,9 @@ private:
         });
         
         http_server_.add_route("/api/video/stream/twitch", [this](const HttpRequest& req) {
+            if (!ensure_video()) {
+                return video_unavailable();
+            }
             json body = json::parse(req.body);
             std::string stream_key = body.value("stream_key", "");
             std::string title = body.value("title", "OneStopRadio DJ Set");
@@ -233,6 +741,9 @@ private:
         });
         
         http_server_.add_route("/api/video/stream/facebook", [this](const HttpRequest& req) {
+            if (!ensure_video()) {
+                return video_unavailable();
+            }
             json body = json::parse(req.body);
             std::string stream_key = body.value("stream_key", "");
             std::string title = body.value("title", "Live Radio Show");
@@ -243,6 +754,9 @@ private:
         });
         
         http_server_.add_route("/api/video/stream/start", [this](const HttpRequest& req) {
+            if (!ensure_video()) {
+                return video_unavailable();
+            }
             json body = json::parse(req.body);
             std::vector<std::string> platforms;
             
@@ -259,7 +773,7 @@ private:
                 {"platforms", platforms}
             };
             return response.dump();
-        });
+        }, RouteExecution::WORKER);
         
         http_server_.add_route("/api/video/stream/stop", [this](const HttpRequest& req) {
             bool success = video_manager_.stop_live_stream();
@@ -269,6 +783,9 @@ private:
         
         // Video overlay controls
         http_server_.add_route("/api/video/overlay/text", [this](const HttpRequest& req) {
+            if (!ensure_video()) {
+                return video_unavailable();
+            }
             json body = json::parse(req.body);
             std::string text = body.value("text", "");
             int x = body.value("x", 50);
@@ -282,6 +799,9 @@ private:
         });
         
         http_server_.add_route("/api/video/overlay/clear", [this](const HttpRequest& req) {
+            if (!ensure_video()) {
+                return video_unavailable();
+            }
             bool success = video_manager_.get_composer().remove_text_overlay();
             json response = {{"success", success}, {"overlay", "text_removed"}};
             return response.dump();
@@ -312,6 +832,26 @@ private:
             }
         });
         
+        http_server_.add_route("/api/radio/tracks/import", [this](const HttpRequest& req) {
+            try {
+                json body = json::parse(req.body);
+                std::vector<std::string> file_paths = body.value("file_paths", std::vector<std::string>());
+                bool analyze = body.value("analyze", true);
+                
+                auto track_ids = radio_control_->import_tracks(file_paths, analyze);
+                json response = {
+                    {"success", !track_ids.empty() || file_paths.empty()},
+                    {"track_ids", track_ids},
+                    {"count", track_ids.size()},
+                    {"skipped", file_paths.size() - std::min(file_paths.size(), track_ids.size())}
+                };
+                return response.dump();
+            } catch (const std::exception& e) {
+                json response = {{"success", false}, {"error", e.what()}};
+                return response.dump();
+            }
+        }, RouteExecution::WORKER);
+        
         http_server_.add_route("/api/radio/tracks/remove", [this](const HttpRequest& req) {
             try {
                 json body = json::parse(req.body);
@@ -347,9 +887,47 @@ private:
             }
         });
         
+        // Paged: ?sort=artist&order=desc&limit=100&fields=id,title,artist&cursor=<next_cursor>
         http_server_.add_route("/api/radio/tracks/list", [this](const HttpRequest& req) {
             try {
-                auto tracks = radio_control_->get_all_tracks();
+                TrackPageRequest page;
+                auto param = [&req](const std::string& name) {
+                    auto it = req.params.find(name);
+                    return it != req.params.end() ? it->second : std::string();
+                };
+                if (!param("sort").empty()) page.sort = param("sort");
+                page.descending = param("order") == "desc";
+                page.cursor = param("cursor");
+                if (!param("limit").empty()) page.limit = std::stoi(param("limit"));
+                std::stringstream fields(param("fields"));
+                for (std::string field; std::getline(fields, field, ',');) {
+                    if (!field.empty()) page.fields.push_back(field);
+                }
+                
+                std::string body;
+                JsonWriter out(body);
+                std::string error;
+                out.begin_object().key("success").value(true);
+                if (!radio_control_->write_track_page(page, out, error)) {
+                    json response = {{"success", false}, {"error", error}};
+                    return response.dump();
+                }
+                out.end_object();
+                return body;
+            } catch (const std::exception& e) {
+                json response = {{"success", false}, {"error", e.what()}};
+                return response.dump();
+            }
+        }, RouteExecution::WORKER);
+        
+        http_server_.add_route("/api/radio/tracks/search", [this](const HttpRequest& req) {
+            try {
+                json body = json::parse(req.body);
+                std::string query = body.value("query", "");
+                int limit = body.value("limit", 50);
+                int offset = body.value("offset", 0);
+                
+                auto tracks = radio_control_->search_tracks(query, limit, offset);
                 json tracks_json = json::array();
                 
                 for (const auto& track : tracks) {
@@ -359,6 +937,8 @@ private:
                 json response = {
                     {"success", true},
                     {"tracks", tracks_json},
+                    {"query", query},
+                    {"offset", offset},
                     {"count", tracks.size()}
                 };
                 return response.dump();
@@ -367,23 +947,50 @@ private:
                 return response.dump();
             }
         });
-        
-        http_server_.add_route("/api/radio/tracks/search", [this](const HttpRequest& req) {
+
+        http_server_.add_route("/api/radio/tracks/filter", [this](const HttpRequest& req) {
             try {
                 json body = json::parse(req.body);
-                std::string query = body.value("query", "");
-                
-                auto tracks = radio_control_->search_tracks(query);
+                size_t limit = std::min<size_t>(body.value("limit", 100), 1000);
+
+                std::vector<RadioTrack> tracks;
+                if (body.contains("track_id")) {
+                    // Mixable from a given track: near its BPM and on a neighbouring key
+                    tracks = radio_control_->find_harmonic_tracks(body["track_id"].get<std::string>(),
+                                                                  body.value("tolerance_percent", 6.0f), limit);
+                } else {
+                    OneStopRadio::TrackFilter filter;
+                    filter.min_bpm = body.value("min_bpm", 0.0f);
+                    filter.max_bpm = body.value("max_bpm", 0.0f);
+                    filter.max_play_count = body.value("max_play_count", -1);
+                    filter.limit = limit;
+                    if (body.contains("key")) {
+                        const uint8_t key = OneStopRadio::parse_musical_key(body["key"].get<std::string>());
+                        if (key == OneStopRadio::kNoKey) {
+                            json response = {{"success", false}, {"error", "Unrecognised key"}};
+                            return response.dump();
+                        }
+                        filter.keys = body.value("harmonic", false) ? OneStopRadio::harmonic_keys(key)
+                                                                     : OneStopRadio::KeyMask(1) << key;
+                    }
+                    if (body.contains("genre")) {
+                        filter.genre = radio_control_->find_genre_id(body["genre"].get<std::string>());
+                        if (filter.genre < 0) {
+                            json response = {{"success", true}, {"tracks", json::array()}, {"count", 0}};
+                            return response.dump();
+                        }
+                    }
+                    tracks = radio_control_->find_tracks(filter);
+                }
+
                 json tracks_json = json::array();
-                
                 for (const auto& track : tracks) {
                     tracks_json.push_back(track.to_json());
                 }
-                
+
                 json response = {
                     {"success", true},
                     {"tracks", tracks_json},
-                    {"query", query},
                     {"count", tracks.size()}
                 };
                 return response.dump();
@@ -392,6 +999,35 @@ private:
                 return response.dump();
             }
         });
+
+        http_server_.add_route("/api/radio/tracks/recommend", [this](const HttpRequest& req) {
+            try {
+                json body = json::parse(req.body);
+                std::string track_id = body.value("track_id", "");
+
+                OneStopRadio::RecommendationOptions options;
+                options.bpm_tolerance = body.value("tolerance_percent", 6.0f) / 100.0f;
+                options.half_double = body.value("half_double", true);
+                options.max_energy_delta = body.value("max_energy_delta", 1.0f);
+                options.limit = std::min<size_t>(body.value("limit", 20), 200);
+
+                json tracks_json = json::array();
+                for (const auto& suggestion : radio_control_->recommend_tracks(track_id, options)) {
+                    tracks_json.push_back(suggestion.to_json());
+                }
+
+                json response = {
+                    {"success", true},
+                    {"track_id", track_id},
+                    {"tracks", tracks_json},
+                    {"count", tracks_json.size()}
+                };
+                return response.dump();
+            } catch (const std::exception& e) {
+                json response = {{"success", false}, {"error", e.what()}};
+                return response.dump();
+            }
+        });
         
         http_server_.add_route("/api/radio/tracks/analyze", [this](const HttpRequest& req) {
             try {
@@ -401,7 +1037,51 @@ private:
                 bool success = radio_control_->analyze_track(track_id);
                 json response = {
                     {"success", success},
-                    {"message", success ? "Track analysis completed" : "Failed to analyze track"}
+                    {"track_id", track_id},
+                    {"message", success ? "Track queued for analysis" : "Failed to queue track for analysis"}
+                };
+                return response.dump();
+            } catch (const std::exception& e) {
+                json response = {{"success", false}, {"error", e.what()}};
+                return response.dump();
+            }
+        });
+        
+        http_server_.add_route("/api/radio/tracks/analyze_all", [this](const HttpRequest& req) {
+            bool success = radio_control_->analyze_all_tracks();
+            json response = {
+                {"success", success},
+                {"message", success ? "Unanalyzed tracks queued" : "Analysis queue is full, some tracks were not queued"}
+            };
+            return response.dump();
+        });
+        
+        // ?track_id=<id>, or ?offset=0&limit=100 to page the job list
+        http_server_.add_route("/api/radio/analysis/status", [this](const HttpRequest& req) {
+            try {
+                auto param = [&req](const std::string& name) {
+                    auto it = req.params.find(name);
+                    return it != req.params.end() ? it->second : std::string();
+                };
+                const size_t offset = param("offset").empty() ? 0 : std::stoul(param("offset"));
+                const size_t limit = param("limit").empty() ? 100 : std::stoul(param("limit"));
+                json response = radio_control_->get_analysis_status(param("track_id"), offset, limit);
+                return response.dump();
+            } catch (const std::exception& e) {
+                json response = {{"success", false}, {"error", e.what()}};
+                return response.dump();
+            }
+        });
+        
+        http_server_.add_route("/api/radio/analysis/cancel", [this](const HttpRequest& req) {
+            try {
+                json body = req.body.empty() ? json::object() : json::parse(req.body);
+                std::string track_id = body.value("track_id", "");
+                
+                bool success = radio_control_->cancel_analysis(track_id);
+                json response = {
+                    {"success", success},
+                    {"message", success ? "Analysis cancelled" : "Track is not being analyzed"}
                 };
                 return response.dump();
             } catch (const std::exception& e) {
@@ -430,7 +1110,7 @@ private:
                 json response = {{"success", false}, {"error", e.what()}};
                 return response.dump();
             }
-        });
+        }, RouteExecution::WORKER);
         
         http_server_.add_route("/api/radio/deck/unload", [this](const HttpRequest& req) {
             try {
@@ -507,28 +1187,45 @@ private:
             }
         });
         
-        http_server_.add_route("/api/radio/deck/status", [this](const HttpRequest& req) {
+        // One snapshot per existing deck; deck state only changes through RadioControl
+        struct DeckSnapshots {
+            std::mutex mutex;
+            std::map<std::string, std::unique_ptr<SnapshotCache>> caches;
+        };
+        auto deck_snapshots = std::make_shared<DeckSnapshots>();
+        http_server_.add_snapshot_route("/api/radio/deck/status", [this, deck_snapshots](const HttpRequest& req) {
             try {
                 json body = json::parse(req.body);
                 std::string deck_id = body.value("deck_id", "");
                 
                 DJDeck* deck = radio_control_->get_deck(deck_id);
-                if (deck) {
-                    json response = {
-                        {"success", true},
-                        {"deck", deck->to_json()}
-                    };
-                    return response.dump();
-                } else {
+                if (!deck) {
                     json response = {
                         {"success", false},
                         {"error", "Deck not found"}
                     };
-                    return response.dump();
+                    return SnapshotCache::make(response.dump());
+                }
+                
+                SnapshotCache* cache = nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(deck_snapshots->mutex);
+                    auto& slot = deck_snapshots->caches[deck_id];
+                    if (!slot) {
+                        slot = std::make_unique<SnapshotCache>();
+                    }
+                    cache = slot.get();
                 }
+                return cache->get(radio_control_->get_state_generation(), [deck] {
+                    json response = {
+                        {"success", true},
+                        {"deck", deck->to_json()}
+                    };
+                    return response.dump();
+                });
             } catch (const std::exception& e) {
                 json response = {{"success", false}, {"error", e.what()}};
-                return response.dump();
+                return SnapshotCache::make(response.dump());
             }
         });
         
@@ -552,6 +1249,49 @@ private:
             }
         });
         
+        http_server_.add_route("/api/radio/deck/tempo", [this](const HttpRequest& req) {
+            try {
+                json body = json::parse(req.body);
+                std::string deck_id = body.value("deck_id", "");
+                
+                bool success = radio_control_->get_deck(deck_id) != nullptr;
+                if (success && body.contains("key_lock")) {
+                    success = radio_control_->set_deck_key_lock(deck_id, body["key_lock"].get<bool>());
+                }
+                if (success && body.contains("pitch_semitones")) {
+                    success = radio_control_->set_deck_pitch_shift(deck_id, body["pitch_semitones"].get<double>());
+                }
+                if (success && body.contains("rate")) {
+                    success = radio_control_->set_deck_playback_rate(deck_id, body["rate"].get<double>());
+                }
+                
+                json response = {
+                    {"success", success},
+                    {"deck_id", deck_id},
+                    {"message", success ? "Deck tempo updated" : "Failed to update deck tempo"}
+                };
+                if (const DJDeck* deck = radio_control_->get_deck(deck_id)) {
+                    response["playback_rate"] = deck->playback_rate;
+                    response["key_lock"] = deck->key_lock;
+                    response["pitch_semitones"] = deck->pitch_semitones;
+                }
+                OneStopRadio::TimeStretchStats stats;
+                if (audio_system_.get_time_stretch_stats(deck_id, stats)) {
+                    response["stretch"] = {
+                        {"blocks", stats.blocks},
+                        {"last_us", stats.last_us},
+                        {"avg_us", stats.avg_us},
+                        {"max_us", stats.max_us},
+                        {"load", stats.load}
+                    };
+                }
+                return response.dump();
+            } catch (const std::exception& e) {
+                json response = {{"success", false}, {"error", e.what()}};
+                return response.dump();
+            }
+        });
+        
         // ===== MIXER CONTROLS =====
         
         http_server_.add_route("/api/radio/mixer/crossfader", [this](const HttpRequest& req) {
@@ -590,18 +1330,22 @@ private:
             }
         });
         
-        http_server_.add_route("/api/radio/mixer/status", [this](const HttpRequest& req) {
-            try {
-                json mixer_status = radio_control_->get_mixer_status();
-                json response = {
-                    {"success", true},
-                    {"mixer", mixer_status}
-                };
-                return response.dump();
-            } catch (const std::exception& e) {
-                json response = {{"success", false}, {"error", e.what()}};
-                return response.dump();
-            }
+        auto radio_mixer_cache = std::make_shared<SnapshotCache>();
+        http_server_.add_snapshot_route("/api/radio/mixer/status", [this, radio_mixer_cache](const HttpRequest&) {
+            const uint64_t generation = radio_control_->get_state_generation() + audio_system_.get_state_generation();
+            return radio_mixer_cache->get(generation, [this] {
+                try {
+                    json mixer_status = radio_control_->get_mixer_status();
+                    json response = {
+                        {"success", true},
+                        {"mixer", mixer_status}
+                    };
+                    return response.dump();
+                } catch (const std::exception& e) {
+                    json response = {{"success", false}, {"error", e.what()}};
+                    return response.dump();
+                }
+            });
         });
         
         // ===== MICROPHONE AND TALKOVER CONTROL =====
@@ -886,6 +1630,49 @@ private:
             }
         });
         
+        // Zoomable waveform of an analyzed track, served from its pyramid
+        http_server_.add_route("/api/radio/tracks/{track_id}/waveform", [this](const HttpRequest& req) {
+            try {
+                std::string track_id = req.path_params.at("track_id");
+                auto param = [&req](const char* name, double fallback) {
+                    auto it = req.params.find(name);
+                    return it != req.params.end() ? std::stod(it->second) : fallback;
+                };
+                
+                // Peaks are allocated per pixel, so the width is bounded
+                const double width = param("width", 800);
+                if (!(width >= 1.0)) {
+                    json response = {{"success", false}, {"error", "width must be a positive number of pixels"}};
+                    return response.dump();
+                }
+                
+                RadioControl::WaveformData waveform;
+                bool success = radio_control_->get_track_waveform(
+                    track_id, param("start_ms", 0.0), param("end_ms", 0.0),
+                    static_cast<int>(std::min<double>(width, RadioControl::MAX_WAVEFORM_WIDTH)), waveform);
+                if (!success) {
+                    json response = {{"success", false}, {"error", "Track has no waveform yet"}, {"track_id", track_id}};
+                    return response.dump();
+                }
+                
+                json response = {
+                    {"success", true},
+                    {"track_id", track_id},
+                    {"waveform", {
+                        {"peaks", waveform.peaks},
+                        {"rms", waveform.rms},
+                        {"duration_ms", waveform.duration_ms},
+                        {"sample_rate", waveform.sample_rate},
+                        {"samples_per_pixel", waveform.samples_per_pixel}
+                    }}
+                };
+                return response.dump();
+            } catch (const std::exception& e) {
+                json response = {{"success", false}, {"error", e.what()}};
+                return response.dump();
+            }
+        });
+        
         // Load audio file into channel (matches frontend expectations)
         http_server_.add_route("/api/mixer/channel/A/load", [this](const HttpRequest& req) {
             try {
@@ -912,7 +1699,7 @@ private:
                 json response = {{"success", false}, {"error", e.what()}};
                 return response.dump();
             }
-        });
+        }, RouteExecution::WORKER);
         
         http_server_.add_route("/api/mixer/channel/B/load", [this](const HttpRequest& req) {
             try {
@@ -939,7 +1726,7 @@ private:
                 json response = {{"success", false}, {"error", e.what()}};
                 return response.dump();
             }
-        });
+        }, RouteExecution::WORKER);
         
         // Channel playback control (matches frontend expectations)
         http_server_.add_route("/api/mixer/channel/A/playback", [this](const HttpRequest& req) {
@@ -981,45 +1768,49 @@ private:
         });
         
         // Mixer status endpoint (matches frontend expectations)
-        http_server_.add_route("/api/mixer/status", [this](const HttpRequest& req) {
-            try {
-                AudioLevels master_levels = audio_system_.get_master_audio_levels();
-                float microphone_level = audio_system_.get_microphone_level();
+        // Meters move every callback, so this one is bounded by the tick
+        auto mixer_cache = std::make_shared<SnapshotCache>(status_tick);
+        http_server_.add_snapshot_route("/api/mixer/status", [this, mixer_cache](const HttpRequest&) {
+            return mixer_cache->get(audio_system_.get_state_generation(), [this] {
+                try {
+                    AudioLevels master_levels = audio_system_.get_master_audio_levels();
+                    float microphone_level = audio_system_.get_microphone_level();
                 
-                json response = {
-                    {"success", true},
-                    {"data", {
-                        {"masterVolume", 0.8f}, // Default value
-                        {"crossfader", 0.0f},   // Default value
-                        {"channelA", {
-                            {"volume", 0.75f},
-                            {"bass", 0.0f},
-                            {"mid", 0.0f},
-                            {"treble", 0.0f}
-                        }},
-                        {"channelB", {
-                            {"volume", 0.75f},
-                            {"bass", 0.0f},
-                            {"mid", 0.0f},
-                            {"treble", 0.0f}
-                        }},
-                        {"microphone", {
-                            {"isEnabled", audio_system_.is_microphone_enabled()},
-                            {"isActive", audio_system_.is_microphone_enabled()},
-                            {"isMuted", false},
-                            {"gain", 70.0f}
-                        }},
-                        {"levels", {
-                            {"left", master_levels.left_peak * 100.0f},
-                            {"right", master_levels.right_peak * 100.0f}
+                    json response = {
+                        {"success", true},
+                        {"data", {
+                            {"masterVolume", 0.8f}, // Default value
+                            {"crossfader", 0.0f},   // Default value
+                            {"channelA", {
+                                {"volume", 0.75f},
+                                {"bass", 0.0f},
+                                {"mid", 0.0f},
+                                {"treble", 0.0f}
+                            }},
+                            {"channelB", {
+                                {"volume", 0.75f},
+                                {"bass", 0.0f},
+                                {"mid", 0.0f},
+                                {"treble", 0.0f}
+                            }},
+                            {"microphone", {
+                                {"isEnabled", audio_system_.is_microphone_enabled()},
+                                {"isActive", audio_system_.is_microphone_enabled()},
+                                {"isMuted", false},
+                                {"gain", 70.0f}
+                            }},
+                            {"levels", {
+                                {"left", master_levels.left_peak * 100.0f},
+                                {"right", master_levels.right_peak * 100.0f}
+                            }}
                         }}
-                    }}
-                };
-                return response.dump();
-            } catch (const std::exception& e) {
-                json response = {{"success", false}, {"error", e.what()}};
-                return response.dump();
-            }
+                    };
+                    return response.dump();
+                } catch (const std::exception& e) {
+                    json response = {{"success", false}, {"error", e.what()}};
+                    return response.dump();
+                }
+            });
         });
         
         // Load audio file into channel (legacy compatibility)
@@ -1054,7 +1845,7 @@ private:
                 };
                 return response.dump();
             }
-        });
+        }, RouteExecution::WORKER);
 
         // Channel playback control
         http_server_.add_route("/api/radio/channel/play", [this](const HttpRequest& req) {
@@ -1171,7 +1962,7 @@ private:
                 json response = {{"success", false}, {"error", e.what()}};
                 return response.dump();
             }
-        });
+        }, RouteExecution::WORKER);
         
         http_server_.add_route("/api/radio/station/stop_broadcast", [this](const HttpRequest& req) {
             try {
@@ -1386,7 +2177,7 @@ private:
             bool success = audio_system_.load_audio_file(channel_id, file_path);
             json response = {{"success", success}, {"channel_id", channel_id}, {"file_path", file_path}};
             return response.dump();
-        });
+        }, RouteExecution::WORKER);
         
         http_server_.add_route("/api/audio/channel/play", [this](const HttpRequest& req) {
             json body = json::parse(req.body);
@@ -1530,7 +2321,7 @@ private:
             bool success = audio_system_.start_streaming();
             json response = {{"success", success}, {"action", "stream_started"}};
             return response.dump();
-        });
+        }, RouteExecution::WORKER);
         
         http_server_.add_route("/api/audio/stream/stop", [this](const HttpRequest& req) {
             bool success = audio_system_.stop_streaming();
@@ -1590,7 +2381,7 @@ private:
                 };
                 return response.dump();
             }
-        });
+        }, RouteExecution::WORKER);
         
         http_server_.add_route("/api/audio/stream/disconnect", [this](const HttpRequest& req) {
             bool success = audio_encoder_.disconnect();
@@ -1603,14 +2394,14 @@ private:
         });
         
         http_server_.add_route("/api/audio/stream/start", [this](const HttpRequest& req) {
-            bool success = audio_encoder_.start_streaming();
+            bool success = audio_encoder_.start_streaming(audio_system_.create_master_bus_reader());
             json response = {
                 {"success", success},
                 {"action", "streaming_start"},
                 {"status", success ? "streaming" : "failed"}
             };
             return response.dump();
-        });
+        }, RouteExecution::WORKER);
         
         http_server_.add_route("/api/audio/stream/stop", [this](const HttpRequest& req) {
             bool success = audio_encoder_.stop_streaming();
@@ -1679,19 +2470,46 @@ private:
         });
         
         // Audio recording
+        // Without output_file the recording is segmented into directory on the hour
         http_server_.add_route("/api/audio/record/start", [this](const HttpRequest& req) {
-            json body = json::parse(req.body);
-            std::string output_file = body.value("output_file", "recording.wav");
+            json body = req.body.empty() ? json::object() : json::parse(req.body);
+            RecorderOptions options;
+            options.file = body.value("output_file", "");
+            options.format = body.value("format", options.file.empty() ? options.format
+                                                                       : DiskRecorder::format_for_path(options.file));
+            options.bit_depth = body.value("bit_depth", options.bit_depth);
+            options.bitrate = body.value("bitrate", options.bitrate);
+            options.directory = body.value("directory", options.directory);
+            options.prefix = body.value("prefix", options.prefix);
+            options.segment_seconds = body.value("segment_seconds", options.segment_seconds);
             
-            bool success = audio_system_.start_recording(output_file);
-            json response = {{"success", success}, {"output_file", output_file}, {"action", "record_started"}};
+            bool success = audio_system_.start_recording(options);
+            json response = {
+                {"success", success},
+                {"output_file", audio_system_.get_recording_stats().current_file},
+                {"action", "record_started"}
+            };
             return response.dump();
-        });
+        }, RouteExecution::WORKER);
         
         http_server_.add_route("/api/audio/record/stop", [this](const HttpRequest& req) {
             bool success = audio_system_.stop_recording();
             json response = {{"success", success}, {"action", "record_stopped"}};
             return response.dump();
+        }, RouteExecution::WORKER);
+        
+        http_server_.add_route("/api/audio/record/status", [this](const HttpRequest&) {
+            const RecorderStats stats = audio_system_.get_recording_stats();
+            json response = {
+                {"recording", stats.recording},
+                {"current_file", stats.current_file},
+                {"segments", stats.segments},
+                {"frames_written", stats.frames_written},
+                {"dropped_frames", stats.dropped_frames},
+                {"lag_seconds", stats.lag_seconds},
+                {"write_errors", stats.write_errors}
+            };
+            return response.dump();
         });
         
         // Audio effects
@@ -1743,7 +2561,7 @@ private:
             float bpm = audio_system_.detect_bpm(channel_id);
             json response = {{"success", true}, {"channel_id", channel_id}, {"bpm", bpm}};
             return response.dump();
-        });
+        }, RouteExecution::WORKER);
         
         http_server_.add_route("/api/audio/bpm/sync", [this](const HttpRequest& req) {
             json body = json::parse(req.body);
@@ -1757,17 +2575,27 @@ private:
         
         // Spectrum analyzer
         http_server_.add_route("/api/audio/spectrum", [this](const HttpRequest& req) {
-            json body = json::parse(req.body);
-            int bins = body.value("bins", 256);
-            
-            auto spectrum = audio_system_.get_spectrum_data(bins);
-            json response = {{"success", true}, {"spectrum", spectrum}, {"bins", bins}};
-            return response.dump();
+            try {
+                auto it = req.params.find("bins");
+                int bins = it != req.params.end() ? std::stoi(it->second) : 256;
+                if (!req.body.empty()) {
+                    bins = json::parse(req.body).value("bins", bins);
+                }
+                bins = std::clamp(bins, 1, 4096);
+                
+                auto spectrum = audio_system_.get_spectrum_data(bins);
+                json response = {{"success", true}, {"spectrum", spectrum}, {"bins", bins}};
+                return response.dump();
+            } catch (const std::exception& e) {
+                json response = {{"success", false}, {"error", e.what()}};
+                return response.dump();
+            }
         });
         
         Logger::info("API routes configured");
     }
     
+    StartupOrchestrator startup_;       // First, so its clock starts with the server
     ConfigManager config_manager_;
     StreamManager stream_manager_;
     VideoStreamManager video_manager_;
@@ -1776,6 +2604,10 @@ private:
     std::unique_ptr<RadioControl> radio_control_;
     HttpServer http_server_;
     std::unique_ptr<WebRTCServer> webrtc_server_;
+    std::unique_ptr<LivePushServer> push_server_;
+    std::unique_ptr<StationHost> station_host_;
+    std::string data_dir_;
+    std::string fft_wisdom_path_;
     bool running_;
 };
 
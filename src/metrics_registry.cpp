@@ -0,0 +1,173 @@
+#include "metrics_registry.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+std::string escape_label_value(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '"': escaped += "\\\""; break;
+            case '\n': escaped += "\\n"; break;
+            default: escaped += c; break;
+        }
+    }
+    return escaped;
+}
+
+// {a="1",b="2"}, or empty without labels
+std::string render_labels(const MetricLabels& labels) {
+    if (labels.empty()) {
+        return std::string();
+    }
+    std::string rendered = "{";
+    for (size_t i = 0; i < labels.size(); ++i) {
+        if (i > 0) {
+            rendered += ',';
+        }
+        rendered += labels[i].first + "=\"" + escape_label_value(labels[i].second) + '"';
+    }
+    return rendered + '}';
+}
+
+// Labels plus one more, for histogram buckets
+std::string with_label(const std::string& labels, const std::string& name, const std::string& value) {
+    const std::string extra = name + "=\"" + value + '"';
+    if (labels.empty()) {
+        return '{' + extra + '}';
+    }
+    return labels.substr(0, labels.size() - 1) + ',' + extra + '}';
+}
+
+std::string format_value(double value) {
+    if (std::isnan(value)) {
+        return "NaN";
+    }
+    if (std::isinf(value)) {
+        return value > 0 ? "+Inf" : "-Inf";
+    }
+    std::ostringstream out;
+    out.precision(10);
+    out << value;
+    return out.str();
+}
+
+} // namespace
+
+MetricHistogram::MetricHistogram(const std::vector<double>& bounds)
+    : bound_count_(std::min(bounds.size(), kMaxBuckets)) {
+    std::copy(bounds.begin(), bounds.begin() + static_cast<std::ptrdiff_t>(bound_count_), bounds_);
+}
+
+MetricHistogram::Snapshot MetricHistogram::snapshot() const {
+    Snapshot snapshot;
+    snapshot.bounds.assign(bounds_, bounds_ + bound_count_);
+    uint64_t total = 0;
+    for (size_t i = 0; i <= bound_count_; ++i) {
+        total += counts_[i].load(std::memory_order_relaxed);
+        snapshot.cumulative.push_back(total);
+    }
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+// Caller holds mutex_
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name, Type type, const std::string& help) {
+    auto it = families_.find(name);
+    if (it == families_.end()) {
+        it = families_.emplace(name, Family{type, help, {}, {}, {}, {}}).first;
+    } else if (it->second.type != type) {
+        throw std::invalid_argument("metric " + name + " is already registered with another type");
+    }
+    return it->second;
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = family(name, Type::COUNTER, help).counters[render_labels(labels)];
+    if (!slot) {
+        slot = std::make_unique<MetricCounter>();
+    }
+    return *slot;
+}
+
+MetricGauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = family(name, Type::GAUGE, help).gauges[render_labels(labels)];
+    if (!slot) {
+        slot = std::make_unique<MetricGauge>();
+    }
+    return *slot;
+}
+
+MetricHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                            const std::vector<double>& bounds, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Family& metrics = family(name, Type::HISTOGRAM, help);
+    if (metrics.histograms.empty() && metrics.bounds.empty()) {
+        metrics.bounds = bounds;
+    }
+    auto& slot = metrics.histograms[render_labels(labels)];
+    if (!slot) {
+        slot = std::make_unique<MetricHistogram>(metrics.bounds);
+    }
+    return *slot;
+}
+
+std::string MetricsRegistry::render_prometheus() const {
+    std::ostringstream out;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [name, metrics] : families_) {
+        out << "# HELP " << name << ' ' << metrics.help << '\n';
+        switch (metrics.type) {
+            case Type::COUNTER:
+                out << "# TYPE " << name << " counter\n";
+                for (const auto& [labels, counter] : metrics.counters) {
+                    out << name << labels << ' ' << counter->value() << '\n';
+                }
+                break;
+            case Type::GAUGE:
+                out << "# TYPE " << name << " gauge\n";
+                for (const auto& [labels, gauge] : metrics.gauges) {
+                    out << name << labels << ' ' << format_value(gauge->value()) << '\n';
+                }
+                break;
+            case Type::HISTOGRAM:
+                out << "# TYPE " << name << " histogram\n";
+                for (const auto& [labels, histogram] : metrics.histograms) {
+                    const MetricHistogram::Snapshot snapshot = histogram->snapshot();
+                    for (size_t i = 0; i < snapshot.bounds.size(); ++i) {
+                        out << name << "_bucket" << with_label(labels, "le", format_value(snapshot.bounds[i]))
+                            << ' ' << snapshot.cumulative[i] << '\n';
+                    }
+                    const uint64_t count = snapshot.cumulative.back();
+                    out << name << "_bucket" << with_label(labels, "le", "+Inf") << ' ' << count << '\n';
+                    out << name << "_sum" << labels << ' ' << format_value(snapshot.sum) << '\n';
+                    out << name << "_count" << labels << ' ' << count << '\n';
+                }
+                break;
+        }
+    }
+    return out.str();
+}
+
+std::vector<double> MetricsRegistry::exponential_buckets(double start, double factor, size_t count) {
+    std::vector<double> bounds;
+    bounds.reserve(count);
+    double bound = start;
+    for (size_t i = 0; i < count; ++i) {
+        bounds.push_back(bound);
+        bound *= factor;
+    }
+    return bounds;
+}
@@ -0,0 +1,149 @@
+#include "pixel_kernels.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define PIXEL_HAVE_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define PIXEL_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// The shuffles need SSSE3, which is above the x86-64 baseline; compiled per function like the AVX2 DSP kernels
+#if defined(PIXEL_HAVE_X86) && defined(__GNUC__)
+#define PIXEL_HAVE_SSSE3 1
+#define PIXEL_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+
+namespace dsp {
+
+namespace {
+
+// ===== SCALAR REFERENCE =====
+
+// Exact round(x / 255) for x in [0, 255 * 255]
+inline uint8_t div255(unsigned x) {
+    x += 128;
+    return static_cast<uint8_t>((x + (x >> 8)) >> 8);
+}
+
+void blend_rgba_over_rgb_scalar(uint8_t* dst, const uint8_t* src, size_t pixels) {
+    for (size_t i = 0; i < pixels; ++i) {
+        const unsigned alpha = src[4 * i + 3];
+        for (int c = 0; c < 3; ++c) {
+            dst[3 * i + c] = div255(src[4 * i + c] * alpha + dst[3 * i + c] * (255 - alpha));
+        }
+    }
+}
+
+const PixelKernelTable kScalarTable = {
+    "scalar",
+    blend_rgba_over_rgb_scalar
+};
+
+// ===== SSSE3 =====
+
+#if defined(PIXEL_HAVE_SSSE3)
+
+PIXEL_TARGET_SSSE3
+inline __m128i blend_lanes_ssse3(__m128i src, __m128i dst, __m128i alpha) {
+    const __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(src, alpha), _mm_mullo_epi16(dst, inverse));
+    t = _mm_add_epi16(t, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+PIXEL_TARGET_SSSE3
+void blend_rgba_over_rgb_ssse3(uint8_t* dst, const uint8_t* src, size_t pixels) {
+    // Four RGBA pixels to their RGB bytes, and each alpha repeated per channel
+    const __m128i rgb_mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i alpha_mask = _mm_setr_epi8(3, 3, 3, 7, 7, 7, 11, 11, 11, 15, 15, 15, -1, -1, -1, -1);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    // The 16-byte destination load covers 5.3 pixels, so keep 6 in range
+    for (; i + 6 <= pixels; i += 4) {
+        const __m128i rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+        const __m128i color = _mm_shuffle_epi8(rgba, rgb_mask);
+        const __m128i alpha = _mm_shuffle_epi8(rgba, alpha_mask);
+        const __m128i base = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + 3 * i));
+
+        const __m128i low = blend_lanes_ssse3(_mm_unpacklo_epi8(color, zero), _mm_unpacklo_epi8(base, zero),
+                                              _mm_unpacklo_epi8(alpha, zero));
+        const __m128i high = blend_lanes_ssse3(_mm_unpackhi_epi8(color, zero), _mm_unpackhi_epi8(base, zero),
+                                               _mm_unpackhi_epi8(alpha, zero));
+        const __m128i result = _mm_packus_epi16(low, high);
+
+        // Only the 12 bytes of these four pixels; the rest belong to the next ones
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 3 * i), result);
+        const int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(result, 8));
+        std::memcpy(dst + 3 * i + 8, &tail, sizeof(tail));
+    }
+    blend_rgba_over_rgb_scalar(dst + 3 * i, src + 4 * i, pixels - i);
+}
+
+const PixelKernelTable kSsse3Table = {
+    "ssse3",
+    blend_rgba_over_rgb_ssse3
+};
+
+#endif // PIXEL_HAVE_SSSE3
+
+// ===== NEON =====
+
+#if defined(PIXEL_HAVE_NEON)
+
+void blend_rgba_over_rgb_neon(uint8_t* dst, const uint8_t* src, size_t pixels) {
+    const uint16x8_t bias = vdupq_n_u16(128);
+
+    size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        // Structure loads split the channels, so no shuffles are needed
+        const uint8x8x4_t color = vld4_u8(src + 4 * i);
+        uint8x8x3_t base = vld3_u8(dst + 3 * i);
+        const uint8x8_t alpha = color.val[3];
+        const uint8x8_t inverse = vmvn_u8(alpha);
+
+        for (int c = 0; c < 3; ++c) {
+            uint16x8_t t = vmlal_u8(vmull_u8(color.val[c], alpha), base.val[c], inverse);
+            t = vaddq_u16(t, bias);
+            base.val[c] = vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+        }
+        vst3_u8(dst + 3 * i, base);
+    }
+    blend_rgba_over_rgb_scalar(dst + 3 * i, src + 4 * i, pixels - i);
+}
+
+const PixelKernelTable kNeonTable = {
+    "neon",
+    blend_rgba_over_rgb_neon
+};
+
+#endif // PIXEL_HAVE_NEON
+
+const PixelKernelTable& select_kernels() {
+#if defined(PIXEL_HAVE_SSSE3)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        return kSsse3Table;
+    }
+#endif
+#if defined(PIXEL_HAVE_NEON)
+    return kNeonTable;
+#else
+    return kScalarTable;
+#endif
+}
+
+} // namespace
+
+const PixelKernelTable& pixel_kernels() {
+    static const PixelKernelTable& table = select_kernels();
+    return table;
+}
+
+const PixelKernelTable& scalar_pixel_kernels() {
+    return kScalarTable;
+}
+
+} // namespace dsp
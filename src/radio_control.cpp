@@ -1,15 +1,21 @@
 #include "radio_control.hpp"
 #include "database_manager.hpp"
+#include "analysis_scheduler.hpp"
+#include "waveform_pyramid.hpp"
+#include "track_catalog.hpp"
+#include "recommendation_index.hpp"
 #include "audio_system.hpp"
 #include "video_stream_manager.hpp"
 #include "audio_stream_encoder.hpp"
 #include "utils/logger.hpp"
 #include <algorithm>
+#include <cmath>
 #include <random>
 #include <fstream>
 #include <filesystem>
 #include <iomanip>
 #include <sstream>
+#include <set>
 
 RadioControl::RadioControl(AudioSystem* audio_system, 
                           VideoStreamManager* video_manager,
@@ -18,6 +24,8 @@ RadioControl::RadioControl(AudioSystem* audio_system,
     , video_manager_(video_manager)
     , audio_encoder_(audio_encoder)
     , database_(std::make_unique<DatabaseManager>())
+    , catalog_(std::make_unique<OneStopRadio::TrackCatalog>())
+    , recommendations_(std::make_unique<OneStopRadio::RecommendationIndex>())
     , crossfader_position_(0.0f)
     , crossfader_curve_(0.5f)
     , master_volume_(0.8f)
@@ -35,6 +43,10 @@ RadioControl::~RadioControl() {
     shutdown();
 }
 
+void RadioControl::set_database_options(const DatabaseStorageOptions& options) {
+    database_->set_storage_options(options);
+}
+
 bool RadioControl::initialize() {
     Logger::info("RadioControl: Starting initialization");
     
@@ -52,6 +64,20 @@ bool RadioControl::initialize() {
         Logger::warn("RadioControl: Failed to load data from database, starting fresh");
     }
     
+    // Start background analysis and resume jobs the last shutdown interrupted
+    AnalysisSchedulerOptions analysis_options;
+    analysis_options.waveform_dir = waveform_dir_;
+    analysis_scheduler_ = std::make_unique<AnalysisScheduler>(analysis_options);
+    analysis_scheduler_->set_sink([this](const std::vector<AnalysisJobStatus>& updates) {
+        apply_analysis_updates(updates);
+    });
+    analysis_scheduler_->start();
+    for (const auto& status : {"queued", "running"}) {
+        for (const auto& job : database_->get_analysis_jobs(status)) {
+            analyze_track(job.track_id);
+        }
+    }
+    
     // Initialize station configuration if not exists
     if (station_config_.id.empty()) {
         station_config_.id = "onestopradio_main";
@@ -93,6 +119,11 @@ void RadioControl::shutdown() {
     // Stop broadcasting
     stop_broadcast();
     
+    // Stop analysis; its last batch is written before the database closes
+    if (analysis_scheduler_) {
+        analysis_scheduler_->stop();
+    }
+    
     // Save current state to database
     save_to_database();
     
@@ -117,7 +148,84 @@ std::string RadioControl::add_track(const std::string& file_path, const json& me
     
     // Generate unique track ID
     std::string track_id = generate_track_id();
+    RadioTrack track = make_track(track_id, file_path, metadata);
+    
+    // Store track in memory
+    {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        tracks_[track_id] = track;
+        index_track(track);
+    }
+    
+    // Save to database
+    if (!database_->insert_track(track)) {
+        Logger::error("RadioControl: Failed to save track to database");
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        tracks_.erase(track_id);
+        unindex_track(track_id);
+        return "";
+    }
+    
+    // Analyze track if requested
+    if (metadata.value("analyze", true)) {
+        analyze_track(track_id);
+    }
+    
+    Logger::info("RadioControl: Successfully added track " + track.title + " by " + track.artist);
+    return track_id;
+}
+
+std::vector<std::string> RadioControl::import_tracks(const std::vector<std::string>& file_paths, bool analyze) {
+    Logger::info("RadioControl: Importing " + std::to_string(file_paths.size()) + " tracks");
+    
+    std::vector<RadioTrack> tracks;
+    tracks.reserve(file_paths.size());
+    std::set<std::string> ids;
+    for (const auto& file_path : file_paths) {
+        if (!validate_track_file(file_path)) {
+            Logger::warn("RadioControl: Skipping invalid track file: " + file_path);
+            continue;
+        }
+        
+        // One duplicate id would roll back the whole import
+        std::string track_id;
+        {
+            std::lock_guard<std::mutex> lock(library_mutex_);
+            do {
+                track_id = generate_track_id();
+            } while (ids.count(track_id) || tracks_.count(track_id));
+        }
+        ids.insert(track_id);
+        tracks.push_back(make_track(track_id, file_path));
+    }
+    
+    if (!database_->insert_tracks(tracks)) {
+        Logger::error("RadioControl: Failed to save imported tracks to database");
+        return {};
+    }
     
+    std::vector<std::string> track_ids;
+    track_ids.reserve(tracks.size());
+    {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        for (const auto& track : tracks) {
+            tracks_[track.id] = track;
+            index_track(track);
+            track_ids.push_back(track.id);
+        }
+    }
+    
+    if (analyze) {
+        for (const auto& track_id : track_ids) {
+            analyze_track(track_id);
+        }
+    }
+    
+    Logger::info("RadioControl: Imported " + std::to_string(track_ids.size()) + " tracks");
+    return track_ids;
+}
+
+RadioTrack RadioControl::make_track(const std::string& track_id, const std::string& file_path, const json& metadata) {
     // Create track object
     RadioTrack track;
     track.id = track_id;
@@ -141,23 +249,7 @@ std::string RadioControl::add_track(const std::string& file_path, const json& me
     track.key = combined_metadata.value("key", "");
     track.gain = combined_metadata.value("gain", 1.0f);
     
-    // Store track in memory
-    tracks_[track_id] = track;
-    
-    // Save to database
-    if (!database_->insert_track(track)) {
-        Logger::error("RadioControl: Failed to save track to database");
-        tracks_.erase(track_id);
-        return "";
-    }
-    
-    // Analyze track if requested
-    if (combined_metadata.value("analyze", true)) {
-        analyze_track(track_id);
-    }
-    
-    Logger::info("RadioControl: Successfully added track " + track.title + " by " + track.artist);
-    return track_id;
+    return track;
 }
 
 bool RadioControl::remove_track(const std::string& track_id) {
@@ -170,10 +262,15 @@ bool RadioControl::remove_track(const std::string& track_id) {
         }
     }
     
+    if (analysis_scheduler_) {
+        analysis_scheduler_->cancel(track_id);
+    }
+    
     // Remove from memory
-    auto it = tracks_.find(track_id);
-    if (it != tracks_.end()) {
-        tracks_.erase(it);
+    {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        tracks_.erase(track_id);
+        unindex_track(track_id);
     }
     
     // Remove from database
@@ -187,23 +284,30 @@ bool RadioControl::remove_track(const std::string& track_id) {
 }
 
 bool RadioControl::update_track_metadata(const std::string& track_id, const json& metadata) {
-    auto it = tracks_.find(track_id);
-    if (it == tracks_.end()) {
-        Logger::error("RadioControl: Track not found: " + track_id);
-        return false;
+    RadioTrack track;
+    {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        auto it = tracks_.find(track_id);
+        if (it == tracks_.end()) {
+            Logger::error("RadioControl: Track not found: " + track_id);
+            return false;
+        }
+        
+        RadioTrack& stored = it->second;
+        
+        // Update fields from metadata
+        if (metadata.contains("title")) stored.title = metadata["title"];
+        if (metadata.contains("artist")) stored.artist = metadata["artist"];
+        if (metadata.contains("album")) stored.album = metadata["album"];
+        if (metadata.contains("genre")) stored.genre = metadata["genre"];
+        if (metadata.contains("bpm")) stored.bpm = metadata["bpm"];
+        if (metadata.contains("key")) stored.key = metadata["key"];
+        if (metadata.contains("gain")) stored.gain = metadata["gain"];
+        
+        index_track(stored);
+        track = stored;
     }
     
-    RadioTrack& track = it->second;
-    
-    // Update fields from metadata
-    if (metadata.contains("title")) track.title = metadata["title"];
-    if (metadata.contains("artist")) track.artist = metadata["artist"];
-    if (metadata.contains("album")) track.album = metadata["album"];
-    if (metadata.contains("genre")) track.genre = metadata["genre"];
-    if (metadata.contains("bpm")) track.bpm = metadata["bpm"];
-    if (metadata.contains("key")) track.key = metadata["key"];
-    if (metadata.contains("gain")) track.gain = metadata["gain"];
-    
     // Update in database
     if (!database_->update_track(track)) {
         Logger::error("RadioControl: Failed to update track in database");
@@ -219,7 +323,12 @@ RadioTrack* RadioControl::get_track(const std::string& track_id) {
     return (it != tracks_.end()) ? &it->second : nullptr;
 }
 
+bool RadioControl::write_track_page(const TrackPageRequest& request, JsonWriter& out, std::string& error) {
+    return database_->write_track_page(request, out, error);
+}
+
 std::vector<RadioTrack> RadioControl::get_all_tracks() {
+    std::lock_guard<std::mutex> lock(library_mutex_);
     std::vector<RadioTrack> result;
     result.reserve(tracks_.size());
     
@@ -230,26 +339,295 @@ std::vector<RadioTrack> RadioControl::get_all_tracks() {
     return result;
 }
 
-std::vector<RadioTrack> RadioControl::search_tracks(const std::string& query) {
+std::vector<RadioTrack> RadioControl::search_tracks(const std::string& query, int limit, int offset) {
+    // The database ranks and pages through its full-text index; the library
+    // copies carry the live analysis state
+    std::vector<RadioTrack> result = database_->search_tracks(query, limit, offset);
+    
+    std::lock_guard<std::mutex> lock(library_mutex_);
+    for (RadioTrack& track : result) {
+        auto it = tracks_.find(track.id);
+        if (it != tracks_.end()) {
+            track = it->second;
+        }
+    }
+    
+    return result;
+}
+
+std::vector<RadioTrack> RadioControl::find_tracks(const OneStopRadio::TrackFilter& filter) {
+    std::lock_guard<std::mutex> lock(library_mutex_);
+    const auto matches = catalog_->filter(filter);
+    
     std::vector<RadioTrack> result;
-    std::string lower_query = query;
-    std::transform(lower_query.begin(), lower_query.end(), lower_query.begin(), ::tolower);
+    result.reserve(matches.size());
+    for (OneStopRadio::TrackIndex index : matches) {
+        auto it = tracks_.find(std::string(catalog_->id(index)));
+        if (it != tracks_.end()) {
+            result.push_back(it->second);
+        }
+    }
     
-    for (const auto& [id, track] : tracks_) {
-        std::string searchable = track.title + " " + track.artist + " " + track.album + " " + track.genre;
-        std::transform(searchable.begin(), searchable.end(), searchable.begin(), ::tolower);
+    return result;
+}
+
+std::vector<RadioTrack> RadioControl::find_harmonic_tracks(const std::string& track_id, float tolerance_percent,
+                                                           size_t limit) {
+    OneStopRadio::TrackFilter filter;
+    {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        const OneStopRadio::TrackIndex index = catalog_->find(track_id);
+        if (index == OneStopRadio::kNoTrack) {
+            return {};
+        }
         
-        if (searchable.find(lower_query) != std::string::npos) {
-            result.push_back(track);
+        const float bpm = catalog_->bpm(index);
+        if (bpm > 0.0f) {
+            const float tolerance = std::clamp(tolerance_percent, 0.0f, 50.0f) / 100.0f;
+            filter.min_bpm = bpm * (1.0f - tolerance);
+            filter.max_bpm = bpm * (1.0f + tolerance);
         }
+        filter.keys = OneStopRadio::harmonic_keys(catalog_->key(index));
+    }
+    
+    // One extra, since the seed track matches itself
+    filter.limit = limit > 0 ? limit + 1 : 0;
+    std::vector<RadioTrack> result = find_tracks(filter);
+    result.erase(std::remove_if(result.begin(), result.end(),
+                                [&](const RadioTrack& track) { return track.id == track_id; }),
+                 result.end());
+    if (limit > 0 && result.size() > limit) {
+        result.resize(limit);
     }
     
     return result;
 }
 
+int RadioControl::find_genre_id(const std::string& genre) {
+    std::lock_guard<std::mutex> lock(library_mutex_);
+    return catalog_->genre_id(genre);
+}
+
+std::vector<TrackSuggestion> RadioControl::recommend_tracks(const std::string& track_id,
+                                                            const OneStopRadio::RecommendationOptions& options) {
+    std::lock_guard<std::mutex> lock(library_mutex_);
+    const OneStopRadio::TrackIndex seed = catalog_->find(track_id);
+    if (seed == OneStopRadio::kNoTrack) {
+        return {};
+    }
+    
+    std::vector<TrackSuggestion> result;
+    for (const auto& match : recommendations_->query(seed, options)) {
+        auto it = tracks_.find(std::string(catalog_->id(match.track)));
+        if (it == tracks_.end()) {
+            continue;
+        }
+        TrackSuggestion suggestion;
+        suggestion.track = it->second;
+        suggestion.score = match.score;
+        suggestion.tempo_ratio = match.tempo_ratio;
+        suggestion.key_relation = OneStopRadio::key_relation_name(match.relation);
+        result.push_back(std::move(suggestion));
+    }
+    
+    return result;
+}
+
+// ===== TRACK ANALYSIS =====
+
+bool RadioControl::analyze_track(const std::string& track_id) {
+    std::string file_path;
+    {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        auto it = tracks_.find(track_id);
+        if (it == tracks_.end()) {
+            Logger::error("RadioControl: Track not found for analysis: " + track_id);
+            return false;
+        }
+        file_path = it->second.file_path;
+    }
+    
+    if (!analysis_scheduler_ || !analysis_scheduler_->submit(track_id, file_path, AnalysisPriority::IMPORT)) {
+        Logger::warn("RadioControl: Analysis queue unavailable or full, skipping " + track_id);
+        return false;
+    }
+    return true;
+}
+
+bool RadioControl::analyze_all_tracks() {
+    if (!analysis_scheduler_) {
+        return false;
+    }
+    
+    std::vector<std::pair<std::string, std::string>> pending;
+    {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        for (const auto& [id, track] : tracks_) {
+            if (!track.is_analyzed) {
+                pending.emplace_back(id, track.file_path);
+            }
+        }
+    }
+    
+    size_t queued = 0;
+    for (const auto& [id, file_path] : pending) {
+        if (!analysis_scheduler_->submit(id, file_path, AnalysisPriority::IMPORT)) {
+            break;
+        }
+        ++queued;
+    }
+    
+    Logger::info("RadioControl: Queued " + std::to_string(queued) + " of " +
+                 std::to_string(pending.size()) + " unanalyzed tracks");
+    return queued == pending.size();
+}
+
+bool RadioControl::cancel_analysis(const std::string& track_id) {
+    if (!analysis_scheduler_) {
+        return false;
+    }
+    if (track_id.empty()) {
+        analysis_scheduler_->cancel_all();
+        return true;
+    }
+    return analysis_scheduler_->cancel(track_id);
+}
+
+json RadioControl::get_analysis_status(const std::string& track_id, size_t offset, size_t limit) {
+    auto job_to_json = [](const AnalysisJobStatus& job) {
+        json j = {
+            {"track_id", job.track_id},
+            {"status", analysis_job_state_name(job.state)},
+            {"priority", job.priority == AnalysisPriority::DECK ? "deck" : "import"},
+            {"progress", job.progress}
+        };
+        if (!job.error.empty()) {
+            j["error"] = job.error;
+        }
+        return j;
+    };
+    
+    if (!analysis_scheduler_) {
+        return json{{"running", false}};
+    }
+    
+    if (!track_id.empty()) {
+        AnalysisJobStatus job;
+        if (analysis_scheduler_->get_job(track_id, job)) {
+            return job_to_json(job);
+        }
+        
+        // Finished before this run, or never analyzed
+        DatabaseManager::AnalysisJobData record;
+        if (database_->get_analysis_job(track_id, record)) {
+            json j = {{"track_id", record.track_id}, {"status", record.status}, {"progress", record.progress}};
+            if (!record.error.empty()) {
+                j["error"] = record.error;
+            }
+            return j;
+        }
+        return json{{"track_id", track_id}, {"status", "none"}};
+    }
+    
+    const AnalysisSummary summary = analysis_scheduler_->get_summary();
+    limit = std::min(limit, MAX_ANALYSIS_JOBS_PAGE);
+    json jobs = json::array();
+    for (const auto& job : analysis_scheduler_->get_jobs(offset, limit)) {
+        jobs.push_back(job_to_json(job));
+    }
+    
+    return json{
+        {"running", analysis_scheduler_->is_running()},
+        {"workers", summary.workers},
+        {"queued", summary.queued},
+        {"active", summary.running},
+        {"done", summary.done},
+        {"failed", summary.failed},
+        {"cancelled", summary.cancelled},
+        {"offset", offset},
+        {"jobs", jobs}
+    };
+}
+
+// Runs on the scheduler's writer thread
+void RadioControl::apply_analysis_updates(const std::vector<AnalysisJobStatus>& updates) {
+    std::vector<DatabaseManager::AnalysisJobData> records;
+    records.reserve(updates.size());
+    
+    for (const auto& update : updates) {
+        DatabaseManager::AnalysisJobData record;
+        record.track_id = update.track_id;
+        record.status = analysis_job_state_name(update.state);
+        record.progress = update.progress;
+        record.error = update.error;
+        record.waveform_path = update.waveform_path;
+        if (update.state == AnalysisJobState::DONE && update.waveform) {
+            record.duration_ms = static_cast<int>(update.waveform->duration * 1000.0);
+            record.peak = update.waveform->global_peak;
+            record.dynamic_range = update.waveform->dynamic_range;
+            record.bpm = update.waveform->bpm;
+            record.beat_time = update.waveform->beat_time;
+            record.energy = update.waveform->energy;
+        }
+        records.push_back(record);
+    }
+    
+    if (!database_->save_analysis_jobs(records)) {
+        Logger::error("RadioControl: Failed to save " + std::to_string(records.size()) + " analysis updates");
+        return;
+    }
+    
+    {
+        // Re-analysis replaced the pyramid file; map the new one on next use
+        std::lock_guard<std::mutex> pyramid_lock(pyramid_mutex_);
+        for (const auto& record : records) {
+            if (record.status == "done") {
+                pyramid_cache_.erase(record.track_id);
+            }
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(library_mutex_);
+    for (const auto& record : records) {
+        if (record.status != "done") {
+            continue;
+        }
+        auto it = tracks_.find(record.track_id);
+        if (it != tracks_.end()) {
+            it->second.duration_ms = record.duration_ms;
+            it->second.is_analyzed = true;
+            if (record.bpm > 0.0f) {
+                it->second.bpm = static_cast<int>(std::lround(record.bpm));
+            }
+            it->second.energy = record.energy;
+            
+            const OneStopRadio::TrackIndex index = catalog_->find(record.track_id);
+            catalog_->set_analysis(index, record.bpm, record.duration_ms);
+            recommendations_->update(index, catalog_->bpm(index), catalog_->key(index), record.energy);
+        }
+    }
+}
+
+// ===== PLAYLIST MANAGEMENT =====
+
+bool RadioControl::set_active_playlist(const std::string& playlist_id) {
+    if (playlists_.find(playlist_id) == playlists_.end()) {
+        return false;
+    }
+    
+    for (auto& [id, playlist] : playlists_) {
+        playlist.is_active = id == playlist_id;
+    }
+    prefetch_upcoming_tracks("");
+    
+    Logger::info("RadioControl: Active playlist is now " + playlist_id);
+    return true;
+}
+
 // ===== DECK OPERATIONS =====
 
 bool RadioControl::load_track_to_deck(const std::string& deck_id, const std::string& track_id) {
+    StateChange change(state_generation_);
     Logger::info("RadioControl: Loading track " + track_id + " to deck " + deck_id);
     
     auto deck_it = decks_.find(deck_id);
@@ -278,15 +656,26 @@ bool RadioControl::load_track_to_deck(const std::string& deck_id, const std::str
         return false;
     }
     
+    // Analyze ahead of the library backlog so the deck gets its waveform first
+    if (!track->is_analyzed && analysis_scheduler_) {
+        analysis_scheduler_->submit(track->id, track->file_path, AnalysisPriority::DECK);
+    }
+    
     // Update deck state
-    deck->current_track = track;
-    deck->position_ms = 0.0;
-    deck->is_playing = false;
-    deck->is_paused = false;
-    deck->playback_rate = 1.0;
+    {
+        std::lock_guard<std::mutex> lock(decks_mutex_);
+        deck->current_track = track;
+        deck->position_ms = 0.0;
+        deck->is_playing = false;
+        deck->is_paused = false;
+        deck->playback_rate = 1.0;
+        deck->pitch_semitones = 0.0;
+    }
     
-    // Apply track gain
+    // Apply track gain; key lock stays as the DJ left it
     audio_system_->set_channel_volume(deck_id, track->gain * deck->volume);
+    audio_system_->set_channel_playback_rate(deck_id, deck->playback_rate);
+    audio_system_->set_channel_pitch_shift(deck_id, deck->pitch_semitones);
     
     // Load cue points and hot cues from database
     auto cue_points = database_->get_track_cue_points(track_id);
@@ -317,6 +706,12 @@ bool RadioControl::load_track_to_deck(const std::string& deck_id, const std::str
         }
     }
     
+    // Decode the hot-cue regions ahead of the rest of the track, then what plays next
+    for (const auto& hc : hot_cues) {
+        audio_system_->preload_audio_region(track->file_path, hc.position_ms / 1000.0);
+    }
+    prefetch_upcoming_tracks(track_id);
+    
     // Trigger callback
     if (track_loaded_callback_) {
         track_loaded_callback_(deck_id, *track);
@@ -326,7 +721,48 @@ bool RadioControl::load_track_to_deck(const std::string& deck_id, const std::str
     return true;
 }
 
+void RadioControl::prefetch_upcoming_tracks(const std::string& current_track_id) {
+    const RadioPlaylist* playlist = nullptr;
+    for (const auto& [playlist_id, candidate] : playlists_) {
+        if (candidate.is_active) {
+            playlist = &candidate;
+            break;
+        }
+    }
+    if (!playlist) {
+        auto it = playlists_.find(auto_dj_playlist_id_);
+        playlist = it != playlists_.end() ? &it->second : nullptr;
+    }
+    if (!playlist) {
+        return;
+    }
+    
+    // Start after the current track, or at the top when it is not in the playlist
+    const auto& ids = playlist->track_ids;
+    auto next = std::find(ids.begin(), ids.end(), current_track_id);
+    next = next == ids.end() ? ids.begin() : next + 1;
+    
+    std::vector<std::pair<std::string, std::string>> upcoming;   // Track id, file path
+    {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        for (; next != ids.end() && upcoming.size() < prefetch_ahead_; ++next) {
+            auto track = tracks_.find(*next);
+            if (track != tracks_.end()) {
+                upcoming.emplace_back(track->first, track->second.file_path);
+            }
+        }
+    }
+    
+    for (const auto& [track_id, file_path] : upcoming) {
+        audio_system_->prefetch_audio_file(file_path);
+        for (const auto& hc : database_->get_track_hot_cues(track_id)) {
+            audio_system_->preload_audio_region(file_path, hc.position_ms / 1000.0);
+        }
+    }
+}
+
 bool RadioControl::unload_deck(const std::string& deck_id) {
+    StateChange change(state_generation_);
     auto deck_it = decks_.find(deck_id);
     if (deck_it == decks_.end()) {
         return false;
@@ -338,8 +774,11 @@ bool RadioControl::unload_deck(const std::string& deck_id) {
     stop_deck(deck_id);
     
     // Clear deck state
-    deck->current_track = nullptr;
-    deck->position_ms = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(decks_mutex_);
+        deck->current_track = nullptr;
+        deck->position_ms = 0.0;
+    }
     deck->cue_points.clear();
     for (int i = 0; i < 8; i++) {
         deck->hot_cues[i] = nullptr;
@@ -349,6 +788,7 @@ bool RadioControl::unload_deck(const std::string& deck_id) {
 }
 
 bool RadioControl::play_deck(const std::string& deck_id) {
+    StateChange change(state_generation_);
     auto deck_it = decks_.find(deck_id);
     if (deck_it == decks_.end() || !deck_it->second->current_track) {
         return false;
@@ -360,15 +800,20 @@ bool RadioControl::play_deck(const std::string& deck_id) {
         return false;
     }
     
-    deck->is_playing = true;
-    deck->is_paused = false;
+    {
+        std::lock_guard<std::mutex> lock(decks_mutex_);
+        deck->is_playing = true;
+        deck->is_paused = false;
+    }
     
     // Update track play statistics
     if (deck->current_track) {
         database_->increment_play_count(deck->current_track->id);
         database_->update_last_played(deck->current_track->id);
+        std::lock_guard<std::mutex> lock(library_mutex_);
         deck->current_track->play_count++;
         deck->current_track->last_played = std::chrono::system_clock::now();
+        catalog_->set_play_count(catalog_->find(deck->current_track->id), deck->current_track->play_count);
     }
     
     Logger::info("RadioControl: Started playback on deck " + deck_id);
@@ -376,6 +821,7 @@ bool RadioControl::play_deck(const std::string& deck_id) {
 }
 
 bool RadioControl::pause_deck(const std::string& deck_id) {
+    StateChange change(state_generation_);
     auto deck_it = decks_.find(deck_id);
     if (deck_it == decks_.end()) {
         return false;
@@ -387,14 +833,18 @@ bool RadioControl::pause_deck(const std::string& deck_id) {
         return false;
     }
     
-    deck->is_playing = false;
-    deck->is_paused = true;
+    {
+        std::lock_guard<std::mutex> lock(decks_mutex_);
+        deck->is_playing = false;
+        deck->is_paused = true;
+    }
     
     Logger::info("RadioControl: Paused playback on deck " + deck_id);
     return true;
 }
 
 bool RadioControl::stop_deck(const std::string& deck_id) {
+    StateChange change(state_generation_);
     auto deck_it = decks_.find(deck_id);
     if (deck_it == decks_.end()) {
         return false;
@@ -406,9 +856,12 @@ bool RadioControl::stop_deck(const std::string& deck_id) {
         return false;
     }
     
-    deck->is_playing = false;
-    deck->is_paused = false;
-    deck->position_ms = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(decks_mutex_);
+        deck->is_playing = false;
+        deck->is_paused = false;
+        deck->position_ms = 0.0;
+    }
     
     // Trigger callback if track ended naturally
     if (deck->current_track && track_ended_callback_) {
@@ -421,7 +874,88 @@ bool RadioControl::stop_deck(const std::string& deck_id) {
 
 // ===== MIXER OPERATIONS =====
 
+bool RadioControl::seek_deck(const std::string& deck_id, double position_ms) {
+    StateChange change(state_generation_);
+    auto deck_it = decks_.find(deck_id);
+    if (deck_it == decks_.end() || !deck_it->second->current_track) {
+        return false;
+    }
+    
+    // Memory only: the deck plays decoded PCM from the track cache
+    if (!audio_system_->set_channel_position(deck_id, position_ms / 1000.0)) {
+        return false;
+    }
+    const double actual_ms = audio_system_->get_channel_position(deck_id) * 1000.0;
+    std::lock_guard<std::mutex> lock(decks_mutex_);
+    deck_it->second->position_ms = actual_ms;
+    return true;
+}
+
+bool RadioControl::set_deck_playback_rate(const std::string& deck_id, double rate) {
+    StateChange change(state_generation_);
+    auto deck_it = decks_.find(deck_id);
+    if (deck_it == decks_.end()) {
+        return false;
+    }
+    
+    // Pitch fader range; at 0.5 and 2.0 the stretch stays artefact-tolerable
+    rate = std::clamp(rate, 0.5, 2.0);
+    if (!audio_system_->set_channel_playback_rate(deck_id, rate)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(decks_mutex_);
+    deck_it->second->playback_rate = rate;
+    return true;
+}
+
+bool RadioControl::set_deck_key_lock(const std::string& deck_id, bool enabled) {
+    StateChange change(state_generation_);
+    auto deck_it = decks_.find(deck_id);
+    if (deck_it == decks_.end()) {
+        return false;
+    }
+    
+    if (!audio_system_->set_channel_key_lock(deck_id, enabled)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(decks_mutex_);
+    deck_it->second->key_lock = enabled;
+    return true;
+}
+
+bool RadioControl::set_deck_pitch_shift(const std::string& deck_id, double semitones) {
+    StateChange change(state_generation_);
+    auto deck_it = decks_.find(deck_id);
+    if (deck_it == decks_.end()) {
+        return false;
+    }
+    
+    semitones = std::clamp(semitones, -12.0, 12.0);
+    if (!audio_system_->set_channel_pitch_shift(deck_id, semitones)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(decks_mutex_);
+    deck_it->second->pitch_semitones = semitones;
+    return true;
+}
+
+bool RadioControl::trigger_hot_cue(const std::string& deck_id, int hot_cue_index) {
+    StateChange change(state_generation_);
+    auto deck_it = decks_.find(deck_id);
+    if (deck_it == decks_.end() || hot_cue_index < 0 || hot_cue_index >= 8) {
+        return false;
+    }
+    
+    const DJDeck::CuePoint* cue = deck_it->second->hot_cues[hot_cue_index];
+    if (!cue) {
+        Logger::warn("RadioControl: Hot cue " + std::to_string(hot_cue_index) + " is not set on deck " + deck_id);
+        return false;
+    }
+    return seek_deck(deck_id, cue->position_ms);
+}
+
 bool RadioControl::set_crossfader_position(float position) {
+    StateChange change(state_generation_);
     crossfader_position_ = std::clamp(position, -1.0f, 1.0f);
     
     if (!audio_system_->set_crossfader_position(crossfader_position_)) {
@@ -433,6 +967,7 @@ bool RadioControl::set_crossfader_position(float position) {
 }
 
 bool RadioControl::set_master_volume(float volume) {
+    StateChange change(state_generation_);
     master_volume_ = std::clamp(volume, 0.0f, 1.0f);
     
     if (!audio_system_->set_master_volume(master_volume_)) {
@@ -445,6 +980,7 @@ bool RadioControl::set_master_volume(float volume) {
 // ===== MICROPHONE AND TALKOVER IMPLEMENTATION =====
 
 bool RadioControl::enable_microphone(bool enabled) {
+    StateChange change(state_generation_);
     Logger::info("RadioControl: " + std::string(enabled ? "Enabling" : "Disabling") + " microphone");
     
     microphone_enabled_ = enabled;
@@ -470,6 +1006,7 @@ bool RadioControl::enable_microphone(bool enabled) {
 }
 
 bool RadioControl::set_microphone_gain(float gain) {
+    StateChange change(state_generation_);
     microphone_gain_ = std::clamp(gain, 0.0f, 2.0f);
     
     if (microphone_enabled_) {
@@ -484,6 +1021,7 @@ bool RadioControl::set_microphone_gain(float gain) {
 }
 
 bool RadioControl::set_microphone_mute(bool muted) {
+    StateChange change(state_generation_);
     microphone_muted_ = muted;
     
     if (microphone_enabled_) {
@@ -515,6 +1053,7 @@ float RadioControl::get_microphone_gain() {
 }
 
 bool RadioControl::enable_talkover(bool enabled) {
+    StateChange change(state_generation_);
     Logger::info("RadioControl: " + std::string(enabled ? "Enabling" : "Disabling") + " talkover");
     
     // Can only enable talkover if microphone is enabled and not muted
@@ -525,51 +1064,38 @@ bool RadioControl::enable_talkover(bool enabled) {
     
     talkover_active_ = enabled;
     
+    // Ducking is its own gain stage, so the master volume can still be
+    // changed mid-talkover and nothing has to be restored afterwards
     if (enabled) {
-        // Store current master volume before ducking
-        original_master_volume_ = master_volume_;
-        
-        // Calculate ducked volume
-        float ducked_volume = master_volume_ * talkover_duck_level_;
+        audio_system_->set_duck_level(talkover_duck_level_, talkover_duck_time_);
         
-        // Apply ducking with fade
-        if (!audio_system_->fade_master_volume(ducked_volume, talkover_duck_time_)) {
-            // Fallback to instant volume change if fade not supported
-            set_master_volume(ducked_volume);
-        }
-        
-        Logger::info("RadioControl: Talkover enabled - Master volume ducked from " + 
-                    std::to_string(original_master_volume_) + " to " + std::to_string(ducked_volume));
+        Logger::info("RadioControl: Talkover enabled - Program ducked to " + 
+                    std::to_string(talkover_duck_level_));
     } else {
-        // Restore original volume with fade
-        if (!audio_system_->fade_master_volume(original_master_volume_, talkover_duck_time_)) {
-            // Fallback to instant volume change if fade not supported  
-            set_master_volume(original_master_volume_);
-        }
+        audio_system_->set_duck_level(1.0f, talkover_duck_time_);
         
-        Logger::info("RadioControl: Talkover disabled - Master volume restored to " + 
-                    std::to_string(original_master_volume_));
+        Logger::info("RadioControl: Talkover disabled - Program restored");
     }
     
     return true;
 }
 
 bool RadioControl::set_talkover_duck_level(float level) {
+    StateChange change(state_generation_);
     talkover_duck_level_ = std::clamp(level, 0.0f, 1.0f);
     
     // If talkover is currently active, update the ducked volume
     if (talkover_active_) {
-        float ducked_volume = original_master_volume_ * talkover_duck_level_;
-        set_master_volume(ducked_volume);
+        audio_system_->set_duck_level(talkover_duck_level_, talkover_duck_time_);
         
-        Logger::info("RadioControl: Updated talkover duck level to " + std::to_string(level) + 
-                    " - Current ducked volume: " + std::to_string(ducked_volume));
+        Logger::info("RadioControl: Updated talkover duck level to " + std::to_string(level));
     }
     
     return true;
 }
 
 bool RadioControl::set_talkover_duck_time(float time_ms) {
+    StateChange change(state_generation_);
     talkover_duck_time_ = std::clamp(time_ms, 10.0f, 5000.0f); // 10ms to 5s
     Logger::info("RadioControl: Talkover duck time set to " + std::to_string(talkover_duck_time_) + "ms");
     return true;
@@ -583,6 +1109,37 @@ float RadioControl::get_talkover_duck_level() {
     return talkover_duck_level_;
 }
 
+// ===== STATUS AND MONITORING =====
+
+DJDeck* RadioControl::get_deck(const std::string& deck_id) {
+    auto deck_it = decks_.find(deck_id);
+    return deck_it != decks_.end() ? deck_it->second.get() : nullptr;
+}
+
+std::vector<DJDeckState> RadioControl::get_deck_states() {
+    std::vector<DJDeckState> states;
+    std::lock_guard<std::mutex> lock(decks_mutex_);
+    states.reserve(decks_.size());
+    for (const auto& [deck_id, deck] : decks_) {
+        DJDeckState state;
+        state.id = deck_id;
+        state.is_playing = deck->is_playing;
+        state.is_paused = deck->is_paused;
+        state.position_ms = deck->position_ms;
+        state.playback_rate = deck->playback_rate;
+        state.volume = deck->volume;
+        if (deck->current_track) {
+            // Analysis writes bpm under the library lock
+            std::lock_guard<std::mutex> library_lock(library_mutex_);
+            state.has_track = true;
+            state.track_id = deck->current_track->id;
+            state.bpm = deck->current_track->bpm;
+        }
+        states.push_back(std::move(state));
+    }
+    return states;
+}
+
 // ===== WAVEFORM AND AUDIO VISUALIZATION =====
 
 RadioControl::WaveformData RadioControl::get_deck_waveform(const std::string& deck_id) {
@@ -621,8 +1178,14 @@ bool RadioControl::generate_waveform_data(const std::string& track_id, int width
     
     const RadioTrack& track = track_it->second;
     
-    // Get waveform data from audio system
+    // Analyzed tracks are served from their pyramid without decoding
     WaveformData waveform;
+    if (get_track_waveform(track_id, 0.0, 0.0, width_pixels, waveform)) {
+        waveform_cache_[track_id] = waveform;
+        return true;
+    }
+    
+    // Get waveform data from audio system
     if (!audio_system_->generate_waveform(track.file_path, width_pixels, waveform.peaks, waveform.rms)) {
         Logger::error("RadioControl: Failed to generate waveform data from audio system");
         return false;
@@ -642,6 +1205,49 @@ bool RadioControl::generate_waveform_data(const std::string& track_id, int width
     return true;
 }
 
+bool RadioControl::get_track_waveform(const std::string& track_id, double start_ms, double end_ms,
+                                      int width_pixels, WaveformData& waveform) {
+    if (width_pixels <= 0) {
+        return false;
+    }
+    width_pixels = std::min(width_pixels, MAX_WAVEFORM_WIDTH);
+    
+    auto pyramid = get_waveform_pyramid(track_id);
+    if (!pyramid || pyramid->sample_rate() == 0) {
+        return false;
+    }
+    
+    const double frames_per_ms = pyramid->sample_rate() / 1000.0;
+    const uint64_t total_frames = pyramid->total_frames();
+    const uint64_t start_frame = std::min<uint64_t>(static_cast<uint64_t>(std::max(start_ms, 0.0) * frames_per_ms),
+                                                    total_frames);
+    const uint64_t end_frame = end_ms > 0.0
+        ? std::min<uint64_t>(static_cast<uint64_t>(end_ms * frames_per_ms), total_frames)
+        : total_frames;
+    
+    pyramid->render(start_frame, end_frame, width_pixels, waveform.peaks, waveform.rms);
+    waveform.sample_rate = static_cast<int>(pyramid->sample_rate());
+    waveform.samples_per_pixel = end_frame > start_frame ? static_cast<int>((end_frame - start_frame) / width_pixels) : 0;
+    waveform.duration_ms = pyramid->duration() * 1000.0;
+    waveform.current_position_ms = 0.0;
+    return true;
+}
+
+std::shared_ptr<const OneStopRadio::WaveformPyramid> RadioControl::get_waveform_pyramid(const std::string& track_id) {
+    std::lock_guard<std::mutex> lock(pyramid_mutex_);
+    auto it = pyramid_cache_.find(track_id);
+    if (it != pyramid_cache_.end()) {
+        return it->second;
+    }
+    
+    std::shared_ptr<const OneStopRadio::WaveformPyramid> pyramid =
+        OneStopRadio::WaveformPyramid::open((std::filesystem::path(waveform_dir_) / (track_id + ".osrwp")).string());
+    if (pyramid) {
+        pyramid_cache_[track_id] = pyramid;
+    }
+    return pyramid;
+}
+
 RadioControl::RealTimeAudioLevels RadioControl::get_real_time_levels() {
     RealTimeAudioLevels levels;
     
@@ -711,6 +1317,7 @@ bool RadioControl::stop_audio_monitoring() {
 // ===== RADIO STATION CONTROL =====
 
 bool RadioControl::start_broadcast() {
+    StateChange change(state_generation_);
     Logger::info("RadioControl: Starting broadcast");
     
     // Configure audio encoder with station settings
@@ -737,7 +1344,7 @@ bool RadioControl::start_broadcast() {
         return false;
     }
     
-    if (!audio_encoder_->start_streaming()) {
+    if (!audio_encoder_->start_streaming(audio_system_->create_master_bus_reader())) {
         Logger::error("RadioControl: Failed to start streaming");
         return false;
     }
@@ -757,6 +1364,7 @@ bool RadioControl::start_broadcast() {
 }
 
 bool RadioControl::stop_broadcast() {
+    StateChange change(state_generation_);
     Logger::info("RadioControl: Stopping broadcast");
     
     if (!audio_encoder_->stop_streaming()) {
@@ -819,9 +1427,25 @@ bool RadioControl::load_from_database() {
     
     // Load all tracks
     auto db_tracks = database_->get_all_tracks();
-    tracks_.clear();
-    for (const auto& track : db_tracks) {
-        tracks_[track.id] = track;
+    std::map<std::string, float> energies;
+    for (const auto& record : database_->get_analysis_jobs("done")) {
+        energies[record.track_id] = record.energy;
+    }
+    for (auto& track : db_tracks) {
+        auto energy = energies.find(track.id);
+        if (energy != energies.end()) {
+            track.energy = energy->second;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        tracks_.clear();
+        catalog_->clear();
+        recommendations_->clear();
+        for (const auto& track : db_tracks) {
+            tracks_[track.id] = track;
+            index_track(track);
+        }
     }
     
     // Load all playlists
@@ -838,6 +1462,17 @@ bool RadioControl::load_from_database() {
 
 // ===== PRIVATE HELPER METHODS =====
 
+void RadioControl::index_track(const RadioTrack& track) {
+    const OneStopRadio::TrackIndex index = catalog_->upsert(track);
+    recommendations_->update(index, catalog_->bpm(index), catalog_->key(index),
+                             track.is_analyzed ? track.energy : -1.0f);
+}
+
+void RadioControl::unindex_track(const std::string& track_id) {
+    recommendations_->remove(catalog_->find(track_id));
+    catalog_->remove(track_id);
+}
+
 std::string RadioControl::generate_track_id() {
     static std::random_device rd;
     static std::mt19937 gen(rd());
@@ -965,6 +1600,7 @@ json RadioControl::extract_metadata_from_file(const std::string& file_path) {
 // ===== CHANNEL CONTROL METHODS =====
 
 bool RadioControl::load_audio_file(const std::string& channel_id, const std::string& file_path) {
+    StateChange change(state_generation_);
     Logger::info("RadioControl: Loading audio file " + file_path + " into channel " + channel_id);
     
     if (!std::filesystem::exists(file_path)) {
@@ -999,7 +1635,11 @@ bool RadioControl::load_audio_file(const std::string& channel_id, const std::str
         track.is_loaded = true;
         
         // Store track info
-        tracks_[track.id] = track;
+        {
+            std::lock_guard<std::mutex> lock(library_mutex_);
+            tracks_[track.id] = track;
+            index_track(track);
+        }
         
         // Store channel mapping
         if (channel_id == "A") {
@@ -1017,6 +1657,7 @@ bool RadioControl::load_audio_file(const std::string& channel_id, const std::str
 }
 
 bool RadioControl::set_channel_playback(const std::string& channel_id, bool play) {
+    StateChange change(state_generation_);
     Logger::info("RadioControl: Setting channel " + channel_id + " playback to " + (play ? "play" : "pause"));
     
     // Use audio system to control playback
@@ -1038,6 +1679,7 @@ bool RadioControl::set_channel_playback(const std::string& channel_id, bool play
 }
 
 bool RadioControl::set_channel_volume(const std::string& channel_id, float volume) {
+    StateChange change(state_generation_);
     Logger::info("RadioControl: Setting channel " + channel_id + " volume to " + std::to_string(volume));
     
     // Clamp volume to valid range
@@ -1056,6 +1698,7 @@ bool RadioControl::set_channel_volume(const std::string& channel_id, float volum
 }
 
 bool RadioControl::set_channel_eq(const std::string& channel_id, float bass, float mid, float treble) {
+    StateChange change(state_generation_);
     Logger::info("RadioControl: Setting channel " + channel_id + " EQ - Bass: " + 
                  std::to_string(bass) + ", Mid: " + std::to_string(mid) + ", Treble: " + std::to_string(treble));
     
@@ -1076,6 +1719,30 @@ bool RadioControl::set_channel_eq(const std::string& channel_id, float bass, flo
     return success;
 }
 
+// ===== EFFECTS =====
+
+bool RadioControl::enable_master_limiter(bool enabled, float threshold) {
+    StateChange change(state_generation_);
+    bool success = audio_system_->set_limiter(enabled, threshold);
+    if (!success) {
+        Logger::error("RadioControl: Failed to set master limiter");
+    }
+    return success;
+}
+
+bool RadioControl::enable_master_compressor(bool enabled, float ratio, float threshold) {
+    StateChange change(state_generation_);
+    bool success = true;
+    if (enabled) {
+        success = audio_system_->set_compressor_settings("master", threshold, ratio, 10.0f, 100.0f);
+    }
+    success = audio_system_->enable_channel_compressor("master", enabled) && success;
+    if (!success) {
+        Logger::error("RadioControl: Failed to set master compressor");
+    }
+    return success;
+}
+
 WaveformData RadioControl::get_deck_waveform(const std::string& deck_id) {
     Logger::info("RadioControl: Getting waveform for deck " + deck_id);
     
@@ -1,165 +1,148 @@
 #include "../include/realtime_dj_processor.hpp"
+#include "../include/dsp_kernels.hpp"
+#include "../include/metrics_registry.hpp"
+#include "../include/trace_profiler.hpp"
 #include <cstring>
 #include <sstream>
 #include <iomanip>
 #include <json/json.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace OneStopRadio {
 
-// ThreeBandEQ Implementation
-AudioSample ThreeBandEQ::process(const AudioSample& input, const EQSettings& eq) {
-    AudioSample output = input;
-    
-    // Simple shelving EQ implementation
-    // Low frequency boost/cut (around 100Hz)
-    float low_gain = 1.0f + (eq.low * 0.5f); // ±50% gain
-    
-    // Mid frequency boost/cut (around 1kHz)  
-    float mid_gain = 1.0f + (eq.mid * 0.5f);
-    
-    // High frequency boost/cut (around 8kHz)
-    float high_gain = 1.0f + (eq.high * 0.5f);
-    
-    // Apply simple frequency weighting (basic approximation)
-    output.left = output.left * low_gain * 0.3f + 
-                  output.left * mid_gain * 0.4f + 
-                  output.left * high_gain * 0.3f;
-    
-    output.right = output.right * low_gain * 0.3f + 
-                   output.right * mid_gain * 0.4f + 
-                   output.right * high_gain * 0.3f;
-    
-    return output;
+// AudioBuffer samples are handed to the DSP kernels as interleaved stereo floats
+static_assert(sizeof(AudioSample) == 2 * sizeof(float), "AudioSample must be two packed floats");
+
+namespace {
+inline float* interleaved(AudioBuffer& buffer) {
+    return reinterpret_cast<float*>(buffer.samples.data());
+}
+inline const float* interleaved(const AudioBuffer& buffer) {
+    return reinterpret_cast<const float*>(buffer.samples.data());
+}
+
+BeatTrackerOptions liveDeckTrackerOptions(int sample_rate) {
+    BeatTrackerOptions options;
+    options.sample_rate = sample_rate;
+    return options;
+}
+
+struct DjMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    MetricHistogram& block_seconds = registry.histogram(
+        "onestop_dj_block_seconds", "DJ processor block run time",
+        MetricsRegistry::exponential_buckets(0.0000625, 2.0, 12));
+    MetricCounter& missed_deadlines = registry.counter(
+        "onestop_dj_missed_deadlines_total", "DJ processor blocks that finished after their deadline");
+};
+
+DjMetrics& dj_metrics() {
+    static DjMetrics metrics;
+    return metrics;
+}
+
+// DJ-mixer isolator: knobs kill their band, crossovers at the usual points
+DeckEqOptions isolatorOptions(int sample_rate) {
+    DeckEqOptions options;
+    options.sample_rate = sample_rate;
+    options.mode = DeckEqMode::ISOLATOR;
+    options.low_hz = 300.0f;
+    options.high_hz = 4000.0f;
+    return options;
 }
 
-void ThreeBandEQ::reset() {
-    left_state = FilterState();
-    right_state = FilterState();
+// EQ knobs run -1 (kill) through 0 (flat) to 1 (+6 dB)
+DeckEqSettings isolatorSettings(const EQSettings& eq) {
+    auto band = [](float knob) { return 1.0f + std::min(std::max(knob, -1.0f), 1.0f); };
+    DeckEqSettings settings;
+    settings.low = band(eq.low);
+    settings.mid = band(eq.mid);
+    settings.high = band(eq.high);
+    settings.filter = eq.filter;
+    return settings;
 }
+} // namespace
 
 // BeatDetector Implementation
+BeatDetector::BeatDetector(int sr, size_t /*bs*/)
+    : tracker(liveDeckTrackerOptions(sr)) {}
+
 void BeatDetector::process(const AudioBuffer& buffer) {
-    float energy = calculateEnergy(buffer);
-    
-    analysis.energy_history.push_back(energy);
-    
-    // Keep only recent history (about 10 seconds worth)
-    size_t max_history = (sample_rate / buffer_size) * 10;
-    if (analysis.energy_history.size() > max_history) {
-        analysis.energy_history.erase(analysis.energy_history.begin());
-    }
-    
-    // Detect onset
-    if (detectOnset(energy)) {
-        auto now = std::chrono::steady_clock::now();
-        float time_seconds = std::chrono::duration<float>(now.time_since_epoch()).count();
-        analysis.onset_times.push_back(time_seconds);
-        
-        // Keep only recent onsets
-        if (analysis.onset_times.size() > 32) {
-            analysis.onset_times.erase(analysis.onset_times.begin());
+    for (size_t offset = 0; offset < buffer.size(); offset += SCRATCH_FRAMES) {
+        const size_t n = std::min(SCRATCH_FRAMES, buffer.size() - offset);
+        for (size_t i = 0; i < n; ++i) {
+            const AudioSample& sample = buffer.samples[offset + i];
+            mono_scratch[i] = (sample.left + sample.right) * 0.5f;
         }
-        
-        // Update BPM estimate
-        analysis.current_bpm = estimateBPM();
-    }
-}
-
-float BeatDetector::calculateEnergy(const AudioBuffer& buffer) {
-    float energy = 0.0f;
-    for (const auto& sample : buffer.samples) {
-        float mono = (sample.left + sample.right) * 0.5f;
-        energy += mono * mono;
+        tracker.process(mono_scratch, n);
     }
-    return energy / buffer.samples.size();
 }
 
-bool BeatDetector::detectOnset(float current_energy) {
-    if (analysis.energy_history.size() < 10) return false;
-    
-    // Simple onset detection: current energy significantly higher than recent average
-    float recent_avg = 0.0f;
-    size_t start_idx = std::max(0, (int)analysis.energy_history.size() - 10);
-    
-    for (size_t i = start_idx; i < analysis.energy_history.size() - 1; ++i) {
-        recent_avg += analysis.energy_history[i];
-    }
-    recent_avg /= (analysis.energy_history.size() - 1 - start_idx);
-    
-    return current_energy > recent_avg * 1.5f; // 50% increase threshold
+void BeatDetector::processMono(const float* mono, size_t frames) {
+    tracker.process(mono, frames);
 }
 
-float BeatDetector::estimateBPM() {
-    if (analysis.onset_times.size() < 4) return analysis.current_bpm;
-    
-    std::vector<float> intervals;
-    for (size_t i = 1; i < analysis.onset_times.size(); ++i) {
-        intervals.push_back(analysis.onset_times[i] - analysis.onset_times[i-1]);
+// LevelMeter Implementation
+LevelMeter::LevelMeter(size_t window_size)
+    : rms_window_size(std::max<size_t>(1, window_size)),
+      rms_window_left(rms_window_size, 0.0f),
+      rms_window_right(rms_window_size, 0.0f) {}
+
+inline void LevelMeter::accumulate(float left, float right) {
+    // Update peaks
+    float abs_left = std::abs(left);
+    float abs_right = std::abs(right);
+    
+    if (abs_left > peak_left) peak_left = abs_left;
+    if (abs_right > peak_right) peak_right = abs_right;
+    
+    // Apply peak decay
+    peak_left *= peak_decay_rate;
+    peak_right *= peak_decay_rate;
+    
+    // Slide the RMS window, evicting the oldest sample once full
+    const float sq_left = abs_left * abs_left;
+    const float sq_right = abs_right * abs_right;
+    if (rms_count == rms_window_size) {
+        rms_sum_left -= rms_window_left[rms_write_pos];
+        rms_sum_right -= rms_window_right[rms_write_pos];
+    } else {
+        ++rms_count;
     }
+    rms_window_left[rms_write_pos] = sq_left;
+    rms_window_right[rms_write_pos] = sq_right;
+    rms_sum_left += sq_left;
+    rms_sum_right += sq_right;
     
-    if (intervals.empty()) return analysis.current_bpm;
-    
-    // Calculate median interval
-    std::sort(intervals.begin(), intervals.end());
-    float median_interval = intervals[intervals.size() / 2];
-    
-    // Convert to BPM
-    float bpm = 60.0f / median_interval;
-    
-    // Filter unrealistic BPM values
-    if (bpm >= 60.0f && bpm <= 200.0f) {
-        return bpm;
+    if (++rms_write_pos == rms_window_size) {
+        rms_write_pos = 0;
     }
-    
-    return analysis.current_bpm;
-}
-
-float BeatDetector::getBeatPosition() const {
-    // Simplified beat position calculation
-    return std::fmod(std::chrono::duration<float>(
-        std::chrono::steady_clock::now().time_since_epoch()).count() * 
-        (analysis.current_bpm / 60.0f), 1.0f);
 }
 
-void BeatDetector::reset() {
-    analysis = BeatAnalysis();
+void LevelMeter::updateRMS() {
+    // Calculate RMS
+    if (rms_count > 0) {
+        rms_left = std::sqrt(std::max(0.0f, rms_sum_left) / rms_count);
+        rms_right = std::sqrt(std::max(0.0f, rms_sum_right) / rms_count);
+    }
 }
 
-// LevelMeter Implementation
 void LevelMeter::process(const AudioBuffer& buffer) {
     for (const auto& sample : buffer.samples) {
-        // Update peaks
-        float abs_left = std::abs(sample.left);
-        float abs_right = std::abs(sample.right);
-        
-        if (abs_left > peak_left) peak_left = abs_left;
-        if (abs_right > peak_right) peak_right = abs_right;
-        
-        // Apply peak decay
-        peak_left *= peak_decay_rate;
-        peak_right *= peak_decay_rate;
-        
-        // Update RMS calculation
-        rms_buffer_left.push(abs_left * abs_left);
-        rms_buffer_right.push(abs_right * abs_right);
-        
-        rms_sum_left += abs_left * abs_left;
-        rms_sum_right += abs_right * abs_right;
-        
-        // Remove old samples from RMS window
-        if (rms_buffer_left.size() > rms_window_size) {
-            rms_sum_left -= rms_buffer_left.front();
-            rms_sum_right -= rms_buffer_right.front();
-            rms_buffer_left.pop();
-            rms_buffer_right.pop();
-        }
-        
-        // Calculate RMS
-        if (!rms_buffer_left.empty()) {
-            rms_left = std::sqrt(rms_sum_left / rms_buffer_left.size());
-            rms_right = std::sqrt(rms_sum_right / rms_buffer_right.size());
-        }
+        accumulate(sample.left, sample.right);
+    }
+    updateRMS();
+}
+
+void LevelMeter::processPlanar(const float* left, const float* right, size_t frames) {
+    for (size_t i = 0; i < frames; ++i) {
+        accumulate(left[i], right[i]);
     }
+    updateRMS();
 }
 
 AudioLevels LevelMeter::getLevels() const {
@@ -176,18 +159,17 @@ void LevelMeter::reset() {
     peak_left = peak_right = 0.0f;
     rms_left = rms_right = 0.0f;
     rms_sum_left = rms_sum_right = 0.0f;
-    while (!rms_buffer_left.empty()) rms_buffer_left.pop();
-    while (!rms_buffer_right.empty()) rms_buffer_right.pop();
+    std::fill(rms_window_left.begin(), rms_window_left.end(), 0.0f);
+    std::fill(rms_window_right.begin(), rms_window_right.end(), 0.0f);
+    rms_write_pos = 0;
+    rms_count = 0;
 }
 
 // Crossfader Implementation  
 AudioSample Crossfader::mix(const AudioSample& channel_a, const AudioSample& channel_b, 
                            float crossfader_position) {
-    // Normalize position to 0.0-1.0 range (0=A, 1=B)
-    float normalized_pos = (crossfader_position + 1.0f) * 0.5f;
-    
-    float gain_a = applyCurve(1.0f - normalized_pos, 1.0f);
-    float gain_b = applyCurve(normalized_pos, 1.0f);
+    float gain_a, gain_b;
+    getGains(crossfader_position, gain_a, gain_b);
     
     return AudioSample(
         channel_a.left * gain_a + channel_b.left * gain_b,
@@ -195,6 +177,14 @@ AudioSample Crossfader::mix(const AudioSample& channel_a, const AudioSample& cha
     );
 }
 
+void Crossfader::getGains(float crossfader_position, float& gain_a, float& gain_b) {
+    // Normalize position to 0.0-1.0 range (0=A, 1=B)
+    float normalized_pos = (crossfader_position + 1.0f) * 0.5f;
+    
+    gain_a = applyCurve(1.0f - normalized_pos, 1.0f);
+    gain_b = applyCurve(normalized_pos, 1.0f);
+}
+
 float Crossfader::applyCurve(float position, float input_gain) {
     switch (curve_type) {
         case LINEAR:
@@ -216,18 +206,21 @@ float Crossfader::applyCurve(float position, float input_gain) {
 
 // RealtimeDJProcessor Implementation
 RealtimeDJProcessor::RealtimeDJProcessor(int sr, size_t bs) 
-    : sample_rate(sr), buffer_size(bs),
-      deck_a_buffer(bs, sr), deck_b_buffer(bs, sr), master_buffer(bs, sr) {
+    : sample_rate(sr), buffer_size(bs), master_buffer(bs, sr) {
+    
+    allocateBuffers();
     
     // Initialize audio processing components
-    eq_a = std::make_unique<ThreeBandEQ>(sample_rate);
-    eq_b = std::make_unique<ThreeBandEQ>(sample_rate);
+    deck_eq = std::make_unique<DeckEqualizer>(isolatorOptions(sample_rate));
     beat_detector_a = std::make_unique<BeatDetector>(sample_rate, buffer_size);
     beat_detector_b = std::make_unique<BeatDetector>(sample_rate, buffer_size);
     level_meter_a = std::make_unique<LevelMeter>();
     level_meter_b = std::make_unique<LevelMeter>();
     master_meter = std::make_unique<LevelMeter>();
     crossfader = std::make_unique<Crossfader>();
+    DynamicsOptions dynamics_options;
+    dynamics_options.sample_rate = sample_rate;
+    master_dynamics = std::make_unique<DynamicsProcessor>(dynamics_options);
     
     std::cout << "🎧 Real-time DJ Processor initialized" << std::endl;
     std::cout << "   Sample Rate: " << sample_rate << " Hz" << std::endl;
@@ -245,13 +238,23 @@ void RealtimeDJProcessor::start() {
     processing_active.store(true);
     last_process_time = std::chrono::steady_clock::now();
     
-    processing_thread = std::thread(&RealtimeDJProcessor::processingLoop, this);
+    if (clock_mode == INTERNAL_CLOCK) {
+        processing_thread = std::thread(&RealtimeDJProcessor::processingLoop, this);
+    } else {
+        // Blocks arrive from the device callback; this thread only publishes updates
+        processing_thread = std::thread(&RealtimeDJProcessor::updateLoop, this);
+    }
     
-    std::cout << "🎵 Real-time DJ processing started" << std::endl;
+    std::cout << "🎵 Real-time DJ processing started ("
+              << (clock_mode == INTERNAL_CLOCK ? "internal clock" : "external callback") << ")" << std::endl;
 }
 
 void RealtimeDJProcessor::stop() {
-    processing_active.store(false);
+    {
+        std::lock_guard<std::mutex> lock(clock_mutex);
+        processing_active.store(false);
+    }
+    clock_cv.notify_all();
     
     if (processing_thread.joinable()) {
         processing_thread.join();
@@ -260,133 +263,376 @@ void RealtimeDJProcessor::stop() {
     std::cout << "⏹️ Real-time DJ processing stopped" << std::endl;
 }
 
+void RealtimeDJProcessor::setClockMode(ClockMode mode) {
+    if (processing_active.load()) {
+        std::cerr << "⚠️ Cannot change clock mode while processing is running" << std::endl;
+        return;
+    }
+    clock_mode = mode;
+}
+
+std::chrono::microseconds RealtimeDJProcessor::blockPeriod() const {
+    return std::chrono::microseconds((static_cast<int64_t>(buffer_size) * 1000000) / sample_rate);
+}
+
+bool RealtimeDJProcessor::promoteToRealtime() {
+#if defined(__unix__) || defined(__APPLE__)
+    sched_param param{};
+    param.sched_priority = realtime_priority;
+    int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result != 0) {
+        std::cerr << "⚠️ Could not enable real-time priority for DJ processing (error "
+                  << result << "); running with normal scheduling" << std::endl;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
 void RealtimeDJProcessor::processingLoop() {
+    stat_realtime.store(promoteToRealtime());
+    TRACE_THREAD_NAME("dj_processing");
+    
+    const auto period = blockPeriod();
+    auto deadline = std::chrono::steady_clock::now() + period;
+    
+    std::unique_lock<std::mutex> lock(clock_mutex);
     while (processing_active.load()) {
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
-            now - last_process_time).count();
+        // Sleep until the absolute deadline so scheduling jitter doesn't accumulate
+        if (clock_cv.wait_until(lock, deadline, [this] { return !processing_active.load(); })) {
+            break;
+        }
+        lock.unlock();
         
-        // Process at consistent intervals based on buffer size
-        int target_interval_us = (buffer_size * 1000000) / sample_rate;
+        const auto wake_time = std::chrono::steady_clock::now();
+        const bool woke_late = wake_time - deadline > period;
         
-        if (elapsed >= target_interval_us) {
+        {
+            TRACE_SCOPE("dj_block");
             processAudioBuffer();
             updateSyncAndBPM();
+        }
+        
+        const auto done = std::chrono::steady_clock::now();
+        recordBlockTiming(std::chrono::duration<double, std::micro>(done - wake_time).count(),
+                          woke_late || done > deadline + period);
+        
+        {
+            TRACE_SCOPE("dj_update");
             sendRealtimeUpdate();
-            
-            last_process_time = now;
+        }
+        last_process_time = wake_time;
+        
+        deadline += period;
+        if (done > deadline) {
+            // Fell behind by more than a block; skip ahead rather than bursting to catch up
+            deadline = done + period;
         }
         
-        // Small sleep to prevent CPU spinning
-        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        lock.lock();
     }
 }
 
-void RealtimeDJProcessor::processAudioBuffer() {
-    // Clear output buffer
-    master_buffer.clear();
-    
-    // Process Deck A
-    AudioBuffer processed_a = deck_a_buffer;
-    if (deck_a.is_playing) {
-        // Apply EQ
-        for (auto& sample : processed_a.samples) {
-            sample = processEQ(sample, deck_a.eq, *eq_a);
-        }
-        
-        // Apply volume
-        for (auto& sample : processed_a.samples) {
-            sample = sample * deck_a.volume;
+void RealtimeDJProcessor::updateLoop() {
+    TRACE_THREAD_NAME("dj_updates");
+    const auto period = blockPeriod();
+    auto deadline = std::chrono::steady_clock::now() + period;
+    
+    std::unique_lock<std::mutex> lock(clock_mutex);
+    while (processing_active.load()) {
+        if (clock_cv.wait_until(lock, deadline, [this] { return !processing_active.load(); })) {
+            break;
         }
+        lock.unlock();
         
-        // Update levels and beat detection
-        level_meter_a->process(processed_a);
-        beat_detector_a->process(processed_a);
-        
-        // Update deck state
+        // JSON and WebSocket work stays off the device callback
         {
-            std::lock_guard<std::mutex> lock(deck_a.state_mutex);
-            deck_a.levels = level_meter_a->getLevels();
-            deck_a.detected_bpm = beat_detector_a->getCurrentBPM();
-            deck_a.beat_position = beat_detector_a->getBeatPosition();
+            TRACE_SCOPE("dj_update");
+            sendRealtimeUpdate();
         }
+        
+        deadline = std::max(deadline + period, std::chrono::steady_clock::now());
+        lock.lock();
     }
+}
+
+void RealtimeDJProcessor::processBlock() {
+    if (!processing_active.load()) return;
     
-    // Process Deck B
-    AudioBuffer processed_b = deck_b_buffer;
-    if (deck_b.is_playing) {
-        // Apply EQ
-        for (auto& sample : processed_b.samples) {
-            sample = processEQ(sample, deck_b.eq, *eq_b);
-        }
+    TRACE_SCOPE("dj_block");
+    const auto begin = std::chrono::steady_clock::now();
+    
+    processAudioBuffer();
+    updateSyncAndBPM();
+    
+    const double elapsed_us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - begin).count();
+    const double budget_us = static_cast<double>(blockPeriod().count());
+    recordBlockTiming(elapsed_us, elapsed_us > budget_us);
+    last_process_time = begin;
+}
+
+void RealtimeDJProcessor::recordBlockTiming(double elapsed_us, bool late) {
+    const uint64_t blocks = stat_blocks.fetch_add(1) + 1;
+    DjMetrics& metrics = dj_metrics();
+    metrics.block_seconds.observe(elapsed_us * 1e-6);
+    if (late) {
+        stat_missed.fetch_add(1);
+        metrics.missed_deadlines.increment();
+    }
+    
+    stat_last_us.store(elapsed_us);
+    const double previous_avg = stat_avg_us.load();
+    stat_avg_us.store(blocks == 1 ? elapsed_us : previous_avg + (elapsed_us - previous_avg) * 0.05);
+    if (elapsed_us > stat_max_us.load()) {
+        stat_max_us.store(elapsed_us);
+    }
+}
+
+ProcessingStats RealtimeDJProcessor::getProcessingStats() const {
+    ProcessingStats stats;
+    stats.blocks_processed = stat_blocks.load();
+    stats.missed_deadlines = stat_missed.load();
+    stats.budget_us = static_cast<double>(blockPeriod().count());
+    stats.last_processing_us = stat_last_us.load();
+    stats.avg_processing_us = stat_avg_us.load();
+    stats.max_processing_us = stat_max_us.load();
+    stats.load = stats.budget_us > 0.0 ? stats.avg_processing_us / stats.budget_us : 0.0;
+    stats.realtime_priority = stat_realtime.load();
+    return stats;
+}
+
+void RealtimeDJProcessor::resetProcessingStats() {
+    stat_blocks.store(0);
+    stat_missed.store(0);
+    stat_last_us.store(0.0);
+    stat_avg_us.store(0.0);
+    stat_max_us.store(0.0);
+}
+
+size_t RealtimeDJProcessor::readMasterOutput(float* interleaved_out, size_t frames) const {
+    auto lock = lockBlockBuffers();
+    const size_t available = std::min(frames, buffers.master.size());
+    dsp::interleave_stereo(buffers.master.left.data(), buffers.master.right.data(), interleaved_out, available);
+    return available;
+}
+
+std::unique_lock<std::mutex> RealtimeDJProcessor::lockBlockBuffers() const {
+    // The device callback feeds, runs and drains blocks itself
+    if (clock_mode == EXTERNAL_CALLBACK) {
+        return std::unique_lock<std::mutex>(buffer_mutex, std::defer_lock);
+    }
+    return std::unique_lock<std::mutex>(buffer_mutex);
+}
+
+void RealtimeDJProcessor::DeckParams::setEQ(const EQSettings& eq) {
+    eq_low.store(eq.low, std::memory_order_relaxed);
+    eq_mid.store(eq.mid, std::memory_order_relaxed);
+    eq_high.store(eq.high, std::memory_order_relaxed);
+    eq_filter.store(eq.filter, std::memory_order_relaxed);
+}
+
+EQSettings RealtimeDJProcessor::DeckParams::eq() const {
+    // Bands may come from different updates for one block; the EQ smooths toward them anyway
+    EQSettings settings;
+    settings.low = eq_low.load(std::memory_order_relaxed);
+    settings.mid = eq_mid.load(std::memory_order_relaxed);
+    settings.high = eq_high.load(std::memory_order_relaxed);
+    settings.filter = eq_filter.load(std::memory_order_relaxed);
+    return settings;
+}
+
+void RealtimeDJProcessor::LevelTaps::store(const AudioLevels& levels) {
+    peak_left.store(levels.peak_left, std::memory_order_relaxed);
+    peak_right.store(levels.peak_right, std::memory_order_relaxed);
+    rms_left.store(levels.rms_left, std::memory_order_relaxed);
+    rms_right.store(levels.rms_right, std::memory_order_relaxed);
+}
+
+AudioLevels RealtimeDJProcessor::LevelTaps::load() const {
+    AudioLevels levels;
+    levels.peak_left = peak_left.load(std::memory_order_relaxed);
+    levels.peak_right = peak_right.load(std::memory_order_relaxed);
+    levels.rms_left = rms_left.load(std::memory_order_relaxed);
+    levels.rms_right = rms_right.load(std::memory_order_relaxed);
+    return levels;
+}
+
+void RealtimeDJProcessor::allocateBuffers() {
+    buffers.deck_a_input.resize(buffer_size);
+    buffers.deck_b_input.resize(buffer_size);
+    buffers.master.resize(buffer_size);
+    master_buffer = AudioBuffer(buffer_size, sample_rate);
+}
+
+void RealtimeDJProcessor::processAudioBuffer() {
+    // Snapshot deck and mixer settings once per buffer, without locking
+    const bool playing_a = params_a.playing.load(std::memory_order_relaxed);
+    const bool playing_b = params_b.playing.load(std::memory_order_relaxed);
+    const float volume_a = params_a.volume.load(std::memory_order_relaxed);
+    const float volume_b = params_b.volume.load(std::memory_order_relaxed);
+    const float master_volume = param_master_volume.load(std::memory_order_relaxed);
+    
+    // Channel, crossfader and master gains fold into one mix gain per deck
+    float fader_a, fader_b;
+    crossfader->getGains(param_crossfader.load(std::memory_order_relaxed), fader_a, fader_b);
+    const float mix_gain_a = params_a.channel_volume.load(std::memory_order_relaxed) * fader_a * master_volume;
+    const float mix_gain_b = params_b.channel_volume.load(std::memory_order_relaxed) * fader_b * master_volume;
+    
+    auto lock = lockBlockBuffers();
+    
+    // New EQ settings are targets; the equalizer smooths toward them
+    deck_eq->set(0, isolatorSettings(params_a.eq()));
+    deck_eq->set(1, isolatorSettings(params_b.eq()));
+    
+    PlanarBuffer& input_a = buffers.deck_a_input;
+    PlanarBuffer& input_b = buffers.deck_b_input;
+    PlanarBuffer& master = buffers.master;
+    const size_t frames = master.size();
+    
+    // Fused pipeline: each sub-block runs EQ + gain, metering and the
+    // crossfade while its working set is still in L1
+    for (size_t offset = 0; offset < frames; offset += FUSED_BLOCK_FRAMES) {
+        const size_t n = std::min(FUSED_BLOCK_FRAMES, frames - offset);
+        float* a_left = buffers.deck_a_left;
+        float* a_right = buffers.deck_a_right;
+        float* b_left = buffers.deck_b_left;
+        float* b_right = buffers.deck_b_right;
         
-        // Apply volume
-        for (auto& sample : processed_b.samples) {
-            sample = sample * deck_b.volume;
+        // EQ and deck volume; both decks share one pass through the EQ
+        if (deck_eq->active()) {
+            float* lanes = buffers.eq_lanes;
+            const float* in_a_left = input_a.left.data() + offset;
+            const float* in_a_right = input_a.right.data() + offset;
+            const float* in_b_left = input_b.left.data() + offset;
+            const float* in_b_right = input_b.right.data() + offset;
+            for (size_t i = 0; i < n; ++i) {
+                lanes[4 * i] = playing_a ? in_a_left[i] : 0.0f;
+                lanes[4 * i + 1] = playing_a ? in_a_right[i] : 0.0f;
+                lanes[4 * i + 2] = playing_b ? in_b_left[i] : 0.0f;
+                lanes[4 * i + 3] = playing_b ? in_b_right[i] : 0.0f;
+            }
+            deck_eq->process(lanes, n);
+            for (size_t i = 0; i < n; ++i) {
+                a_left[i] = lanes[4 * i] * volume_a;
+                a_right[i] = lanes[4 * i + 1] * volume_a;
+                b_left[i] = lanes[4 * i + 2] * volume_b;
+                b_right[i] = lanes[4 * i + 3] * volume_b;
+            }
+        } else {
+            auto copyDeck = [n](bool playing, const float* left, const float* right,
+                                float* out_left, float* out_right, float volume) {
+                for (size_t i = 0; i < n; ++i) {
+                    out_left[i] = playing ? left[i] * volume : 0.0f;
+                    out_right[i] = playing ? right[i] * volume : 0.0f;
+                }
+            };
+            copyDeck(playing_a, input_a.left.data() + offset, input_a.right.data() + offset,
+                     a_left, a_right, volume_a);
+            copyDeck(playing_b, input_b.left.data() + offset, input_b.right.data() + offset,
+                     b_left, b_right, volume_b);
         }
         
-        // Update levels and beat detection
-        level_meter_b->process(processed_b);
-        beat_detector_b->process(processed_b);
-        
-        // Update deck state
-        {
-            std::lock_guard<std::mutex> lock(deck_b.state_mutex);
-            deck_b.levels = level_meter_b->getLevels();
-            deck_b.detected_bpm = beat_detector_b->getCurrentBPM();
-            deck_b.beat_position = beat_detector_b->getBeatPosition();
+        // Deck meters
+        if (playing_a) {
+            level_meter_a->processPlanar(a_left, a_right, n);
         }
-    }
-    
-    // Mix channels through crossfader
-    for (size_t i = 0; i < master_buffer.size(); ++i) {
-        AudioSample deck_a_sample = deck_a.is_playing ? processed_a.samples[i] : AudioSample();
-        AudioSample deck_b_sample = deck_b.is_playing ? processed_b.samples[i] : AudioSample();
-        
-        // Apply channel volumes
-        {
-            std::lock_guard<std::mutex> lock(mixer.mixer_mutex);
-            deck_a_sample = deck_a_sample * mixer.channel_a_volume;
-            deck_b_sample = deck_b_sample * mixer.channel_b_volume;
+        if (playing_b) {
+            level_meter_b->processPlanar(b_left, b_right, n);
         }
         
-        // Crossfade
-        master_buffer.samples[i] = crossfader->mix(deck_a_sample, deck_b_sample, 
-                                                  mixer.crossfader);
+        // Crossfade into the master bus, downmixing each deck for its beat tracker on the way
+        float* out_left = master.left.data() + offset;
+        float* out_right = master.right.data() + offset;
+        float* mono_a = buffers.deck_a_mono;
+        float* mono_b = buffers.deck_b_mono;
+        for (size_t i = 0; i < n; ++i) {
+            mono_a[i] = (a_left[i] + a_right[i]) * 0.5f;
+            mono_b[i] = (b_left[i] + b_right[i]) * 0.5f;
+            
+            out_left[i] = a_left[i] * mix_gain_a + b_left[i] * mix_gain_b;
+            out_right[i] = a_right[i] * mix_gain_a + b_right[i] * mix_gain_b;
+        }
+        if (playing_a) {
+            beat_detector_a->processMono(mono_a, n);
+        }
+        if (playing_b) {
+            beat_detector_b->processMono(mono_b, n);
+        }
         
-        // Apply master volume
-        master_buffer.samples[i] = master_buffer.samples[i] * mixer.master_volume;
+        // Limit, then meter what goes out
+        master_dynamics->process_planar(out_left, out_right, n);
+        master_meter->processPlanar(out_left, out_right, n);
     }
     
-    // Update master levels
-    master_meter->process(master_buffer);
-    
-    {
-        std::lock_guard<std::mutex> lock(mixer.mixer_mutex);
-        mixer.master_levels = master_meter->getLevels();
+    // Interleaved copy for getMasterOutput(); the device thread skips it rather than wait
+    std::unique_lock<std::mutex> copy_lock(buffer_mutex, std::defer_lock);
+    if (lock.owns_lock() || copy_lock.try_lock()) {
+        dsp::interleave_stereo(master.left.data(), master.right.data(), interleaved(master_buffer),
+                               std::min(frames, master_buffer.size()));
     }
     
-    // Apply soft limiting to prevent clipping
-    AudioUtils::applySoftLimiter(master_buffer);
+    // Publish what was measured
+    if (playing_a && frames > 0) {
+        taps_a.levels.store(level_meter_a->getLevels());
+        taps_a.bpm.store(beat_detector_a->getCurrentBPM(), std::memory_order_relaxed);
+        taps_a.beat_position.store(beat_detector_a->getBeatPosition(), std::memory_order_relaxed);
+    }
+    if (playing_b && frames > 0) {
+        taps_b.levels.store(level_meter_b->getLevels());
+        taps_b.bpm.store(beat_detector_b->getCurrentBPM(), std::memory_order_relaxed);
+        taps_b.beat_position.store(beat_detector_b->getBeatPosition(), std::memory_order_relaxed);
+    }
+    master_taps.store(master_meter->getLevels());
+}
+
+void RealtimeDJProcessor::processAudioInput(const AudioBuffer& input_a, const AudioBuffer& input_b) {
+    auto lock = lockBlockBuffers();
+    
+    // Deinterleave into the preallocated planar inputs; short inputs are zero padded
+    auto load = [](const AudioBuffer& source, PlanarBuffer& target) {
+        const size_t frames = std::min(source.size(), target.size());
+        dsp::deinterleave_stereo(interleaved(source), target.left.data(), target.right.data(), frames);
+        std::fill(target.left.begin() + frames, target.left.end(), 0.0f);
+        std::fill(target.right.begin() + frames, target.right.end(), 0.0f);
+    };
+    load(input_a, buffers.deck_a_input);
+    load(input_b, buffers.deck_b_input);
+}
+
+AudioBuffer RealtimeDJProcessor::getMasterOutput() const {
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    return master_buffer;
 }
 
-AudioSample RealtimeDJProcessor::processEQ(const AudioSample& input, const EQSettings& eq, 
-                                          ThreeBandEQ& eq_filter) {
-    return eq_filter.process(input, eq);
+void RealtimeDJProcessor::setBufferSize(size_t bs) {
+    if (processing_active.load()) {
+        std::cerr << "⚠️ Cannot change buffer size while processing is running" << std::endl;
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    buffer_size = bs;
+    allocateBuffers();
+    beat_detector_a = std::make_unique<BeatDetector>(sample_rate, buffer_size);
+    beat_detector_b = std::make_unique<BeatDetector>(sample_rate, buffer_size);
 }
 
 void RealtimeDJProcessor::updateSyncAndBPM() {
-    if (!mixer.sync_enabled) return;
+    if (!param_sync.load(std::memory_order_relaxed)) return;
     
     // Simple sync implementation
-    float bpm_a = deck_a.detected_bpm > 0 ? deck_a.detected_bpm : deck_a.manual_bpm;
-    float bpm_b = deck_b.detected_bpm > 0 ? deck_b.detected_bpm : deck_b.manual_bpm;
+    auto deck_bpm = [](const DeckTaps& taps, const DeckParams& params) {
+        const float detected = taps.bpm.load(std::memory_order_relaxed);
+        return detected > 0 ? detected : params.manual_bpm.load(std::memory_order_relaxed);
+    };
+    const float bpm_a = deck_bpm(taps_a, params_a);
+    const float bpm_b = deck_bpm(taps_b, params_b);
     
     if (bpm_a > 0 && bpm_b > 0) {
-        float avg_bpm = (bpm_a + bpm_b) * 0.5f;
-        
-        std::lock_guard<std::mutex> lock(mixer.mixer_mutex);
-        mixer.master_bpm = avg_bpm;
+        tap_master_bpm.store((bpm_a + bpm_b) * 0.5f, std::memory_order_relaxed);
     }
 }
 
@@ -404,32 +650,40 @@ void RealtimeDJProcessor::sendRealtimeUpdate() {
         std::lock_guard<std::mutex> lock(deck_a.state_mutex);
         update["deck_a"]["playing"] = deck_a.is_playing;
         update["deck_a"]["position"] = deck_a.position;
-        update["deck_a"]["bpm"] = deck_a.detected_bpm;
-        update["deck_a"]["beat_position"] = deck_a.beat_position;
-        update["deck_a"]["levels"]["peak_left"] = deck_a.levels.peak_left;
-        update["deck_a"]["levels"]["peak_right"] = deck_a.levels.peak_right;
     }
+    update["deck_a"]["bpm"] = taps_a.bpm.load(std::memory_order_relaxed);
+    update["deck_a"]["beat_position"] = taps_a.beat_position.load(std::memory_order_relaxed);
+    update["deck_a"]["levels"]["peak_left"] = taps_a.levels.peak_left.load(std::memory_order_relaxed);
+    update["deck_a"]["levels"]["peak_right"] = taps_a.levels.peak_right.load(std::memory_order_relaxed);
     
     // Deck B state  
     {
         std::lock_guard<std::mutex> lock(deck_b.state_mutex);
         update["deck_b"]["playing"] = deck_b.is_playing;
         update["deck_b"]["position"] = deck_b.position;
-        update["deck_b"]["bpm"] = deck_b.detected_bpm;
-        update["deck_b"]["beat_position"] = deck_b.beat_position;
-        update["deck_b"]["levels"]["peak_left"] = deck_b.levels.peak_left;
-        update["deck_b"]["levels"]["peak_right"] = deck_b.levels.peak_right;
     }
+    update["deck_b"]["bpm"] = taps_b.bpm.load(std::memory_order_relaxed);
+    update["deck_b"]["beat_position"] = taps_b.beat_position.load(std::memory_order_relaxed);
+    update["deck_b"]["levels"]["peak_left"] = taps_b.levels.peak_left.load(std::memory_order_relaxed);
+    update["deck_b"]["levels"]["peak_right"] = taps_b.levels.peak_right.load(std::memory_order_relaxed);
+    
+    // Processing clock health
+    const ProcessingStats stats = getProcessingStats();
+    update["processing"]["blocks"] = static_cast<Json::UInt64>(stats.blocks_processed);
+    update["processing"]["missed_deadlines"] = static_cast<Json::UInt64>(stats.missed_deadlines);
+    update["processing"]["avg_us"] = stats.avg_processing_us;
+    update["processing"]["max_us"] = stats.max_processing_us;
+    update["processing"]["load"] = stats.load;
     
     // Mixer state
     {
         std::lock_guard<std::mutex> lock(mixer.mixer_mutex);
         update["mixer"]["crossfader"] = mixer.crossfader;
         update["mixer"]["master_volume"] = mixer.master_volume;
-        update["mixer"]["master_bpm"] = mixer.master_bpm;
-        update["mixer"]["levels"]["peak_left"] = mixer.master_levels.peak_left;
-        update["mixer"]["levels"]["peak_right"] = mixer.master_levels.peak_right;
     }
+    update["mixer"]["master_bpm"] = tap_master_bpm.load(std::memory_order_relaxed);
+    update["mixer"]["levels"]["peak_left"] = master_taps.peak_left.load(std::memory_order_relaxed);
+    update["mixer"]["levels"]["peak_right"] = master_taps.peak_right.load(std::memory_order_relaxed);
     
     Json::StreamWriterBuilder builder;
     std::string json_string = Json::writeString(builder, update);
@@ -448,6 +702,7 @@ void RealtimeDJProcessor::loadTrack(const std::string& deck, const std::string&
     deck_ref.track_artist = artist;
     deck_ref.position = 0.0f;
     deck_ref.is_playing = false;
+    getDeckParams(deck).playing.store(false, std::memory_order_relaxed);
     
     std::cout << "🎵 Loaded track on deck " << deck << ": " << title << " - " << artist << std::endl;
 }
@@ -457,6 +712,7 @@ void RealtimeDJProcessor::playDeck(const std::string& deck) {
     std::lock_guard<std::mutex> lock(deck_ref.state_mutex);
     
     deck_ref.is_playing = true;
+    getDeckParams(deck).playing.store(true, std::memory_order_relaxed);
     std::cout << "▶️ Playing deck " << deck << std::endl;
 }
 
@@ -465,6 +721,7 @@ void RealtimeDJProcessor::pauseDeck(const std::string& deck) {
     std::lock_guard<std::mutex> lock(deck_ref.state_mutex);
     
     deck_ref.is_playing = false;
+    getDeckParams(deck).playing.store(false, std::memory_order_relaxed);
     std::cout << "⏸️ Paused deck " << deck << std::endl;
 }
 
@@ -474,17 +731,20 @@ void RealtimeDJProcessor::stopDeck(const std::string& deck) {
     
     deck_ref.is_playing = false;
     deck_ref.position = 0.0f;
+    getDeckParams(deck).playing.store(false, std::memory_order_relaxed);
     std::cout << "⏹️ Stopped deck " << deck << std::endl;
 }
 
 void RealtimeDJProcessor::setCrossfader(float position) {
     std::lock_guard<std::mutex> lock(mixer.mixer_mutex);
     mixer.crossfader = std::clamp(position, -1.0f, 1.0f);
+    param_crossfader.store(mixer.crossfader, std::memory_order_relaxed);
 }
 
 void RealtimeDJProcessor::setMasterVolume(float volume) {
     std::lock_guard<std::mutex> lock(mixer.mixer_mutex);
     mixer.master_volume = std::clamp(volume, 0.0f, 1.0f);
+    param_master_volume.store(mixer.master_volume, std::memory_order_relaxed);
 }
 
 DeckState& RealtimeDJProcessor::getDeckRef(const std::string& deck) {
@@ -495,6 +755,10 @@ const DeckState& RealtimeDJProcessor::getDeckRef(const std::string& deck) const
     return (deck == "A" || deck == "a") ? deck_a : deck_b;
 }
 
+RealtimeDJProcessor::DeckParams& RealtimeDJProcessor::getDeckParams(const std::string& deck) {
+    return (deck == "A" || deck == "a") ? params_a : params_b;
+}
+
 void RealtimeDJProcessor::setWebSocketCallback(std::function<void(const std::string&)> callback) {
     websocket_callback = callback;
 }
@@ -511,30 +775,17 @@ namespace AudioUtils {
     }
     
     void applyGainRamp(AudioBuffer& buffer, float start_gain, float end_gain) {
-        size_t samples = buffer.samples.size();
-        for (size_t i = 0; i < samples; ++i) {
-            float gain = start_gain + (end_gain - start_gain) * (float(i) / samples);
-            buffer.samples[i] = buffer.samples[i] * gain;
-        }
+        dsp::apply_gain_ramp_stereo(interleaved(buffer), buffer.samples.size(), start_gain, end_gain);
     }
     
     void mixBuffers(AudioBuffer& dest, const AudioBuffer& src, float gain) {
         size_t min_size = std::min(dest.samples.size(), src.samples.size());
-        for (size_t i = 0; i < min_size; ++i) {
-            dest.samples[i] += src.samples[i] * gain;
-        }
+        dsp::mix_accumulate(interleaved(dest), interleaved(src), min_size * 2, gain);
     }
     
     void applySoftLimiter(AudioBuffer& buffer, float threshold) {
-        for (auto& sample : buffer.samples) {
-            // Soft clipping using tanh
-            if (std::abs(sample.left) > threshold) {
-                sample.left = std::tanh(sample.left) * threshold;
-            }
-            if (std::abs(sample.right) > threshold) {
-                sample.right = std::tanh(sample.right) * threshold;
-            }
-        }
+        // Soft clipping using tanh
+        dsp::soft_clip(interleaved(buffer), buffer.samples.size() * 2, threshold);
     }
     
     AudioBuffer generateSilence(size_t samples, int sample_rate) {
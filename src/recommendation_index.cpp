@@ -0,0 +1,192 @@
+#include "recommendation_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace OneStopRadio {
+
+namespace {
+
+constexpr float kMaxTolerance = 0.3f;   // Keeps the half, normal and double windows apart
+constexpr float kTempoMultiplePenalty = 0.25f;
+
+float relation_penalty(KeyRelation relation) {
+    switch (relation) {
+        case KeyRelation::SAME: return 0.0f;
+        case KeyRelation::RELATIVE: return 0.2f;
+        case KeyRelation::ADJACENT: return 0.3f;
+        case KeyRelation::UNKNOWN: break;
+    }
+    return 0.5f;
+}
+
+KeyRelation relation_between(uint8_t seed, uint8_t candidate) {
+    if (seed >= kNoKey || candidate >= kNoKey) {
+        return KeyRelation::UNKNOWN;
+    }
+    if (seed == candidate) {
+        return KeyRelation::SAME;
+    }
+    return seed % 12 == candidate % 12 ? KeyRelation::RELATIVE : KeyRelation::ADJACENT;
+}
+
+} // namespace
+
+const char* key_relation_name(KeyRelation relation) {
+    switch (relation) {
+        case KeyRelation::SAME: return "same";
+        case KeyRelation::RELATIVE: return "relative";
+        case KeyRelation::ADJACENT: return "adjacent";
+        case KeyRelation::UNKNOWN: break;
+    }
+    return "unknown";
+}
+
+void RecommendationIndex::update(TrackIndex track, float bpm, uint8_t key, float energy) {
+    if (track == kNoTrack) {
+        return;
+    }
+    remove(track);
+    if (track >= entries_.size()) {
+        entries_.resize(static_cast<size_t>(track) + 1);
+    }
+
+    bpm = bpm > 0.0f ? bpm : 0.0f;
+    key = std::min(key, kNoKey);
+    Bucket& bucket = buckets_[key];
+
+    // After every entry of lower BPM, and of equal BPM but lower energy
+    size_t position = static_cast<size_t>(std::lower_bound(bucket.bpm.begin(), bucket.bpm.end(), bpm) - bucket.bpm.begin());
+    while (position < bucket.bpm.size() && bucket.bpm[position] == bpm && bucket.energy[position] < energy) {
+        ++position;
+    }
+    bucket.bpm.insert(bucket.bpm.begin() + position, bpm);
+    bucket.energy.insert(bucket.energy.begin() + position, energy);
+    bucket.tracks.insert(bucket.tracks.begin() + position, track);
+
+    entries_[track] = Entry{bpm, energy, key, true};
+    ++size_;
+}
+
+void RecommendationIndex::remove(TrackIndex track) {
+    if (!contains(track)) {
+        return;
+    }
+    Entry& entry = entries_[track];
+    Bucket& bucket = buckets_[entry.key];
+
+    size_t position = static_cast<size_t>(std::lower_bound(bucket.bpm.begin(), bucket.bpm.end(), entry.bpm) - bucket.bpm.begin());
+    while (position < bucket.tracks.size() && bucket.tracks[position] != track) {
+        ++position;
+    }
+    if (position < bucket.tracks.size()) {
+        bucket.bpm.erase(bucket.bpm.begin() + position);
+        bucket.energy.erase(bucket.energy.begin() + position);
+        bucket.tracks.erase(bucket.tracks.begin() + position);
+    }
+
+    entry = Entry();
+    --size_;
+}
+
+void RecommendationIndex::clear() {
+    for (Bucket& bucket : buckets_) {
+        bucket = Bucket();
+    }
+    entries_.clear();
+    size_ = 0;
+}
+
+bool RecommendationIndex::contains(TrackIndex track) const {
+    return track < entries_.size() && entries_[track].indexed;
+}
+
+std::vector<Recommendation> RecommendationIndex::query(TrackIndex seed, const RecommendationOptions& options) const {
+    if (!contains(seed)) {
+        return {};
+    }
+    const Entry& entry = entries_[seed];
+    return query(entry.bpm, entry.key, entry.energy, options, seed);
+}
+
+std::vector<Recommendation> RecommendationIndex::query(float bpm, uint8_t key, float energy,
+                                                       const RecommendationOptions& options,
+                                                       TrackIndex exclude) const {
+    std::vector<Recommendation> candidates;
+    const float tolerance = std::clamp(options.bpm_tolerance, 0.0f, kMaxTolerance);
+
+    // Harmonic buckets for a known key; every bucket otherwise
+    std::vector<uint8_t> keys;
+    if (key < kNoKey) {
+        const KeyMask mask = harmonic_keys(key) | (KeyMask(1) << kNoKey);
+        for (uint8_t k = 0; k <= kNoKey; ++k) {
+            if (mask & (KeyMask(1) << k)) {
+                keys.push_back(k);
+            }
+        }
+    } else {
+        for (uint8_t k = 0; k <= kNoKey; ++k) {
+            keys.push_back(k);
+        }
+    }
+
+    for (uint8_t k : keys) {
+        const Bucket& bucket = buckets_[k];
+        const KeyRelation relation = relation_between(key, k);
+        if (bpm <= 0.0f) {
+            // No seed tempo: the key and energy decide alone
+            scan(bucket, 0.0f, INFINITY, 0.0f, 1.0f, relation, energy, options, exclude, candidates);
+            continue;
+        }
+        for (float ratio : {1.0f, 0.5f, 2.0f}) {
+            if (ratio != 1.0f && !options.half_double) {
+                continue;
+            }
+            const float target = bpm * ratio;
+            scan(bucket, target * (1.0f - tolerance), target * (1.0f + tolerance), target, ratio,
+                 relation, energy, options, exclude, candidates);
+        }
+    }
+
+    const auto by_score = [](const Recommendation& a, const Recommendation& b) {
+        return a.score != b.score ? a.score < b.score : a.track < b.track;
+    };
+    if (options.limit > 0 && candidates.size() > options.limit) {
+        std::partial_sort(candidates.begin(), candidates.begin() + options.limit, candidates.end(), by_score);
+        candidates.resize(options.limit);
+    } else {
+        std::sort(candidates.begin(), candidates.end(), by_score);
+    }
+    return candidates;
+}
+
+void RecommendationIndex::scan(const Bucket& bucket, float low, float high, float target, float tempo_ratio,
+                               KeyRelation relation, float energy, const RecommendationOptions& options,
+                               TrackIndex exclude, std::vector<Recommendation>& out) const {
+    const auto begin = std::lower_bound(bucket.bpm.begin(), bucket.bpm.end(), low);
+    const auto end = std::upper_bound(begin, bucket.bpm.end(), high);
+    const size_t first = static_cast<size_t>(begin - bucket.bpm.begin());
+    const size_t last = static_cast<size_t>(end - bucket.bpm.begin());
+
+    const float tempo_scale = target > 0.0f && high > target ? 1.0f / (high - target) : 0.0f;
+    const float base = relation_penalty(relation) + (tempo_ratio != 1.0f ? kTempoMultiplePenalty : 0.0f);
+    const bool match_energy = energy >= 0.0f;
+
+    for (size_t i = first; i < last; ++i) {
+        const TrackIndex track = bucket.tracks[i];
+        if (track == exclude) {
+            continue;
+        }
+        float score = base + std::fabs(bucket.bpm[i] - target) * tempo_scale;
+        if (match_energy && bucket.energy[i] >= 0.0f) {
+            const float delta = std::fabs(bucket.energy[i] - energy);
+            if (delta > options.max_energy_delta) {
+                continue;
+            }
+            score += delta * options.energy_weight;
+        }
+        out.push_back(Recommendation{track, score, tempo_ratio, relation});
+    }
+}
+
+} // namespace OneStopRadio
@@ -0,0 +1,434 @@
+#include "rtmp_sender.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/mem.h>
+}
+
+namespace {
+
+constexpr AVRational kMicroseconds{1, 1000000};
+constexpr std::chrono::milliseconds kIdleWait{50};
+constexpr std::chrono::milliseconds kTrailerTimeout{1000};
+constexpr int kDefaultAacFrames = 1024;
+
+std::string error_string(int error) {
+    char buffer[128] = {};
+    av_strerror(error, buffer, sizeof(buffer));
+    return buffer;
+}
+
+// AudioSpecificConfig for AAC-LC, which FLV carries in place of ADTS headers
+bool set_aac_extradata(AVCodecParameters* params, int sample_rate, int channels) {
+    static const int kRates[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000,
+                                 22050, 16000, 12000, 11025, 8000, 7350};
+    int rate_index = 0;
+    while (rate_index < 13 && kRates[rate_index] != sample_rate) {
+        ++rate_index;
+    }
+    if (rate_index == 13 || channels < 1 || channels > 7) {
+        return false;
+    }
+
+    params->extradata = static_cast<uint8_t*>(av_mallocz(2 + AV_INPUT_BUFFER_PADDING_SIZE));
+    if (!params->extradata) {
+        return false;
+    }
+    const unsigned config = (2u << 11) | (static_cast<unsigned>(rate_index) << 7) | (static_cast<unsigned>(channels) << 3);
+    params->extradata[0] = static_cast<uint8_t>(config >> 8);
+    params->extradata[1] = static_cast<uint8_t>(config & 0xff);
+    params->extradata_size = 2;
+    return true;
+}
+
+} // namespace
+
+RtmpSender::RtmpSender(const RtmpSenderOptions& options, const AVCodecParameters* video, AVRational video_time_base,
+                       const EncoderProfile* audio)
+    : options_(options), video_time_base_(video_time_base), has_audio_(audio != nullptr) {
+    video_params_ = avcodec_parameters_alloc();
+    if (video_params_ && video) {
+        avcodec_parameters_copy(video_params_, video);
+    }
+    if (audio) {
+        audio_profile_ = *audio;
+    }
+}
+
+RtmpSender::~RtmpSender() {
+    stop();
+    avcodec_parameters_free(&video_params_);
+}
+
+bool RtmpSender::start() {
+    if (io_thread_.joinable()) {
+        return true;
+    }
+    if (!video_params_ || options_.url.empty()) {
+        set_error("No video stream or URL");
+        failed_ = true;
+        return false;
+    }
+
+    should_stop_ = false;
+    failed_ = false;
+    io_thread_ = std::thread(&RtmpSender::io_loop, this);
+    return true;
+}
+
+void RtmpSender::stop() {
+    if (!io_thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        should_stop_ = true;
+    }
+    queue_cv_.notify_all();
+    io_thread_.join();
+
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    for (QueuedPacket& entry : queue_) {
+        release(entry);
+    }
+    queue_.clear();
+}
+
+bool RtmpSender::enqueue_video(const AVPacket* packet) {
+    if (!packet || packet->size <= 0 || failed_) {
+        return false;
+    }
+
+    const int64_t dts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    const int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : dts;
+    if (video_origin_ == AV_NOPTS_VALUE) {
+        video_origin_ = dts;
+    }
+
+    QueuedPacket entry;
+    entry.video = av_packet_clone(packet);
+    if (!entry.video) {
+        return false;
+    }
+    entry.pts_us = av_rescale_q(pts - video_origin_, video_time_base_, kMicroseconds);
+    entry.dts_us = av_rescale_q(dts - video_origin_, video_time_base_, kMicroseconds);
+    entry.keyframe = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    entry.size = static_cast<size_t>(packet->size);
+    push(std::move(entry));
+    return true;
+}
+
+void RtmpSender::on_encoded_packet(const EncodedPacketPtr& packet) {
+    if (!has_audio_ || !packet || packet->header || packet->data.empty() || failed_) {
+        return;
+    }
+
+    QueuedPacket entry;
+    entry.audio = packet;
+    entry.pts_us = entry.dts_us = audio_samples_ * 1000000 / audio_profile_.sample_rate;
+    entry.size = packet->data.size();
+    audio_samples_ += packet->frames > 0 ? static_cast<int64_t>(packet->frames) : kDefaultAacFrames;
+    push(std::move(entry));
+}
+
+RtmpSenderStats RtmpSender::get_stats() const {
+    RtmpSenderStats stats;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats = stats_;
+    }
+    stats.connected = connected_;
+    stats.failed = failed_;
+
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stats.queue_packets = queue_.size();
+    if (!queue_.empty()) {
+        stats.queue_ms = (queue_.back().dts_us - queue_.front().dts_us) / 1000.0;
+    }
+    return stats;
+}
+
+void RtmpSender::push(QueuedPacket entry) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+
+        // After the queue was emptied by a drop, pictures up to the next
+        // keyframe reference frames that were never sent
+        if (resync_ && entry.video) {
+            if (!entry.keyframe) {
+                release(entry);
+                std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+                stats_.packets_dropped++;
+                return;
+            }
+            resync_ = false;
+        }
+
+        queue_.push_back(std::move(entry));
+
+        const int64_t max_span_us = static_cast<int64_t>(options_.max_queue_ms) * 1000;
+        while (!queue_.empty() && (queue_.size() > options_.max_queue_packets ||
+                                   queue_.back().dts_us - queue_.front().dts_us > max_span_us)) {
+            drop_oldest_gop();
+        }
+    }
+    queue_cv_.notify_one();
+}
+
+void RtmpSender::drop_oldest_gop() {
+    // Everything up to, not including, the next keyframe after the front
+    uint64_t dropped = 0;
+    do {
+        release(queue_.front());
+        queue_.pop_front();
+        ++dropped;
+    } while (!queue_.empty() && !(queue_.front().video && queue_.front().keyframe));
+
+    if (queue_.empty()) {
+        resync_ = true;
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.packets_dropped += dropped;
+    stats_.gops_dropped++;
+}
+
+void RtmpSender::release(QueuedPacket& entry) {
+    if (entry.video) {
+        av_packet_free(&entry.video);
+    }
+    entry.audio.reset();
+}
+
+void RtmpSender::io_loop() {
+    int failures = 0;
+
+    while (!should_stop_) {
+        if (!output_) {
+            if (!open_output()) {
+                close_output();
+                ++failures;
+                if (options_.max_reconnect_attempts >= 0 && failures > options_.max_reconnect_attempts) {
+                    failed_ = true;
+                    Logger::error("RtmpSender: Giving up on " + options_.name + " after " +
+                                  std::to_string(failures) + " attempts");
+                    break;
+                }
+                if (!wait_reconnect()) {
+                    break;
+                }
+                continue;
+            }
+            failures = 0;
+            connected_ = true;
+            Logger::info("RtmpSender: Connected to " + options_.name);
+        }
+
+        QueuedPacket entry;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait_for(lock, kIdleWait, [this] { return should_stop_ || !queue_.empty(); });
+            if (should_stop_) {
+                break;
+            }
+            if (queue_.empty()) {
+                continue;
+            }
+            entry = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        const bool written = write_packet(entry);
+        release(entry);
+        if (!written) {
+            // The encoders keep running; only this connection is rebuilt
+            Logger::warn("RtmpSender: Connection to " + options_.name + " lost, reconnecting");
+            close_output();
+            {
+                std::lock_guard<std::mutex> lock(stats_mutex_);
+                stats_.reconnects++;
+            }
+            if (!wait_reconnect()) {
+                break;
+            }
+        }
+    }
+
+    close_output();
+}
+
+bool RtmpSender::open_output() {
+    io_deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(options_.io_timeout_ms);
+
+    int ret = avformat_alloc_output_context2(&output_, nullptr, "flv", options_.url.c_str());
+    if (ret < 0 || !output_) {
+        set_error("Failed to create FLV muxer: " + error_string(ret));
+        return false;
+    }
+    output_->interrupt_callback.callback = &RtmpSender::interrupt_callback;
+    output_->interrupt_callback.opaque = this;
+
+    AVStream* video = avformat_new_stream(output_, nullptr);
+    if (!video || avcodec_parameters_copy(video->codecpar, video_params_) < 0) {
+        set_error("Failed to add video stream");
+        return false;
+    }
+    video->codecpar->codec_tag = 0;
+    video->time_base = video_time_base_;
+    video_stream_ = video->index;
+
+    audio_stream_ = -1;
+    if (has_audio_) {
+        AVStream* audio = avformat_new_stream(output_, nullptr);
+        if (!audio) {
+            set_error("Failed to add audio stream");
+            return false;
+        }
+        AVCodecParameters* params = audio->codecpar;
+        params->codec_type = AVMEDIA_TYPE_AUDIO;
+        params->codec_id = AV_CODEC_ID_AAC;
+        params->sample_rate = audio_profile_.sample_rate;
+        params->channels = audio_profile_.channels;
+        params->channel_layout = audio_profile_.channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO;
+        params->bit_rate = static_cast<int64_t>(audio_profile_.bitrate) * 1000;
+        params->frame_size = kDefaultAacFrames;
+        if (!set_aac_extradata(params, audio_profile_.sample_rate, audio_profile_.channels)) {
+            set_error("AAC at " + std::to_string(audio_profile_.sample_rate) + " Hz cannot be muxed");
+            return false;
+        }
+        audio->time_base = {1, audio_profile_.sample_rate};
+        audio_stream_ = audio->index;
+    }
+
+    ret = avio_open2(&output_->pb, options_.url.c_str(), AVIO_FLAG_WRITE, &output_->interrupt_callback, nullptr);
+    if (ret < 0) {
+        set_error("Failed to connect: " + error_string(ret));
+        return false;
+    }
+
+    ret = avformat_write_header(output_, nullptr);
+    if (ret < 0) {
+        set_error("Failed to write FLV header: " + error_string(ret));
+        return false;
+    }
+
+    header_written_ = true;
+    need_keyframe_ = true;
+    return true;
+}
+
+void RtmpSender::close_output() {
+    connected_ = false;
+    if (!output_) {
+        return;
+    }
+
+    // The trailer only updates metadata; give it a short deadline on a dead socket
+    io_deadline_ = std::chrono::steady_clock::now() +
+                   std::min(kTrailerTimeout, std::chrono::milliseconds(options_.io_timeout_ms));
+    if (header_written_) {
+        av_write_trailer(output_);
+    }
+    header_written_ = false;
+
+    if (output_->pb) {
+        avio_closep(&output_->pb);
+    }
+    avformat_free_context(output_);
+    output_ = nullptr;
+}
+
+bool RtmpSender::write_packet(QueuedPacket& entry) {
+    // A new connection starts at a keyframe, with both streams rebased to it
+    if (need_keyframe_) {
+        if (!entry.video || !entry.keyframe) {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.packets_dropped++;
+            return true;
+        }
+        need_keyframe_ = false;
+        connection_origin_us_ = entry.dts_us;
+    }
+    if (entry.dts_us < connection_origin_us_) {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.packets_dropped++;
+        return true;
+    }
+
+    AVPacket* packet = nullptr;
+    int stream_index = video_stream_;
+    if (entry.video) {
+        packet = entry.video;
+        entry.video = nullptr;
+    } else {
+        // AAC packets are a few hundred bytes; a padded copy is what the muxer expects
+        packet = av_packet_alloc();
+        if (!packet || av_new_packet(packet, static_cast<int>(entry.audio->data.size())) < 0) {
+            av_packet_free(&packet);
+            set_error("Failed to allocate audio packet");
+            return false;
+        }
+        std::memcpy(packet->data, entry.audio->data.data(), entry.audio->data.size());
+        packet->flags |= AV_PKT_FLAG_KEY;
+        stream_index = audio_stream_;
+    }
+
+    const AVRational time_base = output_->streams[stream_index]->time_base;
+    packet->stream_index = stream_index;
+    packet->pts = av_rescale_q(entry.pts_us - connection_origin_us_, kMicroseconds, time_base);
+    packet->dts = av_rescale_q(entry.dts_us - connection_origin_us_, kMicroseconds, time_base);
+    packet->duration = 0;
+    packet->pos = -1;
+
+    io_deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(options_.io_timeout_ms);
+    const int ret = av_interleaved_write_frame(output_, packet);
+    av_packet_free(&packet);
+    if (ret < 0) {
+        set_error("Write failed: " + error_string(ret));
+        return false;
+    }
+
+    record_sent(entry.size);
+    return true;
+}
+
+void RtmpSender::record_sent(size_t bytes) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.packets_sent++;
+    stats_.bytes_sent += bytes;
+
+    if (window_bytes_ == 0 && window_start_.time_since_epoch().count() == 0) {
+        window_start_ = now;
+    }
+    window_bytes_ += bytes;
+    const double elapsed = std::chrono::duration<double>(now - window_start_).count();
+    if (elapsed >= 1.0) {
+        const double bitrate = window_bytes_ * 8.0 / elapsed;
+        stats_.bitrate = stats_.bitrate == 0.0 ? bitrate : stats_.bitrate * 0.7 + bitrate * 0.3;
+        window_start_ = now;
+        window_bytes_ = 0;
+    }
+}
+
+void RtmpSender::set_error(const std::string& error) {
+    Logger::error("RtmpSender: " + options_.name + ": " + error);
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.error = error;
+}
+
+bool RtmpSender::wait_reconnect() {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    queue_cv_.wait_for(lock, std::chrono::milliseconds(options_.reconnect_delay_ms),
+                       [this] { return should_stop_.load(); });
+    return !should_stop_;
+}
+
+int RtmpSender::interrupt_callback(void* opaque) {
+    const RtmpSender* sender = static_cast<const RtmpSender*>(opaque);
+    return sender->should_stop_ || std::chrono::steady_clock::now() > sender->io_deadline_ ? 1 : 0;
+}
@@ -0,0 +1,272 @@
+#include "shout_sender.hpp"
+#include "metrics_registry.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// How long the I/O thread sleeps while libshout's socket is not writable
+constexpr std::chrono::milliseconds kBusyRetry{5};
+constexpr std::chrono::milliseconds kConnectPoll{10};
+constexpr std::chrono::milliseconds kIdleWait{50};
+
+// Summed over every connection
+struct SenderMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    MetricHistogram& send_latency = registry.histogram(
+        "onestop_network_send_latency_seconds", "Time from enqueue() to libshout",
+        MetricsRegistry::exponential_buckets(0.001, 2.0, 12));
+    MetricGauge& queue_bytes = registry.gauge(
+        "onestop_network_queue_bytes", "Encoded bytes waiting in sender queues");
+    MetricCounter& packets_dropped = registry.counter(
+        "onestop_network_packets_dropped_total", "Packets discarded because a sender queue was full");
+};
+
+SenderMetrics& sender_metrics() {
+    static SenderMetrics metrics;
+    return metrics;
+}
+
+} // namespace
+
+ShoutSender::ShoutSender(shout_t* shout, size_t max_queue_bytes)
+    : shout_(shout), max_queue_bytes_(max_queue_bytes) {}
+
+ShoutSender::~ShoutSender() {
+    stop();
+}
+
+bool ShoutSender::start(bool open_connection) {
+    if (io_thread_.joinable()) {
+        return true;
+    }
+    if (!shout_) {
+        fail("No shout connection");
+        return false;
+    }
+
+    should_stop_ = false;
+    failed_ = false;
+    open_connection_ = open_connection;
+    connected_ = !open_connection && shout_get_connected(shout_) == SHOUTERR_CONNECTED;
+
+    io_thread_ = std::thread(&ShoutSender::io_loop, this);
+    return true;
+}
+
+void ShoutSender::stop() {
+    if (!io_thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        should_stop_ = true;
+    }
+    queue_cv_.notify_all();
+    io_thread_.join();
+
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    sender_metrics().queue_bytes.add(-static_cast<double>(queue_bytes_));
+    queue_.clear();
+    queue_bytes_ = 0;
+}
+
+bool ShoutSender::enqueue(EncodedPacketPtr packet) {
+    if (!packet || failed_) {
+        return false;
+    }
+
+    const size_t size = packet->data.size();
+    SenderMetrics& metrics = sender_metrics();
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+
+        // Make room by discarding the oldest audio; headers must reach the server
+        while (queue_bytes_ + size > max_queue_bytes_) {
+            auto victim = std::find_if(queue_.begin(), queue_.end(),
+                                       [](const QueuedPacket& entry) { return !entry.packet->header; });
+            if (victim == queue_.end()) {
+                break;
+            }
+
+            {
+                std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+                stats_.packets_dropped++;
+                stats_.bytes_dropped += victim->packet->data.size();
+            }
+            metrics.packets_dropped.increment();
+            metrics.queue_bytes.add(-static_cast<double>(victim->packet->data.size()));
+            queue_bytes_ -= victim->packet->data.size();
+            queue_.erase(victim);
+        }
+
+        queue_.push_back({std::move(packet), std::chrono::steady_clock::now()});
+        queue_bytes_ += size;
+        metrics.queue_bytes.add(static_cast<double>(size));
+    }
+    queue_cv_.notify_one();
+    return true;
+}
+
+bool ShoutSender::enqueue(const uint8_t* data, size_t size) {
+    auto packet = std::make_shared<EncodedPacket>();
+    packet->data.assign(data, data + size);
+    return enqueue(EncodedPacketPtr(std::move(packet)));
+}
+
+std::string ShoutSender::get_error() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return error_;
+}
+
+ShoutSenderStats ShoutSender::get_stats() const {
+    ShoutSenderStats stats;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats = stats_;
+        stats.error = error_;
+    }
+    stats.connected = connected_;
+    stats.failed = failed_;
+
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stats.queue_packets = queue_.size();
+    stats.queue_bytes = queue_bytes_;
+    return stats;
+}
+
+bool ShoutSender::wait_connected(shout_t* shout, std::chrono::milliseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        const int state = shout_get_connected(shout);
+        if (state == SHOUTERR_CONNECTED) {
+            return true;
+        }
+        if (state != SHOUTERR_BUSY || std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(kConnectPoll);
+    }
+}
+
+void ShoutSender::io_loop() {
+    if (open_connection_) {
+        const int result = shout_open(shout_);
+        if (result == SHOUTERR_SUCCESS || result == SHOUTERR_CONNECTED) {
+            connected_ = true;
+        } else if (result != SHOUTERR_BUSY) {
+            fail("Connection failed: " + std::string(shout_get_error(shout_)));
+            return;
+        }
+    }
+
+    auto pause = [this](std::chrono::milliseconds duration) {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        queue_cv_.wait_for(lock, duration, [this] { return should_stop_.load(); });
+    };
+
+    while (!should_stop_) {
+        if (!connected_) {
+            if (!finish_connect()) {
+                if (failed_) {
+                    return;
+                }
+                pause(kConnectPoll);
+                continue;
+            }
+            connected_ = true;
+            Logger::info("Shout connection established");
+        }
+
+        // Hand libshout a new packet only once its own queue has drained
+        if (!flush_shout_queue()) {
+            if (failed_) {
+                return;
+            }
+            pause(kBusyRetry);
+            continue;
+        }
+
+        QueuedPacket entry;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait_for(lock, kIdleWait, [this] { return should_stop_ || !queue_.empty(); });
+            if (should_stop_ || queue_.empty()) {
+                continue;
+            }
+            entry = std::move(queue_.front());
+            queue_.pop_front();
+            queue_bytes_ -= entry.packet->data.size();
+            sender_metrics().queue_bytes.add(-static_cast<double>(entry.packet->data.size()));
+        }
+
+        // Non-blocking: whatever the socket does not take stays queued inside libshout
+        const int result = shout_send(shout_, entry.packet->data.data(), entry.packet->data.size());
+        if (result != SHOUTERR_SUCCESS && result != SHOUTERR_BUSY) {
+            fail("Send failed: " + std::string(shout_get_error(shout_)));
+            return;
+        }
+
+        record_sent(entry);
+        record_shout_queue();
+    }
+}
+
+bool ShoutSender::finish_connect() {
+    const int state = shout_get_connected(shout_);
+    if (state == SHOUTERR_CONNECTED) {
+        return true;
+    }
+    if (state != SHOUTERR_BUSY) {
+        fail("Connection failed: " + std::string(shout_get_error(shout_)));
+    }
+    return false;
+}
+
+bool ShoutSender::flush_shout_queue() {
+    if (shout_queuelen(shout_) <= 0) {
+        return true;
+    }
+
+    // A zero-length send only pushes libshout's pending queue
+    const int result = shout_send(shout_, nullptr, 0);
+    record_shout_queue();
+    if (result == SHOUTERR_SUCCESS) {
+        return true;
+    }
+    if (result != SHOUTERR_BUSY) {
+        fail("Send failed: " + std::string(shout_get_error(shout_)));
+    }
+    return false;
+}
+
+void ShoutSender::record_sent(const QueuedPacket& entry) {
+    const double latency = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - entry.queued_at).count();
+    sender_metrics().send_latency.observe(latency * 0.001);
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.latency_ms = stats_.packets_sent == 0 ? latency : stats_.latency_ms * 0.9 + latency * 0.1;
+    stats_.max_latency_ms = std::max(stats_.max_latency_ms, latency);
+    stats_.packets_sent++;
+    stats_.bytes_sent += entry.packet->data.size();
+}
+
+void ShoutSender::record_shout_queue() {
+    const ssize_t queued = shout_queuelen(shout_);
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.shout_queue_bytes = queued > 0 ? static_cast<size_t>(queued) : 0;
+}
+
+void ShoutSender::fail(const std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        error_ = error;
+    }
+    failed_ = true;
+    connected_ = false;
+    Logger::error("ShoutSender: " + error);
+}
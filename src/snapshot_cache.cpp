@@ -0,0 +1,79 @@
+#include "snapshot_cache.hpp"
+#include "metrics_registry.hpp"
+#include <cstdio>
+
+namespace {
+
+struct SnapshotMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    MetricCounter& hits = registry.counter(
+        "onestop_http_snapshot_hits_total", "Status responses served from a cached snapshot");
+    MetricCounter& builds = registry.counter(
+        "onestop_http_snapshot_builds_total", "Status responses serialized because their state changed");
+};
+
+SnapshotMetrics& snapshot_metrics() {
+    static SnapshotMetrics metrics;
+    return metrics;
+}
+
+} // namespace
+
+SnapshotCache::SnapshotCache(std::chrono::milliseconds max_age) : max_age_(max_age) {}
+
+bool SnapshotCache::fresh(const Entry& entry, uint64_t generation, std::chrono::steady_clock::time_point now) const {
+    return entry.snapshot && entry.generation == generation &&
+           (max_age_.count() == 0 || now - entry.built < max_age_);
+}
+
+std::shared_ptr<const HttpSnapshot> SnapshotCache::get(uint64_t generation, const Builder& build) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fresh(entry_, generation, std::chrono::steady_clock::now())) {
+            snapshot_metrics().hits.increment();
+            return entry_.snapshot;
+        }
+    }
+
+    // One build per miss; whoever waited here finds it done
+    std::lock_guard<std::mutex> build_lock(build_mutex_);
+    std::shared_ptr<const HttpSnapshot> previous;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fresh(entry_, generation, std::chrono::steady_clock::now())) {
+            snapshot_metrics().hits.increment();
+            return entry_.snapshot;
+        }
+        previous = entry_.snapshot;
+    }
+
+    std::string body = build();
+    snapshot_metrics().builds.increment();
+    std::shared_ptr<const HttpSnapshot> snapshot =
+        previous && previous->body == body ? previous : make(std::move(body));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    entry_.snapshot = snapshot;
+    entry_.generation = generation;
+    entry_.built = std::chrono::steady_clock::now();
+    return snapshot;
+}
+
+std::shared_ptr<const HttpSnapshot> SnapshotCache::make(std::string body) {
+    auto snapshot = std::make_shared<HttpSnapshot>();
+    snapshot->etag = make_etag(body);
+    snapshot->body = std::move(body);
+    return snapshot;
+}
+
+std::string SnapshotCache::make_etag(const std::string& body) {
+    // FNV-1a: strong tags only need to tell bodies apart, not resist forgery
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : body) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    char tag[24];
+    std::snprintf(tag, sizeof(tag), "\"%016llx\"", static_cast<unsigned long long>(hash));
+    return tag;
+}
@@ -1,13 +1,30 @@
 #include "video_stream_manager.hpp"
+#include "rtmp_sender.hpp"
+#include "audio_stream_encoder.hpp"
 #include "logger.hpp"
 #include <map>
 #include <sstream>
 
+namespace {
+
+struct CodecParametersDeleter {
+    void operator()(AVCodecParameters* params) const { avcodec_parameters_free(&params); }
+};
+
+} // namespace
+
 // SocialMediaStreamer Implementation
 class SocialMediaStreamer::Impl {
 public:
     Impl() {}
     
+    ~Impl() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& pair : platforms_) {
+            stop_streaming_internal(pair.first);
+        }
+    }
+    
     bool add_platform(const std::string& platform_id, const SocialMediaConfig& config) {
         std::lock_guard<std::mutex> lock(mutex_);
         
@@ -55,6 +72,53 @@ public:
         return true;
     }
     
+    bool get_platform_config(const std::string& platform_id, SocialMediaConfig& config) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        auto it = platforms_.find(platform_id);
+        if (it == platforms_.end()) {
+            return false;
+        }
+        config = it->second;
+        return true;
+    }
+    
+    bool set_video_stream(const std::string& profile_key, const VideoEncoder& encoder) {
+        VideoStream stream;
+        stream.params.reset(avcodec_parameters_alloc());
+        if (!stream.params || !encoder.get_codec_parameters(stream.params.get())) {
+            Logger::error("SocialMediaStreamer", "No codec parameters for profile " + profile_key);
+            return false;
+        }
+        stream.time_base = encoder.get_time_base();
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        video_streams_[profile_key] = std::move(stream);
+        return true;
+    }
+    
+    void clear_video_streams() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        video_streams_.clear();
+    }
+    
+    void set_audio_encoder(std::shared_ptr<SharedStreamEncoder> encoder) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        if (encoder && encoder->profile().codec != StreamCodec::AAC) {
+            Logger::error("SocialMediaStreamer", "RTMP audio must be AAC, not " + encoder->profile().to_string());
+            encoder.reset();
+        }
+        
+        // Live senders keep the encoder they were started with until they stop
+        audio_encoder_ = std::move(encoder);
+    }
+    
+    void set_sender_options(const RtmpSenderOptions& options) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sender_options_ = options;
+    }
+    
     bool start_streaming(const std::string& platform_id) {
         std::lock_guard<std::mutex> lock(mutex_);
         return start_streaming_internal(platform_id);
@@ -102,6 +166,22 @@ public:
         return true;
     }
     
+    bool send_video_packet(const std::string& profile_key, const AVPacket* packet) {
+        if (!packet || packet->size <= 0) {
+            return false;
+        }
+        
+        // Each sender takes its own reference; none of them touches the network here
+        std::lock_guard<std::mutex> lock(mutex_);
+        bool queued = false;
+        for (auto& [platform_id, sender] : senders_) {
+            if (sender.profile_key == profile_key) {
+                queued = sender.sender->enqueue_video(packet) || queued;
+            }
+        }
+        return queued;
+    }
+    
     bool send_video_data(const uint8_t* video_data, size_t video_size,
                         const uint8_t* audio_data, size_t audio_size) {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -134,6 +214,21 @@ public:
     SocialMediaStreamer::StreamStats get_stream_stats(const std::string& platform_id) const {
         std::lock_guard<std::mutex> lock(mutex_);
         
+        auto sender = senders_.find(platform_id);
+        if (sender != senders_.end()) {
+            const RtmpSenderStats rtmp = sender->second.sender->get_stats();
+            SocialMediaStreamer::StreamStats stats;
+            stats.bytes_sent = rtmp.bytes_sent;
+            stats.frames_sent = rtmp.packets_sent;
+            stats.current_bitrate = rtmp.bitrate;
+            stats.is_connected = rtmp.connected;
+            stats.last_error = rtmp.error;
+            stats.packets_dropped = rtmp.packets_dropped;
+            stats.queue_ms = rtmp.queue_ms;
+            stats.reconnects = rtmp.reconnects;
+            return stats;
+        }
+        
         auto it = stream_stats_.find(platform_id);
         if (it != stream_stats_.end()) {
             return it->second;
@@ -178,10 +273,44 @@ private:
             return false;
         }
         
-        // In real implementation, connect to RTMP server
+        if (config.is_live) {
+            return true;
+        }
+        
+        const std::string profile_key = video_profile_key(config.video_format);
+        auto stream = video_streams_.find(profile_key);
+        if (stream == video_streams_.end()) {
+            Logger::error("SocialMediaStreamer", "No encoder running for " + platform_id + " (" + profile_key + ")");
+            if (status_callback_) {
+                status_callback_(platform_id, false, "No encoder for the platform's video format");
+            }
+            return false;
+        }
+        
+        // The sender connects on its own thread; until then packets queue up
+        RtmpSenderOptions options = sender_options_;
+        options.name = platform_id;
+        options.url = config.rtmp_url + "/" + config.stream_key;
+        const EncoderProfile* audio = audio_encoder_ ? &audio_encoder_->profile() : nullptr;
+        
+        PlatformSender entry;
+        entry.profile_key = profile_key;
+        entry.sender = std::make_unique<RtmpSender>(options, stream->second.params.get(), stream->second.time_base, audio);
+        if (!entry.sender->start()) {
+            if (status_callback_) {
+                status_callback_(platform_id, false, "Failed to start RTMP sender");
+            }
+            return false;
+        }
+        if (audio_encoder_) {
+            entry.audio_encoder = audio_encoder_;
+            audio_encoder_->add_sink(entry.sender.get());
+        }
+        senders_[platform_id] = std::move(entry);
+        
         config.is_live = true;
         auto& stats = stream_stats_[platform_id];
-        stats.is_connected = true;
+        stats.is_connected = false;
         stats.last_error.clear();
         
         Logger::info("SocialMediaStreamer", "Started streaming to: " + platform_id + 
@@ -203,6 +332,25 @@ private:
         auto& config = it->second;
         config.is_live = false;
         
+        auto sender = senders_.find(platform_id);
+        if (sender != senders_.end()) {
+            PlatformSender& entry = sender->second;
+            if (entry.audio_encoder) {
+                entry.audio_encoder->remove_sink(entry.sender.get());
+            }
+            entry.sender->stop();
+            
+            // Keep the final counters for reporting after the stream ends
+            const RtmpSenderStats rtmp = entry.sender->get_stats();
+            auto& stats = stream_stats_[platform_id];
+            stats.bytes_sent = rtmp.bytes_sent;
+            stats.frames_sent = rtmp.packets_sent;
+            stats.last_error = rtmp.error;
+            stats.packets_dropped = rtmp.packets_dropped;
+            stats.reconnects = rtmp.reconnects;
+            senders_.erase(sender);
+        }
+        
         auto& stats = stream_stats_[platform_id];
         stats.is_connected = false;
         stats.current_bitrate = 0.0;
@@ -230,6 +378,21 @@ private:
     
     std::map<std::string, SocialMediaConfig> platforms_;
     
+    struct VideoStream {
+        std::unique_ptr<AVCodecParameters, CodecParametersDeleter> params;
+        AVRational time_base{1, 30};
+    };
+    std::map<std::string, VideoStream> video_streams_;     // By video_profile_key()
+    
+    struct PlatformSender {
+        std::string profile_key;
+        std::unique_ptr<RtmpSender> sender;
+        std::shared_ptr<SharedStreamEncoder> audio_encoder;     // The one it is a sink of
+    };
+    std::map<std::string, PlatformSender> senders_;         // Live platforms
+    std::shared_ptr<SharedStreamEncoder> audio_encoder_;
+    RtmpSenderOptions sender_options_;
+    
     struct ExtendedStreamStats : SocialMediaStreamer::StreamStats {
         std::chrono::steady_clock::time_point last_update_time;
     };
@@ -279,6 +442,30 @@ bool SocialMediaStreamer::send_video_data(const uint8_t* video_data, size_t vide
     return impl_->send_video_data(video_data, video_size, audio_data, audio_size);
 }
 
+bool SocialMediaStreamer::send_video_packet(const std::string& profile_key, const AVPacket* packet) {
+    return impl_->send_video_packet(profile_key, packet);
+}
+
+bool SocialMediaStreamer::get_platform_config(const std::string& platform_id, SocialMediaConfig& config) const {
+    return impl_->get_platform_config(platform_id, config);
+}
+
+bool SocialMediaStreamer::set_video_stream(const std::string& profile_key, const VideoEncoder& encoder) {
+    return impl_->set_video_stream(profile_key, encoder);
+}
+
+void SocialMediaStreamer::clear_video_streams() {
+    impl_->clear_video_streams();
+}
+
+void SocialMediaStreamer::set_audio_encoder(std::shared_ptr<SharedStreamEncoder> encoder) {
+    impl_->set_audio_encoder(std::move(encoder));
+}
+
+void SocialMediaStreamer::set_sender_options(const RtmpSenderOptions& options) {
+    impl_->set_sender_options(options);
+}
+
 SocialMediaStreamer::StreamStats SocialMediaStreamer::get_stream_stats(const std::string& platform_id) const {
     return impl_->get_stream_stats(platform_id);
 }
@@ -0,0 +1,306 @@
+#include "spectrum_analyzer.hpp"
+#include "fft_plan_registry.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kTapsPerDecimation = 16;
+
+bool is_power_of_two(int n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+// Windowed-sinc low-pass with its cutoff just below the decimated Nyquist frequency
+std::vector<float> design_lowpass(int decimation) {
+    if (decimation <= 1) {
+        return {1.0f};
+    }
+
+    const int taps = kTapsPerDecimation * decimation + 1;
+    const double cutoff = 0.45 / decimation;   // Cycles per input sample
+    const int center = taps / 2;
+
+    std::vector<float> h(taps);
+    double sum = 0.0;
+    for (int i = 0; i < taps; ++i) {
+        const int n = i - center;
+        const double sinc = n == 0 ? 2.0 * cutoff : std::sin(2.0 * kPi * cutoff * n) / (kPi * n);
+        const double blackman = 0.42 - 0.5 * std::cos(2.0 * kPi * i / (taps - 1)) +
+                                0.08 * std::cos(4.0 * kPi * i / (taps - 1));
+        h[i] = static_cast<float>(sinc * blackman);
+        sum += h[i];
+    }
+    for (auto& tap : h) {
+        tap = static_cast<float>(tap / sum);
+    }
+    return h;
+}
+
+void lower_thread_priority() {
+#ifdef __linux__
+    // Linux applies PRIO_PROCESS to a single thread when given its tid
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+}
+
+} // namespace
+
+SpectrumAnalyzer::SpectrumAnalyzer(const SpectrumAnalyzerOptions& options)
+    : options_(options) {}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    stop();
+    fftwf_free(fft_input_);
+    fftwf_free(fft_output_);
+}
+
+void SpectrumAnalyzer::set_options(const SpectrumAnalyzerOptions& options) {
+    options_ = options;
+}
+
+bool SpectrumAnalyzer::start(std::shared_ptr<AudioRingBuffer::Reader> reader) {
+    if (running_ || !reader) {
+        return false;
+    }
+
+    active_ = options_;
+    const SpectrumAnalyzerOptions& o = active_;
+    if (!is_power_of_two(o.fft_size) || o.fft_size < 64 || o.hop < 1 || o.hop > o.fft_size ||
+        o.decimation < 1 || o.bands < 1 || o.bands > static_cast<int>(SpectrumFrame::kMaxBands) ||
+        o.min_frequency <= 0.0f || o.floor_db >= 0.0f || o.release < 0.0f || o.release >= 1.0f) {
+        Logger::error("SpectrumAnalyzer: Invalid options");
+        return false;
+    }
+    if (static_cast<size_t>(o.hop) * o.decimation > reader->capacity_frames() / 2) {
+        Logger::error("SpectrumAnalyzer: Hop does not fit in the master bus ring");
+        return false;
+    }
+
+    fft_plan_ = FftPlanRegistry::instance().real_forward(o.fft_size);
+    if (!fft_plan_) {
+        return false;
+    }
+
+    fftwf_free(fft_input_);
+    fftwf_free(fft_output_);
+    fft_input_ = fftwf_alloc_real(o.fft_size);
+    fft_output_ = fftwf_alloc_complex(o.fft_size / 2 + 1);
+
+    window_.resize(o.fft_size);
+    double window_sum = 0.0;
+    for (int i = 0; i < o.fft_size; ++i) {
+        window_[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * i / o.fft_size));
+        window_sum += window_[i];
+    }
+    // Scale so a full-scale sine peaks at 0 dBFS
+    window_gain_ = static_cast<float>(2.0 / window_sum);
+
+    lowpass_ = design_lowpass(o.decimation);
+    mono_.assign(lowpass_.size() - 1 + static_cast<size_t>(o.hop) * o.decimation, 0.0f);
+    history_.assign(o.fft_size, 0.0f);
+    block_.resize(static_cast<size_t>(o.hop) * o.decimation * reader->channels());
+
+    working_ = SpectrumFrame();
+    build_band_map(reader->sample_rate());
+    if (band_map_.empty()) {
+        Logger::error("SpectrumAnalyzer: Frequency range is empty at this sample rate");
+        return false;
+    }
+    working_.band_count = static_cast<uint32_t>(band_map_.size());
+    frame_.store(working_);
+
+    reader_ = std::move(reader);
+    running_ = true;
+    thread_ = std::thread([this] { run(); });
+
+    Logger::info("SpectrumAnalyzer: Started (" + std::to_string(o.fft_size) + "-point FFT, hop " +
+                 std::to_string(o.hop) + ", " + std::to_string(band_map_.size()) + " bands)");
+    return true;
+}
+
+void SpectrumAnalyzer::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    running_ = false;
+    reader_->cancel();
+    thread_.join();
+    reader_.reset();
+
+    // Readers see silence rather than the last frame before stopping
+    working_.levels.fill(0.0f);
+    ++working_.sequence;
+    frame_.store(working_);
+
+    Logger::info("SpectrumAnalyzer: Stopped");
+}
+
+void SpectrumAnalyzer::build_band_map(int sample_rate) {
+    const SpectrumAnalyzerOptions& o = active_;
+    const double analyzed_rate = static_cast<double>(sample_rate) / o.decimation;
+    const double resolution = analyzed_rate / o.fft_size;
+    const double nyquist_limit = 0.45 * analyzed_rate;
+    const double max_frequency = o.max_frequency > 0.0f ? std::min<double>(o.max_frequency, nyquist_limit)
+                                                        : nyquist_limit;
+    const double min_frequency = std::max<double>(o.min_frequency, resolution);
+
+    band_map_.clear();
+    if (max_frequency <= min_frequency) {
+        return;
+    }
+
+    const uint32_t last_bin = static_cast<uint32_t>(o.fft_size / 2);
+    const double ratio = max_frequency / min_frequency;
+    band_map_.reserve(o.bands);
+    for (int b = 0; b < o.bands; ++b) {
+        const double low = min_frequency * std::pow(ratio, static_cast<double>(b) / o.bands);
+        const double high = min_frequency * std::pow(ratio, static_cast<double>(b + 1) / o.bands);
+
+        auto first = static_cast<int64_t>(std::ceil(low / resolution));
+        auto last = static_cast<int64_t>(std::ceil(high / resolution)) - 1;
+        if (last < first) {
+            // Band narrower than one bin: take the bin nearest its centre
+            first = last = std::llround(std::sqrt(low * high) / resolution);
+        }
+        band_map_.push_back(BandRange{
+            static_cast<uint32_t>(std::clamp<int64_t>(first, 1, last_bin)),
+            static_cast<uint32_t>(std::clamp<int64_t>(last, 1, last_bin))
+        });
+    }
+
+    working_.min_frequency = static_cast<float>(min_frequency);
+    working_.max_frequency = static_cast<float>(max_frequency);
+}
+
+void SpectrumAnalyzer::run() {
+    lower_thread_priority();
+
+    const size_t hop = static_cast<size_t>(active_.hop);
+    const size_t decimation = static_cast<size_t>(active_.decimation);
+    const size_t block_frames = hop * decimation;
+    const size_t channels = static_cast<size_t>(reader_->channels());
+    const size_t history = lowpass_.size() - 1;
+    const float channel_scale = 1.0f / channels;
+    bool silent = true;
+
+    while (running_) {
+        if (reader_->read(block_.data(), block_frames, std::chrono::milliseconds(200)) == 0) {
+            // Audio stopped: fall to silence once instead of freezing on the last frame
+            if (running_ && !silent) {
+                std::fill(mono_.begin(), mono_.end(), 0.0f);
+                std::fill(history_.begin(), history_.end(), 0.0f);
+                working_.levels.fill(0.0f);
+                ++working_.sequence;
+                frame_.store(working_);
+                silent = true;
+            }
+            continue;
+        }
+        silent = false;
+
+        // Downmix behind the filter history
+        float* mono = mono_.data() + history;
+        for (size_t i = 0; i < block_frames; ++i) {
+            const float* frame = block_.data() + i * channels;
+            float sum = 0.0f;
+            for (size_t ch = 0; ch < channels; ++ch) {
+                sum += frame[ch];
+            }
+            mono[i] = sum * channel_scale;
+        }
+
+        // Slide the analysis window and filter only the samples that are kept
+        std::memmove(history_.data(), history_.data() + hop, (history_.size() - hop) * sizeof(float));
+        float* out = history_.data() + history_.size() - hop;
+        for (size_t j = 0; j < hop; ++j) {
+            const float* x = mono_.data() + j * decimation;
+            float acc = 0.0f;
+            for (size_t t = 0; t < lowpass_.size(); ++t) {
+                acc += lowpass_[t] * x[t];
+            }
+            out[j] = acc;
+        }
+        std::memmove(mono_.data(), mono_.data() + block_frames, history * sizeof(float));
+
+        analyze_window();
+    }
+}
+
+void SpectrumAnalyzer::analyze_window() {
+    const int n = active_.fft_size;
+    for (int i = 0; i < n; ++i) {
+        fft_input_[i] = history_[i] * window_[i];
+    }
+    fftwf_execute_dft_r2c(fft_plan_, fft_input_, fft_output_);
+
+    const float floor_db = active_.floor_db;
+    const float range = -floor_db;
+    const float release = active_.release;
+    const float gain_squared = window_gain_ * window_gain_;
+
+    for (size_t b = 0; b < band_map_.size(); ++b) {
+        float peak_power = 0.0f;
+        for (uint32_t k = band_map_[b].first_bin; k <= band_map_[b].last_bin; ++k) {
+            const float re = fft_output_[k][0];
+            const float im = fft_output_[k][1];
+            peak_power = std::max(peak_power, re * re + im * im);
+        }
+
+        const float db = 10.0f * std::log10(peak_power * gain_squared + 1e-20f);
+        const float level = std::clamp((db - floor_db) / range, 0.0f, 1.0f);
+        float& shown = working_.levels[b];
+        shown = level >= shown ? level : std::max(level, shown * release);
+    }
+
+    ++working_.sequence;
+    frame_.store(working_);
+}
+
+std::vector<float> SpectrumAnalyzer::get_spectrum(int bins) const {
+    std::vector<float> result(std::max(bins, 0), 0.0f);
+    const SpectrumFrame frame = frame_.load();
+    if (bins <= 0 || frame.band_count == 0) {
+        return result;
+    }
+
+    if (static_cast<uint32_t>(bins) == frame.band_count) {
+        std::copy(frame.levels.begin(), frame.levels.begin() + bins, result.begin());
+        return result;
+    }
+
+    // Bands and bins are both log-spaced over the same range, so each bin
+    // covers a fixed run of bands; take the loudest of the run
+    struct BinMap {
+        int bins = 0;
+        uint32_t bands = 0;
+        std::vector<uint32_t> first_band;   // bins + 1 entries
+    };
+    thread_local BinMap map;
+    if (map.bins != bins || map.bands != frame.band_count) {
+        map.bins = bins;
+        map.bands = frame.band_count;
+        map.first_band.resize(bins + 1);
+        for (int i = 0; i <= bins; ++i) {
+            map.first_band[i] = static_cast<uint32_t>(static_cast<uint64_t>(i) * frame.band_count / bins);
+        }
+    }
+
+    for (int i = 0; i < bins; ++i) {
+        const uint32_t first = std::min(map.first_band[i], frame.band_count - 1);
+        const uint32_t end = std::max(map.first_band[i + 1], first + 1);
+        result[i] = *std::max_element(frame.levels.begin() + first, frame.levels.begin() + end);
+    }
+    return result;
+}
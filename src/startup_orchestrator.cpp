@@ -0,0 +1,229 @@
+#include "startup_orchestrator.hpp"
+#include "metrics_registry.hpp"
+#include "trace_profiler.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+std::string format_ms(double ms) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.1f ms", ms);
+    return buffer;
+}
+
+} // namespace
+
+StartupOrchestrator::StartupOrchestrator() : epoch_(std::chrono::steady_clock::now()) {}
+
+StartupOrchestrator::~StartupOrchestrator() {
+    wait();
+}
+
+void StartupOrchestrator::add_phase(const std::string& name, const std::vector<std::string>& depends_on, Phase phase,
+                                    bool required) {
+    auto entry = std::make_unique<Entry>();
+    entry->timing.name = name;
+    entry->timing.required = required;
+    entry->depends_on = depends_on;
+    entry->phase = std::move(phase);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.push_back(std::move(entry));
+}
+
+bool StartupOrchestrator::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<Entry*> batch;
+    for (auto& entry : entries_) {
+        if (!entry->scheduled && !entry->timing.lazy) {
+            entry->scheduled = true;
+            batch.push_back(entry.get());
+        }
+    }
+
+    std::vector<std::thread> threads;
+    while (true) {
+        bool changed = false;
+        size_t unfinished = 0;
+        for (Entry* entry : batch) {
+            if (entry->timing.state == StartupPhaseState::RUNNING) {
+                ++unfinished;
+            }
+            if (entry->timing.state != StartupPhaseState::PENDING) {
+                continue;
+            }
+
+            // Ready once every dependency is done; dead once any cannot be
+            std::string blocker;
+            bool ready = true;
+            for (const std::string& name : entry->depends_on) {
+                const Entry* dependency = find(name);
+                if (!dependency) {
+                    blocker = name + " does not exist";
+                } else if (dependency->timing.state == StartupPhaseState::FAILED ||
+                           dependency->timing.state == StartupPhaseState::SKIPPED) {
+                    blocker = name + " did not complete";
+                } else if (dependency->timing.state == StartupPhaseState::PENDING && !dependency->scheduled) {
+                    blocker = name + " is not part of this run";
+                }
+                if (!blocker.empty()) {
+                    break;
+                }
+                ready = ready && dependency->timing.state == StartupPhaseState::DONE;
+            }
+
+            if (!blocker.empty()) {
+                entry->timing.state = StartupPhaseState::SKIPPED;
+                changed = true;
+                Logger::warn("Startup", "Skipping " + entry->timing.name + ": " + blocker);
+                continue;
+            }
+            ++unfinished;
+            if (!ready) {
+                continue;
+            }
+
+            entry->timing.state = StartupPhaseState::RUNNING;
+            entry->timing.start_ms = elapsed_ms();
+            threads.emplace_back([this, entry] {
+                TRACE_THREAD_NAME("startup");
+                bool success = false;
+                try {
+                    TRACE_SCOPE("startup_phase");
+                    success = entry->phase();
+                } catch (const std::exception& e) {
+                    Logger::error("Startup", entry->timing.name + " threw: " + e.what());
+                }
+                finish(*entry, success);
+            });
+        }
+
+        if (unfinished == 0) {
+            break;
+        }
+        if (!changed) {
+            changed_.wait(lock);
+        }
+    }
+    lock.unlock();
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    lock.lock();
+    return std::none_of(batch.begin(), batch.end(), [](const Entry* entry) {
+        return entry->timing.required && entry->timing.state != StartupPhaseState::DONE;
+    });
+}
+
+void StartupOrchestrator::run_async() {
+    wait();
+    background_ = std::thread([this] { background_result_ = run(); });
+}
+
+bool StartupOrchestrator::wait() {
+    if (background_.joinable()) {
+        background_.join();
+    }
+    return background_result_;
+}
+
+bool StartupOrchestrator::run_once(const std::string& name, const Phase& phase) {
+    std::lock_guard<std::mutex> once_lock(once_mutex_);
+    Entry* entry = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const Entry* existing = find(name)) {
+            return existing->timing.state == StartupPhaseState::DONE;
+        }
+        auto created = std::make_unique<Entry>();
+        created->timing.name = name;
+        created->timing.lazy = true;
+        created->timing.required = false;
+        created->timing.state = StartupPhaseState::RUNNING;
+        created->timing.start_ms = elapsed_ms();
+        created->scheduled = true;
+        entry = created.get();
+        entries_.push_back(std::move(created));
+    }
+
+    bool success = false;
+    try {
+        success = phase();
+    } catch (const std::exception& e) {
+        Logger::error("Startup", name + " threw: " + e.what());
+    }
+    finish(*entry, success);
+    return success;
+}
+
+void StartupOrchestrator::finish(Entry& entry, bool success) {
+    std::string message;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        StartupPhaseTiming& timing = entry.timing;
+        timing.end_ms = elapsed_ms();
+        timing.duration_ms = timing.end_ms - timing.start_ms;
+        timing.state = success ? StartupPhaseState::DONE : StartupPhaseState::FAILED;
+        message = timing.name + (success ? " took " : " failed after ") + format_ms(timing.duration_ms) +
+                  ", done at " + format_ms(timing.end_ms);
+        MetricsRegistry::instance()
+            .gauge("onestop_startup_phase_seconds", "How long each startup phase took", {{"phase", timing.name}})
+            .set(timing.duration_ms / 1000.0);
+    }
+    changed_.notify_all();
+
+    if (success) {
+        Logger::info("Startup", message);
+    } else {
+        Logger::error("Startup", message);
+    }
+}
+
+StartupOrchestrator::Entry* StartupOrchestrator::find(const std::string& name) {
+    for (auto& entry : entries_) {
+        if (entry->timing.name == name) {
+            return entry.get();
+        }
+    }
+    return nullptr;
+}
+
+std::vector<StartupPhaseTiming> StartupOrchestrator::timings() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<StartupPhaseTiming> result;
+    result.reserve(entries_.size());
+    for (const auto& entry : entries_) {
+        result.push_back(entry->timing);
+    }
+    return result;
+}
+
+bool StartupOrchestrator::get_timing(const std::string& name, StartupPhaseTiming& timing) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : entries_) {
+        if (entry->timing.name == name) {
+            timing = entry->timing;
+            return true;
+        }
+    }
+    return false;
+}
+
+double StartupOrchestrator::elapsed_ms() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - epoch_).count();
+}
+
+const char* StartupOrchestrator::state_name(StartupPhaseState state) {
+    switch (state) {
+        case StartupPhaseState::PENDING: return "pending";
+        case StartupPhaseState::RUNNING: return "running";
+        case StartupPhaseState::DONE: return "done";
+        case StartupPhaseState::FAILED: return "failed";
+        case StartupPhaseState::SKIPPED: return "skipped";
+    }
+    return "unknown";
+}
@@ -0,0 +1,581 @@
+#include "station_host.hpp"
+#include "metrics_registry.hpp"
+#include "trace_profiler.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <pthread.h>
+#include <time.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr auto kIdleWait = std::chrono::milliseconds(50);
+constexpr uint64_t kNanosPerSecond = 1000000000ull;
+
+struct StationMetrics {
+    MetricCounter& blocks;
+    MetricCounter& overruns;
+    MetricGauge& load;
+    MetricGauge& cpu_seconds;
+
+    explicit StationMetrics(const std::string& station)
+        : blocks(MetricsRegistry::instance().counter(
+              "onestop_station_blocks_total", "Audio periods rendered by a hosted station", {{"station", station}}))
+        , overruns(MetricsRegistry::instance().counter(
+              "onestop_station_overruns_total", "Periods a hosted station skipped because its worker fell behind",
+              {{"station", station}}))
+        , load(MetricsRegistry::instance().gauge(
+              "onestop_station_load", "Share of a core a hosted station's audio used over the last second",
+              {{"station", station}}))
+        , cpu_seconds(MetricsRegistry::instance().gauge(
+              "onestop_station_cpu_seconds", "CPU time spent on a hosted station's audio and jobs",
+              {{"station", station}})) {}
+};
+
+uint64_t thread_cpu_ns() {
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<uint64_t>(now.tv_sec) * kNanosPerSecond + static_cast<uint64_t>(now.tv_nsec);
+}
+
+// Without going through floating point, so a station's clock never drifts
+uint64_t frames_to_ns(uint64_t frames, int sample_rate) {
+    const uint64_t rate = static_cast<uint64_t>(sample_rate);
+    return frames / rate * kNanosPerSecond + frames % rate * kNanosPerSecond / rate;
+}
+
+bool pin_to_core(std::thread& thread, int core) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+    (void)thread;
+    (void)core;
+    return false;
+#endif
+}
+
+bool valid_station_id(const std::string& id) {
+    return !id.empty() && std::all_of(id.begin(), id.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_';
+    });
+}
+
+struct HostedStation {
+    StationConfig config;
+    std::shared_ptr<AudioSystem> audio;
+    StationMetrics metrics;
+    int worker = -1;
+
+    // Worker thread only
+    std::vector<float> output;
+    size_t block_frames = 0;
+    Clock::time_point epoch;
+    uint64_t clock_frames = 0;          // Frames due since epoch, rendered or skipped
+    bool clock_started = false;
+    uint64_t window_frames = 0;
+    uint64_t window_cpu_ns = 0;
+
+    std::atomic<uint64_t> blocks{0};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> cpu_ns{0};
+    std::atomic<uint64_t> job_cpu_ns{0};
+    std::atomic<uint64_t> jobs{0};
+    std::atomic<double> load{0.0};
+
+    HostedStation(const StationConfig& station_config, std::shared_ptr<AudioSystem> engine)
+        : config(station_config), audio(std::move(engine)), metrics(station_config.id) {}
+
+    void charge(uint64_t audio_ns, uint64_t job_ns) {
+        const uint64_t total = cpu_ns.fetch_add(audio_ns + job_ns, std::memory_order_relaxed) + audio_ns + job_ns;
+        metrics.cpu_seconds.set(static_cast<double>(total) / kNanosPerSecond);
+    }
+};
+
+} // namespace
+
+class StationHost::Impl {
+public:
+    struct Worker {
+        std::thread thread;
+        int core = -1;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<std::shared_ptr<HostedStation>> stations;  // Guarded by mutex
+        uint64_t version = 0;                                  // Guarded by mutex
+        std::atomic<uint64_t> seen_version{0};                 // What the loop renders from
+    };
+
+    struct Task {
+        std::shared_ptr<HostedStation> station;
+        Job job;
+    };
+
+    struct JobQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    explicit Impl(const StationHostOptions& host_options) : options(host_options) {
+        size_t count = options.workers;
+        if (count == 0) {
+            const unsigned hardware = std::thread::hardware_concurrency();
+            count = hardware > 1 ? hardware - 1 : 1;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for (size_t i = 0; i < std::max<size_t>(options.job_workers, 1); ++i) {
+            job_queues.push_back(std::make_unique<JobQueue>());
+        }
+    }
+
+    // ===== AUDIO WORKERS =====
+
+    void worker_loop(Worker& worker) {
+        TRACE_THREAD_NAME("station_worker");
+        std::vector<std::shared_ptr<HostedStation>> local;
+        uint64_t version = 0;
+
+        while (running) {
+            {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                if (worker.version != version) {
+                    local = worker.stations;
+                    version = worker.version;
+                }
+            }
+            worker.seen_version.store(version);
+
+            const Clock::time_point now = Clock::now();
+            Clock::time_point next = now + kIdleWait;
+            for (const auto& station : local) {
+                next = std::min(next, render_due(*station, now));
+            }
+
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.wake.wait_until(lock, next, [&] { return !running || worker.version != version; });
+        }
+        worker.seen_version.store(~0ull);
+    }
+
+    // Renders the station if its period has come; returns when it is next due
+    Clock::time_point render_due(HostedStation& station, Clock::time_point now) {
+        const int sample_rate = station.audio->get_sample_rate();
+        if (!station.clock_started) {
+            station.epoch = now;
+            station.clock_started = true;
+        }
+        Clock::time_point due = station.epoch + std::chrono::nanoseconds(frames_to_ns(station.clock_frames, sample_rate));
+        if (due > now) {
+            return due;
+        }
+
+        // Better one station drops a few periods than every station on the worker falls behind
+        const uint64_t late_frames = static_cast<uint64_t>(
+            std::chrono::duration<double>(now - due).count() * sample_rate);
+        const uint64_t late_blocks = late_frames / station.block_frames;
+        if (late_blocks > static_cast<uint64_t>(std::max(options.max_late_blocks, 0))) {
+            station.clock_frames += late_blocks * station.block_frames;
+            station.overruns.fetch_add(late_blocks, std::memory_order_relaxed);
+            station.metrics.overruns.increment(late_blocks);
+        }
+
+        const uint64_t cpu_start = thread_cpu_ns();
+        {
+            TRACE_SCOPE("station_block");
+            station.audio->process_block(station.output.data(), static_cast<int>(station.block_frames));
+        }
+        const uint64_t cpu = thread_cpu_ns() - cpu_start;
+        station.clock_frames += station.block_frames;
+        station.blocks.fetch_add(1, std::memory_order_relaxed);
+        station.metrics.blocks.increment();
+        station.charge(cpu, 0);
+
+        station.window_cpu_ns += cpu;
+        station.window_frames += station.block_frames;
+        if (station.window_frames >= static_cast<uint64_t>(sample_rate)) {
+            const double load = static_cast<double>(station.window_cpu_ns) /
+                                static_cast<double>(frames_to_ns(station.window_frames, sample_rate));
+            station.load.store(load, std::memory_order_relaxed);
+            station.metrics.load.set(load);
+            station.window_cpu_ns = 0;
+            station.window_frames = 0;
+        }
+
+        return station.epoch + std::chrono::nanoseconds(frames_to_ns(station.clock_frames, sample_rate));
+    }
+
+    void attach(const std::shared_ptr<HostedStation>& station) {
+        Worker& worker = *workers[station->worker];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.stations.push_back(station);
+            ++worker.version;
+        }
+        worker.wake.notify_one();
+    }
+
+    // Returns once the worker can no longer be rendering the station
+    void detach(const std::shared_ptr<HostedStation>& station) {
+        Worker& worker = *workers[station->worker];
+        uint64_t version = 0;
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            auto& list = worker.stations;
+            list.erase(std::remove(list.begin(), list.end(), station), list.end());
+            version = ++worker.version;
+        }
+        worker.wake.notify_one();
+        if (!running) {
+            return;
+        }
+        while (worker.seen_version.load() < version) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    int least_loaded_worker() const {
+        std::vector<size_t> counts(workers.size(), 0);
+        for (const auto& [id, station] : stations) {
+            ++counts[station->worker];
+        }
+        return static_cast<int>(std::min_element(counts.begin(), counts.end()) - counts.begin());
+    }
+
+    bool start_station(HostedStation& station) {
+        if (!station.audio->start_headless()) {
+            return false;
+        }
+        if (!station.config.stream_targets.empty() && !station.audio->start_streaming()) {
+            Logger::warn("StationHost", "Station " + station.config.id + " failed to start streaming");
+        }
+        return true;
+    }
+
+    void stop_station(HostedStation& station) {
+        if (station.audio->is_streaming()) {
+            station.audio->stop_streaming();
+        }
+        station.audio->stop();
+        station.clock_started = false;
+        station.clock_frames = 0;
+    }
+
+    // ===== JOB POOL =====
+
+    // Each worker takes from the front of its own queue and, when that is
+    // empty, steals from the back of the others'
+    bool take_task(size_t index, Task& task) {
+        for (size_t i = 0; i < job_queues.size(); ++i) {
+            JobQueue& queue = *job_queues[(index + i) % job_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            } else {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void job_loop(size_t index) {
+        TRACE_THREAD_NAME("station_jobs");
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(pool_mutex);
+                pool_wake.wait(lock, [&] { return pending > 0 || !running; });
+                if (!running) {
+                    return;
+                }
+                --pending;
+            }
+
+            Task task;
+            if (!take_task(index, task)) {
+                continue;
+            }
+            const uint64_t cpu_start = thread_cpu_ns();
+            try {
+                TRACE_SCOPE("station_job");
+                task.job(*task.station->audio);
+            } catch (const std::exception& e) {
+                Logger::error("StationHost", "Job for station " + task.station->config.id + " failed: " + e.what());
+            }
+            const uint64_t cpu = thread_cpu_ns() - cpu_start;
+            task.station->job_cpu_ns.fetch_add(cpu, std::memory_order_relaxed);
+            task.station->jobs.fetch_add(1, std::memory_order_relaxed);
+            task.station->charge(0, cpu);
+        }
+    }
+
+    void enqueue(Task task) {
+        const size_t index = next_queue.fetch_add(1, std::memory_order_relaxed) % job_queues.size();
+        {
+            std::lock_guard<std::mutex> lock(job_queues[index]->mutex);
+            job_queues[index]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            ++pending;
+        }
+        pool_wake.notify_one();
+    }
+
+    StationHostOptions options;
+    std::atomic<bool> running{false};
+
+    mutable std::mutex stations_mutex;  // Guards stations; held while starting and stopping them
+    std::unordered_map<std::string, std::shared_ptr<HostedStation>> stations;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::vector<std::unique_ptr<JobQueue>> job_queues;
+    std::vector<std::thread> job_threads;
+    std::atomic<size_t> next_queue{0};
+    std::mutex pool_mutex;
+    std::condition_variable pool_wake;
+    size_t pending = 0;                 // Guarded by pool_mutex
+};
+
+StationHost::StationHost(const StationHostOptions& options) : impl_(std::make_unique<Impl>(options)) {}
+
+StationHost::~StationHost() {
+    stop();
+}
+
+bool StationHost::start() {
+    std::lock_guard<std::mutex> lock(impl_->stations_mutex);
+    if (impl_->running) {
+        return true;
+    }
+
+    for (auto& [id, station] : impl_->stations) {
+        if (!impl_->start_station(*station)) {
+            Logger::error("StationHost", "Failed to start station " + id);
+        }
+    }
+
+    impl_->running = true;
+    const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (size_t i = 0; i < impl_->workers.size(); ++i) {
+        Impl::Worker& worker = *impl_->workers[i];
+        worker.seen_version.store(0);
+        worker.thread = std::thread([this, &worker] { impl_->worker_loop(worker); });
+        worker.core = -1;
+        if (impl_->options.pin_workers) {
+            const int core = (impl_->options.first_core + static_cast<int>(i)) % cores;
+            if (pin_to_core(worker.thread, core)) {
+                worker.core = core;
+            }
+        }
+    }
+    for (size_t i = 0; i < impl_->job_queues.size(); ++i) {
+        impl_->job_threads.emplace_back([this, i] { impl_->job_loop(i); });
+    }
+
+    Logger::info("StationHost", std::to_string(impl_->stations.size()) + " stations on " +
+                                std::to_string(impl_->workers.size()) + " workers");
+    return true;
+}
+
+void StationHost::stop() {
+    std::lock_guard<std::mutex> lock(impl_->stations_mutex);
+    if (!impl_->running) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> pool_lock(impl_->pool_mutex);
+        impl_->running = false;
+    }
+    impl_->pool_wake.notify_all();
+    for (auto& worker : impl_->workers) {
+        {
+            std::lock_guard<std::mutex> worker_lock(worker->mutex);
+            ++worker->version;
+        }
+        worker->wake.notify_one();
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    for (std::thread& thread : impl_->job_threads) {
+        thread.join();
+    }
+    impl_->job_threads.clear();
+
+    // Jobs that never ran are dropped with their queues' contents
+    for (auto& queue : impl_->job_queues) {
+        std::lock_guard<std::mutex> queue_lock(queue->mutex);
+        queue->tasks.clear();
+    }
+    impl_->pending = 0;
+
+    for (auto& [id, station] : impl_->stations) {
+        impl_->stop_station(*station);
+    }
+    Logger::info("StationHost", "Stopped");
+}
+
+bool StationHost::is_running() const {
+    return impl_->running;
+}
+
+bool StationHost::add_station(const StationConfig& config) {
+    if (!valid_station_id(config.id)) {
+        Logger::error("StationHost", "Invalid station id '" + config.id + "'");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->stations_mutex);
+    if (impl_->stations.count(config.id)) {
+        Logger::error("StationHost", "Station " + config.id + " already exists");
+        return false;
+    }
+
+    auto audio = std::make_shared<AudioSystem>();
+    if (!audio->initialize(config.format)) {
+        Logger::error("StationHost", "Failed to initialize station " + config.id);
+        return false;
+    }
+    audio->set_track_cache_budget(config.track_cache_mb << 20);
+    if (config.spectrum_analyzer) {
+        audio->enable_spectral_analyzer(true);
+    }
+    for (const auto& [name, target] : config.stream_targets) {
+        audio->add_stream_target(name, target);
+    }
+
+    auto station = std::make_shared<HostedStation>(config, audio);
+    station->block_frames = static_cast<size_t>(audio->get_block_frames());
+    station->output.assign(station->block_frames * static_cast<size_t>(audio->get_channel_count()), 0.0f);
+    const int worker_count = static_cast<int>(impl_->workers.size());
+    station->worker = config.worker >= 0 ? config.worker % worker_count : impl_->least_loaded_worker();
+
+    if (impl_->running && !impl_->start_station(*station)) {
+        Logger::error("StationHost", "Failed to start station " + config.id);
+        return false;
+    }
+    impl_->stations[config.id] = station;
+    impl_->attach(station);
+
+    Logger::info("StationHost", "Station " + config.id + " on worker " + std::to_string(station->worker));
+    return true;
+}
+
+bool StationHost::remove_station(const std::string& id) {
+    std::lock_guard<std::mutex> lock(impl_->stations_mutex);
+    auto it = impl_->stations.find(id);
+    if (it == impl_->stations.end()) {
+        return false;
+    }
+    std::shared_ptr<HostedStation> station = it->second;
+    impl_->stations.erase(it);
+
+    // Queued jobs keep the engine alive until they finish; it is stopped by then
+    impl_->detach(station);
+    if (impl_->running) {
+        impl_->stop_station(*station);
+    }
+    Logger::info("StationHost", "Station " + id + " removed");
+    return true;
+}
+
+std::shared_ptr<AudioSystem> StationHost::get_station(const std::string& id) const {
+    std::lock_guard<std::mutex> lock(impl_->stations_mutex);
+    auto it = impl_->stations.find(id);
+    return it != impl_->stations.end() ? it->second->audio : nullptr;
+}
+
+std::vector<std::string> StationHost::get_station_ids() const {
+    std::lock_guard<std::mutex> lock(impl_->stations_mutex);
+    std::vector<std::string> ids;
+    ids.reserve(impl_->stations.size());
+    for (const auto& [id, station] : impl_->stations) {
+        ids.push_back(id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+bool StationHost::submit(const std::string& id, Job job) {
+    std::shared_ptr<HostedStation> station;
+    {
+        std::lock_guard<std::mutex> lock(impl_->stations_mutex);
+        auto it = impl_->stations.find(id);
+        if (it == impl_->stations.end() || !impl_->running) {
+            return false;
+        }
+        station = it->second;
+    }
+    impl_->enqueue({std::move(station), std::move(job)});
+    return true;
+}
+
+std::vector<StationStats> StationHost::stats() const {
+    std::vector<StationStats> result;
+    for (const std::string& id : get_station_ids()) {
+        StationStats stats;
+        if (get_stats(id, stats)) {
+            result.push_back(std::move(stats));
+        }
+    }
+    return result;
+}
+
+bool StationHost::get_stats(const std::string& id, StationStats& stats) const {
+    std::shared_ptr<HostedStation> station;
+    int core = -1;
+    {
+        std::lock_guard<std::mutex> lock(impl_->stations_mutex);
+        auto it = impl_->stations.find(id);
+        if (it == impl_->stations.end()) {
+            return false;
+        }
+        station = it->second;
+        if (impl_->running) {
+            core = impl_->workers[station->worker]->core;
+        }
+    }
+
+    stats = StationStats();
+    stats.id = station->config.id;
+    stats.name = station->config.name;
+    stats.running = station->audio->is_headless();
+    stats.worker = station->worker;
+    stats.core = core;
+    stats.sample_rate = station->audio->get_sample_rate();
+    stats.blocks = station->blocks.load(std::memory_order_relaxed);
+    stats.overruns = station->overruns.load(std::memory_order_relaxed);
+    stats.cpu_seconds = static_cast<double>(station->cpu_ns.load(std::memory_order_relaxed)) / kNanosPerSecond;
+    stats.job_cpu_seconds = static_cast<double>(station->job_cpu_ns.load(std::memory_order_relaxed)) / kNanosPerSecond;
+    stats.load = station->load.load(std::memory_order_relaxed);
+    stats.jobs = station->jobs.load(std::memory_order_relaxed);
+
+    const TrackCacheStats cache = station->audio->get_track_cache_stats();
+    stats.memory_bytes = cache.bytes;
+    stats.memory_budget_bytes = cache.budget_bytes;
+    stats.streaming = station->audio->is_streaming();
+    return true;
+}
+
+size_t StationHost::worker_count() const {
+    return impl_->workers.size();
+}
@@ -273,13 +273,12 @@ StreamStats StreamController::GetStreamStatus(const std::string& stream_id) {
     
     const auto& stream = it->second;
     stats.status = stream->status;
-    stats.is_connected = (stream->shout_connection != nullptr);
     stats.current_listeners = stream->current_listeners;
     stats.peak_listeners = stream->peak_listeners;
-    stats.bytes_sent = stream->bytes_sent;
     stats.start_time = stream->start_time;
     stats.last_update = std::chrono::system_clock::now();
     stats.error_message = stream->error_message;
+    FillSenderStats(*stream, stats);
     
     // Calculate uptime
     if (stream->status == StreamStatus::ACTIVE) {
@@ -300,13 +299,12 @@ std::vector<StreamStats> StreamController::GetAllStreamStats() {
         StreamStats stats{};
         stats.stream_id = stream_id;
         stats.status = stream->status;
-        stats.is_connected = (stream->shout_connection != nullptr);
         stats.current_listeners = stream->current_listeners;
         stats.peak_listeners = stream->peak_listeners;
-        stats.bytes_sent = stream->bytes_sent;
         stats.start_time = stream->start_time;
         stats.last_update = std::chrono::system_clock::now();
         stats.error_message = stream->error_message;
+        FillSenderStats(*stream, stats);
         
         if (stream->status == StreamStatus::ACTIVE) {
             auto now = std::chrono::system_clock::now();
@@ -522,6 +520,14 @@ bool StreamController::CreateShoutConnection(const std::string& stream_id) {
     shout_set_description(shout, config.description.c_str());
     shout_set_genre(shout, config.genre.c_str());
     
+    // The sender opens the connection on its own thread; SendAudioData only queues
+    shout_set_nonblocking(shout, 1);
+    
+    // Two seconds of audio at the mount's bitrate before the oldest is dropped
+    const size_t queue_bytes = static_cast<size_t>(config.quality) * 125 * 2;
+    stream->sender = std::make_unique<ShoutSender>(shout, queue_bytes);
+    stream->sender->start(true);
+    
     // Store connection
     stream->shout_connection = shout;
     
@@ -536,6 +542,10 @@ void StreamController::CloseShoutConnection(const std::string& stream_id) {
     }
     
     auto& stream = it->second;
+    if (stream->sender) {
+        stream->bytes_sent = stream->sender->get_stats().bytes_sent;
+        stream->sender.reset();
+    }
     if (stream->shout_connection) {
         shout_close(stream->shout_connection);
         shout_free(stream->shout_connection);
@@ -578,21 +588,39 @@ bool StreamController::SendAudioData(const std::string& stream_id, const uint8_t
     std::lock_guard<std::mutex> lock(streams_mutex_);
     
     auto it = streams_.find(stream_id);
-    if (it == streams_.end() || !it->second->shout_connection) {
+    if (it == streams_.end() || !it->second->sender) {
         return false;
     }
     
     auto& stream = it->second;
     
-    if (shout_send(stream->shout_connection, data, size) != SHOUTERR_SUCCESS) {
-        stream->error_message = "Failed to send audio data: " + std::string(shout_get_error(stream->shout_connection));
+    // Queue only; the sender's I/O thread talks to the server
+    if (!stream->sender->enqueue(data, size)) {
+        stream->error_message = "Failed to send audio data: " + stream->sender->get_error();
         return false;
     }
-    
-    stream->bytes_sent += size;
     return true;
 }
 
+void StreamController::FillSenderStats(const Stream& stream, StreamStats& stats) const {
+    stats.bytes_sent = stream.bytes_sent;
+    stats.is_connected = false;
+    
+    if (!stream.sender) {
+        return;
+    }
+    
+    const ShoutSenderStats sender = stream.sender->get_stats();
+    stats.is_connected = sender.connected;
+    stats.bytes_sent = static_cast<int64_t>(sender.bytes_sent);
+    stats.send_queue_bytes = sender.queue_bytes + sender.shout_queue_bytes;
+    stats.packets_dropped = static_cast<int64_t>(sender.packets_dropped);
+    stats.send_latency_ms = sender.latency_ms;
+    if (sender.failed && stats.error_message.empty()) {
+        stats.error_message = sender.error;
+    }
+}
+
 bool StreamController::IsHealthy() const {
     return initialized_ && running_;
 }
@@ -1,7 +1,8 @@
 #include "stream_controller_api.hpp"
+#include "metrics_registry.hpp"
 #include <iostream>
 #include <sstream>
-#include <regex>
+#include <stdexcept>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -34,35 +35,35 @@ bool StreamControllerAPI::Initialize(const std::string& config_file) {
         return CreateErrorResponse("Method not allowed", 405);
     });
 
-    http_server_->add_route("/api/v1/streams/([^/]+)/activate", [this](const HttpRequest& req) {
+    http_server_->add_route("/api/v1/streams/{stream_id}/activate", [this](const HttpRequest& req) {
         if (req.method == "POST") {
             return HandleActivateStream(req);
         }
         return CreateErrorResponse("Method not allowed", 405);
     });
 
-    http_server_->add_route("/api/v1/streams/([^/]+)/deactivate", [this](const HttpRequest& req) {
+    http_server_->add_route("/api/v1/streams/{stream_id}/deactivate", [this](const HttpRequest& req) {
         if (req.method == "POST") {
             return HandleDeactivateStream(req);
         }
         return CreateErrorResponse("Method not allowed", 405);
     });
 
-    http_server_->add_route("/api/v1/streams/([^/]+)/status", [this](const HttpRequest& req) {
+    http_server_->add_route("/api/v1/streams/{stream_id}/status", [this](const HttpRequest& req) {
         if (req.method == "GET") {
             return HandleGetStreamStatus(req);
         }
         return CreateErrorResponse("Method not allowed", 405);
     });
 
-    http_server_->add_route("/api/v1/streams/([^/]+)/metadata", [this](const HttpRequest& req) {
+    http_server_->add_route("/api/v1/streams/{stream_id}/metadata", [this](const HttpRequest& req) {
         if (req.method == "POST") {
             return HandleUpdateMetadata(req);
         }
         return CreateErrorResponse("Method not allowed", 405);
     });
 
-    http_server_->add_route("/api/v1/streams/([^/]+)", [this](const HttpRequest& req) {
+    http_server_->add_route("/api/v1/streams/{stream_id}", [this](const HttpRequest& req) {
         if (req.method == "PUT") {
             return HandleUpdateStream(req);
         } else if (req.method == "DELETE") {
@@ -77,6 +78,10 @@ bool StreamControllerAPI::Initialize(const std::string& config_file) {
         return HandleHealthCheck(req);
     });
 
+    http_server_->add_route("GET", "/metrics", MetricsRegistry::kContentType, [](const HttpRequest&) {
+        return MetricsRegistry::instance().render_prometheus();
+    });
+
     http_server_->add_route("/api/v1/reload", [this](const HttpRequest& req) {
         if (req.method == "POST") {
             return HandleReloadConfig(req);
@@ -125,7 +130,7 @@ std::string StreamControllerAPI::HandleCreateStream(const HttpRequest& request)
 
 std::string StreamControllerAPI::HandleActivateStream(const HttpRequest& request) {
     try {
-        std::string stream_id = ExtractStreamId(request.path);
+        std::string stream_id = ExtractStreamId(request);
         
         if (stream_controller_->ActivateStream(stream_id)) {
             json response = {
@@ -144,7 +149,7 @@ std::string StreamControllerAPI::HandleActivateStream(const HttpRequest& request
 
 std::string StreamControllerAPI::HandleDeactivateStream(const HttpRequest& request) {
     try {
-        std::string stream_id = ExtractStreamId(request.path);
+        std::string stream_id = ExtractStreamId(request);
         
         if (stream_controller_->DeactivateStream(stream_id)) {
             json response = {
@@ -163,7 +168,7 @@ std::string StreamControllerAPI::HandleDeactivateStream(const HttpRequest& reque
 
 std::string StreamControllerAPI::HandleDeleteStream(const HttpRequest& request) {
     try {
-        std::string stream_id = ExtractStreamId(request.path);
+        std::string stream_id = ExtractStreamId(request);
         
         if (stream_controller_->DeleteMountPoint(stream_id)) {
             json response = {
@@ -182,7 +187,7 @@ std::string StreamControllerAPI::HandleDeleteStream(const HttpRequest& request)
 
 std::string StreamControllerAPI::HandleUpdateStream(const HttpRequest& request) {
     try {
-        std::string stream_id = ExtractStreamId(request.path);
+        std::string stream_id = ExtractStreamId(request);
         StreamConfig config = JsonToStreamConfig(request.body);
         config.stream_id = stream_id;  // Ensure stream_id matches URL
         
@@ -203,7 +208,7 @@ std::string StreamControllerAPI::HandleUpdateStream(const HttpRequest& request)
 
 std::string StreamControllerAPI::HandleGetStreamStatus(const HttpRequest& request) {
     try {
-        std::string stream_id = ExtractStreamId(request.path);
+        std::string stream_id = ExtractStreamId(request);
         StreamStats stats = stream_controller_->GetStreamStatus(stream_id);
         
         if (stats.status == StreamStatus::ERROR && stats.stream_id.empty()) {
@@ -239,7 +244,7 @@ std::string StreamControllerAPI::HandleGetAllStreams(const HttpRequest& request)
 
 std::string StreamControllerAPI::HandleUpdateMetadata(const HttpRequest& request) {
     try {
-        std::string stream_id = ExtractStreamId(request.path);
+        std::string stream_id = ExtractStreamId(request);
         json request_json = json::parse(request.body);
         
         std::string title = request_json.value("title", "");
@@ -360,6 +365,9 @@ std::string StreamControllerAPI::StreamStatsToJson(const StreamStats& stats) {
         {"current_listeners", stats.current_listeners},
         {"peak_listeners", stats.peak_listeners},
         {"bytes_sent", stats.bytes_sent},
+        {"send_queue_bytes", stats.send_queue_bytes},
+        {"packets_dropped", stats.packets_dropped},
+        {"send_latency_ms", stats.send_latency_ms},
         {"uptime_seconds", stats.uptime_seconds},
         {"start_time", std::chrono::duration_cast<std::chrono::seconds>(
             stats.start_time.time_since_epoch()).count()},
@@ -378,16 +386,14 @@ std::string StreamControllerAPI::StreamStatsToJson(const StreamStats& stats) {
     return j.dump();
 }
 
-std::string StreamControllerAPI::ExtractStreamId(const std::string& path) {
-    // Extract stream_id from paths like "/api/v1/streams/{stream_id}/activate"
-    std::regex pattern(R"(/api/v1/streams/([^/]+)(?:/[^/]+)?)");
-    std::smatch matches;
-    
-    if (std::regex_search(path, matches, pattern) && matches.size() > 1) {
-        return matches[1].str();
+std::string StreamControllerAPI::ExtractStreamId(const HttpRequest& request) {
+    // Bound by the router from "/api/v1/streams/{stream_id}/..."
+    auto it = request.path_params.find("stream_id");
+    if (it != request.path_params.end() && !it->second.empty()) {
+        return it->second;
     }
-    
-    throw std::runtime_error("Could not extract stream_id from path: " + path);
+
+    throw std::runtime_error("Could not extract stream_id from path: " + request.path);
 }
 
 } // namespace onestopradio
\ No newline at end of file
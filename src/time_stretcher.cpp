@@ -0,0 +1,254 @@
+#include "time_stretcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace OneStopRadio {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kCoarseStep = 4;      // Splice offsets tried in the first pass
+
+} // namespace
+
+TimeStretcher::TimeStretcher(const TimeStretcherOptions& options)
+    : options_(options) {
+    options_.sample_rate = std::max(options_.sample_rate, 1);
+    options_.max_ratio = std::max(options_.max_ratio, 1.0f);
+    options_.max_block_frames = std::max<size_t>(options_.max_block_frames, 1);
+    channels_ = std::max(options_.channels, 1);
+    hop_ = std::max(16, static_cast<int>(std::lround(options_.sample_rate * options_.frame_ms / 2000.0)));
+    frame_ = 2 * hop_;
+    search_ = std::max(0, static_cast<int>(std::lround(options_.sample_rate * options_.search_ms / 1000.0)));
+
+    // Periodic Hann: frames at half-frame hops sum to exactly one
+    window_.resize(frame_);
+    for (int n = 0; n < frame_; ++n) {
+        window_[n] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * n / frame_));
+    }
+
+    // Widest span one hop reads: the search region around the nominal position,
+    // a whole frame, and a continuation up to max_ratio hops behind
+    const int max_ratio = static_cast<int>(std::ceil(options_.max_ratio));
+    const size_t input_capacity = static_cast<size_t>(frame_ + 2 * search_ + (max_ratio + 1) * hop_);
+    input_.assign(input_capacity * channels_, 0.0f);
+    overlap_.assign(static_cast<size_t>(frame_) * channels_, 0.0f);
+
+    fifo_capacity_ = static_cast<size_t>(std::ceil(options_.max_block_frames * options_.max_ratio)) + 2 * hop_ + 8;
+    fifo_.assign(fifo_capacity_ * channels_, 0.0f);
+
+    update_ratios();
+    reset();
+}
+
+void TimeStretcher::set_rate(double rate) {
+    rate_ = rate > 0.0 ? rate : 1.0;
+    update_ratios();
+}
+
+void TimeStretcher::set_pitch_shift(double semitones) {
+    pitch_semitones_ = semitones;
+    update_ratios();
+}
+
+void TimeStretcher::set_key_lock(bool enabled) {
+    key_lock_ = enabled;
+    update_ratios();
+}
+
+void TimeStretcher::set_source_rate(int sample_rate) {
+    source_rate_ = sample_rate;
+    update_ratios();
+}
+
+void TimeStretcher::update_ratios() {
+    const double pitch = std::pow(2.0, pitch_semitones_ / 12.0);
+    const double source = source_rate_ > 0 ? static_cast<double>(source_rate_) / options_.sample_rate : 1.0;
+    const double resample = key_lock_ ? pitch : rate_ * pitch;
+    const double low = 1.0 / options_.max_ratio;
+    const double high = options_.max_ratio;
+
+    // Source frames per second stay at rate * source rate whichever way it splits
+    stretch_ = std::clamp(rate_ / resample, low, high);
+    step_ = std::clamp(resample * source, low, high);
+}
+
+void TimeStretcher::reset() {
+    // Splices may look up to search_ frames before the start, where it is silent
+    input_start_ = -search_;
+    input_end_ = 0;
+    std::fill(input_.begin(), input_.begin() + static_cast<size_t>(search_) * channels_, 0.0f);
+
+    analysis_position_ = 0.0;
+    natural_position_ = 0;
+    first_frame_ = true;
+    std::fill(overlap_.begin(), overlap_.end(), 0.0f);
+
+    std::fill(fifo_.begin(), fifo_.begin() + channels_, 0.0f);
+    fifo_frames_ = 1;
+    fifo_position_ = 1.0;
+}
+
+double TimeStretcher::source_position() const {
+    const double pending = static_cast<double>(fifo_frames_) - fifo_position_;
+    return std::max(0.0, analysis_position_ - stretch_ * std::max(pending, 0.0));
+}
+
+void TimeStretcher::render(float* out, size_t frames, TimeStretchSource& source) {
+    const auto begin = std::chrono::steady_clock::now();
+    frames = std::min(frames, options_.max_block_frames);
+
+    // Keep one frame of history before the read position; the rest is spent
+    const size_t spent = static_cast<size_t>(fifo_position_) - 1;
+    if (spent > 0) {
+        std::memmove(fifo_.data(), fifo_.data() + spent * channels_,
+                     (fifo_frames_ - spent) * channels_ * sizeof(float));
+        fifo_frames_ -= spent;
+        fifo_position_ -= static_cast<double>(spent);
+    }
+
+    for (size_t i = 0; i < frames; ++i) {
+        size_t index = static_cast<size_t>(fifo_position_);
+        while (index + 2 >= fifo_frames_) {
+            next_hop(source);
+        }
+
+        // Cubic Hermite through the four frames around the read position
+        const float t = static_cast<float>(fifo_position_ - static_cast<double>(index));
+        const float* y = fifo_.data() + (index - 1) * channels_;
+        for (int ch = 0; ch < channels_; ++ch) {
+            const float ym1 = y[ch];
+            const float y0 = y[channels_ + ch];
+            const float y1 = y[2 * channels_ + ch];
+            const float y2 = y[3 * channels_ + ch];
+            const float c1 = 0.5f * (y1 - ym1);
+            const float c2 = ym1 - 2.5f * y0 + 2.0f * y1 - 0.5f * y2;
+            const float c3 = 0.5f * (y2 - ym1) + 1.5f * (y0 - y1);
+            out[i * channels_ + ch] = ((c3 * t + c2) * t + c1) * t + y0;
+        }
+        fifo_position_ += step_;
+    }
+
+    record_timing(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count(),
+                  frames);
+}
+
+void TimeStretcher::next_hop(TimeStretchSource& source) {
+    const int64_t nominal = std::llround(analysis_position_);
+
+    // Drop input no splice can reach any more
+    const int64_t keep = first_frame_ ? nominal - search_ : std::min(natural_position_, nominal - search_);
+    if (keep >= input_end_) {
+        // Fast tempo skipped past everything buffered; stream through the gap
+        float* scratch = input_.data();
+        const size_t capacity = input_.size() / channels_;
+        for (int64_t skipped = input_end_; skipped < keep;) {
+            const size_t n = static_cast<size_t>(std::min<int64_t>(keep - skipped, static_cast<int64_t>(capacity)));
+            source.read(scratch, n);
+            skipped += static_cast<int64_t>(n);
+        }
+        input_start_ = input_end_ = keep;
+    } else if (keep > input_start_) {
+        const size_t dropped = static_cast<size_t>(keep - input_start_);
+        std::memmove(input_.data(), input_.data() + dropped * channels_,
+                     static_cast<size_t>(input_end_ - keep) * channels_ * sizeof(float));
+        input_start_ = keep;
+    }
+
+    int64_t chosen = nominal;
+    if (!first_frame_) {
+        if (natural_position_ >= nominal - search_ && natural_position_ <= nominal + search_) {
+            chosen = natural_position_;     // A seamless continuation is in range
+        } else {
+            fill_input(std::max(natural_position_, nominal + search_) + hop_, source);
+            chosen = find_splice(nominal);
+        }
+    }
+    fill_input(chosen + frame_, source);
+
+    const float* x = input_frame(chosen);
+    for (int n = 0; n < frame_; ++n) {
+        const float w = window_[n];
+        for (int ch = 0; ch < channels_; ++ch) {
+            overlap_[n * channels_ + ch] += x[n * channels_ + ch] * w;
+        }
+    }
+
+    // The first hop now has both of its frames; move it to the resampler
+    const size_t hop_samples = static_cast<size_t>(hop_) * channels_;
+    std::memcpy(fifo_.data() + fifo_frames_ * channels_, overlap_.data(), hop_samples * sizeof(float));
+    fifo_frames_ += hop_;
+    std::memmove(overlap_.data(), overlap_.data() + hop_samples, hop_samples * sizeof(float));
+    std::fill(overlap_.begin() + hop_samples, overlap_.end(), 0.0f);
+
+    natural_position_ = chosen + hop_;
+    analysis_position_ += stretch_ * hop_;
+    first_frame_ = false;
+}
+
+void TimeStretcher::fill_input(int64_t end, TimeStretchSource& source) {
+    if (end <= input_end_) {
+        return;
+    }
+    source.read(input_.data() + static_cast<size_t>(input_end_ - input_start_) * channels_,
+                static_cast<size_t>(end - input_end_));
+    input_end_ = end;
+}
+
+int64_t TimeStretcher::find_splice(int64_t nominal) {
+    const float* reference = input_frame(natural_position_);
+    const float* candidates = input_frame(nominal - search_);
+
+    // Every fourth offset on every other frame, then refine around the best
+    const int span = 2 * search_;
+    int best = 0;
+    double best_score = -1e30;
+    for (int offset = 0; offset <= span; offset += kCoarseStep) {
+        const double score = correlation(reference, candidates + offset * channels_, 2);
+        if (score > best_score) {
+            best_score = score;
+            best = offset;
+        }
+    }
+    const int coarse = best;
+    best_score = correlation(reference, candidates + coarse * channels_, 1);
+    for (int offset = std::max(0, coarse - kCoarseStep + 1); offset <= std::min(span, coarse + kCoarseStep - 1); ++offset) {
+        const double score = correlation(reference, candidates + offset * channels_, 1);
+        if (score > best_score) {
+            best_score = score;
+            best = offset;
+        }
+    }
+    return nominal - search_ + best;
+}
+
+// Summed over channels, so anti-phase stereo content still lines up
+double TimeStretcher::correlation(const float* reference, const float* candidate, int stride) const {
+    float dot = 0.0f;
+    float energy = 0.0f;
+    const size_t step = static_cast<size_t>(stride) * channels_;
+    const size_t samples = static_cast<size_t>(hop_) * channels_;
+    for (size_t n = 0; n < samples; n += step) {
+        for (int ch = 0; ch < channels_; ++ch) {
+            dot += reference[n + ch] * candidate[n + ch];
+            energy += candidate[n + ch] * candidate[n + ch];
+        }
+    }
+    return dot / std::sqrt(static_cast<double>(energy) + 1e-9);
+}
+
+void TimeStretcher::record_timing(double elapsed_us, size_t frames) {
+    TimeStretchStats& stats = running_stats_;
+    stats.blocks++;
+    stats.last_us = elapsed_us;
+    stats.avg_us = stats.blocks == 1 ? elapsed_us : stats.avg_us + (elapsed_us - stats.avg_us) * 0.05;
+    stats.max_us = std::max(stats.max_us, elapsed_us);
+    const double block_us = frames * 1e6 / options_.sample_rate;
+    stats.load = block_us > 0.0 ? stats.avg_us / block_us : 0.0;
+    stats_.store(stats);
+}
+
+} // namespace OneStopRadio
@@ -0,0 +1,329 @@
+#include "trace_profiler.hpp"
+#include "utils/json_writer.hpp"
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+struct TraceProfiler::ThreadHandle {
+    ThreadBuffer* buffer = nullptr;
+    const char* name = nullptr;
+
+    ~ThreadHandle() {
+        if (buffer) {
+            buffer->owned.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local TraceProfiler::ThreadHandle TraceProfiler::local_;
+
+namespace {
+
+constexpr uint64_t kTrackUuidBase = 0x6f73720000000000ULL;  // Any base; uuid 0 is reserved
+constexpr uint32_t kClockMonotonic = 3;                     // Perfetto BuiltinClock, steady_clock on Linux
+
+// Protobuf wire encoding for the handful of Perfetto messages we emit
+class ProtoWriter {
+public:
+    void varint(uint32_t field, uint64_t value) {
+        tag(field, 0);
+        raw_varint(value);
+    }
+
+    void bytes(uint32_t field, const std::string& value) {
+        tag(field, 2);
+        raw_varint(value.size());
+        out_ += value;
+    }
+
+    void message(uint32_t field, const ProtoWriter& nested) { bytes(field, nested.out_); }
+
+    const std::string& str() const { return out_; }
+
+private:
+    void tag(uint32_t field, uint32_t wire_type) { raw_varint((static_cast<uint64_t>(field) << 3) | wire_type); }
+
+    void raw_varint(uint64_t value) {
+        while (value >= 0x80) {
+            out_ += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out_ += static_cast<char>(value);
+    }
+
+    std::string out_;
+};
+
+struct ThreadTrace {
+    uint32_t id = 0;
+    std::string name;
+    std::vector<TraceEvent> events;
+};
+
+} // namespace
+
+TraceProfiler& TraceProfiler::instance() {
+    static TraceProfiler profiler;
+    return profiler;
+}
+
+bool TraceProfiler::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capturing_.load()) {
+        return false;
+    }
+
+    // Nothing records while stopped, so every ring can be rewound
+    size_t count = buffer_count();
+    size_t spare = 0;
+    for (size_t i = 0; i < count; ++i) {
+        buffers_[i].head.store(0, std::memory_order_relaxed);
+        if (!buffers_[i].owned.load(std::memory_order_relaxed)) {
+            ++spare;
+        }
+    }
+    for (; spare < kSpareBuffers && count < kMaxThreads; ++spare, ++count) {
+        buffers_[count].events = std::make_unique<TraceEvent[]>(kEventsPerThread);
+        buffers_[count].id = static_cast<uint32_t>(count + 1);
+        buffer_count_.store(count + 1, std::memory_order_release);
+    }
+
+    dropped_.store(0, std::memory_order_relaxed);
+    capture_start_ns_ = now_ns();
+    capture_end_ns_ = 0;
+    capturing_.store(true);
+    return true;
+}
+
+bool TraceProfiler::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!capturing_.load()) {
+        return false;
+    }
+    capturing_.store(false);
+    capture_end_ns_ = now_ns();
+
+    // An event that saw the capture running is finished before export reads it
+    const size_t count = buffer_count();
+    for (size_t i = 0; i < count; ++i) {
+        while (buffers_[i].writing.load()) {
+            std::this_thread::yield();
+        }
+    }
+    return true;
+}
+
+TraceStatus TraceProfiler::status() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TraceStatus status;
+    status.capturing = capturing_.load();
+    const uint64_t end_ns = status.capturing ? now_ns() : capture_end_ns_;
+    if (capture_start_ns_ != 0 && end_ns >= capture_start_ns_) {
+        status.duration_seconds = static_cast<double>(end_ns - capture_start_ns_) * 1e-9;
+    }
+    const size_t count = buffer_count();
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t head = buffers_[i].head.load(std::memory_order_acquire);
+        if (head == 0) {
+            continue;
+        }
+        status.events += std::min<uint64_t>(head, kEventsPerThread);
+        status.overwritten += head > kEventsPerThread ? head - kEventsPerThread : 0;
+        ++status.threads;
+    }
+    status.dropped = dropped_.load(std::memory_order_relaxed);
+    return status;
+}
+
+void TraceProfiler::set_thread_name(const char* name) {
+    ThreadHandle& local = local_;
+    local.name = name;
+    if (local.buffer) {
+        local.buffer->name.store(name, std::memory_order_relaxed);
+    }
+}
+
+// A free buffer with nothing recorded in this capture, claimed without locking
+TraceProfiler::ThreadBuffer* TraceProfiler::claim_buffer() {
+    const size_t count = buffer_count();
+    for (size_t i = 0; i < count; ++i) {
+        ThreadBuffer& buffer = buffers_[i];
+        if (buffer.owned.load(std::memory_order_relaxed) || buffer.head.load(std::memory_order_relaxed) != 0) {
+            continue;
+        }
+        bool expected = false;
+        if (!buffer.owned.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            continue;
+        }
+        // Its last owner may have recorded and exited between the checks
+        if (buffer.head.load(std::memory_order_acquire) != 0) {
+            buffer.owned.store(false, std::memory_order_release);
+            continue;
+        }
+        return &buffer;
+    }
+    return nullptr;
+}
+
+void TraceProfiler::record(const char* name, uint64_t start_ns, uint64_t end_ns) {
+    ThreadHandle& local = local_;
+    ThreadBuffer* buffer = local.buffer;
+    if (!buffer) {
+        if (!capturing()) {
+            return;
+        }
+        buffer = claim_buffer();
+        if (!buffer) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer->name.store(local.name, std::memory_order_relaxed);
+        local.buffer = buffer;
+    }
+
+    // Sequentially consistent against stop(): either stop() sees us writing
+    // and waits, or we see the capture has ended
+    buffer->writing.store(true);
+    if (capturing_.load()) {
+        const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        buffer->events[head % kEventsPerThread] = TraceEvent{name, start_ns, end_ns};
+        buffer->head.store(head + 1, std::memory_order_release);
+    }
+    buffer->writing.store(false, std::memory_order_release);
+}
+
+namespace {
+
+// Caller holds the profiler's lock with no capture running
+template <typename Buffers>
+std::vector<ThreadTrace> collect(const Buffers& buffers, size_t count, size_t capacity) {
+    std::vector<ThreadTrace> threads;
+    for (size_t i = 0; i < count; ++i) {
+        const auto& buffer = buffers[i];
+        const uint64_t head = buffer.head.load(std::memory_order_acquire);
+        if (head == 0) {
+            continue;
+        }
+        ThreadTrace thread;
+        thread.id = buffer.id;
+        const char* name = buffer.name.load(std::memory_order_relaxed);
+        thread.name = name ? name : "thread " + std::to_string(buffer.id);
+        const uint64_t first = head > capacity ? head - capacity : 0;
+        thread.events.reserve(static_cast<size_t>(head - first));
+        for (uint64_t n = first; n < head; ++n) {
+            thread.events.push_back(buffer.events[n % capacity]);
+        }
+        threads.push_back(std::move(thread));
+    }
+    return threads;
+}
+
+} // namespace
+
+std::string TraceProfiler::export_chrome_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capturing_.load()) {
+        return std::string();
+    }
+    const std::vector<ThreadTrace> threads = collect(buffers_, buffer_count(), kEventsPerThread);
+    const int pid = static_cast<int>(getpid());
+    // Timestamps in microseconds from the start of the capture
+    const auto micros = [this](uint64_t ns) {
+        return static_cast<double>(static_cast<int64_t>(ns - capture_start_ns_)) * 1e-3;
+    };
+
+    std::string out;
+    JsonWriter json(out);
+    json.begin_object().key("traceEvents").begin_array();
+    for (const ThreadTrace& thread : threads) {
+        json.begin_object()
+            .key("name").value("thread_name")
+            .key("ph").value("M")
+            .key("pid").value(pid)
+            .key("tid").value(thread.id)
+            .key("args").begin_object().key("name").value(thread.name).end_object()
+            .end_object();
+        for (const TraceEvent& event : thread.events) {
+            json.begin_object()
+                .key("name").value(event.name)
+                .key("cat").value("onestop")
+                .key("ph").value("X")
+                .key("ts").value(micros(event.start_ns))
+                .key("dur").value(static_cast<double>(event.end_ns - event.start_ns) * 1e-3)
+                .key("pid").value(pid)
+                .key("tid").value(thread.id)
+                .end_object();
+        }
+    }
+    json.end_array();
+    json.key("displayTimeUnit").value("ms");
+    json.key("otherData").begin_object()
+        .key("dropped").value(dropped_.load(std::memory_order_relaxed))
+        .end_object();
+    json.end_object();
+    return out;
+}
+
+std::string TraceProfiler::export_perfetto() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capturing_.load()) {
+        return std::string();
+    }
+    std::vector<ThreadTrace> threads = collect(buffers_, buffer_count(), kEventsPerThread);
+    const uint64_t pid = static_cast<uint64_t>(getpid());
+
+    // Trace { repeated TracePacket packet = 1; }, one packet sequence per thread
+    ProtoWriter trace;
+    for (ThreadTrace& thread : threads) {
+        const uint64_t uuid = kTrackUuidBase + thread.id;
+
+        ProtoWriter descriptor_thread;          // ThreadDescriptor
+        descriptor_thread.varint(1, pid);
+        descriptor_thread.varint(2, thread.id);
+        descriptor_thread.bytes(5, thread.name);
+        ProtoWriter descriptor;                 // TrackDescriptor
+        descriptor.varint(1, uuid);
+        descriptor.message(4, descriptor_thread);
+        ProtoWriter packet;
+        packet.message(60, descriptor);
+        packet.varint(10, thread.id);           // trusted_packet_sequence_id
+        packet.varint(13, 1);                   // SEQ_INCREMENTAL_STATE_CLEARED
+        trace.message(1, packet);
+
+        const auto slice = [&](uint64_t timestamp_ns, const char* name) {
+            ProtoWriter event;                  // TrackEvent
+            event.varint(9, name ? 1 : 2);      // TYPE_SLICE_BEGIN / TYPE_SLICE_END
+            event.varint(11, uuid);
+            if (name) {
+                event.bytes(23, name);
+            }
+            ProtoWriter packet;
+            packet.varint(8, timestamp_ns);
+            packet.varint(58, kClockMonotonic);
+            packet.message(11, event);
+            packet.varint(10, thread.id);
+            trace.message(1, packet);
+        };
+
+        // Scopes are recorded as they close; replay them as properly nested
+        // begin and end pairs in time order
+        std::sort(thread.events.begin(), thread.events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+            return a.start_ns != b.start_ns ? a.start_ns < b.start_ns : a.end_ns > b.end_ns;
+        });
+        std::vector<uint64_t> open_ends;
+        for (const TraceEvent& event : thread.events) {
+            while (!open_ends.empty() && open_ends.back() <= event.start_ns) {
+                slice(open_ends.back(), nullptr);
+                open_ends.pop_back();
+            }
+            slice(event.start_ns, event.name);
+            open_ends.push_back(event.end_ns);
+        }
+        while (!open_ends.empty()) {
+            slice(open_ends.back(), nullptr);
+            open_ends.pop_back();
+        }
+    }
+    return trace.str();
+}
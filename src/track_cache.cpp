@@ -0,0 +1,594 @@
+#include "track_cache.hpp"
+#include "audio_decoder.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using OneStopRadio::AudioDecoder;
+
+namespace {
+
+// Open decoders kept between jobs, so alternating decks keep their resampler state
+constexpr size_t kMaxIdleDecoders = 4;
+
+void lower_thread_priority() {
+#ifdef __linux__
+    // Decoding must never compete with the audio callback for a core
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+}
+
+} // namespace
+
+// ===== DECODED TRACK =====
+
+DecodedTrack::DecodedTrack(std::string file_path, int sample_rate, int channels, uint64_t frames,
+                           uint32_t chunk_frames)
+    : file_path_(std::move(file_path))
+    , sample_rate_(sample_rate)
+    , channels_(channels)
+    , frames_(frames)
+    , chunk_frames_(std::max<uint32_t>(chunk_frames, 1))
+    , chunk_count_(static_cast<size_t>((frames + chunk_frames_ - 1) / chunk_frames_))
+    , chunks_(new std::atomic<float*>[chunk_count_]) {
+    for (size_t i = 0; i < chunk_count_; ++i) {
+        chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+DecodedTrack::~DecodedTrack() {
+    for (size_t i = 0; i < chunk_count_; ++i) {
+        delete[] chunks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+size_t DecodedTrack::chunk_samples(size_t index) const {
+    const uint64_t first = static_cast<uint64_t>(index) * chunk_frames_;
+    return static_cast<size_t>(std::min<uint64_t>(chunk_frames_, frames_ - first)) * channels_;
+}
+
+size_t DecodedTrack::read(uint64_t frame, float* out, size_t count) const {
+    size_t copied = 0;
+    while (copied < count && frame < frames_) {
+        const size_t index = chunk_of(frame);
+        const float* chunk = chunks_[index].load(std::memory_order_acquire);
+        if (!chunk) {
+            break;
+        }
+
+        const uint64_t offset = frame - static_cast<uint64_t>(index) * chunk_frames_;
+        const size_t available = chunk_samples(index) / channels_ - static_cast<size_t>(offset);
+        const size_t n = std::min(count - copied, available);
+        std::memcpy(out + copied * channels_, chunk + offset * channels_, n * channels_ * sizeof(float));
+        copied += n;
+        frame += n;
+    }
+    return copied;
+}
+
+bool DecodedTrack::is_decoded(uint64_t frame) const {
+    return frame < frames_ && has_chunk(chunk_of(frame));
+}
+
+size_t DecodedTrack::decoded_bytes() const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < chunk_count_; ++i) {
+        if (has_chunk(i)) {
+            bytes += chunk_samples(i) * sizeof(float);
+        }
+    }
+    return bytes;
+}
+
+bool DecodedTrack::publish_chunk(size_t index, std::unique_ptr<float[]> samples) {
+    float* expected = nullptr;
+    if (!chunks_[index].compare_exchange_strong(expected, samples.get(), std::memory_order_acq_rel)) {
+        return false;
+    }
+    samples.release();
+    decoded_chunks_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+// ===== TRACK CACHE =====
+
+class TrackCache::Impl {
+public:
+    explicit Impl(const TrackCacheOptions& options) : options_(options) {}
+
+    ~Impl() {
+        stop();
+    }
+
+    bool start() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) {
+            return true;
+        }
+
+        stopping_ = false;
+        running_ = true;
+        const size_t worker_count = std::max<size_t>(options_.workers, 1);
+        workers_.reserve(worker_count);
+        for (size_t i = 0; i < worker_count; ++i) {
+            workers_.emplace_back([this] { worker_loop(); });
+        }
+
+        Logger::info("TrackCache: Started " + std::to_string(worker_count) + " decoders (" +
+                     std::to_string(options_.memory_budget_bytes >> 20) + " MB budget)");
+        return true;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) {
+                return;
+            }
+            stopping_ = true;
+            queue_.clear();
+        }
+        work_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        Logger::info("TrackCache: Stopped");
+    }
+
+    std::shared_ptr<const DecodedTrack> acquire(const std::string& file_path, double position_seconds) {
+        std::shared_ptr<DecodedTrack> track;
+        int sample_rate = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sample_rate = options_.sample_rate;
+            auto it = entries_.find(file_path);
+            if (it != entries_.end()) {
+                ++hits_;
+                touch_locked(it->second);
+                track = it->second.track;
+            } else {
+                ++misses_;
+            }
+        }
+
+        if (!track) {
+            track = open_track(file_path, sample_rate);
+            if (!track) {
+                return nullptr;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        track = insert_locked(track);
+        if (!track->is_complete()) {
+            enqueue_locked(make_job(file_path, track, PrefetchPriority::PLAYBACK, position_seconds,
+                                    options_.playback_lead_seconds));
+            enqueue_locked(make_job(file_path, track, PrefetchPriority::LOADED, position_seconds, 0.0));
+        }
+        return track;
+    }
+
+    std::shared_ptr<const DecodedTrack> find(const std::string& file_path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(file_path);
+        if (it == entries_.end()) {
+            return nullptr;
+        }
+        touch_locked(it->second);
+        return it->second.track;
+    }
+
+    void prefetch(const std::string& file_path, PrefetchPriority priority, double position_seconds, double seconds) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<DecodedTrack> track;
+        auto it = entries_.find(file_path);
+        if (it != entries_.end()) {
+            track = it->second.track;
+            if (track->is_complete()) {
+                return;
+            }
+        }
+        enqueue_locked(make_job(file_path, std::move(track), priority, position_seconds, seconds));
+    }
+
+    void set_memory_budget(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_.memory_budget_bytes = bytes;
+        while (bytes_ > options_.memory_budget_bytes && evict_one_locked()) {
+        }
+    }
+
+    void set_sample_rate(int sample_rate) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (sample_rate == options_.sample_rate) {
+            return;
+        }
+        options_.sample_rate = sample_rate;
+
+        // Tracks at the old rate are forgotten; decks holding one keep it until they reload
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (sample_rate > 0 && it->second.track->sample_rate() != sample_rate) {
+                bytes_ -= std::min(bytes_, it->second.track->decoded_bytes());
+                lru_.erase(it->second.lru);
+                it = entries_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        queue_.erase(std::remove_if(queue_.begin(), queue_.end(), [this](const Job& job) {
+            return job.track && entries_.find(job.file_path) == entries_.end();
+        }), queue_.end());
+        idle_decoders_.clear();
+    }
+
+    TrackCacheStats get_stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        TrackCacheStats stats;
+        stats.tracks = entries_.size();
+        stats.bytes = bytes_;
+        stats.budget_bytes = options_.memory_budget_bytes;
+        stats.queued = queue_.size();
+        stats.hits = hits_;
+        stats.misses = misses_;
+        stats.evictions = evictions_;
+        return stats;
+    }
+
+    double hot_cue_seconds() const {
+        return options_.hot_cue_seconds;
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<DecodedTrack> track;
+        std::list<std::string>::iterator lru;   // Front is most recently used
+    };
+
+    struct Job {
+        std::string file_path;
+        std::shared_ptr<DecodedTrack> track;    // Null until a worker has read the header
+        PrefetchPriority priority = PrefetchPriority::UPCOMING;
+        double position_seconds = 0.0;
+        double seconds = 0.0;                   // <= 0: the whole track, wrapping around
+        uint64_t sequence = 0;
+
+        bool whole() const { return seconds <= 0.0; }
+    };
+
+    Job make_job(const std::string& file_path, std::shared_ptr<DecodedTrack> track, PrefetchPriority priority,
+                 double position_seconds, double seconds) {
+        Job job;
+        job.file_path = file_path;
+        job.track = std::move(track);
+        job.priority = priority;
+        job.position_seconds = std::max(position_seconds, 0.0);
+        job.seconds = seconds;
+        job.sequence = next_sequence_++;
+        return job;
+    }
+
+    // Reads the header; the decoder is pooled for the worker that decodes the samples
+    std::shared_ptr<DecodedTrack> open_track(const std::string& file_path, int sample_rate) {
+        std::unique_ptr<AudioDecoder> decoder = AudioDecoder::open(file_path, sample_rate);
+        if (!decoder) {
+            Logger::warn("TrackCache: Failed to open " + file_path);
+            return nullptr;
+        }
+
+        const auto& info = decoder->info();
+        auto track = std::make_shared<DecodedTrack>(file_path, info.sample_rate, info.channels, info.frames,
+                                                    options_.chunk_frames);
+        release_decoder(std::move(decoder));
+        return track;
+    }
+
+    // An idle decoder of the track, or a new one
+    std::unique_ptr<AudioDecoder> checkout_decoder(const DecodedTrack& track) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto it = idle_decoders_.begin(); it != idle_decoders_.end(); ++it) {
+                const auto& info = (*it)->info();
+                if ((*it)->file_path() == track.file_path() && info.sample_rate == track.sample_rate() &&
+                    info.channels == track.channels()) {
+                    std::unique_ptr<AudioDecoder> decoder = std::move(*it);
+                    idle_decoders_.erase(it);
+                    return decoder;
+                }
+            }
+        }
+
+        std::unique_ptr<AudioDecoder> decoder = AudioDecoder::open(track.file_path(), track.sample_rate());
+        if (decoder && (decoder->info().sample_rate != track.sample_rate() ||
+                        decoder->info().channels != track.channels())) {
+            return nullptr;     // The file changed since its header was read
+        }
+        return decoder;
+    }
+
+    void release_decoder(std::unique_ptr<AudioDecoder> decoder) {
+        if (!decoder) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_decoders_.push_front(std::move(decoder));
+        if (idle_decoders_.size() > kMaxIdleDecoders) {
+            idle_decoders_.pop_back();
+        }
+    }
+
+    // @return the cached track for its path, which is `track` unless another thread got there first
+    std::shared_ptr<DecodedTrack> insert_locked(const std::shared_ptr<DecodedTrack>& track) {
+        auto it = entries_.find(track->file_path());
+        if (it != entries_.end()) {
+            touch_locked(it->second);
+            return it->second.track;
+        }
+
+        lru_.push_front(track->file_path());
+        entries_.emplace(track->file_path(), Entry{track, lru_.begin()});
+        return track;
+    }
+
+    void touch_locked(Entry& entry) {
+        lru_.splice(lru_.begin(), lru_, entry.lru);
+    }
+
+    // Evicts the least recently used track that only the cache holds
+    bool evict_one_locked() {
+        for (auto it = lru_.rbegin(); it != lru_.rend(); ++it) {
+            auto entry = entries_.find(*it);
+            if (entry->second.track.use_count() != 1) {
+                continue;   // On a deck, or queued for decoding
+            }
+            bytes_ -= std::min(bytes_, entry->second.track->decoded_bytes());
+            ++evictions_;
+            lru_.erase(entry->second.lru);
+            entries_.erase(entry);
+            return true;
+        }
+        return false;
+    }
+
+    void enqueue_locked(Job job) {
+        for (auto it = queue_.begin(); it != queue_.end();) {
+            const Job& queued = *it;
+            const bool same_work = queued.file_path == job.file_path && queued.whole() == job.whole() &&
+                                   (job.whole() || queued.position_seconds == job.position_seconds);
+            if (same_work && queued.priority < job.priority) {
+                return;     // Already queued more urgently
+            }
+            // Otherwise the new request replaces it; for whole tracks that moves the start
+            it = same_work ? queue_.erase(it) : it + 1;
+        }
+        queue_.push_back(std::move(job));
+        work_cv_.notify_one();
+    }
+
+    std::vector<Job>::iterator next_job_locked() {
+        return std::min_element(queue_.begin(), queue_.end(), [](const Job& a, const Job& b) {
+            return a.priority != b.priority ? a.priority < b.priority : a.sequence < b.sequence;
+        });
+    }
+
+    // A newer whole-track request for the same track makes `job` redundant
+    bool superseded_locked(const Job& job) const {
+        return job.whole() && std::any_of(queue_.begin(), queue_.end(), [&job](const Job& queued) {
+            return queued.file_path == job.file_path && queued.whole() && queued.priority <= job.priority;
+        });
+    }
+
+    bool preempted_locked(const Job& job) const {
+        return superseded_locked(job) || std::any_of(queue_.begin(), queue_.end(), [&job](const Job& queued) {
+            return queued.priority < job.priority;
+        });
+    }
+
+    // Makes room for `bytes`; prefetches give up rather than exceed the budget
+    bool reserve_locked(const Job& job, size_t bytes) {
+        while (bytes_ + bytes > options_.memory_budget_bytes && evict_one_locked()) {
+        }
+        return bytes_ + bytes <= options_.memory_budget_bytes || job.priority == PrefetchPriority::PLAYBACK ||
+               job.priority == PrefetchPriority::LOADED;
+    }
+
+    void worker_loop() {
+        lower_thread_priority();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            work_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) {
+                break;
+            }
+
+            auto next = next_job_locked();
+            Job job = std::move(*next);
+            queue_.erase(next);
+            lock.unlock();
+
+            run_job(job);
+
+            lock.lock();
+        }
+    }
+
+    void run_job(Job& job) {
+        if (!job.track) {
+            int sample_rate = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                sample_rate = options_.sample_rate;
+            }
+            std::shared_ptr<DecodedTrack> track = open_track(job.file_path, sample_rate);
+            if (!track) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            job.track = insert_locked(track);
+        }
+
+        std::unique_ptr<AudioDecoder> decoder;
+        decode_chunks(job, decoder);
+        release_decoder(std::move(decoder));
+    }
+
+    void decode_chunks(Job& job, std::unique_ptr<AudioDecoder>& decoder) {
+        DecodedTrack& track = *job.track;
+        const uint64_t start_frame = std::min<uint64_t>(
+            static_cast<uint64_t>(job.position_seconds * track.sample_rate()), track.frames() - 1);
+        const size_t first = track.chunk_of(start_frame);
+        size_t count = track.chunk_count();
+        if (!job.whole()) {
+            const uint64_t end_frame = std::min<uint64_t>(
+                static_cast<uint64_t>(std::ceil((job.position_seconds + job.seconds) * track.sample_rate())),
+                track.frames());
+            count = end_frame > start_frame ? track.chunk_of(end_frame - 1) - first + 1 : 1;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            const size_t index = (first + i) % track.chunk_count();
+            if (track.has_chunk(index)) {
+                continue;
+            }
+            const size_t samples = track.chunk_samples(index);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) {
+                    return;
+                }
+                if (superseded_locked(job)) {
+                    return;
+                }
+                if (preempted_locked(job)) {
+                    // Pick up from this chunk once the urgent work is done; the
+                    // sequence keeps the job's place among its priority
+                    const double chunk_seconds = static_cast<double>(index) * track.chunk_frames() / track.sample_rate();
+                    if (!job.whole()) {
+                        job.seconds -= chunk_seconds - job.position_seconds;
+                    }
+                    job.position_seconds = chunk_seconds;
+                    queue_.push_back(std::move(job));
+                    return;
+                }
+                if (!reserve_locked(job, samples * sizeof(float))) {
+                    LOG_DEBUG("TrackCache: Budget full, dropped prefetch of " + job.file_path);
+                    return;
+                }
+            }
+
+            if (!decoder) {
+                decoder = checkout_decoder(track);
+            }
+            if (!decoder || !decode_chunk(track, index, *decoder)) {
+                Logger::warn("TrackCache: Failed to decode " + job.file_path);
+                return;
+            }
+        }
+    }
+
+    bool decode_chunk(DecodedTrack& track, size_t index, AudioDecoder& decoder) {
+        // Consecutive chunks need no seek, so the resampler runs on uninterrupted
+        const uint64_t first_frame = static_cast<uint64_t>(index) * track.chunk_frames();
+        if (decoder.position() != first_frame && !decoder.seek(first_frame)) {
+            return false;
+        }
+
+        const size_t samples = track.chunk_samples(index);
+        const size_t frames = samples / track.channels();
+        std::unique_ptr<float[]> chunk(new float[samples]);
+        const size_t got = decoder.read(chunk.get(), frames);
+
+        // Frames the decoder did not deliver play as silence, as in the analyzer;
+        // FFmpeg frame counts come from the container and may overshoot
+        std::fill(chunk.get() + got * track.channels(), chunk.get() + samples, 0.0f);
+
+        if (track.publish_chunk(index, std::move(chunk))) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(track.file_path());
+            if (it != entries_.end() && it->second.track.get() == &track) {
+                bytes_ += samples * sizeof(float);
+            }
+        }
+        return true;
+    }
+
+    TrackCacheOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::vector<std::thread> workers_;
+    bool running_ = false;
+    bool stopping_ = false;
+
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> lru_;
+    size_t bytes_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+
+    std::vector<Job> queue_;
+    uint64_t next_sequence_ = 0;
+
+    std::list<std::unique_ptr<AudioDecoder>> idle_decoders_;   // Front is most recently used
+};
+
+TrackCache::TrackCache(const TrackCacheOptions& options)
+    : impl_(std::make_unique<Impl>(options)) {}
+
+TrackCache::~TrackCache() = default;
+
+bool TrackCache::start() {
+    return impl_->start();
+}
+
+void TrackCache::stop() {
+    impl_->stop();
+}
+
+std::shared_ptr<const DecodedTrack> TrackCache::acquire(const std::string& file_path, double position_seconds) {
+    return impl_->acquire(file_path, position_seconds);
+}
+
+std::shared_ptr<const DecodedTrack> TrackCache::find(const std::string& file_path) {
+    return impl_->find(file_path);
+}
+
+void TrackCache::prefetch(const std::string& file_path, PrefetchPriority priority) {
+    impl_->prefetch(file_path, priority, 0.0, 0.0);
+}
+
+void TrackCache::prefetch_region(const std::string& file_path, double position_seconds, double seconds,
+                                 PrefetchPriority priority) {
+    impl_->prefetch(file_path, priority, position_seconds, seconds > 0.0 ? seconds : impl_->hot_cue_seconds());
+}
+
+void TrackCache::set_sample_rate(int sample_rate) {
+    impl_->set_sample_rate(sample_rate);
+}
+
+void TrackCache::set_memory_budget(size_t bytes) {
+    impl_->set_memory_budget(bytes);
+}
+
+TrackCacheStats TrackCache::get_stats() const {
+    return impl_->get_stats();
+}
@@ -0,0 +1,345 @@
+#include "track_catalog.hpp"
+#include "radio_control.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <cstring>
+
+namespace OneStopRadio {
+
+namespace {
+
+constexpr size_t kFilterBlock = 256;    // Matches computed per pass before collecting
+
+std::string lower(std::string_view text) {
+    std::string result(text);
+    for (char& c : result) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return result;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+uint8_t wheel_position(int number, bool major) {
+    return static_cast<uint8_t>((number - 1) + (major ? 12 : 0));
+}
+
+} // namespace
+
+// ===== MUSICAL KEYS =====
+
+uint8_t parse_musical_key(std::string_view key) {
+    const std::string text = lower(trim(key));
+    if (text.empty()) {
+        return kNoKey;
+    }
+
+    // Camelot "8A" / "12B" and Open Key "1m" / "6d"
+    if (std::isdigit(static_cast<unsigned char>(text[0]))) {
+        size_t digits = 0;
+        int number = 0;
+        while (digits < text.size() && std::isdigit(static_cast<unsigned char>(text[digits]))) {
+            number = number * 10 + (text[digits] - '0');
+            ++digits;
+        }
+        if (number < 1 || number > 12 || digits + 1 != text.size()) {
+            return kNoKey;
+        }
+        switch (text[digits]) {
+            case 'a': return wheel_position(number, false);
+            case 'b': return wheel_position(number, true);
+            case 'm': return wheel_position((number + 6) % 12 + 1, false);     // Open Key 1m is 8A
+            case 'd': return wheel_position((number + 6) % 12 + 1, true);
+            default: return kNoKey;
+        }
+    }
+
+    // Note name, accidental, then the mode
+    static const int kPitchClass[] = {9, 11, 0, 2, 4, 5, 7};   // a..g
+    if (text[0] < 'a' || text[0] > 'g') {
+        return kNoKey;
+    }
+    int pitch = kPitchClass[text[0] - 'a'];
+    std::string_view mode(text);
+    mode.remove_prefix(1);
+    if (!mode.empty() && (mode[0] == '#' || mode[0] == 'b')) {
+        pitch += mode[0] == '#' ? 1 : -1;
+        mode.remove_prefix(1);
+    }
+    mode = trim(mode);
+
+    bool major = true;
+    if (mode == "m" || mode == "min" || mode == "minor") {
+        major = false;
+    } else if (!mode.empty() && mode != "maj" && mode != "major") {
+        return kNoKey;
+    }
+
+    // Camelot numbers step by fifths: C major is 8B, its relative A minor 8A
+    pitch = (pitch + 12) % 12;
+    const int relative_major = major ? pitch : (pitch + 3) % 12;
+    return wheel_position((relative_major * 7 + 7) % 12 + 1, major);
+}
+
+std::string camelot_name(uint8_t key) {
+    if (key >= kNoKey) {
+        return "";
+    }
+    return std::to_string(key % 12 + 1) + (key < 12 ? "A" : "B");
+}
+
+KeyMask harmonic_keys(uint8_t key) {
+    if (key >= kNoKey) {
+        return 0;
+    }
+    const int number = key % 12;
+    const int ring = key < 12 ? 0 : 12;
+    return (KeyMask(1) << key) |
+           (KeyMask(1) << (ring + (number + 1) % 12)) |
+           (KeyMask(1) << (ring + (number + 11) % 12)) |
+           (KeyMask(1) << ((key + 12) % 24));
+}
+
+// ===== STRING ARENA =====
+
+std::string_view StringArena::store(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    char* data = nullptr;
+    if (text.size() > kBlockSize / 4) {
+        // Large strings get a block of their own so the current one is not wasted
+        blocks_.push_back(std::make_unique<char[]>(text.size()));
+        data = blocks_.back().get();
+    } else {
+        if (!block_ || block_used_ + text.size() > kBlockSize) {
+            blocks_.push_back(std::make_unique<char[]>(kBlockSize));
+            block_ = blocks_.back().get();
+            block_used_ = 0;
+        }
+        data = block_ + block_used_;
+        block_used_ += text.size();
+    }
+    std::memcpy(data, text.data(), text.size());
+    bytes_ += text.size();
+    return {data, text.size()};
+}
+
+void StringArena::clear() {
+    blocks_.clear();
+    block_ = nullptr;
+    block_used_ = 0;
+    bytes_ = 0;
+}
+
+// ===== CATALOG =====
+
+TrackIndex TrackCatalog::upsert(const RadioTrack& track) {
+    TrackIndex index = find(track.id);
+    if (index == kNoTrack) {
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        } else {
+            index = static_cast<TrackIndex>(live_.size());
+            bpm_.push_back(0.0f);
+            key_.push_back(kNoKey);
+            duration_ms_.push_back(0);
+            genre_.push_back(0);
+            play_count_.push_back(0);
+            live_.push_back(0);
+            ids_.emplace_back();
+            titles_.emplace_back();
+            artists_.emplace_back();
+        }
+        ids_[index] = store(track.id);
+        index_.emplace(ids_[index], index);
+        live_[index] = 1;
+    } else {
+        dead_bytes_ += titles_[index].size() + artists_[index].size();
+    }
+
+    titles_[index] = store(track.title);
+    artists_[index] = store(track.artist);
+    bpm_[index] = static_cast<float>(std::max(track.bpm, 0));
+    key_[index] = parse_musical_key(track.key);
+    duration_ms_[index] = track.duration_ms;
+    genre_[index] = intern_genre(track.genre);
+    play_count_[index] = static_cast<uint32_t>(std::max(track.play_count, 0));
+
+    if (dead_bytes_ > arena_.bytes() / 2 && dead_bytes_ > 1024 * 1024) {
+        compact();
+    }
+    return index;
+}
+
+bool TrackCatalog::remove(std::string_view track_id) {
+    auto it = index_.find(track_id);
+    if (it == index_.end()) {
+        return false;
+    }
+    const TrackIndex index = it->second;
+    index_.erase(it);
+
+    dead_bytes_ += ids_[index].size() + titles_[index].size() + artists_[index].size();
+    ids_[index] = titles_[index] = artists_[index] = {};
+    live_[index] = 0;
+    free_.push_back(index);
+    return true;
+}
+
+void TrackCatalog::clear() {
+    bpm_.clear();
+    key_.clear();
+    duration_ms_.clear();
+    genre_.clear();
+    play_count_.clear();
+    live_.clear();
+    ids_.clear();
+    titles_.clear();
+    artists_.clear();
+    index_.clear();
+    free_.clear();
+    genres_.clear();
+    genre_index_.clear();
+    arena_.clear();
+    dead_bytes_ = 0;
+}
+
+void TrackCatalog::set_play_count(TrackIndex index, int play_count) {
+    if (index < live_.size()) {
+        play_count_[index] = static_cast<uint32_t>(std::max(play_count, 0));
+    }
+}
+
+void TrackCatalog::set_analysis(TrackIndex index, float bpm, int duration_ms) {
+    if (index >= live_.size()) {
+        return;
+    }
+    if (bpm > 0.0f) {
+        bpm_[index] = bpm;
+    }
+    duration_ms_[index] = duration_ms;
+}
+
+TrackIndex TrackCatalog::find(std::string_view track_id) const {
+    auto it = index_.find(track_id);
+    return it != index_.end() ? it->second : kNoTrack;
+}
+
+int TrackCatalog::genre_id(std::string_view genre) const {
+    auto it = genre_index_.find(lower(trim(genre)));
+    return it != genre_index_.end() ? it->second : -1;
+}
+
+std::string_view TrackCatalog::genre(TrackIndex index) const {
+    return genres_.empty() ? std::string_view() : genres_[genre_[index]];
+}
+
+std::vector<TrackIndex> TrackCatalog::filter(const TrackFilter& filter) const {
+    const float low = filter.min_bpm;
+    const float high = filter.max_bpm > 0.0f ? filter.max_bpm : FLT_MAX;
+    const KeyMask keys = filter.keys != 0 ? filter.keys : ~KeyMask(0);
+    const uint32_t any_genre = filter.genre < 0 ? 1 : 0;
+    const uint16_t genre = static_cast<uint16_t>(std::max(filter.genre, 0));
+    const uint32_t max_plays = filter.max_play_count < 0 ? UINT32_MAX : static_cast<uint32_t>(filter.max_play_count);
+
+    const float* bpm = bpm_.data();
+    const uint8_t* key = key_.data();
+    const uint16_t* genres = genre_.data();
+    const uint32_t* plays = play_count_.data();
+    const uint8_t* live = live_.data();
+
+    std::vector<TrackIndex> result;
+    uint8_t match[kFilterBlock];
+    const size_t count = live_.size();
+    for (size_t base = 0; base < count; base += kFilterBlock) {
+        const size_t n = std::min(kFilterBlock, count - base);
+
+        // Branch-free predicate over the columns; the collect loop below is the only branch
+        for (size_t i = 0; i < n; ++i) {
+            const size_t j = base + i;
+            match[i] = static_cast<uint8_t>(
+                live[j] &
+                static_cast<uint32_t>(bpm[j] >= low) &
+                static_cast<uint32_t>(bpm[j] <= high) &
+                (keys >> key[j]) &
+                (any_genre | static_cast<uint32_t>(genres[j] == genre)) &
+                static_cast<uint32_t>(plays[j] <= max_plays) & 1u);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            if (match[i]) {
+                result.push_back(static_cast<TrackIndex>(base + i));
+                if (filter.limit > 0 && result.size() >= filter.limit) {
+                    return result;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+std::string_view TrackCatalog::store(std::string_view text) {
+    return arena_.store(text);
+}
+
+uint16_t TrackCatalog::intern_genre(std::string_view genre) {
+    if (genres_.empty()) {
+        genres_.emplace_back();
+        genre_index_.emplace(genres_[0], 0);
+    }
+    const std::string name = lower(trim(genre));
+    auto it = genre_index_.find(name);
+    if (it != genre_index_.end()) {
+        return it->second;
+    }
+    if (genres_.size() > UINT16_MAX) {
+        return 0;       // Out of ids; the track files under no genre
+    }
+    const uint16_t id = static_cast<uint16_t>(genres_.size());
+    genres_.push_back(store(name));
+    genre_index_.emplace(genres_.back(), id);
+    return id;
+}
+
+void TrackCatalog::compact() {
+    StringArena arena;
+    for (size_t i = 0; i < live_.size(); ++i) {
+        if (live_[i]) {
+            ids_[i] = arena.store(ids_[i]);
+            titles_[i] = arena.store(titles_[i]);
+            artists_[i] = arena.store(artists_[i]);
+        }
+    }
+    for (auto& genre : genres_) {
+        genre = arena.store(genre);
+    }
+
+    // Both maps are keyed by views into the old arena
+    index_.clear();
+    for (size_t i = 0; i < live_.size(); ++i) {
+        if (live_[i]) {
+            index_.emplace(ids_[i], static_cast<TrackIndex>(i));
+        }
+    }
+    genre_index_.clear();
+    for (size_t i = 0; i < genres_.size(); ++i) {
+        genre_index_.emplace(genres_[i], static_cast<uint16_t>(i));
+    }
+
+    arena_ = std::move(arena);
+    dead_bytes_ = 0;
+}
+
+} // namespace OneStopRadio
@@ -22,6 +22,7 @@ public:
         default_format.height = 1080;
         default_format.fps = 30;
         default_format.bitrate = 2500000;
+        default_format.encoder = "auto";
         
         if (!video_manager_->initialize(default_format)) {
             Logger::error("VideoApiServer", "Failed to initialize video manager");
@@ -136,6 +137,34 @@ private:
         response["slideshow"] = {
             {"active", video_manager_->get_composer().is_slideshow_active()}
         };
+        const VideoEncoderStats encoder = video_manager_->get_encoder_stats();
+        response["encoder"] = {
+            {"backend", video_encoder_backend_name(encoder.backend)},
+            {"hardware", encoder.hardware},
+            {"frames", static_cast<Json::UInt64>(encoder.frames)},
+            {"last_encode_ms", encoder.last_encode_ms},
+            {"avg_encode_ms", encoder.avg_encode_ms},
+            {"max_encode_ms", encoder.max_encode_ms}
+        };
+        
+        const VideoPipelineStats pipeline = video_manager_->get_pipeline_stats();
+        const auto stage_json = [](const VideoStageStats& stage) {
+            return json{
+                {"frames", static_cast<Json::UInt64>(stage.frames)},
+                {"dropped", static_cast<Json::UInt64>(stage.dropped)},
+                {"avg_ms", stage.avg_ms},
+                {"max_ms", stage.max_ms}
+            };
+        };
+        response["pipeline"] = {
+            {"compose", stage_json(pipeline.compose)},
+            {"convert", stage_json(pipeline.convert)},
+            {"encode", stage_json(pipeline.encode)},
+            {"send", stage_json(pipeline.send)},
+            {"deadline_misses", static_cast<Json::UInt64>(pipeline.deadline_misses)},
+            {"repeated_frames", static_cast<Json::UInt64>(pipeline.repeated_frames)},
+            {"latency_ms", pipeline.latency_ms}
+        };
         
         Logger::info("VideoApiServer", "Video status requested");
         return response.dump();
@@ -492,7 +521,10 @@ private:
                 {"frames_sent", stats.frames_sent},
                 {"current_bitrate", stats.current_bitrate},
                 {"is_connected", stats.is_connected},
-                {"last_error", stats.last_error}
+                {"last_error", stats.last_error},
+                {"packets_dropped", stats.packets_dropped},
+                {"queue_ms", stats.queue_ms},
+                {"reconnects", stats.reconnects}
             };
         }
         response["stream_stats"] = stream_stats;
@@ -4,7 +4,13 @@
 #include <thread>
 #include <chrono>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include "utils/spsc_queue.hpp"
+#include "pixel_kernels.hpp"
+#include "trace_profiler.hpp"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -12,72 +18,114 @@ extern "C" {
 #include <libavutil/imgutils.h>
 #include <libswscale/swscale.h>
 #include <libavutil/opt.h>
+#include <libavutil/hwcontext.h>
 }
 
+const char* video_encoder_backend_name(VideoEncoderBackend backend) {
+    switch (backend) {
+        case VideoEncoderBackend::SOFTWARE: return "software";
+        case VideoEncoderBackend::VAAPI: return "vaapi";
+        case VideoEncoderBackend::NVENC: return "nvenc";
+        case VideoEncoderBackend::QSV: return "qsv";
+        case VideoEncoderBackend::VIDEOTOOLBOX: return "videotoolbox";
+    }
+    return "unknown";
+}
+
+std::string video_profile_key(const VideoFormat& format) {
+    return std::to_string(format.width) + "x" + std::to_string(format.height) + "/" +
+           std::to_string(format.bitrate) + "/" + format.codec + "/" + format.encoder + "/" + format.hw_device;
+}
+
+namespace {
+
+struct HardwareEncoder {
+    VideoEncoderBackend backend;
+    const char* codec_name;
+    AVHWDeviceType device_type;
+    AVPixelFormat hw_format;
+};
+
+// Tried in this order by "auto"; libx264 is always the last resort
+const HardwareEncoder kHardwareEncoders[] = {
+    {VideoEncoderBackend::NVENC, "h264_nvenc", AV_HWDEVICE_TYPE_CUDA, AV_PIX_FMT_CUDA},
+    {VideoEncoderBackend::QSV, "h264_qsv", AV_HWDEVICE_TYPE_QSV, AV_PIX_FMT_QSV},
+    {VideoEncoderBackend::VAAPI, "h264_vaapi", AV_HWDEVICE_TYPE_VAAPI, AV_PIX_FMT_VAAPI},
+    {VideoEncoderBackend::VIDEOTOOLBOX, "h264_videotoolbox", AV_HWDEVICE_TYPE_VIDEOTOOLBOX, AV_PIX_FMT_VIDEOTOOLBOX},
+};
+
+} // namespace
+
 // VideoEncoder Implementation
 class VideoEncoder::Impl {
 public:
-    Impl() : codec_context_(nullptr), frame_(nullptr), packet_(nullptr), initialized_(false) {}
+    Impl() : codec_context_(nullptr), sws_context_(nullptr), packet_(nullptr), initialized_(false) {}
     
     ~Impl() {
         cleanup();
     }
     
-    bool initialize(const VideoFormat& format) {
+    bool initialize(const VideoFormat& format, int source_width, int source_height) {
         format_ = format;
+        source_width_ = source_width > 0 ? source_width : format.width;
+        source_height_ = source_height > 0 ? source_height : format.height;
         
-        // Find H.264 encoder
-        const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_H264);
-        if (!codec) {
-            Logger::error("VideoEncoder", "H.264 encoder not found");
-            return false;
-        }
-        
-        // Allocate codec context
-        codec_context_ = avcodec_alloc_context3(codec);
-        if (!codec_context_) {
-            Logger::error("VideoEncoder", "Failed to allocate codec context");
-            return false;
+        // Requested hardware backends first, then libx264
+        bool opened = false;
+        for (const HardwareEncoder& hardware : kHardwareEncoders) {
+            if (format.encoder != "auto" && format.encoder != video_encoder_backend_name(hardware.backend)) {
+                continue;
+            }
+            if (open_hardware_codec(hardware)) {
+                opened = true;
+                break;
+            }
+            cleanup();
         }
-        
-        // Set codec parameters
-        codec_context_->bit_rate = format.bitrate;
-        codec_context_->width = format.width;
-        codec_context_->height = format.height;
-        codec_context_->time_base = {1, format.fps};
-        codec_context_->framerate = {format.fps, 1};
-        codec_context_->gop_size = format.fps; // I-frame every second
-        codec_context_->max_b_frames = 1;
-        codec_context_->pix_fmt = AV_PIX_FMT_YUV420P;
-        
-        // Set H.264 specific options for streaming
-        av_opt_set(codec_context_->priv_data, "preset", "fast", 0);
-        av_opt_set(codec_context_->priv_data, "tune", "zerolatency", 0);
-        av_opt_set(codec_context_->priv_data, "profile", "baseline", 0);
-        
-        // Open codec
-        if (avcodec_open2(codec_context_, codec, nullptr) < 0) {
-            Logger::error("VideoEncoder", "Failed to open codec");
+        if (!opened && !open_software_codec()) {
             cleanup();
             return false;
         }
         
-        // Allocate frame
-        frame_ = av_frame_alloc();
-        if (!frame_) {
-            Logger::error("VideoEncoder", "Failed to allocate frame");
+        // Composed frames are RGB24 at the composer's size; profiles for other
+        // platforms are scaled in the same pass as the pixel format conversion
+        sws_context_ = sws_getCachedContext(nullptr,
+                                            source_width_, source_height_, AV_PIX_FMT_RGB24,
+                                            format.width, format.height, sw_format_,
+                                            SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!sws_context_) {
+            Logger::error("VideoEncoder", "Failed to create RGB to YUV converter");
             cleanup();
             return false;
         }
         
-        frame_->format = codec_context_->pix_fmt;
-        frame_->width = codec_context_->width;
-        frame_->height = codec_context_->height;
+        for (size_t i = 0; i < kFramePoolSize; ++i) {
+            AVFrame* frame = av_frame_alloc();
+            if (!frame) {
+                Logger::error("VideoEncoder", "Failed to allocate frame");
+                cleanup();
+                return false;
+            }
+            frame_pool_.push_back(frame);
+            
+            frame->format = sw_format_;
+            frame->width = codec_context_->width;
+            frame->height = codec_context_->height;
+            
+            if (av_frame_get_buffer(frame, 0) < 0) {
+                Logger::error("VideoEncoder", "Failed to allocate frame buffer");
+                cleanup();
+                return false;
+            }
+        }
         
-        if (av_frame_get_buffer(frame_, 0) < 0) {
-            Logger::error("VideoEncoder", "Failed to allocate frame buffer");
-            cleanup();
-            return false;
+        if (hw_frames_) {
+            hw_frame_ = av_frame_alloc();
+            if (!hw_frame_) {
+                Logger::error("VideoEncoder", "Failed to allocate hardware frame");
+                cleanup();
+                return false;
+            }
         }
         
         // Allocate packet
@@ -88,25 +136,77 @@ public:
             return false;
         }
         
+        running_stats_ = VideoEncoderStats{};
+        running_stats_.backend = backend_;
+        running_stats_.hardware = backend_ != VideoEncoderBackend::SOFTWARE;
+        stats_.store(running_stats_);
+        
         initialized_ = true;
-        Logger::info("VideoEncoder", "Initialized successfully");
+        Logger::info("VideoEncoder", std::string("Initialized successfully with ") + video_encoder_backend_name(backend_) +
+                     " backend");
         return true;
     }
     
-    bool encode_frame(const uint8_t* frame_data, std::vector<uint8_t>& encoded_data) {
+    AVFrame* convert_frame(const uint8_t* frame_data, int64_t pts) {
         if (!initialized_) {
+            return nullptr;
+        }
+        
+        AVFrame* frame = acquire_frame();
+        if (!frame) {
+            Logger::error("VideoEncoder", "No writable frame available");
+            return nullptr;
+        }
+        
+        // RGB24 -> YUV420P, or NV12 for upload to a hardware encoder
+        const uint8_t* source[1] = {frame_data};
+        const int source_stride[1] = {source_width_ * 3};
+        sws_scale(sws_context_, source, source_stride, 0, source_height_, frame->data, frame->linesize);
+        frame->pts = map_pts(pts);
+        
+        return av_frame_clone(frame);
+    }
+    
+    AVFrame* repeat_frame(const AVFrame* converted, int64_t pts) {
+        if (!initialized_ || !converted) {
+            return nullptr;
+        }
+        
+        AVFrame* frame = av_frame_clone(converted);
+        if (frame) {
+            frame->pts = map_pts(pts);
+        }
+        return frame;
+    }
+    
+    bool encode_converted(AVFrame* frame, const VideoEncoder::PacketCallback& on_packet) {
+        if (!initialized_ || !frame) {
+            av_frame_free(&frame);
             return false;
         }
         
-        // Copy frame data (assuming RGB24 input)
-        // In a real implementation, you'd convert RGB to YUV420P here
-        memcpy(frame_->data[0], frame_data, 
-               format_.width * format_.height * 3 / 2); // YUV420P size
+        const auto begin = std::chrono::steady_clock::now();
         
-        frame_->pts = frame_count_++;
+        AVFrame* input = frame;
+        if (hw_frame_) {
+            // Upload into a surface from the encoder's own pool
+            if (av_hwframe_get_buffer(hw_frames_, hw_frame_, 0) < 0 ||
+                av_hwframe_transfer_data(hw_frame_, frame, 0) < 0) {
+                av_frame_unref(hw_frame_);
+                av_frame_free(&frame);
+                Logger::error("VideoEncoder", "Failed to upload frame to the GPU");
+                return false;
+            }
+            hw_frame_->pts = frame->pts;
+            input = hw_frame_;
+        }
         
-        // Encode frame
-        int ret = avcodec_send_frame(codec_context_, frame_);
+        // Encode frame; the encoder takes its own reference to the surface
+        int ret = avcodec_send_frame(codec_context_, input);
+        if (hw_frame_) {
+            av_frame_unref(hw_frame_);
+        }
+        av_frame_free(&frame);
         if (ret < 0) {
             Logger::error("VideoEncoder", "Error sending frame to encoder");
             return false;
@@ -122,57 +222,290 @@ public:
                 break;
             }
             
-            // Copy encoded data
-            encoded_data.insert(encoded_data.end(), 
-                              packet_->data, 
-                              packet_->data + packet_->size);
+            if (on_packet) {
+                on_packet(packet_);
+            }
             
             av_packet_unref(packet_);
         }
         
+        record_timing(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
         return true;
     }
     
+    bool encode_frame(const uint8_t* frame_data, const VideoEncoder::PacketCallback& on_packet) {
+        AVFrame* frame = convert_frame(frame_data, last_pts_ + 1);
+        return frame && encode_converted(frame, on_packet);
+    }
+    
+    VideoEncoderStats get_stats() const {
+        return stats_.load();
+    }
+    
+    bool get_codec_parameters(AVCodecParameters* params) const {
+        return initialized_ && params && avcodec_parameters_from_context(params, codec_context_) >= 0;
+    }
+    
+    AVRational get_time_base() const {
+        return codec_context_ ? codec_context_->time_base : AVRational{1, format_.fps};
+    }
+    
     void cleanup() {
         if (packet_) {
             av_packet_free(&packet_);
         }
         
-        if (frame_) {
-            av_frame_free(&frame_);
+        for (AVFrame*& frame : frame_pool_) {
+            av_frame_free(&frame);
+        }
+        frame_pool_.clear();
+        next_frame_ = 0;
+        pts_offset_ = 0;
+        last_pts_ = -1;
+        
+        if (hw_frame_) {
+            av_frame_free(&hw_frame_);
+        }
+        
+        if (sws_context_) {
+            sws_freeContext(sws_context_);
+            sws_context_ = nullptr;
         }
         
         if (codec_context_) {
             avcodec_free_context(&codec_context_);
         }
         
+        av_buffer_unref(&hw_frames_);
+        av_buffer_unref(&hw_device_);
+        backend_ = VideoEncoderBackend::SOFTWARE;
+        sw_format_ = AV_PIX_FMT_YUV420P;
+        
         initialized_ = false;
     }
 
 private:
+    // Frames queued between conversion and encoding, or still referenced by
+    // the encoder, while the next one is filled
+    static constexpr size_t kFramePoolSize = 6;
+    
+    // Settings every backend shares
+    bool allocate_context(const AVCodec* codec) {
+        codec_context_ = avcodec_alloc_context3(codec);
+        if (!codec_context_) {
+            Logger::error("VideoEncoder", "Failed to allocate codec context");
+            return false;
+        }
+        
+        codec_context_->bit_rate = format_.bitrate;
+        codec_context_->width = format_.width;
+        codec_context_->height = format_.height;
+        codec_context_->time_base = {1, format_.fps};
+        codec_context_->framerate = {format_.fps, 1};
+        codec_context_->gop_size = format_.fps; // I-frame every second
+        codec_context_->max_b_frames = 1;
+        // SPS/PPS go in extradata, where FLV and every other muxer expect them
+        codec_context_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        return true;
+    }
+    
+    bool open_software_codec() {
+        // Find H.264 encoder
+        const AVCodec* codec = avcodec_find_encoder_by_name("libx264");
+        if (!codec) {
+            codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+        }
+        if (!codec) {
+            Logger::error("VideoEncoder", "H.264 encoder not found");
+            return false;
+        }
+        
+        if (!allocate_context(codec)) {
+            return false;
+        }
+        codec_context_->pix_fmt = AV_PIX_FMT_YUV420P;
+        
+        // Set H.264 specific options for streaming
+        av_opt_set(codec_context_->priv_data, "preset", "fast", 0);
+        av_opt_set(codec_context_->priv_data, "tune", "zerolatency", 0);
+        av_opt_set(codec_context_->priv_data, "profile", "baseline", 0);
+        
+        // Open codec
+        if (avcodec_open2(codec_context_, codec, nullptr) < 0) {
+            Logger::error("VideoEncoder", "Failed to open codec");
+            return false;
+        }
+        
+        backend_ = VideoEncoderBackend::SOFTWARE;
+        sw_format_ = AV_PIX_FMT_YUV420P;
+        return true;
+    }
+    
+    bool open_hardware_codec(const HardwareEncoder& hardware) {
+        const char* name = video_encoder_backend_name(hardware.backend);
+        const AVCodec* codec = avcodec_find_encoder_by_name(hardware.codec_name);
+        if (!codec) {
+            Logger::info("VideoEncoder", std::string(name) + ": encoder not built into FFmpeg");
+            return false;
+        }
+        
+        const char* device = format_.hw_device.empty() ? nullptr : format_.hw_device.c_str();
+        if (av_hwdevice_ctx_create(&hw_device_, hardware.device_type, device, nullptr, 0) < 0) {
+            Logger::info("VideoEncoder", std::string(name) + ": no usable device");
+            return false;
+        }
+        
+        // GPU surfaces the composed frames are uploaded into, as NV12
+        hw_frames_ = av_hwframe_ctx_alloc(hw_device_);
+        if (!hw_frames_) {
+            Logger::error("VideoEncoder", std::string(name) + ": failed to allocate frame pool");
+            return false;
+        }
+        AVHWFramesContext* frames = reinterpret_cast<AVHWFramesContext*>(hw_frames_->data);
+        frames->format = hardware.hw_format;
+        frames->sw_format = AV_PIX_FMT_NV12;
+        frames->width = format_.width;
+        frames->height = format_.height;
+        frames->initial_pool_size = 16;
+        if (av_hwframe_ctx_init(hw_frames_) < 0) {
+            Logger::info("VideoEncoder", std::string(name) + ": failed to initialize frame pool");
+            return false;
+        }
+        
+        if (!allocate_context(codec)) {
+            return false;
+        }
+        codec_context_->pix_fmt = hardware.hw_format;
+        codec_context_->hw_frames_ctx = av_buffer_ref(hw_frames_);
+        if (!codec_context_->hw_frames_ctx) {
+            return false;
+        }
+        
+        // Low-latency presets; VAAPI has none
+        switch (hardware.backend) {
+            case VideoEncoderBackend::NVENC:
+                av_opt_set(codec_context_->priv_data, "preset", "p4", 0);
+                av_opt_set(codec_context_->priv_data, "tune", "ll", 0);
+                break;
+            case VideoEncoderBackend::QSV:
+                av_opt_set(codec_context_->priv_data, "preset", "veryfast", 0);
+                break;
+            case VideoEncoderBackend::VIDEOTOOLBOX:
+                av_opt_set_int(codec_context_->priv_data, "realtime", 1, 0);
+                break;
+            default:
+                break;
+        }
+        
+        if (avcodec_open2(codec_context_, codec, nullptr) < 0) {
+            Logger::info("VideoEncoder", std::string(name) + ": failed to open " + hardware.codec_name);
+            return false;
+        }
+        
+        backend_ = hardware.backend;
+        sw_format_ = AV_PIX_FMT_NV12;
+        return true;
+    }
+    
+    void record_timing(double elapsed_ms) {
+        VideoEncoderStats& stats = running_stats_;
+        stats.frames++;
+        stats.last_encode_ms = elapsed_ms;
+        stats.avg_encode_ms = stats.frames == 1 ? elapsed_ms : stats.avg_encode_ms + (elapsed_ms - stats.avg_encode_ms) * 0.05;
+        stats.max_encode_ms = std::max(stats.max_encode_ms, elapsed_ms);
+        stats_.store(stats);
+    }
+    
+    // A new session counts from 0 again; keep the codec's timestamps increasing
+    int64_t map_pts(int64_t pts) {
+        if (pts + pts_offset_ <= last_pts_) {
+            pts_offset_ = last_pts_ + 1 - pts;
+        }
+        last_pts_ = pts + pts_offset_;
+        return last_pts_;
+    }
+    
+    // Next pooled frame whose buffer the encoder no longer references; if the
+    // encoder holds them all, av_frame_make_writable gives one a fresh buffer
+    AVFrame* acquire_frame() {
+        for (size_t i = 0; i < frame_pool_.size(); ++i) {
+            AVFrame* frame = frame_pool_[(next_frame_ + i) % frame_pool_.size()];
+            if (av_frame_is_writable(frame)) {
+                next_frame_ = (next_frame_ + i + 1) % frame_pool_.size();
+                return frame;
+            }
+        }
+        AVFrame* frame = frame_pool_[next_frame_];
+        next_frame_ = (next_frame_ + 1) % frame_pool_.size();
+        return av_frame_make_writable(frame) >= 0 ? frame : nullptr;
+    }
+    
     AVCodecContext* codec_context_;
-    AVFrame* frame_;
+    VideoEncoderBackend backend_ = VideoEncoderBackend::SOFTWARE;
+    AVPixelFormat sw_format_ = AV_PIX_FMT_YUV420P;  // What sws_scale writes
+    AVBufferRef* hw_device_ = nullptr;
+    AVBufferRef* hw_frames_ = nullptr;
+    AVFrame* hw_frame_ = nullptr;                   // Upload target, only with hw_frames_
+    SwsContext* sws_context_;
+    std::vector<AVFrame*> frame_pool_;
+    size_t next_frame_ = 0;
     AVPacket* packet_;
     VideoFormat format_;
+    int source_width_ = 0;
+    int source_height_ = 0;
     bool initialized_;
-    int64_t frame_count_ = 0;
+    int64_t pts_offset_ = 0;
+    int64_t last_pts_ = -1;
+    
+    SeqLock<VideoEncoderStats> stats_;
+    VideoEncoderStats running_stats_;
 };
 
 VideoEncoder::VideoEncoder() : impl_(std::make_unique<Impl>()) {}
 VideoEncoder::~VideoEncoder() = default;
 
-bool VideoEncoder::initialize(const VideoFormat& format) {
-    return impl_->initialize(format);
+bool VideoEncoder::initialize(const VideoFormat& format, int source_width, int source_height) {
+    return impl_->initialize(format, source_width, source_height);
+}
+
+bool VideoEncoder::encode_frame(const uint8_t* frame_data, const PacketCallback& on_packet) {
+    return impl_->encode_frame(frame_data, on_packet);
+}
+
+AVFrame* VideoEncoder::convert_frame(const uint8_t* frame_data, int64_t pts) {
+    return impl_->convert_frame(frame_data, pts);
+}
+
+AVFrame* VideoEncoder::repeat_frame(const AVFrame* converted, int64_t pts) {
+    return impl_->repeat_frame(converted, pts);
+}
+
+bool VideoEncoder::encode_converted(AVFrame* frame, const PacketCallback& on_packet) {
+    return impl_->encode_converted(frame, on_packet);
 }
 
 bool VideoEncoder::encode_frame(const uint8_t* frame_data, std::vector<uint8_t>& encoded_data) {
-    return impl_->encode_frame(frame_data, encoded_data);
+    return impl_->encode_frame(frame_data, [&encoded_data](const AVPacket* packet) {
+        encoded_data.insert(encoded_data.end(), packet->data, packet->data + packet->size);
+    });
 }
 
 void VideoEncoder::reset() {
     impl_->cleanup();
 }
 
+VideoEncoderStats VideoEncoder::get_stats() const {
+    return impl_->get_stats();
+}
+
+bool VideoEncoder::get_codec_parameters(AVCodecParameters* params) const {
+    return impl_->get_codec_parameters(params);
+}
+
+AVRational VideoEncoder::get_time_base() const {
+    return impl_->get_time_base();
+}
+
 // VideoComposer Implementation
 class VideoComposer::Impl {
 public:
@@ -180,14 +513,18 @@ public:
              slideshow_active_(false), current_slide_index_(0) {}
     
     bool initialize(const VideoFormat& format) {
+        std::lock_guard<std::mutex> lock(mutex_);
         format_ = format;
         
-        // Allocate frame buffer
-        frame_size_ = format.width * format.height * 3; // RGB24
-        frame_buffer_.resize(frame_size_);
+        // Background layer, black by default
+        frame_size_ = static_cast<size_t>(format.width) * format.height * 3; // RGB24
+        background_.assign(frame_size_, 0);
+        background_black_ = true;
         
-        // Create black frame as default
-        std::fill(frame_buffer_.begin(), frame_buffer_.end(), 0);
+        frames_.clear();
+        current_frame_ = kNoFrame;
+        mark_dirty(full_frame());
+        rasterize_overlay();
         
         Logger::info("VideoComposer", "Initialized with resolution " + 
                     std::to_string(format.width) + "x" + std::to_string(format.height));
@@ -337,40 +674,58 @@ public:
         load_current_slide();
     }
     
-    bool get_current_frame(uint8_t* frame_buffer, size_t buffer_size) {
+    VideoFramePtr acquire_frame() {
         std::lock_guard<std::mutex> lock(mutex_);
         
-        if (buffer_size < frame_size_) {
-            return false;
+        if (frame_size_ == 0) {
+            return nullptr;
         }
         
-        // Generate frame based on current source
-        switch (current_source_) {
-            case VideoSource::CAMERA:
-                if (camera_enabled_) {
-                    generate_camera_frame();
-                } else {
-                    generate_black_frame();
-                }
-                break;
-                
-            case VideoSource::IMAGE:
-            case VideoSource::SLIDESHOW:
-                // Current frame already prepared
-                break;
-                
-            case VideoSource::OFF:
-            default:
-                generate_black_frame();
-                break;
+        // Images and slides are already in the background layer
+        const bool live_camera = current_source_ == VideoSource::CAMERA && camera_enabled_;
+        if (!live_camera && current_source_ != VideoSource::IMAGE && current_source_ != VideoSource::SLIDESHOW) {
+            generate_black_frame();
         }
         
-        // Apply text overlay if present
-        if (!overlay_text_.empty()) {
-            apply_text_overlay();
+        // A camera frame is new every time, and the one after it needs a full redraw
+        const bool redraw = live_camera || camera_in_frame_;
+        if (!redraw && dirty_.empty() && current_frame_ != kNoFrame) {
+            return frames_[current_frame_];
         }
         
-        memcpy(frame_buffer, frame_buffer_.data(), frame_size_);
+        // Patch the current frame in place when nobody else holds it,
+        // otherwise composite a whole frame into a free one
+        Rect region = dirty_;
+        if (redraw || current_frame_ == kNoFrame || !is_free(frames_[current_frame_])) {
+            const size_t index = free_frame();
+            if (index == kNoFrame) {
+                return nullptr;     // Every frame is still referenced downstream
+            }
+            current_frame_ = index;
+            region = full_frame();
+        }
+        
+        const std::shared_ptr<VideoFrame>& frame = frames_[current_frame_];
+        if (live_camera) {
+            generate_camera_frame(frame->rgb.data());
+        } else {
+            copy_background(frame->rgb.data(), region);
+        }
+        blend_overlay(frame->rgb.data(), region);
+        
+        frame->generation = ++generation_;
+        dirty_ = Rect{};
+        camera_in_frame_ = live_camera;
+        return frame;
+    }
+    
+    bool get_current_frame(uint8_t* frame_buffer, size_t buffer_size) {
+        VideoFramePtr frame = acquire_frame();
+        if (!frame || buffer_size < frame->rgb.size()) {
+            return false;
+        }
+        
+        memcpy(frame_buffer, frame->rgb.data(), frame->rgb.size());
         return true;
     }
     
@@ -383,6 +738,7 @@ public:
         overlay_y_ = y;
         overlay_font_ = font;
         overlay_font_size_ = font_size;
+        rasterize_overlay();
         
         Logger::info("VideoComposer", "Text overlay added: " + text);
         return true;
@@ -392,24 +748,133 @@ public:
         std::lock_guard<std::mutex> lock(mutex_);
         
         overlay_text_.clear();
+        rasterize_overlay();
         Logger::info("VideoComposer", "Text overlay removed");
         return true;
     }
 
 private:
+    struct Rect {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+        
+        bool empty() const { return width <= 0 || height <= 0; }
+    };
+    
+    // Text rasterized once per change, at its clipped position
+    struct OverlayLayer {
+        Rect bounds;
+        std::vector<uint8_t> rgba;      // Straight alpha, bounds.width x bounds.height
+    };
+    
+    static constexpr size_t kFramePoolSize = 8;
+    static constexpr size_t kNoFrame = static_cast<size_t>(-1);
+    
+    static Rect intersect(const Rect& a, const Rect& b) {
+        const int x0 = std::max(a.x, b.x);
+        const int y0 = std::max(a.y, b.y);
+        const int x1 = std::min(a.x + a.width, b.x + b.width);
+        const int y1 = std::min(a.y + a.height, b.y + b.height);
+        return Rect{x0, y0, x1 - x0, y1 - y0};
+    }
+    
+    static Rect unite(const Rect& a, const Rect& b) {
+        const int x0 = std::min(a.x, b.x);
+        const int y0 = std::min(a.y, b.y);
+        const int x1 = std::max(a.x + a.width, b.x + b.width);
+        const int y1 = std::max(a.y + a.height, b.y + b.height);
+        return Rect{x0, y0, x1 - x0, y1 - y0};
+    }
+    
+    Rect full_frame() const {
+        return Rect{0, 0, format_.width, format_.height};
+    }
+    
+    void mark_dirty(const Rect& rect) {
+        if (!rect.empty()) {
+            dirty_ = dirty_.empty() ? rect : unite(dirty_, rect);
+        }
+    }
+    
+    // Only the pool still references it. The acquire fence pairs with the
+    // release in the last holder's reference drop, so its reads are done.
+    static bool is_free(const std::shared_ptr<VideoFrame>& frame) {
+        if (frame.use_count() != 1) {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+    
+    size_t free_frame() {
+        for (size_t i = 0; i < frames_.size(); ++i) {
+            if (is_free(frames_[i])) {
+                return i;
+            }
+        }
+        if (frames_.size() >= kFramePoolSize) {
+            return kNoFrame;
+        }
+        
+        auto frame = std::make_shared<VideoFrame>();
+        frame->rgb.resize(frame_size_);
+        frame->width = format_.width;
+        frame->height = format_.height;
+        frames_.push_back(std::move(frame));
+        return frames_.size() - 1;
+    }
+    
+    void copy_background(uint8_t* dst, const Rect& region) {
+        const Rect area = intersect(region, full_frame());
+        if (area.empty()) {
+            return;
+        }
+        if (area.width == format_.width) {
+            const size_t offset = static_cast<size_t>(area.y) * format_.width * 3;
+            memcpy(dst + offset, background_.data() + offset, static_cast<size_t>(area.height) * format_.width * 3);
+            return;
+        }
+        for (int y = area.y; y < area.y + area.height; ++y) {
+            const size_t offset = (static_cast<size_t>(y) * format_.width + area.x) * 3;
+            memcpy(dst + offset, background_.data() + offset, static_cast<size_t>(area.width) * 3);
+        }
+    }
+    
+    void blend_overlay(uint8_t* dst, const Rect& region) {
+        const Rect area = intersect(region, overlay_.bounds);
+        if (area.empty()) {
+            return;
+        }
+        for (int y = area.y; y < area.y + area.height; ++y) {
+            uint8_t* row = dst + (static_cast<size_t>(y) * format_.width + area.x) * 3;
+            const uint8_t* src = overlay_.rgba.data() +
+                (static_cast<size_t>(y - overlay_.bounds.y) * overlay_.bounds.width + (area.x - overlay_.bounds.x)) * 4;
+            dsp::blend_rgba_over_rgb(row, src, static_cast<size_t>(area.width));
+        }
+    }
+    
     void generate_black_frame() {
-        std::fill(frame_buffer_.begin(), frame_buffer_.end(), 0);
+        if (background_black_) {
+            return;
+        }
+        std::fill(background_.begin(), background_.end(), 0);
+        background_black_ = true;
+        mark_dirty(full_frame());
     }
     
     void generate_colored_frame(uint8_t r, uint8_t g, uint8_t b) {
         for (size_t i = 0; i < frame_size_; i += 3) {
-            frame_buffer_[i] = r;     // Red
-            frame_buffer_[i + 1] = g; // Green  
-            frame_buffer_[i + 2] = b; // Blue
+            background_[i] = r;     // Red
+            background_[i + 1] = g; // Green  
+            background_[i + 2] = b; // Blue
         }
+        background_black_ = false;
+        mark_dirty(full_frame());
     }
     
-    void generate_camera_frame() {
+    void generate_camera_frame(uint8_t* frame_buffer) {
         // Mock camera frame with moving gradient
         static int frame_counter = 0;
         frame_counter++;
@@ -423,9 +888,9 @@ private:
                 uint8_t g = (y + frame_counter) % 256;
                 uint8_t b = ((x + y + frame_counter) / 2) % 256;
                 
-                frame_buffer_[index] = r;
-                frame_buffer_[index + 1] = g;
-                frame_buffer_[index + 2] = b;
+                frame_buffer[index] = r;
+                frame_buffer[index + 1] = g;
+                frame_buffer[index + 2] = b;
             }
         }
     }
@@ -441,36 +906,47 @@ private:
             
             generate_colored_frame(r, g, b);
             
-            Logger::debug("VideoComposer", "Loaded slide " + std::to_string(current_slide_index_) + 
-                         ": " + image_path);
+            LOG_DEBUG("VideoComposer", "Loaded slide " + std::to_string(current_slide_index_) + 
+                     ": " + image_path);
         }
     }
     
-    void apply_text_overlay() {
-        // Mock text overlay - in real implementation, use FFmpeg's text filter
-        // For now, just draw a simple white rectangle where text would be
-        int text_width = overlay_text_.length() * (overlay_font_size_ / 2);
-        int text_height = overlay_font_size_;
+    void rasterize_overlay() {
+        // Mock text overlay - in real implementation, render glyphs with FreeType
+        // For now, just a simple white rectangle where text would be
+        const Rect previous = overlay_.bounds;
+        overlay_ = OverlayLayer{};
         
-        for (int y = overlay_y_; y < overlay_y_ + text_height && y < format_.height; ++y) {
-            for (int x = overlay_x_; x < overlay_x_ + text_width && x < format_.width; ++x) {
-                size_t index = (y * format_.width + x) * 3;
-                if (index + 2 < frame_size_) {
-                    frame_buffer_[index] = 255;     // White text background
-                    frame_buffer_[index + 1] = 255;
-                    frame_buffer_[index + 2] = 255;
-                }
+        if (!overlay_text_.empty()) {
+            const Rect text{overlay_x_, overlay_y_,
+                            static_cast<int>(overlay_text_.length()) * (overlay_font_size_ / 2), overlay_font_size_};
+            const Rect bounds = intersect(text, full_frame());
+            if (!bounds.empty()) {
+                overlay_.bounds = bounds;
+                overlay_.rgba.assign(static_cast<size_t>(bounds.width) * bounds.height * 4, 255); // Opaque white
             }
         }
+        
+        mark_dirty(previous);
+        mark_dirty(overlay_.bounds);
     }
     
     VideoFormat format_;
     VideoSource current_source_;
     bool camera_enabled_;
     
-    // Frame buffer
-    std::vector<uint8_t> frame_buffer_;
-    size_t frame_size_;
+    // Layers
+    std::vector<uint8_t> background_;   // RGB24, the image, slide or black
+    bool background_black_ = true;
+    OverlayLayer overlay_;
+    size_t frame_size_ = 0;
+    
+    // Composited frames
+    std::vector<std::shared_ptr<VideoFrame>> frames_;
+    size_t current_frame_ = kNoFrame;
+    uint64_t generation_ = 0;
+    Rect dirty_;                        // Changed since current_frame_ was composited
+    bool camera_in_frame_ = false;
     
     // Static image
     std::string current_image_path_;
@@ -542,6 +1018,10 @@ void VideoComposer::previous_slide() {
     impl_->previous_slide();
 }
 
+VideoFramePtr VideoComposer::acquire_frame() {
+    return impl_->acquire_frame();
+}
+
 bool VideoComposer::get_current_frame(uint8_t* frame_buffer, size_t buffer_size) {
     return impl_->get_current_frame(frame_buffer, buffer_size);
 }
@@ -555,6 +1035,349 @@ bool VideoComposer::remove_text_overlay() {
     return impl_->remove_text_overlay();
 }
 
+// VideoStreamManager pipeline
+namespace {
+
+constexpr size_t kPipelineDepth = 3;        // Composed frames in flight
+constexpr size_t kMaxLiveProfiles = 8;
+constexpr size_t kPacketQueueSize = 256;
+constexpr auto kStageWait = std::chrono::milliseconds(10);
+constexpr auto kPacketBackoff = std::chrono::microseconds(500);
+
+using PipelineClock = std::chrono::steady_clock;
+
+// Wakes a stage when its input queue gets an item. The queues themselves
+// stay lock-free; the mutex only orders the notify against the wait.
+class StageSignal {
+public:
+    void notify() {
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        cv_.notify_one();
+    }
+    
+    template <typename Ready>
+    void wait(Ready ready) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, kStageWait, ready);
+    }
+    
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+// Counters for one stage, written only by that stage's thread
+class StageMeter {
+public:
+    void record(PipelineClock::time_point begin) {
+        const double ms = std::chrono::duration<double, std::milli>(PipelineClock::now() - begin).count();
+        stats_.frames++;
+        stats_.avg_ms = stats_.frames == 1 ? ms : stats_.avg_ms + (ms - stats_.avg_ms) * 0.05;
+        stats_.max_ms = std::max(stats_.max_ms, ms);
+        published_.store(stats_);
+    }
+    
+    void drop() {
+        stats_.dropped++;
+        published_.store(stats_);
+    }
+    
+    VideoStageStats load() const { return published_.load(); }
+    
+private:
+    VideoStageStats stats_;
+    SeqLock<VideoStageStats> published_;
+};
+
+} // namespace
+
+/**
+ * One thread per stage, joined by bounded SPSC queues, so composing frame
+ * n+1 overlaps converting and encoding frame n. Composition is paced on
+ * absolute deadlines from the stream start; a late frame shortens the next
+ * wait instead of pushing every later frame back, and slots missed entirely
+ * are skipped, leaving a gap in the timestamps rather than a drift.
+ *
+ * Composed frames are shared references to the composer's buffers. When a
+ * frame's generation matches the last one converted, every profile gets
+ * another reference to its previous YUV frame at the new timestamp instead
+ * of a fresh conversion. Ingest servers expect a constant frame rate, so
+ * unchanged pictures are still encoded; the codec spends almost nothing on
+ * them.
+ *
+ * A stage whose output queue is full drops the frame rather than waiting,
+ * so a slow encoder costs frames, never pacing. Encoded packets are the
+ * exception: dropping one would corrupt the GOP, so the encode stage waits
+ * for the send queue instead.
+ */
+struct VideoStreamManager::Pipeline {
+    struct ComposedFrame {
+        VideoFramePtr frame;
+        int64_t pts = 0;
+        PipelineClock::time_point composed_at;
+    };
+    
+    struct ConvertedFrame {
+        std::array<AVFrame*, kMaxLiveProfiles> frames{};    // By profile
+        PipelineClock::time_point composed_at;
+    };
+    
+    struct QueuedPacket {
+        size_t profile = 0;
+        AVPacket* packet = nullptr;
+        PipelineClock::time_point composed_at;
+    };
+    
+    Pipeline(VideoComposer& composer, SocialMediaStreamer& streamer,
+             const std::vector<std::pair<std::string, VideoEncoder*>>& profiles, const VideoFormat& format)
+        : composer_(composer), streamer_(streamer), profiles_(profiles), format_(format),
+          composed_(kPipelineDepth), converted_(kPipelineDepth),
+          packets_(kPacketQueueSize) {
+        if (profiles_.size() > kMaxLiveProfiles) {
+            Logger::warn("VideoStreamManager", "Only the first " + std::to_string(kMaxLiveProfiles) +
+                         " video profiles are encoded");
+            profiles_.resize(kMaxLiveProfiles);
+        }
+        
+        // Built once; per-frame state reaches them through encoding_composed_at_
+        for (size_t i = 0; i < profiles_.size(); ++i) {
+            packet_callbacks_.emplace_back([this, i](const AVPacket* packet) { queue_packet(i, packet); });
+        }
+    }
+    
+    ~Pipeline() {
+        stop();
+    }
+    
+    void start() {
+        running_ = true;
+        compose_thread_ = std::thread(&Pipeline::compose_loop, this);
+        convert_thread_ = std::thread(&Pipeline::convert_loop, this);
+        encode_thread_ = std::thread(&Pipeline::encode_loop, this);
+        send_thread_ = std::thread(&Pipeline::send_loop, this);
+    }
+    
+    void stop() {
+        running_ = false;
+        convert_signal_.notify();
+        encode_signal_.notify();
+        send_signal_.notify();
+        for (std::thread* thread : {&compose_thread_, &convert_thread_, &encode_thread_, &send_thread_}) {
+            if (thread->joinable()) {
+                thread->join();
+            }
+        }
+        
+        // Every thread has exited, so this one may pop from all the queues
+        ComposedFrame composed;
+        while (composed_.try_pop(composed)) {
+        }
+        ConvertedFrame converted;
+        while (converted_.try_pop(converted)) {
+            for (AVFrame*& frame : converted.frames) {
+                av_frame_free(&frame);
+            }
+        }
+        QueuedPacket queued;
+        while (packets_.try_pop(queued)) {
+            av_packet_free(&queued.packet);
+        }
+        for (AVFrame*& frame : last_converted_) {
+            av_frame_free(&frame);
+        }
+    }
+    
+    VideoPipelineStats stats() const {
+        VideoPipelineStats stats;
+        stats.compose = compose_meter_.load();
+        stats.convert = convert_meter_.load();
+        stats.encode = encode_meter_.load();
+        stats.send = send_meter_.load();
+        stats.deadline_misses = deadline_misses_.load(std::memory_order_relaxed);
+        stats.repeated_frames = repeated_frames_.load(std::memory_order_relaxed);
+        stats.latency_ms = latency_ms_.load();
+        return stats;
+    }
+    
+private:
+    void compose_loop() {
+        const int64_t fps = std::max(format_.fps, 1);
+        const auto start = PipelineClock::now();
+        int64_t slot = 0;
+        
+        Logger::info("VideoStreamManager", "Video pipeline started");
+        TRACE_THREAD_NAME("video_compose");
+        
+        while (running_) {
+            // Slot n is due n / fps seconds after the start, exactly
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(slot * 1000000000LL / fps));
+            if (!running_) {
+                break;
+            }
+            
+            TRACE_SCOPE("video_compose");
+            const auto begin = PipelineClock::now();
+            VideoFramePtr frame = composer_.acquire_frame();
+            if (!frame || !composed_.try_push(ComposedFrame{std::move(frame), slot, begin})) {
+                compose_meter_.drop();      // Every frame is still downstream
+            } else {
+                convert_signal_.notify();
+                compose_meter_.record(begin);
+            }
+            
+            // Skip the slots that have already passed
+            const int64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                PipelineClock::now() - start).count();
+            const int64_t current = elapsed_ns * fps / 1000000000LL;
+            if (current > slot + 1) {
+                deadline_misses_.fetch_add(static_cast<uint64_t>(current - slot - 1), std::memory_order_relaxed);
+                slot = current;
+            } else {
+                ++slot;
+            }
+        }
+        
+        Logger::info("VideoStreamManager", "Video pipeline stopped");
+    }
+    
+    void convert_loop() {
+        TRACE_THREAD_NAME("video_convert");
+        while (running_) {
+            ComposedFrame composed;
+            if (!composed_.try_pop(composed)) {
+                convert_signal_.wait([this] { return !running_ || !composed_.empty(); });
+                continue;
+            }
+            
+            TRACE_SCOPE("video_convert");
+            const auto begin = PipelineClock::now();
+            ConvertedFrame converted;
+            converted.composed_at = composed.composed_at;
+            const bool repeated = composed.frame->generation == last_generation_;
+            for (size_t i = 0; i < profiles_.size(); ++i) {
+                VideoEncoder& encoder = *profiles_[i].second;
+                if (repeated && last_converted_[i]) {
+                    converted.frames[i] = encoder.repeat_frame(last_converted_[i], composed.pts);
+                    continue;
+                }
+                converted.frames[i] = encoder.convert_frame(composed.frame->rgb.data(), composed.pts);
+                av_frame_free(&last_converted_[i]);
+                last_converted_[i] = converted.frames[i] ? av_frame_clone(converted.frames[i]) : nullptr;
+            }
+            last_generation_ = composed.frame->generation;
+            if (repeated) {
+                repeated_frames_.fetch_add(1, std::memory_order_relaxed);
+            }
+            
+            // The converted frames hold their own copies; the RGB frame goes back to the composer
+            composed.frame.reset();
+            
+            if (!converted_.try_push(converted)) {
+                for (AVFrame*& frame : converted.frames) {
+                    av_frame_free(&frame);
+                }
+                convert_meter_.drop();
+                continue;
+            }
+            encode_signal_.notify();
+            convert_meter_.record(begin);
+        }
+    }
+    
+    void encode_loop() {
+        TRACE_THREAD_NAME("video_encode");
+        while (running_) {
+            ConvertedFrame converted;
+            if (!converted_.try_pop(converted)) {
+                encode_signal_.wait([this] { return !running_ || !converted_.empty(); });
+                continue;
+            }
+            
+            TRACE_SCOPE("video_encode");
+            const auto begin = PipelineClock::now();
+            encoding_composed_at_ = converted.composed_at;
+            for (size_t i = 0; i < profiles_.size(); ++i) {
+                if (converted.frames[i]) {
+                    profiles_[i].second->encode_converted(converted.frames[i], packet_callbacks_[i]);
+                }
+            }
+            encode_meter_.record(begin);
+        }
+    }
+    
+    // Encode thread, from inside encode_converted()
+    void queue_packet(size_t profile, const AVPacket* packet) {
+        QueuedPacket queued{profile, av_packet_clone(packet), encoding_composed_at_};
+        if (!queued.packet) {
+            encode_meter_.drop();
+            return;
+        }
+        while (!packets_.try_push(queued)) {
+            if (!running_) {
+                av_packet_free(&queued.packet);
+                return;
+            }
+            std::this_thread::sleep_for(kPacketBackoff);
+        }
+        send_signal_.notify();
+    }
+    
+    void send_loop() {
+        TRACE_THREAD_NAME("video_send");
+        double latency_ms = 0.0;
+        while (running_) {
+            QueuedPacket queued;
+            if (!packets_.try_pop(queued)) {
+                send_signal_.wait([this] { return !running_ || !packets_.empty(); });
+                continue;
+            }
+            
+            TRACE_SCOPE("video_send");
+            const auto begin = PipelineClock::now();
+            streamer_.send_video_packet(profiles_[queued.profile].first, queued.packet);
+            av_packet_free(&queued.packet);
+            send_meter_.record(begin);
+            
+            const double ms = std::chrono::duration<double, std::milli>(begin - queued.composed_at).count();
+            latency_ms = latency_ms == 0.0 ? ms : latency_ms + (ms - latency_ms) * 0.05;
+            latency_ms_.store(latency_ms);
+        }
+    }
+    
+    VideoComposer& composer_;
+    SocialMediaStreamer& streamer_;
+    std::vector<std::pair<std::string, VideoEncoder*>> profiles_;
+    const VideoFormat format_;
+    
+    SpscQueue<ComposedFrame> composed_;         // Compose -> convert
+    SpscQueue<ConvertedFrame> converted_;       // Convert -> encode
+    SpscQueue<QueuedPacket> packets_;           // Encode -> send
+    StageSignal convert_signal_;
+    StageSignal encode_signal_;
+    StageSignal send_signal_;
+    
+    // Convert thread only: the last picture converted, by profile
+    std::array<AVFrame*, kMaxLiveProfiles> last_converted_{};
+    uint64_t last_generation_ = 0;
+    
+    std::vector<VideoEncoder::PacketCallback> packet_callbacks_;
+    PipelineClock::time_point encoding_composed_at_;
+    
+    StageMeter compose_meter_;
+    StageMeter convert_meter_;
+    StageMeter encode_meter_;
+    StageMeter send_meter_;
+    std::atomic<uint64_t> deadline_misses_{0};
+    std::atomic<uint64_t> repeated_frames_{0};
+    SeqLock<double> latency_ms_;
+    
+    std::atomic<bool> running_{false};
+    std::thread compose_thread_;
+    std::thread convert_thread_;
+    std::thread encode_thread_;
+    std::thread send_thread_;
+};
+
 // VideoStreamManager Implementation
 VideoStreamManager::VideoStreamManager() 
     : initialized_(false), running_(false) {
@@ -627,17 +1450,59 @@ bool VideoStreamManager::start_live_stream(const std::vector<std::string>& platf
         return true;
     }
     
+    // One encoder per distinct profile; platforms sharing a profile share its packets
+    const std::string default_key = video_profile_key(current_format_);
+    live_profiles_.clear();
+    for (const auto& platform_id : platform_ids) {
+        SocialMediaConfig config;
+        if (!streamer_->get_platform_config(platform_id, config)) {
+            continue;   // Reported by start_multi_stream below
+        }
+        
+        VideoFormat profile = config.video_format;
+        profile.fps = current_format_.fps;
+        const std::string key = video_profile_key(profile);
+        if (std::any_of(live_profiles_.begin(), live_profiles_.end(),
+                        [&key](const auto& entry) { return entry.first == key; })) {
+            continue;
+        }
+        
+        VideoEncoder* encoder = encoder_.get();
+        if (key != default_key) {
+            auto created = std::make_unique<VideoEncoder>();
+            if (!created->initialize(profile, current_format_.width, current_format_.height)) {
+                Logger::error("VideoStreamManager", "Failed to initialize encoder for " + key);
+                continue;
+            }
+            encoder = created.get();
+            live_encoders_[key] = std::move(created);
+        }
+        streamer_->set_video_stream(key, *encoder);
+        live_profiles_.emplace_back(key, encoder);
+    }
+    
+    // Audio is encoded once by the audio system and shared with every platform
+    streamer_->set_audio_encoder(acquire_audio_ ? acquire_audio_() : nullptr);
+    
     // Start streaming on specified platforms
     if (!streamer_->start_multi_stream(platform_ids)) {
         Logger::error("VideoStreamManager", "Failed to start streaming on some platforms");
-        return false;
+        if (streamer_->get_active_streams().empty()) {
+            streamer_->set_audio_encoder(nullptr);
+            streamer_->clear_video_streams();
+            live_profiles_.clear();
+            live_encoders_.clear();
+            if (release_audio_) {
+                release_audio_();
+            }
+            return false;
+        }
     }
     
-    // Start video processing loop
+    // Start the compose/convert/encode/send pipeline
+    pipeline_ = std::make_unique<Pipeline>(*composer_, *streamer_, live_profiles_, current_format_);
+    pipeline_->start();
     running_ = true;
-    processing_thread_ = std::thread([this]() {
-        video_processing_loop();
-    });
     
     Logger::info("VideoStreamManager", "Live stream started");
     return true;
@@ -653,59 +1518,41 @@ bool VideoStreamManager::stop_live_stream() {
     running_ = false;
     
     // Stop video processing
-    if (processing_thread_.joinable()) {
-        processing_thread_.join();
-    }
+    pipeline_.reset();
     
     // Stop all streams
     streamer_->stop_all_streams();
+    streamer_->set_audio_encoder(nullptr);
+    streamer_->clear_video_streams();
+    live_profiles_.clear();
+    live_encoders_.clear();
+    if (release_audio_) {
+        release_audio_();
+    }
     
     Logger::info("VideoStreamManager", "Live stream stopped");
     return true;
 }
 
-bool VideoStreamManager::is_live() const {
+VideoEncoderStats VideoStreamManager::get_encoder_stats() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return running_;
+    return encoder_ ? encoder_->get_stats() : VideoEncoderStats{};
 }
 
-void VideoStreamManager::video_processing_loop() {
-    const int target_fps = current_format_.fps;
-    const auto frame_duration = std::chrono::milliseconds(1000 / target_fps);
-    
-    std::vector<uint8_t> frame_buffer(current_format_.width * current_format_.height * 3);
-    std::vector<uint8_t> encoded_data;
-    
-    Logger::info("VideoStreamManager", "Video processing loop started");
-    
-    while (running_) {
-        auto frame_start = std::chrono::steady_clock::now();
-        
-        // Get current frame from composer
-        if (composer_->get_current_frame(frame_buffer.data(), frame_buffer.size())) {
-            
-            // Encode frame
-            encoded_data.clear();
-            if (encoder_->encode_frame(frame_buffer.data(), encoded_data)) {
-                
-                // Send to all active streams
-                if (!encoded_data.empty()) {
-                    streamer_->send_video_data(encoded_data.data(), encoded_data.size(),
-                                             nullptr, 0); // Audio data handled separately
-                }
-            }
-        }
-        
-        // Maintain target FPS
-        auto frame_end = std::chrono::steady_clock::now();
-        auto elapsed = frame_end - frame_start;
-        
-        if (elapsed < frame_duration) {
-            std::this_thread::sleep_for(frame_duration - elapsed);
-        }
-    }
-    
-    Logger::info("VideoStreamManager", "Video processing loop stopped");
+VideoPipelineStats VideoStreamManager::get_pipeline_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pipeline_ ? pipeline_->stats() : VideoPipelineStats{};
+}
+
+void VideoStreamManager::set_audio_source(AudioEncoderSource acquire, std::function<void()> release) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    acquire_audio_ = std::move(acquire);
+    release_audio_ = std::move(release);
+}
+
+bool VideoStreamManager::is_live() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
 }
 
 // Video source shortcuts
@@ -0,0 +1,306 @@
+#include "waveform_pyramid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace OneStopRadio {
+
+namespace {
+
+constexpr char kMagic[4] = {'O', 'S', 'W', 'P'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kHeaderSize = 64;
+constexpr uint64_t kBinAlignment = 64;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t level_count;
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint64_t total_frames;
+    uint32_t bin_size;
+    uint8_t reserved[28];
+};
+static_assert(sizeof(FileHeader) == kHeaderSize, "pyramid header must stay 64 bytes");
+
+struct LevelEntry {
+    uint32_t samples_per_bin;
+    uint32_t reserved;
+    uint64_t bin_count;
+    uint64_t offset;
+};
+static_assert(sizeof(LevelEntry) == 24, "pyramid level entry must stay 24 bytes");
+static_assert(sizeof(WaveformBin) == 8, "pyramid bin must stay 8 bytes");
+
+uint64_t align_up(uint64_t value) {
+    return (value + kBinAlignment - 1) / kBinAlignment * kBinAlignment;
+}
+
+int16_t to_sample16(float value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+} // namespace
+
+// ===== BUILDER =====
+
+const std::vector<uint32_t>& WaveformPyramidBuilder::default_levels() {
+    static const std::vector<uint32_t> levels = {64, 256, 1024, 4096};
+    return levels;
+}
+
+WaveformPyramidBuilder::WaveformPyramidBuilder(std::vector<uint32_t> samples_per_bin)
+    : samples_per_bin_(std::move(samples_per_bin)) {
+    if (samples_per_bin_.empty() || samples_per_bin_.front() == 0) {
+        throw std::invalid_argument("WaveformPyramidBuilder: need at least one non-zero level");
+    }
+    for (size_t i = 1; i < samples_per_bin_.size(); ++i) {
+        if (samples_per_bin_[i] <= samples_per_bin_[i - 1] || samples_per_bin_[i] % samples_per_bin_[i - 1] != 0) {
+            throw std::invalid_argument("WaveformPyramidBuilder: each level must be a larger multiple of the previous");
+        }
+    }
+}
+
+void WaveformPyramidBuilder::reset(uint32_t sample_rate, uint32_t channels) {
+    sample_rate_ = sample_rate;
+    channels_ = channels;
+    total_frames_ = 0;
+    finest_.clear();
+    current_ = Accumulator();
+    current_frames_ = 0;
+}
+
+void WaveformPyramidBuilder::add(const float* interleaved, size_t frames) {
+    const uint32_t bin_frames = samples_per_bin_.front();
+
+    for (size_t i = 0; i < frames; ++i) {
+        const float* frame = interleaved + i * channels_;
+        for (uint32_t ch = 0; ch < channels_; ++ch) {
+            const float sample = frame[ch];
+            if (current_.count == 0) {
+                current_.min = current_.max = sample;
+            } else {
+                current_.min = std::min(current_.min, sample);
+                current_.max = std::max(current_.max, sample);
+            }
+            current_.sum_squares += static_cast<double>(sample) * sample;
+            ++current_.count;
+        }
+
+        if (++current_frames_ == bin_frames) {
+            finest_.push_back(current_);
+            current_ = Accumulator();
+            current_frames_ = 0;
+        }
+    }
+    total_frames_ += frames;
+}
+
+WaveformBin WaveformPyramidBuilder::to_bin(const Accumulator& acc) {
+    WaveformBin bin{};
+    if (acc.count > 0) {
+        bin.min = to_sample16(acc.min);
+        bin.max = to_sample16(acc.max);
+        const double rms = std::sqrt(acc.sum_squares / acc.count);
+        bin.rms = static_cast<uint16_t>(std::lround(std::min(rms, 1.0) * 32767.0));
+    }
+    return bin;
+}
+
+bool WaveformPyramidBuilder::write(const std::string& output_path) const {
+    // Fold the finest level, plus any partial last bin, into every level
+    std::vector<Accumulator> finest = finest_;
+    if (current_frames_ > 0) {
+        finest.push_back(current_);
+    }
+
+    std::vector<std::vector<WaveformBin>> levels(samples_per_bin_.size());
+    for (size_t level = 0; level < samples_per_bin_.size(); ++level) {
+        const size_t group = samples_per_bin_[level] / samples_per_bin_.front();
+        auto& bins = levels[level];
+        bins.reserve((finest.size() + group - 1) / group);
+
+        for (size_t first = 0; first < finest.size(); first += group) {
+            Accumulator acc;
+            const size_t last = std::min(first + group, finest.size());
+            for (size_t i = first; i < last; ++i) {
+                const Accumulator& part = finest[i];
+                if (part.count == 0) {
+                    continue;
+                }
+                acc.min = acc.count ? std::min(acc.min, part.min) : part.min;
+                acc.max = acc.count ? std::max(acc.max, part.max) : part.max;
+                acc.sum_squares += part.sum_squares;
+                acc.count += part.count;
+            }
+            bins.push_back(to_bin(acc));
+        }
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.header_size = kHeaderSize;
+    header.level_count = static_cast<uint32_t>(levels.size());
+    header.sample_rate = sample_rate_;
+    header.channels = channels_;
+    header.total_frames = total_frames_;
+    header.bin_size = sizeof(WaveformBin);
+
+    std::vector<LevelEntry> entries(levels.size());
+    uint64_t offset = align_up(kHeaderSize + entries.size() * sizeof(LevelEntry));
+    for (size_t level = 0; level < levels.size(); ++level) {
+        entries[level].samples_per_bin = samples_per_bin_[level];
+        entries[level].reserved = 0;
+        entries[level].bin_count = levels[level].size();
+        entries[level].offset = offset;
+        offset = align_up(offset + levels[level].size() * sizeof(WaveformBin));
+    }
+
+    const std::string temp_path = output_path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(LevelEntry));
+
+        static const char padding[kBinAlignment] = {};
+        for (size_t level = 0; level < levels.size(); ++level) {
+            const uint64_t position = static_cast<uint64_t>(file.tellp());
+            file.write(padding, entries[level].offset - position);
+            file.write(reinterpret_cast<const char*>(levels[level].data()),
+                       levels[level].size() * sizeof(WaveformBin));
+        }
+
+        if (!file.good()) {
+            file.close();
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temp_path.c_str(), output_path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ===== READER =====
+
+std::unique_ptr<WaveformPyramid> WaveformPyramid::open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderSize) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);   // The mapping keeps the file alive
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+
+    std::unique_ptr<WaveformPyramid> pyramid(new WaveformPyramid());
+    pyramid->data_ = data;
+    pyramid->size_ = size;
+
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    const auto* header = reinterpret_cast<const FileHeader*>(bytes);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion ||
+        header->header_size < kHeaderSize || header->bin_size != sizeof(WaveformBin) ||
+        header->level_count == 0 ||
+        header->header_size + static_cast<uint64_t>(header->level_count) * sizeof(LevelEntry) > size) {
+        return nullptr;
+    }
+
+    pyramid->sample_rate_ = header->sample_rate;
+    pyramid->channels_ = header->channels;
+    pyramid->total_frames_ = header->total_frames;
+
+    const auto* entries = reinterpret_cast<const LevelEntry*>(bytes + header->header_size);
+    for (uint32_t i = 0; i < header->level_count; ++i) {
+        const LevelEntry& entry = entries[i];
+        if (entry.samples_per_bin == 0 || entry.offset % alignof(WaveformBin) != 0 ||
+            entry.offset > size || entry.bin_count > (size - entry.offset) / sizeof(WaveformBin)) {
+            return nullptr;
+        }
+        pyramid->levels_.push_back(Level{
+            entry.samples_per_bin,
+            entry.bin_count,
+            reinterpret_cast<const WaveformBin*>(bytes + entry.offset)
+        });
+    }
+
+    return pyramid;
+}
+
+WaveformPyramid::~WaveformPyramid() {
+    if (data_) {
+        munmap(data_, size_);
+    }
+}
+
+void WaveformPyramid::render(uint64_t start_frame, uint64_t end_frame, size_t width,
+                             std::vector<float>& peaks, std::vector<float>& rms) const {
+    peaks.assign(width, 0.0f);
+    rms.assign(width, 0.0f);
+    if (width == 0 || end_frame <= start_frame || levels_.empty()) {
+        return;
+    }
+
+    // Coarsest level that still gives every column at least one bin
+    const double frames_per_column = static_cast<double>(end_frame - start_frame) / width;
+    const Level* level = &levels_.front();
+    for (const auto& candidate : levels_) {
+        if (candidate.samples_per_bin <= frames_per_column &&
+            candidate.samples_per_bin > level->samples_per_bin) {
+            level = &candidate;
+        }
+    }
+
+    constexpr float kScale = 1.0f / 32767.0f;
+    for (size_t column = 0; column < width; ++column) {
+        const uint64_t first_frame = start_frame + static_cast<uint64_t>(column * frames_per_column);
+        const uint64_t last_frame = start_frame + static_cast<uint64_t>((column + 1) * frames_per_column);
+
+        const uint64_t first_bin = first_frame / level->samples_per_bin;
+        const uint64_t end_bin = std::min(std::max(first_bin + 1,
+                                                   (last_frame + level->samples_per_bin - 1) / level->samples_per_bin),
+                                          level->bin_count);
+        if (first_bin >= end_bin) {
+            continue;
+        }
+
+        int peak = 0;
+        double sum_squares = 0.0;
+        for (uint64_t b = first_bin; b < end_bin; ++b) {
+            const WaveformBin& bin = level->bins[b];
+            peak = std::max({peak, std::abs(static_cast<int>(bin.min)), static_cast<int>(bin.max)});
+            sum_squares += static_cast<double>(bin.rms) * bin.rms;
+        }
+
+        peaks[column] = std::min(peak * kScale, 1.0f);
+        rms[column] = static_cast<float>(std::sqrt(sum_squares / (end_bin - first_bin))) * kScale;
+    }
+}
+
+} // namespace OneStopRadio
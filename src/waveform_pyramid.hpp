@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace OneStopRadio {
+
+/**
+ * One bin of a waveform level: extremes and RMS of every channel sample in
+ * the bin, scaled so that 32767 is full scale
+ */
+struct WaveformBin {
+    int16_t min;
+    int16_t max;
+    uint16_t rms;
+    uint16_t reserved;
+};
+
+/**
+ * Builds a min/max/RMS pyramid while a track is decoded
+ *
+ * Only the finest level is accumulated; coarser levels are folded from it
+ * in write(), so every level is exact rather than averaged from rounded
+ * values.
+ */
+class WaveformPyramidBuilder {
+public:
+    // 64, 256, 1024 and 4096 frames per bin
+    static const std::vector<uint32_t>& default_levels();
+
+    /**
+     * @param samples_per_bin Frames per bin for each level, ascending, each
+     *        a multiple of the one before
+     * @throws std::invalid_argument otherwise
+     */
+    explicit WaveformPyramidBuilder(std::vector<uint32_t> samples_per_bin = default_levels());
+
+    // Start a new track
+    void reset(uint32_t sample_rate, uint32_t channels);
+
+    // Append interleaved frames
+    void add(const float* interleaved, size_t frames);
+
+    /**
+     * Write the pyramid file. The file is replaced atomically, so readers
+     * that still map the old one are unaffected.
+     */
+    bool write(const std::string& output_path) const;
+
+private:
+    struct Accumulator {
+        float min = 0.0f;
+        float max = 0.0f;
+        double sum_squares = 0.0;
+        uint64_t count = 0;
+    };
+
+    std::vector<uint32_t> samples_per_bin_;
+    uint32_t sample_rate_ = 0;
+    uint32_t channels_ = 0;
+    uint64_t total_frames_ = 0;
+
+    std::vector<Accumulator> finest_;
+    Accumulator current_;
+    uint32_t current_frames_ = 0;
+
+    static WaveformBin to_bin(const Accumulator& acc);
+};
+
+/**
+ * Read-only view of a pyramid file, memory-mapped
+ *
+ * File layout, little-endian, version 1:
+ *   header (64 bytes): "OSWP", u32 version, u32 header size, u32 level count,
+ *     u32 sample rate, u32 channels, u64 total frames, u32 bin size,
+ *     zero padding
+ *   level table: level count x { u32 frames per bin, u32 0, u64 bin count,
+ *     u64 file offset of the first bin }
+ *   bins: WaveformBin arrays, each starting on a 64-byte boundary
+ *
+ * Readers must reject files whose version they do not know.
+ */
+class WaveformPyramid {
+public:
+    struct Level {
+        uint32_t samples_per_bin;
+        uint64_t bin_count;
+        const WaveformBin* bins;
+    };
+
+    // @return nullptr if the file is missing, truncated or not a version 1 pyramid
+    static std::unique_ptr<WaveformPyramid> open(const std::string& path);
+    ~WaveformPyramid();
+
+    WaveformPyramid(const WaveformPyramid&) = delete;
+    WaveformPyramid& operator=(const WaveformPyramid&) = delete;
+
+    uint32_t sample_rate() const { return sample_rate_; }
+    uint32_t channels() const { return channels_; }
+    uint64_t total_frames() const { return total_frames_; }
+    double duration() const { return sample_rate_ ? static_cast<double>(total_frames_) / sample_rate_ : 0.0; }
+
+    size_t level_count() const { return levels_.size(); }
+    const Level& level(size_t index) const { return levels_[index]; }
+
+    /**
+     * Peak (0.0 - 1.0) and RMS per column for frames [start_frame, end_frame).
+     * Reads the coarsest level whose bins are no wider than a column, so the
+     * cost depends on width, not on the length of the window.
+     */
+    void render(uint64_t start_frame, uint64_t end_frame, size_t width,
+                std::vector<float>& peaks, std::vector<float>& rms) const;
+
+private:
+    WaveformPyramid() = default;
+
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    uint32_t sample_rate_ = 0;
+    uint32_t channels_ = 0;
+    uint64_t total_frames_ = 0;
+    std::vector<Level> levels_;
+};
+
+} // namespace OneStopRadio
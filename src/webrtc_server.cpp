@@ -1,291 +1,1319 @@
 #include "webrtc_server.hpp"
-#include "logger.hpp"
-#include <iostream>
-#include <thread>
+#include "audio_system.hpp"
+#include "metrics_registry.hpp"
+#include "trace_profiler.hpp"
+#include "utils/logger.hpp"
+#include <rtc/rtc.hpp>
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/server.hpp>
+#include <nlohmann/json.hpp>
+#include <opus/opus.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <variant>
 
-WebRTCServer::WebRTCServer(int port) : port_(port), running_(false) {
-    Logger::info("WebRTCServer", "Initialized on port " + std::to_string(port));
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libavutil/opt.h>
+#include <libswresample/swresample.h>
 }
 
-WebRTCServer::~WebRTCServer() {
-    stop();
+using json = nlohmann::json;
+using SignalingServer = websocketpp::server<websocketpp::config::asio>;
+
+namespace {
+
+constexpr int kOpusRate = 48000;            // RTP clock rate of Opus, whatever it codes
+constexpr int kMaxFrameSamples = 5760;      // 120 ms, the longest Opus packet
+constexpr size_t kMaxOpusPacket = 4000;
+constexpr size_t kRtpHeaderBytes = 12;
+constexpr size_t kMaxBufferedPackets = 1024;
+constexpr int kMaxConcealedRun = 5;         // Frames concealed on an empty buffer before rebuffering
+constexpr auto kMediaTick = std::chrono::milliseconds(2);
+constexpr auto kPingInterval = std::chrono::seconds(1);
+constexpr auto kInputRetry = std::chrono::seconds(1);      // First wait for a free mixer slot
+constexpr auto kMaxInputRetry = std::chrono::seconds(30);  // Doubling up to this
+constexpr auto kReturnReadTimeout = std::chrono::milliseconds(100);
+constexpr const char* kLatencyChannel = "latency";
+
+double steady_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-bool WebRTCServer::start() {
-    if (running_) {
-        Logger::warn("WebRTCServer", "Server already running");
-        return true;
+struct WebRTCMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    MetricGauge& peers = registry.gauge(
+        "onestop_webrtc_peers", "WebRTC peers with a media session");
+    MetricCounter& packets_received = registry.counter(
+        "onestop_webrtc_packets_total", "Opus RTP packets", {{"direction", "received"}});
+    MetricCounter& packets_sent = registry.counter(
+        "onestop_webrtc_packets_total", "Opus RTP packets", {{"direction", "sent"}});
+    MetricCounter& packets_lost = registry.counter(
+        "onestop_webrtc_packet_losses_total", "Contribution packets missing at playout", {{"type", "lost"}});
+    MetricCounter& packets_late = registry.counter(
+        "onestop_webrtc_packet_losses_total", "Contribution packets missing at playout", {{"type", "late"}});
+    MetricHistogram& rtt_seconds = registry.histogram(
+        "onestop_webrtc_rtt_seconds", "Round trip to WebRTC peers",
+        MetricsRegistry::exponential_buckets(0.005, 2.0, 10));
+};
+
+WebRTCMetrics& webrtc_metrics() {
+    static WebRTCMetrics metrics;
+    return metrics;
+}
+
+struct RtpPacket {
+    uint8_t payload_type = 0;
+    uint16_t sequence = 0;
+    uint32_t timestamp = 0;
+    uint32_t ssrc = 0;
+    std::vector<uint8_t> payload;
+};
+
+uint16_t read_be16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+uint32_t read_be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void write_be16(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value);
+}
+
+void write_be32(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<uint8_t>(value >> (24 - 8 * i));
     }
-    
-    try {
-        // Initialize WebSocket server for signaling
-        signaling_server_.set_access_channels(websocketpp::log::alevel::all);
-        signaling_server_.clear_access_channels(websocketpp::log::alevel::frame_payload);
-        
-        signaling_server_.init_asio();
-        signaling_server_.set_reuse_addr(true);
-        
-        // Set message handlers
-        signaling_server_.set_message_handler(
-            [this](websocketpp::connection_hdl hdl, websocketpp::server<websocketpp::config::asio>::message_ptr msg) {
-                handle_message(hdl, msg);
-            });
-        
-        signaling_server_.set_open_handler(
-            [this](websocketpp::connection_hdl hdl) {
-                handle_connection(hdl);
-            });
-        
-        signaling_server_.set_close_handler(
-            [this](websocketpp::connection_hdl hdl) {
-                handle_disconnect(hdl);
+}
+
+// RTCP shares the port (RFC 5761); its packet types land in 192-223 here
+bool is_rtcp(const uint8_t* data, size_t size) {
+    return size >= 2 && data[1] >= 192 && data[1] <= 223;
+}
+
+// RFC 3550 fixed header, then CSRCs, a header extension and padding, all skipped
+bool parse_rtp(const uint8_t* data, size_t size, RtpPacket& packet) {
+    if (size < kRtpHeaderBytes || (data[0] >> 6) != 2) {
+        return false;
+    }
+    size_t offset = kRtpHeaderBytes + static_cast<size_t>(data[0] & 0x0F) * 4;
+    if (data[0] & 0x10) {
+        if (size < offset + 4) {
+            return false;
+        }
+        offset += 4 + static_cast<size_t>(read_be16(data + offset + 2)) * 4;
+    }
+    size_t end = size;
+    if (data[0] & 0x20) {
+        const size_t padding = data[size - 1];
+        if (padding == 0 || padding > end) {
+            return false;
+        }
+        end -= padding;
+    }
+    if (offset >= end) {
+        return false;
+    }
+    packet.payload_type = data[1] & 0x7F;
+    packet.sequence = read_be16(data + 2);
+    packet.timestamp = read_be32(data + 4);
+    packet.ssrc = read_be32(data + 8);
+    packet.payload.assign(data + offset, data + end);
+    return true;
+}
+
+/**
+ * Reorders one peer's packets and hands them out at the playout rate
+ *
+ * Playout starts once the buffer spans the target delay, which follows the
+ * RFC 3550 jitter estimate. Running dry conceals a frame and waits, which
+ * stretches the delay to what the network needs; the caller trims it back
+ * once the buffer runs well past the target. A packet missing while later
+ * ones are here is lost and concealed, from the next packet's FEC when it
+ * is the next one. Dry for kMaxConcealedRun frames, the buffer refills to
+ * the target before playing again.
+ */
+class JitterBuffer {
+public:
+    enum class Result {
+        PACKET,     // payload is the next packet
+        RECOVER,    // payload is the packet after a lost one, to decode its FEC
+        CONCEAL,    // Lost; nothing to decode from
+        EMPTY       // Not playing
+    };
+
+    JitterBuffer(double min_ms, double max_ms) : min_ms_(min_ms), max_ms_(std::max(min_ms, max_ms)) {}
+
+    void push(RtpPacket&& packet, double arrival_ms) {
+        if (!have_sequence_ || packet.ssrc != ssrc_) {
+            reset();
+            ssrc_ = packet.ssrc;
+            highest_ = (uint64_t(1) << 32) + packet.sequence;
+            have_sequence_ = true;
+        }
+        // Extend the 16-bit sequence around the highest seen so far
+        const int16_t delta = static_cast<int16_t>(packet.sequence - static_cast<uint16_t>(highest_));
+        const uint64_t sequence = highest_ + delta;
+        ++received_;
+
+        // Before its first playout next_ is below every extended sequence
+        if (sequence < next_) {
+            ++late_;
+            return;
+        }
+        if (sequence > highest_ || received_ == 1) {
+            update_jitter(packet.timestamp, arrival_ms);
+            highest_ = std::max(highest_, sequence);
+        }
+        packets_.emplace(sequence, std::move(packet));
+        while (packets_.size() > kMaxBufferedPackets) {
+            packets_.erase(packets_.begin());
+            ++discarded_;
+        }
+    }
+
+    Result pop(std::vector<uint8_t>& payload) {
+        if (!playing_) {
+            if (packets_.empty() || depth_ms() < target_ms()) {
+                return Result::EMPTY;
+            }
+            playing_ = true;
+            next_ = packets_.begin()->first;
+            concealed_run_ = 0;
+        }
+
+        auto it = packets_.begin();
+        if (it == packets_.end()) {
+            // Conceal without moving on: the delay grows by a frame and the
+            // packet still plays when it comes
+            if (++concealed_run_ > kMaxConcealedRun) {
+                playing_ = false;
+                ++rebuffers_;
+                return Result::EMPTY;
+            }
+            return Result::CONCEAL;
+        }
+        concealed_run_ = 0;
+
+        if (it->first == next_) {
+            payload = std::move(it->second.payload);
+            packets_.erase(it);
+            ++next_;
+            return Result::PACKET;
+        }
+
+        // next_ is missing but later packets are here
+        ++lost_;
+        const bool fec = it->first == next_ + 1;
+        ++next_;
+        if (fec) {
+            payload = it->second.payload;
+            ++recovered_;
+            return Result::RECOVER;
+        }
+        return Result::CONCEAL;
+    }
+
+    double depth_ms() const {
+        if (packets_.empty()) {
+            return 0.0;
+        }
+        const uint64_t first = playing_ ? next_ : packets_.begin()->first;
+        return highest_ >= first ? static_cast<double>(highest_ - first + 1) * frame_ms_ : 0.0;
+    }
+
+    double target_ms() const { return std::clamp(frame_ms_ + 4.0 * jitter_ms(), min_ms_, max_ms_); }
+    double jitter_ms() const { return jitter_ / (kOpusRate / 1000.0); }
+    double frame_ms() const { return frame_ms_; }
+    void set_frame_ms(double ms) { frame_ms_ = ms; }
+
+    void reset() {
+        packets_.clear();
+        playing_ = false;
+        next_ = 0;
+        have_sequence_ = false;
+        have_transit_ = false;
+        jitter_ = 0.0;
+    }
+
+    uint64_t received() const { return received_; }
+    uint64_t lost() const { return lost_; }
+    uint64_t late() const { return late_; }
+    uint64_t recovered() const { return recovered_; }
+    uint64_t discarded() const { return discarded_; }
+    uint64_t rebuffers() const { return rebuffers_; }
+
+private:
+    // J += (|D| - J) / 16, in RTP timestamp units
+    void update_jitter(uint32_t timestamp, double arrival_ms) {
+        if (have_transit_) {
+            const double arrival_delta = (arrival_ms - last_arrival_ms_) * (kOpusRate / 1000.0);
+            const double d = arrival_delta - static_cast<double>(static_cast<int32_t>(timestamp - last_timestamp_));
+            jitter_ += (std::fabs(d) - jitter_) / 16.0;
+        }
+        have_transit_ = true;
+        last_arrival_ms_ = arrival_ms;
+        last_timestamp_ = timestamp;
+    }
+
+    const double min_ms_;
+    const double max_ms_;
+    std::map<uint64_t, RtpPacket> packets_;
+    bool have_sequence_ = false;
+    uint32_t ssrc_ = 0;
+    uint64_t highest_ = 0;
+    bool playing_ = false;
+    uint64_t next_ = 0;
+    int concealed_run_ = 0;
+    double frame_ms_ = 20.0;                // Duration of the last decoded packet
+
+    bool have_transit_ = false;
+    double last_arrival_ms_ = 0.0;
+    uint32_t last_timestamp_ = 0;
+    double jitter_ = 0.0;
+
+    uint64_t received_ = 0;
+    uint64_t lost_ = 0;
+    uint64_t late_ = 0;
+    uint64_t recovered_ = 0;
+    uint64_t discarded_ = 0;
+    uint64_t rebuffers_ = 0;
+};
+
+/**
+ * Interleaved float rate conversion; passes audio through at equal rates
+ */
+class RateConverter {
+public:
+    RateConverter(int channels, int from_rate, int to_rate) : channels_(channels) {
+        if (from_rate == to_rate) {
+            return;
+        }
+        const int64_t layout = av_get_default_channel_layout(channels);
+        context_ = swr_alloc_set_opts(nullptr, layout, AV_SAMPLE_FMT_FLT, to_rate,
+                                      layout, AV_SAMPLE_FMT_FLT, from_rate, 0, nullptr);
+        if (context_ && swr_init(context_) < 0) {
+            swr_free(&context_);
+        }
+        valid_ = context_ != nullptr;
+    }
+
+    ~RateConverter() { swr_free(&context_); }
+
+    RateConverter(const RateConverter&) = delete;
+    RateConverter& operator=(const RateConverter&) = delete;
+
+    bool valid() const { return valid_; }
+
+    // Appends to out
+    void convert(const float* in, int frames, std::vector<float>& out) {
+        const size_t channels = static_cast<size_t>(channels_);
+        if (!context_) {
+            out.insert(out.end(), in, in + static_cast<size_t>(frames) * channels);
+            return;
+        }
+        const int capacity = swr_get_out_samples(context_, frames);
+        if (capacity <= 0) {
+            return;
+        }
+        const size_t used = out.size();
+        out.resize(used + static_cast<size_t>(capacity) * channels);
+        uint8_t* output = reinterpret_cast<uint8_t*>(out.data() + used);
+        const uint8_t* input = reinterpret_cast<const uint8_t*>(in);
+        const int converted = swr_convert(context_, &output, capacity, &input, frames);
+        out.resize(used + static_cast<size_t>(std::max(converted, 0)) * channels);
+    }
+
+private:
+    int channels_;
+    SwrContext* context_ = nullptr;
+    bool valid_ = true;
+};
+
+const char* state_name(rtc::PeerConnection::State state) {
+    switch (state) {
+        case rtc::PeerConnection::State::New: return "new";
+        case rtc::PeerConnection::State::Connecting: return "connecting";
+        case rtc::PeerConnection::State::Connected: return "connected";
+        case rtc::PeerConnection::State::Disconnected: return "disconnected";
+        case rtc::PeerConnection::State::Failed: return "failed";
+        case rtc::PeerConnection::State::Closed: return "closed";
+    }
+    return "unknown";
+}
+
+/**
+ * One peer's media session. The signalling thread creates and closes it;
+ * libdatachannel threads push packets and echoes under mutex; the media
+ * thread owns the decoder and the return thread the RTP send state.
+ */
+struct MediaPeer {
+    MediaPeer(const WebRTCOptions& options) : jitter(options.min_jitter_ms, options.max_jitter_ms) {}
+
+    ~MediaPeer() {
+        if (decoder) {
+            opus_decoder_destroy(decoder);
+        }
+    }
+
+    std::string id;
+    websocketpp::connection_hdl connection;
+    std::shared_ptr<rtc::PeerConnection> pc;
+    std::shared_ptr<rtc::Track> track;
+    int payload_type = 111;
+    bool receives_return = false;           // The peer asked for our audio
+    std::atomic<rtc::PeerConnection::State> state{rtc::PeerConnection::State::New};
+
+    std::mutex mutex;
+    JitterBuffer jitter;
+    bool closed = false;
+    bool contributing = false;              // Between start-stream and stop-stream
+    std::string stream_id;
+    std::shared_ptr<LiveInput> input;
+    bool unplaced = false;                  // No mixer slot was free; retried with backoff
+    std::chrono::steady_clock::duration input_retry{kInputRetry};
+    std::chrono::steady_clock::time_point next_input_attempt{};
+    std::shared_ptr<rtc::DataChannel> latency_channel;
+    uint64_t ping_id = 0;
+    double rtt_ms = 0.0;
+    double remote_capture_ms = 0.0;         // Reported by the peer with each echo
+    double remote_playout_ms = 0.0;
+
+    // Media thread
+    OpusDecoder* decoder = nullptr;
+    std::unique_ptr<RateConverter> from_opus;
+    std::vector<uint8_t> payload;
+    std::vector<float> decoded;
+    std::vector<float> converted;
+    int frame_samples = kOpusRate / 50;
+    std::atomic<uint64_t> trimmed{0};       // Decoded and dropped to cut the delay
+
+    // Return thread
+    uint32_t ssrc = 0;
+    uint16_t sequence = 0;
+    uint32_t timestamp = 0;
+    std::atomic<uint64_t> packets_sent{0};
+};
+
+struct WebRTCClient {
+    websocketpp::connection_hdl connection;
+    std::chrono::steady_clock::time_point connected_at;
+    bool has_webrtc_connection = false;
+    bool is_streaming = false;
+    std::string stream_id;
+    bool has_audio_callback = false;
+    std::shared_ptr<MediaPeer> peer;
+};
+
+} // namespace
+
+class WebRTCServer::Impl {
+public:
+    Impl(int port, const WebRTCOptions& options) : port_(port), options_(options) {
+        options_.frame_ms = options_.frame_ms >= 20 ? 20 : 10;
+        std::random_device seed;
+        random_.seed(seed());
+    }
+
+    ~Impl() {
+        stop();
+    }
+
+    bool start() {
+        if (running_) {
+            Logger::warn("WebRTCServer", "Server already running");
+            return true;
+        }
+
+        if (audio_system_ && audio_system_->get_channel_count() > 2) {
+            Logger::error("WebRTCServer", "Opus carries at most two channels; media path disabled");
+            audio_system_ = nullptr;
+        }
+        media_rate_ = audio_system_ ? audio_system_->get_sample_rate() : kOpusRate;
+        media_channels_ = audio_system_ ? audio_system_->get_channel_count() : 2;
+
+        try {
+            // Initialize WebSocket server for signaling
+            signaling_server_.set_access_channels(websocketpp::log::alevel::all);
+            signaling_server_.clear_access_channels(websocketpp::log::alevel::frame_payload);
+
+            signaling_server_.init_asio();
+            signaling_server_.set_reuse_addr(true);
+
+            // Set message handlers
+            signaling_server_.set_message_handler(
+                [this](websocketpp::connection_hdl hdl, SignalingServer::message_ptr msg) {
+                    handle_message(hdl, msg);
+                });
+
+            signaling_server_.set_open_handler(
+                [this](websocketpp::connection_hdl hdl) {
+                    handle_connection(hdl);
+                });
+
+            signaling_server_.set_close_handler(
+                [this](websocketpp::connection_hdl hdl) {
+                    handle_disconnect(hdl);
+                });
+
+            // Start listening
+            signaling_server_.listen(port_);
+            signaling_server_.start_accept();
+
+            // Run server in separate thread
+            server_thread_ = std::thread([this]() {
+                signaling_server_.run();
             });
-        
-        // Start listening
-        signaling_server_.listen(port_);
-        signaling_server_.start_accept();
-        
-        // Run server in separate thread
-        server_thread_ = std::thread([this]() {
-            signaling_server_.run();
-        });
-        
+
+        } catch (const std::exception& e) {
+            Logger::error("WebRTCServer", "Failed to start: " + std::string(e.what()));
+            return false;
+        }
+
         running_ = true;
+        media_thread_ = std::thread(&Impl::media_loop, this);
+        if (audio_system_ && options_.program_return) {
+            return_thread_ = std::thread(&Impl::return_loop, this);
+        }
         Logger::info("WebRTCServer", "Started successfully on port " + std::to_string(port_));
         return true;
-        
-    } catch (const std::exception& e) {
-        Logger::error("WebRTCServer", "Failed to start: " + std::string(e.what()));
-        return false;
     }
-}
 
-void WebRTCServer::stop() {
-    if (!running_) {
-        return;
-    }
-    
-    running_ = false;
-    
-    try {
-        signaling_server_.stop();
-        
-        if (server_thread_.joinable()) {
-            server_thread_.join();
-        }
-        
-        // Clean up all connections
-        std::lock_guard<std::mutex> lock(connections_mutex_);
-        connections_.clear();
-        
-        Logger::info("WebRTCServer", "Stopped successfully");
-        
-    } catch (const std::exception& e) {
-        Logger::error("WebRTCServer", "Error during stop: " + std::string(e.what()));
+    void stop() {
+        if (!running_) {
+            return;
+        }
+
+        running_ = false;
+        if (media_thread_.joinable()) {
+            media_thread_.join();
+        }
+        if (return_thread_.joinable()) {
+            return_thread_.join();
+        }
+
+        try {
+            signaling_server_.stop();
+
+            if (server_thread_.joinable()) {
+                server_thread_.join();
+            }
+
+            // Clean up all connections
+            std::map<websocketpp::connection_hdl, std::shared_ptr<WebRTCClient>,
+                     std::owner_less<websocketpp::connection_hdl>> connections;
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex_);
+                connections.swap(connections_);
+            }
+            for (const auto& pair : connections) {
+                if (pair.second->peer) {
+                    close_peer(*pair.second->peer);
+                }
+            }
+
+            Logger::info("WebRTCServer", "Stopped successfully");
+
+        } catch (const std::exception& e) {
+            Logger::error("WebRTCServer", "Error during stop: " + std::string(e.what()));
+        }
     }
-}
 
-void WebRTCServer::handle_connection(websocketpp::connection_hdl hdl) {
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    
-    // Create new client connection
-    auto client = std::make_shared<WebRTCClient>();
-    client->connection = hdl;
-    client->connected_at = std::chrono::steady_clock::now();
-    
-    connections_[hdl] = client;
-    
-    Logger::info("WebRTCServer", "New client connected. Total connections: " + 
-                std::to_string(connections_.size()));
-}
+    void handle_connection(websocketpp::connection_hdl hdl) {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+
+        // Create new client connection
+        auto client = std::make_shared<WebRTCClient>();
+        client->connection = hdl;
+        client->connected_at = std::chrono::steady_clock::now();
 
-void WebRTCServer::handle_disconnect(websocketpp::connection_hdl hdl) {
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    
-    auto it = connections_.find(hdl);
-    if (it != connections_.end()) {
-        connections_.erase(it);
-        
-        Logger::info("WebRTCServer", "Client disconnected. Total connections: " + 
+        connections_[hdl] = client;
+
+        Logger::info("WebRTCServer", "New client connected. Total connections: " +
                     std::to_string(connections_.size()));
     }
-}
 
-void WebRTCServer::handle_message(websocketpp::connection_hdl hdl, 
-                                websocketpp::server<websocketpp::config::asio>::message_ptr msg) {
-    try {
-        // Parse JSON message
-        json message = json::parse(msg->get_payload());
-        std::string type = message.value("type", "");
-        
-        Logger::debug("WebRTCServer", "Received message type: " + type);
-        
-        if (type == "offer") {
-            handle_offer(hdl, message);
-        } else if (type == "answer") {
-            handle_answer(hdl, message);
-        } else if (type == "ice-candidate") {
-            handle_ice_candidate(hdl, message);
-        } else if (type == "start-stream") {
-            handle_start_stream(hdl, message);
-        } else if (type == "stop-stream") {
-            handle_stop_stream(hdl, message);
-        } else {
-            Logger::warn("WebRTCServer", "Unknown message type: " + type);
-        }
-        
-    } catch (const std::exception& e) {
-        Logger::error("WebRTCServer", "Error handling message: " + std::string(e.what()));
+    void handle_disconnect(websocketpp::connection_hdl hdl) {
+        std::shared_ptr<MediaPeer> peer;
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+
+            auto it = connections_.find(hdl);
+            if (it == connections_.end()) {
+                return;
+            }
+            peer = it->second->peer;
+            connections_.erase(it);
+
+            Logger::info("WebRTCServer", "Client disconnected. Total connections: " +
+                        std::to_string(connections_.size()));
+        }
+        if (peer) {
+            close_peer(*peer);
+        }
     }
-}
 
-void WebRTCServer::handle_offer(websocketpp::connection_hdl hdl, const json& message) {
-    // In a real WebRTC implementation, this would:
-    // 1. Create a peer connection
-    // 2. Set remote description (offer)
-    // 3. Create answer
-    // 4. Set local description
-    // 5. Send answer back to client
-    
-    // For now, send a mock answer
-    json response = {
-        {"type", "answer"},
-        {"sdp", "mock-answer-sdp"},
-        {"success", true}
-    };
-    
-    send_message(hdl, response);
-    Logger::info("WebRTCServer", "Processed offer and sent answer");
-}
+    void handle_message(websocketpp::connection_hdl hdl, SignalingServer::message_ptr msg) {
+        try {
+            // Parse JSON message
+            json message = json::parse(msg->get_payload());
+            std::string type = message.value("type", "");
 
-void WebRTCServer::handle_answer(websocketpp::connection_hdl hdl, const json& message) {
-    // Handle WebRTC answer (typically from client in response to our offer)
-    Logger::info("WebRTCServer", "Received answer from client");
-    
-    // Update client state
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    auto it = connections_.find(hdl);
-    if (it != connections_.end()) {
-        it->second->has_webrtc_connection = true;
+            LOG_DEBUG("WebRTCServer", "Received message type: " + type);
+
+            if (type == "offer") {
+                handle_offer(hdl, message);
+            } else if (type == "answer") {
+                handle_answer(hdl, message);
+            } else if (type == "ice-candidate") {
+                handle_ice_candidate(hdl, message);
+            } else if (type == "start-stream") {
+                handle_start_stream(hdl, message);
+            } else if (type == "stop-stream") {
+                handle_stop_stream(hdl, message);
+            } else if (type == "latency-pong") {
+                if (auto peer = find_peer(hdl)) {
+                    handle_latency_pong(*peer, message);
+                }
+            } else {
+                Logger::warn("WebRTCServer", "Unknown message type: " + type);
+            }
+
+        } catch (const std::exception& e) {
+            Logger::error("WebRTCServer", "Error handling message: " + std::string(e.what()));
+        }
     }
-}
 
-void WebRTCServer::handle_ice_candidate(websocketpp::connection_hdl hdl, const json& message) {
-    // Handle ICE candidate for NAT traversal
-    Logger::debug("WebRTCServer", "Received ICE candidate");
-    
-    // In a real implementation, this would be added to the peer connection
-    // For now, just acknowledge
-    json response = {
-        {"type", "ice-candidate-ack"},
-        {"success", true}
-    };
-    
-    send_message(hdl, response);
-}
+    // The client offers; we answer with a track on its audio m-line, so the
+    // answer carries our SSRC and the program return needs no renegotiation
+    void handle_offer(websocketpp::connection_hdl hdl, const json& message) {
+        std::shared_ptr<MediaPeer> peer;
+        try {
+            peer = create_peer(hdl, message.value("sdp", ""));
+        } catch (const std::exception& e) {
+            send_message(hdl, {{"type", "answer"}, {"success", false}, {"error", e.what()}});
+            Logger::error("WebRTCServer", "Rejected offer: " + std::string(e.what()));
+            return;
+        }
 
-void WebRTCServer::handle_start_stream(websocketpp::connection_hdl hdl, const json& message) {
-    std::string stream_id = message.value("stream_id", "default");
-    
-    // Update client state
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    auto it = connections_.find(hdl);
-    if (it != connections_.end()) {
-        it->second->is_streaming = true;
-        it->second->stream_id = stream_id;
-        
-        // Register audio data callback
-        if (audio_callback_) {
-            it->second->has_audio_callback = true;
-        }
-    }
-    
-    json response = {
-        {"type", "stream-started"},
-        {"stream_id", stream_id},
-        {"success", true}
-    };
-    
-    send_message(hdl, response);
-    Logger::info("WebRTCServer", "Started streaming for client: " + stream_id);
-}
+        std::shared_ptr<MediaPeer> previous;
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            auto it = connections_.find(hdl);
+            if (it != connections_.end()) {
+                previous = std::exchange(it->second->peer, peer);
+                it->second->has_webrtc_connection = true;
+                // A renegotiating client keeps streaming into the same channel
+                std::lock_guard<std::mutex> peer_lock(peer->mutex);
+                peer->contributing = it->second->is_streaming;
+                peer->stream_id = it->second->stream_id;
+            } else {
+                previous = peer;
+            }
+        }
+        if (previous) {
+            close_peer(*previous);
+        }
+        Logger::info("WebRTCServer", "Processed offer for " + peer->id);
+    }
+
+    // We never offer, but a client may renegotiate by asking us to
+    void handle_answer(websocketpp::connection_hdl hdl, const json& message) {
+        Logger::info("WebRTCServer", "Received answer from client");
+
+        auto peer = find_peer(hdl);
+        if (!peer) {
+            return;
+        }
+        try {
+            peer->pc->setRemoteDescription(rtc::Description(message.value("sdp", ""), "answer"));
+        } catch (const std::exception& e) {
+            Logger::error("WebRTCServer", "Bad answer from " + peer->id + ": " + e.what());
+        }
+    }
+
+    void handle_ice_candidate(websocketpp::connection_hdl hdl, const json& message) {
+        LOG_DEBUG("WebRTCServer", "Received ICE candidate");
+
+        auto peer = find_peer(hdl);
+        const std::string candidate = message.value("candidate", "");
+        if (!peer || candidate.empty()) {
+            return;
+        }
+        try {
+            peer->pc->addRemoteCandidate(rtc::Candidate(candidate, message.value("sdpMid", "")));
+        } catch (const std::exception& e) {
+            Logger::warn("WebRTCServer", "Ignored ICE candidate from " + peer->id + ": " + e.what());
+        }
+    }
+
+    void handle_start_stream(websocketpp::connection_hdl hdl, const json& message) {
+        std::string stream_id = message.value("stream_id", "default");
+
+        // Update client state
+        std::shared_ptr<MediaPeer> peer;
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            auto it = connections_.find(hdl);
+            if (it != connections_.end()) {
+                it->second->is_streaming = true;
+                it->second->stream_id = stream_id;
+                peer = it->second->peer;
+
+                // Register audio data callback
+                if (audio_callback_) {
+                    it->second->has_audio_callback = true;
+                }
+            }
+        }
+        if (peer) {
+            std::lock_guard<std::mutex> lock(peer->mutex);
+            peer->contributing = true;
+            peer->stream_id = stream_id;
+        }
+
+        json response = {
+            {"type", "stream-started"},
+            {"stream_id", stream_id},
+            {"success", true}
+        };
+
+        send_message(hdl, response);
+        Logger::info("WebRTCServer", "Started streaming for client: " + stream_id);
+    }
+
+    void handle_stop_stream(websocketpp::connection_hdl hdl, const json&) {
+        // Update client state
+        std::string stream_id;
+        std::shared_ptr<MediaPeer> peer;
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            auto it = connections_.find(hdl);
+            if (it == connections_.end()) {
+                return;
+            }
+            stream_id = it->second->stream_id;
+            it->second->is_streaming = false;
+            it->second->stream_id = "";
+            it->second->has_audio_callback = false;
+            peer = it->second->peer;
+        }
+        if (peer) {
+            stop_contribution(*peer);
+        }
 
-void WebRTCServer::handle_stop_stream(websocketpp::connection_hdl hdl, const json& message) {
-    // Update client state
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    auto it = connections_.find(hdl);
-    if (it != connections_.end()) {
-        std::string stream_id = it->second->stream_id;
-        it->second->is_streaming = false;
-        it->second->stream_id = "";
-        it->second->has_audio_callback = false;
-        
         json response = {
             {"type", "stream-stopped"},
             {"stream_id", stream_id},
             {"success", true}
         };
-        
+
         send_message(hdl, response);
         Logger::info("WebRTCServer", "Stopped streaming for client: " + stream_id);
     }
-}
 
-void WebRTCServer::send_message(websocketpp::connection_hdl hdl, const json& message) {
-    try {
+    void send_message(websocketpp::connection_hdl hdl, const json& message) {
+        try {
+            std::string msg_str = message.dump();
+            signaling_server_.send(hdl, msg_str, websocketpp::frame::opcode::text);
+        } catch (const std::exception& e) {
+            Logger::error("WebRTCServer", "Failed to send message: " + std::string(e.what()));
+        }
+    }
+
+    void broadcast_message(const json& message) {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+
         std::string msg_str = message.dump();
-        signaling_server_.send(hdl, msg_str, websocketpp::frame::opcode::text);
-    } catch (const std::exception& e) {
-        Logger::error("WebRTCServer", "Failed to send message: " + std::string(e.what()));
+        for (const auto& pair : connections_) {
+            try {
+                signaling_server_.send(pair.first, msg_str, websocketpp::frame::opcode::text);
+            } catch (const std::exception& e) {
+                Logger::error("WebRTCServer", "Failed to broadcast to client: " + std::string(e.what()));
+            }
+        }
     }
-}
 
-void WebRTCServer::broadcast_message(const json& message) {
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    
-    std::string msg_str = message.dump();
-    for (const auto& pair : connections_) {
-        try {
-            signaling_server_.send(pair.first, msg_str, websocketpp::frame::opcode::text);
-        } catch (const std::exception& e) {
-            Logger::error("WebRTCServer", "Failed to broadcast to client: " + std::string(e.what()));
+    // ===== MEDIA =====
+
+    std::shared_ptr<MediaPeer> create_peer(websocketpp::connection_hdl hdl, const std::string& sdp) {
+        rtc::Description offer(sdp, "offer");
+
+        // The first audio m-line that offers Opus
+        rtc::Description::Media* remote_audio = nullptr;
+        int payload_type = -1;
+        for (int i = 0; i < offer.mediaCount() && !remote_audio; ++i) {
+            auto entry = offer.media(i);
+            auto* media = std::get_if<rtc::Description::Media*>(&entry);
+            if (!media || (*media)->type() != "audio") {
+                continue;
+            }
+            for (int pt : (*media)->payloadTypes()) {
+                const auto* map = (*media)->rtpMap(pt);
+                std::string format = map ? map->format : "";
+                std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+                if (format == "opus") {
+                    remote_audio = *media;
+                    payload_type = pt;
+                    break;
+                }
+            }
+        }
+        if (!remote_audio) {
+            throw std::runtime_error("offer has no Opus audio");
+        }
+
+        auto peer = std::make_shared<MediaPeer>(options_);
+        peer->id = "peer" + std::to_string(++peer_counter_);
+        peer->connection = hdl;
+        peer->payload_type = payload_type;
+        {
+            std::lock_guard<std::mutex> lock(random_mutex_);
+            peer->ssrc = static_cast<uint32_t>(random_());
+            peer->sequence = static_cast<uint16_t>(random_());
+            peer->timestamp = static_cast<uint32_t>(random_());
+        }
+
+        int error = OPUS_OK;
+        peer->decoder = opus_decoder_create(kOpusRate, media_channels_, &error);
+        if (error != OPUS_OK) {
+            throw std::runtime_error(std::string("Opus decoder: ") + opus_strerror(error));
+        }
+        peer->from_opus = std::make_unique<RateConverter>(media_channels_, kOpusRate, media_rate_);
+        if (!peer->from_opus->valid()) {
+            throw std::runtime_error("no resampler to " + std::to_string(media_rate_) + " Hz");
+        }
+        peer->decoded.resize(static_cast<size_t>(kMaxFrameSamples) * media_channels_);
+
+        rtc::Configuration config;
+        for (const std::string& server : options_.ice_servers) {
+            config.iceServers.emplace_back(server);
+        }
+        config.portRangeBegin = options_.port_range_begin;
+        config.portRangeEnd = options_.port_range_end;
+        peer->pc = std::make_shared<rtc::PeerConnection>(config);
+
+        // Answer with the reverse of the offered direction
+        using Direction = rtc::Description::Direction;
+        Direction direction = Direction::SendRecv;
+        switch (remote_audio->direction()) {
+            case Direction::SendOnly: direction = Direction::RecvOnly; break;
+            case Direction::RecvOnly: direction = Direction::SendOnly; break;
+            case Direction::Inactive: direction = Direction::Inactive; break;
+            default: break;
+        }
+        peer->receives_return = direction == Direction::SendRecv || direction == Direction::SendOnly;
+
+        // ptime asks the peer for our frame duration; 10 ms halves the packetization delay
+        rtc::Description::Audio audio(remote_audio->mid(), direction);
+        audio.addOpusCodec(payload_type, std::string("minptime=10;useinbandfec=1") +
+                                         (media_channels_ == 2 ? ";stereo=1;sprop-stereo=1" : ""));
+        audio.addAttribute("ptime:" + std::to_string(options_.frame_ms));
+        if (peer->receives_return) {
+            audio.addSSRC(peer->ssrc, "onestop", "onestop-program", "program");
+        }
+        peer->track = peer->pc->addTrack(std::move(audio));
+        peer->track->setMediaHandler(std::make_shared<rtc::RtcpReceivingSession>());
+
+        std::weak_ptr<MediaPeer> weak = peer;
+        peer->pc->onLocalDescription([this, hdl](rtc::Description description) {
+            send_message(hdl, {{"type", description.typeString()}, {"sdp", std::string(description)}, {"success", true}});
+        });
+        peer->pc->onLocalCandidate([this, hdl](rtc::Candidate candidate) {
+            send_message(hdl, {{"type", "ice-candidate"}, {"candidate", candidate.candidate()}, {"sdpMid", candidate.mid()}});
+        });
+        peer->pc->onStateChange([weak](rtc::PeerConnection::State state) {
+            if (auto peer = weak.lock()) {
+                peer->state = state;
+                Logger::info("WebRTCServer", peer->id + " " + state_name(state));
+            }
+        });
+        peer->pc->onDataChannel([this, weak](std::shared_ptr<rtc::DataChannel> channel) {
+            auto peer = weak.lock();
+            if (!peer || channel->label() != kLatencyChannel) {
+                return;
+            }
+            channel->onMessage(nullptr, [this, weak](rtc::string text) {
+                if (auto peer = weak.lock()) {
+                    handle_latency_pong(*peer, json::parse(text, nullptr, false));
+                }
+            });
+            std::lock_guard<std::mutex> lock(peer->mutex);
+            peer->latency_channel = std::move(channel);
+        });
+        peer->track->onMessage([this, weak](rtc::binary message) {
+            if (auto peer = weak.lock()) {
+                receive_rtp(*peer, reinterpret_cast<const uint8_t*>(message.data()), message.size());
+            }
+        }, nullptr);
+
+        peer->pc->setRemoteDescription(std::move(offer));
+        return peer;
+    }
+
+    // Signalling thread; the media path forgets the peer on its next pass
+    void close_peer(MediaPeer& peer) {
+        stop_contribution(peer);
+        {
+            std::lock_guard<std::mutex> lock(peer.mutex);
+            peer.closed = true;
+            peer.latency_channel.reset();
+        }
+        if (peer.pc) {
+            peer.pc->close();
+        }
+    }
+
+    void stop_contribution(MediaPeer& peer) {
+        std::shared_ptr<LiveInput> input;
+        {
+            std::lock_guard<std::mutex> lock(peer.mutex);
+            peer.contributing = false;
+            peer.jitter.reset();
+            peer.unplaced = false;
+            peer.input_retry = kInputRetry;
+            peer.next_input_attempt = {};
+            input = std::move(peer.input);
+        }
+        if (input && audio_system_) {
+            audio_system_->destroy_live_input(input->id());
+        }
+    }
+
+    // libdatachannel thread
+    void receive_rtp(MediaPeer& peer, const uint8_t* data, size_t size) {
+        RtpPacket packet;
+        if (is_rtcp(data, size) || !parse_rtp(data, size, packet) || packet.payload_type != peer.payload_type) {
+            return;
+        }
+        metrics_.packets_received.increment();
+        const double arrival_ms = steady_ms();
+        std::lock_guard<std::mutex> lock(peer.mutex);
+        if (peer.contributing) {
+            const uint64_t late = peer.jitter.late();
+            peer.jitter.push(std::move(packet), arrival_ms);
+            metrics_.packets_late.increment(peer.jitter.late() - late);
+        }
+    }
+
+    // Keeps each contributing peer's live input one Opus frame past a mixer
+    // block, decoding and concealing from the jitter buffer as it drains
+    void media_loop() {
+        TRACE_THREAD_NAME("webrtc_media");
+        auto next_ping = std::chrono::steady_clock::now();
+        while (running_) {
+            const std::vector<std::shared_ptr<MediaPeer>> peers = media_peers();
+            const auto now = std::chrono::steady_clock::now();
+            const bool ping = now >= next_ping;
+            if (ping) {
+                next_ping = now + kPingInterval;
+            }
+            for (const auto& peer : peers) {
+                play_out(*peer);
+                if (ping) {
+                    send_ping(*peer);
+                }
+            }
+            metrics_.peers.set(static_cast<double>(peers.size()));
+            std::this_thread::sleep_for(kMediaTick);
+        }
+    }
+
+    void play_out(MediaPeer& peer) {
+        TRACE_SCOPE("webrtc_playout");
+        std::shared_ptr<LiveInput> input;
+        std::string stream_id;
+        {
+            std::lock_guard<std::mutex> lock(peer.mutex);
+            if (peer.closed || !peer.contributing || (peer.jitter.received() == 0)) {
+                return;
+            }
+            if (!peer.input && audio_system_) {
+                place_input(peer);
+            }
+            input = peer.input;
+            stream_id = peer.stream_id;
+        }
+        const size_t frame_frames = static_cast<size_t>(peer.frame_samples) * media_rate_ / kOpusRate;
+
+        for (;;) {
+            if (input && input->buffered_frames() >= input->block_frames() + frame_frames) {
+                return;
+            }
+
+            JitterBuffer::Result result;
+            bool excess = false;
+            {
+                std::lock_guard<std::mutex> lock(peer.mutex);
+                const uint64_t lost = peer.jitter.lost();
+                result = peer.jitter.pop(peer.payload);
+                metrics_.packets_lost.increment(peer.jitter.lost() - lost);
+                // Beyond two frames over target, catch up by dropping decoded audio
+                excess = peer.jitter.depth_ms() > peer.jitter.target_ms() + 2.0 * peer.jitter.frame_ms();
+            }
+            if (result == JitterBuffer::Result::EMPTY) {
+                return;
+            }
+
+            int samples = 0;
+            float* pcm = peer.decoded.data();
+            const unsigned char* data = peer.payload.data();
+            const opus_int32 size = static_cast<opus_int32>(peer.payload.size());
+            switch (result) {
+                case JitterBuffer::Result::PACKET:
+                    samples = opus_decode_float(peer.decoder, data, size, pcm, kMaxFrameSamples, 0);
+                    if (samples > 0) {
+                        peer.frame_samples = samples;
+                        std::lock_guard<std::mutex> lock(peer.mutex);
+                        peer.jitter.set_frame_ms(samples * 1000.0 / kOpusRate);
+                    }
+                    break;
+                case JitterBuffer::Result::RECOVER:
+                    samples = opus_decode_float(peer.decoder, data, size, pcm, peer.frame_samples, 1);
+                    break;
+                default:
+                    samples = opus_decode_float(peer.decoder, nullptr, 0, pcm, peer.frame_samples, 0);
+                    break;
+            }
+            if (samples <= 0) {
+                continue;   // A corrupt packet; the next one is decoded on the next pass
+            }
+            if (excess) {
+                peer.trimmed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            peer.converted.clear();
+            peer.from_opus->convert(pcm, samples, peer.converted);
+            const size_t frames = peer.converted.size() / media_channels_;
+            if (input) {
+                input->write(peer.converted.data(), frames);
+            }
+            if (audio_callback_) {
+                audio_callback_(stream_id, peer.converted.data(), frames, media_channels_);
+            }
+            if (!input) {
+                return; // Nothing paces a callback-only feed but the packets themselves
+            }
+        }
+    }
+
+    // Under peer.mutex. Until a slot frees up the peer plays out to the
+    // callback alone, and the attempts back off rather than run every tick.
+    void place_input(MediaPeer& peer) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now < peer.next_input_attempt) {
+            return;
+        }
+        peer.input = audio_system_->create_live_input("webrtc_" + peer.id);
+        if (peer.input) {
+            if (peer.unplaced) {
+                Logger::info("WebRTCServer", "Peer " + peer.id + " joined the mix");
+            }
+            peer.unplaced = false;
+            peer.input_retry = kInputRetry;
+            return;
+        }
+        if (!peer.unplaced) {
+            Logger::warn("WebRTCServer", "No mixer slot for peer " + peer.id + "; retrying in the background");
+            peer.unplaced = true;
         }
+        peer.next_input_attempt = now + peer.input_retry;
+        peer.input_retry = std::min<std::chrono::steady_clock::duration>(peer.input_retry * 2, kMaxInputRetry);
     }
+
+    void send_ping(MediaPeer& peer) {
+        json ping = {{"type", "latency-ping"}, {"t", steady_ms()}};
+        std::shared_ptr<rtc::DataChannel> channel;
+        {
+            std::lock_guard<std::mutex> lock(peer.mutex);
+            if (peer.closed || peer.state.load() != rtc::PeerConnection::State::Connected) {
+                return;
+            }
+            ping["id"] = ++peer.ping_id;
+            channel = peer.latency_channel;
+        }
+        // The data channel shares the media's path; the signalling socket may not
+        if (channel && channel->isOpen()) {
+            try {
+                channel->send(ping.dump());
+                return;
+            } catch (const std::exception&) {
+            }
+        }
+        send_message(peer.connection, ping);
+    }
+
+    // {"type":"latency-pong","t":<echoed>[,"capture_delay_ms":x][,"playout_delay_ms":y]}
+    void handle_latency_pong(MediaPeer& peer, const json& message) {
+        if (!message.is_object() || !message.contains("t") || !message["t"].is_number()) {
+            return;
+        }
+        const double rtt = steady_ms() - message["t"].get<double>();
+        if (rtt < 0.0 || rtt > 60000.0) {
+            return;
+        }
+        metrics_.rtt_seconds.observe(rtt / 1000.0);
+        std::lock_guard<std::mutex> lock(peer.mutex);
+        peer.rtt_ms = peer.rtt_ms > 0.0 ? peer.rtt_ms + (rtt - peer.rtt_ms) / 8.0 : rtt;
+        peer.remote_capture_ms = std::max(0.0, message.value("capture_delay_ms", 0.0));
+        peer.remote_playout_ms = std::max(0.0, message.value("playout_delay_ms", 0.0));
+    }
+
+    // Encodes the program bus once and sends each packet to every peer
+    // that receives audio, under that peer's SSRC and sequence
+    void return_loop() {
+        TRACE_THREAD_NAME("webrtc_return");
+        auto reader = audio_system_->create_master_bus_reader();
+        if (!reader) {
+            Logger::error("WebRTCServer", "No program bus; return disabled");
+            return;
+        }
+        int error = OPUS_OK;
+        OpusEncoder* encoder = opus_encoder_create(kOpusRate, media_channels_, OPUS_APPLICATION_RESTRICTED_LOWDELAY, &error);
+        if (error != OPUS_OK) {
+            Logger::error("WebRTCServer", std::string("Opus encoder: ") + opus_strerror(error));
+            return;
+        }
+        opus_encoder_ctl(encoder, OPUS_SET_BITRATE(options_.return_bitrate * 1000));
+        opus_int32 lookahead = 0;
+        opus_encoder_ctl(encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+        encoder_delay_ms_ = lookahead * 1000.0 / kOpusRate;
+
+        RateConverter to_opus(media_channels_, media_rate_, kOpusRate);
+        const size_t channels = static_cast<size_t>(media_channels_);
+        const size_t read_frames = static_cast<size_t>(media_rate_) * options_.frame_ms / 1000;
+        const int opus_frames = kOpusRate * options_.frame_ms / 1000;
+        std::vector<float> block(read_frames * channels);
+        std::vector<float> pending;
+        std::vector<uint8_t> packet(kRtpHeaderBytes + kMaxOpusPacket);
+
+        while (running_) {
+            if (reader->read(block.data(), read_frames, kReturnReadTimeout) == 0) {
+                continue;
+            }
+            // What the bus holds past this frame waits that long to go out
+            return_queue_ms_ = static_cast<double>(reader->available()) * 1000.0 / media_rate_;
+            to_opus.convert(block.data(), static_cast<int>(read_frames), pending);
+
+            while (pending.size() >= static_cast<size_t>(opus_frames) * channels) {
+                const std::vector<std::shared_ptr<MediaPeer>> peers = return_peers();
+                if (!peers.empty()) {
+                    TRACE_SCOPE("webrtc_return");
+                    const opus_int32 bytes = opus_encode_float(encoder, pending.data(), opus_frames,
+                                                               packet.data() + kRtpHeaderBytes, kMaxOpusPacket);
+                    if (bytes > 0) {
+                        send_return(peers, packet, static_cast<size_t>(bytes), opus_frames);
+                    }
+                }
+                pending.erase(pending.begin(), pending.begin() + static_cast<size_t>(opus_frames) * channels);
+            }
+        }
+        opus_encoder_destroy(encoder);
+    }
+
+    void send_return(const std::vector<std::shared_ptr<MediaPeer>>& peers, std::vector<uint8_t>& packet,
+                     size_t payload_bytes, int frame_samples) {
+        for (const auto& peer : peers) {
+            packet[0] = 0x80;
+            packet[1] = static_cast<uint8_t>(peer->payload_type & 0x7F);
+            write_be16(&packet[2], peer->sequence++);
+            write_be32(&packet[4], peer->timestamp);
+            write_be32(&packet[8], peer->ssrc);
+            peer->timestamp += static_cast<uint32_t>(frame_samples);
+            try {
+                peer->track->send(reinterpret_cast<const rtc::byte*>(packet.data()), kRtpHeaderBytes + payload_bytes);
+                peer->packets_sent.fetch_add(1, std::memory_order_relaxed);
+                metrics_.packets_sent.increment();
+            } catch (const std::exception& e) {
+                LOG_DEBUG("WebRTCServer", "Return to " + peer->id + " failed: " + e.what());
+            }
+        }
+    }
+
+    std::vector<std::shared_ptr<MediaPeer>> media_peers() const {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        std::vector<std::shared_ptr<MediaPeer>> peers;
+        for (const auto& pair : connections_) {
+            if (pair.second->peer) {
+                peers.push_back(pair.second->peer);
+            }
+        }
+        return peers;
+    }
+
+    std::vector<std::shared_ptr<MediaPeer>> return_peers() const {
+        std::vector<std::shared_ptr<MediaPeer>> peers = media_peers();
+        peers.erase(std::remove_if(peers.begin(), peers.end(), [](const std::shared_ptr<MediaPeer>& peer) {
+            return !peer->receives_return || !peer->track->isOpen();
+        }), peers.end());
+        return peers;
+    }
+
+    std::shared_ptr<MediaPeer> find_peer(websocketpp::connection_hdl hdl) const {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        auto it = connections_.find(hdl);
+        return it != connections_.end() ? it->second->peer : nullptr;
+    }
+
+    std::vector<WebRTCPeerStats> get_peer_stats() const {
+        const double output_ms = audio_system_ ? audio_system_->get_output_latency() * 1000.0 : 0.0;
+        const double queue_ms = return_queue_ms_.load();
+        const double encoder_ms = encoder_delay_ms_.load();
+
+        std::vector<WebRTCPeerStats> stats;
+        for (const auto& peer : media_peers()) {
+            WebRTCPeerStats peer_stats;
+            peer_stats.peer_id = peer->id;
+            peer_stats.state = state_name(peer->state.load());
+            peer_stats.packets_sent = peer->packets_sent.load(std::memory_order_relaxed);
+            peer_stats.packets_discarded = peer->trimmed.load(std::memory_order_relaxed);
+
+            double input_ms = 0.0;
+            double capture_ms = 0.0;
+            double playout_ms = 0.0;
+            {
+                std::lock_guard<std::mutex> lock(peer->mutex);
+                const JitterBuffer& jitter = peer->jitter;
+                peer_stats.stream_id = peer->stream_id;
+                peer_stats.packets_received = jitter.received();
+                peer_stats.packets_lost = jitter.lost();
+                peer_stats.packets_late = jitter.late();
+                peer_stats.packets_recovered = jitter.recovered();
+                peer_stats.packets_discarded += jitter.discarded();
+                peer_stats.jitter_ms = jitter.jitter_ms();
+                peer_stats.jitter_buffer_ms = jitter.depth_ms();
+                peer_stats.jitter_target_ms = jitter.target_ms();
+                peer_stats.rtt_ms = peer->rtt_ms;
+                if (peer->input) {
+                    peer_stats.input_channel = peer->input->id();
+                    peer_stats.mixer_underruns = peer->input->underruns();
+                    input_ms = static_cast<double>(peer->input->buffered_frames()) * 1000.0 / media_rate_;
+                }
+                capture_ms = peer->remote_capture_ms + jitter.frame_ms();
+                playout_ms = peer->remote_playout_ms;
+            }
+
+            // Capture and packetization, half the round trip, our two buffers, then the device
+            const double one_way_ms = peer_stats.rtt_ms / 2.0;
+            const double to_mix_ms = capture_ms + one_way_ms + peer_stats.jitter_buffer_ms + input_ms;
+            peer_stats.contribution_latency_ms = to_mix_ms + output_ms;
+            // The program bus is written before the device plays it
+            peer_stats.return_latency_ms = queue_ms + options_.frame_ms + encoder_ms + one_way_ms + playout_ms;
+            peer_stats.round_trip_latency_ms = to_mix_ms + peer_stats.return_latency_ms;
+            stats.push_back(std::move(peer_stats));
+        }
+        return stats;
+    }
+
+    size_t get_connection_count() const {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        return connections_.size();
+    }
+
+    size_t get_streaming_count() const {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+
+        size_t streaming_count = 0;
+        for (const auto& pair : connections_) {
+            if (pair.second->is_streaming) {
+                streaming_count++;
+            }
+        }
+
+        return streaming_count;
+    }
+
+    std::vector<std::string> get_active_streams() const {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+
+        std::vector<std::string> streams;
+        for (const auto& pair : connections_) {
+            if (pair.second->is_streaming && !pair.second->stream_id.empty()) {
+                streams.push_back(pair.second->stream_id);
+            }
+        }
+
+        return streams;
+    }
+
+    int port_;
+    WebRTCOptions options_;
+    AudioSystem* audio_system_ = nullptr;
+    WebRTCServer::AudioDataCallback audio_callback_;
+    std::atomic<bool> running_{false};
+    WebRTCMetrics& metrics_ = webrtc_metrics();
+
+    SignalingServer signaling_server_;
+    std::thread server_thread_;
+    std::map<websocketpp::connection_hdl, std::shared_ptr<WebRTCClient>,
+             std::owner_less<websocketpp::connection_hdl>> connections_;
+    mutable std::mutex connections_mutex_;
+
+    // Fixed at start(): the mixer's format, or stereo 48 kHz without one
+    int media_rate_ = kOpusRate;
+    int media_channels_ = 2;
+    std::thread media_thread_;
+    std::thread return_thread_;
+    std::atomic<double> return_queue_ms_{0.0};
+    std::atomic<double> encoder_delay_ms_{0.0};
+    std::atomic<uint64_t> peer_counter_{0};
+    std::mutex random_mutex_;
+    std::mt19937 random_;
+};
+
+WebRTCServer::WebRTCServer(int port, const WebRTCOptions& options)
+    : impl_(std::make_unique<Impl>(port, options)) {
+    Logger::info("WebRTCServer", "Initialized on port " + std::to_string(port));
+}
+
+WebRTCServer::~WebRTCServer() {
+    stop();
+}
+
+void WebRTCServer::set_audio_system(AudioSystem* audio_system) {
+    impl_->audio_system_ = audio_system;
 }
 
 void WebRTCServer::set_audio_data_callback(AudioDataCallback callback) {
-    audio_callback_ = std::move(callback);
+    impl_->audio_callback_ = std::move(callback);
     Logger::info("WebRTCServer", "Audio data callback registered");
 }
 
+bool WebRTCServer::start() {
+    return impl_->start();
+}
+
+void WebRTCServer::stop() {
+    impl_->stop();
+}
+
+bool WebRTCServer::is_running() const {
+    return impl_->running_;
+}
+
 size_t WebRTCServer::get_connection_count() const {
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    return connections_.size();
+    return impl_->get_connection_count();
 }
 
 size_t WebRTCServer::get_streaming_count() const {
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    
-    size_t streaming_count = 0;
-    for (const auto& pair : connections_) {
-        if (pair.second->is_streaming) {
-            streaming_count++;
-        }
-    }
-    
-    return streaming_count;
+    return impl_->get_streaming_count();
 }
 
 std::vector<std::string> WebRTCServer::get_active_streams() const {
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    
-    std::vector<std::string> streams;
-    for (const auto& pair : connections_) {
-        if (pair.second->is_streaming && !pair.second->stream_id.empty()) {
-            streams.push_back(pair.second->stream_id);
-        }
-    }
-    
-    return streams;
-}
\ No newline at end of file
+    return impl_->get_active_streams();
+}
+
+std::vector<WebRTCPeerStats> WebRTCServer::get_peer_stats() const {
+    return impl_->get_peer_stats();
+}